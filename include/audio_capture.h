@@ -0,0 +1,89 @@
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include <stdint.h>
+#include "platform.h"
+#include "frame_pool.h"
+#include "spsc_ring.h"
+#include "audio_source.h"
+
+// One capture thread per audio source. The thread sleeps in the source's
+// wait() until the device signals a buffer, copies every ready packet into a
+// pooled packet and pushes the packet handle onto an SPSC ring; the consumer
+// (the engine's mux thread) pops, writes and releases it. The device buffer
+// goes back to the driver as soon as it is copied, so a slow consumer fills
+// the ring rather than overrunning the device.
+
+#define AUDIO_CAPTURE_DEFAULT_DEPTH 128
+#define AUDIO_CAPTURE_PACKET_MS 20         // Larger device buffers are split
+#define AUDIO_CAPTURE_MAX_ERRORS 100       // Consecutive source errors before the thread gives up
+
+typedef struct {
+    frame_handle_t packet;          // Samples, in the capture's packet pool
+    uint32_t frames;
+    uint64_t position;              // Frames captured before this packet
+} audio_packet_t;
+
+typedef struct {
+    uint64_t wakes;                 // Woken by the device
+    uint64_t timeouts;              // Woken by the wait timeout
+    uint64_t packets;
+    uint64_t frames;
+    uint64_t dropped_frames;        // Ring or packet pool full
+    uint64_t errors;
+} audio_capture_stats_t;
+
+// Called on the capture thread after packets were queued
+typedef void (*audio_capture_notify_fn)(void* context);
+
+// Status line sink for audio_capture_report
+typedef void (*audio_capture_report_fn)(const char* message);
+
+typedef struct {
+    const char* name;
+    audio_source_t* source;
+    frame_pool_t pool;
+    spsc_ring_t queue;
+    uint32_t packet_frames;
+    unsigned int wait_ms;           // Longest sleep without a device signal
+    audio_capture_notify_fn notify;
+    void* notify_context;
+
+    platform_thread_t thread;
+    int started;
+    platform_atomic_t stopping;
+    platform_atomic_t failed;
+
+    // Capture thread only
+    uint64_t position;
+    int consecutive_errors;
+    audio_capture_stats_t stats;
+} audio_capture_t;
+
+// The source must outlive the capture; queue_depth 0 = AUDIO_CAPTURE_DEFAULT_DEPTH
+int audio_capture_init(audio_capture_t* capture, const char* name, audio_source_t* source, unsigned int queue_depth);
+void audio_capture_set_notify(audio_capture_t* capture, audio_capture_notify_fn notify, void* context);
+
+// Starts the source, then its thread
+int audio_capture_start(audio_capture_t* capture);
+
+// Joins the thread after a last drain, then stops the source. Packets still
+// queued stay poppable.
+void audio_capture_stop(audio_capture_t* capture);
+
+// The thread gave up after repeated source errors
+int audio_capture_failed(audio_capture_t* capture);
+
+// Consumer side: pop a packet, read its samples, release it
+int audio_capture_pop(audio_capture_t* capture, audio_packet_t* packet);
+const uint8_t* audio_capture_packet_data(audio_capture_t* capture, const audio_packet_t* packet);
+void audio_capture_release(audio_capture_t* capture, const audio_packet_t* packet);
+
+// Exact once the thread is stopped
+void audio_capture_get_stats(audio_capture_t* capture, audio_capture_stats_t* stats);
+void audio_capture_report(audio_capture_t* capture, audio_capture_report_fn report);
+
+// Stops if needed and drops anything left in the queue
+void audio_capture_cleanup(audio_capture_t* capture);
+
+#endif // AUDIO_CAPTURE_H
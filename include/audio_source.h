@@ -0,0 +1,58 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <stdint.h>
+
+// Where audio packets come from: WASAPI microphone and loopback endpoints on
+// Windows, and a timer-driven simulated device that lets the capture thread
+// run and be tested anywhere. Every backend is event driven: wait() sleeps
+// until the device signals that a buffer is ready (or the timeout passes),
+// then get_buffer/release_buffer are called until the device is drained.
+//
+// Samples are interleaved PCM in the source's format.
+
+// Wait results
+#define AUDIO_WAIT_READY    0      // The device signalled a buffer
+#define AUDIO_WAIT_TIMEOUT  1      // Nothing signalled; draining anyway is harmless
+
+typedef struct audio_source audio_source_t;
+
+typedef struct {
+    const char* name;
+    int (*start)(audio_source_t* source);
+    // Returns AUDIO_WAIT_* or -1 on error
+    int (*wait)(audio_source_t* source, unsigned int timeout_ms);
+    // Next packet: 0 with *frames = 0 once drained, -1 on error
+    int (*get_buffer)(audio_source_t* source, const uint8_t** data, uint32_t* frames);
+    void (*release_buffer)(audio_source_t* source, uint32_t frames);
+    void (*stop)(audio_source_t* source);
+    // Optional, run on the capture thread around its loop (COM, thread priority)
+    void (*thread_init)(audio_source_t* source);
+    void (*thread_exit)(audio_source_t* source);
+    void (*destroy)(audio_source_t* source);
+} audio_source_ops_t;
+
+struct audio_source {
+    const audio_source_ops_t* ops;
+    void* impl;
+    int sample_rate;
+    int channels;
+    int bits_per_sample;
+    int block_align;                // Bytes per frame (all channels)
+    unsigned int period_ms;         // How often the device has a buffer ready
+    unsigned int buffer_ms;         // Device buffer length; audio is lost when not drained in time
+};
+
+// Dispatch helpers; all tolerate a source whose create failed
+int audio_source_start(audio_source_t* source);
+int audio_source_wait(audio_source_t* source, unsigned int timeout_ms);
+int audio_source_get_buffer(audio_source_t* source, const uint8_t** data, uint32_t* frames);
+void audio_source_release_buffer(audio_source_t* source, uint32_t frames);
+void audio_source_stop(audio_source_t* source);
+void audio_source_thread_init(audio_source_t* source);
+void audio_source_thread_exit(audio_source_t* source);
+void audio_source_destroy(audio_source_t* source);
+
+const char* audio_source_name(const audio_source_t* source);
+
+#endif // AUDIO_SOURCE_H
@@ -0,0 +1,38 @@
+#ifndef CAPTURE_REGION_H
+#define CAPTURE_REGION_H
+
+#include "dirty_frame.h"
+
+// Sub-rectangle of the desktop that is captured and encoded. Only the region
+// is read back; desktop updates are translated into region coordinates, and
+// anything outside it is dropped before it reaches the GPU copy.
+
+#define CAPTURE_REGION_ALIGNMENT 2  // 4:2:0 video needs even dimensions
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} capture_region_t;
+
+// Whole-desktop region
+void capture_region_full(capture_region_t* region, int desktop_width, int desktop_height);
+
+// Clip a requested region to the desktop and round its size down to the codec
+// alignment. Returns 0 if anything usable remains, -1 otherwise.
+int capture_region_resolve(capture_region_t* region, int desktop_width, int desktop_height);
+
+int capture_region_is_full(const capture_region_t* region, int desktop_width, int desktop_height);
+
+// Translate desktop move and dirty rects into region coordinates. Moves whose
+// source lies partly outside the region cannot be replayed from the region's
+// own pixels and become dirty rects instead, so dirty_out must have room for
+// dirty_count + move_count rects and moves_out for move_count moves.
+void capture_region_map_updates(const capture_region_t* region,
+                                const frame_move_t* moves, int move_count,
+                                const frame_rect_t* dirty, int dirty_count,
+                                frame_move_t* moves_out, int* moves_out_count,
+                                frame_rect_t* dirty_out, int* dirty_out_count);
+
+#endif // CAPTURE_REGION_H
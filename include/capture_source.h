@@ -0,0 +1,60 @@
+#ifndef CAPTURE_SOURCE_H
+#define CAPTURE_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame_pool.h"
+
+// Where video frames come from. The engine drives every backend through the
+// same small vtable: desktop duplication on Windows, and the portable
+// synthetic and raw-file replay sources that let the capture -> convert ->
+// encode path run and be profiled without a desktop.
+//
+// Frames are tightly packed BGRA (pitch = width * 4) written into pool frames;
+// the caller picks top-down or bottom-up per call.
+
+// Frame acquisition results
+#define CAPTURE_FRAME_NEW      0   // *frame holds a new pool reference
+#define CAPTURE_FRAME_NONE     1   // Nothing to deliver yet
+#define CAPTURE_FRAME_REPEAT   2   // Content unchanged, reuse the previous frame
+
+typedef struct capture_source capture_source_t;
+
+// Status line sink for capture_source_report
+typedef void (*capture_report_fn)(const char* message);
+
+typedef struct {
+    const char* name;
+    // Attach the pool frames are delivered in; called before start
+    int (*set_pool)(capture_source_t* source, frame_pool_t* pool);
+    int (*start)(capture_source_t* source);
+    // Returns CAPTURE_FRAME_* or -1 on error
+    int (*get_frame)(capture_source_t* source, frame_handle_t* frame, int top_down);
+    void (*stop)(capture_source_t* source);
+    // Optional end-of-recording statistics
+    void (*report)(capture_source_t* source, capture_report_fn report);
+    void (*destroy)(capture_source_t* source);
+} capture_source_ops_t;
+
+struct capture_source {
+    const capture_source_ops_t* ops;
+    void* impl;
+    int width;
+    int height;
+    int fps;                        // Native frame rate if the source has one, 0 otherwise
+    int finished;                   // No more frames will come (end of a replay file)
+    frame_pool_t* pool;
+    uint64_t frames_delivered;
+};
+
+// Dispatch helpers; all tolerate a source whose create failed
+int capture_source_set_pool(capture_source_t* source, frame_pool_t* pool);
+int capture_source_start(capture_source_t* source);
+int capture_source_get_frame(capture_source_t* source, frame_handle_t* frame, int top_down);
+void capture_source_stop(capture_source_t* source);
+void capture_source_report(capture_source_t* source, capture_report_fn report);
+void capture_source_destroy(capture_source_t* source);
+
+const char* capture_source_name(const capture_source_t* source);
+
+#endif // CAPTURE_SOURCE_H
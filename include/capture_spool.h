@@ -0,0 +1,143 @@
+#ifndef CAPTURE_SPOOL_H
+#define CAPTURE_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+#include "tile_hash.h"
+
+// Capture spool: "capture now, encode later". Frames go to a memory-mapped
+// file as they are captured and are encoded afterwards, when real-time
+// encoding cannot keep up. Each frame is cut into 64x64 tiles and every
+// distinct tile is stored once: frames list the tiles that changed by index
+// into the tiles stored so far, so a static desktop costs a few bytes per
+// frame and a window moving over it only its new tiles.
+//
+// The file is written strictly front to back and a record only refers to
+// tiles before it, so it can be read as a stream, and followed by a reader
+// while it is still being written.
+//
+// Format, little-endian. Every record starts on an 8-byte boundary.
+//
+// Header, 64 bytes:
+//   0  "MUXSWSPL"   magic
+//   8  uint32       version (1)
+//   12 uint32       width
+//   16 uint32       height
+//   20 uint32       tile size (64)
+//   24 uint32       fps the frames were captured at (0 = unknown)
+//   28 uint32       flags: 1 = complete, the writer closed the file
+//   32 uint64       committed: bytes from the start of the file through the
+//                   last whole frame; anything after it is unfinished
+//   40 uint64       frames committed
+//   48 uint64       tiles committed
+//   56 uint64       reserved, 0
+//
+// Records: uint32 type, uint32 record size (header and padding included),
+// then by type:
+//   1 tile   uint64 hash, uint16 width, uint16 height, uint32 reserved, then
+//            width * height BGRA pixels, rows top-down. Tiles are numbered
+//            from 0 in file order; edge tiles are smaller.
+//   2 frame  int64 capture time (100 ns units), uint32 count, uint32
+//            reserved, then count pairs of uint32 position, uint32 tile.
+//            Positions number the frame's tiles in rows from the top left;
+//            each pair names the tile now at that position. The first frame
+//            lists every position; a count of 0 repeats the previous frame.
+//
+// A frame's new tiles come right before it and the header counts move past
+// both at once, so a reader never sees half a frame. Records of unknown type
+// are skipped.
+
+#define CAPTURE_SPOOL_MAGIC "MUXSWSPL"
+#define CAPTURE_SPOOL_VERSION 1
+#define CAPTURE_SPOOL_HEADER_SIZE 64
+#define CAPTURE_SPOOL_TILE 64
+#define CAPTURE_SPOOL_MAX_DIMENSION 16384
+#define CAPTURE_SPOOL_FLAG_COMPLETE 1
+#define CAPTURE_SPOOL_RECORD_TILE 1
+#define CAPTURE_SPOOL_RECORD_FRAME 2
+
+typedef struct {
+    uint64_t frames;                // Appended, repeats included
+    uint64_t repeats;               // Frames with no changed tile
+    uint64_t tiles_stored;          // Distinct tiles written
+    uint64_t tiles_reused;          // Changed positions whose content was already stored
+    uint64_t tile_refs;             // Position pairs written
+    uint64_t bytes;                 // File length
+    uint64_t raw_bytes;             // What the frames take uncompressed
+    uint64_t remaps;                // Times the file grew
+} capture_spool_stats_t;
+
+typedef struct {
+    platform_map_t map;
+    int width;
+    int height;
+    int fps;
+    int tiles_x;
+    int tiles_y;
+    size_t used;                    // Bytes committed
+
+    tile_hash_t hash;               // Finds the changed tiles
+    uint32_t* current;              // Tile at each position in the latest frame
+    uint32_t* pairs;                // Scratch for a frame's pairs
+
+    // Stored tiles, and an open-addressing table over their hashes
+    uint64_t* tile_hashes;
+    uint64_t* tile_offsets;         // Of each tile's record
+    uint32_t tile_count;
+    uint32_t tile_capacity;
+    uint32_t* table;                // Tile index + 1, 0 when empty
+    uint32_t table_size;            // Power of two, at least twice tile_count
+
+    int has_frame;
+    capture_spool_stats_t stats;
+} capture_spool_writer_t;
+
+typedef struct {
+    int64_t time;                   // 100 ns units
+    uint32_t changed_tiles;         // 0: same pixels as the previous frame
+} capture_spool_frame_t;
+
+typedef struct {
+    platform_map_t map;
+    int width;
+    int height;
+    int fps;
+    int tiles_x;
+    int tiles_y;
+    int complete;                   // The writer has closed the file
+    size_t committed;
+    size_t offset;                  // Next record
+
+    uint64_t* tile_offsets;
+    uint32_t tile_count;
+    uint32_t tile_capacity;
+    uint32_t* current;              // Tile at each position
+    int has_frame;
+    uint64_t frames;
+} capture_spool_reader_t;
+
+// Status line sink for capture_spool_writer_report
+typedef void (*capture_spool_report_fn)(const char* message);
+
+// Writer. Frames are top-down BGRA; time in 100 ns units, increasing.
+int capture_spool_writer_open(capture_spool_writer_t* writer, const char* path, int width, int height, int fps);
+int capture_spool_writer_append(capture_spool_writer_t* writer, const uint8_t* pixels, size_t pitch, int64_t time);
+// The previous frame again, without hashing it
+int capture_spool_writer_repeat(capture_spool_writer_t* writer, int64_t time);
+// Mark the file complete and cut it to its length
+int capture_spool_writer_close(capture_spool_writer_t* writer);
+void capture_spool_writer_report(const capture_spool_writer_t* writer, capture_spool_report_fn report);
+
+// Reader. next() rebuilds the following frame into pixels (top-down BGRA,
+// pitch at least width * 4) and returns 1, 0 when no whole frame follows yet
+// (reader->complete: none ever will), or -1 if the file is damaged. With
+// pixels NULL it only moves to the frame, and compose() rebuilds it later,
+// so a frame that turns out to be a repeat costs no copy.
+int capture_spool_reader_open(capture_spool_reader_t* reader, const char* path);
+int capture_spool_reader_next(capture_spool_reader_t* reader, uint8_t* pixels, size_t pitch,
+                              capture_spool_frame_t* frame);
+int capture_spool_reader_compose(const capture_spool_reader_t* reader, uint8_t* pixels, size_t pitch);
+void capture_spool_reader_close(capture_spool_reader_t* reader);
+
+#endif // CAPTURE_SPOOL_H
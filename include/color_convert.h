@@ -0,0 +1,73 @@
+#ifndef COLOR_CONVERT_H
+#define COLOR_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "copy_kernels.h"
+#include "worker_pool.h"
+
+// BGRA to 4:2:0 YUV conversion for the encoder input, so Media Foundation
+// receives 1.5 bytes per pixel instead of 4 and does no colour conversion of
+// its own. Chroma is the mean of each 2x2 block. The matrix and range must
+// match the MF_MT_YUV_MATRIX and MF_MT_VIDEO_NOMINAL_RANGE the encoder
+// advertises, or players will shift colours and black/white levels.
+
+typedef enum {
+    COLOR_MATRIX_BT601 = 0,     // SD (Kr 0.299, Kb 0.114)
+    COLOR_MATRIX_BT709          // HD (Kr 0.2126, Kb 0.0722)
+} color_matrix_t;
+
+typedef enum {
+    COLOR_RANGE_LIMITED = 0,    // Y 16-235, chroma 16-240 (MFNominalRange_16_235)
+    COLOR_RANGE_FULL            // 0-255 on every plane (MFNominalRange_0_255)
+} color_range_t;
+
+typedef enum {
+    COLOR_FORMAT_NV12 = 0,      // Y plane, then interleaved UV plane at half resolution
+    COLOR_FORMAT_I420           // Y plane, then U and V planes at half resolution
+} color_format_t;
+
+#define COLOR_COEFF_BITS 14
+
+typedef struct {
+    color_matrix_t matrix;
+    color_range_t range;
+    copy_kernel_level_t level;  // SIMD level used by the kernels
+    int16_t y_coeff[3];         // B, G, R weights for luma (COLOR_COEFF_BITS fixed point)
+    int16_t u_coeff[3];         // B, G, R weights for Cb
+    int16_t v_coeff[3];         // B, G, R weights for Cr
+    int32_t y_offset;           // 16 for limited range, 0 for full
+    worker_pool_t* pool;        // Frame slices run here; NULL converts on the calling thread
+} color_converter_t;
+
+// Destination planes; unused planes are NULL (plane 2 for NV12)
+typedef struct {
+    uint8_t* planes[3];
+    size_t pitches[3];
+} color_planes_t;
+
+int color_converter_init(color_converter_t* converter, color_matrix_t matrix, color_range_t range);
+
+// Override the SIMD level (tests and benchmarks); returns -1 if unsupported
+int color_converter_set_level(color_converter_t* converter, copy_kernel_level_t level);
+
+// Split whole-frame conversions across a worker pool (NULL to stop); the pool must outlive its use
+void color_converter_set_pool(color_converter_t* converter, worker_pool_t* pool);
+
+// Convert a top-down BGRA frame. Width and height must be even.
+int color_convert_frame(const color_converter_t* converter, color_format_t format, const color_planes_t* dst,
+                        const uint8_t* src, size_t src_pitch, int width, int height);
+
+// Convert source rows [row_begin, row_end); both must be even (one chroma row per two luma rows)
+int color_convert_rows(const color_converter_t* converter, color_format_t format, const color_planes_t* dst,
+                       const uint8_t* src, size_t src_pitch, int width, int row_begin, int row_end);
+
+// Tightly packed layout of a whole frame in one buffer, as Media Foundation expects it
+size_t color_frame_size(color_format_t format, int width, int height);
+int color_planes_for_buffer(color_format_t format, uint8_t* buffer, int width, int height, color_planes_t* planes);
+
+const char* color_matrix_name(color_matrix_t matrix);
+const char* color_range_name(color_range_t range);
+const char* color_format_name(color_format_t format);
+
+#endif // COLOR_CONVERT_H
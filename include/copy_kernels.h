@@ -0,0 +1,42 @@
+#ifndef COPY_KERNELS_H
+#define COPY_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Strided plane copies used on the frame readback path: plain copies, pitch
+// repacking between surfaces with different row pitches, and copies with a
+// vertical flip. Copies large enough to thrash the last-level cache use
+// non-temporal stores so they do not evict the working set of the rest of the
+// pipeline, with the widest SIMD variant the CPU and OS support selected at
+// runtime from CPUID.
+
+typedef enum {
+    COPY_KERNEL_SCALAR = 0,
+    COPY_KERNEL_SSE2,
+    COPY_KERNEL_AVX2,
+    COPY_KERNEL_AVX512,
+    COPY_KERNEL_COUNT
+} copy_kernel_level_t;
+
+// Copy rows of row_bytes each. With flip_vertical, source row i lands in
+// destination row (rows - 1 - i). Pitches may differ (pitch repacking).
+void copy_plane(uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch,
+                size_t row_bytes, int rows, int flip_vertical);
+
+// Same as copy_plane with an explicit kernel level, for tests and benchmarks.
+// Returns -1 if the level is not supported on this machine.
+int copy_plane_with(copy_kernel_level_t level, uint8_t* dst, size_t dst_pitch,
+                    const uint8_t* src, size_t src_pitch, size_t row_bytes, int rows, int flip_vertical);
+
+// Dispatch control
+copy_kernel_level_t copy_kernels_best_level(void);
+int copy_kernels_supported(copy_kernel_level_t level);
+const char* copy_kernels_level_name(copy_kernel_level_t level);
+
+// Copies of at least this many bytes use non-temporal stores; 0 restores the
+// default, the last-level cache size reported by CPUID
+size_t copy_kernels_nt_threshold(void);
+void copy_kernels_set_nt_threshold(size_t bytes);
+
+#endif // COPY_KERNELS_H
@@ -0,0 +1,89 @@
+#ifndef CURSOR_COMPOSITOR_H
+#define CURSOR_COMPOSITOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "copy_kernels.h"
+#include "dirty_frame.h"
+
+// Software cursor for captured frames. Desktop duplication delivers the
+// desktop without the pointer, plus the pointer shape and position on the
+// side; this decodes the shape once into premultiplied BGRA (and an XOR
+// plane for the inverting pixels of monochrome and masked-color cursors),
+// caches it, and alpha-blends only the cursor rectangle into a frame:
+//
+//     out = color + dst * (255 - color.alpha) / 255, then XOR xor_mask
+//
+// The blend rounds exactly, so the SSE2/AVX2 kernels match the scalar one.
+
+#define CURSOR_MAX_SIZE 256         // Largest shape width or height accepted
+#define CURSOR_CACHE_SIZE 8         // Decoded shapes kept, least recently used evicted
+
+// Shape encodings, same values as DXGI_OUTDUPL_POINTER_SHAPE_TYPE
+typedef enum {
+    CURSOR_SHAPE_MONOCHROME = 1,    // 1 bpp AND mask rows followed by XOR mask rows
+    CURSOR_SHAPE_COLOR = 2,         // 32 bpp BGRA with straight alpha
+    CURSOR_SHAPE_MASKED_COLOR = 4   // 32 bpp BGR, alpha 0 replaces the screen, 0xFF XORs it
+} cursor_shape_type_t;
+
+typedef struct {
+    uint64_t key;                   // Hash of the raw shape, 0 for an empty entry
+    int width;
+    int height;
+    int hot_x;
+    int hot_y;
+    uint32_t* color;                // width * height premultiplied BGRA
+    uint32_t* xor_mask;             // width * height, NULL if no pixel inverts the screen
+    uint64_t last_used;
+} cursor_shape_t;
+
+typedef struct {
+    cursor_shape_t cache[CURSOR_CACHE_SIZE];
+    int current;                    // Cache index of the active shape, -1 before the first one
+    int x;                          // Top-left corner of the shape, in capture coordinates
+    int y;
+    int visible;
+    copy_kernel_level_t level;      // SIMD level used by the blend
+    uint64_t generation;            // Bumped whenever the drawn cursor would look different
+    uint64_t clock;                 // LRU clock for the cache
+
+    // Statistics
+    uint64_t shape_updates;
+    uint64_t cache_hits;
+    uint64_t blends;
+} cursor_compositor_t;
+
+// Lifecycle
+int cursor_compositor_init(cursor_compositor_t* cursor);
+void cursor_compositor_cleanup(cursor_compositor_t* cursor);
+
+// Override the SIMD level (tests and benchmarks); returns -1 if unsupported
+int cursor_compositor_set_level(cursor_compositor_t* cursor, copy_kernel_level_t level);
+
+// Make a shape current, decoding it unless an identical one is cached. Width,
+// height and pitch are as reported by DXGI: a monochrome shape's height covers
+// both masks, so the cursor itself is height / 2 rows tall.
+int cursor_compositor_set_shape(cursor_compositor_t* cursor, cursor_shape_type_t type, const uint8_t* data,
+                                int width, int height, int pitch, int hot_x, int hot_y);
+
+// Move or hide the cursor; (x, y) is the shape's top-left corner
+void cursor_compositor_set_position(cursor_compositor_t* cursor, int x, int y, int visible);
+
+// Frame rectangle the cursor covers when drawn at (origin_x, origin_y) of a
+// width x height frame. Returns 0 if nothing would be drawn.
+int cursor_compositor_bounds(const cursor_compositor_t* cursor, int width, int height,
+                             int origin_x, int origin_y, frame_rect_t* rect);
+
+// Blend the cursor into a BGRA frame. The cursor's coordinate space starts at
+// (origin_x, origin_y) of the frame; with flip_vertical the frame is stored
+// bottom-up. *drawn (optional) receives the covered rect in top-down frame
+// coordinates, empty if nothing was drawn.
+int cursor_compositor_draw(cursor_compositor_t* cursor, uint8_t* pixels, size_t pitch, int width, int height,
+                           int origin_x, int origin_y, int flip_vertical, frame_rect_t* drawn);
+
+// Decode a raw shape of width x height cursor pixels (tests and benchmarks).
+// xor_mask is always written; *has_xor reports whether any entry is non-zero.
+int cursor_decode_shape(cursor_shape_type_t type, const uint8_t* data, int width, int height, int pitch,
+                        uint32_t* color, uint32_t* xor_mask, int* has_xor);
+
+#endif // CURSOR_COMPOSITOR_H
@@ -0,0 +1,73 @@
+#ifndef DESKTOP_CANVAS_H
+#define DESKTOP_CANVAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+#include "capture_region.h"
+
+// Virtual desktop capture: every output gets its own worker thread, and all
+// of them read back in parallel straight into their place on one shared BGRA
+// canvas laid out by desktop coordinates. Gaps between outputs stay black.
+
+#define DESKTOP_CANVAS_MAX_OUTPUTS 16
+
+// Output capture results
+#define CANVAS_OUTPUT_NEW        0   // Output pixels in the canvas were updated
+#define CANVAS_OUTPUT_UNCHANGED  1   // Output had nothing new
+
+// Write the output's current image to dst (top-down BGRA, width x height of
+// the output). Called on the output's worker thread. Returns CANVAS_OUTPUT_NEW,
+// CANVAS_OUTPUT_UNCHANGED or -1 on error.
+typedef int (*canvas_capture_fn)(void* context, uint8_t* dst, size_t dst_pitch);
+
+typedef struct {
+    capture_region_t desktop;   // Output rectangle in desktop coordinates (may be negative)
+    canvas_capture_fn capture;
+    void* context;
+} canvas_output_desc_t;
+
+struct desktop_canvas;
+
+typedef struct {
+    canvas_output_desc_t desc;
+    struct desktop_canvas* canvas;
+    platform_thread_t thread;
+    int thread_started;
+    uint64_t last_sequence;     // Last capture request this worker completed
+    int last_result;
+    uint64_t updates;
+    uint64_t failures;
+} canvas_output_t;
+
+typedef struct desktop_canvas {
+    uint8_t* pixels;
+    int width;
+    int height;
+    size_t stride;
+    int origin_x;               // Desktop coordinate of canvas column 0
+    int origin_y;               // Desktop coordinate of canvas row 0
+    canvas_output_t outputs[DESKTOP_CANVAS_MAX_OUTPUTS];
+    int output_count;
+
+    platform_mutex_t lock;
+    platform_cond_t work_ready;
+    platform_cond_t work_done;
+    uint64_t sequence;          // Capture requests issued
+    int pending;                // Workers still busy with the current request
+    int stopping;
+    uint64_t frames;
+} desktop_canvas_t;
+
+// Lifecycle - init lays out the canvas and starts one worker per output
+int desktop_canvas_init(desktop_canvas_t* canvas, const canvas_output_desc_t* outputs, int output_count);
+void desktop_canvas_cleanup(desktop_canvas_t* canvas);
+
+// Capture every output in parallel and wait for all of them. Returns the
+// number of outputs that changed, or -1 if any output failed.
+int desktop_canvas_capture(desktop_canvas_t* canvas);
+
+// Bounding box of the outputs in desktop coordinates; fails on empty or overlapping outputs
+int desktop_canvas_layout(const canvas_output_desc_t* outputs, int output_count, capture_region_t* bounds);
+
+#endif // DESKTOP_CANVAS_H
@@ -0,0 +1,77 @@
+#ifndef DIRTY_FRAME_H
+#define DIRTY_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental frame updates driven by dirty and move rectangles.
+// A persistent CPU-side BGRA frame is patched with only the regions that
+// changed; the per-update changed region list and a short damage history let
+// downstream buffers that are a few updates old catch up without full copies.
+
+#define DIRTY_FRAME_BYTES_PER_PIXEL 4
+#define DIRTY_FRAME_MAX_RECTS 64     // Rects kept per update before collapsing to a bounding box
+#define DIRTY_FRAME_HISTORY 8        // Updates a downstream copy may lag behind before a full copy
+
+// Half-open rectangle in pixels: [left, right) x [top, bottom)
+typedef struct {
+    int left;
+    int top;
+    int right;
+    int bottom;
+} frame_rect_t;
+
+// Content moved from (source_x, source_y) in the previous frame to destination
+typedef struct {
+    int source_x;
+    int source_y;
+    frame_rect_t destination;
+} frame_move_t;
+
+// Changed regions of one update
+typedef struct {
+    frame_rect_t rects[DIRTY_FRAME_MAX_RECTS];
+    int count;
+} frame_damage_t;
+
+typedef struct {
+    uint8_t* pixels;            // Persistent top-down BGRA frame
+    int width;
+    int height;
+    size_t stride;
+    uint64_t generation;        // Number of updates applied, 0 means no content yet
+    frame_damage_t history[DIRTY_FRAME_HISTORY]; // Indexed by generation % DIRTY_FRAME_HISTORY
+    uint64_t bytes_copied;      // Bytes read from source surfaces, last update
+    uint64_t bytes_moved;       // Bytes shifted inside the frame by move rects, last update
+    uint64_t total_bytes_copied;
+    uint64_t total_bytes_moved;
+} dirty_frame_t;
+
+// Lifecycle
+int dirty_frame_init(dirty_frame_t* frame, int width, int height);
+void dirty_frame_cleanup(dirty_frame_t* frame);
+
+// Updates - the source is a full-size surface with the new desktop image
+int dirty_frame_full_update(dirty_frame_t* frame, const uint8_t* src, size_t src_pitch);
+int dirty_frame_apply(dirty_frame_t* frame, const uint8_t* src, size_t src_pitch,
+                      const frame_move_t* moves, int move_count,
+                      const frame_rect_t* dirty, int dirty_count);
+
+// Changed regions of the latest update
+const frame_rect_t* dirty_frame_changed(const dirty_frame_t* frame, int* count);
+
+// Bring a downstream copy last synced at dst_generation up to date, optionally
+// flipping vertically. Returns bytes written, or -1 on error.
+long long dirty_frame_copy_out(const dirty_frame_t* frame, uint8_t* dst, size_t dst_pitch,
+                               uint64_t dst_generation, int flip_vertical);
+
+// Copy one rect of the current frame into a downstream copy, e.g. to undo
+// something drawn over it. Returns bytes written, or -1 on error.
+long long dirty_frame_copy_rect(const dirty_frame_t* frame, uint8_t* dst, size_t dst_pitch,
+                                const frame_rect_t* rect, int flip_vertical);
+
+// Rectangle helpers
+int frame_rect_clip(frame_rect_t* rect, int width, int height);
+int frame_rect_area(const frame_rect_t* rect);
+
+#endif // DIRTY_FRAME_H
@@ -0,0 +1,20 @@
+#ifndef DXGI_SOURCE_H
+#define DXGI_SOURCE_H
+
+#include <windows.h>
+#include "capture_source.h"
+
+// Desktop duplication capture source: one output (optionally cropped to a
+// region) or every output stitched onto a virtual desktop canvas.
+
+typedef struct {
+    int monitor_index;
+    BOOL virtual_desktop;           // Capture every monitor; region must be off
+    BOOL region_enabled;
+    int region_x, region_y, region_w, region_h;
+    BOOL cursor_enabled;
+} dxgi_source_config_t;
+
+int dxgi_source_create(capture_source_t* source, const dxgi_source_config_t* config);
+
+#endif // DXGI_SOURCE_H
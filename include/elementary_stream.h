@@ -0,0 +1,78 @@
+#ifndef ELEMENTARY_STREAM_H
+#define ELEMENTARY_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parsing for the encoded streams the muxer packages: H.264 in Annex B form
+// (NAL units behind 00 00 01 start codes, as encoders emit them) and AAC in
+// ADTS frames. Only what a container needs is read: NAL unit boundaries and
+// types, the SPS fields that describe the picture, and the ADTS header.
+
+// ---------------------------------------------------------------------------
+// H.264
+// ---------------------------------------------------------------------------
+
+#define H264_NAL_SLICE 1
+#define H264_NAL_IDR 5
+#define H264_NAL_SEI 6
+#define H264_NAL_SPS 7
+#define H264_NAL_PPS 8
+#define H264_NAL_AUD 9
+
+#define H264_NAL_TYPE(header) ((header) & 0x1F)
+
+// Picture description from a sequence parameter set
+typedef struct {
+    int profile_idc;
+    int constraint_flags;           // constraint_set0..5 flags byte
+    int level_idc;
+    int chroma_format_idc;          // 1 = 4:2:0 unless the profile says otherwise
+    int bit_depth_luma;
+    int bit_depth_chroma;
+    int width;                      // Cropped, in pixels
+    int height;
+} h264_sps_info_t;
+
+// Next NAL unit of an Annex B buffer, without its start code. *offset starts
+// at 0 and advances past the unit. Returns 1 for a unit, 0 at the end.
+int h264_next_nal(const uint8_t* data, size_t size, size_t* offset, const uint8_t** nal, size_t* nal_size);
+
+// Parse an SPS NAL unit (header byte included); 0 on success
+int h264_parse_sps(const uint8_t* nal, size_t size, h264_sps_info_t* info);
+
+// Non-zero if an Annex B access unit contains an IDR slice
+int h264_is_keyframe(const uint8_t* data, size_t size);
+
+// ---------------------------------------------------------------------------
+// AAC
+// ---------------------------------------------------------------------------
+
+#define AAC_ADTS_HEADER_SIZE 7          // 9 with the optional CRC
+#define AAC_OBJECT_TYPE_LC 2
+#define AAC_SAMPLES_PER_FRAME 1024
+
+typedef struct {
+    int object_type;                // Audio object type (2 = AAC-LC)
+    int sample_rate_index;
+    uint32_t sample_rate;
+    int channels;
+    size_t header_size;             // 7, or 9 with a CRC
+    size_t frame_size;              // Header included
+} aac_adts_header_t;
+
+// Parse the ADTS header at data. Returns 0 with the whole frame present,
+// 1 if the header parsed but the frame is cut short, -1 if it is not ADTS.
+int aac_adts_parse(const uint8_t* data, size_t size, aac_adts_header_t* header);
+
+// Write a 7-byte ADTS header for a raw frame of payload_size bytes
+int aac_adts_write_header(uint8_t header[AAC_ADTS_HEADER_SIZE], int object_type, uint32_t sample_rate,
+                          int channels, size_t payload_size);
+
+// Sampling frequency index for a rate, or -1 if AAC has none
+int aac_sample_rate_index(uint32_t sample_rate);
+
+// Two-byte AudioSpecificConfig for the esds box; 0 on success
+int aac_audio_specific_config(int object_type, uint32_t sample_rate, int channels, uint8_t config[2]);
+
+#endif // ELEMENTARY_STREAM_H
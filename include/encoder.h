@@ -5,9 +5,36 @@
 #include <mfapi.h>
 #include <mfidl.h>
 #include <mfreadwrite.h>
+#include "frame_pool.h"
+#include "color_convert.h"
+#include "frame_timeline.h"
+#include "encoder_backend.h"
 
-// Encoder context for muxing video and audio streams
+// Frames handed to encoder_add_video_frame are encoder_input_format_t
+// (encoder_backend.h); BGRA is bottom-up in single-track mode and Media
+// Foundation converts it to YUV
+
+// Container written by the sink writer
+typedef enum {
+    ENCODER_CONTAINER_MP4 = 0,              // moov written by encoder_finalize
+    ENCODER_CONTAINER_FRAGMENTED_MP4        // moof+mdat fragments written as they fill (Windows 10+)
+} encoder_container_t;
+
+// Per-recording choices made before encoder_init*; they survive its reset,
+// so a segment rollover opens the next file the same way
+typedef struct {
+    encoder_input_format_t video_input;
+    color_matrix_t color_matrix;
+    color_range_t color_range;
+    frame_timing_t frame_timing;
+    encoder_container_t container;
+    DWORD recording_start_time;
+} encoder_settings_t;
+
+// Encoder context for muxing video and audio streams. Holds all of one
+// recording's state; separate contexts record independently.
 typedef struct {
+    encoder_settings_t settings;
     const char* output_filename;
     BOOL dual_track_mode;
     BOOL audio_only_mode;
@@ -22,6 +49,25 @@ typedef struct {
     int video_width;
     int video_height;
     int video_fps;
+    
+    // Sink writer and its streams
+    IMFSinkWriter* sink_writer;
+    DWORD video_stream_index;
+    DWORD audio_stream_index;
+    DWORD system_audio_stream_index;
+    DWORD mic_audio_stream_index;
+    int audio_sample_rate;
+    
+    // Running counts and timing
+    UINT64 video_frame_count;
+    UINT64 audio_sample_count;
+    UINT64 system_audio_sample_count;
+    UINT64 mic_audio_sample_count;
+    UINT64 audio_samples_logged;
+    LONGLONG last_video_timestamp;
+    frame_timeline_t video_timeline;
+    IMFSample* pending_video_sample; // Held until the next frame fixes its duration
+    UINT64 repeated_video_frames;
 } encoder_context_t;
 
 // Core encoding functions
@@ -40,10 +86,21 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
                                       int sample_rate, int channels, int bits_per_sample);
 
 // Stream management
-void encoder_set_recording_start_time(DWORD start_time);
+void encoder_set_recording_start_time(encoder_context_t* context, DWORD start_time);
+
+// Video input format and colour space; call before encoder_init*
+void encoder_set_video_input(encoder_context_t* context, encoder_input_format_t format, color_matrix_t matrix, color_range_t range);
+
+// Constant or variable frame rate sample timing; call before encoder_init*
+void encoder_set_frame_timing(encoder_context_t* context, frame_timing_t timing);
+
+// Output container; call before encoder_init*
+void encoder_set_container(encoder_context_t* context, encoder_container_t container);
 
 // Data input functions
-int encoder_add_video_frame(encoder_context_t* context, void* frame_data, size_t frame_size, DWORD elapsed_ms);
+// Video capture times are frame slot times since recording start, in 100 ns units
+int encoder_add_video_frame(encoder_context_t* context, frame_pool_t* pool, frame_handle_t frame, LONGLONG capture_time);
+int encoder_repeat_video_frame(encoder_context_t* context, LONGLONG capture_time);
 int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms);
 int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms);
 int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms);
@@ -52,4 +109,22 @@ int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UI
 int encoder_finalize(encoder_context_t* context);
 void encoder_cleanup(encoder_context_t* context);
 
+// Segmented output: a closed segment's sink writer, detached from the encoder
+typedef struct {
+    IMFSinkWriter* writer;
+} encoder_segment_t;
+
+// End the open file at end_time (100 ns since its start) and detach it; the
+// next encoder_init* call opens the following segment. NULL on failure.
+encoder_segment_t* encoder_detach_segment(encoder_context_t* context, LONGLONG end_time);
+
+// Write the moov and close a detached segment; touches no encoder state, so
+// it can run on any thread while the next segment records. Frees segment.
+int encoder_finalize_segment(encoder_segment_t* segment);
+
+// The sink writer as an encoder backend, driving context through the calls
+// above. Each context has its own sink writer, so backends on separate
+// contexts record concurrently; the caller keeps context for segment rollover.
+int mf_backend_create(encoder_backend_t* backend, encoder_context_t* context);
+
 #endif // ENCODER_H
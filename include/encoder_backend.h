@@ -0,0 +1,156 @@
+#ifndef ENCODER_BACKEND_H
+#define ENCODER_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "frame_pool.h"
+#include "color_convert.h"
+#include "frame_timeline.h"
+
+// Where recorded frames and audio go. The engine's mux thread drives every
+// backend through the same small vtable, the way it drives capture sources:
+// the Media Foundation sink writer on Windows (encoder.c), and portable
+// backends that let the whole capture -> convert -> encode path run and be
+// measured on any platform:
+//
+//   h264   software H.264 (h264_writer) into fragmented MP4
+//   x264   libx264 into fragmented MP4, when built with MUXSW_HAVE_X264
+//          (both also hand their packets to a packet sink: the replay buffer)
+//   raw    BGRA frames to a raw frame file (replay_source.h), for --replay
+//          or --transcode
+//   spool  BGRA frames to a capture spool (capture_spool.h)
+//   null   counts and discards everything: the capture ceiling, no encoder
+//
+// Video frames are pool frames; a backend that keeps one past the call takes
+// its own reference. Times are 100 ns units since the recording started.
+// A backend sets failed when it can no longer write (disk full, muxer
+// error); the recording stops rather than leave a gap.
+
+#define ENCODER_BACKEND_MAX_PATH 520
+#define ENCODER_BACKEND_MAX_AUDIO 2
+#define ENCODER_BACKEND_UNITS_PER_SECOND 10000000LL
+
+typedef enum {
+    ENCODER_BACKEND_MEDIA_FOUNDATION = 0,   // Windows sink writer: H.264 + AAC
+    ENCODER_BACKEND_H264,
+    ENCODER_BACKEND_X264,
+    ENCODER_BACKEND_RAW,
+    ENCODER_BACKEND_SPOOL,
+    ENCODER_BACKEND_NULL
+} encoder_backend_kind_t;
+
+// Layout of the video frames pushed to a backend
+typedef enum {
+    ENCODER_INPUT_BGRA = 0,     // Bottom-up when the backend sets bottom_up, top-down otherwise
+    ENCODER_INPUT_NV12          // Top-down NV12 produced by color_convert
+} encoder_input_format_t;
+
+#define ENCODER_FORMAT_BIT(format) (1u << (format))
+
+typedef struct {
+    const char* path;
+    int video;                      // Non-zero for a video stream
+    int width;
+    int height;
+    int fps;
+    encoder_input_format_t format;
+    color_matrix_t matrix;          // NV12 input
+    color_range_t range;
+    frame_timing_t timing;          // Constant or variable frame rate samples
+    int fragmented;                 // Fragmented MP4 where the backend has a choice
+    int keyframe_interval;          // Frames; 0 = the backend's default
+    int packets_only;               // Encoded packets go to the packet sink only, no file (h264, x264)
+    int audio_streams;              // 0, 1, or 2 to keep system audio and microphone apart
+    int sample_rate;                // Interleaved PCM
+    int channels;
+    int bits_per_sample;
+} encoder_backend_config_t;
+
+typedef struct {
+    uint64_t video_frames;          // New frames pushed
+    uint64_t repeated_frames;       // Ticks without new content
+    uint64_t audio_frames;          // PCM frames pushed, every stream
+    uint64_t failures;              // Pushes the backend refused
+    uint64_t bytes;                 // Output written, where the backend knows it
+    uint64_t busy_ns;               // Time inside push, flush and finalize calls
+} encoder_backend_stats_t;
+
+typedef struct encoder_backend encoder_backend_t;
+
+#define ENCODER_PACKET_VIDEO 0      // One access unit, Annex B
+#define ENCODER_PACKET_AUDIO 1      // ADTS AAC frames
+
+// Receives every encoded packet as the backend writes it, on the thread that
+// pushed the frame or samples; time in 100 ns units. Audio packets only come
+// from a backend that encodes audio in process, which none in the tree does yet.
+typedef void (*encoder_packet_fn)(void* context, int type, const uint8_t* data, size_t size, int64_t time);
+
+// Status line sink for encoder_backend_report
+typedef void (*encoder_backend_report_fn)(const char* message);
+
+typedef struct {
+    const char* name;
+    uint32_t formats;               // ENCODER_FORMAT_BIT of each input format taken
+    int audio;                      // Takes audio streams
+    // Open the output; called again after finalize for the next file
+    int (*init)(encoder_backend_t* backend, const encoder_backend_config_t* config);
+    int (*push_video)(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time);
+    // The previous frame again, nothing changed on screen
+    int (*repeat_video)(encoder_backend_t* backend, int64_t time);
+    int (*push_audio)(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time);
+    // Optional: write out what is buffered, so the output is readable up to here
+    int (*flush)(encoder_backend_t* backend);
+    // Complete and close the output
+    int (*finalize)(encoder_backend_t* backend);
+    // Optional: fill in what only the backend knows (bytes written)
+    void (*stats)(encoder_backend_t* backend, encoder_backend_stats_t* stats);
+    // Optional end-of-recording statistics
+    void (*report)(encoder_backend_t* backend, encoder_backend_report_fn report);
+    // Free everything; an output still open is abandoned
+    void (*destroy)(encoder_backend_t* backend);
+} encoder_backend_ops_t;
+
+struct encoder_backend {
+    const encoder_backend_ops_t* ops;
+    void* impl;
+    encoder_backend_config_t config;    // Of the last init; path points at path below
+    char path[ENCODER_BACKEND_MAX_PATH];
+    int open;                       // Between init and finalize
+    int bottom_up;                  // Set by init: BGRA frames are wanted bottom-up
+    int failed;
+    encoder_packet_fn packet_sink;  // Optional; only backends that encode in process call it
+    void* packet_context;
+    encoder_backend_stats_t stats;
+};
+
+// Portable backends by kind; the Media Foundation backend is created by
+// mf_backend_create (encoder.h). Returns -1 for a kind not built in.
+int encoder_backend_create(encoder_backend_t* backend, encoder_backend_kind_t kind);
+int null_backend_create(encoder_backend_t* backend);
+int raw_backend_create(encoder_backend_t* backend);
+int spool_backend_create(encoder_backend_t* backend);
+int h264_backend_create(encoder_backend_t* backend);
+int x264_backend_create(encoder_backend_t* backend);
+
+// Dispatch helpers; all tolerate a backend whose create failed
+int encoder_backend_init(encoder_backend_t* backend, const encoder_backend_config_t* config);
+int encoder_backend_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time);
+int encoder_backend_repeat_video(encoder_backend_t* backend, int64_t time);
+int encoder_backend_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time);
+int encoder_backend_flush(encoder_backend_t* backend);
+int encoder_backend_finalize(encoder_backend_t* backend);
+void encoder_backend_get_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats);
+void encoder_backend_report(encoder_backend_t* backend, encoder_backend_report_fn report);
+void encoder_backend_destroy(encoder_backend_t* backend);
+
+// Set after create; kept across init and finalize
+void encoder_backend_set_packet_sink(encoder_backend_t* backend, encoder_packet_fn sink, void* context);
+
+int encoder_backend_takes(const encoder_backend_t* backend, encoder_input_format_t format);
+const char* encoder_backend_name(const encoder_backend_t* backend);
+
+// Command-line names: mf, h264, x264, raw, spool, null
+const char* encoder_backend_kind_name(encoder_backend_kind_t kind);
+int encoder_backend_parse(const char* name, encoder_backend_kind_t* kind);
+
+#endif // ENCODER_BACKEND_H
@@ -2,6 +2,9 @@
 #define ENGINE_H
 
 #include <windows.h>
+#include "color_convert.h"
+#include "synthetic_source.h"
+#include "encoder_backend.h"
 
 // Audio source type enumeration
 typedef enum {
@@ -11,6 +14,19 @@ typedef enum {
     AUDIO_SOURCE_BOTH = 3
 } audio_source_type_t;
 
+// Where video frames come from
+typedef enum {
+    CAPTURE_SOURCE_DXGI = 0,        // Desktop duplication
+    CAPTURE_SOURCE_SYNTHETIC,       // Generated test pattern
+    CAPTURE_SOURCE_REPLAY           // Raw frame file
+} capture_source_kind_t;
+
+// Frame rate limits; high-refresh rates (144/165/240 Hz displays) get a raised-priority
+// capture thread and a per-second achieved-rate report
+#define CAPTURE_MAX_FPS 240
+#define CAPTURE_HIGH_FRAME_RATE 100
+#define CAPTURE_DEFAULT_REPLAY_BUDGET_MB 512
+
 // Capture parameters structure
 typedef struct {
     char output_filename[MAX_PATH];
@@ -24,9 +40,31 @@ typedef struct {
     BOOL audio_only_mode; // True if recording audio only (MP3 output)
     // MVP: Video capture parameters
     int monitor_index; // Monitor to capture (default: 0)
+    BOOL virtual_desktop; // Capture every monitor onto one stitched canvas
     BOOL cursor_enabled; // Include cursor in capture (default: TRUE)
     BOOL region_enabled; // Use specific region instead of full screen
     int region_x, region_y, region_w, region_h; // Region coordinates
+    double output_scale; // Downscale factor before encoding (0 = none, wins over output size)
+    int output_width, output_height; // Explicit encode size (0 = keep aspect / none)
+    BOOL encode_nv12; // Convert to NV12 before the encoder instead of passing BGRA (default: TRUE)
+    color_matrix_t color_matrix; // YUV matrix for NV12 input (default: BT.709)
+    color_range_t color_range; // YUV range for NV12 input (default: limited)
+    int worker_threads; // Threads for scaling and colour conversion (0 = one per CPU)
+    BOOL change_detection; // Treat pixel-identical captured frames as repeats (default: TRUE)
+    BOOL variable_frame_rate; // Stamp samples with capture times and skip unchanged frames (default: FALSE)
+    capture_source_kind_t capture_source; // Video source (default: desktop duplication)
+    synthetic_pattern_t synthetic_pattern; // Pattern for the synthetic source
+    int source_width, source_height; // Synthetic source size (default: 1920x1080)
+    char replay_filename[MAX_PATH]; // Raw frame file for the replay source
+    BOOL replay_loop; // Restart the replay file at its end instead of stopping (default: FALSE)
+    int audio_buffer_ms; // WASAPI device buffer, drained by event-driven capture threads (default: 50)
+    BOOL fragmented_output; // Fragmented MP4: readable while recording, no long finalize (default: TRUE)
+    int segment_time; // Start a new file every this many seconds, at the next keyframe (0 = one file)
+    ULONGLONG segment_size; // Start a new file once this many bytes are written (0 = no limit)
+    BOOL spool_output; // Write captured frames to a capture spool to encode later, video only (default: FALSE)
+    encoder_backend_kind_t encoder_backend; // Where frames go (default: Media Foundation; --spool selects the spool)
+    int replay_seconds; // Keep the last this many seconds in memory, written by engine_save_replay (0 = record to file)
+    int replay_budget_mb; // Replay packets held at most; older GOPs go first when it fills (default: 512)
 } capture_params_t;
 
 // Capture statistics
@@ -44,7 +82,11 @@ typedef struct {
 typedef void (*capture_status_callback_t)(const char* message);
 typedef void (*capture_progress_callback_t)(int frame_count, DWORD elapsed_ms);
 
-// Capture engine context
+// Recording state owned by one engine (engine.c)
+struct engine_session;
+
+// Capture engine context. Each engine records on its own; several can run in
+// one process, each engine_start on its own thread.
 typedef struct {
     capture_params_t params;
     capture_stats_t stats;
@@ -52,6 +94,7 @@ typedef struct {
     capture_progress_callback_t progress_callback;
     BOOL is_running;
     BOOL force_stop;
+    struct engine_session* session; // Allocated by engine_init, freed by engine_cleanup
 } capture_engine_t;
 
 // Function declarations
@@ -64,4 +107,9 @@ void engine_set_progress_callback(capture_engine_t* engine, capture_progress_cal
 BOOL engine_is_running(const capture_engine_t* engine);
 const capture_stats_t* engine_get_stats(const capture_engine_t* engine);
 
+// Replay mode: queue a save of the buffered seconds from any thread. The file is
+// written in the background; its name goes to path. -1 when not replaying.
+int engine_save_replay(capture_engine_t* engine, char* path, size_t path_size);
+BOOL engine_is_replaying(const capture_engine_t* engine);
+
 #endif // ENGINE_H
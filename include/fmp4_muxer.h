@@ -0,0 +1,139 @@
+#ifndef FMP4_MUXER_H
+#define FMP4_MUXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "mp4_box.h"
+#include "elementary_stream.h"
+
+// Fragmented MP4 writer for encoded H.264 and AAC. The file starts with ftyp
+// and a moov whose sample tables are empty and whose mvex announces
+// fragments; samples then follow as moof+mdat pairs, one every fragment_ms
+// or so. Each fragment is written as soon as it closes, so the file on disk
+// is playable up to its last complete fragment, memory stays bounded by one
+// fragment whatever the recording length, and finishing only has to write
+// the final fragment. Every fragment is a checkpoint: a file cut short by a
+// crash is recovered up to it by mp4_repair.
+//
+// Video arrives as Annex B access units with timestamps; SPS and PPS are
+// lifted into the avcC box and the other NAL units stored length-prefixed.
+// Fragments start on a keyframe once fragment_ms has passed, or on any
+// frame at twice that for streams with long GOPs. Audio arrives as ADTS
+// frames, or as raw frames when the format is configured; 1024 samples each.
+// The two tracks are interleaved per fragment: one traf each in the moof,
+// their samples in one mdat.
+
+#define FMP4_VIDEO_TIMESCALE 90000
+#define FMP4_DEFAULT_FRAGMENT_MS 1000
+#define FMP4_DEFAULT_MAX_BUFFERED (8u * 1024 * 1024)
+#define FMP4_MAX_FRAGMENT_SAMPLES 4096      // Per track; a full table forces a fragment
+#define FMP4_MAX_PARAMETER_SET 256
+
+#define FMP4_TRACK_VIDEO 0
+#define FMP4_TRACK_AUDIO 1
+#define FMP4_TRACK_COUNT 2
+
+// Destination for the muxed bytes; returns 0 on success
+typedef int (*fmp4_write_fn)(void* context, const uint8_t* data, size_t size);
+
+typedef struct {
+    int video;                      // Non-zero for an H.264 track
+    int audio;                      // Non-zero for an AAC track
+    uint32_t audio_sample_rate;     // 0 takes the format from the first ADTS header
+    int audio_channels;
+    uint32_t fragment_ms;           // Target fragment duration; 0 for the default
+    size_t max_buffered_bytes;      // Sample data held before a fragment is forced; 0 for the default
+    uint32_t frame_duration;        // 100 ns units, for the final frame; 0 for 1/30 s
+    int durable;                    // Sync each fragment to disk when writing a file
+} fmp4_config_t;
+
+typedef struct {
+    uint32_t size;
+    uint32_t duration;
+    uint32_t flags;                 // trun sample_flags
+} fmp4_sample_t;
+
+typedef struct {
+    uint32_t track_id;
+    uint32_t timescale;
+    mp4_buffer_t data;              // Sample bytes of the open fragment
+    fmp4_sample_t* samples;         // FMP4_MAX_FRAGMENT_SAMPLES entries
+    uint32_t sample_count;
+    uint64_t fragment_start;        // Decode time of the open fragment's first sample
+    uint64_t next_time;             // Decode time of the next sample
+} fmp4_track_t;
+
+typedef struct {
+    uint64_t fragments;
+    uint64_t bytes_written;
+    uint64_t video_frames;
+    uint64_t audio_frames;
+    uint64_t dropped_video;         // Before the first keyframe
+    uint64_t dropped_audio;         // Over budget before the first keyframe, or after audio was abandoned
+    uint64_t forced_fragments;      // Cut mid-GOP by time, size or sample count
+    size_t peak_buffered;
+} fmp4_muxer_stats_t;
+
+typedef struct {
+    fmp4_config_t config;
+    fmp4_write_fn write;
+    void* context;
+    FILE* file;                     // Owned when opened with fmp4_muxer_open
+
+    mp4_buffer_t boxes;             // Scratch for ftyp/moov and moof
+    fmp4_track_t tracks[FMP4_TRACK_COUNT];
+
+    uint8_t sps[FMP4_MAX_PARAMETER_SET];
+    size_t sps_size;
+    uint8_t pps[FMP4_MAX_PARAMETER_SET];
+    size_t pps_size;
+    h264_sps_info_t sps_info;
+    int keyframe_seen;
+
+    mp4_buffer_t pending;           // Latest video frame, held until the next gives its duration
+    int has_pending;
+    int pending_keyframe;
+    uint64_t pending_time;          // FMP4_VIDEO_TIMESCALE units
+    uint32_t last_duration;
+
+    uint8_t audio_config[2];        // AudioSpecificConfig
+    int audio_ready;
+    int adts_format;                // Format taken from ADTS headers: input stays ADTS
+    int audio_abandoned;            // No format by the first fragment: written without audio
+
+    int header_written;
+    uint32_t sequence;
+    int failed;
+    fmp4_muxer_stats_t stats;
+} fmp4_muxer_t;
+
+// Status line sink for fmp4_muxer_report
+typedef void (*fmp4_muxer_report_fn)(const char* message);
+
+// Stream to a callback, or to a file the muxer creates and closes
+int fmp4_muxer_init(fmp4_muxer_t* muxer, const fmp4_config_t* config, fmp4_write_fn write, void* context);
+int fmp4_muxer_open(fmp4_muxer_t* muxer, const fmp4_config_t* config, const char* path);
+
+// One Annex B access unit; time in 100 ns units, increasing
+int fmp4_muxer_write_video(fmp4_muxer_t* muxer, const uint8_t* data, size_t size, int64_t time);
+
+// One or more ADTS frames, or one raw frame when the audio format was configured
+int fmp4_muxer_write_audio(fmp4_muxer_t* muxer, const uint8_t* data, size_t size);
+
+// Close the open fragment now
+int fmp4_muxer_flush(fmp4_muxer_t* muxer);
+
+// Write everything still buffered; the file is complete afterwards
+int fmp4_muxer_finish(fmp4_muxer_t* muxer);
+
+// Free buffers and close an owned file (without finishing)
+void fmp4_muxer_cleanup(fmp4_muxer_t* muxer);
+
+// Sample bytes waiting for the open fragment to close
+size_t fmp4_muxer_buffered_bytes(const fmp4_muxer_t* muxer);
+
+void fmp4_muxer_get_stats(const fmp4_muxer_t* muxer, fmp4_muxer_stats_t* stats);
+void fmp4_muxer_report(const fmp4_muxer_t* muxer, fmp4_muxer_report_fn report);
+
+#endif // FMP4_MUXER_H
@@ -0,0 +1,44 @@
+#ifndef FPS_METER_H
+#define FPS_METER_H
+
+#include <stdint.h>
+
+// Achieved against requested frame rate, one-second windows at a time. The
+// caller feeds the running total of frames written and the clock; the meter
+// closes a window once a second has passed and keeps the per-second range
+// and the number of seconds that fell short of the requested rate.
+
+#define FPS_METER_WINDOW_NS 1000000000ULL
+#define FPS_METER_SHORT_PERCENT 95         // A second below this share of the requested rate is short
+
+typedef struct {
+    int requested_fps;
+    int started;
+    uint64_t start_ns;
+    uint64_t window_start_ns;
+    uint64_t window_start_frames;
+    uint64_t frames;                // Latest running total
+
+    // Closed windows
+    uint64_t windows;
+    uint64_t short_windows;
+    double last_fps;
+    double min_fps;
+    double max_fps;
+} fps_meter_t;
+
+// Status line sink for fps_meter_report
+typedef void (*fps_meter_report_fn)(const char* message);
+
+int fps_meter_init(fps_meter_t* meter, int requested_fps);
+void fps_meter_start(fps_meter_t* meter, uint64_t now_ns);
+
+// Record the running frame total; returns 1 when this closed a window (last_fps is its rate)
+int fps_meter_update(fps_meter_t* meter, uint64_t now_ns, uint64_t total_frames);
+
+// Average over everything since start
+double fps_meter_average(const fps_meter_t* meter, uint64_t now_ns);
+
+void fps_meter_report(const fps_meter_t* meter, uint64_t now_ns, fps_meter_report_fn report);
+
+#endif // FPS_METER_H
@@ -0,0 +1,83 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+#include "platform.h"
+
+// Capture clock for a fixed frame rate. Frame n is due exactly
+// n * rate_den / rate_num seconds after start, computed from the frame index
+// rather than by adding a rounded interval, so 60 fps stays 60 fps over any
+// session length and 30000/1001 lands on whole seconds every 30000 frames.
+//
+// The pacer sleeps on the platform's high-resolution timer until the next
+// frame is due and records how late each wake-up was (jitter). A caller that
+// falls more than a frame behind resumes on the latest due frame; the frames
+// in between are counted as skipped rather than captured in a burst.
+
+#define FRAME_PACER_NS_PER_SECOND 1000000000ULL
+#define FRAME_PACER_JITTER_BUCKETS 6       // < 0.1, 0.5, 1, 2, 5 ms, and the rest
+
+// Time source and sleep, replaceable so tests can run a simulated clock
+typedef struct {
+    uint64_t (*now_ns)(void* context);
+    void (*wait_until_ns)(void* context, uint64_t deadline_ns);
+    void* context;
+} frame_clock_t;
+
+// One paced frame
+typedef struct {
+    uint64_t index;                 // Frame slot since start
+    uint64_t time_ns;               // Exact due time of the slot, from start
+    uint64_t jitter_ns;             // How late the wake-up was
+    uint64_t skipped;               // Slots passed over to get here
+} frame_pacer_tick_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t skipped;
+    uint64_t total_jitter_ns;
+    uint64_t max_jitter_ns;
+    uint64_t jitter_buckets[FRAME_PACER_JITTER_BUCKETS];
+} frame_pacer_stats_t;
+
+typedef struct {
+    uint32_t rate_num;              // Frames per rate_den seconds
+    uint32_t rate_den;
+    uint64_t whole_seconds_ns;      // rate_den seconds: the span of rate_num frames
+
+    frame_clock_t clock;
+    int own_timer;                  // Using the platform clock and this timer
+    platform_timer_t timer;
+
+    uint64_t start_ns;
+    uint64_t next_frame;
+    frame_pacer_stats_t stats;
+} frame_pacer_t;
+
+// Status line sink for frame_pacer_report
+typedef void (*frame_pacer_report_fn)(const char* message);
+
+// rate_num/rate_den frames per second (e.g. 60/1, 30000/1001); a NULL clock
+// uses platform_time_ns() and a platform timer
+int frame_pacer_init(frame_pacer_t* pacer, uint32_t rate_num, uint32_t rate_den, const frame_clock_t* clock);
+void frame_pacer_cleanup(frame_pacer_t* pacer);
+
+// Frame 0 is due now
+void frame_pacer_start(frame_pacer_t* pacer);
+
+// Sleep until the next frame is due and describe it
+int frame_pacer_wait(frame_pacer_t* pacer, frame_pacer_tick_t* tick);
+
+// Due time of a frame slot, from start
+uint64_t frame_pacer_frame_time_ns(const frame_pacer_t* pacer, uint64_t frame);
+
+// Frames due within a span of milliseconds, rounded up; for sizing queues in time
+uint32_t frame_pacer_frames_within(uint32_t rate_num, uint32_t rate_den, uint32_t milliseconds);
+
+// Clock time since start
+uint64_t frame_pacer_elapsed_ns(const frame_pacer_t* pacer);
+
+void frame_pacer_get_stats(const frame_pacer_t* pacer, frame_pacer_stats_t* stats);
+void frame_pacer_report(const frame_pacer_t* pacer, frame_pacer_report_fn report);
+
+#endif // FRAME_PACER_H
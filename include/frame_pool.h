@@ -0,0 +1,60 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+// Preallocated, aligned, refcounted video frame buffers shared by capture,
+// the cached-frame logic and the encoder. Frames are addressed by handle;
+// a frame returns to the pool when its last reference is released.
+
+#define FRAME_POOL_ALIGNMENT 64
+#define FRAME_HANDLE_INVALID (-1)
+
+typedef int frame_handle_t;
+
+// Pool usage statistics
+typedef struct {
+    int capacity;
+    int in_use;
+    int high_water;         // Peak number of frames in use at once
+    uint64_t acquired;      // Successful acquisitions
+    uint64_t exhausted;     // Acquisitions that failed because every frame was in use
+} frame_pool_stats_t;
+
+typedef struct {
+    uint8_t* data;
+    platform_atomic_t refcount;
+    int next_free;
+} frame_slot_t;
+
+typedef struct {
+    frame_slot_t* slots;
+    uint8_t* storage;       // One aligned block backing every frame
+    size_t frame_size;      // Usable bytes per frame
+    size_t frame_stride;    // frame_size rounded up to FRAME_POOL_ALIGNMENT
+    int capacity;
+    int free_head;
+    platform_mutex_t lock;
+    frame_pool_stats_t stats;
+} frame_pool_t;
+
+// Pool lifecycle
+int frame_pool_init(frame_pool_t* pool, size_t frame_size, int capacity);
+void frame_pool_cleanup(frame_pool_t* pool);
+
+// Frame acquisition and reference counting
+frame_handle_t frame_pool_acquire(frame_pool_t* pool);
+void frame_pool_addref(frame_pool_t* pool, frame_handle_t handle);
+void frame_pool_release(frame_pool_t* pool, frame_handle_t handle);
+
+// Frame access
+void* frame_pool_data(const frame_pool_t* pool, frame_handle_t handle);
+size_t frame_pool_frame_size(const frame_pool_t* pool);
+int frame_pool_refcount(frame_pool_t* pool, frame_handle_t handle);
+
+// Statistics
+void frame_pool_get_stats(frame_pool_t* pool, frame_pool_stats_t* stats);
+
+#endif // FRAME_POOL_H
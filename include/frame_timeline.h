@@ -0,0 +1,69 @@
+#ifndef FRAME_TIMELINE_H
+#define FRAME_TIMELINE_H
+
+#include <stdint.h>
+
+// Sample timing for the video stream. The encoder holds the newest sample back
+// and this policy decides, for every capture tick, whether that sample is
+// written, with which duration, and when the next one starts.
+//
+// Constant frame rate places every tick on a fixed fps grid: the capture time
+// is rounded to its slot, so a static desktop still advances one slot per tick
+// (the held sample just gets longer), and slots that never got a tick (paced
+// over under load, or dropped before the encoder) are covered by the held
+// sample too. File time keeps matching the recording clock the audio uses.
+// Variable frame rate only starts samples for changed frames and stamps them
+// with the real capture time; unchanged ticks cost nothing. Both re-emit the
+// held pixels after refresh_interval so long static stretches stay seekable.
+
+#define FRAME_TIMELINE_UNITS_PER_SECOND 10000000LL    // Media Foundation 100 ns units
+#define FRAME_TIMELINE_REFRESH_SECONDS 2
+
+typedef enum {
+    FRAME_TIMING_CFR = 0,
+    FRAME_TIMING_VFR
+} frame_timing_t;
+
+// What the encoder does for one tick
+typedef struct {
+    int write_pending;              // Write the held sample first, with pending_duration
+    int64_t pending_duration;
+    int start_sample;               // Hold a new sample starting at `time` (new pixels, or the held ones re-emitted)
+    int64_t time;
+} frame_timeline_step_t;
+
+typedef struct {
+    frame_timing_t mode;
+    int fps;
+    int64_t refresh_interval;       // Longest a held sample may grow before it is re-emitted
+
+    uint64_t ticks;                 // CFR: next free slot
+    int pending;                    // A sample is held back
+    int64_t pending_time;           // Its sample time
+    int64_t last_time;              // Latest tick time on the output timeline
+    int64_t end_time;               // End of the last written sample
+
+    // Statistics
+    uint64_t samples;               // Samples started, including refreshes
+    uint64_t refreshes;             // Samples that re-emit held pixels
+    uint64_t repeats;               // Ticks without new content
+    uint64_t gap_slots;             // CFR slots without a tick, filled by the held sample
+} frame_timeline_t;
+
+int frame_timeline_init(frame_timeline_t* timeline, frame_timing_t mode, int fps);
+
+// Capture time is in FRAME_TIMELINE_UNITS since recording start; CFR rounds it to a slot
+int frame_timeline_new_frame(frame_timeline_t* timeline, int64_t capture_time, frame_timeline_step_t* step);
+
+// A tick with unchanged content; fails if no sample is held yet
+int frame_timeline_repeat_frame(frame_timeline_t* timeline, int64_t capture_time, frame_timeline_step_t* step);
+
+// Duration for the held sample at end of stream, or -1 if none is held
+int64_t frame_timeline_finish(frame_timeline_t* timeline);
+
+// CFR sample time of a tick
+int64_t frame_timeline_slot_time(const frame_timeline_t* timeline, uint64_t tick);
+
+const char* frame_timing_name(frame_timing_t mode);
+
+#endif // FRAME_TIMELINE_H
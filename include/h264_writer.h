@@ -0,0 +1,81 @@
+#ifndef H264_WRITER_H
+#define H264_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mp4_box.h"
+#include "color_convert.h"
+
+// Software H.264 encoder with no dependencies, for platforms without Media
+// Foundation. It makes no attempt at compression: a macroblock that changed
+// since the previous picture is sent as I_PCM, its 4:2:0 samples stored as
+// they are, and one that did not as P_Skip. The pictures are exact, a still
+// screen costs a few bytes a frame and a fully changing one 1.5 bytes per
+// pixel. Any decoder plays the result (Constrained Baseline, CAVLC, one
+// slice per picture, no deblocking), which makes it a reference and fallback
+// backend rather than a replacement for a real encoder.
+//
+// Input is NV12 (color_convert's output); output is one Annex B access unit
+// per picture, SPS and PPS in front of every IDR, as fmp4_muxer takes them.
+
+#define H264_WRITER_MAX_DIMENSION 16384
+
+typedef struct {
+    int width;                      // Even
+    int height;                     // Even
+    int fps;                        // For the level; 0 = 30
+    int keyframe_interval;          // Pictures from one IDR to the next; 0 = two seconds
+    color_matrix_t matrix;          // Signalled in the VUI so players convert back correctly
+    color_range_t range;
+} h264_writer_config_t;
+
+typedef struct {
+    uint64_t pictures;
+    uint64_t keyframes;
+    uint64_t coded_macroblocks;     // Sent as I_PCM
+    uint64_t skipped_macroblocks;   // Sent as P_Skip
+    uint64_t bytes;                 // Access units, start codes included
+} h264_writer_stats_t;
+
+typedef struct {
+    h264_writer_config_t config;
+    int mb_width;
+    int mb_height;
+    int level_idc;
+
+    // Padded to whole macroblocks, edges repeated: the picture being coded
+    // and the previous one, which is also what the decoder holds
+    uint8_t* current;
+    uint8_t* reference;
+    size_t luma_pitch;              // mb_width * 16; the chroma plane has the same pitch
+    size_t luma_size;
+    int has_reference;
+
+    int frame_num;
+    int idr_pic_id;
+    int since_keyframe;
+
+    mp4_buffer_t rbsp;              // NAL payload before emulation prevention
+    uint64_t bits;                  // Pending bits, most significant first
+    int bit_count;
+    mp4_buffer_t output;            // Access unit returned to the caller
+    h264_writer_stats_t stats;
+} h264_writer_t;
+
+// Status line sink for h264_writer_report
+typedef void (*h264_writer_report_fn)(const char* message);
+
+int h264_writer_init(h264_writer_t* writer, const h264_writer_config_t* config);
+void h264_writer_cleanup(h264_writer_t* writer);
+
+// Encode one NV12 picture (planes 0 and 1). The access unit stays valid
+// until the next call; keyframe is set when it is an IDR.
+int h264_writer_encode(h264_writer_t* writer, const color_planes_t* picture, int force_keyframe,
+                       const uint8_t** data, size_t* size, int* keyframe);
+
+// The previous picture again: every macroblock skipped, or an IDR of it when one is due
+int h264_writer_repeat(h264_writer_t* writer, const uint8_t** data, size_t* size, int* keyframe);
+
+void h264_writer_report(const h264_writer_t* writer, h264_writer_report_fn report);
+
+#endif // H264_WRITER_H
@@ -3,6 +3,8 @@
 
 #include <windows.h>
 
+#define MICROPHONE_DEFAULT_BUFFER_MS 50
+
 #ifdef MUXSW_ENABLE_AUDIO
 #include <mmdeviceapi.h>
 #include <audioclient.h>
@@ -16,13 +18,25 @@ typedef struct {
     IAudioCaptureClient* capture_client;
     WAVEFORMATEX* wave_format;
     UINT32 buffer_frame_count;
+    UINT32 buffer_ms;          // Requested device buffer length
+    UINT32 period_ms;          // Device period: how often a buffer becomes ready
+    HANDLE ready_event;        // Signalled by the device in event-driven mode
+    BOOL event_driven;
     BOOL is_capturing;
-    BOOL using_silent_buffer; // Track if returning static silent buffer
+    BOOL using_silent_buffer; // Track if returning silent buffer
+    // Silence generated while the device has nothing, paced from the first empty read
+    BYTE* silent_buffer;
+    UINT32 silent_buffer_size;
+    DWORD silent_start_time;
+    UINT64 silent_samples;
 } microphone_context_t;
 
 // Microphone capture functions
-int microphone_init(microphone_context_t* ctx);
+// buffer_ms = 0 uses MICROPHONE_DEFAULT_BUFFER_MS
+int microphone_init(microphone_context_t* ctx, UINT32 buffer_ms);
 int microphone_start_capture(microphone_context_t* ctx);
+// Sleep until the device has a buffer ready: 0 ready, 1 timeout, -1 error
+int microphone_wait(microphone_context_t* ctx, DWORD timeout_ms);
 int microphone_get_buffer(microphone_context_t* ctx, BYTE** data, UINT32* num_frames);
 void microphone_release_buffer(microphone_context_t* ctx, UINT32 num_frames);
 void microphone_stop_capture(microphone_context_t* ctx);
@@ -36,8 +50,9 @@ typedef struct {
 } microphone_context_t;
 
 // No-op stub functions for MVP
-static inline int microphone_init(microphone_context_t* ctx) { (void)ctx; return 0; }
+static inline int microphone_init(microphone_context_t* ctx, UINT32 buffer_ms) { (void)ctx; (void)buffer_ms; return 0; }
 static inline int microphone_start_capture(microphone_context_t* ctx) { (void)ctx; return 0; }
+static inline int microphone_wait(microphone_context_t* ctx, DWORD timeout_ms) { (void)ctx; (void)timeout_ms; return -1; }
 static inline int microphone_get_buffer(microphone_context_t* ctx, BYTE** data, UINT32* num_frames) { 
     (void)ctx; (void)data; (void)num_frames; return -1; 
 }
@@ -0,0 +1,85 @@
+#ifndef MP4_BOX_H
+#define MP4_BOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ISO base media file format (MP4) box building and walking. Writers append
+// big-endian fields to a growable buffer and patch each box's size when it
+// is closed; readers walk box headers in memory without copying, validating
+// sizes against the bytes available so truncated input is reported instead
+// of read past.
+
+#define MP4_FOURCC(a, b, c, d) \
+    ((uint32_t)(uint8_t)(a) << 24 | (uint32_t)(uint8_t)(b) << 16 | (uint32_t)(uint8_t)(c) << 8 | (uint32_t)(uint8_t)(d))
+
+#define MP4_BOX_HEADER_SIZE 8
+#define MP4_LARGE_BOX_HEADER_SIZE 16
+
+// ---------------------------------------------------------------------------
+// Writing
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    int failed;                     // An allocation failed; later writes are dropped
+} mp4_buffer_t;
+
+void mp4_buffer_init(mp4_buffer_t* buffer);
+void mp4_buffer_free(mp4_buffer_t* buffer);
+void mp4_buffer_reset(mp4_buffer_t* buffer);    // Keeps the allocation
+int mp4_buffer_reserve(mp4_buffer_t* buffer, size_t size);
+
+void mp4_put_u8(mp4_buffer_t* buffer, uint8_t value);
+void mp4_put_u16(mp4_buffer_t* buffer, uint16_t value);
+void mp4_put_u24(mp4_buffer_t* buffer, uint32_t value);
+void mp4_put_u32(mp4_buffer_t* buffer, uint32_t value);
+void mp4_put_u64(mp4_buffer_t* buffer, uint64_t value);
+void mp4_put_bytes(mp4_buffer_t* buffer, const void* data, size_t size);
+void mp4_put_zeros(mp4_buffer_t* buffer, size_t count);
+
+// Open a box; returns its offset for mp4_box_end, which writes the size.
+// Boxes nest by closing them in reverse order.
+size_t mp4_box_begin(mp4_buffer_t* buffer, uint32_t type);
+size_t mp4_full_box_begin(mp4_buffer_t* buffer, uint32_t type, uint8_t version, uint32_t flags);
+void mp4_box_end(mp4_buffer_t* buffer, size_t offset);
+
+// Overwrite a field written earlier
+void mp4_patch_u32(mp4_buffer_t* buffer, size_t offset, uint32_t value);
+
+// ---------------------------------------------------------------------------
+// Reading
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t type;
+    uint64_t size;                  // Whole box, header included
+    size_t header_size;             // 8, or 16 for 64-bit sizes
+    const uint8_t* payload;         // size - header_size bytes
+    size_t payload_size;
+} mp4_box_t;
+
+uint16_t mp4_read_u16(const uint8_t* data);
+uint32_t mp4_read_u24(const uint8_t* data);
+uint32_t mp4_read_u32(const uint8_t* data);
+uint64_t mp4_read_u64(const uint8_t* data);
+
+// Parse the box header at data. Returns 0 when the whole box is present,
+// 1 when only the header is (box->size says how much is missing), and -1 for
+// a malformed or incomplete header. A size of 0 (box runs to the end of the
+// data) is resolved against size.
+int mp4_box_parse(const uint8_t* data, size_t size, mp4_box_t* box);
+
+// Walk the boxes in a payload: *offset starts at 0 and advances past each
+// box returned. Returns 1 for a box, 0 at the end, -1 on a malformed box.
+int mp4_box_next(const uint8_t* data, size_t size, size_t* offset, mp4_box_t* box);
+
+// First child box of a type, or -1 if absent
+int mp4_box_find(const uint8_t* data, size_t size, uint32_t type, mp4_box_t* box);
+
+// Four-character code as a printable string (5 bytes with the terminator)
+void mp4_fourcc_string(uint32_t type, char text[5]);
+
+#endif // MP4_BOX_H
@@ -0,0 +1,40 @@
+#ifndef MP4_REPAIR_H
+#define MP4_REPAIR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Salvage for fragmented MP4 recordings that never finished: the process
+// died, was killed by the emergency timeout, or the disk filled up. One
+// sequential pass copies ftyp and moov, then every complete moof+mdat pair.
+// A last fragment cut short keeps the samples whose data made it to disk:
+// its truns are shortened, the moof rebuilt and the data offsets moved to
+// match. Whatever follows (a partial box, zero fill) is dropped. Memory is
+// bounded by the largest fragment, never the file.
+//
+// A plain MP4 whose moov was due at finalize has no sample index to rebuild
+// from; it is reported rather than guessed at.
+
+#define MP4_REPAIR_MAX_BOX (64u * 1024 * 1024)          // ftyp, moov, moof and other boxes held whole
+#define MP4_REPAIR_MAX_FRAGMENT (512u * 1024 * 1024)    // mdat held while checking the last fragment
+
+typedef struct {
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t fragments;             // Written, a trimmed last one included
+    uint64_t samples;               // In the written fragments
+    uint64_t trimmed_samples;       // Dropped from a cut-short last fragment
+    uint64_t discarded_bytes;       // Input after the last recoverable byte
+    int complete;                   // The input ended on a box boundary: nothing was lost
+} mp4_repair_result_t;
+
+// Status line sink for mp4_repair_report
+typedef void (*mp4_repair_report_fn)(const char* message);
+
+// Returns 0 if a playable file was written
+int mp4_repair_stream(FILE* input, FILE* output, mp4_repair_result_t* result);
+int mp4_repair_file(const char* input_path, const char* output_path, mp4_repair_result_t* result);
+
+void mp4_repair_report(const mp4_repair_result_t* result, mp4_repair_report_fn report);
+
+#endif // MP4_REPAIR_H
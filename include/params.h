@@ -15,4 +15,9 @@ int params_set_recording_mode(capture_params_t* params, BOOL enable_video, BOOL
 // Function to auto-adjust filename extension based on mode
 void params_adjust_filename_extension(capture_params_t* params);
 
+// Whether the safety caps on runaway recordings (the engine's 60 s and the signal
+// handler's 5 min) may stop this one: only an unlimited recording to a single file.
+// A recording with a duration ends on its own; segmented and replay sessions run for hours.
+BOOL params_is_capped(const capture_params_t* params);
+
 #endif // PARAMS_H
@@ -0,0 +1,99 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include "platform.h"
+#include "spsc_ring.h"
+
+// A recording as a set of stages, each on its own thread, handing work to
+// each other through spsc_ring queues. A stage is a step function the thread
+// calls over and over; when a step finds nothing to do the thread sleeps
+// until another stage notifies it (after a push) or its idle timeout runs out.
+//
+// Stopping drains in stage order: once stop is requested source stages exit
+// right away, and every other stage keeps stepping while its predecessors are
+// still running and exits at its first idle step after they have all exited.
+// Producers are therefore added before their consumers, and nothing queued
+// before the stop is lost.
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_MAX_QUEUES 8
+
+// Step results
+#define PIPELINE_STEP_IDLE    0     // Nothing to do: wait for a notify or the idle timeout
+#define PIPELINE_STEP_BUSY    1     // Did work; step again straight away
+#define PIPELINE_STEP_DONE    2     // Out of input for good (end of a replay file); winds the pipeline down
+#define PIPELINE_STEP_BLOCKED 3     // Has input but its output queue is full: waits like idle, never counts as drained
+#define PIPELINE_STEP_ERROR  -1     // Fatal; the pipeline is marked failed and winds down
+
+typedef int (*pipeline_step_fn)(void* context);
+typedef void (*pipeline_thread_fn)(void* context);
+
+typedef struct {
+    const char* name;
+    pipeline_step_fn step;
+    pipeline_thread_fn thread_init; // Optional, runs on the stage thread before the first step
+    pipeline_thread_fn thread_exit; // Optional, runs on the stage thread after the last step
+    void* context;
+    unsigned int idle_ms;           // Longest idle sleep before stepping again (0 = 10 ms)
+    int source;                     // Produces on its own (capture, audio): stops stepping as soon as stop is requested
+} pipeline_stage_desc_t;
+
+typedef struct pipeline pipeline_t;
+
+typedef struct {
+    pipeline_stage_desc_t desc;
+    pipeline_t* pipeline;
+    int index;
+    platform_thread_t thread;
+    int started;
+    platform_mutex_t mutex;
+    platform_cond_t wake;
+    int signaled;                   // Notified since the last wait
+    platform_atomic_t exited;
+
+    // Statistics, written by the stage thread
+    uint64_t steps;
+    uint64_t busy_steps;
+    uint64_t idle_waits;
+} pipeline_stage_t;
+
+struct pipeline {
+    pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+    int stage_count;
+    spsc_ring_t* queues[PIPELINE_MAX_QUEUES];   // Registered for reporting only
+    int queue_count;
+    int running;
+    platform_atomic_t stopping;     // Stop requested: stages drain in order
+    platform_atomic_t finished;     // A stage is done or failed; the owner should stop
+    platform_atomic_t failed;
+};
+
+// Status line sink for pipeline_report
+typedef void (*pipeline_report_fn)(const char* message);
+
+int pipeline_init(pipeline_t* pipeline);
+
+// Returns the stage index, or -1. Add producers before their consumers.
+int pipeline_add_stage(pipeline_t* pipeline, const pipeline_stage_desc_t* desc);
+int pipeline_add_queue(pipeline_t* pipeline, spsc_ring_t* queue);
+
+int pipeline_start(pipeline_t* pipeline);
+
+// Wake a stage, typically after pushing into its input queue; any thread
+void pipeline_notify(pipeline_t* pipeline, int stage);
+
+// A stage has finished or failed, so the owner should call pipeline_stop
+int pipeline_finished(pipeline_t* pipeline);
+int pipeline_failed(pipeline_t* pipeline);
+
+// Request stop, let the stages drain in order and join them
+void pipeline_stop(pipeline_t* pipeline);
+
+// Per-queue depth and stall counters, per-stage activity
+void pipeline_report(pipeline_t* pipeline, pipeline_report_fn report);
+
+// Stops the pipeline if it still runs; does not clean up the queues
+void pipeline_cleanup(pipeline_t* pipeline);
+
+#endif // PIPELINE_H
@@ -0,0 +1,117 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Portable primitives shared by the platform-independent capture modules.
+// Windows builds map onto Win32/Interlocked APIs, other builds onto pthreads
+// and GCC/Clang atomic builtins so the core can be unit-tested on Linux.
+
+#ifdef _WIN32
+#include <windows.h>
+typedef CRITICAL_SECTION platform_mutex_t;
+typedef CONDITION_VARIABLE platform_cond_t;
+typedef HANDLE platform_thread_t;
+typedef volatile LONG platform_atomic_t;
+#else
+#include <pthread.h>
+typedef pthread_mutex_t platform_mutex_t;
+typedef pthread_cond_t platform_cond_t;
+typedef pthread_t platform_thread_t;
+typedef volatile long platform_atomic_t;
+#endif
+
+typedef void (*platform_thread_fn)(void* arg);
+
+// One-shot high-resolution timer for pacing loops; use one per thread
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+    int high_resolution;            // Created with CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#else
+    int unused;
+#endif
+} platform_timer_t;
+
+// Mutex functions
+int platform_mutex_init(platform_mutex_t* mutex);
+void platform_mutex_lock(platform_mutex_t* mutex);
+void platform_mutex_unlock(platform_mutex_t* mutex);
+void platform_mutex_destroy(platform_mutex_t* mutex);
+
+// Condition variables (used with a platform_mutex_t)
+int platform_cond_init(platform_cond_t* cond);
+void platform_cond_wait(platform_cond_t* cond, platform_mutex_t* mutex);
+// Returns 0 when woken, 1 when the timeout expired first
+int platform_cond_wait_ms(platform_cond_t* cond, platform_mutex_t* mutex, unsigned int milliseconds);
+void platform_cond_signal(platform_cond_t* cond);
+void platform_cond_broadcast(platform_cond_t* cond);
+void platform_cond_destroy(platform_cond_t* cond);
+
+// Threads
+int platform_thread_create(platform_thread_t* thread, platform_thread_fn fn, void* arg);
+void platform_thread_join(platform_thread_t thread);
+int platform_cpu_count(void);
+void platform_sleep_ms(unsigned int milliseconds);
+void platform_yield(void);          // Give up the rest of the time slice
+
+// Monotonic clock in nanoseconds from an arbitrary origin
+uint64_t platform_time_ns(void);
+
+// Sleep until platform_time_ns() reaches the deadline. Windows uses a waitable
+// timer (high resolution where the OS has it, spinning the last stretch where
+// not); other builds sleep on CLOCK_MONOTONIC with an absolute deadline.
+int platform_timer_init(platform_timer_t* timer);
+void platform_timer_wait_until_ns(platform_timer_t* timer, uint64_t deadline_ns);
+void platform_timer_destroy(platform_timer_t* timer);
+
+// Flush a stream through the C library and the OS cache to the disk, so
+// what was written survives the process and the machine going down
+int platform_file_sync(FILE* file);
+
+// Memory-mapped files. A writable map creates (or replaces) the file at the
+// given size and can grow; closing it cuts the file to the length actually
+// used. A read-only map covers the file as it was when opened; refresh maps
+// whatever another writer has added since.
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    int writable;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} platform_map_t;
+
+int platform_map_create(platform_map_t* map, const char* path, size_t size);
+int platform_map_open(platform_map_t* map, const char* path);
+int platform_map_resize(platform_map_t* map, size_t size);      // Writable maps; data may move
+int platform_map_refresh(platform_map_t* map);                  // Read-only maps; data may move
+int platform_map_sync(platform_map_t* map);                     // Flush written pages to the disk
+void platform_map_close(platform_map_t* map, size_t length);    // length: bytes kept of a writable map
+
+// Aligned allocation (alignment must be a power of two)
+void* platform_aligned_alloc(size_t size, size_t alignment);
+void platform_aligned_free(void* ptr);
+
+// Atomic counters - increment/decrement return the new value. The fence orders
+// plain stores before it ahead of any after it (for memory shared with readers).
+#ifdef _WIN32
+static inline long platform_atomic_inc(platform_atomic_t* value) { return InterlockedIncrement(value); }
+static inline long platform_atomic_dec(platform_atomic_t* value) { return InterlockedDecrement(value); }
+static inline long platform_atomic_load(platform_atomic_t* value) { return InterlockedCompareExchange(value, 0, 0); }
+static inline void platform_atomic_store(platform_atomic_t* value, long desired) { InterlockedExchange(value, desired); }
+static inline void platform_atomic_fence(void) { MemoryBarrier(); }
+#else
+static inline long platform_atomic_inc(platform_atomic_t* value) { return __atomic_add_fetch(value, 1, __ATOMIC_ACQ_REL); }
+static inline long platform_atomic_dec(platform_atomic_t* value) { return __atomic_sub_fetch(value, 1, __ATOMIC_ACQ_REL); }
+static inline long platform_atomic_load(platform_atomic_t* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+static inline void platform_atomic_store(platform_atomic_t* value, long desired) { __atomic_store_n(value, desired, __ATOMIC_RELEASE); }
+static inline void platform_atomic_fence(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#endif
+
+#endif // PLATFORM_H
@@ -0,0 +1,63 @@
+#ifndef READBACK_RING_H
+#define READBACK_RING_H
+
+#include <stdint.h>
+
+// Scheduling for a ring of GPU staging surfaces. Mapping a staging texture
+// right after the copy into it waits for the GPU to finish that copy, a full
+// GPU->CPU sync on every frame. With a ring the copy for update N goes into
+// one surface and update N - latency is mapped from another, by which time
+// its copy has long completed.
+//
+// The ring only hands out slot indices and decides when the oldest copy may
+// be mapped; the caller owns the surfaces and whatever it needs per slot.
+// Slots always retire in submission order, so updates that build on each
+// other (dirty rects, moves) are applied in the order they were captured.
+
+#define READBACK_RING_MAX_DEPTH 8
+#define READBACK_RING_DEFAULT_DEPTH 3
+#define READBACK_RING_DEFAULT_LATENCY 2
+
+// What to do with the oldest in-flight slot
+typedef enum {
+    READBACK_IDLE = 0,              // Nothing to map yet
+    READBACK_TRY,                   // Map only if the copy has finished (no waiting)
+    READBACK_WAIT                   // Map now, waiting for the copy if it must
+} readback_action_t;
+
+typedef struct {
+    int depth;                      // Surfaces in the ring
+    int latency;                    // Newer submissions a copy waits behind before it is mapped
+    int head;                       // Next slot to submit into
+    int tail;                       // Oldest in-flight slot
+    int in_flight;
+
+    // Statistics
+    uint64_t submitted;
+    uint64_t retired;
+    uint64_t stalls;                // Retires that had to wait for the GPU
+    uint64_t deferred;              // Non-blocking maps that found the copy still running
+} readback_ring_t;
+
+// latency must be below depth; 0 maps every copy immediately (no pipelining)
+int readback_ring_init(readback_ring_t* ring, int depth, int latency);
+
+// Drop every in-flight slot, e.g. after the surfaces were recreated
+void readback_ring_reset(readback_ring_t* ring);
+
+// Slot for the next copy, or -1 while every slot is in flight
+int readback_ring_begin(const readback_ring_t* ring);
+void readback_ring_submit(readback_ring_t* ring);
+
+// How to handle the oldest in-flight slot, returned in *slot. Copies older
+// than the latency must be mapped; when no new copies are coming (idle) the
+// rest are picked up as soon as the GPU is done with them.
+readback_action_t readback_ring_next(const readback_ring_t* ring, int idle, int* slot);
+
+// The oldest slot was mapped and consumed; stalled if the map had to wait
+void readback_ring_retire(readback_ring_t* ring, int stalled);
+
+// A non-blocking map found the oldest copy still running
+void readback_ring_defer(readback_ring_t* ring);
+
+#endif // READBACK_RING_H
@@ -0,0 +1,144 @@
+#ifndef REPLAY_BUFFER_H
+#define REPLAY_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+#include "fmp4_muxer.h"
+
+// Instant replay: the last stretch of a recording kept in memory as encoded
+// packets, written to a standalone MP4 only when asked. Packets (H.264
+// access units in Annex B form, ADTS AAC frames) go into one fixed block of
+// budget_bytes and a fixed packet index, both allocated up front, so memory
+// never grows with the length of the session.
+//
+// The buffer always starts on a keyframe. When a packet does not fit, or
+// the oldest GOP is older than max_duration needs, whole GOPs are evicted
+// from the front with the audio that plays during them. A GOP larger than
+// the whole budget cannot be kept: the buffer empties and video resumes at
+// the next keyframe.
+//
+// Saving copies nothing up front. The saver walks the buffer from the front
+// while packets keep arriving; only packets it has already written may be
+// evicted meanwhile, and a packet that would need an unread one is dropped
+// (video then resumes at the next keyframe) rather than blocking capture.
+// replay_buffer_save writes on the caller's thread; replay_buffer_request_save
+// hands the job to the buffer's saver thread and returns at once, so it can
+// run from a console control handler or a GUI button.
+
+#define REPLAY_UNITS_PER_SECOND 10000000LL      // 100 ns units, as the encoder
+#define REPLAY_DEFAULT_MAX_PACKETS 65536
+#define REPLAY_MAX_REQUESTS 4                   // Saves queued for the saver thread
+#define REPLAY_MAX_PATH 520
+
+#define REPLAY_PACKET_VIDEO 0
+#define REPLAY_PACKET_AUDIO 1
+
+typedef struct {
+    size_t budget_bytes;            // Packet data held at most
+    uint32_t max_packets;           // Index entries; 0 for the default
+    int64_t max_duration;           // Keep no more than needed for this long, 100 ns units; 0 to fill the budget
+    int video;                      // H.264 packets expected
+    int audio;                      // ADTS AAC packets expected
+    uint32_t frame_duration;        // 100 ns units, for the saved file's last frame; 0 for 1/30 s
+} replay_config_t;
+
+typedef struct {
+    int type;                       // REPLAY_PACKET_*
+    int keyframe;
+    int64_t time;                   // 100 ns since recording start
+    int64_t duration;               // Audio only: frames * 1024 / rate
+    size_t offset;                  // Data position in the block
+    size_t size;
+    size_t span;                    // Bytes taken from the block, including padding skipped to wrap
+} replay_packet_t;
+
+typedef struct {
+    uint64_t packets;               // Accepted
+    uint64_t bytes;
+    uint64_t gops_evicted;
+    uint64_t packets_evicted;
+    uint64_t dropped_before_keyframe;   // Video with no keyframe to start from
+    uint64_t dropped_oversize;      // Larger than the budget, or a GOP that outgrew it
+    uint64_t dropped_while_saving;  // The saver had not written the space yet
+    uint64_t saves;
+    uint64_t save_failures;
+    uint64_t last_save_ns;
+    int64_t last_save_duration;     // Media length of the last save, 100 ns units
+    size_t peak_bytes;
+} replay_stats_t;
+
+typedef struct {
+    uint64_t video_frames;
+    uint64_t audio_frames;          // Packets
+    int64_t start_time;             // Recording time the file starts at
+    int64_t duration;
+    uint64_t bytes_written;
+} replay_save_result_t;
+
+typedef struct {
+    replay_config_t config;
+
+    uint8_t* data;                  // budget_bytes
+    size_t used;                    // Bytes of live packets and their padding
+    size_t tail;                    // Where the next packet goes
+
+    replay_packet_t* packets;       // max_packets, a ring
+    uint64_t head;                  // Sequence number of the oldest packet
+    uint64_t tail_sequence;         // Sequence number the next packet gets
+    uint64_t* keyframes;            // Sequence numbers of the keyframes from the buffer's start on, a ring
+    uint32_t keyframe_first;
+    uint32_t keyframe_count;        // 0: no keyframe to start from
+    int need_keyframe;              // Video was dropped: wait for the next keyframe
+    int64_t last_time;              // Newest packet's end
+
+    platform_mutex_t mutex;
+    platform_cond_t cond;
+    int saving;
+    uint64_t save_cursor;           // Packets before this were written by the saver
+
+    // Saver thread
+    platform_thread_t thread;
+    int thread_started;
+    int stopping;
+    char requests[REPLAY_MAX_REQUESTS][REPLAY_MAX_PATH];
+    int request_count;
+    int busy;
+
+    replay_stats_t stats;
+} replay_buffer_t;
+
+// Status line sink for replay_buffer_report
+typedef void (*replay_report_fn)(const char* message);
+
+int replay_buffer_init(replay_buffer_t* buffer, const replay_config_t* config);
+
+// One Annex B access unit; time in 100 ns units, increasing
+int replay_buffer_write_video(replay_buffer_t* buffer, const uint8_t* data, size_t size, int64_t time);
+
+// One or more ADTS frames starting at time
+int replay_buffer_write_audio(replay_buffer_t* buffer, const uint8_t* data, size_t size, int64_t time);
+
+// Write what the buffer holds now to an MP4 at path; packets keep arriving meanwhile
+int replay_buffer_save(replay_buffer_t* buffer, const char* path, replay_save_result_t* result);
+
+// Queue a save on the saver thread and return; fails if REPLAY_MAX_REQUESTS are waiting
+int replay_buffer_request_save(replay_buffer_t* buffer, const char* path);
+
+// Wait until every requested save has finished
+void replay_buffer_wait_saves(replay_buffer_t* buffer);
+
+// Media held, from the first keyframe to the end of the newest packet
+int64_t replay_buffer_duration(replay_buffer_t* buffer);
+
+size_t replay_buffer_bytes(replay_buffer_t* buffer);
+void replay_buffer_get_stats(replay_buffer_t* buffer, replay_stats_t* stats);
+void replay_buffer_report(replay_buffer_t* buffer, replay_report_fn report);
+
+// Name of the index-th save of a recording: name.mp4 -> name-replay-001.mp4
+int replay_buffer_path(const char* base_path, uint32_t index, char* path, size_t size);
+
+// Waits for queued saves, then frees everything
+void replay_buffer_cleanup(replay_buffer_t* buffer);
+
+#endif // REPLAY_BUFFER_H
@@ -0,0 +1,42 @@
+#ifndef REPLAY_SOURCE_H
+#define REPLAY_SOURCE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "capture_source.h"
+
+// Raw frame files: a 32-byte header followed by width * height * 4 byte
+// top-down BGRA frames, nothing else. Recorded once (on any machine) and
+// replayed as a capture source, they feed real desktop content through the
+// pipeline where no desktop is available.
+//
+// Header, little-endian:
+//   0  "MUXSWRAW"   magic
+//   8  uint32       version (1)
+//   12 uint32       width
+//   16 uint32       height
+//   20 uint32       fps the frames were captured at (0 = unknown)
+//   24 uint64       reserved, 0
+
+#define REPLAY_FILE_MAGIC "MUXSWRAW"
+#define REPLAY_FILE_VERSION 1
+#define REPLAY_FILE_HEADER_SIZE 32
+#define REPLAY_MAX_DIMENSION 16384
+
+typedef struct {
+    FILE* file;
+    int width;
+    int height;
+    uint64_t frames;
+} replay_writer_t;
+
+// Writer for producing replay files
+int replay_writer_open(replay_writer_t* writer, const char* path, int width, int height, int fps);
+int replay_writer_append(replay_writer_t* writer, const uint8_t* pixels, size_t pitch);
+int replay_writer_close(replay_writer_t* writer);
+
+// Replay source; with loop the file restarts at its end, otherwise the
+// source reports finished after the last frame
+int replay_source_create(capture_source_t* source, const char* path, int loop);
+
+#endif // REPLAY_SOURCE_H
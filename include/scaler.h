@@ -0,0 +1,76 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "copy_kernels.h"
+#include "worker_pool.h"
+
+// BGRA frame resampling between capture and encode, so a 4K desktop can be
+// delivered at 1080p without the encoder ever seeing full-resolution pixels.
+// Exact 2:1 reductions take a dedicated 2x2 box path; other ratios run a
+// separable two-pass filter with fixed-point weights precomputed at init.
+// Output rows are split into slices run on a shared worker pool.
+
+typedef enum {
+    SCALER_FILTER_AUTO = 0,     // Box for exact 2:1, area when shrinking, bilinear when enlarging
+    SCALER_FILTER_BOX2,         // 2x2 average; requires dst = src / 2 on both axes
+    SCALER_FILTER_AREA,         // Pixel-coverage average; best for arbitrary downscales
+    SCALER_FILTER_BILINEAR      // Two-tap linear interpolation
+} scaler_filter_t;
+
+// Source pixels contributing to one output column or row
+typedef struct {
+    int start;                  // First source index
+    int count;                  // Number of taps
+    int offset;                 // Index of the first tap weight in the weight table
+} scaler_span_t;
+
+typedef struct {
+    scaler_span_t* spans;       // One per output index
+    int16_t* weights;           // Taps of every span, each span summing to SCALER_WEIGHT_ONE
+    int max_taps;
+} scaler_axis_t;
+
+typedef struct {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    scaler_filter_t filter;     // Resolved filter, never AUTO after init
+    copy_kernel_level_t level;  // SIMD level used by the kernels
+    worker_pool_t* pool;        // Slices run here; NULL scales on the calling thread
+    int workers;                // Scratch sets below, one per pool worker
+
+    scaler_axis_t horizontal;
+    scaler_axis_t vertical;
+    int16_t* row_buffers;       // Per-worker intermediate row (vertical pass output)
+    size_t row_buffer_stride;   // Elements per worker row buffer
+    const uint8_t** tap_rows;   // Per-worker source row pointers for the vertical taps
+} scaler_t;
+
+#define SCALER_WEIGHT_BITS 14
+#define SCALER_WEIGHT_ONE (1 << SCALER_WEIGHT_BITS)
+
+// Lifecycle. The pool may be NULL and, if given, must outlive the scaler.
+int scaler_init(scaler_t* scaler, int src_width, int src_height, int dst_width, int dst_height,
+                scaler_filter_t filter, worker_pool_t* pool);
+void scaler_cleanup(scaler_t* scaler);
+
+// Override the SIMD level (tests and benchmarks); returns -1 if unsupported
+int scaler_set_level(scaler_t* scaler, copy_kernel_level_t level);
+
+// Scale a whole top-down or bottom-up BGRA frame; orientation is preserved
+int scaler_process(scaler_t* scaler, uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch);
+
+// Scale output rows [dst_row_begin, dst_row_end) using the given worker's scratch
+int scaler_process_rows(scaler_t* scaler, int worker, uint8_t* dst, size_t dst_pitch,
+                        const uint8_t* src, size_t src_pitch, int dst_row_begin, int dst_row_end);
+
+// Output size for a scale factor or explicit size, rounded to even dimensions
+int scaler_output_size(int src_width, int src_height, double scale, int width, int height,
+                       int* out_width, int* out_height);
+
+const char* scaler_filter_name(scaler_filter_t filter);
+
+#endif // SCALER_H
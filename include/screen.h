@@ -10,25 +10,79 @@
 #include <d3d11.h>
 #pragma warning(pop)
 
+#include "frame_pool.h"
+#include "dirty_frame.h"
+#include "capture_region.h"
+#include "cursor_compositor.h"
+#include "capture_source.h"
+#include "readback_ring.h"
+
+// One desktop update waiting in a staging slot, in region coordinates
+typedef struct {
+    BOOL full;                      // Whole region copied; the rect lists are unused
+    frame_move_t* moves;
+    int move_count;
+    frame_rect_t* dirty;
+    int dirty_count;
+    int capacity;                   // Entries allocated in each list
+} screen_readback_t;
+
 typedef struct {
     ID3D11Device* device;
     ID3D11DeviceContext* context;
     IDXGIOutputDuplication* duplication;
     DXGI_OUTDUPL_DESC duplication_desc;
+    int monitor_index;              // Position in the flat output list across adapters
+    capture_region_t output_bounds; // Output rectangle in desktop coordinates
     int width;
     int height;
     BOOL is_capturing;
-    // Frame caching for consistent FPS
-    void* cached_frame;
-    size_t cached_frame_size;
-    BOOL has_cached_frame;
+    // Part of the desktop that is read back and delivered, full desktop by default
+    capture_region_t region;
+    // Frames are written into a pool shared with the engine and encoder
+    frame_pool_t* frame_pool;
+    // A frame has been delivered, so "repeat previous frame" is meaningful
+    BOOL has_previous_frame;
+    // Incremental readback: only dirty rects are copied to the staging ring and
+    // the persistent CPU frame, pool frames catch up from the damage history.
+    // Each update is mapped a few updates after its copy, so the capture loop
+    // does not wait for the GPU.
+    ID3D11Texture2D* staging[READBACK_RING_MAX_DEPTH];
+    screen_readback_t readback[READBACK_RING_MAX_DEPTH];   // Update carried by each staging slot
+    readback_ring_t readback_ring;
+    dirty_frame_t dirty_frame;
+    BYTE* metadata;                 // Move and dirty rects reported by DXGI
+    UINT metadata_capacity;
+    uint64_t* slot_generation;      // Dirty frame generation each pool frame was last synced to
+    uint64_t delivered_generation;  // Generation of the last frame handed out from the pool
+    uint64_t external_generation;   // Generation the screen_capture_into target was last synced to
+    BOOL slots_flipped;             // Orientation the pool frames were written in
+    // Software cursor: DXGI leaves the pointer out of the desktop image, so its
+    // shape and position are tracked here and blended into delivered frames
+    BOOL cursor_enabled;
+    cursor_compositor_t cursor;
+    BYTE* pointer_shape;            // Raw shape from GetFramePointerShape
+    UINT pointer_shape_capacity;
+    frame_rect_t* slot_cursor;      // Cursor rect blended into each pool frame, undone before reuse
+    uint64_t delivered_cursor;      // Cursor generation of the last frame handed out
 } screen_capture_t;
 
+// Frame acquisition results, the same values every capture source returns
+#define SCREEN_FRAME_NEW      CAPTURE_FRAME_NEW       // *frame holds a new pool reference
+#define SCREEN_FRAME_NONE     CAPTURE_FRAME_NONE      // Nothing to deliver yet
+#define SCREEN_FRAME_REPEAT   CAPTURE_FRAME_REPEAT    // Desktop unchanged, reuse the previous frame
+
 // Function declarations
+int screen_count_outputs(void);
 int screen_init(screen_capture_t* capture);
+int screen_init_output(screen_capture_t* capture, int monitor_index);
+void screen_set_frame_pool(screen_capture_t* capture, frame_pool_t* pool);
+void screen_set_cursor(screen_capture_t* capture, BOOL enabled);
+int screen_set_region(screen_capture_t* capture, int x, int y, int width, int height);
 int screen_start_capture(screen_capture_t* capture);
-int screen_get_frame(screen_capture_t* capture, void** frame_data, size_t* frame_size);
-int screen_get_frame_dual_track(screen_capture_t* capture, void** frame_data, size_t* frame_size, BOOL dual_track_mode);
+int screen_get_frame(screen_capture_t* capture, frame_handle_t* frame);
+int screen_get_frame_dual_track(screen_capture_t* capture, frame_handle_t* frame, BOOL dual_track_mode);
+int screen_capture_into(screen_capture_t* capture, uint8_t* dst, size_t dst_pitch);
 void screen_stop_capture(screen_capture_t* capture);
 void screen_cleanup(screen_capture_t* capture);
 
@@ -0,0 +1,149 @@
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+// Segmented output: one long recording split into files that play back to
+// back. Once the open segment reaches its duration or size limit, the next
+// frame that can start a file (a keyframe; any new frame for an encoder that
+// restarts its GOP with each file) becomes the first frame of the next
+// segment. Nothing is dropped or written twice at the boundary:
+//
+//   - Video: the last frame of the old segment lasts until the boundary.
+//   - Audio: samples before the boundary time go to the old segment, the
+//     rest to the new one, splitting a packet when the boundary falls inside
+//     it. Audio ahead of video is held until video passes it; when audio
+//     lags, the boundary frame (and any behind it) waits for the audio to
+//     reach it, up to hold_ms, so late samples still land in the old file.
+//
+// Without video, audio stream 0 places the boundaries on exact sample counts
+// and the other streams are split at the same time.
+//
+// Every segment's timeline starts at 0, so segments play and concatenate on
+// their own, and segment n + 1 starts exactly where segment n ends on the
+// recording timeline (start_time, in the stats and open callback).
+//
+// Closing a file (moov, index, flush) can take seconds for a long segment.
+// The old segment is handed to a finalizer thread; the caller's thread only
+// detaches it and opens the next file.
+
+#define SEGMENTER_UNITS_PER_SECOND 10000000LL     // 100 ns units, as the encoder
+#define SEGMENTER_MAX_AUDIO 2                     // Audio streams (system, microphone)
+#define SEGMENTER_MAX_PENDING 4                   // Closed segments waiting for the finalizer
+#define SEGMENTER_MAX_PATH 520
+#define SEGMENTER_MAX_VIDEO_HOLD 32               // Frames waiting for audio at a boundary
+#define SEGMENTER_MAX_VIDEO_ITEM 64               // Bytes of a caller's frame item
+#define SEGMENTER_DEFAULT_HOLD_MS 100             // How far video waits for audio at a boundary
+#define SEGMENTER_AUDIO_HOLD_MS 1000              // Audio held ahead of the clock, per stream
+
+typedef struct {
+    int64_t max_duration;           // Segment length, 100 ns units; 0 for no limit
+    uint64_t max_bytes;             // Segment size; 0 for no limit
+    int video;                      // Boundaries fall on video frames; otherwise on audio samples
+    int audio_streams;
+    uint32_t audio_rate[SEGMENTER_MAX_AUDIO];           // Hz
+    uint32_t audio_frame_bytes[SEGMENTER_MAX_AUDIO];    // Bytes per sample frame, all channels
+    size_t video_item_size;         // Bytes copied from each frame pointer, at most SEGMENTER_MAX_VIDEO_ITEM
+    uint32_t hold_ms;               // Longest wait for audio at a boundary; 0 for the default
+} segmenter_config_t;
+
+// The encoder behind the segmenter. Times are relative to the segment start.
+typedef struct {
+    // Segment `index` (from 2; the caller opened the first) starts at
+    // start_time on the recording timeline
+    int (*open)(void* context, uint32_t index, const char* path, int64_t start_time);
+    // A copy of the item passed to segmenter_video
+    int (*video)(void* context, const void* frame, int64_t time);
+    // position: sample frames written to this stream in the segment so far
+    int (*audio)(void* context, int stream, const uint8_t* data, uint32_t frames, uint64_t position);
+    // Bytes written to the open segment; NULL if unknown (size limits then never trip)
+    uint64_t (*bytes)(void* context);
+    // Detach the open segment, ending it at end_time; the handle goes to finalize (NULL fails)
+    void* (*close)(void* context, int64_t end_time);
+    // Finish a detached segment; runs on the finalizer thread
+    int (*finalize)(void* context, void* segment);
+} segment_sink_t;
+
+typedef struct {
+    uint32_t segments;              // Opened, including the first
+    uint32_t finalized;
+    uint32_t finalize_failures;
+    uint64_t finalize_ns_max;       // Longest finalize, off the recording thread
+    uint64_t finalize_waits;        // Rollovers that waited for a finalizer slot
+    uint64_t held_audio_peak;       // Bytes held ahead of the clock
+    uint64_t held_video_peak;       // Frames held waiting for audio
+    uint64_t late_boundaries;       // Rolled before every stream reached the boundary
+    uint64_t hold_overflows;        // Audio written before the clock passed it
+    int64_t last_start_time;        // Recording time where the open segment starts
+} segmenter_stats_t;
+
+typedef struct {
+    uint8_t* data;
+    size_t size;                    // Bytes held
+    size_t capacity;
+    uint64_t written;               // Sample frames written to the open segment
+    uint64_t received;              // Sample frames received since recording start
+    uint64_t segment_start;         // Sample frame where the open segment starts
+} segmenter_audio_t;
+
+typedef struct {
+    segmenter_config_t config;
+    segment_sink_t sink;
+    void* context;
+    char base_path[SEGMENTER_MAX_PATH];
+    char path[SEGMENTER_MAX_PATH];  // Open segment
+
+    uint32_t index;
+    int failed;
+    int64_t segment_start;          // Recording time of the open segment's start
+    int64_t video_time;             // Latest video frame
+    uint64_t video_frames;          // In the open segment
+    int rollover_due;               // A limit was reached; roll at the next frame that can start a file
+    segmenter_audio_t audio[SEGMENTER_MAX_AUDIO];
+
+    // Frames not yet written: the first waits for audio to reach a boundary
+    uint8_t video_items[SEGMENTER_MAX_VIDEO_HOLD][SEGMENTER_MAX_VIDEO_ITEM];
+    int64_t video_times[SEGMENTER_MAX_VIDEO_HOLD];
+    int video_can_start[SEGMENTER_MAX_VIDEO_HOLD];
+    int video_held;
+
+    // Finalizer thread
+    platform_thread_t thread;
+    platform_mutex_t mutex;
+    platform_cond_t cond;
+    int thread_started;
+    int stopping;
+    void* pending[SEGMENTER_MAX_PENDING];
+    int pending_count;
+    int finalizing;
+
+    segmenter_stats_t stats;
+} segmenter_t;
+
+// Status line sink for segmenter_report
+typedef void (*segmenter_report_fn)(const char* message);
+
+// Path of segment index (from 1): "name.mp4" becomes "name-001.mp4"
+int segmenter_path(const char* base_path, uint32_t index, char* path, size_t size);
+
+// The caller opens segment 1 (segmenter_path(base_path, 1)) itself and
+// finalizes the last one after segmenter_finish
+int segmenter_init(segmenter_t* segmenter, const segmenter_config_t* config, const char* base_path,
+                   const segment_sink_t* sink, void* context);
+
+// A video frame at time (100 ns since recording start); video_item_size bytes
+// of frame are copied. can_start: the frame may begin a segment (repeats of
+// the previous frame pass 0). The sink may receive it later, after audio.
+int segmenter_video(segmenter_t* segmenter, const void* frame, int64_t time, int can_start);
+int segmenter_audio(segmenter_t* segmenter, int stream, const uint8_t* data, uint32_t frames);
+
+// Write held frames and audio to the open segment and wait for the finalizer
+// to finish every closed segment. The open segment is left for the caller.
+int segmenter_finish(segmenter_t* segmenter);
+void segmenter_cleanup(segmenter_t* segmenter);
+
+void segmenter_report(const segmenter_t* segmenter, segmenter_report_fn report);
+
+#endif // SEGMENTER_H
@@ -0,0 +1,36 @@
+#ifndef SIMULATED_AUDIO_H
+#define SIMULATED_AUDIO_H
+
+#include <stdint.h>
+#include "audio_source.h"
+
+// A stand-in audio device driven by a timer thread. Every period the timer
+// writes the frames that are due into a device buffer of buffer_ms frames
+// and signals that a buffer is ready, the way a WASAPI endpoint in event
+// mode does. Frames that find the buffer full are lost, like a device
+// overrun. Samples are 16-bit and carry their frame index: channel c of
+// frame n holds (int16_t)(n + c), so consumers can check for gaps.
+
+typedef struct {
+    int sample_rate;
+    int channels;
+    unsigned int period_ms;         // Timer period, one buffer-ready signal each
+    unsigned int buffer_ms;         // Device buffer; must hold at least one period
+    int event_driven;               // 0: wait() just sleeps, like polling a device
+} simulated_audio_config_t;
+
+typedef struct {
+    uint64_t produced_frames;
+    uint64_t lost_frames;           // Overrun: the buffer was full when they were due
+    uint64_t signals;
+    uint64_t pickups;               // Buffers fetched after a signal
+    uint64_t total_latency_ns;      // Signal to first get_buffer, summed over pickups
+    uint64_t max_latency_ns;
+} simulated_audio_stats_t;
+
+int simulated_audio_create(audio_source_t* source, const simulated_audio_config_t* config);
+
+// Fails (-1) for sources that are not simulated
+int simulated_audio_get_stats(audio_source_t* source, simulated_audio_stats_t* stats);
+
+#endif // SIMULATED_AUDIO_H
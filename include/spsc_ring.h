@@ -0,0 +1,72 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread, carrying small fixed-size elements by value (frame and
+// packet handles, not pixels). Push and pop never block and never take a
+// lock: a full or empty ring is reported to the caller, who decides whether
+// to drop, retry or wait.
+//
+// Each side owns its index and keeps a cached copy of the other side's, so
+// the shared cache line is only touched when the cached view runs out. The
+// producer and consumer halves are padded onto separate cache lines.
+
+#define SPSC_RING_MAX_ELEMENT 64
+#define SPSC_RING_CACHE_LINE 64
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t depth;                 // Elements queued right now
+    uint32_t high_water;            // Deepest the queue has been
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t full;                  // Pushes rejected because the ring was full (producer stalls)
+    uint64_t empty;                 // Pops that found nothing (consumer starved)
+} spsc_ring_stats_t;
+
+typedef struct {
+    // Read-only after init
+    const char* name;
+    uint8_t* slots;
+    size_t element_size;
+    unsigned long capacity;         // Power of two
+    unsigned long mask;
+    char pad0[SPSC_RING_CACHE_LINE];
+
+    // Producer side
+    platform_atomic_t head;         // Next slot to write; wraps freely
+    unsigned long cached_tail;      // Producer's last view of tail
+    unsigned long high_water;
+    uint64_t pushed;
+    uint64_t full;
+    char pad1[SPSC_RING_CACHE_LINE];
+
+    // Consumer side
+    platform_atomic_t tail;         // Next slot to read
+    unsigned long cached_head;      // Consumer's last view of head
+    uint64_t popped;
+    uint64_t empty;
+    char pad2[SPSC_RING_CACHE_LINE];
+} spsc_ring_t;
+
+// Capacity is rounded up to a power of two; the name is kept for reports
+int spsc_ring_init(spsc_ring_t* ring, const char* name, unsigned int capacity, size_t element_size);
+void spsc_ring_cleanup(spsc_ring_t* ring);
+
+// Producer: returns 0, or -1 when the ring is full
+int spsc_ring_push(spsc_ring_t* ring, const void* element);
+
+// Consumer: returns 0, or -1 when the ring is empty
+int spsc_ring_pop(spsc_ring_t* ring, void* element);
+
+// Safe from any thread; a snapshot that may be stale by the time it returns
+unsigned int spsc_ring_depth(spsc_ring_t* ring);
+
+// Counters are exact once both sides are idle, approximate while they run
+void spsc_ring_get_stats(spsc_ring_t* ring, spsc_ring_stats_t* stats);
+
+#endif // SPSC_RING_H
@@ -0,0 +1,39 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include <stdint.h>
+#include "capture_source.h"
+
+// Deterministic generated desktops for running and profiling the pipeline
+// without a real screen. Each pattern stresses a different part of it:
+//
+//   blocks  a static gradient with a few bouncing blocks - small dirty areas
+//   text    a page of glyph-like text scrolling upwards  - large moves, static
+//           between scroll steps
+//   noise   full-frame random pixels                     - worst case for
+//           change detection and the encoder
+//
+// Motion is defined per second and advanced by one 1/fps step per delivered
+// frame, so output is identical across runs and machines.
+
+typedef enum {
+    SYNTHETIC_PATTERN_BLOCKS = 0,
+    SYNTHETIC_PATTERN_TEXT,
+    SYNTHETIC_PATTERN_NOISE
+} synthetic_pattern_t;
+
+typedef struct {
+    synthetic_pattern_t pattern;
+    int width;
+    int height;
+    int fps;
+    uint32_t seed;
+} synthetic_source_config_t;
+
+int synthetic_source_create(capture_source_t* source, const synthetic_source_config_t* config);
+
+// Pattern names as used on the command line ("blocks", "text", "noise")
+const char* synthetic_pattern_name(synthetic_pattern_t pattern);
+int synthetic_pattern_parse(const char* name, synthetic_pattern_t* pattern);
+
+#endif // SYNTHETIC_SOURCE_H
@@ -3,6 +3,8 @@
 
 #include <windows.h>
 
+#define SYSTEM_DEFAULT_BUFFER_MS 50
+
 #ifdef MUXSW_ENABLE_AUDIO
 #include <mmdeviceapi.h>
 #include <audioclient.h>
@@ -16,13 +18,27 @@ typedef struct {
     IAudioCaptureClient* capture_client;
     WAVEFORMATEX* wave_format;
     UINT32 buffer_frame_count;
+    UINT32 buffer_ms;          // Requested device buffer length
+    UINT32 period_ms;          // Device period: how often a buffer becomes ready
+    HANDLE ready_event;        // Signalled by the device in event-driven mode
+    BOOL event_driven;
     BOOL is_capturing;
     BOOL using_silent_buffer;  // Track if we're using silent buffer
+    // Silence generated while nothing plays, paced from the first empty read
+    BYTE* silent_buffer;
+    UINT32 silent_buffer_size;
+    UINT32 silent_call_count;
+    DWORD silent_start_time;
+    UINT64 silent_samples;
+    DWORD last_silent_generation;
 } system_context_t;
 
 // System audio capture functions
-int system_init(system_context_t* ctx);
+// buffer_ms = 0 uses SYSTEM_DEFAULT_BUFFER_MS
+int system_init(system_context_t* ctx, UINT32 buffer_ms);
 int system_start_capture(system_context_t* ctx);
+// Sleep until the device has a buffer ready: 0 ready, 1 timeout, -1 error
+int system_wait(system_context_t* ctx, DWORD timeout_ms);
 int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames);
 void system_release_buffer(system_context_t* ctx, UINT32 num_frames);
 void system_stop_capture(system_context_t* ctx);
@@ -36,8 +52,9 @@ typedef struct {
 } system_context_t;
 
 // No-op stub functions for MVP
-static inline int system_init(system_context_t* ctx) { (void)ctx; return 0; }
+static inline int system_init(system_context_t* ctx, UINT32 buffer_ms) { (void)ctx; (void)buffer_ms; return 0; }
 static inline int system_start_capture(system_context_t* ctx) { (void)ctx; return 0; }
+static inline int system_wait(system_context_t* ctx, DWORD timeout_ms) { (void)ctx; (void)timeout_ms; return -1; }
 static inline int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames) { 
     (void)ctx; (void)data; (void)num_frames; return -1; 
 }
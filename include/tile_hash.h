@@ -0,0 +1,58 @@
+#ifndef TILE_HASH_H
+#define TILE_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "copy_kernels.h"
+#include "worker_pool.h"
+
+// Content change detection for captured BGRA frames. The frame is cut into
+// square tiles and each tile gets a 64-bit hash; a frame whose tiles all hash
+// the same as the previous frame's is unchanged, whatever the capture API
+// reported (cursor-only updates and pixel-identical repaints). The hash
+// accumulates 32-byte stripes in four 64-bit lanes with 32x32->64 multiplies,
+// so the SSE2/AVX2 kernels produce the same value as the scalar one.
+
+#define TILE_HASH_DEFAULT_TILE 64
+#define TILE_HASH_MAX_TILE 256      // Tile size in pixels; must be a multiple of 8
+
+typedef struct {
+    int width;
+    int height;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    copy_kernel_level_t level;      // SIMD level used by the kernels
+    worker_pool_t* pool;            // Tile rows are hashed here; NULL hashes on the calling thread
+
+    uint64_t* hashes;               // tiles_x * tiles_y, from the latest update
+    uint8_t* changed;               // Per tile, non-zero if it changed in the latest update
+    uint64_t keys[TILE_HASH_MAX_TILE / 2 + 4]; // Per 8-byte word of a tile row, plus a tail stripe
+    int has_frame;                  // hashes hold a frame to compare against
+
+    // Statistics
+    int changed_tiles;              // Latest update
+    uint64_t frames;
+    uint64_t unchanged_frames;
+} tile_hash_t;
+
+// Lifecycle. tile_size 0 picks TILE_HASH_DEFAULT_TILE.
+int tile_hash_init(tile_hash_t* hash, int width, int height, int tile_size);
+void tile_hash_cleanup(tile_hash_t* hash);
+
+// Override the SIMD level (tests and benchmarks); returns -1 if unsupported
+int tile_hash_set_level(tile_hash_t* hash, copy_kernel_level_t level);
+void tile_hash_set_pool(tile_hash_t* hash, worker_pool_t* pool);
+
+// Hash a frame and compare it with the previous one. Returns the number of
+// changed tiles (every tile for the first frame), or -1 on error. Tiles are
+// numbered in buffer row order, whatever the frame's orientation.
+int tile_hash_update(tile_hash_t* hash, const uint8_t* pixels, size_t pitch);
+
+// Forget the previous frame so the next update reports every tile changed
+void tile_hash_reset(tile_hash_t* hash);
+
+// Hash of one tile-sized block, as stored in hashes[] (tests and benchmarks)
+uint64_t tile_hash_block(const tile_hash_t* hash, const uint8_t* pixels, size_t pitch, int width, int height);
+
+#endif // TILE_HASH_H
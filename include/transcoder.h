@@ -0,0 +1,83 @@
+#ifndef TRANSCODER_H
+#define TRANSCODER_H
+
+#include <stdint.h>
+#include "color_convert.h"
+#include "encoder_backend.h"
+
+// Offline transcode of a capture spool or raw frame file (replay_source.h)
+// to fragmented MP4, after a session recorded with --spool. The input is
+// memory-mapped and runs through three pipeline stages on their own threads:
+//
+//   read     rebuilds spool frames or copies raw ones out of the mapping, so
+//            page faults and disk reads happen here, a few frames ahead
+//   convert  scales and converts BGRA to NV12, each frame split into slices
+//            across a worker pool
+//   encode   hands NV12 frames to an encoder backend (encoder_backend.h):
+//            software H.264 by default, libx264, or null to measure the
+//            other two stages alone
+//
+// Bounded queues between them keep the disk and every core busy at once.
+// Spool repeats skip reading and conversion and cost the encoder a skipped
+// picture. The report gives each stage's rate over the time it was working,
+// so the slowest stage is the one holding the transcode back.
+
+#define TRANSCODE_DEFAULT_QUEUE 4
+#define TRANSCODE_MAX_QUEUE 64
+
+typedef enum {
+    TRANSCODE_INPUT_SPOOL = 0,
+    TRANSCODE_INPUT_RAW
+} transcode_input_t;
+
+// Status line sink for progress and reports
+typedef void (*transcode_report_fn)(const char* message);
+
+typedef struct {
+    const char* input;
+    const char* output;
+    double scale;                   // Output size as a factor, or width/height; 0 = input size
+    int width;
+    int height;
+    color_matrix_t matrix;
+    color_range_t range;
+    int threads;                    // Conversion workers; 0 = one per CPU
+    int fps;                        // Raw files that carry none; 0 = the file's, else 30
+    int keyframe_interval;          // Frames; 0 = two seconds
+    encoder_backend_kind_t encoder; // A backend that takes NV12: h264 (the default), x264 or null
+    int queue_depth;                // Frames in flight between stages; 0 = TRANSCODE_DEFAULT_QUEUE
+    int follow;                     // Wait for more frames while the spool is still being written
+    transcode_report_fn progress;   // Optional, called about once a second
+} transcode_config_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t busy_ns;               // Time spent working, waits excluded
+} transcode_stage_stats_t;
+
+typedef struct {
+    transcode_input_t input;
+    encoder_backend_kind_t encoder;
+    int input_width;
+    int input_height;
+    int output_width;
+    int output_height;
+    int threads;
+    transcode_stage_stats_t read;
+    transcode_stage_stats_t convert;
+    transcode_stage_stats_t encode;
+    uint64_t frames;                // Written to the output
+    uint64_t repeats;               // Spool frames with nothing changed
+    uint64_t input_bytes;
+    uint64_t output_bytes;
+    uint64_t elapsed_ns;
+} transcode_stats_t;
+
+void transcode_config_defaults(transcode_config_t* config);
+
+// Runs to the end of the input; stats are filled in as far as it got even on failure
+int transcode_file(const transcode_config_t* config, transcode_stats_t* stats);
+
+void transcode_report(const transcode_stats_t* stats, transcode_report_fn report);
+
+#endif // TRANSCODER_H
@@ -0,0 +1,25 @@
+#ifndef WASAPI_SOURCE_H
+#define WASAPI_SOURCE_H
+
+#include "audio_source.h"
+#include "microphone.h"
+#include "system.h"
+
+// The microphone and system loopback endpoints as audio sources for the
+// capture threads. The contexts stay owned by the caller: init them first
+// and clean them up after the source is destroyed. The capture thread joins
+// the multithreaded apartment and the "Pro Audio" MMCSS class while it runs.
+
+#ifdef MUXSW_ENABLE_AUDIO
+int wasapi_source_create_microphone(audio_source_t* source, microphone_context_t* ctx);
+int wasapi_source_create_system(audio_source_t* source, system_context_t* ctx);
+#else
+static inline int wasapi_source_create_microphone(audio_source_t* source, microphone_context_t* ctx) {
+    (void)source; (void)ctx; return -1;
+}
+static inline int wasapi_source_create_system(audio_source_t* source, system_context_t* ctx) {
+    (void)source; (void)ctx; return -1;
+}
+#endif // MUXSW_ENABLE_AUDIO
+
+#endif // WASAPI_SOURCE_H
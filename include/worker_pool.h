@@ -0,0 +1,64 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "platform.h"
+
+// Persistent worker threads for the per-frame pixel stages (scaling, colour
+// conversion). A run splits a job into numbered tasks, typically horizontal
+// slices of a frame. Every worker starts on its own contiguous share of the
+// tasks and, once that is drained, steals from the others, so a worker that
+// was descheduled does not hold up the frame. The calling thread takes part
+// as worker 0, and worker_pool_run returns only once every task has finished.
+
+#define WORKER_POOL_MAX_THREADS 64
+
+// Tasks that write disjoint outputs give the same result for any schedule.
+// Return 0 on success; any failure makes the whole run fail.
+typedef int (*worker_pool_task_fn)(void* context, int task, int worker);
+
+// One worker's share of the current run, padded to its own cache line
+typedef struct {
+    platform_atomic_t next;     // Next unclaimed task (may run past end)
+    long end;                   // One past the last task of this share
+    char padding[64 - sizeof(platform_atomic_t) - sizeof(long)];
+} worker_pool_queue_t;
+
+typedef struct {
+    int threads;                    // Workers including the calling thread
+    platform_thread_t* handles;     // threads - 1 helper threads
+    worker_pool_queue_t* queues;    // One per worker
+
+    platform_mutex_t mutex;
+    platform_cond_t wake;           // New run or shutdown
+    platform_cond_t idle;           // Last helper left the current run
+    platform_mutex_t run_mutex;     // One run at a time
+    unsigned long generation;       // Bumped for every run
+    int busy;                       // Helpers still inside the current run
+    int shutdown;
+
+    worker_pool_task_fn fn;
+    void* context;
+    platform_atomic_t failed;
+    platform_atomic_t started;      // Helpers that have taken a worker index
+
+    // Statistics (cumulative)
+    platform_atomic_t steals;       // Tasks run by a worker other than their owner
+    long runs;
+} worker_pool_t;
+
+// Lifecycle. threads <= 0 picks one worker per CPU; 1 runs everything on the caller.
+// The pool must not move in memory while its workers are running.
+int worker_pool_init(worker_pool_t* pool, int threads);
+void worker_pool_cleanup(worker_pool_t* pool);
+
+// Run tasks [0, task_count) and wait for all of them
+int worker_pool_run(worker_pool_t* pool, int task_count, worker_pool_task_fn fn, void* context);
+
+// Worker count, or 1 for a NULL pool (callers may treat NULL as "no pool")
+int worker_pool_threads(const worker_pool_t* pool);
+
+// Slice count for splitting `units` of work: a few per worker for stealing to
+// balance, but never fewer than `min_units` per slice
+int worker_pool_slices(const worker_pool_t* pool, int units, int min_units);
+
+#endif // WORKER_POOL_H
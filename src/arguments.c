@@ -1,4 +1,5 @@
 #include "arguments.h"
+#include "worker_pool.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,10 +17,35 @@ void arguments_print_usage(const char* program_name) {
     printf("  -s, --system           Enable system audio capture (Disabled - MVP)\n");
     printf("  -m, --microphone       Enable microphone capture (Disabled - MVP)\n");
 #endif
-    printf("  --fps <rate>           Frame rate (default: 30)\n");
-    printf("  --monitor <index>      Monitor index to capture (default: 0)\n");
+    printf("  --fps <rate>           Frame rate, up to 240 (default: 30)\n");
+    printf("  --monitor <index|all>  Monitor index to capture, or all for the whole desktop (default: 0)\n");
     printf("  --cursor [on|off]      Include cursor in capture (default: on)\n");
     printf("  --region x y w h       Capture specific region (default: full screen)\n");
+    printf("  --scale <factor>       Downscale before encoding, e.g. 0.5 (default: 1)\n");
+    printf("  --output-size <WxH>    Encode at this size; 0 for one side keeps the aspect ratio\n");
+    printf("  --pixel-format <fmt>   Encoder input: nv12 or bgra (default: nv12)\n");
+    printf("  --color-matrix <m>     NV12 matrix: bt709 or bt601 (default: bt709)\n");
+    printf("  --color-range <r>      NV12 range: limited or full (default: limited)\n");
+    printf("  --threads <n>          Threads for scaling and colour conversion (default: one per CPU)\n");
+    printf("  --audio-buffer <ms>    Audio device buffer, 3-500 ms; lower is lower latency (default: 50)\n");
+    printf("  --vfr                  Variable frame rate: real capture times, no samples for unchanged frames\n");
+    printf("  --fragmented on|off    Fragmented MP4: playable while recording and after a crash (default: on)\n");
+    printf("  --segment-time <sec>   Roll over to a new file (name-001.mp4, -002, ...) every this many seconds\n");
+    printf("  --segment-size <MB>    Roll over to a new file once the current one reaches this size\n");
+    printf("  --replay-buffer <sec>  Keep the last seconds in memory only; Ctrl+Break saves them to\n");
+    printf("                         name-replay-001.mp4, -002, ... (needs --encoder h264 or x264; no audio)\n");
+    printf("  --replay-budget <MB>   Memory the replay buffer may hold (default: 512)\n");
+    printf("  --spool                Write frames to a capture spool (.spool) and encode later; no audio\n");
+    printf("  --encoder <name>       mf (Media Foundation, default), h264 (software), x264 (if built), raw (.raw\n");
+    printf("                         frame file), spool or null (discard: capture ceiling); all but mf record no audio\n");
+    printf("  --change-detect on|off Skip captured frames identical to the previous one (default: on)\n");
+    printf("  --synthetic <pattern>  Capture a generated pattern: blocks, text or noise (no desktop needed)\n");
+    printf("  --source-size <WxH>    Synthetic pattern size (default: 1920x1080)\n");
+    printf("  --replay <file>        Capture frames from a raw frame file instead of the desktop\n");
+    printf("  --replay-loop          Restart the replay file at its end instead of stopping\n");
+    printf("  --repair <in> [out]    Rebuild a playable file from a recording cut short (default out: <in>-repaired.mp4)\n");
+    printf("  --transcode <in> [out] Encode a spool or raw frame file to MP4 offline (--scale, --output-size,\n");
+    printf("                         --threads, --fps, --color-*, --encoder h264|x264|null, --follow while still recording)\n");
     printf("  -h, --help             Show this help message\n");
     printf("Notes:\n");
 #ifdef MUXSW_ENABLE_AUDIO
@@ -85,8 +111,8 @@ int arguments_parse(int argc, char* argv[], capture_params_t* params) {
         else if (strcmp(argv[i], "--fps") == 0) {
             if (i + 1 < argc) {
                 params->fps = atoi(argv[++i]);
-                if (params->fps <= 0 || params->fps > 120) {
-                    fprintf(stderr, "Error: FPS must be between 1 and 120\n");
+                if (params->fps <= 0 || params->fps > CAPTURE_MAX_FPS) {
+                    fprintf(stderr, "Error: FPS must be between 1 and %d\n", CAPTURE_MAX_FPS);
                     return -1;
                 }
             } else {
@@ -96,13 +122,18 @@ int arguments_parse(int argc, char* argv[], capture_params_t* params) {
         }
         else if (strcmp(argv[i], "--monitor") == 0) {
             if (i + 1 < argc) {
-                params->monitor_index = atoi(argv[++i]);
-                if (params->monitor_index < 0) {
-                    fprintf(stderr, "Error: Monitor index must be >= 0\n");
-                    return -1;
+                const char* monitor_opt = argv[++i];
+                if (strcmp(monitor_opt, "all") == 0) {
+                    params->virtual_desktop = TRUE;
+                } else {
+                    params->monitor_index = atoi(monitor_opt);
+                    if (params->monitor_index < 0) {
+                        fprintf(stderr, "Error: Monitor index must be >= 0\n");
+                        return -1;
+                    }
                 }
             } else {
-                fprintf(stderr, "Error: --monitor requires an index\n");
+                fprintf(stderr, "Error: --monitor requires an index or all\n");
                 return -1;
             }
         }
@@ -122,6 +153,240 @@ int arguments_parse(int argc, char* argv[], capture_params_t* params) {
                 return -1;
             }
         }
+        else if (strcmp(argv[i], "--scale") == 0) {
+            if (i + 1 < argc) {
+                params->output_scale = atof(argv[++i]);
+                if (params->output_scale <= 0.0 || params->output_scale > 1.0) {
+                    fprintf(stderr, "Error: Scale must be greater than 0 and at most 1\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --scale requires a factor\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--output-size") == 0) {
+            if (i + 1 < argc) {
+                if (sscanf(argv[++i], "%dx%d", &params->output_width, &params->output_height) != 2 ||
+                    params->output_width < 0 || params->output_height < 0 ||
+                    (params->output_width == 0 && params->output_height == 0)) {
+                    fprintf(stderr, "Error: --output-size expects WIDTHxHEIGHT, e.g. 1920x1080\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --output-size requires WIDTHxHEIGHT\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--pixel-format") == 0) {
+            if (i + 1 < argc) {
+                const char* format = argv[++i];
+                if (strcmp(format, "nv12") == 0) {
+                    params->encode_nv12 = TRUE;
+                } else if (strcmp(format, "bgra") == 0) {
+                    params->encode_nv12 = FALSE;
+                } else {
+                    fprintf(stderr, "Error: Invalid pixel format '%s'. Use nv12 or bgra\n", format);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --pixel-format requires 'nv12' or 'bgra'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--color-matrix") == 0) {
+            if (i + 1 < argc) {
+                const char* matrix = argv[++i];
+                if (strcmp(matrix, "bt709") == 0) {
+                    params->color_matrix = COLOR_MATRIX_BT709;
+                } else if (strcmp(matrix, "bt601") == 0) {
+                    params->color_matrix = COLOR_MATRIX_BT601;
+                } else {
+                    fprintf(stderr, "Error: Invalid color matrix '%s'. Use bt709 or bt601\n", matrix);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --color-matrix requires 'bt709' or 'bt601'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--color-range") == 0) {
+            if (i + 1 < argc) {
+                const char* range = argv[++i];
+                if (strcmp(range, "limited") == 0) {
+                    params->color_range = COLOR_RANGE_LIMITED;
+                } else if (strcmp(range, "full") == 0) {
+                    params->color_range = COLOR_RANGE_FULL;
+                } else {
+                    fprintf(stderr, "Error: Invalid color range '%s'. Use limited or full\n", range);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --color-range requires 'limited' or 'full'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            if (i + 1 < argc) {
+                params->worker_threads = atoi(argv[++i]);
+                if (params->worker_threads < 1 || params->worker_threads > WORKER_POOL_MAX_THREADS) {
+                    fprintf(stderr, "Error: Threads must be between 1 and %d\n", WORKER_POOL_MAX_THREADS);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --threads requires a count\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--audio-buffer") == 0) {
+            if (i + 1 < argc) {
+                params->audio_buffer_ms = atoi(argv[++i]);
+                if (params->audio_buffer_ms < 3 || params->audio_buffer_ms > 500) {
+                    fprintf(stderr, "Error: Audio buffer must be between 3 and 500 ms\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --audio-buffer requires a length in milliseconds\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--vfr") == 0) {
+            params->variable_frame_rate = TRUE;
+        }
+        else if (strcmp(argv[i], "--fragmented") == 0) {
+            if (i + 1 < argc) {
+                const char* mode = argv[++i];
+                if (strcmp(mode, "on") == 0) {
+                    params->fragmented_output = TRUE;
+                } else if (strcmp(mode, "off") == 0) {
+                    params->fragmented_output = FALSE;
+                } else {
+                    fprintf(stderr, "Error: Invalid fragmented mode '%s'. Use on or off\n", mode);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --fragmented requires 'on' or 'off'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--segment-time") == 0) {
+            if (i + 1 < argc) {
+                params->segment_time = atoi(argv[++i]);
+                if (params->segment_time <= 0) {
+                    fprintf(stderr, "Error: Segment time must be a positive number of seconds\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --segment-time requires a length in seconds\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--segment-size") == 0) {
+            if (i + 1 < argc) {
+                int megabytes = atoi(argv[++i]);
+                if (megabytes <= 0) {
+                    fprintf(stderr, "Error: Segment size must be a positive number of megabytes\n");
+                    return -1;
+                }
+                params->segment_size = (ULONGLONG)megabytes * 1024 * 1024;
+            } else {
+                fprintf(stderr, "Error: --segment-size requires a size in megabytes\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--replay-buffer") == 0) {
+            if (i + 1 < argc) {
+                params->replay_seconds = atoi(argv[++i]);
+                if (params->replay_seconds <= 0) {
+                    fprintf(stderr, "Error: Replay buffer length must be a positive number of seconds\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --replay-buffer requires a length in seconds\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--replay-budget") == 0) {
+            if (i + 1 < argc) {
+                params->replay_budget_mb = atoi(argv[++i]);
+                if (params->replay_budget_mb <= 0) {
+                    fprintf(stderr, "Error: Replay budget must be a positive number of megabytes\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --replay-budget requires a size in megabytes\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--spool") == 0) {
+            params->spool_output = TRUE;
+        }
+        else if (strcmp(argv[i], "--encoder") == 0) {
+            if (i + 1 < argc) {
+                const char* name = argv[++i];
+                if (encoder_backend_parse(name, &params->encoder_backend) != 0) {
+                    fprintf(stderr, "Error: Invalid encoder '%s'. Use mf, h264, x264, raw, spool or null\n", name);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --encoder requires mf, h264, x264, raw, spool or null\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--change-detect") == 0) {
+            if (i + 1 < argc) {
+                const char* mode = argv[++i];
+                if (strcmp(mode, "on") == 0) {
+                    params->change_detection = TRUE;
+                } else if (strcmp(mode, "off") == 0) {
+                    params->change_detection = FALSE;
+                } else {
+                    fprintf(stderr, "Error: Invalid change detection mode '%s'. Use on or off\n", mode);
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --change-detect requires 'on' or 'off'\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--synthetic") == 0) {
+            if (i + 1 < argc) {
+                const char* pattern = argv[++i];
+                if (synthetic_pattern_parse(pattern, &params->synthetic_pattern) != 0) {
+                    fprintf(stderr, "Error: Invalid synthetic pattern '%s'. Use blocks, text or noise\n", pattern);
+                    return -1;
+                }
+                params->capture_source = CAPTURE_SOURCE_SYNTHETIC;
+            } else {
+                fprintf(stderr, "Error: --synthetic requires blocks, text or noise\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--source-size") == 0) {
+            if (i + 1 < argc) {
+                if (sscanf(argv[++i], "%dx%d", &params->source_width, &params->source_height) != 2 ||
+                    params->source_width <= 0 || params->source_height <= 0) {
+                    fprintf(stderr, "Error: --source-size expects WIDTHxHEIGHT, e.g. 1920x1080\n");
+                    return -1;
+                }
+            } else {
+                fprintf(stderr, "Error: --source-size requires WIDTHxHEIGHT\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--replay") == 0) {
+            if (i + 1 < argc) {
+                strncpy(params->replay_filename, argv[++i], sizeof(params->replay_filename) - 1);
+                params->replay_filename[sizeof(params->replay_filename) - 1] = '\0';
+                params->capture_source = CAPTURE_SOURCE_REPLAY;
+            } else {
+                fprintf(stderr, "Error: --replay requires a file\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--replay-loop") == 0) {
+            params->replay_loop = TRUE;
+        }
         else if (strcmp(argv[i], "--region") == 0) {
             if (i + 4 < argc) {
                 params->region_x = atoi(argv[++i]);
@@ -0,0 +1,181 @@
+#include "audio_capture.h"
+#include <stdio.h>
+#include <string.h>
+
+#define AUDIO_CAPTURE_MIN_WAIT_MS 10
+
+int audio_capture_init(audio_capture_t* capture, const char* name, audio_source_t* source, unsigned int queue_depth) {
+    if (!capture) return -1;
+    memset(capture, 0, sizeof(audio_capture_t));
+    if (!source || !source->ops || source->sample_rate <= 0 || source->block_align <= 0) return -1;
+    if (queue_depth == 0) queue_depth = AUDIO_CAPTURE_DEFAULT_DEPTH;
+
+    capture->name = name ? name : audio_source_name(source);
+    capture->source = source;
+    capture->packet_frames = (uint32_t)((uint64_t)source->sample_rate * AUDIO_CAPTURE_PACKET_MS / 1000);
+    if (capture->packet_frames == 0) capture->packet_frames = 1;
+
+    // Twice the device period: a missed signal costs one extra period, not a stall
+    capture->wait_ms = source->period_ms * 2;
+    if (capture->wait_ms < AUDIO_CAPTURE_MIN_WAIT_MS) capture->wait_ms = AUDIO_CAPTURE_MIN_WAIT_MS;
+
+    if (spsc_ring_init(&capture->queue, capture->name, queue_depth, sizeof(audio_packet_t)) != 0) return -1;
+    // One packet more than the ring holds: the consumer may still be writing one out
+    if (frame_pool_init(&capture->pool, (size_t)capture->packet_frames * source->block_align, (int)capture->queue.capacity + 1) != 0) {
+        spsc_ring_cleanup(&capture->queue);
+        return -1;
+    }
+    return 0;
+}
+
+void audio_capture_set_notify(audio_capture_t* capture, audio_capture_notify_fn notify, void* context) {
+    if (!capture || capture->started) return;
+    capture->notify = notify;
+    capture->notify_context = context;
+}
+
+// Copy everything the device has ready; returns -1 on a source error
+static int audio_capture_drain(audio_capture_t* capture) {
+    audio_source_t* source = capture->source;
+    size_t block_align = (size_t)source->block_align;
+    int queued = 0;
+    int result = 0;
+
+    for (;;) {
+        const uint8_t* data = NULL;
+        uint32_t frames = 0;
+        if (audio_source_get_buffer(source, &data, &frames) != 0) {
+            result = -1;
+            break;
+        }
+        if (frames == 0) break;
+
+        uint32_t remaining = frames;
+        while (remaining > 0) {
+            audio_packet_t packet;
+            packet.frames = remaining < capture->packet_frames ? remaining : capture->packet_frames;
+            packet.position = capture->position;
+            packet.packet = frame_pool_acquire(&capture->pool);
+            if (packet.packet == FRAME_HANDLE_INVALID) break;
+
+            memcpy(frame_pool_data(&capture->pool, packet.packet), data, packet.frames * block_align);
+            if (spsc_ring_push(&capture->queue, &packet) != 0) {
+                frame_pool_release(&capture->pool, packet.packet);
+                break;
+            }
+            data += packet.frames * block_align;
+            remaining -= packet.frames;
+            capture->position += packet.frames;
+            capture->stats.packets++;
+            capture->stats.frames += packet.frames;
+            queued = 1;
+        }
+        // The consumer is behind: the rest of this buffer is lost, but the device is not held
+        capture->stats.dropped_frames += remaining;
+        capture->position += remaining;
+
+        audio_source_release_buffer(source, frames);
+    }
+
+    if (queued && capture->notify) capture->notify(capture->notify_context);
+    return result;
+}
+
+static void audio_capture_thread(void* arg) {
+    audio_capture_t* capture = (audio_capture_t*)arg;
+    audio_source_thread_init(capture->source);
+
+    while (!platform_atomic_load(&capture->stopping)) {
+        int result = audio_source_wait(capture->source, capture->wait_ms);
+        if (result == AUDIO_WAIT_READY) {
+            capture->stats.wakes++;
+        } else if (result == AUDIO_WAIT_TIMEOUT) {
+            capture->stats.timeouts++;
+        }
+        if (result < 0 || audio_capture_drain(capture) != 0) {
+            capture->stats.errors++;
+            if (++capture->consecutive_errors > AUDIO_CAPTURE_MAX_ERRORS) {
+                fprintf(stderr, "Audio capture %s: too many source errors, giving up\n", capture->name);
+                platform_atomic_store(&capture->failed, 1);
+                break;
+            }
+            if (result < 0) platform_sleep_ms(capture->wait_ms);
+            continue;
+        }
+        capture->consecutive_errors = 0;
+    }
+
+    // Keep what the device captured up to the stop
+    if (!platform_atomic_load(&capture->failed)) audio_capture_drain(capture);
+    audio_source_thread_exit(capture->source);
+}
+
+int audio_capture_start(audio_capture_t* capture) {
+    if (!capture || !capture->source || capture->started) return -1;
+
+    platform_atomic_store(&capture->stopping, 0);
+    platform_atomic_store(&capture->failed, 0);
+    if (audio_source_start(capture->source) != 0) return -1;
+    if (platform_thread_create(&capture->thread, audio_capture_thread, capture) != 0) {
+        audio_source_stop(capture->source);
+        return -1;
+    }
+    capture->started = 1;
+    return 0;
+}
+
+void audio_capture_stop(audio_capture_t* capture) {
+    if (!capture || !capture->started) return;
+    platform_atomic_store(&capture->stopping, 1);
+    platform_thread_join(capture->thread);
+    capture->started = 0;
+    audio_source_stop(capture->source);
+}
+
+int audio_capture_failed(audio_capture_t* capture) {
+    return capture ? (int)platform_atomic_load(&capture->failed) : 1;
+}
+
+int audio_capture_pop(audio_capture_t* capture, audio_packet_t* packet) {
+    if (!capture || !capture->queue.slots || !packet) return -1;
+    return spsc_ring_pop(&capture->queue, packet);
+}
+
+const uint8_t* audio_capture_packet_data(audio_capture_t* capture, const audio_packet_t* packet) {
+    if (!capture || !packet) return NULL;
+    return (const uint8_t*)frame_pool_data(&capture->pool, packet->packet);
+}
+
+void audio_capture_release(audio_capture_t* capture, const audio_packet_t* packet) {
+    if (!capture || !packet) return;
+    frame_pool_release(&capture->pool, packet->packet);
+}
+
+void audio_capture_get_stats(audio_capture_t* capture, audio_capture_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(audio_capture_stats_t));
+    if (capture) *stats = capture->stats;
+}
+
+void audio_capture_report(audio_capture_t* capture, audio_capture_report_fn report) {
+    if (!capture || !capture->source || !report) return;
+    char message[192];
+    snprintf(message, sizeof(message), "Audio %s: %llu packets, %llu frames, %llu device wakes, %llu timeouts, %llu frames dropped",
+             capture->name, (unsigned long long)capture->stats.packets, (unsigned long long)capture->stats.frames,
+             (unsigned long long)capture->stats.wakes, (unsigned long long)capture->stats.timeouts,
+             (unsigned long long)capture->stats.dropped_frames);
+    report(message);
+}
+
+void audio_capture_cleanup(audio_capture_t* capture) {
+    if (!capture) return;
+    audio_capture_stop(capture);
+
+    audio_packet_t packet;
+    while (audio_capture_pop(capture, &packet) == 0) {
+        audio_capture_release(capture, &packet);
+    }
+    spsc_ring_cleanup(&capture->queue);
+    frame_pool_cleanup(&capture->pool);
+    memset(capture, 0, sizeof(audio_capture_t));
+}
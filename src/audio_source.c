@@ -0,0 +1,46 @@
+#include "audio_source.h"
+#include <string.h>
+
+int audio_source_start(audio_source_t* source) {
+    if (!source || !source->ops) return -1;
+    return source->ops->start ? source->ops->start(source) : 0;
+}
+
+int audio_source_wait(audio_source_t* source, unsigned int timeout_ms) {
+    if (!source || !source->ops || !source->ops->wait) return -1;
+    return source->ops->wait(source, timeout_ms);
+}
+
+int audio_source_get_buffer(audio_source_t* source, const uint8_t** data, uint32_t* frames) {
+    if (!data || !frames) return -1;
+    *data = NULL;
+    *frames = 0;
+    if (!source || !source->ops || !source->ops->get_buffer) return -1;
+    return source->ops->get_buffer(source, data, frames);
+}
+
+void audio_source_release_buffer(audio_source_t* source, uint32_t frames) {
+    if (source && source->ops && source->ops->release_buffer) source->ops->release_buffer(source, frames);
+}
+
+void audio_source_stop(audio_source_t* source) {
+    if (source && source->ops && source->ops->stop) source->ops->stop(source);
+}
+
+void audio_source_thread_init(audio_source_t* source) {
+    if (source && source->ops && source->ops->thread_init) source->ops->thread_init(source);
+}
+
+void audio_source_thread_exit(audio_source_t* source) {
+    if (source && source->ops && source->ops->thread_exit) source->ops->thread_exit(source);
+}
+
+void audio_source_destroy(audio_source_t* source) {
+    if (!source) return;
+    if (source->ops && source->ops->destroy) source->ops->destroy(source);
+    memset(source, 0, sizeof(audio_source_t));
+}
+
+const char* audio_source_name(const audio_source_t* source) {
+    return source && source->ops ? source->ops->name : "none";
+}
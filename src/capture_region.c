@@ -0,0 +1,91 @@
+#include "capture_region.h"
+#include <stdio.h>
+
+void capture_region_full(capture_region_t* region, int desktop_width, int desktop_height) {
+    if (!region) return;
+    region->x = 0;
+    region->y = 0;
+    region->width = desktop_width;
+    region->height = desktop_height;
+}
+
+int capture_region_resolve(capture_region_t* region, int desktop_width, int desktop_height) {
+    if (!region || desktop_width <= 0 || desktop_height <= 0) return -1;
+
+    frame_rect_t rect = { region->x, region->y, region->x + region->width, region->y + region->height };
+    if (region->width <= 0 || region->height <= 0 || !frame_rect_clip(&rect, desktop_width, desktop_height)) {
+        fprintf(stderr, "Capture region %d,%d %dx%d lies outside the %dx%d desktop\n",
+                region->x, region->y, region->width, region->height, desktop_width, desktop_height);
+        return -1;
+    }
+
+    int width = (rect.right - rect.left) & ~(CAPTURE_REGION_ALIGNMENT - 1);
+    int height = (rect.bottom - rect.top) & ~(CAPTURE_REGION_ALIGNMENT - 1);
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "Capture region %d,%d %dx%d is too small to encode\n",
+                region->x, region->y, region->width, region->height);
+        return -1;
+    }
+
+    region->x = rect.left;
+    region->y = rect.top;
+    region->width = width;
+    region->height = height;
+    return 0;
+}
+
+int capture_region_is_full(const capture_region_t* region, int desktop_width, int desktop_height) {
+    return region && region->x == 0 && region->y == 0 &&
+           region->width == desktop_width && region->height == desktop_height;
+}
+
+// Intersect a desktop rect with the region and shift it to region coordinates
+static int region_local_rect(const capture_region_t* region, const frame_rect_t* desktop, frame_rect_t* local) {
+    local->left = desktop->left - region->x;
+    local->top = desktop->top - region->y;
+    local->right = desktop->right - region->x;
+    local->bottom = desktop->bottom - region->y;
+    return frame_rect_clip(local, region->width, region->height);
+}
+
+void capture_region_map_updates(const capture_region_t* region,
+                                const frame_move_t* moves, int move_count,
+                                const frame_rect_t* dirty, int dirty_count,
+                                frame_move_t* moves_out, int* moves_out_count,
+                                frame_rect_t* dirty_out, int* dirty_out_count) {
+    int move_total = 0;
+    int dirty_total = 0;
+
+    if (region) {
+        for (int i = 0; i < move_count; i++) {
+            frame_rect_t dest;
+            if (!region_local_rect(region, &moves[i].destination, &dest)) continue;
+
+            // Source of the part of the move that lands inside the region
+            int source_left = moves[i].source_x + dest.left - moves[i].destination.left;
+            int source_top = moves[i].source_y + dest.top - moves[i].destination.top;
+            int source_right = source_left + (dest.right - dest.left);
+            int source_bottom = source_top + (dest.bottom - dest.top);
+
+            if (source_left >= 0 && source_top >= 0 && source_right <= region->width && source_bottom <= region->height) {
+                moves_out[move_total].source_x = source_left;
+                moves_out[move_total].source_y = source_top;
+                moves_out[move_total].destination = dest;
+                move_total++;
+            } else {
+                // Content scrolled in from outside the region has to be read back
+                dirty_out[dirty_total++] = dest;
+            }
+        }
+
+        for (int i = 0; i < dirty_count; i++) {
+            frame_rect_t local;
+            if (region_local_rect(region, &dirty[i], &local)) {
+                dirty_out[dirty_total++] = local;
+            }
+        }
+    }
+
+    if (moves_out_count) *moves_out_count = move_total;
+    if (dirty_out_count) *dirty_out_count = dirty_total;
+}
@@ -0,0 +1,43 @@
+#include "capture_source.h"
+#include <string.h>
+
+int capture_source_set_pool(capture_source_t* source, frame_pool_t* pool) {
+    if (!source || !source->ops || !pool) return -1;
+    if (frame_pool_frame_size(pool) < (size_t)source->width * source->height * 4) return -1;
+
+    source->pool = pool;
+    return source->ops->set_pool ? source->ops->set_pool(source, pool) : 0;
+}
+
+int capture_source_start(capture_source_t* source) {
+    if (!source || !source->ops || !source->pool) return -1;
+    return source->ops->start ? source->ops->start(source) : 0;
+}
+
+int capture_source_get_frame(capture_source_t* source, frame_handle_t* frame, int top_down) {
+    if (!frame) return -1;
+    *frame = FRAME_HANDLE_INVALID;
+    if (!source || !source->ops || !source->pool) return -1;
+
+    int result = source->ops->get_frame(source, frame, top_down);
+    if (result == CAPTURE_FRAME_NEW) source->frames_delivered++;
+    return result;
+}
+
+void capture_source_stop(capture_source_t* source) {
+    if (source && source->ops && source->ops->stop) source->ops->stop(source);
+}
+
+void capture_source_report(capture_source_t* source, capture_report_fn report) {
+    if (source && source->ops && source->ops->report && report) source->ops->report(source, report);
+}
+
+void capture_source_destroy(capture_source_t* source) {
+    if (!source) return;
+    if (source->ops && source->ops->destroy) source->ops->destroy(source);
+    memset(source, 0, sizeof(capture_source_t));
+}
+
+const char* capture_source_name(const capture_source_t* source) {
+    return source && source->ops ? source->ops->name : "none";
+}
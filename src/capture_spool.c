@@ -0,0 +1,486 @@
+#include "capture_spool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPOOL_RECORD_HEADER 8
+#define SPOOL_TILE_HEADER 24            // Record header, hash, size, reserved
+#define SPOOL_FRAME_HEADER 24           // Record header, time, count, reserved
+#define SPOOL_MAP_MIN ((size_t)16 << 20)
+#define SPOOL_NO_TILE 0xFFFFFFFFu
+
+static void spool_put_u16(uint8_t* dst, uint16_t value) {
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+}
+
+static void spool_put_u32(uint8_t* dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) dst[i] = (uint8_t)(value >> (i * 8));
+}
+
+static void spool_put_u64(uint8_t* dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) dst[i] = (uint8_t)(value >> (i * 8));
+}
+
+static uint16_t spool_get_u16(const uint8_t* src) {
+    return (uint16_t)(src[0] | src[1] << 8);
+}
+
+static uint32_t spool_get_u32(const uint8_t* src) {
+    return (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static uint64_t spool_get_u64(const uint8_t* src) {
+    return (uint64_t)spool_get_u32(src) | (uint64_t)spool_get_u32(src + 4) << 32;
+}
+
+// The header counts a reader may be polling: one aligned store or load on
+// the little-endian hosts this runs on, so they are never seen half written
+static void spool_store_count(uint8_t* dst, uint64_t value) {
+    *(volatile uint64_t*)dst = value;
+}
+
+static uint64_t spool_load_count(const uint8_t* src) {
+    return *(const volatile uint64_t*)src;
+}
+
+static size_t spool_align(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+// Pixel size of the tile at a position
+static void spool_tile_size(int width, int height, int tiles_x, int position, int* tile_width, int* tile_height) {
+    int x = (position % tiles_x) * CAPTURE_SPOOL_TILE;
+    int y = (position / tiles_x) * CAPTURE_SPOOL_TILE;
+    *tile_width = width - x < CAPTURE_SPOOL_TILE ? width - x : CAPTURE_SPOOL_TILE;
+    *tile_height = height - y < CAPTURE_SPOOL_TILE ? height - y : CAPTURE_SPOOL_TILE;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+// Bytes a frame can add at most: every tile new, and a pair for each
+static size_t spool_frame_bound(const capture_spool_writer_t* writer) {
+    size_t positions = (size_t)writer->tiles_x * writer->tiles_y;
+    return positions * (SPOOL_TILE_HEADER + 8) + (size_t)writer->width * writer->height * 4 + SPOOL_FRAME_HEADER;
+}
+
+// Room in the file, the tile index and the table for one more frame, so
+// appending it cannot fail halfway
+static int spool_reserve(capture_spool_writer_t* writer) {
+    size_t bound = spool_frame_bound(writer);
+    if (writer->used + bound > writer->map.size) {
+        size_t size = writer->map.size + writer->map.size / 2;
+        if (size < writer->used + 2 * bound) size = writer->used + 2 * bound;
+        if (platform_map_resize(&writer->map, size) != 0) {
+            fprintf(stderr, "Spool: Failed to grow the file to %zu MB\n", size >> 20);
+            return -1;
+        }
+        writer->stats.remaps++;
+    }
+
+    uint32_t positions = (uint32_t)(writer->tiles_x * writer->tiles_y);
+    if (writer->tile_count > UINT32_MAX / 4 - positions) {
+        fprintf(stderr, "Spool: Too many distinct tiles\n");
+        return -1;
+    }
+    uint32_t needed = writer->tile_count + positions;
+    if (needed > writer->tile_capacity) {
+        uint32_t capacity = writer->tile_capacity * 2;
+        if (capacity < needed) capacity = needed;
+        uint64_t* hashes = (uint64_t*)realloc(writer->tile_hashes, capacity * sizeof(uint64_t));
+        if (hashes) writer->tile_hashes = hashes;
+        uint64_t* offsets = (uint64_t*)realloc(writer->tile_offsets, capacity * sizeof(uint64_t));
+        if (offsets) writer->tile_offsets = offsets;
+        if (!hashes || !offsets) return -1;
+        writer->tile_capacity = capacity;
+    }
+    if (needed * 2 > writer->table_size) {
+        uint32_t size = writer->table_size;
+        while (needed * 2 > size) size *= 2;
+        uint32_t* table = (uint32_t*)calloc(size, sizeof(uint32_t));
+        if (!table) return -1;
+        for (uint32_t tile = 0; tile < writer->tile_count; tile++) {
+            uint32_t slot = (uint32_t)writer->tile_hashes[tile] & (size - 1);
+            while (table[slot]) slot = (slot + 1) & (size - 1);
+            table[slot] = tile + 1;
+        }
+        free(writer->table);
+        writer->table = table;
+        writer->table_size = size;
+    }
+    return 0;
+}
+
+// A stored tile with these pixels, or SPOOL_NO_TILE. The hash only finds
+// candidates; the pixels decide.
+static uint32_t spool_find_tile(const capture_spool_writer_t* writer, uint64_t hash, const uint8_t* pixels, size_t pitch,
+                                int width, int height, uint32_t* slot) {
+    uint32_t mask = writer->table_size - 1;
+    size_t row_bytes = (size_t)width * 4;
+    for (*slot = (uint32_t)hash & mask; writer->table[*slot]; *slot = (*slot + 1) & mask) {
+        uint32_t tile = writer->table[*slot] - 1;
+        if (writer->tile_hashes[tile] != hash) continue;
+        const uint8_t* record = writer->map.data + writer->tile_offsets[tile];
+        if (spool_get_u16(record + 16) != width || spool_get_u16(record + 18) != height) continue;
+        const uint8_t* stored = record + SPOOL_TILE_HEADER;
+        int y = 0;
+        while (y < height && memcmp(stored + (size_t)y * row_bytes, pixels + (size_t)y * pitch, row_bytes) == 0) y++;
+        if (y == height) return tile;
+    }
+    return SPOOL_NO_TILE;
+}
+
+static uint32_t spool_store_tile(capture_spool_writer_t* writer, size_t* offset, uint64_t hash, const uint8_t* pixels,
+                                 size_t pitch, int width, int height, uint32_t slot) {
+    size_t row_bytes = (size_t)width * 4;
+    size_t size = spool_align(SPOOL_TILE_HEADER + row_bytes * height);
+    uint8_t* record = writer->map.data + *offset;
+    spool_put_u32(record, CAPTURE_SPOOL_RECORD_TILE);
+    spool_put_u32(record + 4, (uint32_t)size);
+    spool_put_u64(record + 8, hash);
+    spool_put_u16(record + 16, (uint16_t)width);
+    spool_put_u16(record + 18, (uint16_t)height);
+    spool_put_u32(record + 20, 0);
+    for (int y = 0; y < height; y++) {
+        memcpy(record + SPOOL_TILE_HEADER + (size_t)y * row_bytes, pixels + (size_t)y * pitch, row_bytes);
+    }
+
+    uint32_t tile = writer->tile_count++;
+    writer->tile_hashes[tile] = hash;
+    writer->tile_offsets[tile] = *offset;
+    writer->table[slot] = tile + 1;
+    *offset += size;
+    writer->stats.tiles_stored++;
+    return tile;
+}
+
+// Write the frame record and move the header past it and the tiles before it
+static void spool_commit_frame(capture_spool_writer_t* writer, size_t offset, int64_t time, uint32_t count) {
+    uint8_t* record = writer->map.data + offset;
+    size_t size = SPOOL_FRAME_HEADER + (size_t)count * 8;
+    spool_put_u32(record, CAPTURE_SPOOL_RECORD_FRAME);
+    spool_put_u32(record + 4, (uint32_t)size);
+    spool_put_u64(record + 8, (uint64_t)time);
+    spool_put_u32(record + 16, count);
+    spool_put_u32(record + 20, 0);
+    for (uint32_t i = 0; i < count * 2; i++) spool_put_u32(record + SPOOL_FRAME_HEADER + i * 4, writer->pairs[i]);
+
+    writer->used = offset + size;
+    writer->stats.frames++;
+    writer->stats.tile_refs += count;
+    writer->stats.bytes = writer->used;
+    writer->stats.raw_bytes += (uint64_t)writer->width * writer->height * 4;
+    if (count == 0) writer->stats.repeats++;
+
+    // Readers following the file must see the records before the counts that cover them
+    platform_atomic_fence();
+    spool_store_count(writer->map.data + 40, writer->stats.frames);
+    spool_store_count(writer->map.data + 48, writer->tile_count);
+    spool_store_count(writer->map.data + 32, writer->used);
+}
+
+int capture_spool_writer_open(capture_spool_writer_t* writer, const char* path, int width, int height, int fps) {
+    if (!writer || !path) return -1;
+    memset(writer, 0, sizeof(capture_spool_writer_t));
+    if (width <= 0 || height <= 0 || width > CAPTURE_SPOOL_MAX_DIMENSION || height > CAPTURE_SPOOL_MAX_DIMENSION ||
+        fps < 0) {
+        fprintf(stderr, "Spool: Invalid frame size %dx%d\n", width, height);
+        return -1;
+    }
+    writer->width = width;
+    writer->height = height;
+    writer->fps = fps;
+    writer->tiles_x = (width + CAPTURE_SPOOL_TILE - 1) / CAPTURE_SPOOL_TILE;
+    writer->tiles_y = (height + CAPTURE_SPOOL_TILE - 1) / CAPTURE_SPOOL_TILE;
+    size_t positions = (size_t)writer->tiles_x * writer->tiles_y;
+
+    writer->current = (uint32_t*)malloc(positions * sizeof(uint32_t));
+    writer->pairs = (uint32_t*)malloc(positions * 2 * sizeof(uint32_t));
+    writer->table_size = 1024;
+    writer->table = (uint32_t*)calloc(writer->table_size, sizeof(uint32_t));
+    if (!writer->current || !writer->pairs || !writer->table ||
+        tile_hash_init(&writer->hash, width, height, CAPTURE_SPOOL_TILE) != 0) {
+        fprintf(stderr, "Spool: Out of memory\n");
+        capture_spool_writer_close(writer);
+        return -1;
+    }
+
+    size_t size = CAPTURE_SPOOL_HEADER_SIZE + 2 * spool_frame_bound(writer);
+    if (size < SPOOL_MAP_MIN) size = SPOOL_MAP_MIN;
+    if (platform_map_create(&writer->map, path, size) != 0) {
+        fprintf(stderr, "Spool: Failed to create %s\n", path);
+        capture_spool_writer_close(writer);
+        return -1;
+    }
+
+    uint8_t* header = writer->map.data;
+    memset(header, 0, CAPTURE_SPOOL_HEADER_SIZE);
+    memcpy(header, CAPTURE_SPOOL_MAGIC, 8);
+    spool_put_u32(header + 8, CAPTURE_SPOOL_VERSION);
+    spool_put_u32(header + 12, (uint32_t)width);
+    spool_put_u32(header + 16, (uint32_t)height);
+    spool_put_u32(header + 20, CAPTURE_SPOOL_TILE);
+    spool_put_u32(header + 24, (uint32_t)fps);
+    spool_put_u64(header + 32, CAPTURE_SPOOL_HEADER_SIZE);
+    writer->used = CAPTURE_SPOOL_HEADER_SIZE;
+    writer->stats.bytes = writer->used;
+    return 0;
+}
+
+int capture_spool_writer_append(capture_spool_writer_t* writer, const uint8_t* pixels, size_t pitch, int64_t time) {
+    if (!writer || !writer->map.data || !pixels || pitch < (size_t)writer->width * 4) return -1;
+    if (spool_reserve(writer) != 0) return -1;
+    if (tile_hash_update(&writer->hash, pixels, pitch) < 0) return -1;
+
+    size_t offset = writer->used;
+    uint32_t count = 0;
+    int positions = writer->tiles_x * writer->tiles_y;
+    for (int position = 0; position < positions; position++) {
+        if (!writer->hash.changed[position]) continue;
+        int width, height;
+        spool_tile_size(writer->width, writer->height, writer->tiles_x, position, &width, &height);
+        const uint8_t* src = pixels + (size_t)(position / writer->tiles_x) * CAPTURE_SPOOL_TILE * pitch +
+                             (size_t)(position % writer->tiles_x) * CAPTURE_SPOOL_TILE * 4;
+        uint64_t hash = writer->hash.hashes[position];
+        uint32_t slot;
+        uint32_t tile = spool_find_tile(writer, hash, src, pitch, width, height, &slot);
+        if (tile == SPOOL_NO_TILE) {
+            tile = spool_store_tile(writer, &offset, hash, src, pitch, width, height, slot);
+        } else {
+            writer->stats.tiles_reused++;
+        }
+        if (writer->has_frame && writer->current[position] == tile) continue;
+        writer->current[position] = tile;
+        writer->pairs[count * 2] = (uint32_t)position;
+        writer->pairs[count * 2 + 1] = tile;
+        count++;
+    }
+
+    spool_commit_frame(writer, offset, time, count);
+    writer->has_frame = 1;
+    return 0;
+}
+
+int capture_spool_writer_repeat(capture_spool_writer_t* writer, int64_t time) {
+    if (!writer || !writer->map.data || !writer->has_frame) return -1;
+    if (writer->used + SPOOL_FRAME_HEADER > writer->map.size && spool_reserve(writer) != 0) return -1;
+    spool_commit_frame(writer, writer->used, time, 0);
+    return 0;
+}
+
+int capture_spool_writer_close(capture_spool_writer_t* writer) {
+    if (!writer) return -1;
+    int result = 0;
+    if (writer->map.data) {
+        platform_atomic_fence();
+        spool_put_u32(writer->map.data + 28, CAPTURE_SPOOL_FLAG_COMPLETE);
+        if (platform_map_sync(&writer->map) != 0) {
+            fprintf(stderr, "Spool: Failed to flush the file\n");
+            result = -1;
+        }
+        platform_map_close(&writer->map, writer->used);
+    }
+    tile_hash_cleanup(&writer->hash);
+    free(writer->current);
+    free(writer->pairs);
+    free(writer->tile_hashes);
+    free(writer->tile_offsets);
+    free(writer->table);
+    capture_spool_stats_t stats = writer->stats;
+    memset(writer, 0, sizeof(capture_spool_writer_t));
+    writer->stats = stats;
+    return result;
+}
+
+void capture_spool_writer_report(const capture_spool_writer_t* writer, capture_spool_report_fn report) {
+    if (!writer || !report) return;
+    const capture_spool_stats_t* stats = &writer->stats;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Spool: %llu frames (%llu repeats), %llu tiles stored, %llu reused; %.1f MB for %.1f MB of frames (%.1f%%)",
+             (unsigned long long)stats->frames, (unsigned long long)stats->repeats,
+             (unsigned long long)stats->tiles_stored, (unsigned long long)stats->tiles_reused,
+             stats->bytes / 1048576.0, stats->raw_bytes / 1048576.0,
+             stats->raw_bytes ? 100.0 * stats->bytes / stats->raw_bytes : 0.0);
+    report(message);
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+// Pick up frames the writer committed since the last look
+static int spool_reader_refresh(capture_spool_reader_t* reader) {
+    if (reader->complete) return 0;
+    // The flag first: once it is set, the count read after it is final
+    int complete = (spool_get_u32(reader->map.data + 28) & CAPTURE_SPOOL_FLAG_COMPLETE) != 0;
+    platform_atomic_fence();
+    uint64_t committed = spool_load_count(reader->map.data + 32);
+    platform_atomic_fence();
+    if (committed > reader->map.size && platform_map_refresh(&reader->map) != 0) return -1;
+    if (committed < reader->committed || committed > reader->map.size) {
+        fprintf(stderr, "Spool: Header counts past the end of the file\n");
+        return -1;
+    }
+    reader->committed = (size_t)committed;
+    reader->complete = complete;
+    return 0;
+}
+
+static int spool_reader_add_tile(capture_spool_reader_t* reader, const uint8_t* record, size_t size) {
+    int width = size >= SPOOL_TILE_HEADER ? spool_get_u16(record + 16) : 0;
+    int height = size >= SPOOL_TILE_HEADER ? spool_get_u16(record + 18) : 0;
+    if (width == 0 || height == 0 || width > CAPTURE_SPOOL_TILE || height > CAPTURE_SPOOL_TILE ||
+        size < SPOOL_TILE_HEADER + (size_t)width * height * 4) {
+        fprintf(stderr, "Spool: Bad tile record\n");
+        return -1;
+    }
+    if (reader->tile_count == reader->tile_capacity) {
+        uint32_t capacity = reader->tile_capacity ? reader->tile_capacity * 2 : 1024;
+        uint64_t* offsets = (uint64_t*)realloc(reader->tile_offsets, capacity * sizeof(uint64_t));
+        if (!offsets) return -1;
+        reader->tile_offsets = offsets;
+        reader->tile_capacity = capacity;
+    }
+    reader->tile_offsets[reader->tile_count++] = reader->offset;
+    return 0;
+}
+
+static int spool_reader_apply_frame(capture_spool_reader_t* reader, const uint8_t* record, size_t size) {
+    uint32_t count = size >= SPOOL_FRAME_HEADER ? spool_get_u32(record + 16) : 0;
+    uint32_t positions = (uint32_t)(reader->tiles_x * reader->tiles_y);
+    if (size < SPOOL_FRAME_HEADER || count > positions || size < SPOOL_FRAME_HEADER + (size_t)count * 8) {
+        fprintf(stderr, "Spool: Bad frame record\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t position = spool_get_u32(record + SPOOL_FRAME_HEADER + i * 8);
+        uint32_t tile = spool_get_u32(record + SPOOL_FRAME_HEADER + i * 8 + 4);
+        if (position >= positions || tile >= reader->tile_count) {
+            fprintf(stderr, "Spool: Frame refers to a missing tile\n");
+            return -1;
+        }
+        int width, height;
+        spool_tile_size(reader->width, reader->height, reader->tiles_x, (int)position, &width, &height);
+        const uint8_t* stored = reader->map.data + reader->tile_offsets[tile];
+        if (spool_get_u16(stored + 16) != width || spool_get_u16(stored + 18) != height) {
+            fprintf(stderr, "Spool: Tile does not fit its position\n");
+            return -1;
+        }
+        reader->current[position] = tile;
+    }
+    if (!reader->has_frame) {
+        for (uint32_t position = 0; position < positions; position++) {
+            if (reader->current[position] == SPOOL_NO_TILE) {
+                fprintf(stderr, "Spool: First frame leaves tiles empty\n");
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void spool_reader_compose(const capture_spool_reader_t* reader, uint8_t* pixels, size_t pitch) {
+    int positions = reader->tiles_x * reader->tiles_y;
+    for (int position = 0; position < positions; position++) {
+        int width, height;
+        spool_tile_size(reader->width, reader->height, reader->tiles_x, position, &width, &height);
+        const uint8_t* src = reader->map.data + reader->tile_offsets[reader->current[position]] + SPOOL_TILE_HEADER;
+        uint8_t* dst = pixels + (size_t)(position / reader->tiles_x) * CAPTURE_SPOOL_TILE * pitch +
+                       (size_t)(position % reader->tiles_x) * CAPTURE_SPOOL_TILE * 4;
+        size_t row_bytes = (size_t)width * 4;
+        for (int y = 0; y < height; y++) memcpy(dst + (size_t)y * pitch, src + (size_t)y * row_bytes, row_bytes);
+    }
+}
+
+int capture_spool_reader_open(capture_spool_reader_t* reader, const char* path) {
+    if (!reader || !path) return -1;
+    memset(reader, 0, sizeof(capture_spool_reader_t));
+    if (platform_map_open(&reader->map, path) != 0) {
+        fprintf(stderr, "Spool: Cannot open %s\n", path);
+        return -1;
+    }
+
+    const uint8_t* header = reader->map.data;
+    uint32_t version = 0, width = 0, height = 0, tile = 0, fps = 0;
+    if (reader->map.size >= CAPTURE_SPOOL_HEADER_SIZE && memcmp(header, CAPTURE_SPOOL_MAGIC, 8) == 0) {
+        version = spool_get_u32(header + 8);
+        width = spool_get_u32(header + 12);
+        height = spool_get_u32(header + 16);
+        tile = spool_get_u32(header + 20);
+        fps = spool_get_u32(header + 24);
+    }
+    if (version != CAPTURE_SPOOL_VERSION || width == 0 || height == 0 || width > CAPTURE_SPOOL_MAX_DIMENSION ||
+        height > CAPTURE_SPOOL_MAX_DIMENSION || tile != CAPTURE_SPOOL_TILE || fps > 1000) {
+        fprintf(stderr, "Spool: %s is not a capture spool (version %u, %ux%u)\n", path, version, width, height);
+        capture_spool_reader_close(reader);
+        return -1;
+    }
+    reader->width = (int)width;
+    reader->height = (int)height;
+    reader->fps = (int)fps;
+    reader->tiles_x = (reader->width + CAPTURE_SPOOL_TILE - 1) / CAPTURE_SPOOL_TILE;
+    reader->tiles_y = (reader->height + CAPTURE_SPOOL_TILE - 1) / CAPTURE_SPOOL_TILE;
+    reader->offset = CAPTURE_SPOOL_HEADER_SIZE;
+    reader->committed = CAPTURE_SPOOL_HEADER_SIZE;
+
+    size_t positions = (size_t)reader->tiles_x * reader->tiles_y;
+    reader->current = (uint32_t*)malloc(positions * sizeof(uint32_t));
+    if (!reader->current || spool_reader_refresh(reader) != 0) {
+        capture_spool_reader_close(reader);
+        return -1;
+    }
+    memset(reader->current, 0xFF, positions * sizeof(uint32_t));
+    return 0;
+}
+
+int capture_spool_reader_next(capture_spool_reader_t* reader, uint8_t* pixels, size_t pitch,
+                              capture_spool_frame_t* frame) {
+    if (!reader || !reader->map.data || (pixels && pitch < (size_t)reader->width * 4)) return -1;
+    for (;;) {
+        if (reader->offset + SPOOL_RECORD_HEADER > reader->committed) {
+            if (spool_reader_refresh(reader) != 0) return -1;
+            if (reader->offset + SPOOL_RECORD_HEADER > reader->committed) return 0;
+        }
+
+        const uint8_t* record = reader->map.data + reader->offset;
+        uint32_t type = spool_get_u32(record);
+        size_t size = spool_get_u32(record + 4);
+        if (size < SPOOL_RECORD_HEADER || size % 8 != 0 || size > reader->committed - reader->offset) {
+            fprintf(stderr, "Spool: Bad record at offset %zu\n", reader->offset);
+            return -1;
+        }
+
+        if (type == CAPTURE_SPOOL_RECORD_TILE) {
+            if (spool_reader_add_tile(reader, record, size) != 0) return -1;
+        } else if (type == CAPTURE_SPOOL_RECORD_FRAME) {
+            if (spool_reader_apply_frame(reader, record, size) != 0) return -1;
+            if (pixels) spool_reader_compose(reader, pixels, pitch);
+            reader->offset += size;
+            reader->has_frame = 1;
+            reader->frames++;
+            if (frame) {
+                frame->time = (int64_t)spool_get_u64(record + 8);
+                frame->changed_tiles = spool_get_u32(record + 16);
+            }
+            return 1;
+        }
+        reader->offset += size;
+    }
+}
+
+int capture_spool_reader_compose(const capture_spool_reader_t* reader, uint8_t* pixels, size_t pitch) {
+    if (!reader || !reader->has_frame || !pixels || pitch < (size_t)reader->width * 4) return -1;
+    spool_reader_compose(reader, pixels, pitch);
+    return 0;
+}
+
+void capture_spool_reader_close(capture_spool_reader_t* reader) {
+    if (!reader) return;
+    platform_map_close(&reader->map, 0);
+    free(reader->tile_offsets);
+    free(reader->current);
+    memset(reader, 0, sizeof(capture_spool_reader_t));
+}
@@ -0,0 +1,390 @@
+#include "color_convert.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COLOR_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COLOR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COLOR_TARGET(isa)
+#endif
+
+#define COLOR_ONE (1 << COLOR_COEFF_BITS)
+
+// Luma rows per slice below which spreading over workers costs more than it saves
+#define COLOR_MIN_SLICE_ROWS 16
+
+// Chroma is computed from the sum of a 2x2 block, hence two extra bits of shift
+#define COLOR_CHROMA_SHIFT (COLOR_COEFF_BITS + 2)
+
+static uint8_t color_clamp_u8(int32_t value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+static int16_t color_fixed(double value) {
+    return (int16_t)(value >= 0.0 ? value * COLOR_ONE + 0.5 : value * COLOR_ONE - 0.5);
+}
+
+int color_converter_init(color_converter_t* converter, color_matrix_t matrix, color_range_t range) {
+    if (!converter) return -1;
+    if (matrix != COLOR_MATRIX_BT601 && matrix != COLOR_MATRIX_BT709) return -1;
+    if (range != COLOR_RANGE_LIMITED && range != COLOR_RANGE_FULL) return -1;
+
+    memset(converter, 0, sizeof(color_converter_t));
+    converter->matrix = matrix;
+    converter->range = range;
+    converter->level = copy_kernels_best_level();
+
+    double kr = matrix == COLOR_MATRIX_BT709 ? 0.2126 : 0.299;
+    double kb = matrix == COLOR_MATRIX_BT709 ? 0.0722 : 0.114;
+    double y_scale = range == COLOR_RANGE_LIMITED ? 219.0 / 255.0 : 1.0;
+    double c_scale = range == COLOR_RANGE_LIMITED ? 224.0 / 255.0 : 1.0;
+
+    // Green absorbs the rounding so white maps exactly to the top of the
+    // range and every grey has exactly neutral chroma
+    converter->y_coeff[0] = color_fixed(kb * y_scale);
+    converter->y_coeff[2] = color_fixed(kr * y_scale);
+    converter->y_coeff[1] = (int16_t)(color_fixed(y_scale) - converter->y_coeff[0] - converter->y_coeff[2]);
+
+    converter->u_coeff[0] = color_fixed(0.5 * c_scale);
+    converter->u_coeff[2] = color_fixed(-kr / (2.0 * (1.0 - kb)) * c_scale);
+    converter->u_coeff[1] = (int16_t)(-converter->u_coeff[0] - converter->u_coeff[2]);
+
+    converter->v_coeff[2] = color_fixed(0.5 * c_scale);
+    converter->v_coeff[0] = color_fixed(-kb / (2.0 * (1.0 - kr)) * c_scale);
+    converter->v_coeff[1] = (int16_t)(-converter->v_coeff[0] - converter->v_coeff[2]);
+
+    converter->y_offset = range == COLOR_RANGE_LIMITED ? 16 : 0;
+    return 0;
+}
+
+int color_converter_set_level(color_converter_t* converter, copy_kernel_level_t level) {
+    if (!converter || level < COPY_KERNEL_SCALAR || level >= COPY_KERNEL_COUNT) return -1;
+    if (!copy_kernels_supported(level)) return -1;
+    converter->level = level;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Row-pair kernels: two BGRA rows produce two luma rows and one chroma row.
+// Each returns how many pixels it converted; the scalar kernel finishes the rest.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const uint8_t* src0;
+    const uint8_t* src1;
+    uint8_t* y0;
+    uint8_t* y1;
+    uint8_t* u;                 // NV12: interleaved UV row
+    uint8_t* v;                 // NV12: NULL
+} color_rows_t;
+
+typedef int (*color_row_pair_fn)(const color_converter_t* converter, const color_rows_t* rows, int begin, int width);
+
+static int color_row_pair_scalar(const color_converter_t* converter, const color_rows_t* rows, int begin, int width) {
+    const int16_t* yc = converter->y_coeff;
+    const int16_t* uc = converter->u_coeff;
+    const int16_t* vc = converter->v_coeff;
+    const int32_t y_round = (converter->y_offset << COLOR_COEFF_BITS) + (1 << (COLOR_COEFF_BITS - 1));
+    const int32_t c_round = (128 << COLOR_CHROMA_SHIFT) + (1 << (COLOR_CHROMA_SHIFT - 1));
+
+    for (int x = begin; x < width; x += 2) {
+        const uint8_t* p[4] = {
+            rows->src0 + (size_t)x * 4, rows->src0 + (size_t)x * 4 + 4,
+            rows->src1 + (size_t)x * 4, rows->src1 + (size_t)x * 4 + 4
+        };
+        uint8_t* y_out[4] = { rows->y0 + x, rows->y0 + x + 1, rows->y1 + x, rows->y1 + x + 1 };
+
+        int32_t sum_b = 0, sum_g = 0, sum_r = 0;
+        for (int i = 0; i < 4; i++) {
+            int32_t y = yc[0] * p[i][0] + yc[1] * p[i][1] + yc[2] * p[i][2];
+            *y_out[i] = color_clamp_u8((y + y_round) >> COLOR_COEFF_BITS);
+            sum_b += p[i][0];
+            sum_g += p[i][1];
+            sum_r += p[i][2];
+        }
+
+        uint8_t u = color_clamp_u8((uc[0] * sum_b + uc[1] * sum_g + uc[2] * sum_r + c_round) >> COLOR_CHROMA_SHIFT);
+        uint8_t v = color_clamp_u8((vc[0] * sum_b + vc[1] * sum_g + vc[2] * sum_r + c_round) >> COLOR_CHROMA_SHIFT);
+        if (rows->v) {
+            rows->u[x / 2] = u;
+            rows->v[x / 2] = v;
+        } else {
+            rows->u[x] = u;
+            rows->u[x + 1] = v;
+        }
+    }
+    return width;
+}
+
+#ifdef COLOR_X86
+
+// (B, G) and (R, A) weight pairs laid out for madd against 16-bit BGRA pixels
+COLOR_TARGET("sse2")
+static __m128i color_coeff_sse2(const int16_t coeff[3]) {
+    int32_t bg = (int32_t)(((uint32_t)(uint16_t)coeff[1] << 16) | (uint16_t)coeff[0]);
+    int32_t ra = (int32_t)(uint16_t)coeff[2];
+    return _mm_set_epi32(ra, bg, ra, bg);
+}
+
+// Dot products of four 16-bit BGRA pixels (two in lo, two in hi) with a weight set
+COLOR_TARGET("sse2")
+static __m128i color_dot4_sse2(__m128i lo, __m128i hi, __m128i coeff) {
+    __m128 a = _mm_castsi128_ps(_mm_madd_epi16(lo, coeff));
+    __m128 b = _mm_castsi128_ps(_mm_madd_epi16(hi, coeff));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm_add_epi32(even, odd);
+}
+
+// 2x2 block sums of four pixels from each of two rows: two chroma samples, 16-bit BGRA
+COLOR_TARGET("sse2")
+static __m128i color_block_sums_sse2(__m128i row0, __m128i row1) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+    return _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+}
+
+COLOR_TARGET("sse2")
+static __m128i color_luma8_sse2(__m128i a, __m128i b, __m128i coeff, __m128i round) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i y0 = color_dot4_sse2(_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero), coeff);
+    __m128i y1 = color_dot4_sse2(_mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero), coeff);
+    y0 = _mm_srai_epi32(_mm_add_epi32(y0, round), COLOR_COEFF_BITS);
+    y1 = _mm_srai_epi32(_mm_add_epi32(y1, round), COLOR_COEFF_BITS);
+    return _mm_packus_epi16(_mm_packs_epi32(y0, y1), zero);
+}
+
+COLOR_TARGET("sse2")
+static int color_row_pair_sse2(const color_converter_t* converter, const color_rows_t* rows, int begin, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cy = color_coeff_sse2(converter->y_coeff);
+    const __m128i cu = color_coeff_sse2(converter->u_coeff);
+    const __m128i cv = color_coeff_sse2(converter->v_coeff);
+    const __m128i y_round = _mm_set1_epi32((converter->y_offset << COLOR_COEFF_BITS) + (1 << (COLOR_COEFF_BITS - 1)));
+    const __m128i c_round = _mm_set1_epi32((128 << COLOR_CHROMA_SHIFT) + (1 << (COLOR_CHROMA_SHIFT - 1)));
+
+    int x = begin;
+    for (; x + 8 <= width; x += 8) {
+        __m128i a0 = _mm_loadu_si128((const __m128i*)(rows->src0 + (size_t)x * 4));
+        __m128i b0 = _mm_loadu_si128((const __m128i*)(rows->src0 + (size_t)x * 4 + 16));
+        __m128i a1 = _mm_loadu_si128((const __m128i*)(rows->src1 + (size_t)x * 4));
+        __m128i b1 = _mm_loadu_si128((const __m128i*)(rows->src1 + (size_t)x * 4 + 16));
+
+        _mm_storel_epi64((__m128i*)(rows->y0 + x), color_luma8_sse2(a0, b0, cy, y_round));
+        _mm_storel_epi64((__m128i*)(rows->y1 + x), color_luma8_sse2(a1, b1, cy, y_round));
+
+        __m128i sums_a = color_block_sums_sse2(a0, a1);
+        __m128i sums_b = color_block_sums_sse2(b0, b1);
+        __m128i u = _mm_srai_epi32(_mm_add_epi32(color_dot4_sse2(sums_a, sums_b, cu), c_round), COLOR_CHROMA_SHIFT);
+        __m128i v = _mm_srai_epi32(_mm_add_epi32(color_dot4_sse2(sums_a, sums_b, cv), c_round), COLOR_CHROMA_SHIFT);
+
+        if (rows->v) {
+            int32_t u4 = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(u, zero), zero));
+            int32_t v4 = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(v, zero), zero));
+            memcpy(rows->u + x / 2, &u4, 4);
+            memcpy(rows->v + x / 2, &v4, 4);
+        } else {
+            __m128i uv = _mm_packs_epi32(_mm_unpacklo_epi32(u, v), _mm_unpackhi_epi32(u, v));
+            _mm_storel_epi64((__m128i*)(rows->u + x), _mm_packus_epi16(uv, zero));
+        }
+    }
+    return x;
+}
+
+COLOR_TARGET("avx2")
+static __m256i color_dot8_avx2(__m256i lo, __m256i hi, __m256i coeff) {
+    __m256 a = _mm256_castsi256_ps(_mm256_madd_epi16(lo, coeff));
+    __m256 b = _mm256_castsi256_ps(_mm256_madd_epi16(hi, coeff));
+    __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    return _mm256_add_epi32(even, odd);
+}
+
+COLOR_TARGET("avx2")
+static __m256i color_block_sums_avx2(__m256i row0, __m256i row1) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(row0, zero), _mm256_unpacklo_epi8(row1, zero));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(row0, zero), _mm256_unpackhi_epi8(row1, zero));
+    return _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+}
+
+// 16 int32 lanes (8 per lane half, pixel order per lane) to 16 ordered bytes
+COLOR_TARGET("avx2")
+static __m128i color_pack16_avx2(__m256i first, __m256i second) {
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xD8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+}
+
+COLOR_TARGET("avx2")
+static __m128i color_luma16_avx2(__m256i a, __m256i b, __m256i coeff, __m256i round) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i y0 = color_dot8_avx2(_mm256_unpacklo_epi8(a, zero), _mm256_unpackhi_epi8(a, zero), coeff);
+    __m256i y1 = color_dot8_avx2(_mm256_unpacklo_epi8(b, zero), _mm256_unpackhi_epi8(b, zero), coeff);
+    y0 = _mm256_srai_epi32(_mm256_add_epi32(y0, round), COLOR_COEFF_BITS);
+    y1 = _mm256_srai_epi32(_mm256_add_epi32(y1, round), COLOR_COEFF_BITS);
+    return color_pack16_avx2(y0, y1);
+}
+
+COLOR_TARGET("avx2")
+static int color_row_pair_avx2(const color_converter_t* converter, const color_rows_t* rows, int begin, int width) {
+    const __m256i cy = _mm256_broadcastsi128_si256(color_coeff_sse2(converter->y_coeff));
+    const __m256i cu = _mm256_broadcastsi128_si256(color_coeff_sse2(converter->u_coeff));
+    const __m256i cv = _mm256_broadcastsi128_si256(color_coeff_sse2(converter->v_coeff));
+    const __m256i y_round = _mm256_set1_epi32((converter->y_offset << COLOR_COEFF_BITS) + (1 << (COLOR_COEFF_BITS - 1)));
+    const __m256i c_round = _mm256_set1_epi32((128 << COLOR_CHROMA_SHIFT) + (1 << (COLOR_CHROMA_SHIFT - 1)));
+    // Chroma comes out as c0 c1 c4 c5 | c2 c3 c6 c7 after the per-lane shuffles
+    const __m256i chroma_order = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+
+    int x = begin;
+    for (; x + 16 <= width; x += 16) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i*)(rows->src0 + (size_t)x * 4));
+        __m256i b0 = _mm256_loadu_si256((const __m256i*)(rows->src0 + (size_t)x * 4 + 32));
+        __m256i a1 = _mm256_loadu_si256((const __m256i*)(rows->src1 + (size_t)x * 4));
+        __m256i b1 = _mm256_loadu_si256((const __m256i*)(rows->src1 + (size_t)x * 4 + 32));
+
+        _mm_storeu_si128((__m128i*)(rows->y0 + x), color_luma16_avx2(a0, b0, cy, y_round));
+        _mm_storeu_si128((__m128i*)(rows->y1 + x), color_luma16_avx2(a1, b1, cy, y_round));
+
+        __m256i sums_a = color_block_sums_avx2(a0, a1);
+        __m256i sums_b = color_block_sums_avx2(b0, b1);
+        __m256i u = _mm256_srai_epi32(_mm256_add_epi32(color_dot8_avx2(sums_a, sums_b, cu), c_round), COLOR_CHROMA_SHIFT);
+        __m256i v = _mm256_srai_epi32(_mm256_add_epi32(color_dot8_avx2(sums_a, sums_b, cv), c_round), COLOR_CHROMA_SHIFT);
+
+        if (rows->v) {
+            u = _mm256_permutevar8x32_epi32(u, chroma_order);
+            v = _mm256_permutevar8x32_epi32(v, chroma_order);
+            __m128i u8 = _mm_packs_epi32(_mm256_castsi256_si128(u), _mm256_extracti128_si256(u, 1));
+            __m128i v8 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+            _mm_storel_epi64((__m128i*)(rows->u + x / 2), _mm_packus_epi16(u8, u8));
+            _mm_storel_epi64((__m128i*)(rows->v + x / 2), _mm_packus_epi16(v8, v8));
+        } else {
+            // Interleaving per lane pairs c0-1 with c2-3 and c4-5 with c6-7; the lane fix-up restores order
+            _mm_storeu_si128((__m128i*)(rows->u + x),
+                             color_pack16_avx2(_mm256_unpacklo_epi32(u, v), _mm256_unpackhi_epi32(u, v)));
+        }
+    }
+    return x;
+}
+
+#endif // COLOR_X86
+
+static color_row_pair_fn color_kernel_for(copy_kernel_level_t level) {
+#ifdef COLOR_X86
+    if (level >= COPY_KERNEL_AVX2) return color_row_pair_avx2;
+    if (level == COPY_KERNEL_SSE2) return color_row_pair_sse2;
+#else
+    (void)level;
+#endif
+    return color_row_pair_scalar;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+int color_convert_rows(const color_converter_t* converter, color_format_t format, const color_planes_t* dst,
+                       const uint8_t* src, size_t src_pitch, int width, int row_begin, int row_end) {
+    if (!converter || !dst || !src || width <= 0 || (width & 1)) return -1;
+    if (row_begin < 0 || row_begin > row_end || (row_begin & 1) || (row_end & 1)) return -1;
+    if (!dst->planes[0] || !dst->planes[1]) return -1;
+    if (format == COLOR_FORMAT_I420 && !dst->planes[2]) return -1;
+    if (format != COLOR_FORMAT_NV12 && format != COLOR_FORMAT_I420) return -1;
+
+    color_row_pair_fn kernel = color_kernel_for(converter->level);
+
+    for (int y = row_begin; y < row_end; y += 2) {
+        color_rows_t rows;
+        rows.src0 = src + (size_t)y * src_pitch;
+        rows.src1 = rows.src0 + src_pitch;
+        rows.y0 = dst->planes[0] + (size_t)y * dst->pitches[0];
+        rows.y1 = rows.y0 + dst->pitches[0];
+        rows.u = dst->planes[1] + (size_t)(y / 2) * dst->pitches[1];
+        rows.v = format == COLOR_FORMAT_I420 ? dst->planes[2] + (size_t)(y / 2) * dst->pitches[2] : NULL;
+
+        int done = kernel(converter, &rows, 0, width);
+        color_row_pair_scalar(converter, &rows, done, width);
+    }
+    return 0;
+}
+
+typedef struct {
+    const color_converter_t* converter;
+    color_format_t format;
+    const color_planes_t* dst;
+    const uint8_t* src;
+    size_t src_pitch;
+    int width;
+    int height;
+    int slices;
+} color_job_t;
+
+// Slice bounds are taken in row pairs so every slice starts on a chroma row
+static int color_slice_task(void* context, int task, int worker) {
+    color_job_t* job = (color_job_t*)context;
+    int pairs = job->height / 2;
+    (void)worker;
+    return color_convert_rows(job->converter, job->format, job->dst, job->src, job->src_pitch, job->width,
+                              2 * (int)((long long)pairs * task / job->slices),
+                              2 * (int)((long long)pairs * (task + 1) / job->slices));
+}
+
+void color_converter_set_pool(color_converter_t* converter, worker_pool_t* pool) {
+    if (converter) converter->pool = pool;
+}
+
+int color_convert_frame(const color_converter_t* converter, color_format_t format, const color_planes_t* dst,
+                        const uint8_t* src, size_t src_pitch, int width, int height) {
+    if (!converter || height <= 0 || (height & 1)) return -1;
+
+    int slices = worker_pool_slices(converter->pool, height, COLOR_MIN_SLICE_ROWS);
+    if (!converter->pool || slices <= 1) {
+        return color_convert_rows(converter, format, dst, src, src_pitch, width, 0, height);
+    }
+
+    color_job_t job = { converter, format, dst, src, src_pitch, width, height, slices };
+    return worker_pool_run(converter->pool, slices, color_slice_task, &job);
+}
+
+size_t color_frame_size(color_format_t format, int width, int height) {
+    (void)format; // NV12 and I420 carry the same samples, only the chroma layout differs
+    if (width <= 0 || height <= 0) return 0;
+    return (size_t)width * height + 2 * (size_t)(width / 2) * (height / 2);
+}
+
+int color_planes_for_buffer(color_format_t format, uint8_t* buffer, int width, int height, color_planes_t* planes) {
+    if (!buffer || !planes || width <= 0 || height <= 0 || (width & 1) || (height & 1)) return -1;
+
+    memset(planes, 0, sizeof(color_planes_t));
+    planes->planes[0] = buffer;
+    planes->pitches[0] = (size_t)width;
+    planes->planes[1] = buffer + (size_t)width * height;
+
+    if (format == COLOR_FORMAT_NV12) {
+        planes->pitches[1] = (size_t)width;
+    } else if (format == COLOR_FORMAT_I420) {
+        planes->pitches[1] = (size_t)width / 2;
+        planes->planes[2] = planes->planes[1] + (size_t)(width / 2) * (height / 2);
+        planes->pitches[2] = (size_t)width / 2;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+const char* color_matrix_name(color_matrix_t matrix) {
+    return matrix == COLOR_MATRIX_BT709 ? "BT.709" : "BT.601";
+}
+
+const char* color_range_name(color_range_t range) {
+    return range == COLOR_RANGE_FULL ? "full" : "limited";
+}
+
+const char* color_format_name(color_format_t format) {
+    return format == COLOR_FORMAT_I420 ? "I420" : "NV12";
+}
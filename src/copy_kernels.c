@@ -0,0 +1,298 @@
+#include "copy_kernels.h"
+#include "platform.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define COPY_KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang only emit SIMD instructions inside functions that ask for them
+#if defined(__GNUC__) || defined(__clang__)
+#define COPY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define COPY_TARGET(isa)
+#endif
+
+#define COPY_KERNELS_DEFAULT_LLC (8u * 1024u * 1024u)
+
+typedef void (*copy_row_fn)(uint8_t* dst, const uint8_t* src, size_t bytes);
+
+static platform_atomic_t g_detected = 0;
+static copy_kernel_level_t g_best_level = COPY_KERNEL_SCALAR;
+static int g_supported[COPY_KERNEL_COUNT] = { 1, 0, 0, 0 };
+static size_t g_llc_size = COPY_KERNELS_DEFAULT_LLC;
+static size_t g_nt_threshold = 0;   // 0 means derive it from the LLC size
+
+static void copy_row_scalar(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    memcpy(dst, src, bytes);
+}
+
+#ifdef COPY_KERNELS_X86
+
+// Bytes to copy with ordinary stores before dst reaches the given alignment
+static size_t copy_align_head(const uint8_t* dst, size_t alignment, size_t bytes) {
+    size_t head = (alignment - ((uintptr_t)dst & (alignment - 1))) & (alignment - 1);
+    return head < bytes ? head : bytes;
+}
+
+COPY_TARGET("sse2")
+static void copy_row_sse2_nt(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    size_t i = copy_align_head(dst, 16, bytes);
+    if (i) memcpy(dst, src, i);
+    for (; i + 64 <= bytes; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + i + 48));
+        _mm_stream_si128((__m128i*)(dst + i), a);
+        _mm_stream_si128((__m128i*)(dst + i + 16), b);
+        _mm_stream_si128((__m128i*)(dst + i + 32), c);
+        _mm_stream_si128((__m128i*)(dst + i + 48), d);
+    }
+    for (; i + 16 <= bytes; i += 16) {
+        _mm_stream_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+    }
+    if (i < bytes) memcpy(dst + i, src + i, bytes - i);
+}
+
+COPY_TARGET("avx2")
+static void copy_row_avx2_nt(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    size_t i = copy_align_head(dst, 32, bytes);
+    if (i) memcpy(dst, src, i);
+    for (; i + 128 <= bytes; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 96));
+        _mm256_stream_si256((__m256i*)(dst + i), a);
+        _mm256_stream_si256((__m256i*)(dst + i + 32), b);
+        _mm256_stream_si256((__m256i*)(dst + i + 64), c);
+        _mm256_stream_si256((__m256i*)(dst + i + 96), d);
+    }
+    for (; i + 32 <= bytes; i += 32) {
+        _mm256_stream_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    if (i < bytes) memcpy(dst + i, src + i, bytes - i);
+}
+
+COPY_TARGET("avx512f")
+static void copy_row_avx512_nt(uint8_t* dst, const uint8_t* src, size_t bytes) {
+    size_t i = copy_align_head(dst, 64, bytes);
+    if (i) memcpy(dst, src, i);
+    for (; i + 256 <= bytes; i += 256) {
+        __m512i a = _mm512_loadu_si512((const void*)(src + i));
+        __m512i b = _mm512_loadu_si512((const void*)(src + i + 64));
+        __m512i c = _mm512_loadu_si512((const void*)(src + i + 128));
+        __m512i d = _mm512_loadu_si512((const void*)(src + i + 192));
+        _mm512_stream_si512((void*)(dst + i), a);
+        _mm512_stream_si512((void*)(dst + i + 64), b);
+        _mm512_stream_si512((void*)(dst + i + 128), c);
+        _mm512_stream_si512((void*)(dst + i + 192), d);
+    }
+    for (; i + 64 <= bytes; i += 64) {
+        _mm512_stream_si512((void*)(dst + i), _mm512_loadu_si512((const void*)(src + i)));
+    }
+    if (i < bytes) memcpy(dst + i, src + i, bytes - i);
+}
+
+// Streaming stores are weakly ordered; fence before anyone else reads the frame
+COPY_TARGET("sse2")
+static void copy_store_fence(void) {
+    _mm_sfence();
+}
+
+static void copy_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned)info[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t copy_xgetbv(void) {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+// Largest data or unified cache from the deterministic cache parameter leaf
+static size_t copy_detect_llc(unsigned leaf) {
+    size_t largest = 0;
+    for (unsigned sub = 0; sub < 16; sub++) {
+        unsigned regs[4];
+        copy_cpuid(leaf, sub, regs);
+        unsigned type = regs[0] & 0x1F;
+        if (type == 0) break;
+        if (type == 2) continue; // Instruction cache
+
+        size_t ways = ((regs[1] >> 22) & 0x3FF) + 1;
+        size_t partitions = ((regs[1] >> 12) & 0x3FF) + 1;
+        size_t line = (regs[1] & 0xFFF) + 1;
+        size_t sets = (size_t)regs[2] + 1;
+        size_t size = ways * partitions * line * sets;
+        if (size > largest) largest = size;
+    }
+    return largest;
+}
+
+static void copy_detect_cpu(void) {
+    unsigned regs[4];
+    copy_cpuid(0, 0, regs);
+    unsigned max_leaf = regs[0];
+    int intel = regs[1] == 0x756E6547 && regs[3] == 0x49656E69 && regs[2] == 0x6C65746E; // "GenuineIntel"
+
+    if (max_leaf < 1) return;
+    copy_cpuid(1, 0, regs);
+    int sse2 = (regs[3] >> 26) & 1;
+    int osxsave = (regs[2] >> 27) & 1;
+    int avx = (regs[2] >> 28) & 1;
+
+    // AVX state must be enabled by the OS, not just present in the CPU
+    uint64_t xcr0 = osxsave ? copy_xgetbv() : 0;
+    int os_avx = (xcr0 & 0x6) == 0x6;
+    int os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+    int avx2 = 0;
+    int avx512f = 0;
+    if (max_leaf >= 7) {
+        copy_cpuid(7, 0, regs);
+        avx2 = (regs[1] >> 5) & 1;
+        avx512f = (regs[1] >> 16) & 1;
+    }
+
+    g_supported[COPY_KERNEL_SSE2] = sse2;
+    g_supported[COPY_KERNEL_AVX2] = sse2 && avx && os_avx && avx2;
+    g_supported[COPY_KERNEL_AVX512] = g_supported[COPY_KERNEL_AVX2] && os_avx512 && avx512f;
+
+    size_t llc = 0;
+    if (intel && max_leaf >= 4) {
+        llc = copy_detect_llc(4);
+    } else {
+        copy_cpuid(0x80000000, 0, regs);
+        if (regs[0] >= 0x8000001D) llc = copy_detect_llc(0x8000001D);
+    }
+    if (llc > 0) g_llc_size = llc;
+}
+
+#endif // COPY_KERNELS_X86
+
+// Cached copies go through memcpy at every level: the C runtime already picks
+// rep movsb or its own vector loop, and hand-written temporal loops measured
+// slower. The ISA-specific kernels are the streaming-store paths.
+static const copy_row_fn g_row_kernels[COPY_KERNEL_COUNT][2] = {
+    { copy_row_scalar, copy_row_scalar },
+#ifdef COPY_KERNELS_X86
+    { copy_row_scalar, copy_row_sse2_nt },
+    { copy_row_scalar, copy_row_avx2_nt },
+    { copy_row_scalar, copy_row_avx512_nt },
+#else
+    { copy_row_scalar, copy_row_scalar },
+    { copy_row_scalar, copy_row_scalar },
+    { copy_row_scalar, copy_row_scalar },
+#endif
+};
+
+static void copy_kernels_detect(void) {
+    if (platform_atomic_load(&g_detected)) return;
+
+    // Detection is idempotent, so a racing first call just repeats the work;
+    // each global is only ever written with its final value, so a concurrent
+    // copy never sees the best level fall back to scalar mid-detection
+#ifdef COPY_KERNELS_X86
+    copy_detect_cpu();
+#endif
+    copy_kernel_level_t best = COPY_KERNEL_SCALAR;
+    for (int level = COPY_KERNEL_COUNT - 1; level > COPY_KERNEL_SCALAR; level--) {
+        if (g_supported[level]) {
+            best = (copy_kernel_level_t)level;
+            break;
+        }
+    }
+    g_best_level = best;
+    platform_atomic_store(&g_detected, 1);
+}
+
+// Only a copy that fills the whole LLC is sure to evict what the other
+// pipeline stages keep there; smaller ones stay cached for the next reader
+static size_t copy_kernels_default_threshold(void) {
+    return g_nt_threshold ? g_nt_threshold : g_llc_size;
+}
+
+static void copy_plane_level(copy_kernel_level_t level, uint8_t* dst, size_t dst_pitch,
+                             const uint8_t* src, size_t src_pitch, size_t row_bytes, int rows, int flip_vertical) {
+    if (!dst || !src || row_bytes == 0 || rows <= 0) return;
+
+    size_t total = row_bytes * (size_t)rows;
+    size_t threshold = copy_kernels_default_threshold();
+    int nt = level != COPY_KERNEL_SCALAR && total >= threshold;
+    copy_row_fn copy_row = g_row_kernels[level][nt];
+
+    if (!flip_vertical && dst_pitch == row_bytes && src_pitch == row_bytes) {
+        // Both surfaces are tightly packed: one long copy instead of many rows
+        copy_row(dst, src, total);
+    } else {
+        for (int y = 0; y < rows; y++) {
+            int dst_row = flip_vertical ? rows - 1 - y : y;
+            copy_row(dst + (size_t)dst_row * dst_pitch, src + (size_t)y * src_pitch, row_bytes);
+        }
+    }
+
+#ifdef COPY_KERNELS_X86
+    if (nt) copy_store_fence();
+#endif
+}
+
+void copy_plane(uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch,
+                size_t row_bytes, int rows, int flip_vertical) {
+    copy_kernels_detect();
+    copy_plane_level(g_best_level, dst, dst_pitch, src, src_pitch, row_bytes, rows, flip_vertical);
+}
+
+int copy_plane_with(copy_kernel_level_t level, uint8_t* dst, size_t dst_pitch,
+                    const uint8_t* src, size_t src_pitch, size_t row_bytes, int rows, int flip_vertical) {
+    if (!copy_kernels_supported(level)) return -1;
+    copy_plane_level(level, dst, dst_pitch, src, src_pitch, row_bytes, rows, flip_vertical);
+    return 0;
+}
+
+copy_kernel_level_t copy_kernels_best_level(void) {
+    copy_kernels_detect();
+    return g_best_level;
+}
+
+int copy_kernels_supported(copy_kernel_level_t level) {
+    if (level < COPY_KERNEL_SCALAR || level >= COPY_KERNEL_COUNT) return 0;
+    copy_kernels_detect();
+    return g_supported[level];
+}
+
+const char* copy_kernels_level_name(copy_kernel_level_t level) {
+    switch (level) {
+        case COPY_KERNEL_SCALAR: return "scalar";
+        case COPY_KERNEL_SSE2: return "sse2";
+        case COPY_KERNEL_AVX2: return "avx2";
+        case COPY_KERNEL_AVX512: return "avx512";
+        default: return "unknown";
+    }
+}
+
+size_t copy_kernels_nt_threshold(void) {
+    copy_kernels_detect();
+    return copy_kernels_default_threshold();
+}
+
+void copy_kernels_set_nt_threshold(size_t bytes) {
+    g_nt_threshold = bytes;
+}
@@ -0,0 +1,355 @@
+#include "cursor_compositor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CURSOR_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CURSOR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CURSOR_TARGET(isa)
+#endif
+
+// x / 255 rounded to nearest, exact for x <= 255 * 255
+static unsigned cursor_div255(unsigned x) {
+    unsigned t = x + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static void cursor_store(uint32_t* pixel, unsigned b, unsigned g, unsigned r, unsigned a) {
+    uint8_t bytes[4] = { (uint8_t)b, (uint8_t)g, (uint8_t)r, (uint8_t)a };
+    memcpy(pixel, bytes, 4);
+}
+
+// ---------------------------------------------------------------------------
+// Shape decoding
+// ---------------------------------------------------------------------------
+
+int cursor_decode_shape(cursor_shape_type_t type, const uint8_t* data, int width, int height, int pitch,
+                        uint32_t* color, uint32_t* xor_mask, int* has_xor) {
+    if (!data || !color || !xor_mask || width <= 0 || height <= 0) return -1;
+    int inverts = 0;
+
+    switch (type) {
+    case CURSOR_SHAPE_MONOCHROME:
+        // AND 0: black or white from the XOR bit; AND 1: transparent, or inverted if the XOR bit is set
+        if (pitch < (width + 7) / 8) return -1;
+        for (int y = 0; y < height; y++) {
+            const uint8_t* and_row = data + (size_t)y * pitch;
+            const uint8_t* xor_row = data + (size_t)(y + height) * pitch;
+            for (int x = 0; x < width; x++) {
+                uint8_t bit = (uint8_t)(0x80 >> (x & 7));
+                int and_bit = (and_row[x >> 3] & bit) != 0;
+                int xor_bit = (xor_row[x >> 3] & bit) != 0;
+                size_t i = (size_t)y * width + x;
+                if (!and_bit) {
+                    unsigned value = xor_bit ? 255 : 0;
+                    cursor_store(&color[i], value, value, value, 255);
+                    xor_mask[i] = 0;
+                } else {
+                    color[i] = 0;
+                    if (xor_bit) {
+                        cursor_store(&xor_mask[i], 255, 255, 255, 0);
+                    } else {
+                        xor_mask[i] = 0;
+                    }
+                    inverts |= xor_bit;
+                }
+            }
+        }
+        break;
+
+    case CURSOR_SHAPE_COLOR:
+        if (pitch < width * 4) return -1;
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = data + (size_t)y * pitch;
+            for (int x = 0; x < width; x++) {
+                const uint8_t* src = row + x * 4;
+                unsigned alpha = src[3];
+                size_t i = (size_t)y * width + x;
+                cursor_store(&color[i], cursor_div255(src[0] * alpha), cursor_div255(src[1] * alpha),
+                             cursor_div255(src[2] * alpha), alpha);
+                xor_mask[i] = 0;
+            }
+        }
+        break;
+
+    case CURSOR_SHAPE_MASKED_COLOR:
+        if (pitch < width * 4) return -1;
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = data + (size_t)y * pitch;
+            for (int x = 0; x < width; x++) {
+                const uint8_t* src = row + x * 4;
+                size_t i = (size_t)y * width + x;
+                if (src[3] == 0) {
+                    cursor_store(&color[i], src[0], src[1], src[2], 255);
+                    xor_mask[i] = 0;
+                } else {
+                    color[i] = 0;
+                    cursor_store(&xor_mask[i], src[0], src[1], src[2], 0);
+                    inverts |= (src[0] | src[1] | src[2]) != 0;
+                }
+            }
+        }
+        break;
+
+    default:
+        return -1;
+    }
+
+    if (has_xor) *has_xor = inverts;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Blend kernels: one row of premultiplied cursor pixels over the frame,
+// xor_mask may be NULL
+// ---------------------------------------------------------------------------
+
+typedef void (*cursor_blend_fn)(uint8_t* dst, const uint8_t* color, const uint8_t* xor_mask, int pixels);
+
+static void cursor_blend_row_scalar(uint8_t* dst, const uint8_t* color, const uint8_t* xor_mask, int pixels) {
+    for (int i = 0; i < pixels * 4; i += 4) {
+        unsigned inverse = 255u - color[i + 3];
+        for (int c = 0; c < 4; c++) {
+            unsigned value = color[i + c] + cursor_div255(dst[i + c] * inverse);
+            if (value > 255) value = 255;
+            dst[i + c] = (uint8_t)(xor_mask ? value ^ xor_mask[i + c] : value);
+        }
+    }
+}
+
+#ifdef CURSOR_X86
+
+// dst * (255 - alpha) / 255 for four 16-bit BGRA pixels' worth of lanes
+CURSOR_TARGET("sse2")
+static __m128i cursor_scale_sse2(__m128i dst16, __m128i color16) {
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(color16, 0xFF), 0xFF);
+    __m128i product = _mm_mullo_epi16(dst16, _mm_sub_epi16(_mm_set1_epi16(255), alpha));
+    product = _mm_add_epi16(product, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+}
+
+CURSOR_TARGET("sse2")
+static void cursor_blend_row_sse2(uint8_t* dst, const uint8_t* color, const uint8_t* xor_mask, int pixels) {
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        __m128i c = _mm_loadu_si128((const __m128i*)(color + i * 4));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i low = cursor_scale_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(c, zero));
+        __m128i high = cursor_scale_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(c, zero));
+        __m128i out = _mm_adds_epu8(c, _mm_packus_epi16(low, high));
+        if (xor_mask) out = _mm_xor_si128(out, _mm_loadu_si128((const __m128i*)(xor_mask + i * 4)));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), out);
+    }
+    if (i < pixels) {
+        cursor_blend_row_scalar(dst + i * 4, color + i * 4, xor_mask ? xor_mask + i * 4 : NULL, pixels - i);
+    }
+}
+
+CURSOR_TARGET("avx2")
+static __m256i cursor_scale_avx2(__m256i dst16, __m256i color16) {
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(color16, 0xFF), 0xFF);
+    __m256i product = _mm256_mullo_epi16(dst16, _mm256_sub_epi16(_mm256_set1_epi16(255), alpha));
+    product = _mm256_add_epi16(product, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+}
+
+// Unpack and pack both work within 128-bit lanes, so pixel order survives
+CURSOR_TARGET("avx2")
+static void cursor_blend_row_avx2(uint8_t* dst, const uint8_t* color, const uint8_t* xor_mask, int pixels) {
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(color + i * 4));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i * 4));
+        __m256i low = cursor_scale_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(c, zero));
+        __m256i high = cursor_scale_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(c, zero));
+        __m256i out = _mm256_adds_epu8(c, _mm256_packus_epi16(low, high));
+        if (xor_mask) out = _mm256_xor_si256(out, _mm256_loadu_si256((const __m256i*)(xor_mask + i * 4)));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), out);
+    }
+    if (i < pixels) {
+        cursor_blend_row_sse2(dst + i * 4, color + i * 4, xor_mask ? xor_mask + i * 4 : NULL, pixels - i);
+    }
+}
+
+#endif // CURSOR_X86
+
+static cursor_blend_fn cursor_kernel_for(copy_kernel_level_t level) {
+#ifdef CURSOR_X86
+    if (level >= COPY_KERNEL_AVX2) return cursor_blend_row_avx2;
+    if (level == COPY_KERNEL_SSE2) return cursor_blend_row_sse2;
+#else
+    (void)level;
+#endif
+    return cursor_blend_row_scalar;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+int cursor_compositor_init(cursor_compositor_t* cursor) {
+    if (!cursor) return -1;
+    memset(cursor, 0, sizeof(cursor_compositor_t));
+    cursor->current = -1;
+    cursor->level = copy_kernels_best_level();
+    return 0;
+}
+
+static void cursor_shape_free(cursor_shape_t* shape) {
+    free(shape->color);
+    free(shape->xor_mask);
+    memset(shape, 0, sizeof(cursor_shape_t));
+}
+
+void cursor_compositor_cleanup(cursor_compositor_t* cursor) {
+    if (!cursor) return;
+    for (int i = 0; i < CURSOR_CACHE_SIZE; i++) {
+        cursor_shape_free(&cursor->cache[i]);
+    }
+    memset(cursor, 0, sizeof(cursor_compositor_t));
+    cursor->current = -1;
+}
+
+int cursor_compositor_set_level(cursor_compositor_t* cursor, copy_kernel_level_t level) {
+    if (!cursor || level < COPY_KERNEL_SCALAR || level >= COPY_KERNEL_COUNT) return -1;
+    if (!copy_kernels_supported(level)) return -1;
+    cursor->level = level;
+    return 0;
+}
+
+// FNV-1a over the shape header and the meaningful bytes of every row
+static uint64_t cursor_shape_key(cursor_shape_type_t type, const uint8_t* data, int width, int height, int pitch,
+                                 int hot_x, int hot_y) {
+    int header[5] = { (int)type, width, height, hot_x, hot_y };
+    size_t row_bytes = type == CURSOR_SHAPE_MONOCHROME ? (size_t)(width + 7) / 8 : (size_t)width * 4;
+    uint64_t key = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < sizeof(header); i++) {
+        key = (key ^ ((const uint8_t*)header)[i]) * 0x100000001B3ull;
+    }
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = data + (size_t)y * pitch;
+        for (size_t i = 0; i < row_bytes; i++) {
+            key = (key ^ row[i]) * 0x100000001B3ull;
+        }
+    }
+    return key ? key : 1;
+}
+
+int cursor_compositor_set_shape(cursor_compositor_t* cursor, cursor_shape_type_t type, const uint8_t* data,
+                                int width, int height, int pitch, int hot_x, int hot_y) {
+    if (!cursor || !data || width <= 0 || height <= 0 || pitch <= 0) return -1;
+
+    int rows = type == CURSOR_SHAPE_MONOCHROME ? height / 2 : height;
+    if (rows <= 0 || width > CURSOR_MAX_SIZE || rows > CURSOR_MAX_SIZE) {
+        fprintf(stderr, "Cursor: Unsupported %dx%d pointer shape\n", width, rows);
+        return -1;
+    }
+
+    uint64_t key = cursor_shape_key(type, data, width, height, pitch, hot_x, hot_y);
+    cursor->clock++;
+    cursor->shape_updates++;
+
+    // Pointers cycle through a handful of shapes (arrow, I-beam, hand, resize)
+    int slot = -1;
+    for (int i = 0; i < CURSOR_CACHE_SIZE; i++) {
+        if (cursor->cache[i].key == key) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        cursor->cache_hits++;
+    } else {
+        slot = 0;
+        for (int i = 1; i < CURSOR_CACHE_SIZE && cursor->cache[slot].key != 0; i++) {
+            if (cursor->cache[i].key == 0 || cursor->cache[i].last_used < cursor->cache[slot].last_used) slot = i;
+        }
+
+        cursor_shape_t* shape = &cursor->cache[slot];
+        cursor_shape_free(shape);
+        if (slot == cursor->current) cursor->current = -1;
+
+        size_t pixels = (size_t)width * rows;
+        shape->color = (uint32_t*)malloc(pixels * sizeof(uint32_t));
+        shape->xor_mask = (uint32_t*)malloc(pixels * sizeof(uint32_t));
+        int has_xor = 0;
+        if (!shape->color || !shape->xor_mask ||
+            cursor_decode_shape(type, data, width, rows, pitch, shape->color, shape->xor_mask, &has_xor) != 0) {
+            fprintf(stderr, "Cursor: Failed to decode %dx%d pointer shape (type %d)\n", width, rows, (int)type);
+            cursor_shape_free(shape);
+            return -1;
+        }
+        if (!has_xor) {
+            free(shape->xor_mask);
+            shape->xor_mask = NULL;
+        }
+        shape->key = key;
+        shape->width = width;
+        shape->height = rows;
+        shape->hot_x = hot_x;
+        shape->hot_y = hot_y;
+    }
+
+    cursor->cache[slot].last_used = cursor->clock;
+    if (slot != cursor->current) {
+        cursor->current = slot;
+        cursor->generation++;
+    }
+    return 0;
+}
+
+void cursor_compositor_set_position(cursor_compositor_t* cursor, int x, int y, int visible) {
+    if (!cursor) return;
+    visible = visible != 0;
+    if (cursor->visible == visible && (!visible || (cursor->x == x && cursor->y == y))) return;
+
+    cursor->x = x;
+    cursor->y = y;
+    cursor->visible = visible;
+    cursor->generation++;
+}
+
+int cursor_compositor_bounds(const cursor_compositor_t* cursor, int width, int height,
+                             int origin_x, int origin_y, frame_rect_t* rect) {
+    if (!cursor || !rect || !cursor->visible || cursor->current < 0) return 0;
+
+    const cursor_shape_t* shape = &cursor->cache[cursor->current];
+    rect->left = origin_x + cursor->x;
+    rect->top = origin_y + cursor->y;
+    rect->right = rect->left + shape->width;
+    rect->bottom = rect->top + shape->height;
+    return frame_rect_clip(rect, width, height);
+}
+
+int cursor_compositor_draw(cursor_compositor_t* cursor, uint8_t* pixels, size_t pitch, int width, int height,
+                           int origin_x, int origin_y, int flip_vertical, frame_rect_t* drawn) {
+    if (drawn) memset(drawn, 0, sizeof(frame_rect_t));
+    if (!cursor || !pixels || width <= 0 || height <= 0 || pitch < (size_t)width * 4) return -1;
+
+    frame_rect_t rect;
+    if (!cursor_compositor_bounds(cursor, width, height, origin_x, origin_y, &rect)) return 0;
+
+    const cursor_shape_t* shape = &cursor->cache[cursor->current];
+    cursor_blend_fn blend = cursor_kernel_for(cursor->level);
+    int shape_x = rect.left - (origin_x + cursor->x);
+    int shape_y = rect.top - (origin_y + cursor->y);
+
+    for (int y = rect.top; y < rect.bottom; y++) {
+        int row = flip_vertical ? height - 1 - y : y;
+        size_t offset = (size_t)(y - rect.top + shape_y) * shape->width + shape_x;
+        blend(pixels + (size_t)row * pitch + (size_t)rect.left * 4, (const uint8_t*)(shape->color + offset),
+              shape->xor_mask ? (const uint8_t*)(shape->xor_mask + offset) : NULL, rect.right - rect.left);
+    }
+
+    cursor->blends++;
+    if (drawn) *drawn = rect;
+    return 0;
+}
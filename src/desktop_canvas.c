@@ -0,0 +1,168 @@
+#include "desktop_canvas.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DESKTOP_CANVAS_ALIGNMENT 64
+
+int desktop_canvas_layout(const canvas_output_desc_t* outputs, int output_count, capture_region_t* bounds) {
+    if (!outputs || output_count <= 0 || !bounds) return -1;
+
+    int left = outputs[0].desktop.x;
+    int top = outputs[0].desktop.y;
+    int right = left;
+    int bottom = top;
+
+    for (int i = 0; i < output_count; i++) {
+        const capture_region_t* d = &outputs[i].desktop;
+        if (d->width <= 0 || d->height <= 0 || !outputs[i].capture) return -1;
+
+        // Workers write without locking, which is only safe if outputs never overlap
+        for (int j = 0; j < i; j++) {
+            const capture_region_t* o = &outputs[j].desktop;
+            if (d->x < o->x + o->width && o->x < d->x + d->width &&
+                d->y < o->y + o->height && o->y < d->y + d->height) {
+                return -1;
+            }
+        }
+
+        if (d->x < left) left = d->x;
+        if (d->y < top) top = d->y;
+        if (d->x + d->width > right) right = d->x + d->width;
+        if (d->y + d->height > bottom) bottom = d->y + d->height;
+    }
+
+    bounds->x = left;
+    bounds->y = top;
+    bounds->width = right - left;
+    bounds->height = bottom - top;
+    return 0;
+}
+
+static void canvas_worker(void* arg) {
+    canvas_output_t* output = (canvas_output_t*)arg;
+    desktop_canvas_t* canvas = output->canvas;
+
+    // Each output owns a disjoint window of the canvas (checked by the layout), so workers never contend on pixels
+    uint8_t* dst = canvas->pixels +
+                   (size_t)(output->desc.desktop.y - canvas->origin_y) * canvas->stride +
+                   (size_t)(output->desc.desktop.x - canvas->origin_x) * 4;
+
+    platform_mutex_lock(&canvas->lock);
+    for (;;) {
+        while (!canvas->stopping && output->last_sequence == canvas->sequence) {
+            platform_cond_wait(&canvas->work_ready, &canvas->lock);
+        }
+        if (canvas->stopping) break;
+
+        uint64_t sequence = canvas->sequence;
+        platform_mutex_unlock(&canvas->lock);
+
+        int result = output->desc.capture(output->desc.context, dst, canvas->stride);
+
+        platform_mutex_lock(&canvas->lock);
+        output->last_sequence = sequence;
+        output->last_result = result;
+        if (result == CANVAS_OUTPUT_NEW) output->updates++;
+        if (result < 0) output->failures++;
+        if (--canvas->pending == 0) {
+            platform_cond_signal(&canvas->work_done);
+        }
+    }
+    platform_mutex_unlock(&canvas->lock);
+}
+
+int desktop_canvas_init(desktop_canvas_t* canvas, const canvas_output_desc_t* outputs, int output_count) {
+    if (!canvas || !outputs || output_count <= 0 || output_count > DESKTOP_CANVAS_MAX_OUTPUTS) return -1;
+
+    memset(canvas, 0, sizeof(desktop_canvas_t));
+
+    capture_region_t bounds;
+    if (desktop_canvas_layout(outputs, output_count, &bounds) != 0) {
+        fprintf(stderr, "Desktop canvas: Invalid output layout (empty or overlapping outputs)\n");
+        return -1;
+    }
+
+    // Pad to the codec alignment; the padding stays black like any other gap
+    canvas->origin_x = bounds.x;
+    canvas->origin_y = bounds.y;
+    canvas->width = (bounds.width + CAPTURE_REGION_ALIGNMENT - 1) & ~(CAPTURE_REGION_ALIGNMENT - 1);
+    canvas->height = (bounds.height + CAPTURE_REGION_ALIGNMENT - 1) & ~(CAPTURE_REGION_ALIGNMENT - 1);
+    canvas->stride = (size_t)canvas->width * 4;
+
+    canvas->pixels = (uint8_t*)platform_aligned_alloc(canvas->stride * (size_t)canvas->height, DESKTOP_CANVAS_ALIGNMENT);
+    if (!canvas->pixels) {
+        fprintf(stderr, "Desktop canvas: Failed to allocate %dx%d canvas\n", canvas->width, canvas->height);
+        return -1;
+    }
+    memset(canvas->pixels, 0, canvas->stride * (size_t)canvas->height);
+
+    if (platform_mutex_init(&canvas->lock) != 0 ||
+        platform_cond_init(&canvas->work_ready) != 0 ||
+        platform_cond_init(&canvas->work_done) != 0) {
+        platform_aligned_free(canvas->pixels);
+        memset(canvas, 0, sizeof(desktop_canvas_t));
+        return -1;
+    }
+
+    for (int i = 0; i < output_count; i++) {
+        canvas_output_t* output = &canvas->outputs[i];
+        output->desc = outputs[i];
+        output->canvas = canvas;
+        canvas->output_count = i + 1;
+
+        if (platform_thread_create(&output->thread, canvas_worker, output) != 0) {
+            fprintf(stderr, "Desktop canvas: Failed to start worker for output %d\n", i);
+            canvas->output_count = i;
+            desktop_canvas_cleanup(canvas);
+            return -1;
+        }
+        output->thread_started = 1;
+    }
+
+    return 0;
+}
+
+void desktop_canvas_cleanup(desktop_canvas_t* canvas) {
+    if (!canvas || !canvas->pixels) return;
+
+    platform_mutex_lock(&canvas->lock);
+    canvas->stopping = 1;
+    platform_cond_broadcast(&canvas->work_ready);
+    platform_mutex_unlock(&canvas->lock);
+
+    for (int i = 0; i < canvas->output_count; i++) {
+        if (canvas->outputs[i].thread_started) {
+            platform_thread_join(canvas->outputs[i].thread);
+        }
+    }
+
+    platform_cond_destroy(&canvas->work_done);
+    platform_cond_destroy(&canvas->work_ready);
+    platform_mutex_destroy(&canvas->lock);
+    platform_aligned_free(canvas->pixels);
+    memset(canvas, 0, sizeof(desktop_canvas_t));
+}
+
+int desktop_canvas_capture(desktop_canvas_t* canvas) {
+    if (!canvas || !canvas->pixels || canvas->output_count <= 0) return -1;
+
+    platform_mutex_lock(&canvas->lock);
+    canvas->sequence++;
+    canvas->pending = canvas->output_count;
+    platform_cond_broadcast(&canvas->work_ready);
+
+    while (canvas->pending > 0) {
+        platform_cond_wait(&canvas->work_done, &canvas->lock);
+    }
+
+    int changed = 0;
+    int failed = 0;
+    for (int i = 0; i < canvas->output_count; i++) {
+        if (canvas->outputs[i].last_result == CANVAS_OUTPUT_NEW) changed++;
+        if (canvas->outputs[i].last_result < 0) failed = 1;
+    }
+    canvas->frames++;
+    platform_mutex_unlock(&canvas->lock);
+
+    return failed ? -1 : changed;
+}
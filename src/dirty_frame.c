@@ -0,0 +1,253 @@
+#include "dirty_frame.h"
+#include "copy_kernels.h"
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+
+#define DIRTY_FRAME_ALIGNMENT 64
+
+int frame_rect_clip(frame_rect_t* rect, int width, int height) {
+    if (!rect) return 0;
+    if (rect->left < 0) rect->left = 0;
+    if (rect->top < 0) rect->top = 0;
+    if (rect->right > width) rect->right = width;
+    if (rect->bottom > height) rect->bottom = height;
+    return rect->right > rect->left && rect->bottom > rect->top;
+}
+
+int frame_rect_area(const frame_rect_t* rect) {
+    if (!rect || rect->right <= rect->left || rect->bottom <= rect->top) return 0;
+    return (rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+static int frame_rect_contains(const frame_rect_t* outer, const frame_rect_t* inner) {
+    return inner->left >= outer->left && inner->right <= outer->right &&
+           inner->top >= outer->top && inner->bottom <= outer->bottom;
+}
+
+static void damage_add(frame_damage_t* damage, const frame_rect_t* rect) {
+    for (int i = 0; i < damage->count; i++) {
+        if (frame_rect_contains(&damage->rects[i], rect)) return;
+    }
+
+    // Drop rects the new one covers entirely
+    for (int i = 0; i < damage->count; ) {
+        if (frame_rect_contains(rect, &damage->rects[i])) {
+            damage->rects[i] = damage->rects[--damage->count];
+        } else {
+            i++;
+        }
+    }
+
+    if (damage->count < DIRTY_FRAME_MAX_RECTS) {
+        damage->rects[damage->count++] = *rect;
+        return;
+    }
+
+    // Too many rects to track individually; fall back to their bounding box
+    frame_rect_t bounds = *rect;
+    for (int i = 0; i < damage->count; i++) {
+        const frame_rect_t* r = &damage->rects[i];
+        if (r->left < bounds.left) bounds.left = r->left;
+        if (r->top < bounds.top) bounds.top = r->top;
+        if (r->right > bounds.right) bounds.right = r->right;
+        if (r->bottom > bounds.bottom) bounds.bottom = r->bottom;
+    }
+    damage->rects[0] = bounds;
+    damage->count = 1;
+}
+
+static frame_damage_t* dirty_frame_begin_update(dirty_frame_t* frame) {
+    frame->generation++;
+    frame->bytes_copied = 0;
+    frame->bytes_moved = 0;
+
+    frame_damage_t* damage = &frame->history[frame->generation % DIRTY_FRAME_HISTORY];
+    damage->count = 0;
+    return damage;
+}
+
+static void copy_rect(uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch,
+                      const frame_rect_t* rect) {
+    size_t offset = (size_t)rect->left * DIRTY_FRAME_BYTES_PER_PIXEL;
+    size_t row_bytes = (size_t)(rect->right - rect->left) * DIRTY_FRAME_BYTES_PER_PIXEL;
+
+    copy_plane(dst + (size_t)rect->top * dst_pitch + offset, dst_pitch,
+               src + (size_t)rect->top * src_pitch + offset, src_pitch,
+               row_bytes, rect->bottom - rect->top, 0);
+}
+
+int dirty_frame_init(dirty_frame_t* frame, int width, int height) {
+    if (!frame || width <= 0 || height <= 0) return -1;
+
+    memset(frame, 0, sizeof(dirty_frame_t));
+    frame->width = width;
+    frame->height = height;
+    frame->stride = (size_t)width * DIRTY_FRAME_BYTES_PER_PIXEL;
+
+    frame->pixels = (uint8_t*)platform_aligned_alloc(frame->stride * (size_t)height, DIRTY_FRAME_ALIGNMENT);
+    if (!frame->pixels) {
+        fprintf(stderr, "Dirty frame: Failed to allocate %dx%d frame\n", width, height);
+        return -1;
+    }
+    memset(frame->pixels, 0, frame->stride * (size_t)height);
+
+    return 0;
+}
+
+void dirty_frame_cleanup(dirty_frame_t* frame) {
+    if (!frame) return;
+    platform_aligned_free(frame->pixels);
+    memset(frame, 0, sizeof(dirty_frame_t));
+}
+
+int dirty_frame_full_update(dirty_frame_t* frame, const uint8_t* src, size_t src_pitch) {
+    if (!frame || !frame->pixels || !src || src_pitch < frame->stride) return -1;
+
+    frame_damage_t* damage = dirty_frame_begin_update(frame);
+    frame_rect_t full = { 0, 0, frame->width, frame->height };
+
+    copy_rect(frame->pixels, frame->stride, src, src_pitch, &full);
+    damage_add(damage, &full);
+
+    frame->bytes_copied = (uint64_t)frame->stride * (uint64_t)frame->height;
+    frame->total_bytes_copied += frame->bytes_copied;
+    return 0;
+}
+
+static uint64_t apply_move(dirty_frame_t* frame, const frame_move_t* move, frame_rect_t* applied) {
+    frame_rect_t dest = move->destination;
+    int dx = dest.left - move->source_x;
+    int dy = dest.top - move->source_y;
+
+    // Clip the destination against the frame and against the shifted source bounds
+    if (!frame_rect_clip(&dest, frame->width, frame->height)) return 0;
+    if (dest.left < dx) dest.left = dx;
+    if (dest.top < dy) dest.top = dy;
+    if (dest.right > frame->width + dx) dest.right = frame->width + dx;
+    if (dest.bottom > frame->height + dy) dest.bottom = frame->height + dy;
+    if (dest.right <= dest.left || dest.bottom <= dest.top) return 0;
+
+    size_t row_bytes = (size_t)(dest.right - dest.left) * DIRTY_FRAME_BYTES_PER_PIXEL;
+    size_t dst_offset = (size_t)dest.left * DIRTY_FRAME_BYTES_PER_PIXEL;
+    size_t src_offset = (size_t)(dest.left - dx) * DIRTY_FRAME_BYTES_PER_PIXEL;
+
+    // Walk rows away from the overlap so source rows are read before being overwritten;
+    // memmove covers horizontal overlap within a row
+    if (dy > 0) {
+        for (int y = dest.bottom - 1; y >= dest.top; y--) {
+            memmove(frame->pixels + (size_t)y * frame->stride + dst_offset,
+                    frame->pixels + (size_t)(y - dy) * frame->stride + src_offset, row_bytes);
+        }
+    } else {
+        for (int y = dest.top; y < dest.bottom; y++) {
+            memmove(frame->pixels + (size_t)y * frame->stride + dst_offset,
+                    frame->pixels + (size_t)(y - dy) * frame->stride + src_offset, row_bytes);
+        }
+    }
+
+    *applied = dest;
+    return (uint64_t)row_bytes * (uint64_t)(dest.bottom - dest.top);
+}
+
+int dirty_frame_apply(dirty_frame_t* frame, const uint8_t* src, size_t src_pitch,
+                      const frame_move_t* moves, int move_count,
+                      const frame_rect_t* dirty, int dirty_count) {
+    if (!frame || !frame->pixels || move_count < 0 || dirty_count < 0) return -1;
+    if ((move_count > 0 && !moves) || (dirty_count > 0 && (!dirty || !src || src_pitch < frame->stride))) return -1;
+
+    // Moves are relative to the previous image, so without one there is nothing to move
+    if (frame->generation == 0 && move_count > 0) return -1;
+
+    frame_damage_t* damage = dirty_frame_begin_update(frame);
+
+    // Moves first, then dirty rects, matching the order DXGI reports them in
+    for (int i = 0; i < move_count; i++) {
+        frame_rect_t applied;
+        uint64_t bytes = apply_move(frame, &moves[i], &applied);
+        if (bytes == 0) continue;
+        frame->bytes_moved += bytes;
+        damage_add(damage, &applied);
+    }
+
+    for (int i = 0; i < dirty_count; i++) {
+        frame_rect_t rect = dirty[i];
+        if (!frame_rect_clip(&rect, frame->width, frame->height)) continue;
+        copy_rect(frame->pixels, frame->stride, src, src_pitch, &rect);
+        frame->bytes_copied += (uint64_t)frame_rect_area(&rect) * DIRTY_FRAME_BYTES_PER_PIXEL;
+        damage_add(damage, &rect);
+    }
+
+    frame->total_bytes_copied += frame->bytes_copied;
+    frame->total_bytes_moved += frame->bytes_moved;
+    return 0;
+}
+
+const frame_rect_t* dirty_frame_changed(const dirty_frame_t* frame, int* count) {
+    if (count) *count = 0;
+    if (!frame || frame->generation == 0) return NULL;
+
+    const frame_damage_t* damage = &frame->history[frame->generation % DIRTY_FRAME_HISTORY];
+    if (count) *count = damage->count;
+    return damage->rects;
+}
+
+static void copy_rect_out(const dirty_frame_t* frame, uint8_t* dst, size_t dst_pitch,
+                          const frame_rect_t* rect, int flip_vertical) {
+    size_t offset = (size_t)rect->left * DIRTY_FRAME_BYTES_PER_PIXEL;
+    size_t row_bytes = (size_t)(rect->right - rect->left) * DIRTY_FRAME_BYTES_PER_PIXEL;
+    int dst_top = flip_vertical ? frame->height - rect->bottom : rect->top;
+
+    copy_plane(dst + (size_t)dst_top * dst_pitch + offset, dst_pitch,
+               frame->pixels + (size_t)rect->top * frame->stride + offset, frame->stride,
+               row_bytes, rect->bottom - rect->top, flip_vertical);
+}
+
+long long dirty_frame_copy_rect(const dirty_frame_t* frame, uint8_t* dst, size_t dst_pitch,
+                                const frame_rect_t* rect, int flip_vertical) {
+    if (!frame || !frame->pixels || !dst || !rect || dst_pitch < frame->stride) return -1;
+
+    frame_rect_t clipped = *rect;
+    if (!frame_rect_clip(&clipped, frame->width, frame->height)) return 0;
+    copy_rect_out(frame, dst, dst_pitch, &clipped, flip_vertical);
+    return (long long)frame_rect_area(&clipped) * DIRTY_FRAME_BYTES_PER_PIXEL;
+}
+
+long long dirty_frame_copy_out(const dirty_frame_t* frame, uint8_t* dst, size_t dst_pitch,
+                               uint64_t dst_generation, int flip_vertical) {
+    if (!frame || !frame->pixels || !dst || dst_pitch < frame->stride) return -1;
+    if (dst_generation >= frame->generation) return 0;
+
+    frame_rect_t full = { 0, 0, frame->width, frame->height };
+    long long full_bytes = (long long)frame->stride * frame->height;
+
+    // Unknown or too stale to catch up from the history: copy everything
+    if (dst_generation == 0 || frame->generation - dst_generation > DIRTY_FRAME_HISTORY) {
+        copy_rect_out(frame, dst, dst_pitch, &full, flip_vertical);
+        return full_bytes;
+    }
+
+    // Merge the damage of every missed update, dropping rects another one already covers
+    frame_damage_t merged;
+    merged.count = 0;
+    for (uint64_t gen = dst_generation + 1; gen <= frame->generation; gen++) {
+        const frame_damage_t* damage = &frame->history[gen % DIRTY_FRAME_HISTORY];
+        for (int i = 0; i < damage->count; i++) {
+            damage_add(&merged, &damage->rects[i]);
+        }
+    }
+
+    long long bytes = 0;
+    for (int i = 0; i < merged.count; i++) {
+        bytes += (long long)frame_rect_area(&merged.rects[i]) * DIRTY_FRAME_BYTES_PER_PIXEL;
+    }
+    if (bytes >= full_bytes) {
+        copy_rect_out(frame, dst, dst_pitch, &full, flip_vertical);
+        return full_bytes;
+    }
+
+    for (int i = 0; i < merged.count; i++) {
+        copy_rect_out(frame, dst, dst_pitch, &merged.rects[i], flip_vertical);
+    }
+    return bytes;
+}
@@ -0,0 +1,244 @@
+#include "dxgi_source.h"
+#include "screen.h"
+#include "desktop_canvas.h"
+#include "copy_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    BOOL virtual_desktop;
+
+    // Single output
+    screen_capture_t screen;
+
+    // Virtual desktop (--monitor all): one capture per output stitched onto a canvas
+    screen_capture_t outputs[DESKTOP_CANVAS_MAX_OUTPUTS];
+    int output_count;
+    desktop_canvas_t canvas;
+    BOOL canvas_delivered;
+    uint64_t canvas_cursor_state;   // Sum of the outputs' cursor generations at the last delivery
+} dxgi_state_t;
+
+// Canvas worker callback: read one output back into its window of the canvas
+static int dxgi_capture_output(void* context, uint8_t* dst, size_t dst_pitch) {
+    int result = screen_capture_into((screen_capture_t*)context, dst, dst_pitch);
+    if (result < 0) return -1;
+    return result == SCREEN_FRAME_NEW ? CANVAS_OUTPUT_NEW : CANVAS_OUTPUT_UNCHANGED;
+}
+
+static void dxgi_cleanup_outputs(dxgi_state_t* state) {
+    // Workers first: they are the only callers of the output captures
+    desktop_canvas_cleanup(&state->canvas);
+    for (int i = 0; i < state->output_count; i++) {
+        screen_stop_capture(&state->outputs[i]);
+        screen_cleanup(&state->outputs[i]);
+    }
+    state->output_count = 0;
+    state->canvas_delivered = FALSE;
+    state->canvas_cursor_state = 0;
+}
+
+static int dxgi_init_outputs(dxgi_state_t* state, BOOL cursor_enabled) {
+    int count = screen_count_outputs();
+    if (count <= 0) return -1;
+    if (count > DESKTOP_CANVAS_MAX_OUTPUTS) count = DESKTOP_CANVAS_MAX_OUTPUTS;
+    
+    canvas_output_desc_t descs[DESKTOP_CANVAS_MAX_OUTPUTS];
+    for (int i = 0; i < count; i++) {
+        if (screen_init_output(&state->outputs[i], i) != 0) {
+            dxgi_cleanup_outputs(state);
+            return -1;
+        }
+        state->output_count = i + 1;
+        screen_set_cursor(&state->outputs[i], cursor_enabled);
+        descs[i].desktop = state->outputs[i].output_bounds;
+        descs[i].capture = dxgi_capture_output;
+        descs[i].context = &state->outputs[i];
+    }
+    
+    if (desktop_canvas_init(&state->canvas, descs, state->output_count) != 0) {
+        dxgi_cleanup_outputs(state);
+        return -1;
+    }
+    
+    printf("Virtual desktop: %d monitors, %dx%d canvas\n", state->output_count, state->canvas.width, state->canvas.height);
+    return 0;
+}
+
+static int dxgi_set_pool(capture_source_t* source, frame_pool_t* pool) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    
+    // Canvas frames are copied out here, so only the single-output capture writes into the pool itself
+    if (!state->virtual_desktop) screen_set_frame_pool(&state->screen, pool);
+    return 0;
+}
+
+static int dxgi_start(capture_source_t* source) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    if (!state->virtual_desktop) return screen_start_capture(&state->screen);
+    
+    for (int i = 0; i < state->output_count; i++) {
+        if (screen_start_capture(&state->outputs[i]) != 0) return -1;
+    }
+    return 0;
+}
+
+// Next frame from the stitched canvas
+static int dxgi_get_canvas_frame(capture_source_t* source, dxgi_state_t* state, frame_handle_t* frame, int top_down) {
+    int changed = desktop_canvas_capture(&state->canvas);
+    if (changed < 0) return -1;
+    
+    // Workers are idle between captures, so the output cursors can be read here
+    uint64_t cursor_state = 0;
+    for (int i = 0; i < state->output_count; i++) {
+        if (state->outputs[i].cursor_enabled) cursor_state += state->outputs[i].cursor.generation;
+    }
+    if (changed == 0 && (!state->canvas_delivered || cursor_state == state->canvas_cursor_state)) {
+        return state->canvas_delivered ? CAPTURE_FRAME_REPEAT : CAPTURE_FRAME_NONE;
+    }
+    
+    frame_handle_t handle = frame_pool_acquire(source->pool);
+    if (handle == FRAME_HANDLE_INVALID) return CAPTURE_FRAME_NONE;
+    
+    desktop_canvas_t* canvas = &state->canvas;
+    uint8_t* dst = (uint8_t*)frame_pool_data(source->pool, handle);
+    copy_plane(dst, canvas->stride, canvas->pixels, canvas->stride, canvas->stride, canvas->height, !top_down);
+    
+    // The canvas stays cursor-free; the pointer is drawn on the delivered copy only
+    for (int i = 0; i < state->output_count; i++) {
+        if (!state->outputs[i].cursor_enabled) continue;
+        cursor_compositor_draw(&state->outputs[i].cursor, dst, canvas->stride, canvas->width, canvas->height,
+                               state->outputs[i].output_bounds.x - canvas->origin_x,
+                               state->outputs[i].output_bounds.y - canvas->origin_y, !top_down, NULL);
+    }
+    
+    state->canvas_delivered = TRUE;
+    state->canvas_cursor_state = cursor_state;
+    *frame = handle;
+    return CAPTURE_FRAME_NEW;
+}
+
+static int dxgi_get_frame(capture_source_t* source, frame_handle_t* frame, int top_down) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    if (state->virtual_desktop) return dxgi_get_canvas_frame(source, state, frame, top_down);
+    return screen_get_frame_dual_track(&state->screen, frame, top_down ? TRUE : FALSE);
+}
+
+static void dxgi_stop(capture_source_t* source) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    if (!state->virtual_desktop) {
+        screen_stop_capture(&state->screen);
+        return;
+    }
+    
+    // Workers only touch their output inside desktop_canvas_capture, so they are idle here
+    for (int i = 0; i < state->output_count; i++) {
+        screen_stop_capture(&state->outputs[i]);
+    }
+}
+
+// Readback totals of every active capture, and cursor shape traffic
+static void dxgi_report(capture_source_t* source, capture_report_fn report) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    const screen_capture_t* captures = state->virtual_desktop ? state->outputs : &state->screen;
+    int count = state->virtual_desktop ? state->output_count : 1;
+    char message[256];
+    
+    double full_mb = 0.0, read_mb = 0.0, moved_mb = 0.0;
+    uint64_t shape_updates = 0, cache_hits = 0;
+    uint64_t staged = 0, stalls = 0;
+    for (int i = 0; i < count; i++) {
+        const dirty_frame_t* dirty = &captures[i].dirty_frame;
+        full_mb += (double)dirty->generation * dirty->stride * dirty->height / (1024.0 * 1024.0);
+        read_mb += (double)dirty->total_bytes_copied / (1024.0 * 1024.0);
+        moved_mb += (double)dirty->total_bytes_moved / (1024.0 * 1024.0);
+        shape_updates += captures[i].cursor.shape_updates;
+        cache_hits += captures[i].cursor.cache_hits;
+        staged += captures[i].readback_ring.retired;
+        stalls += captures[i].readback_ring.stalls;
+    }
+    
+    sprintf(message, "Readback: %.1f MB of %.1f MB full-frame (%.1f%%), %.1f MB moved in place",
+            read_mb, full_mb, full_mb > 0.0 ? 100.0 * read_mb / full_mb : 0.0, moved_mb);
+    report(message);
+    
+    sprintf(message, "Staging ring: %llu updates read back, %llu waited on the GPU",
+            (unsigned long long)staged, (unsigned long long)stalls);
+    report(message);
+    
+    if (shape_updates > 0) {
+        sprintf(message, "Cursor: %llu shape changes, %llu from cache",
+                (unsigned long long)shape_updates, (unsigned long long)cache_hits);
+        report(message);
+    }
+}
+
+static void dxgi_destroy(capture_source_t* source) {
+    dxgi_state_t* state = (dxgi_state_t*)source->impl;
+    if (!state) return;
+    
+    if (state->virtual_desktop) {
+        dxgi_cleanup_outputs(state);
+    } else {
+        screen_stop_capture(&state->screen);
+        screen_cleanup(&state->screen);
+    }
+    free(state);
+    source->impl = NULL;
+}
+
+static const capture_source_ops_t dxgi_ops = {
+    "dxgi",
+    dxgi_set_pool,
+    dxgi_start,
+    dxgi_get_frame,
+    dxgi_stop,
+    dxgi_report,
+    dxgi_destroy
+};
+
+int dxgi_source_create(capture_source_t* source, const dxgi_source_config_t* config) {
+    if (!source || !config) return -1;
+    memset(source, 0, sizeof(capture_source_t));
+    
+    // Region coordinates are per monitor; a stitched canvas has no single monitor to crop
+    if (config->virtual_desktop && config->region_enabled) {
+        fprintf(stderr, "A capture region cannot be combined with virtual desktop capture\n");
+        return -1;
+    }
+    
+    dxgi_state_t* state = (dxgi_state_t*)calloc(1, sizeof(dxgi_state_t));
+    if (!state) return -1;
+    state->virtual_desktop = config->virtual_desktop;
+    
+    if (config->virtual_desktop) {
+        if (dxgi_init_outputs(state, config->cursor_enabled) != 0) {
+            free(state);
+            return -1;
+        }
+        source->width = state->canvas.width;
+        source->height = state->canvas.height;
+    } else {
+        if (screen_init_output(&state->screen, config->monitor_index) != 0) {
+            free(state);
+            return -1;
+        }
+        
+        // Only the requested region is read back and encoded
+        if (config->region_enabled &&
+            screen_set_region(&state->screen, config->region_x, config->region_y, config->region_w, config->region_h) != 0) {
+            fprintf(stderr, "Capture region does not fit the desktop\n");
+            screen_cleanup(&state->screen);
+            free(state);
+            return -1;
+        }
+        screen_set_cursor(&state->screen, config->cursor_enabled);
+        source->width = state->screen.region.width;
+        source->height = state->screen.region.height;
+    }
+    
+    source->ops = &dxgi_ops;
+    source->impl = state;
+    return 0;
+}
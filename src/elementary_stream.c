@@ -0,0 +1,263 @@
+#include "elementary_stream.h"
+#include <string.h>
+
+static const uint32_t aac_sample_rates[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+#define AAC_SAMPLE_RATE_COUNT (int)(sizeof(aac_sample_rates) / sizeof(aac_sample_rates[0]))
+
+// ---------------------------------------------------------------------------
+// H.264
+// ---------------------------------------------------------------------------
+
+// Offset of the byte after the next 00 00 01 at or after start, or size
+static size_t h264_find_start_code(const uint8_t* data, size_t size, size_t start) {
+    for (size_t i = start; i + 3 <= size; i++) {
+        if (data[i + 2] > 1) {
+            i += 2;
+        } else if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            return i + 3;
+        }
+    }
+    return size;
+}
+
+int h264_next_nal(const uint8_t* data, size_t size, size_t* offset, const uint8_t** nal, size_t* nal_size) {
+    if (!data || !offset || !nal || !nal_size) return 0;
+
+    size_t begin = h264_find_start_code(data, size, *offset);
+    if (begin >= size) {
+        *offset = size;
+        return 0;
+    }
+    size_t next = h264_find_start_code(data, size, begin);
+    size_t end = next >= size ? size : next - 3;
+    *offset = end;
+
+    // Zero bytes before the next start code belong to it (4-byte start codes, trailing_zero_8bits)
+    while (end > begin && data[end - 1] == 0) end--;
+    *nal = data + begin;
+    *nal_size = end - begin;
+    return 1;
+}
+
+int h264_is_keyframe(const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    const uint8_t* nal;
+    size_t nal_size;
+    while (h264_next_nal(data, size, &offset, &nal, &nal_size)) {
+        if (nal_size > 0 && H264_NAL_TYPE(nal[0]) == H264_NAL_IDR) return 1;
+    }
+    return 0;
+}
+
+// Bit reader over an RBSP; emulation prevention bytes (00 00 03) are skipped
+// as they are read
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t byte;
+    int bit;
+    int zeros;                      // Consecutive zero bytes before the current one
+    int overrun;
+} h264_bit_reader_t;
+
+static void h264_bits_init(h264_bit_reader_t* reader, const uint8_t* data, size_t size) {
+    memset(reader, 0, sizeof(h264_bit_reader_t));
+    reader->data = data;
+    reader->size = size;
+}
+
+static unsigned int h264_read_bit(h264_bit_reader_t* reader) {
+    if (reader->bit == 0) {
+        if (reader->byte < reader->size && reader->zeros >= 2 && reader->data[reader->byte] == 3) {
+            reader->byte++;
+            reader->zeros = 0;
+        }
+    }
+    if (reader->byte >= reader->size) {
+        reader->overrun = 1;
+        return 0;
+    }
+    uint8_t value = reader->data[reader->byte];
+    unsigned int bit = (value >> (7 - reader->bit)) & 1;
+    if (++reader->bit == 8) {
+        reader->bit = 0;
+        reader->zeros = value == 0 ? reader->zeros + 1 : 0;
+        reader->byte++;
+    }
+    return bit;
+}
+
+static uint32_t h264_read_bits(h264_bit_reader_t* reader, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++) value = value << 1 | h264_read_bit(reader);
+    return value;
+}
+
+// Exp-Golomb ue(v); values past 32 bits mark the reader as overrun
+static uint32_t h264_read_ue(h264_bit_reader_t* reader) {
+    int leading = 0;
+    while (h264_read_bit(reader) == 0) {
+        if (reader->overrun || ++leading > 31) {
+            reader->overrun = 1;
+            return 0;
+        }
+    }
+    return ((1u << leading) - 1) + h264_read_bits(reader, leading);
+}
+
+static int32_t h264_read_se(h264_bit_reader_t* reader) {
+    uint32_t value = h264_read_ue(reader);
+    return (value & 1) ? (int32_t)((value + 1) / 2) : -(int32_t)(value / 2);
+}
+
+static void h264_skip_scaling_list(h264_bit_reader_t* reader, int size) {
+    int last = 8, next = 8;
+    for (int j = 0; j < size && !reader->overrun; j++) {
+        if (next != 0) next = (last + h264_read_se(reader) + 256) % 256;
+        if (next != 0) last = next;
+    }
+}
+
+static int h264_profile_has_chroma_info(int profile_idc) {
+    switch (profile_idc) {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int h264_parse_sps(const uint8_t* nal, size_t size, h264_sps_info_t* info) {
+    if (!nal || !info || size < 4 || H264_NAL_TYPE(nal[0]) != H264_NAL_SPS) return -1;
+    memset(info, 0, sizeof(h264_sps_info_t));
+
+    h264_bit_reader_t reader;
+    h264_bits_init(&reader, nal + 1, size - 1);
+    info->profile_idc = (int)h264_read_bits(&reader, 8);
+    info->constraint_flags = (int)h264_read_bits(&reader, 8);
+    info->level_idc = (int)h264_read_bits(&reader, 8);
+    h264_read_ue(&reader);                                  // seq_parameter_set_id
+
+    info->chroma_format_idc = 1;
+    info->bit_depth_luma = 8;
+    info->bit_depth_chroma = 8;
+    int separate_colour_planes = 0;
+    if (h264_profile_has_chroma_info(info->profile_idc)) {
+        info->chroma_format_idc = (int)h264_read_ue(&reader);
+        if (info->chroma_format_idc == 3) separate_colour_planes = (int)h264_read_bit(&reader);
+        info->bit_depth_luma = 8 + (int)h264_read_ue(&reader);
+        info->bit_depth_chroma = 8 + (int)h264_read_ue(&reader);
+        h264_read_bit(&reader);                             // qpprime_y_zero_transform_bypass_flag
+        if (h264_read_bit(&reader)) {                       // seq_scaling_matrix_present_flag
+            int lists = info->chroma_format_idc == 3 ? 12 : 8;
+            for (int i = 0; i < lists; i++) {
+                if (h264_read_bit(&reader)) h264_skip_scaling_list(&reader, i < 6 ? 16 : 64);
+            }
+        }
+    }
+
+    h264_read_ue(&reader);                                  // log2_max_frame_num_minus4
+    uint32_t poc_type = h264_read_ue(&reader);
+    if (poc_type == 0) {
+        h264_read_ue(&reader);                              // log2_max_pic_order_cnt_lsb_minus4
+    } else if (poc_type == 1) {
+        h264_read_bit(&reader);                             // delta_pic_order_always_zero_flag
+        h264_read_se(&reader);                              // offset_for_non_ref_pic
+        h264_read_se(&reader);                              // offset_for_top_to_bottom_field
+        uint32_t cycle = h264_read_ue(&reader);
+        for (uint32_t i = 0; i < cycle && !reader.overrun; i++) h264_read_se(&reader);
+    }
+    h264_read_ue(&reader);                                  // max_num_ref_frames
+    h264_read_bit(&reader);                                 // gaps_in_frame_num_value_allowed_flag
+
+    uint32_t width_mbs = h264_read_ue(&reader) + 1;
+    uint32_t height_map_units = h264_read_ue(&reader) + 1;
+    int frame_mbs_only = (int)h264_read_bit(&reader);
+    if (!frame_mbs_only) h264_read_bit(&reader);            // mb_adaptive_frame_field_flag
+    h264_read_bit(&reader);                                 // direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (h264_read_bit(&reader)) {
+        crop_left = h264_read_ue(&reader);
+        crop_right = h264_read_ue(&reader);
+        crop_top = h264_read_ue(&reader);
+        crop_bottom = h264_read_ue(&reader);
+    }
+    if (reader.overrun || width_mbs > 1024 || height_map_units > 1024) return -1;
+
+    // Crop offsets count chroma samples (and field pairs for interlaced streams)
+    int chroma_array_type = separate_colour_planes ? 0 : info->chroma_format_idc;
+    uint32_t unit_x = 1, unit_y = (uint32_t)(2 - frame_mbs_only);
+    if (chroma_array_type != 0) {
+        unit_x = chroma_array_type == 3 ? 1 : 2;
+        unit_y *= chroma_array_type == 1 ? 2 : 1;
+    }
+    long width = (long)width_mbs * 16 - (long)unit_x * (crop_left + crop_right);
+    long height = (long)height_map_units * 16 * (2 - frame_mbs_only) - (long)unit_y * (crop_top + crop_bottom);
+    if (width <= 0 || height <= 0) return -1;
+
+    info->width = (int)width;
+    info->height = (int)height;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// AAC
+// ---------------------------------------------------------------------------
+
+int aac_sample_rate_index(uint32_t sample_rate) {
+    for (int i = 0; i < AAC_SAMPLE_RATE_COUNT; i++) {
+        if (aac_sample_rates[i] == sample_rate) return i;
+    }
+    return -1;
+}
+
+int aac_adts_parse(const uint8_t* data, size_t size, aac_adts_header_t* header) {
+    if (!data || !header || size < AAC_ADTS_HEADER_SIZE) return -1;
+    memset(header, 0, sizeof(aac_adts_header_t));
+
+    // syncword 0xFFF, layer 0
+    if (data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) return -1;
+
+    int protection_absent = data[1] & 1;
+    header->object_type = ((data[2] >> 6) & 3) + 1;
+    header->sample_rate_index = (data[2] >> 2) & 0xF;
+    header->channels = (data[2] & 1) << 2 | data[3] >> 6;
+    header->header_size = protection_absent ? AAC_ADTS_HEADER_SIZE : AAC_ADTS_HEADER_SIZE + 2;
+    header->frame_size = (size_t)(data[3] & 3) << 11 | (size_t)data[4] << 3 | data[5] >> 5;
+    if (header->sample_rate_index >= AAC_SAMPLE_RATE_COUNT || header->frame_size < header->header_size) return -1;
+    header->sample_rate = aac_sample_rates[header->sample_rate_index];
+
+    return header->frame_size > size ? 1 : 0;
+}
+
+int aac_adts_write_header(uint8_t header[AAC_ADTS_HEADER_SIZE], int object_type, uint32_t sample_rate,
+                          int channels, size_t payload_size) {
+    int index = aac_sample_rate_index(sample_rate);
+    size_t frame_size = payload_size + AAC_ADTS_HEADER_SIZE;
+    if (!header || index < 0 || object_type < 1 || object_type > 4 || channels < 1 || channels > 7 ||
+        frame_size > 0x1FFF) {
+        return -1;
+    }
+
+    header[0] = 0xFF;
+    header[1] = 0xF1;                                       // MPEG-4, layer 0, no CRC
+    header[2] = (uint8_t)((object_type - 1) << 6 | index << 2 | channels >> 2);
+    header[3] = (uint8_t)((channels & 3) << 6 | (int)(frame_size >> 11));
+    header[4] = (uint8_t)(frame_size >> 3);
+    header[5] = (uint8_t)((frame_size & 7) << 5 | 0x1F);   // Buffer fullness 0x7FF (variable rate)
+    header[6] = 0xFC;
+    return 0;
+}
+
+int aac_audio_specific_config(int object_type, uint32_t sample_rate, int channels, uint8_t config[2]) {
+    int index = aac_sample_rate_index(sample_rate);
+    if (!config || index < 0 || object_type < 1 || object_type > 30 || channels < 1 || channels > 7) return -1;
+    config[0] = (uint8_t)(object_type << 3 | index >> 1);
+    config[1] = (uint8_t)((index & 1) << 7 | channels << 3);
+    return 0;
+}
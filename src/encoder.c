@@ -22,40 +22,115 @@ DEFINE_GUID(MF_SINK_WRITER_DISABLE_THROTTLING, 0x08b845d8, 0x2b74, 0x4afe, 0x9d,
 DEFINE_GUID(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, 0xa634a91c, 0x822b, 0x41b9, 0xa4, 0x94, 0x4d, 0xe4, 0x64, 0x36, 0x12, 0xb0);
 DEFINE_GUID(MF_TRANSCODE_CONTAINERTYPE, 0x150ff23f, 0x4abc, 0x478b, 0xac, 0x4f, 0xe1, 0x91, 0x6f, 0xba, 0x1c, 0xca);
 DEFINE_GUID(MFTranscodeContainerType_MPEG4, 0xdc6cd05d, 0xb9d0, 0x40ef, 0xbd, 0x35, 0xfa, 0x62, 0x2a, 0x1a, 0xb0, 0x26);
+DEFINE_GUID(MFTranscodeContainerType_FMPEG4, 0x9ba876f1, 0x419f, 0x4b77, 0xa1, 0xe0, 0x35, 0x95, 0x9d, 0x9d, 0x40, 0x04);
 
-// Windows Media Foundation encoding implementation
-static IMFSinkWriter* g_sink_writer = NULL;
-static DWORD g_video_stream_index = 0;
-static DWORD g_audio_stream_index = 0;
-static DWORD g_system_audio_stream_index = 0; // For dual-track mode
-static DWORD g_mic_audio_stream_index = 0;    // For dual-track mode
-static BOOL g_dual_track_mode = FALSE;
-static UINT64 g_video_frame_count = 0;
-static UINT64 g_audio_sample_count = 0;
-static UINT64 g_system_audio_sample_count = 0; // For dual-track mode
-static UINT64 g_mic_audio_sample_count = 0;    // For dual-track mode
-static UINT32 g_video_width = 0;
-static UINT32 g_video_height = 0;
-static UINT32 g_video_fps = 30;
-static UINT32 g_audio_sample_rate = 44100; // Store actual sample rate for accurate timing
-static DWORD g_recording_start_time = 0; // For real-time timestamps
-static LONGLONG g_last_video_timestamp = 0; // Track last video timestamp for duration calculation
+// Windows Media Foundation encoding implementation. Everything a recording
+// needs lives in its encoder_context_t, so recordings in one process are
+// independent; Media Foundation itself is reference counted per process.
+
+// eAVEncH264VProfile_High and eAVEncH264VLevel5_2 (codecapi.h)
+#define ENCODER_H264_PROFILE_HIGH 100
+#define ENCODER_H264_LEVEL_5_2 52
 
 // Define standard container timescale for proper MP4 timing
 #define STANDARD_CONTAINER_TIMESCALE 30000  // Use 30000 (30 FPS * 1000) for consistent timing
 
-// Global timescale override for audio-only mode
-static UINT32 g_container_timescale = 30000;
+void encoder_set_video_input(encoder_context_t* context, encoder_input_format_t format, color_matrix_t matrix, color_range_t range) {
+    if (!context) return;
+    context->settings.video_input = format;
+    context->settings.color_matrix = matrix;
+    context->settings.color_range = range;
+}
 
-int encoder_init(encoder_context_t* context, const char* filename, int width, int height, int fps,
-             int sample_rate, int channels, int bits_per_sample) {
-    if (!context || !filename) return -1;
-    
+void encoder_set_frame_timing(encoder_context_t* context, frame_timing_t timing) {
+    if (context) context->settings.frame_timing = timing;
+}
+
+void encoder_set_container(encoder_context_t* context, encoder_container_t container) {
+    if (context) context->settings.container = container;
+}
+
+static const GUID* encoder_container_type(const encoder_context_t* context) {
+    return context->settings.container == ENCODER_CONTAINER_FRAGMENTED_MP4 ? &MFTranscodeContainerType_FMPEG4
+                                                                            : &MFTranscodeContainerType_MPEG4;
+}
+
+// A new file: everything but the settings starts from zero, so a segment
+// rollover keeps the input format and timing of the first file
+static void encoder_reset_context(encoder_context_t* context, const char* filename,
+                                  int sample_rate, int channels, int bits_per_sample) {
+    encoder_settings_t settings = context->settings;
     memset(context, 0, sizeof(encoder_context_t));
+    context->settings = settings;
     context->output_filename = filename;
     context->input_sample_rate = sample_rate;
     context->input_channels = channels;
     context->input_bits_per_sample = bits_per_sample;
+}
+
+// Bytes of one input frame as handed to encoder_add_video_frame
+static DWORD encoder_video_frame_bytes(const encoder_context_t* context) {
+    if (context->settings.video_input == ENCODER_INPUT_NV12) {
+        return (DWORD)color_frame_size(COLOR_FORMAT_NV12, context->video_width, context->video_height);
+    }
+    return (DWORD)context->video_width * (DWORD)context->video_height * 4; // BGRA = 4 bytes per pixel
+}
+
+// Matrix and nominal range for YUV media types; must match what color_convert produced
+static HRESULT encoder_set_color_attributes(const encoder_context_t* context, IMFMediaType* type) {
+    HRESULT hr = IMFMediaType_SetUINT32(type, &MF_MT_VIDEO_NOMINAL_RANGE,
+                                        context->settings.color_range == COLOR_RANGE_FULL ? MFNominalRange_0_255 : MFNominalRange_16_235);
+    if (FAILED(hr)) return hr;
+    return IMFMediaType_SetUINT32(type, &MF_MT_YUV_MATRIX,
+                                  context->settings.color_matrix == COLOR_MATRIX_BT709 ? MFVideoTransferMatrix_BT709 : MFVideoTransferMatrix_BT601);
+}
+
+// Input subtype plus, for NV12, a top-down stride and the colour space
+static HRESULT encoder_set_video_input_type(const encoder_context_t* context, IMFMediaType* type, int width) {
+    if (context->settings.video_input != ENCODER_INPUT_NV12) {
+        return IMFMediaType_SetGUID(type, &MF_MT_SUBTYPE, &MFVideoFormat_ARGB32);
+    }
+    
+    HRESULT hr = IMFMediaType_SetGUID(type, &MF_MT_SUBTYPE, &MFVideoFormat_NV12);
+    if (FAILED(hr)) return hr;
+    hr = IMFMediaType_SetUINT32(type, &MF_MT_DEFAULT_STRIDE, (UINT32)width);
+    if (FAILED(hr)) return hr;
+    return encoder_set_color_attributes(context, type);
+}
+
+// Bitrate by resolution at 30 fps, scaled 1.5x at 60 fps and 4.5x at 240 fps. Frames at high
+// rates differ less from each other, so the rate grows slower than the frame count.
+static UINT32 encoder_video_bitrate(int width, int fps) {
+    UINT32 bitrate;
+    if (width >= 1920) {
+        bitrate = 1200000; // 1.2 Mbps for 1080p+
+    } else if (width >= 1280) {
+        bitrate = 800000;  // 800 Kbps for 720p
+    } else {
+        bitrate = 500000;  // 500 Kbps for lower res
+    }
+    if (fps > 30) {
+        bitrate = (UINT32)((UINT64)bitrate * (UINT32)(fps + 30) / 60);
+    }
+    return bitrate;
+}
+
+// Above 60 fps the encoder's default level (4.2 tops out at 1080p64) rejects or caps the stream;
+// High profile at level 5.2 covers 1080p240 and 4K60
+static void encoder_set_h264_level(IMFMediaType* type, int fps) {
+    if (fps <= 60) return;
+    HRESULT hr = IMFMediaType_SetUINT32(type, &MF_MT_MPEG2_PROFILE, ENCODER_H264_PROFILE_HIGH);
+    if (SUCCEEDED(hr)) hr = IMFMediaType_SetUINT32(type, &MF_MT_MPEG2_LEVEL, ENCODER_H264_LEVEL_5_2);
+    if (FAILED(hr)) {
+        fprintf(stderr, "Warning: Failed to set H.264 level for %d fps: 0x%08X\n", fps, hr);
+    }
+}
+
+int encoder_init(encoder_context_t* context, const char* filename, int width, int height, int fps,
+             int sample_rate, int channels, int bits_per_sample) {
+    if (!context || !filename) return -1;
+    
+    encoder_reset_context(context, filename, sample_rate, channels, bits_per_sample);
     
     // Determine if we should include audio based on valid parameters
     BOOL include_audio = (sample_rate > 0 && channels > 0 && bits_per_sample > 0);
@@ -94,7 +169,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
     }
     
     // CRITICAL FIX: Set MP4 container type for proper moov atom generation
-    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, &MFTranscodeContainerType_MPEG4);
+    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, encoder_container_type(context));
     if (FAILED(hr)) {
         fprintf(stderr, "Warning: Failed to set MP4 container type: 0x%08X\n", hr);
     }
@@ -114,7 +189,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
         fprintf(stderr, "Warning: Failed to enable hardware transforms: 0x%08X\n", hr);
     }
     
-    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &g_sink_writer);
+    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to create sink writer: 0x%08X\n", hr);
         IMFAttributes_Release(attributes);
@@ -133,14 +208,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
     if (FAILED(hr)) goto cleanup;
     
     // Optimized bitrate - adaptive based on resolution and fps
-    UINT32 optimized_bitrate;
-    if (width >= 1920) {
-        optimized_bitrate = 1200000; // 1.2 Mbps for 1080p+
-    } else if (width >= 1280) {
-        optimized_bitrate = 800000;  // 800 Kbps for 720p
-    } else {
-        optimized_bitrate = 500000;  // 500 Kbps for lower res
-    }
+    UINT32 optimized_bitrate = encoder_video_bitrate(width, fps);
     
     hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_AVG_BITRATE, optimized_bitrate);
     if (FAILED(hr)) goto cleanup;
@@ -154,12 +222,18 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
     hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
     if (FAILED(hr)) goto cleanup;
     
-    hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_VIDEO_NOMINAL_RANGE, MFNominalRange_0_255);
+    encoder_set_h264_level(video_type_out, fps);
+    
+    if (context->settings.video_input == ENCODER_INPUT_NV12) {
+        hr = encoder_set_color_attributes(context, video_type_out);
+    } else {
+        hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_VIDEO_NOMINAL_RANGE, MFNominalRange_0_255);
+    }
     if (FAILED(hr)) {
         DEBUG_PRINT("Warning: Failed to set nominal range: 0x%08X\n", hr);
     }
     
-    hr = IMFSinkWriter_AddStream(g_sink_writer, video_type_out, &g_video_stream_index);
+    hr = IMFSinkWriter_AddStream(context->sink_writer, video_type_out, &context->video_stream_index);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to add video stream: 0x%08X\n", hr);
         goto cleanup;
@@ -171,7 +245,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
     hr = IMFMediaType_SetGUID(video_type_in, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
     if (FAILED(hr)) goto cleanup;
     
-    hr = IMFMediaType_SetGUID(video_type_in, &MF_MT_SUBTYPE, &MFVideoFormat_ARGB32);
+    hr = encoder_set_video_input_type(context, video_type_in, width);
     if (FAILED(hr)) goto cleanup;
     
     hr = IMFMediaType_SetUINT64(video_type_in, &MF_MT_FRAME_SIZE, ((UINT64)width << 32) | height);
@@ -183,7 +257,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
     hr = IMFMediaType_SetUINT32(video_type_in, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
     if (FAILED(hr)) goto cleanup;
     
-    hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_video_stream_index, video_type_in, NULL);
+    hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->video_stream_index, video_type_in, NULL);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set video input type: 0x%08X\n", hr);
         goto cleanup;
@@ -214,7 +288,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
         DEBUG_PRINT("Audio output: Using AAC compression\n");
         
         // Add audio stream
-        hr = IMFSinkWriter_AddStream(g_sink_writer, audio_type_out, &g_audio_stream_index);
+        hr = IMFSinkWriter_AddStream(context->sink_writer, audio_type_out, &context->audio_stream_index);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to add audio stream: 0x%08X\n", hr);
             goto cleanup;
@@ -253,7 +327,7 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
         if (FAILED(hr)) goto cleanup;
         
         // Set input type for audio stream
-        hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_audio_stream_index, audio_type_in, NULL);
+        hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->audio_stream_index, audio_type_in, NULL);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to set audio input type: 0x%08X\n", hr);
             goto cleanup;
@@ -262,23 +336,22 @@ int encoder_init(encoder_context_t* context, const char* filename, int width, in
         printf("Audio stream configured: %d Hz, %d channels, %d bits\n", sample_rate, channels, bits_per_sample);
     } else {
         printf("Skipping audio stream configuration (video-only)\n");
-        g_audio_stream_index = (DWORD)-1; // Mark as invalid
+        context->audio_stream_index = (DWORD)-1; // Mark as invalid
     }
     
     // Begin writing
-    hr = IMFSinkWriter_BeginWriting(g_sink_writer);
+    hr = IMFSinkWriter_BeginWriting(context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to begin writing: 0x%08X\n", hr);
         goto cleanup;
     }
     
-    // Store global parameters
-    g_video_width = width;
-    g_video_height = height;
-    g_video_fps = fps;
-    g_audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
-    g_video_frame_count = 0;
-    g_audio_sample_count = 0;
+    // Video format of this file
+    context->video_width = width;
+    context->video_height = height;
+    context->video_fps = fps;
+    context->audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
+    frame_timeline_init(&context->video_timeline, context->settings.frame_timing, fps);
     
     context->is_recording = TRUE;
     // Don't set recording start time here - it will be set when capture actually begins
@@ -300,9 +373,9 @@ cleanup:
     if (audio_type_out) IMFMediaType_Release(audio_type_out);
     if (audio_type_in) IMFMediaType_Release(audio_type_in);
     if (attributes) IMFAttributes_Release(attributes);
-    if (g_sink_writer) {
-        IMFSinkWriter_Release(g_sink_writer);
-        g_sink_writer = NULL;
+    if (context->sink_writer) {
+        IMFSinkWriter_Release(context->sink_writer);
+        context->sink_writer = NULL;
     }
     free(wide_filename);
     MFShutdown();
@@ -314,16 +387,9 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
                         int sample_rate, int channels, int bits_per_sample) {
     if (!context || !filename) return -1;
     
-    memset(context, 0, sizeof(encoder_context_t));
-    context->output_filename = filename;
-    context->input_sample_rate = sample_rate;
-    context->input_channels = channels;
-    context->input_bits_per_sample = bits_per_sample;
+    encoder_reset_context(context, filename, sample_rate, channels, bits_per_sample);
     context->dual_track_mode = TRUE;
     
-    // Set global dual-track mode
-    g_dual_track_mode = TRUE;
-    
     // Determine if we should include audio based on valid parameters
     BOOL include_audio = (sample_rate > 0 && channels > 0 && bits_per_sample > 0);
     if (!include_audio) {
@@ -340,13 +406,11 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     IMFMediaType* mic_audio_type_in = NULL;
     IMFAttributes* attributes = NULL;
     
-    // Initialize global state
-    g_video_frame_count = 0;
-    g_system_audio_sample_count = 0;
-    g_mic_audio_sample_count = 0;
-    g_video_width = width;
-    g_video_height = height;
-    g_video_fps = fps;
+    // Video format of this file
+    context->video_width = width;
+    context->video_height = height;
+    context->video_fps = fps;
+    frame_timeline_init(&context->video_timeline, context->settings.frame_timing, fps);
     
     printf("Media Foundation muxer initialized (dual-track): %dx%d @ %d fps, output: %s\n", 
            width, height, fps, filename);
@@ -378,7 +442,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     }
     
     // CRITICAL FIX: Set MP4 container type for proper moov atom generation
-    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, &MFTranscodeContainerType_MPEG4);
+    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, encoder_container_type(context));
     if (FAILED(hr)) {
         fprintf(stderr, "Warning: Failed to set MP4 container type: 0x%08X\n", hr);
     }
@@ -400,7 +464,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     }
     
     // Create sink writer
-    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &g_sink_writer);
+    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to create sink writer: 0x%08X\n", hr);
         IMFAttributes_Release(attributes);
@@ -420,14 +484,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     if (FAILED(hr)) goto cleanup_dual;
     
     // Optimized bitrate - adaptive based on resolution and fps
-    UINT32 optimized_bitrate;
-    if (width >= 1920) {
-        optimized_bitrate = 1200000; // 1.2 Mbps for 1080p+
-    } else if (width >= 1280) {
-        optimized_bitrate = 800000;  // 800 Kbps for 720p
-    } else {
-        optimized_bitrate = 500000;  // 500 Kbps for lower res
-    }
+    UINT32 optimized_bitrate = encoder_video_bitrate(width, fps);
     
     hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_AVG_BITRATE, optimized_bitrate);
     if (FAILED(hr)) goto cleanup_dual;
@@ -442,21 +499,30 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     hr = IMFMediaType_SetUINT32(video_type_out, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
     if (FAILED(hr)) goto cleanup_dual;
     
+    encoder_set_h264_level(video_type_out, fps);
+    
+    if (context->settings.video_input == ENCODER_INPUT_NV12) {
+        hr = encoder_set_color_attributes(context, video_type_out);
+        if (FAILED(hr)) {
+            DEBUG_PRINT("Warning: Failed to set colour attributes: 0x%08X\n", hr);
+        }
+    }
+    
     // Add video stream
-    hr = IMFSinkWriter_AddStream(g_sink_writer, video_type_out, &g_video_stream_index);
+    hr = IMFSinkWriter_AddStream(context->sink_writer, video_type_out, &context->video_stream_index);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to add video stream: 0x%08X\n", hr);
         goto cleanup_dual;
     }
     
-    // Configure video input type (ARGB32)
+    // Configure video input type (ARGB32 or NV12)
     hr = MFCreateMediaType(&video_type_in);
     if (FAILED(hr)) goto cleanup_dual;
     
     hr = IMFMediaType_SetGUID(video_type_in, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
     if (FAILED(hr)) goto cleanup_dual;
     
-    hr = IMFMediaType_SetGUID(video_type_in, &MF_MT_SUBTYPE, &MFVideoFormat_ARGB32);
+    hr = encoder_set_video_input_type(context, video_type_in, width);
     if (FAILED(hr)) goto cleanup_dual;
     
     hr = IMFMediaType_SetUINT64(video_type_in, &MF_MT_FRAME_SIZE, ((UINT64)width << 32) | height);
@@ -469,7 +535,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
     if (FAILED(hr)) goto cleanup_dual;
     
     // Set input type for video stream
-    hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_video_stream_index, video_type_in, NULL);
+    hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->video_stream_index, video_type_in, NULL);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set video input type: 0x%08X\n", hr);
         goto cleanup_dual;
@@ -500,7 +566,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
         if (FAILED(hr)) goto cleanup_dual;
         
         // Add system audio stream
-        hr = IMFSinkWriter_AddStream(g_sink_writer, system_audio_type_out, &g_system_audio_stream_index);
+        hr = IMFSinkWriter_AddStream(context->sink_writer, system_audio_type_out, &context->system_audio_stream_index);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to add system audio stream: 0x%08X\n", hr);
             goto cleanup_dual;
@@ -529,7 +595,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
         if (FAILED(hr)) goto cleanup_dual;
         
         // Add microphone audio stream
-        hr = IMFSinkWriter_AddStream(g_sink_writer, mic_audio_type_out, &g_mic_audio_stream_index);
+        hr = IMFSinkWriter_AddStream(context->sink_writer, mic_audio_type_out, &context->mic_audio_stream_index);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to add microphone audio stream: 0x%08X\n", hr);
             goto cleanup_dual;
@@ -565,7 +631,7 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
         if (FAILED(hr)) goto cleanup_dual;
         
         // Set input type for system audio stream
-        hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_system_audio_stream_index, system_audio_type_in, NULL);
+        hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->system_audio_stream_index, system_audio_type_in, NULL);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to set system audio input type: 0x%08X\n", hr);
             goto cleanup_dual;
@@ -601,25 +667,25 @@ int encoder_init_dual_track(encoder_context_t* context, const char* filename, in
         if (FAILED(hr)) goto cleanup_dual;
         
         // Set input type for microphone audio stream
-        hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_mic_audio_stream_index, mic_audio_type_in, NULL);
+        hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->mic_audio_stream_index, mic_audio_type_in, NULL);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to set microphone audio input type: 0x%08X\n", hr);
             goto cleanup_dual;
         }
         
         printf("Dual-track audio configured: System (stream %d) + Microphone (stream %d)\n", 
-               g_system_audio_stream_index, g_mic_audio_stream_index);
+               context->system_audio_stream_index, context->mic_audio_stream_index);
     }
     
     // Begin writing
-    hr = IMFSinkWriter_BeginWriting(g_sink_writer);
+    hr = IMFSinkWriter_BeginWriting(context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to begin writing: 0x%08X\n", hr);
         goto cleanup_dual;
     }
     
     context->is_recording = TRUE;
-    g_audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
+    context->audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
     
     // Clean up temporary objects
     if (video_type_out) IMFMediaType_Release(video_type_out);
@@ -641,9 +707,9 @@ cleanup_dual:
     if (mic_audio_type_out) IMFMediaType_Release(mic_audio_type_out);
     if (mic_audio_type_in) IMFMediaType_Release(mic_audio_type_in);
     if (attributes) IMFAttributes_Release(attributes);
-    if (g_sink_writer) {
-        IMFSinkWriter_Release(g_sink_writer);
-        g_sink_writer = NULL;
+    if (context->sink_writer) {
+        IMFSinkWriter_Release(context->sink_writer);
+        context->sink_writer = NULL;
     }
     free(wide_filename);
     MFShutdown();
@@ -655,17 +721,9 @@ cleanup_dual:
 int encoder_init_audio_only(encoder_context_t* context, const char* filename, int sample_rate, int channels, int bits_per_sample) {
     if (!context || !filename) return -1;
     
-    memset(context, 0, sizeof(encoder_context_t));
-    context->output_filename = filename;
-    context->input_sample_rate = sample_rate;
-    context->input_channels = channels;
-    context->input_bits_per_sample = bits_per_sample;
+    encoder_reset_context(context, filename, sample_rate, channels, bits_per_sample);
     context->dual_track_mode = FALSE;
     
-    // Set global state for audio-only mode
-    g_dual_track_mode = FALSE;
-    g_audio_sample_count = 0;
-    
     HRESULT hr;
     IMFMediaType* audio_type_out = NULL;
     IMFMediaType* audio_type_in = NULL;
@@ -698,7 +756,7 @@ int encoder_init_audio_only(encoder_context_t* context, const char* filename, in
     }
     
     // CRITICAL FIX: Set MP4 container type for proper moov atom generation
-    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, &MFTranscodeContainerType_MPEG4);
+    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, encoder_container_type(context));
     if (FAILED(hr)) {
         fprintf(stderr, "Warning: Failed to set MP4 container type: 0x%08X\n", hr);
     }
@@ -720,7 +778,7 @@ int encoder_init_audio_only(encoder_context_t* context, const char* filename, in
         fprintf(stderr, "Warning: Failed to enable hardware transforms: 0x%08X\n", hr);
     }
       // Create sink writer for MP4 file
-    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &g_sink_writer);
+    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to create sink writer: 0x%08X\n", hr);
         goto cleanup_audio_only;
@@ -747,7 +805,7 @@ int encoder_init_audio_only(encoder_context_t* context, const char* filename, in
     }
     
     // Add audio stream
-    hr = IMFSinkWriter_AddStream(g_sink_writer, audio_type_out, &g_audio_stream_index);
+    hr = IMFSinkWriter_AddStream(context->sink_writer, audio_type_out, &context->audio_stream_index);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to add audio stream: 0x%08X\n", hr);
         goto cleanup_audio_only;
@@ -782,21 +840,21 @@ int encoder_init_audio_only(encoder_context_t* context, const char* filename, in
     }
     
     // Set input type
-    hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_audio_stream_index, audio_type_in, NULL);
+    hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->audio_stream_index, audio_type_in, NULL);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set audio input type: 0x%08X\n", hr);
         goto cleanup_audio_only;
     }
     
     // Begin writing
-    hr = IMFSinkWriter_BeginWriting(g_sink_writer);
+    hr = IMFSinkWriter_BeginWriting(context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to begin writing: 0x%08X\n", hr);
         goto cleanup_audio_only;
     }
     
     context->is_recording = TRUE;
-    g_audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
+    context->audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
     printf("Audio-only recording initialized (AAC in MP4 container): %d Hz, %d channels, %d bits\n", 
            sample_rate, channels, bits_per_sample);
     
@@ -812,9 +870,9 @@ cleanup_audio_only:
     if (audio_type_out) IMFMediaType_Release(audio_type_out);
     if (audio_type_in) IMFMediaType_Release(audio_type_in);
     if (attributes) IMFAttributes_Release(attributes);
-    if (g_sink_writer) {
-        IMFSinkWriter_Release(g_sink_writer);
-        g_sink_writer = NULL;
+    if (context->sink_writer) {
+        IMFSinkWriter_Release(context->sink_writer);
+        context->sink_writer = NULL;
     }
     free(wide_filename);
     MFShutdown();
@@ -826,18 +884,9 @@ cleanup_audio_only:
 int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* filename, int sample_rate, int channels, int bits_per_sample) {
     if (!context || !filename) return -1;
     
-    memset(context, 0, sizeof(encoder_context_t));
-    context->output_filename = filename;
-    context->input_sample_rate = sample_rate;
-    context->input_channels = channels;
-    context->input_bits_per_sample = bits_per_sample;
+    encoder_reset_context(context, filename, sample_rate, channels, bits_per_sample);
     context->dual_track_mode = TRUE;
     
-    // Set global state for audio-only dual-track mode
-    g_dual_track_mode = TRUE;
-    g_system_audio_sample_count = 0;
-    g_mic_audio_sample_count = 0;
-    
     HRESULT hr;
     IMFMediaType* system_audio_type_out = NULL;
     IMFMediaType* system_audio_type_in = NULL;
@@ -872,7 +921,7 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     }
     
     // CRITICAL FIX: Set MP4 container type for proper moov atom generation
-    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, &MFTranscodeContainerType_MPEG4);
+    hr = IMFAttributes_SetGUID(attributes, &MF_TRANSCODE_CONTAINERTYPE, encoder_container_type(context));
     if (FAILED(hr)) {
         fprintf(stderr, "Warning: Failed to set MP4 container type: 0x%08X\n", hr);
     }
@@ -899,7 +948,7 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     // Temporarily disable container timescale override - needs further investigation
     
     // Create sink writer for MP4 file
-    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &g_sink_writer);
+    hr = MFCreateSinkWriterFromURL(wide_filename, NULL, attributes, &context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to create sink writer: 0x%08X\n", hr);
         goto cleanup_audio_dual;
@@ -926,7 +975,7 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     }
     
     // Add system audio stream
-    hr = IMFSinkWriter_AddStream(g_sink_writer, system_audio_type_out, &g_system_audio_stream_index);
+    hr = IMFSinkWriter_AddStream(context->sink_writer, system_audio_type_out, &context->system_audio_stream_index);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to add system audio stream: 0x%08X\n", hr);
         goto cleanup_audio_dual;
@@ -953,7 +1002,7 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     }
     
     // Add microphone audio stream
-    hr = IMFSinkWriter_AddStream(g_sink_writer, mic_audio_type_out, &g_mic_audio_stream_index);
+    hr = IMFSinkWriter_AddStream(context->sink_writer, mic_audio_type_out, &context->mic_audio_stream_index);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to add microphone audio stream: 0x%08X\n", hr);
         goto cleanup_audio_dual;
@@ -988,7 +1037,7 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     }
     
     // Set system audio input type
-    hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_system_audio_stream_index, system_audio_type_in, NULL);
+    hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->system_audio_stream_index, system_audio_type_in, NULL);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set system audio input type: 0x%08X\n", hr);
         goto cleanup_audio_dual;
@@ -1023,23 +1072,23 @@ int encoder_init_audio_only_dual_track(encoder_context_t* context, const char* f
     }
     
     // Set microphone audio input type
-    hr = IMFSinkWriter_SetInputMediaType(g_sink_writer, g_mic_audio_stream_index, mic_audio_type_in, NULL);
+    hr = IMFSinkWriter_SetInputMediaType(context->sink_writer, context->mic_audio_stream_index, mic_audio_type_in, NULL);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set microphone audio input type: 0x%08X\n", hr);
         goto cleanup_audio_dual;
     }
     
     // Begin writing
-    hr = IMFSinkWriter_BeginWriting(g_sink_writer);
+    hr = IMFSinkWriter_BeginWriting(context->sink_writer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to begin writing: 0x%08X\n", hr);
         goto cleanup_audio_dual;
     }
     
     context->is_recording = TRUE;
-    g_audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
+    context->audio_sample_rate = sample_rate; // Store actual sample rate for timing calculations
     printf("Audio-only dual-track recording initialized (MP4 output): System (stream %d) + Microphone (stream %d)\n", 
-           g_system_audio_stream_index, g_mic_audio_stream_index);
+           context->system_audio_stream_index, context->mic_audio_stream_index);
     
     // Clean up temporary objects
     if (system_audio_type_out) IMFMediaType_Release(system_audio_type_out);
@@ -1057,9 +1106,9 @@ cleanup_audio_dual:
     if (mic_audio_type_out) IMFMediaType_Release(mic_audio_type_out);
     if (mic_audio_type_in) IMFMediaType_Release(mic_audio_type_in);
     if (attributes) IMFAttributes_Release(attributes);
-    if (g_sink_writer) {
-        IMFSinkWriter_Release(g_sink_writer);
-        g_sink_writer = NULL;
+    if (context->sink_writer) {
+        IMFSinkWriter_Release(context->sink_writer);
+        context->sink_writer = NULL;
     }
     free(wide_filename);
     MFShutdown();
@@ -1067,17 +1116,138 @@ cleanup_audio_dual:
     return -1;
 }
 
-int encoder_add_video_frame(encoder_context_t* context, void* frame_data, size_t frame_size, DWORD elapsed_ms) {
-    // Suppress unused parameter warning - we calculate buffer size from video dimensions for consistency
-    UNREFERENCED_PARAMETER(frame_size);
+// IMFMediaBuffer that lends a frame pool buffer to Media Foundation without copying.
+// It holds one pool reference, dropped when MF releases the last COM reference.
+typedef struct {
+    IMFMediaBuffer iface;
+    volatile LONG com_refcount;
+    frame_pool_t* pool;
+    frame_handle_t frame;
+    BYTE* data;
+    DWORD max_length;
+    DWORD current_length;
+} pool_media_buffer_t;
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_query_interface(IMFMediaBuffer* buffer, REFIID riid, void** object) {
+    if (!object) return E_POINTER;
+    if (IsEqualIID(riid, &IID_IUnknown) || IsEqualIID(riid, &IID_IMFMediaBuffer)) {
+        *object = buffer;
+        IMFMediaBuffer_AddRef(buffer);
+        return S_OK;
+    }
+    *object = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE pool_buffer_add_ref(IMFMediaBuffer* buffer) {
+    return (ULONG)InterlockedIncrement(&((pool_media_buffer_t*)buffer)->com_refcount);
+}
+
+static ULONG STDMETHODCALLTYPE pool_buffer_release(IMFMediaBuffer* buffer) {
+    pool_media_buffer_t* pool_buffer = (pool_media_buffer_t*)buffer;
+    LONG remaining = InterlockedDecrement(&pool_buffer->com_refcount);
+    if (remaining == 0) {
+        frame_pool_release(pool_buffer->pool, pool_buffer->frame);
+        free(pool_buffer);
+    }
+    return (ULONG)remaining;
+}
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_lock(IMFMediaBuffer* buffer, BYTE** data, DWORD* max_length, DWORD* current_length) {
+    pool_media_buffer_t* pool_buffer = (pool_media_buffer_t*)buffer;
+    if (!data) return E_POINTER;
+    *data = pool_buffer->data;
+    if (max_length) *max_length = pool_buffer->max_length;
+    if (current_length) *current_length = pool_buffer->current_length;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_unlock(IMFMediaBuffer* buffer) {
+    UNREFERENCED_PARAMETER(buffer);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_get_current_length(IMFMediaBuffer* buffer, DWORD* length) {
+    if (!length) return E_POINTER;
+    *length = ((pool_media_buffer_t*)buffer)->current_length;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_set_current_length(IMFMediaBuffer* buffer, DWORD length) {
+    pool_media_buffer_t* pool_buffer = (pool_media_buffer_t*)buffer;
+    if (length > pool_buffer->max_length) return E_INVALIDARG;
+    pool_buffer->current_length = length;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE pool_buffer_get_max_length(IMFMediaBuffer* buffer, DWORD* length) {
+    if (!length) return E_POINTER;
+    *length = ((pool_media_buffer_t*)buffer)->max_length;
+    return S_OK;
+}
+
+static IMFMediaBufferVtbl g_pool_buffer_vtbl = {
+    pool_buffer_query_interface,
+    pool_buffer_add_ref,
+    pool_buffer_release,
+    pool_buffer_lock,
+    pool_buffer_unlock,
+    pool_buffer_get_current_length,
+    pool_buffer_set_current_length,
+    pool_buffer_get_max_length
+};
+
+// Wrap a pool frame as an IMFMediaBuffer; takes its own reference on the frame
+static HRESULT create_pool_media_buffer(frame_pool_t* pool, frame_handle_t frame, DWORD length, IMFMediaBuffer** buffer) {
+    BYTE* data = (BYTE*)frame_pool_data(pool, frame);
+    if (!data || length > frame_pool_frame_size(pool)) return E_INVALIDARG;
+    
+    pool_media_buffer_t* pool_buffer = (pool_media_buffer_t*)malloc(sizeof(pool_media_buffer_t));
+    if (!pool_buffer) return E_OUTOFMEMORY;
+    
+    pool_buffer->iface.lpVtbl = &g_pool_buffer_vtbl;
+    pool_buffer->com_refcount = 1;
+    pool_buffer->pool = pool;
+    pool_buffer->frame = frame;
+    pool_buffer->data = data;
+    pool_buffer->max_length = length;
+    pool_buffer->current_length = length;
+    frame_pool_addref(pool, frame);
+    
+    *buffer = &pool_buffer->iface;
+    return S_OK;
+}
+
+// Write the held-back video sample with the duration the timeline gave it
+static int encoder_write_pending_video(encoder_context_t* context, LONGLONG duration) {
+    if (!context->pending_video_sample) return 0;
+    
+    LONGLONG start = 0;
+    HRESULT hr = IMFSample_GetSampleTime(context->pending_video_sample, &start);
+    if (SUCCEEDED(hr)) hr = IMFSample_SetSampleDuration(context->pending_video_sample, duration);
+    if (FAILED(hr)) {
+        fprintf(stderr, "Failed to set video sample duration: 0x%08X\n", hr);
+    } else {
+        hr = IMFSinkWriter_WriteSample(context->sink_writer, context->video_stream_index, context->pending_video_sample);
+        if (FAILED(hr)) {
+            fprintf(stderr, "Failed to write video sample: 0x%08X\n", hr);
+        }
+    }
+    
+    context->last_video_timestamp = start + duration;
+    IMFSample_Release(context->pending_video_sample);
+    context->pending_video_sample = NULL;
     
-    if (!context || !context->is_recording || !frame_data || !g_sink_writer) return -1;
+    return SUCCEEDED(hr) ? 0 : -1;
+}
+
+int encoder_add_video_frame(encoder_context_t* context, frame_pool_t* pool, frame_handle_t frame, LONGLONG capture_time) {
+    if (!context || !context->is_recording || !pool || frame == FRAME_HANDLE_INVALID || !context->sink_writer) return -1;
     
     HRESULT hr;
     IMFSample* sample = NULL;
     IMFMediaBuffer* buffer = NULL;
-    BYTE* buffer_data = NULL;
-    DWORD buffer_length = g_video_width * g_video_height * 4; // BGRA = 4 bytes per pixel
+    DWORD buffer_length = encoder_video_frame_bytes(context);
     
     // Create sample
     hr = MFCreateSample(&sample);
@@ -1086,44 +1256,14 @@ int encoder_add_video_frame(encoder_context_t* context, void* frame_data, size_t
         return -1;
     }
     
-    // Create media buffer
-    hr = MFCreateMemoryBuffer(buffer_length, &buffer);
+    // Lend the frame to MF directly (BGRA input leaves colour conversion to Media Foundation)
+    hr = create_pool_media_buffer(pool, frame, buffer_length, &buffer);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to create video buffer: 0x%08X\n", hr);
         IMFSample_Release(sample);
         return -1;
     }
     
-    // Lock buffer and copy data
-    hr = IMFMediaBuffer_Lock(buffer, &buffer_data, NULL, NULL);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to lock video buffer: 0x%08X\n", hr);
-        IMFMediaBuffer_Release(buffer);
-        IMFSample_Release(sample);
-        return -1;
-    }
-    
-    // Copy BGRA frame data directly (Windows Media Foundation will handle conversion)
-    memcpy(buffer_data, frame_data, buffer_length);
-    
-    // Unlock buffer
-    hr = IMFMediaBuffer_Unlock(buffer);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to unlock video buffer: 0x%08X\n", hr);
-        IMFMediaBuffer_Release(buffer);
-        IMFSample_Release(sample);
-        return -1;
-    }
-    
-    // Set current length
-    hr = IMFMediaBuffer_SetCurrentLength(buffer, buffer_length);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to set video buffer length: 0x%08X\n", hr);
-        IMFMediaBuffer_Release(buffer);
-        IMFSample_Release(sample);
-        return -1;
-    }
-    
     // Add buffer to sample
     hr = IMFSample_AddBuffer(sample, buffer);
     if (FAILED(hr)) {
@@ -1133,9 +1273,11 @@ int encoder_add_video_frame(encoder_context_t* context, void* frame_data, size_t
         return -1;
     }
     
-    // CRITICAL FIX: Use frame-based timing instead of real-time for consistent playback speed
-    // Calculate timestamp based on frame number and target FPS for consistent timing
-    LONGLONG timestamp = (LONGLONG)(g_video_frame_count * 10000000LL / g_video_fps);
+    // Constant frame rate stamps the frame slot of the capture time, so slots with no frame
+    // lengthen the held one; variable frame rate stamps the capture time itself
+    frame_timeline_step_t step;
+    frame_timeline_new_frame(&context->video_timeline, capture_time, &step);
+    LONGLONG timestamp = step.time;
     hr = IMFSample_SetSampleTime(sample, timestamp);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set video sample time: 0x%08X\n", hr);
@@ -1144,44 +1286,63 @@ int encoder_add_video_frame(encoder_context_t* context, void* frame_data, size_t
         return -1;
     }
     
-    // Use fixed frame duration based on target FPS for consistent playback speed
-    LONGLONG duration = 10000000LL / g_video_fps;
-    hr = IMFSample_SetSampleDuration(sample, duration);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to set video sample duration: 0x%08X\n", hr);
-        IMFMediaBuffer_Release(buffer);
-        IMFSample_Release(sample);
-        return -1;
-    }
+    // The previous frame now knows how long it lasted
+    int result = step.write_pending ? encoder_write_pending_video(context, step.pending_duration) : 0;
     
-    hr = IMFSinkWriter_WriteSample(g_sink_writer, g_video_stream_index, sample);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to write video sample: 0x%08X\n", hr);
-        IMFMediaBuffer_Release(buffer);
-        IMFSample_Release(sample);
-        return -1;
-    }
-    
-    g_video_frame_count++;
+    // Hold this sample back so repeats can extend its duration instead of re-encoding it
+    context->pending_video_sample = sample;
+    context->video_frame_count++;
     
 #ifdef DEBUG
-    if (g_video_frame_count % 30 == 0) {
-        printf("Video: %lld frames, timestamp=%.2fs, elapsed=%lums\n", 
-               g_video_frame_count, timestamp / 10000000.0, elapsed_ms);
+    if (context->video_frame_count % 30 == 0) {
+        printf("Video: %lld frames, timestamp=%.2fs, captured=%.2fs\n", 
+               context->video_frame_count, timestamp / 10000000.0, capture_time / 10000000.0);
     }
 #endif
     
     IMFMediaBuffer_Release(buffer);
-    IMFSample_Release(sample);
     
-    return 0;
+    return result;
+}
+
+// Desktop unchanged: extend the held-back sample instead of copying pixels
+int encoder_repeat_video_frame(encoder_context_t* context, LONGLONG capture_time) {
+    if (!context || !context->is_recording || !context->sink_writer || !context->pending_video_sample) return -1;
+    
+    frame_timeline_step_t step;
+    if (frame_timeline_repeat_frame(&context->video_timeline, capture_time, &step) != 0) return -1;
+    context->video_frame_count++;
+    context->repeated_video_frames++;
+    if (!step.start_sample) return 0;
+    
+    // Re-emit the same buffer periodically so long static periods stay seekable
+    IMFMediaBuffer* buffer = NULL;
+    IMFSample* sample = NULL;
+    
+    HRESULT hr = IMFSample_GetBufferByIndex(context->pending_video_sample, 0, &buffer);
+    if (SUCCEEDED(hr)) hr = MFCreateSample(&sample);
+    if (SUCCEEDED(hr)) hr = IMFSample_AddBuffer(sample, buffer);
+    if (SUCCEEDED(hr)) hr = IMFSample_SetSampleTime(sample, step.time);
+    if (buffer) IMFMediaBuffer_Release(buffer);
+    
+    if (FAILED(hr)) {
+        // Close the held sample where the timeline expects it; video resumes with the next new frame
+        fprintf(stderr, "Failed to re-emit repeated video frame: 0x%08X\n", hr);
+        if (sample) IMFSample_Release(sample);
+        encoder_write_pending_video(context, step.pending_duration);
+        return -1;
+    }
+    
+    int result = encoder_write_pending_video(context, step.pending_duration);
+    context->pending_video_sample = sample;
+    return result;
 }
 
 int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms) {
-    if (!context || !context->is_recording || !audio_data || !g_sink_writer) return -1;
+    if (!context || !context->is_recording || !audio_data || !context->sink_writer) return -1;
     
     // Check if audio stream is valid (video-only mode)
-    if (g_audio_stream_index == (DWORD)-1) {
+    if (context->audio_stream_index == (DWORD)-1) {
         // Silently ignore audio frames when audio is disabled
         return 0;
     }
@@ -1249,7 +1410,7 @@ int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32
     // CRITICAL FIX: Use sample-based timing for audio instead of real-time for consistent sync
     // Calculate timestamp based on accumulated audio samples for accurate timing
     // CRITICAL FIX: Use OUTPUT sample rate (44100 Hz) for timing calculations, not input sample rate
-    LONGLONG timestamp = (LONGLONG)(g_audio_sample_count * 10000000LL / 44100);
+    LONGLONG timestamp = (LONGLONG)(context->audio_sample_count * 10000000LL / 44100);
     hr = IMFSample_SetSampleTime(sample, timestamp);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set audio sample time: 0x%08X\n", hr);
@@ -1259,18 +1420,16 @@ int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32
     }
     
     // Update sample count before calculating duration
-    g_audio_sample_count += num_frames;
+    context->audio_sample_count += num_frames;
     
     // DEBUG: Log sample accumulation for timing diagnosis
-    static UINT64 last_log_time = 0;
-    static UINT64 samples_at_last_log = 0;
-    UINT64 current_sample_count = g_audio_sample_count;
+    UINT64 current_sample_count = context->audio_sample_count;
     
-    if (current_sample_count - samples_at_last_log >= 44100) { // Log every ~1 second of samples (44100 Hz)
+    if (current_sample_count - context->audio_samples_logged >= 44100) { // Log every ~1 second of samples (44100 Hz)
         printf("Audio samples: %llu total, %llu in last batch, %.3f seconds encoded\n", 
-               current_sample_count, current_sample_count - samples_at_last_log, 
+               current_sample_count, current_sample_count - context->audio_samples_logged, 
                (double)current_sample_count / 44100);
-        samples_at_last_log = current_sample_count;
+        context->audio_samples_logged = current_sample_count;
     }
     
     // Calculate duration based on number of frames and OUTPUT sample rate
@@ -1282,7 +1441,7 @@ int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32
         IMFSample_Release(sample);
         return -1;
     }
-      hr = IMFSinkWriter_WriteSample(g_sink_writer, g_audio_stream_index, sample);
+      hr = IMFSinkWriter_WriteSample(context->sink_writer, context->audio_stream_index, sample);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to write audio sample: 0x%08X\n", hr);
         IMFMediaBuffer_Release(buffer);
@@ -1298,7 +1457,7 @@ int encoder_add_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32
 
 // Add system audio frame (dual-track mode)
 int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms) {
-    if (!context || !context->is_recording || !audio_data || !g_sink_writer || !g_dual_track_mode) return -1;
+    if (!context || !context->is_recording || !audio_data || !context->sink_writer || !context->dual_track_mode) return -1;
     
     HRESULT hr;
     IMFSample* sample = NULL;
@@ -1361,7 +1520,7 @@ int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data,
     }
     
     // CRITICAL FIX: Use OUTPUT sample rate (44100 Hz) for system audio timing instead of input sample rate
-    LONGLONG timestamp = (LONGLONG)(g_system_audio_sample_count * 10000000LL / 44100);
+    LONGLONG timestamp = (LONGLONG)(context->system_audio_sample_count * 10000000LL / 44100);
     hr = IMFSample_SetSampleTime(sample, timestamp);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set system audio sample time: 0x%08X\n", hr);
@@ -1371,7 +1530,7 @@ int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data,
     }
     
     // Increment sample count before calculating duration
-    g_system_audio_sample_count += num_frames;
+    context->system_audio_sample_count += num_frames;
     
     // Set sample duration based on frame count and OUTPUT sample rate
     LONGLONG duration = (LONGLONG)(num_frames * 10000000LL / 44100);
@@ -1384,7 +1543,7 @@ int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data,
     }
     
     // Write sample to system audio stream
-    hr = IMFSinkWriter_WriteSample(g_sink_writer, g_system_audio_stream_index, sample);
+    hr = IMFSinkWriter_WriteSample(context->sink_writer, context->system_audio_stream_index, sample);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to write system audio sample: 0x%08X\n", hr);
         IMFMediaBuffer_Release(buffer);
@@ -1401,7 +1560,7 @@ int encoder_add_system_audio_frame(encoder_context_t* context, BYTE* audio_data,
 
 // Add microphone audio frame (dual-track mode)
 int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UINT32 num_frames, DWORD elapsed_ms) {
-    if (!context || !context->is_recording || !audio_data || !g_sink_writer || !g_dual_track_mode) return -1;
+    if (!context || !context->is_recording || !audio_data || !context->sink_writer || !context->dual_track_mode) return -1;
     
     HRESULT hr;
     IMFSample* sample = NULL;
@@ -1464,7 +1623,7 @@ int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UI
     }
     
     // CRITICAL FIX: Use OUTPUT sample rate (44100 Hz) for microphone audio timing instead of input sample rate
-    LONGLONG timestamp = (LONGLONG)(g_mic_audio_sample_count * 10000000LL / 44100);
+    LONGLONG timestamp = (LONGLONG)(context->mic_audio_sample_count * 10000000LL / 44100);
     hr = IMFSample_SetSampleTime(sample, timestamp);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to set microphone audio sample time: 0x%08X\n", hr);
@@ -1474,7 +1633,7 @@ int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UI
     }
     
     // Increment sample count before calculating duration
-    g_mic_audio_sample_count += num_frames;
+    context->mic_audio_sample_count += num_frames;
     
     // Set sample duration based on frame count and OUTPUT sample rate
     LONGLONG duration = (LONGLONG)(num_frames * 10000000LL / 44100);
@@ -1487,7 +1646,7 @@ int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UI
     }
     
     // Write sample to microphone audio stream
-    hr = IMFSinkWriter_WriteSample(g_sink_writer, g_mic_audio_stream_index, sample);
+    hr = IMFSinkWriter_WriteSample(context->sink_writer, context->mic_audio_stream_index, sample);
     if (FAILED(hr)) {
         fprintf(stderr, "Failed to write microphone audio sample: 0x%08X\n", hr);
         IMFMediaBuffer_Release(buffer);
@@ -1505,12 +1664,20 @@ int encoder_add_mic_audio_frame(encoder_context_t* context, BYTE* audio_data, UI
 int encoder_finalize(encoder_context_t* context) {
     if (!context) return -1;
     
-    if (g_sink_writer) {
-        printf("Finalizing WMF sink writer with %lld frames...\n", g_video_frame_count);
+    if (context->sink_writer) {
+        printf("Finalizing WMF sink writer with %lld frames (%lld repeated)...\n", context->video_frame_count, context->repeated_video_frames);
+        if (context->video_timeline.gap_slots > 0) {
+            printf("Frame slots without a capture: %llu, held frames cover them\n",
+                   (unsigned long long)context->video_timeline.gap_slots);
+        }
+        
+        // The last frame is still held back for possible repeats
+        LONGLONG last_duration = frame_timeline_finish(&context->video_timeline);
+        if (last_duration > 0) encoder_write_pending_video(context, last_duration);
         
         // CRITICAL FIX: Flush the sink writer before finalization
         printf("Flushing sink writer...\n");
-        HRESULT flush_hr = IMFSinkWriter_Flush(g_sink_writer, MF_SINK_WRITER_ALL_STREAMS);
+        HRESULT flush_hr = IMFSinkWriter_Flush(context->sink_writer, MF_SINK_WRITER_ALL_STREAMS);
         if (FAILED(flush_hr)) {
             fprintf(stderr, "Warning: Failed to flush sink writer: 0x%08X\n", flush_hr);
         } else {
@@ -1518,12 +1685,12 @@ int encoder_finalize(encoder_context_t* context) {
         }
         
         // CRITICAL FIX: Send end-of-stream markers before finalization
-        UINT64 total_audio_samples = g_audio_sample_count + g_system_audio_sample_count + g_mic_audio_sample_count;
+        UINT64 total_audio_samples = context->audio_sample_count + context->system_audio_sample_count + context->mic_audio_sample_count;
         
         // Send end-of-stream for video if we have video
-        if (g_video_frame_count > 0) {
+        if (context->video_frame_count > 0) {
             printf("Sending video end-of-stream...\n");
-            HRESULT hr = IMFSinkWriter_SendStreamTick(g_sink_writer, g_video_stream_index, g_last_video_timestamp);
+            HRESULT hr = IMFSinkWriter_SendStreamTick(context->sink_writer, context->video_stream_index, context->last_video_timestamp);
             if (FAILED(hr)) {
                 fprintf(stderr, "Warning: Failed to send video end-of-stream: 0x%08X\n", hr);
             }
@@ -1531,28 +1698,28 @@ int encoder_finalize(encoder_context_t* context) {
         
         // Send end-of-stream for audio streams if we have audio
         if (total_audio_samples > 0) {
-            if (g_dual_track_mode) {
-                if (g_system_audio_sample_count > 0) {
+            if (context->dual_track_mode) {
+                if (context->system_audio_sample_count > 0) {
                     printf("Sending system audio end-of-stream...\n");
-                    LONGLONG system_timestamp = (g_system_audio_sample_count * 10000000LL) / g_audio_sample_rate;
-                    HRESULT hr = IMFSinkWriter_SendStreamTick(g_sink_writer, g_system_audio_stream_index, system_timestamp);
+                    LONGLONG system_timestamp = (context->system_audio_sample_count * 10000000LL) / context->audio_sample_rate;
+                    HRESULT hr = IMFSinkWriter_SendStreamTick(context->sink_writer, context->system_audio_stream_index, system_timestamp);
                     if (FAILED(hr)) {
                         fprintf(stderr, "Warning: Failed to send system audio end-of-stream: 0x%08X\n", hr);
                     }
                 }
-                if (g_mic_audio_sample_count > 0) {
+                if (context->mic_audio_sample_count > 0) {
                     printf("Sending microphone audio end-of-stream...\n");
-                    LONGLONG mic_timestamp = (g_mic_audio_sample_count * 10000000LL) / g_audio_sample_rate;
-                    HRESULT hr = IMFSinkWriter_SendStreamTick(g_sink_writer, g_mic_audio_stream_index, mic_timestamp);
+                    LONGLONG mic_timestamp = (context->mic_audio_sample_count * 10000000LL) / context->audio_sample_rate;
+                    HRESULT hr = IMFSinkWriter_SendStreamTick(context->sink_writer, context->mic_audio_stream_index, mic_timestamp);
                     if (FAILED(hr)) {
                         fprintf(stderr, "Warning: Failed to send microphone audio end-of-stream: 0x%08X\n", hr);
                     }
                 }
             } else {
-                if (g_audio_sample_count > 0) {
+                if (context->audio_sample_count > 0) {
                     printf("Sending audio end-of-stream...\n");
-                    LONGLONG audio_timestamp = (g_audio_sample_count * 10000000LL) / g_audio_sample_rate;
-                    HRESULT hr = IMFSinkWriter_SendStreamTick(g_sink_writer, g_audio_stream_index, audio_timestamp);
+                    LONGLONG audio_timestamp = (context->audio_sample_count * 10000000LL) / context->audio_sample_rate;
+                    HRESULT hr = IMFSinkWriter_SendStreamTick(context->sink_writer, context->audio_stream_index, audio_timestamp);
                     if (FAILED(hr)) {
                         fprintf(stderr, "Warning: Failed to send audio end-of-stream: 0x%08X\n", hr);
                     }
@@ -1562,12 +1729,12 @@ int encoder_finalize(encoder_context_t* context) {
         
         // CRITICAL FIX: Always finalize the sink writer to ensure proper MP4 structure
         // Even if no frames/samples were captured, the file needs proper moov atom
-        if (g_video_frame_count == 0 && total_audio_samples == 0) {
+        if (context->video_frame_count == 0 && total_audio_samples == 0) {
             printf("Warning: No audio or video data captured, but finalizing anyway for proper MP4 structure\n");
         }
         
         printf("Finalizing sink writer...\n");
-        HRESULT hr = IMFSinkWriter_Finalize(g_sink_writer);
+        HRESULT hr = IMFSinkWriter_Finalize(context->sink_writer);
         if (FAILED(hr)) {
             fprintf(stderr, "Failed to finalize sink writer: 0x%08X\n", hr);
             // For empty files, this is expected, don't treat as fatal error
@@ -1586,40 +1753,161 @@ int encoder_finalize(encoder_context_t* context) {
     return 0;
 }
 
+encoder_segment_t* encoder_detach_segment(encoder_context_t* context, LONGLONG end_time) {
+    if (!context || !context->is_recording || !context->sink_writer) return NULL;
+    
+    encoder_segment_t* segment = (encoder_segment_t*)malloc(sizeof(encoder_segment_t));
+    if (!segment) {
+        fprintf(stderr, "Failed to allocate segment\n");
+        return NULL;
+    }
+    
+    // The held-back frame lasts until the next segment starts
+    if (context->pending_video_sample) {
+        LONGLONG start = 0;
+        IMFSample_GetSampleTime(context->pending_video_sample, &start);
+        LONGLONG duration = end_time > start ? end_time - start : frame_timeline_finish(&context->video_timeline);
+        encoder_write_pending_video(context, duration > 0 ? duration : 1);
+    }
+    
+    segment->writer = context->sink_writer;
+    context->sink_writer = NULL;
+    context->is_recording = FALSE;
+    return segment;
+}
+
+int encoder_finalize_segment(encoder_segment_t* segment) {
+    if (!segment) return -1;
+    
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    HRESULT hr = IMFSinkWriter_Finalize(segment->writer);
+    if (FAILED(hr)) {
+        fprintf(stderr, "Failed to finalize segment: 0x%08X\n", hr);
+    }
+    IMFSinkWriter_Release(segment->writer);
+    
+    // Balances the MFStartup of the encoder_init* call that opened the segment
+    MFShutdown();
+    CoUninitialize();
+    free(segment);
+    return SUCCEEDED(hr) ? 0 : -1;
+}
+
 void encoder_cleanup(encoder_context_t* context) {
     if (!context) return;
     
+    // Drop a held-back frame that never reached finalize
+    if (context->pending_video_sample) {
+        IMFSample_Release(context->pending_video_sample);
+        context->pending_video_sample = NULL;
+    }
+    
     // Only cleanup if we actually have resources to clean
-    if (g_sink_writer) {
-        IMFSinkWriter_Release(g_sink_writer);
-        g_sink_writer = NULL;
+    if (context->sink_writer) {
+        IMFSinkWriter_Release(context->sink_writer);
+        context->sink_writer = NULL;
         printf("Muxer cleaned up\n");
         
         // Only shutdown MF when we're actually releasing the sink writer
         MFShutdown();
     }
     
-    // CRITICAL: Reset all global state variables to prevent carryover between recordings
-    g_video_stream_index = 0;
-    g_audio_stream_index = 0;
-    g_system_audio_stream_index = 0;
-    g_mic_audio_stream_index = 0;
-    g_dual_track_mode = FALSE;
-    g_video_frame_count = 0;
-    g_audio_sample_count = 0;
-    g_system_audio_sample_count = 0;
-    g_mic_audio_sample_count = 0;
-    g_video_width = 0;
-    g_video_height = 0;
-    g_video_fps = 30;
-    g_recording_start_time = 0;
-    g_last_video_timestamp = 0;
-    
+    // Settings included: the next recording starts from defaults
     memset(context, 0, sizeof(encoder_context_t));
 }
 
 // Set the actual recording start time when capture begins
-void encoder_set_recording_start_time(DWORD start_time) {
-    g_recording_start_time = start_time;
-    printf("Recording start time synchronized: %lu ms\n", g_recording_start_time);
+void encoder_set_recording_start_time(encoder_context_t* context, DWORD start_time) {
+    if (!context) return;
+    context->settings.recording_start_time = start_time;
+    printf("Recording start time synchronized: %lu ms\n", context->settings.recording_start_time);
+}
+
+// ---------------------------------------------------------------------------
+// Encoder backend
+// ---------------------------------------------------------------------------
+
+static int mf_backend_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    encoder_context_t* context = (encoder_context_t*)backend->impl;
+    encoder_set_video_input(context, config->format, config->matrix, config->range);
+    encoder_set_frame_timing(context, config->timing);
+    encoder_set_container(context, config->fragmented ? ENCODER_CONTAINER_FRAGMENTED_MP4 : ENCODER_CONTAINER_MP4);
+    
+    BOOL dual_track = config->audio_streams == 2;
+    int result;
+    if (!config->video) {
+        result = dual_track
+            ? encoder_init_audio_only_dual_track(context, config->path, config->sample_rate, config->channels, config->bits_per_sample)
+            : encoder_init_audio_only(context, config->path, config->sample_rate, config->channels, config->bits_per_sample);
+    } else if (dual_track) {
+        result = encoder_init_dual_track(context, config->path, config->width, config->height, config->fps,
+                                         config->sample_rate, config->channels, config->bits_per_sample);
+    } else {
+        // Video-only recordings pass no audio format so no audio stream is created
+        int audio = config->audio_streams > 0;
+        result = encoder_init(context, config->path, config->width, config->height, config->fps,
+                              audio ? config->sample_rate : 0, audio ? config->channels : 0,
+                              audio ? config->bits_per_sample : 0);
+    }
+    
+    // Single-track BGRA goes to Media Foundation bottom-up
+    backend->bottom_up = config->video && !dual_track && config->format == ENCODER_INPUT_BGRA;
+    return result;
+}
+
+static int mf_backend_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    return encoder_add_video_frame((encoder_context_t*)backend->impl, pool, frame, (LONGLONG)time);
+}
+
+static int mf_backend_repeat_video(encoder_backend_t* backend, int64_t time) {
+    return encoder_repeat_video_frame((encoder_context_t*)backend->impl, (LONGLONG)time);
+}
+
+// Stream 0 is system audio and 1 the microphone when they are kept apart
+static int mf_backend_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time) {
+    encoder_context_t* context = (encoder_context_t*)backend->impl;
+    DWORD elapsed_ms = (DWORD)(time / 10000);
+    if (backend->config.audio_streams < 2) return encoder_add_audio_frame(context, (BYTE*)data, frames, elapsed_ms);
+    if (stream == 0) return encoder_add_system_audio_frame(context, (BYTE*)data, frames, elapsed_ms);
+    return encoder_add_mic_audio_frame(context, (BYTE*)data, frames, elapsed_ms);
+}
+
+static int mf_backend_finalize(encoder_backend_t* backend) {
+    return encoder_finalize((encoder_context_t*)backend->impl);
+}
+
+// Media Foundation writes the file itself; its size is the only count of bytes
+static void mf_backend_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats) {
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (backend->path[0] && GetFileAttributesExA(backend->path, GetFileExInfoStandard, &info)) {
+        stats->bytes = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    }
+}
+
+static void mf_backend_destroy(encoder_backend_t* backend) {
+    if (backend->impl) encoder_cleanup((encoder_context_t*)backend->impl);
+    backend->impl = NULL;
+}
+
+static const encoder_backend_ops_t mf_backend_ops = {
+    "mf",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_BGRA) | ENCODER_FORMAT_BIT(ENCODER_INPUT_NV12),
+    1,
+    mf_backend_init,
+    mf_backend_push_video,
+    mf_backend_repeat_video,
+    mf_backend_push_audio,
+    NULL,
+    mf_backend_finalize,
+    mf_backend_stats,
+    NULL,
+    mf_backend_destroy
+};
+
+int mf_backend_create(encoder_backend_t* backend, encoder_context_t* context) {
+    if (!backend || !context) return -1;
+    memset(backend, 0, sizeof(encoder_backend_t));
+    backend->ops = &mf_backend_ops;
+    backend->impl = context;
+    return 0;
 }
@@ -0,0 +1,221 @@
+#include "encoder_backend.h"
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* const encoder_backend_names[] = { "mf", "h264", "x264", "raw", "spool", "null" };
+
+int encoder_backend_create(encoder_backend_t* backend, encoder_backend_kind_t kind) {
+    switch (kind) {
+    case ENCODER_BACKEND_H264:
+        return h264_backend_create(backend);
+    case ENCODER_BACKEND_X264:
+        return x264_backend_create(backend);
+    case ENCODER_BACKEND_RAW:
+        return raw_backend_create(backend);
+    case ENCODER_BACKEND_SPOOL:
+        return spool_backend_create(backend);
+    case ENCODER_BACKEND_NULL:
+        return null_backend_create(backend);
+    default:
+        fprintf(stderr, "Encoder: The %s backend is not available on this platform\n", encoder_backend_kind_name(kind));
+        if (backend) memset(backend, 0, sizeof(encoder_backend_t));
+        return -1;
+    }
+}
+
+int encoder_backend_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    if (!backend || !backend->ops || !config || !config->path) return -1;
+    const encoder_backend_ops_t* ops = backend->ops;
+    if (config->video && (config->width <= 0 || config->height <= 0 || config->fps <= 0 ||
+                          !encoder_backend_takes(backend, config->format))) {
+        fprintf(stderr, "Encoder: The %s backend cannot take %dx%d %s video at %d fps\n", ops->name,
+                config->width, config->height, config->format == ENCODER_INPUT_NV12 ? "NV12" : "BGRA", config->fps);
+        return -1;
+    }
+    if (config->audio_streams < 0 || config->audio_streams > ENCODER_BACKEND_MAX_AUDIO ||
+        (config->audio_streams > 0 && (!ops->audio || config->sample_rate <= 0 || config->channels <= 0))) {
+        fprintf(stderr, "Encoder: The %s backend cannot take %d audio streams\n", ops->name, config->audio_streams);
+        return -1;
+    }
+    if (strlen(config->path) >= sizeof(backend->path)) return -1;
+
+    // The path is copied so segment names can be built in a reused buffer
+    memmove(backend->path, config->path, strlen(config->path) + 1);
+    backend->config = *config;
+    backend->config.path = backend->path;
+    backend->bottom_up = 0;
+    backend->failed = 0;
+    if (ops->init(backend, &backend->config) != 0) return -1;
+    backend->open = 1;
+    return 0;
+}
+
+static int encoder_backend_ready(const encoder_backend_t* backend) {
+    return backend && backend->ops && backend->open && !backend->failed;
+}
+
+// Counts a refusal and times the call
+static int encoder_backend_account(encoder_backend_t* backend, int result, uint64_t start) {
+    if (result != 0) backend->stats.failures++;
+    backend->stats.busy_ns += platform_time_ns() - start;
+    return result;
+}
+
+int encoder_backend_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    if (!encoder_backend_ready(backend) || !pool || frame == FRAME_HANDLE_INVALID) return -1;
+    uint64_t start = platform_time_ns();
+    int result = backend->ops->push_video(backend, pool, frame, time);
+    if (result == 0) backend->stats.video_frames++;
+    return encoder_backend_account(backend, result, start);
+}
+
+int encoder_backend_repeat_video(encoder_backend_t* backend, int64_t time) {
+    if (!encoder_backend_ready(backend)) return -1;
+    uint64_t start = platform_time_ns();
+    int result = backend->ops->repeat_video(backend, time);
+    if (result == 0) backend->stats.repeated_frames++;
+    return encoder_backend_account(backend, result, start);
+}
+
+int encoder_backend_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time) {
+    if (!encoder_backend_ready(backend) || !data || stream < 0 || stream >= backend->config.audio_streams) return -1;
+    uint64_t start = platform_time_ns();
+    int result = backend->ops->push_audio(backend, stream, data, frames, time);
+    if (result == 0) backend->stats.audio_frames += frames;
+    return encoder_backend_account(backend, result, start);
+}
+
+int encoder_backend_flush(encoder_backend_t* backend) {
+    if (!encoder_backend_ready(backend)) return -1;
+    if (!backend->ops->flush) return 0;
+    uint64_t start = platform_time_ns();
+    return encoder_backend_account(backend, backend->ops->flush(backend), start);
+}
+
+int encoder_backend_finalize(encoder_backend_t* backend) {
+    if (!backend || !backend->ops) return -1;
+    if (!backend->open) return 0;
+    uint64_t start = platform_time_ns();
+    int result = backend->ops->finalize(backend);
+    backend->open = 0;
+    backend->stats.busy_ns += platform_time_ns() - start;
+    return result;
+}
+
+void encoder_backend_get_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(encoder_backend_stats_t));
+    if (!backend || !backend->ops) return;
+    if (backend->ops->stats) backend->ops->stats(backend, &backend->stats);
+    *stats = backend->stats;
+}
+
+void encoder_backend_report(encoder_backend_t* backend, encoder_backend_report_fn report) {
+    if (!backend || !backend->ops || !report) return;
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(backend, &stats);
+    uint64_t pushes = stats.video_frames + stats.repeated_frames;
+    char message[256];
+    snprintf(message, sizeof(message), "Encoder: %s, %llu frames (%llu repeats), %.2f ms per frame, %llu refused",
+             backend->ops->name, (unsigned long long)pushes, (unsigned long long)stats.repeated_frames,
+             pushes > 0 ? stats.busy_ns / 1e6 / (double)pushes : 0.0, (unsigned long long)stats.failures);
+    report(message);
+    if (backend->ops->report) backend->ops->report(backend, report);
+}
+
+void encoder_backend_destroy(encoder_backend_t* backend) {
+    if (!backend) return;
+    if (backend->ops && backend->ops->destroy) backend->ops->destroy(backend);
+    memset(backend, 0, sizeof(encoder_backend_t));
+}
+
+void encoder_backend_set_packet_sink(encoder_backend_t* backend, encoder_packet_fn sink, void* context) {
+    if (!backend) return;
+    backend->packet_sink = sink;
+    backend->packet_context = context;
+}
+
+int encoder_backend_takes(const encoder_backend_t* backend, encoder_input_format_t format) {
+    return backend && backend->ops && (backend->ops->formats & ENCODER_FORMAT_BIT(format)) != 0;
+}
+
+const char* encoder_backend_name(const encoder_backend_t* backend) {
+    return backend && backend->ops ? backend->ops->name : "none";
+}
+
+const char* encoder_backend_kind_name(encoder_backend_kind_t kind) {
+    if ((int)kind < 0 || (size_t)kind >= sizeof(encoder_backend_names) / sizeof(encoder_backend_names[0])) return "unknown";
+    return encoder_backend_names[kind];
+}
+
+int encoder_backend_parse(const char* name, encoder_backend_kind_t* kind) {
+    if (!name || !kind) return -1;
+    for (size_t i = 0; i < sizeof(encoder_backend_names) / sizeof(encoder_backend_names[0]); i++) {
+        if (strcmp(name, encoder_backend_names[i]) == 0) {
+            *kind = (encoder_backend_kind_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Null backend
+// ---------------------------------------------------------------------------
+
+static int null_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    (void)backend;
+    (void)config;
+    return 0;
+}
+
+static int null_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    (void)backend;
+    (void)pool;
+    (void)frame;
+    (void)time;
+    return 0;
+}
+
+static int null_repeat_video(encoder_backend_t* backend, int64_t time) {
+    (void)backend;
+    (void)time;
+    return 0;
+}
+
+static int null_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time) {
+    (void)backend;
+    (void)stream;
+    (void)data;
+    (void)frames;
+    (void)time;
+    return 0;
+}
+
+static int null_finalize(encoder_backend_t* backend) {
+    (void)backend;
+    return 0;
+}
+
+static const encoder_backend_ops_t null_ops = {
+    "null",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_BGRA) | ENCODER_FORMAT_BIT(ENCODER_INPUT_NV12),
+    1,
+    null_init,
+    null_push_video,
+    null_repeat_video,
+    null_push_audio,
+    NULL,
+    null_finalize,
+    NULL,
+    NULL,
+    NULL
+};
+
+int null_backend_create(encoder_backend_t* backend) {
+    if (!backend) return -1;
+    memset(backend, 0, sizeof(encoder_backend_t));
+    backend->ops = &null_ops;
+    return 0;
+}
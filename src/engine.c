@@ -1,16 +1,150 @@
 #include "engine.h"
-#include "screen.h"
+#include "capture_source.h"
+#include "dxgi_source.h"
+#include "synthetic_source.h"
+#include "replay_source.h"
 #include "microphone.h"
 #include "system.h"
 #include "encoder.h"
+#include "encoder_backend.h"
+#include "frame_pool.h"
+#include "copy_kernels.h"
+#include "scaler.h"
+#include "color_convert.h"
+#include "worker_pool.h"
+#include "tile_hash.h"
+#include "spsc_ring.h"
+#include "pipeline.h"
+#include "frame_pacer.h"
+#include "fps_meter.h"
+#include "audio_capture.h"
+#include "wasapi_source.h"
+#include "segmenter.h"
+#include "replay_buffer.h"
+#include "params.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-// Internal contexts - completely isolated for modular recording
-static screen_capture_t screen_ctx = {0};
-static microphone_context_t microphone_ctx = {0};
-static system_context_t system_ctx = {0};
-static encoder_context_t encoder_ctx = {0};
+// Recording pipeline: the capture thread grabs frames on the frame pacer, the
+// video thread scales and converts them, one audio_capture thread per endpoint
+// drains WASAPI when the device signals, and the mux thread is the only one
+// that calls the encoder. Frame and packet handles move between them through
+// SPSC rings; when the video side falls behind, capture drops the grab instead
+// of waiting.
+//
+// Queues and pools are sized in time rather than frames, so high frame rates
+// keep the same slack: two frames per video queue up to 120 fps, four at 240.
+#define ENGINE_VIDEO_QUEUE_MS 16
+#define ENGINE_ENCODER_QUEUE_MS 33      // Samples queued inside Media Foundation
+#define ENGINE_SEGMENT_POLL_MS 250      // How often the open segment's file size is read
+#define ENGINE_DETECT_THREADS 2         // Change detection: the capture thread and one helper
+
+// Rounded up, and never fewer than two
+static int engine_frames_within(int fps, unsigned int milliseconds) {
+    int frames = (int)frame_pacer_frames_within((uint32_t)fps, 1, milliseconds);
+    return frames < 2 ? 2 : frames;
+}
+
+typedef struct {
+    int kind;                   // CAPTURE_FRAME_NEW or CAPTURE_FRAME_REPEAT
+    frame_handle_t frame;       // Invalid for repeats
+    frame_pool_t* pool;         // frame_pool, or encode_pool once transformed
+    LONGLONG capture_time;      // Frame slot time since recording start, 100 ns units
+} engine_video_item_t;
+
+// State shared by the stage threads; each counter has a single writer
+typedef struct {
+    frame_pacer_t pacer;            // Recording clock; frame slots for the capture thread
+    BOOL video_enabled;
+    BOOL high_frame_rate;           // fps >= CAPTURE_HIGH_FRAME_RATE
+    BOOL microphone_ok;
+    BOOL system_ok;
+    int capture_stage;
+    int video_stage;
+    int mux_stage;
+    
+    // Capture thread
+    int failed_frame_attempts;
+    int dropped_frames;             // Capture queue full
+    // Video thread
+    int failed_transforms;
+    // Mux thread, read by the supervising thread for progress
+    platform_atomic_t frame_count;
+} engine_recording_t;
+
+// Everything one engine records with. Each capture_engine_t owns its own, so
+// several engines in one process record independently.
+struct engine_session {
+    // Internal contexts - completely isolated for modular recording
+    capture_source_t capture_source;
+    microphone_context_t microphone_ctx;
+    system_context_t system_ctx;
+    encoder_context_t encoder_ctx;
+    encoder_backend_t encoder_backend;
+    frame_pool_t frame_pool;
+    
+    // Frame transforms between capture and encode: optional downscale (--scale /
+    // --output-size) and BGRA to NV12 conversion, both sliced across the worker pool.
+    // Transformed frames come from encode_pool.
+    int frame_width;
+    int frame_height;
+    scaler_t scaler;
+    BOOL scaling_enabled;
+    color_converter_t converter;
+    BOOL convert_enabled;
+    uint8_t* scale_scratch;
+    frame_pool_t encode_pool;
+    worker_pool_t worker_pool;
+    
+    // Tile-hash change detection: captured frames identical to the previous one become repeats.
+    // It runs on the capture thread with a pool of its own, so capture never waits for the
+    // video thread's scaling and conversion to release worker_pool.
+    tile_hash_t change_detector;
+    worker_pool_t detect_pool;
+    BOOL change_detect_enabled;
+    
+    int video_queue_depth;
+    int segment_hold_frames;            // Frames the segmenter may hold at a boundary
+    engine_recording_t recording;
+    pipeline_t pipeline;
+    spsc_ring_t capture_queue;
+    spsc_ring_t video_queue;
+    audio_source_t microphone_source;
+    audio_source_t system_source;
+    audio_capture_t microphone_capture;
+    audio_capture_t system_capture;
+    platform_atomic_t stop_requested;   // Set by engine_stop from any thread
+    
+    // How every segment's encoder is opened, so rollovers match the first file
+    encoder_backend_config_t encoder_config;
+    
+    // Segmented output: the mux thread hands frames and audio to the segmenter, which
+    // rolls the encoder over to the next file and finalizes the old one on its own thread
+    BOOL segmenting;
+    BOOL segmenter_started;
+    segmenter_t segmenter;
+    int segment_system_stream;          // Segmenter stream of each source, -1 when not recorded
+    int segment_microphone_stream;
+    ULONGLONG segment_bytes;            // Open segment's size at the last poll
+    DWORD segment_bytes_polled;
+    
+    // Replay mode (--replay-buffer): the encoder's packets go to memory only, and
+    // engine_save_replay writes the last seconds from any thread. replay_lock keeps a
+    // save from racing the buffer's teardown.
+    replay_buffer_t replay;
+    platform_mutex_t replay_lock;
+    BOOL replaying;
+    uint32_t replay_saves;
+};
+
+typedef struct engine_session engine_session_t;
+
+// Frames in flight: capture, both video queues, the encoder's held-back sample, samples queued inside
+// Media Foundation and frames the segmenter holds while a boundary waits for audio
+static int engine_frame_pool_capacity(const engine_session_t* session, int fps) {
+    return 4 + 2 * session->video_queue_depth + engine_frames_within(fps, ENGINE_ENCODER_QUEUE_MS) + session->segment_hold_frames;
+}
 
 // Default status callback (prints to console)
 static void default_status_callback(const char* message) {
@@ -24,6 +158,475 @@ static void default_progress_callback(int frame_count, DWORD elapsed_ms) {
     }
 }
 
+// The Media Foundation backend drives encoder_ctx, which segment rollover detaches directly
+static int engine_create_backend(engine_session_t* session, encoder_backend_kind_t kind) {
+    if (kind == ENCODER_BACKEND_MEDIA_FOUNDATION) return mf_backend_create(&session->encoder_backend, &session->encoder_ctx);
+    return encoder_backend_create(&session->encoder_backend, kind);
+}
+
+static int engine_open_encoder(engine_session_t* session, const char* filename) {
+    session->encoder_config.path = filename;
+    return encoder_backend_init(&session->encoder_backend, &session->encoder_config);
+}
+
+// Encoder packet sink in replay mode, called on the mux thread
+static void engine_replay_packet(void* context, int type, const uint8_t* data, size_t size, int64_t time) {
+    engine_session_t* session = (engine_session_t*)context;
+    if (type == ENCODER_PACKET_AUDIO) {
+        replay_buffer_write_audio(&session->replay, data, size, time);
+    } else {
+        replay_buffer_write_video(&session->replay, data, size, time);
+    }
+}
+
+// Replay bytes per second when every frame changes, 0 when there is no fixed
+// bound. The software writer sends changed macroblocks uncompressed (I_PCM),
+// so at worst each frame is a whole NV12 picture; x264 compresses.
+static double engine_replay_worst_rate(const engine_session_t* session, const capture_params_t* params) {
+    if (params->encoder_backend != ENCODER_BACKEND_H264) return 0.0;
+    return (double)color_frame_size(COLOR_FORMAT_NV12, session->encoder_config.width, session->encoder_config.height) *
+           params->fps;
+}
+
+static int engine_start_replay(engine_session_t* session, const capture_params_t* params) {
+    replay_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.budget_bytes = (size_t)params->replay_budget_mb * 1024 * 1024;
+    config.max_duration = (int64_t)params->replay_seconds * ENCODER_BACKEND_UNITS_PER_SECOND;
+    config.video = 1;
+    config.audio = session->encoder_config.audio_streams > 0;
+    config.frame_duration = (uint32_t)(ENCODER_BACKEND_UNITS_PER_SECOND / params->fps);
+    if (replay_buffer_init(&session->replay, &config) != 0) return -1;
+    
+    session->encoder_config.packets_only = 1;
+    encoder_backend_set_packet_sink(&session->encoder_backend, engine_replay_packet, session);
+    platform_mutex_lock(&session->replay_lock);
+    session->replaying = TRUE;
+    session->replay_saves = 0;
+    platform_mutex_unlock(&session->replay_lock);
+    return 0;
+}
+
+// Waits for requested saves; the buffer is gone once this returns
+static void engine_cleanup_replay(engine_session_t* session, capture_status_callback_t report) {
+    platform_mutex_lock(&session->replay_lock);
+    BOOL replaying = session->replaying;
+    session->replaying = FALSE;
+    platform_mutex_unlock(&session->replay_lock);
+    if (!replaying) return;
+    replay_buffer_wait_saves(&session->replay);
+    if (report) replay_buffer_report(&session->replay, report);
+    replay_buffer_cleanup(&session->replay);
+}
+
+// System audio is the first backend stream; the microphone has its own only when they are kept apart
+static int engine_audio_stream(const engine_session_t* session, BOOL microphone) {
+    return microphone && session->encoder_config.audio_streams == 2 ? 1 : 0;
+}
+
+// Segmenter sink: the encoder, one file at a time; called on the mux thread
+static int engine_segment_open(void* context, uint32_t index, const char* path, int64_t start_time) {
+    engine_session_t* session = (engine_session_t*)context;
+    (void)index;
+    (void)start_time;
+    session->segment_bytes = 0;
+    session->segment_bytes_polled = GetTickCount();
+    return engine_open_encoder(session, path);
+}
+
+static int engine_segment_video(void* context, const void* frame, int64_t time) {
+    engine_session_t* session = (engine_session_t*)context;
+    const engine_video_item_t* video = (const engine_video_item_t*)frame;
+    if (video->kind != CAPTURE_FRAME_NEW) return encoder_backend_repeat_video(&session->encoder_backend, time);
+    
+    int result = encoder_backend_push_video(&session->encoder_backend, video->pool, video->frame, time);
+    frame_pool_release(video->pool, video->frame);
+    return result;
+}
+
+static int engine_segment_audio(void* context, int stream, const uint8_t* data, uint32_t frames, uint64_t position) {
+    engine_session_t* session = (engine_session_t*)context;
+    int64_t time = (int64_t)(position * ENCODER_BACKEND_UNITS_PER_SECOND / (UINT64)session->encoder_config.sample_rate);
+    return encoder_backend_push_audio(&session->encoder_backend, engine_audio_stream(session, stream == session->segment_microphone_stream),
+                                      data, frames, time);
+}
+
+// The file grows as Media Foundation writes it; reading its size every frame would cost a syscall each
+static uint64_t engine_segment_bytes(void* context) {
+    engine_session_t* session = (engine_session_t*)context;
+    DWORD now = GetTickCount();
+    if (now - session->segment_bytes_polled >= ENGINE_SEGMENT_POLL_MS) {
+        WIN32_FILE_ATTRIBUTE_DATA info;
+        if (GetFileAttributesExA(session->segmenter.path, GetFileExInfoStandard, &info)) {
+            session->segment_bytes = ((ULONGLONG)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+        }
+        session->segment_bytes_polled = now;
+    }
+    return session->segment_bytes;
+}
+
+static void* engine_segment_close(void* context, int64_t end_time) {
+    engine_session_t* session = (engine_session_t*)context;
+    return encoder_detach_segment(&session->encoder_ctx, end_time);
+}
+
+// Finalizer thread
+static int engine_segment_finalize(void* context, void* segment) {
+    (void)context;
+    return encoder_finalize_segment((encoder_segment_t*)segment);
+}
+
+static int engine_start_segmenter(engine_session_t* session, const capture_params_t* params, const capture_stats_t* stats) {
+    segmenter_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.max_duration = (int64_t)params->segment_time * SEGMENTER_UNITS_PER_SECOND;
+    config.max_bytes = params->segment_size;
+    config.video = session->recording.video_enabled;
+    config.video_item_size = sizeof(engine_video_item_t);
+    session->segment_system_stream = session->recording.system_ok ? config.audio_streams++ : -1;
+    session->segment_microphone_stream = session->recording.microphone_ok ? config.audio_streams++ : -1;
+    for (int stream = 0; stream < config.audio_streams; stream++) {
+        config.audio_rate[stream] = (uint32_t)stats->audio_sample_rate;
+        config.audio_frame_bytes[stream] = (uint32_t)(stats->audio_channels * stats->audio_bits_per_sample / 8);
+    }
+    
+    segment_sink_t sink = { engine_segment_open, engine_segment_video, engine_segment_audio, engine_segment_bytes,
+                            engine_segment_close, engine_segment_finalize };
+    if (segmenter_init(&session->segmenter, &config, params->output_filename, &sink, session) != 0) return -1;
+    session->segmenter_started = TRUE;
+    session->segment_bytes = 0;
+    session->segment_bytes_polled = GetTickCount();
+    return 0;
+}
+
+// Create the capture source the parameters ask for; fills in the video size
+static int engine_create_source(engine_session_t* session, capture_engine_t* engine, const capture_params_t* params) {
+    int result = -1;
+    switch (params->capture_source) {
+    case CAPTURE_SOURCE_SYNTHETIC: {
+        synthetic_source_config_t config;
+        config.pattern = params->synthetic_pattern;
+        config.width = params->source_width;
+        config.height = params->source_height;
+        config.fps = params->fps;
+        config.seed = 1;
+        result = synthetic_source_create(&session->capture_source, &config);
+        break;
+    }
+    case CAPTURE_SOURCE_REPLAY:
+        result = replay_source_create(&session->capture_source, params->replay_filename, params->replay_loop);
+        break;
+    default: {
+        dxgi_source_config_t config;
+        config.monitor_index = params->monitor_index;
+        config.virtual_desktop = params->virtual_desktop;
+        config.region_enabled = params->region_enabled;
+        config.region_x = params->region_x;
+        config.region_y = params->region_y;
+        config.region_w = params->region_w;
+        config.region_h = params->region_h;
+        config.cursor_enabled = params->cursor_enabled;
+        result = dxgi_source_create(&session->capture_source, &config);
+        break;
+    }
+    }
+    
+    if (result != 0) {
+        engine->status_callback("Error: Failed to initialize screen capture");
+        return -1;
+    }
+    
+    char source_msg[128];
+    sprintf(source_msg, "Capture source: %s, %dx%d", capture_source_name(&session->capture_source),
+            session->capture_source.width, session->capture_source.height);
+    engine->status_callback(source_msg);
+    return 0;
+}
+
+// Turn a captured BGRA frame into the frame the encoder consumes. Consumes the
+// capture reference; returns FRAME_HANDLE_INVALID if no encode frame is free.
+static frame_handle_t engine_transform_frame(engine_session_t* session, frame_handle_t frame) {
+    frame_handle_t out = frame_pool_acquire(&session->encode_pool);
+    if (out != FRAME_HANDLE_INVALID) {
+        uint8_t* out_data = (uint8_t*)frame_pool_data(&session->encode_pool, out);
+        const uint8_t* bgra = (const uint8_t*)frame_pool_data(&session->frame_pool, frame);
+        int width = session->frame_width;
+        int height = session->frame_height;
+        int result = 0;
+        
+        if (session->scaling_enabled) {
+            uint8_t* scaled = session->convert_enabled ? session->scale_scratch : out_data;
+            result = scaler_process(&session->scaler, scaled, (size_t)session->scaler.dst_width * 4, bgra, (size_t)width * 4);
+            bgra = scaled;
+            width = session->scaler.dst_width;
+            height = session->scaler.dst_height;
+        }
+        if (result == 0 && session->convert_enabled) {
+            color_planes_t planes;
+            result = color_planes_for_buffer(COLOR_FORMAT_NV12, out_data, width, height, &planes);
+            if (result == 0) {
+                result = color_convert_frame(&session->converter, COLOR_FORMAT_NV12, &planes, bgra, (size_t)width * 4, width, height);
+            }
+        }
+        
+        if (result != 0) {
+            frame_pool_release(&session->encode_pool, out);
+            out = FRAME_HANDLE_INVALID;
+        }
+    }
+    frame_pool_release(&session->frame_pool, frame);
+    return out;
+}
+
+// The mux thread talks to Media Foundation from the multithreaded apartment
+static void engine_stage_com_init(void* context) {
+    (void)context;
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+}
+
+static void engine_stage_com_exit(void* context) {
+    (void)context;
+    CoUninitialize();
+}
+
+// High frame rates leave a few milliseconds per frame; keep the capture thread ahead of normal-priority work
+static void engine_capture_thread_init(void* context) {
+    (void)context;
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+}
+
+static void engine_capture_thread_exit(void* context) {
+    (void)context;
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+}
+
+// Capture thread: grab on the frame clock and hand the frame to the video thread
+static int engine_capture_step(void* context) {
+    engine_session_t* session = (engine_session_t*)context;
+    engine_recording_t* run = &session->recording;
+    
+    // A replay without looping ends the recording with its last frame
+    if (session->capture_source.finished) return PIPELINE_STEP_DONE;
+    
+    // Sleeps until the next frame slot; a stalled thread resumes on the latest one
+    frame_pacer_tick_t tick;
+    if (frame_pacer_wait(&run->pacer, &tick) != 0) return PIPELINE_STEP_ERROR;
+    
+    frame_handle_t frame = FRAME_HANDLE_INVALID;
+    
+    // Frames arrive the way the encoder backend wants them; only single-track Media Foundation BGRA is bottom-up
+    int frame_result = capture_source_get_frame(&session->capture_source, &frame,
+                                                !session->encoder_backend.bottom_up);
+    
+    // A reported update that left every tile identical (repaint, no-op present) is a repeat
+    if (frame_result == CAPTURE_FRAME_NEW && frame != FRAME_HANDLE_INVALID && session->change_detect_enabled &&
+        tile_hash_update(&session->change_detector, (const uint8_t*)frame_pool_data(&session->frame_pool, frame), (size_t)session->frame_width * 4) == 0) {
+        frame_pool_release(&session->frame_pool, frame);
+        frame = FRAME_HANDLE_INVALID;
+        frame_result = CAPTURE_FRAME_REPEAT;
+    }
+    
+    if ((frame_result == CAPTURE_FRAME_NEW && frame != FRAME_HANDLE_INVALID) || frame_result == CAPTURE_FRAME_REPEAT) {
+        engine_video_item_t item;
+        item.kind = frame_result;
+        item.frame = frame;
+        item.pool = &session->frame_pool;
+        item.capture_time = (LONGLONG)(tick.time_ns / 100);
+        if (spsc_ring_push(&session->capture_queue, &item) == 0) {
+            pipeline_notify(&session->pipeline, run->video_stage);
+        } else {
+            // The video thread is behind; losing this grab keeps the next one on time
+            if (frame != FRAME_HANDLE_INVALID) frame_pool_release(&session->frame_pool, frame);
+            run->dropped_frames++;
+        }
+    } else {
+        run->failed_frame_attempts++;
+    }
+    
+    return PIPELINE_STEP_BUSY;
+}
+
+// Video thread: scale and convert, then queue for the mux thread
+static int engine_video_step(void* context) {
+    engine_session_t* session = (engine_session_t*)context;
+    engine_recording_t* run = &session->recording;
+    
+    if (spsc_ring_depth(&session->capture_queue) == 0) return PIPELINE_STEP_IDLE;
+    if (spsc_ring_depth(&session->video_queue) >= session->video_queue.capacity) return PIPELINE_STEP_BLOCKED;
+    
+    engine_video_item_t item;
+    if (spsc_ring_pop(&session->capture_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    
+    if (item.kind == CAPTURE_FRAME_NEW && (session->scaling_enabled || session->convert_enabled)) {
+        item.frame = engine_transform_frame(session, item.frame);
+        item.pool = &session->encode_pool;
+        if (item.frame == FRAME_HANDLE_INVALID) {
+            run->failed_transforms++;
+            return PIPELINE_STEP_BUSY;
+        }
+    }
+    
+    // Only this thread pushes here and the depth was checked above
+    spsc_ring_push(&session->video_queue, &item);
+    pipeline_notify(&session->pipeline, run->mux_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+// Mux thread: the only caller of the encoder, so the sink writer sees one thread
+static int engine_mux_step(void* context) {
+    engine_session_t* session = (engine_session_t*)context;
+    engine_recording_t* run = &session->recording;
+    int worked = 0;
+    
+    engine_video_item_t video;
+    if (run->video_enabled && spsc_ring_pop(&session->video_queue, &video) == 0) {
+        // Room for a blocked video thread
+        pipeline_notify(&session->pipeline, run->video_stage);
+        if (session->segmenting) {
+            // The segmenter writes (and releases) the frame once the audio before it is in
+            if (!session->segmenter.failed) {
+                segmenter_video(&session->segmenter, &video, video.capture_time, video.kind == CAPTURE_FRAME_NEW);
+            } else if (video.kind == CAPTURE_FRAME_NEW) {
+                frame_pool_release(video.pool, video.frame);
+            }
+        } else if (video.kind == CAPTURE_FRAME_NEW) {
+            encoder_backend_push_video(&session->encoder_backend, video.pool, video.frame, video.capture_time);
+            frame_pool_release(video.pool, video.frame);
+        } else {
+            // Static desktop: the encoder extends the previous sample, no pixels move
+            encoder_backend_repeat_video(&session->encoder_backend, video.capture_time);
+        }
+        platform_atomic_inc(&run->frame_count);
+        worked = 1;
+    }
+    
+    // Out of disk or a muxer error: stop rather than record a gap
+    if (session->encoder_backend.failed) return PIPELINE_STEP_ERROR;
+    
+    // Dual-track recordings keep system and microphone apart; otherwise both feed the one audio track
+    audio_packet_t packet;
+    if (audio_capture_pop(&session->system_capture, &packet) == 0) {
+        const uint8_t* data = (const uint8_t*)audio_capture_packet_data(&session->system_capture, &packet);
+        int64_t time = (int64_t)(packet.position * ENCODER_BACKEND_UNITS_PER_SECOND / (UINT64)session->system_source.sample_rate);
+        if (session->segmenting) {
+            if (session->segment_system_stream >= 0) segmenter_audio(&session->segmenter, session->segment_system_stream, data, packet.frames);
+        } else {
+            encoder_backend_push_audio(&session->encoder_backend, engine_audio_stream(session, FALSE), data, packet.frames, time);
+        }
+        audio_capture_release(&session->system_capture, &packet);
+        worked = 1;
+    }
+    if (audio_capture_pop(&session->microphone_capture, &packet) == 0) {
+        const uint8_t* data = (const uint8_t*)audio_capture_packet_data(&session->microphone_capture, &packet);
+        int64_t time = (int64_t)(packet.position * ENCODER_BACKEND_UNITS_PER_SECOND / (UINT64)session->microphone_source.sample_rate);
+        if (session->segmenting) {
+            if (session->segment_microphone_stream >= 0) segmenter_audio(&session->segmenter, session->segment_microphone_stream, data, packet.frames);
+        } else {
+            encoder_backend_push_audio(&session->encoder_backend, engine_audio_stream(session, TRUE), data, packet.frames, time);
+        }
+        audio_capture_release(&session->microphone_capture, &packet);
+        worked = 1;
+    }
+    
+    return worked ? PIPELINE_STEP_BUSY : PIPELINE_STEP_IDLE;
+}
+
+// Called on an audio capture thread after it queued packets
+static void engine_audio_notify(void* context) {
+    engine_session_t* session = (engine_session_t*)context;
+    pipeline_notify(&session->pipeline, session->recording.mux_stage);
+}
+
+// Queues and stages for one recording; producers are added before their consumers
+static int engine_build_pipeline(engine_session_t* session) {
+    engine_recording_t* run = &session->recording;
+    pipeline_init(&session->pipeline);
+    run->capture_stage = -1;
+    run->video_stage = -1;
+    run->mux_stage = -1;
+    
+    if (run->video_enabled) {
+        if (spsc_ring_init(&session->capture_queue, "capture->video", (unsigned int)session->video_queue_depth, sizeof(engine_video_item_t)) != 0 ||
+            spsc_ring_init(&session->video_queue, "video->mux", (unsigned int)session->video_queue_depth, sizeof(engine_video_item_t)) != 0) {
+            return -1;
+        }
+        pipeline_add_queue(&session->pipeline, &session->capture_queue);
+        pipeline_add_queue(&session->pipeline, &session->video_queue);
+        
+        pipeline_stage_desc_t capture = { "capture", engine_capture_step, NULL, NULL, session, 1, 1 };
+        if (run->high_frame_rate) {
+            capture.thread_init = engine_capture_thread_init;
+            capture.thread_exit = engine_capture_thread_exit;
+        }
+        run->capture_stage = pipeline_add_stage(&session->pipeline, &capture);
+        if (run->capture_stage < 0) return -1;
+    }
+    
+    // Audio runs on its own capture threads and feeds the mux stage directly
+    if (run->system_ok) {
+        if (wasapi_source_create_system(&session->system_source, &session->system_ctx) != 0 ||
+            audio_capture_init(&session->system_capture, "system audio", &session->system_source, 0) != 0) {
+            return -1;
+        }
+        audio_capture_set_notify(&session->system_capture, engine_audio_notify, session);
+        pipeline_add_queue(&session->pipeline, &session->system_capture.queue);
+    }
+    if (run->microphone_ok) {
+        if (wasapi_source_create_microphone(&session->microphone_source, &session->microphone_ctx) != 0 ||
+            audio_capture_init(&session->microphone_capture, "microphone", &session->microphone_source, 0) != 0) {
+            return -1;
+        }
+        audio_capture_set_notify(&session->microphone_capture, engine_audio_notify, session);
+        pipeline_add_queue(&session->pipeline, &session->microphone_capture.queue);
+    }
+    
+    if (run->video_enabled) {
+        pipeline_stage_desc_t video = { "video", engine_video_step, NULL, NULL, session, 0, 0 };
+        run->video_stage = pipeline_add_stage(&session->pipeline, &video);
+        if (run->video_stage < 0) return -1;
+    }
+    
+    pipeline_stage_desc_t mux = { "mux", engine_mux_step, engine_stage_com_init, engine_stage_com_exit, session, 0, 0 };
+    run->mux_stage = pipeline_add_stage(&session->pipeline, &mux);
+    return run->mux_stage < 0 ? -1 : 0;
+}
+
+// Joins the audio and stage threads if still running and frees their queues
+static void engine_cleanup_pipeline(engine_session_t* session) {
+    audio_capture_cleanup(&session->system_capture);
+    audio_capture_cleanup(&session->microphone_capture);
+    pipeline_cleanup(&session->pipeline);
+    frame_pacer_cleanup(&session->recording.pacer);
+    spsc_ring_cleanup(&session->capture_queue);
+    spsc_ring_cleanup(&session->video_queue);
+    audio_source_destroy(&session->system_source);
+    audio_source_destroy(&session->microphone_source);
+}
+
+static void engine_cleanup_segmenter(engine_session_t* session) {
+    if (session->segmenter_started) segmenter_cleanup(&session->segmenter);
+    session->segmenter_started = FALSE;
+    session->segmenting = FALSE;
+    session->segment_hold_frames = 0;
+    session->segment_system_stream = -1;
+    session->segment_microphone_stream = -1;
+}
+
+static void engine_cleanup_transform(engine_session_t* session) {
+    scaler_cleanup(&session->scaler);
+    tile_hash_cleanup(&session->change_detector);
+    worker_pool_cleanup(&session->detect_pool);
+    session->change_detect_enabled = FALSE;
+    worker_pool_cleanup(&session->worker_pool);
+    session->scaling_enabled = FALSE;
+    session->convert_enabled = FALSE;
+    if (session->scale_scratch) {
+        platform_aligned_free(session->scale_scratch);
+        session->scale_scratch = NULL;
+    }
+    frame_pool_cleanup(&session->encode_pool);
+}
+
 int engine_init(capture_engine_t* engine) {
     if (!engine) return -1;
     
@@ -31,6 +634,22 @@ int engine_init(capture_engine_t* engine) {
     engine->status_callback = default_status_callback;
     engine->progress_callback = default_progress_callback;
     
+    // Recording state lives with the engine rather than in this file
+    engine->session = (engine_session_t*)calloc(1, sizeof(engine_session_t));
+    if (!engine->session) {
+        fprintf(stderr, "Engine: Failed to allocate the recording session\n");
+        return -1;
+    }
+    engine->session->video_queue_depth = 2;
+    engine->session->segment_system_stream = -1;
+    engine->session->segment_microphone_stream = -1;
+    if (platform_mutex_init(&engine->session->replay_lock) != 0) {
+        fprintf(stderr, "Engine: Failed to create the replay lock\n");
+        free(engine->session);
+        engine->session = NULL;
+        return -1;
+    }
+    
     return 0;
 }
 
@@ -55,19 +674,182 @@ const capture_stats_t* engine_get_stats(const capture_engine_t* engine) {
 }
 
 int engine_start(capture_engine_t* engine, const capture_params_t* params) {
-    if (!engine || !params || engine->is_running) return -1;
+    if (!engine || !engine->session || !params || engine->is_running) return -1;
+    engine_session_t* session = engine->session;
     
     // Copy parameters
     engine->params = *params;
     engine->force_stop = FALSE;
+    platform_atomic_store(&session->stop_requested, 0);
     memset(&engine->stats, 0, sizeof(capture_stats_t));
     
     engine->status_callback("Initializing capture...");
     
+    // Segment boundaries may hold frames back, so the pools get room for them
+    session->segmenting = params->segment_time > 0 || params->segment_size > 0;
+#ifndef MUXSW_ENABLE_AUDIO
+    // Checked before anything is allocated, like the other parameter checks
+    if (params->audio_only_mode) {
+        engine->status_callback("Error: Audio-only mode not supported in MVP build");
+        return -1;
+    }
+#endif
+    if (engine_create_backend(session, params->encoder_backend) != 0) {
+        engine->status_callback("Error: Encoder backend unavailable");
+        return -1;
+    }
+    if (session->segmenting && params->encoder_backend != ENCODER_BACKEND_MEDIA_FOUNDATION) {
+        engine->status_callback("Error: Segmented output needs the Media Foundation encoder");
+        encoder_backend_destroy(&session->encoder_backend);
+        return -1;
+    }
+    if (params->replay_seconds > 0 && (session->segmenting || params->audio_only_mode ||
+        (params->encoder_backend != ENCODER_BACKEND_H264 && params->encoder_backend != ENCODER_BACKEND_X264) ||
+        (params->audio_sources != AUDIO_SOURCE_NONE && !session->encoder_backend.ops->audio))) {
+        engine->status_callback("Error: The replay buffer needs video from the h264 or x264 encoder, without segments or audio");
+        encoder_backend_destroy(&session->encoder_backend);
+        return -1;
+    }
+    if (params->audio_only_mode && !session->encoder_backend.ops->audio) {
+        char backend_msg[128];
+        sprintf(backend_msg, "Error: The %s encoder records video only", encoder_backend_name(&session->encoder_backend));
+        engine->status_callback(backend_msg);
+        encoder_backend_destroy(&session->encoder_backend);
+        return -1;
+    }
+    session->segment_hold_frames = 0;
+    if (session->segmenting && !params->audio_only_mode) {
+        session->segment_hold_frames = engine_frames_within(params->fps, SEGMENTER_DEFAULT_HOLD_MS) + 1;
+        if (session->segment_hold_frames > SEGMENTER_MAX_VIDEO_HOLD) session->segment_hold_frames = SEGMENTER_MAX_VIDEO_HOLD;
+    }
+    
     // Initialize screen capture (skip for audio-only mode)
+    int video_width = 0;
+    int video_height = 0;
     if (!params->audio_only_mode) {
-        if (screen_init(&screen_ctx) != 0) {
-            engine->status_callback("Error: Failed to initialize screen capture");
+        // Region coordinates are per monitor; a stitched canvas has no single monitor to crop
+        if (params->virtual_desktop && params->region_enabled) {
+            engine->status_callback("Error: --region cannot be combined with --monitor all");
+            encoder_backend_destroy(&session->encoder_backend);
+            return -1;
+        }
+        if (engine_create_source(session, engine, params) != 0) {
+            encoder_backend_destroy(&session->encoder_backend);
+            return -1;
+        }
+        video_width = session->capture_source.width;
+        video_height = session->capture_source.height;
+        
+        // Preallocate every frame buffer the video path will use
+        size_t frame_size = (size_t)video_width * video_height * 4;
+        session->video_queue_depth = engine_frames_within(params->fps, ENGINE_VIDEO_QUEUE_MS);
+        if (frame_pool_init(&session->frame_pool, frame_size, engine_frame_pool_capacity(session, params->fps)) != 0) {
+            engine->status_callback("Error: Failed to allocate frame pool");
+            capture_source_destroy(&session->capture_source);
+            encoder_backend_destroy(&session->encoder_backend);
+            return -1;
+        }
+        if (capture_source_set_pool(&session->capture_source, &session->frame_pool) != 0) {
+            engine->status_callback("Error: Capture source does not fit the frame pool");
+            capture_source_destroy(&session->capture_source);
+            frame_pool_cleanup(&session->frame_pool);
+            encoder_backend_destroy(&session->encoder_backend);
+            return -1;
+        }
+    }
+    
+    // Encode size: the capture size unless a downscale was requested
+    int encode_width = video_width;
+    int encode_height = video_height;
+    session->frame_width = video_width;
+    session->frame_height = video_height;
+    if (!params->audio_only_mode) {
+        BOOL transform_failed = FALSE;
+        BOOL scale_requested = params->output_scale > 0.0 || params->output_width > 0 || params->output_height > 0;
+        // Backends that take one format get it whatever --format says
+        BOOL encode_nv12 = encoder_backend_takes(&session->encoder_backend, ENCODER_INPUT_NV12) &&
+                           (params->encode_nv12 || !encoder_backend_takes(&session->encoder_backend, ENCODER_INPUT_BGRA));
+        if (params->encoder_backend == ENCODER_BACKEND_SPOOL) {
+            // The spool keeps frames as captured; size and pixel format are picked when it is encoded
+            if (scale_requested) engine->status_callback("Spool: frames are stored at capture size, scale when encoding");
+            scale_requested = FALSE;
+            encode_nv12 = FALSE;
+        }
+        if ((scale_requested || encode_nv12) && worker_pool_init(&session->worker_pool, params->worker_threads) != 0) {
+            engine->status_callback("Error: Failed to start pixel worker threads");
+            transform_failed = TRUE;
+        }
+        if (!transform_failed && params->change_detection) {
+            int detect_threads = params->worker_threads == 1 ? 1 : ENGINE_DETECT_THREADS;
+            if (worker_pool_init(&session->detect_pool, detect_threads) != 0 ||
+                tile_hash_init(&session->change_detector, video_width, video_height, 0) != 0) {
+                engine->status_callback("Warning: Change detection unavailable");
+                worker_pool_cleanup(&session->detect_pool);
+            } else {
+                tile_hash_set_pool(&session->change_detector, &session->detect_pool);
+                session->change_detect_enabled = TRUE;
+            }
+        }
+        if (!transform_failed && scale_requested) {
+            if (scaler_output_size(video_width, video_height, params->output_scale, params->output_width, params->output_height,
+                                   &encode_width, &encode_height) != 0) {
+                engine->status_callback("Error: Invalid output size");
+                transform_failed = TRUE;
+            } else if (encode_width != video_width || encode_height != video_height) {
+                if (scaler_init(&session->scaler, video_width, video_height, encode_width, encode_height, SCALER_FILTER_AUTO, &session->worker_pool) != 0) {
+                    engine->status_callback("Error: Failed to initialize scaler");
+                    transform_failed = TRUE;
+                } else {
+                    char scale_msg[128];
+                    sprintf(scale_msg, "Scaling %dx%d -> %dx%d (%s, %d threads)", video_width, video_height,
+                            encode_width, encode_height, scaler_filter_name(session->scaler.filter), session->scaler.workers);
+                    engine->status_callback(scale_msg);
+                    session->scaling_enabled = TRUE;
+                }
+            }
+        }
+        
+        // NV12 is 1.5 bytes per pixel instead of 4 and skips the converter inside Media Foundation; 4:2:0 needs even sizes
+        if (!transform_failed && encode_nv12) {
+            if (((encode_width & 1) || (encode_height & 1)) && !encoder_backend_takes(&session->encoder_backend, ENCODER_INPUT_BGRA)) {
+                engine->status_callback("Error: The encoder needs an even frame size");
+                transform_failed = TRUE;
+            } else if ((encode_width & 1) || (encode_height & 1)) {
+                engine->status_callback("Warning: Odd frame size, passing BGRA to the encoder");
+            } else if (color_converter_init(&session->converter, params->color_matrix, params->color_range) == 0) {
+                color_converter_set_pool(&session->converter, &session->worker_pool);
+                char color_msg[128];
+                sprintf(color_msg, "Encoder input: NV12 %s %s range (%d threads)", color_matrix_name(params->color_matrix),
+                        color_range_name(params->color_range), worker_pool_threads(&session->worker_pool));
+                engine->status_callback(color_msg);
+                session->convert_enabled = TRUE;
+            }
+        }
+        
+        if (!transform_failed && (session->scaling_enabled || session->convert_enabled)) {
+            size_t encode_size = session->convert_enabled
+                ? color_frame_size(COLOR_FORMAT_NV12, encode_width, encode_height)
+                : (size_t)encode_width * encode_height * 4;
+            if (frame_pool_init(&session->encode_pool, encode_size, engine_frame_pool_capacity(session, params->fps)) != 0) {
+                engine->status_callback("Error: Failed to allocate encoder frame pool");
+                transform_failed = TRUE;
+            }
+            
+            // Scaled BGRA waits here when it still has to be converted
+            if (session->scaling_enabled && session->convert_enabled) {
+                session->scale_scratch = (uint8_t*)platform_aligned_alloc((size_t)encode_width * encode_height * 4, FRAME_POOL_ALIGNMENT);
+                if (!session->scale_scratch) {
+                    engine->status_callback("Error: Failed to allocate scaler buffer");
+                    transform_failed = TRUE;
+                }
+            }
+        }
+        
+        if (transform_failed) {
+            engine_cleanup_transform(session);
+            capture_source_destroy(&session->capture_source);
+            frame_pool_cleanup(&session->frame_pool);
+            encoder_backend_destroy(&session->encoder_backend);
             return -1;
         }
     }
@@ -83,10 +865,6 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
     use_microphone = FALSE;
     use_system = FALSE;
     use_dual_track = FALSE;
-    if (params->audio_only_mode) {
-        engine->status_callback("Error: Audio-only mode not supported in MVP build");
-        return -1;
-    }
 #endif
     
     int microphone_result = -1;
@@ -95,11 +873,11 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
     // Initialize microphone if needed
     if (use_microphone) {
 #ifdef MUXSW_ENABLE_AUDIO
-        microphone_result = microphone_init(&microphone_ctx);
+        microphone_result = microphone_init(&session->microphone_ctx, (UINT32)params->audio_buffer_ms);
         if (microphone_result == 0) {
-            engine->stats.audio_sample_rate = microphone_ctx.wave_format->nSamplesPerSec;
-            engine->stats.audio_channels = microphone_ctx.wave_format->nChannels;
-            engine->stats.audio_bits_per_sample = microphone_ctx.wave_format->wBitsPerSample;
+            engine->stats.audio_sample_rate = session->microphone_ctx.wave_format->nSamplesPerSec;
+            engine->stats.audio_channels = session->microphone_ctx.wave_format->nChannels;
+            engine->stats.audio_bits_per_sample = session->microphone_ctx.wave_format->wBitsPerSample;
             engine->status_callback("Microphone initialized successfully");
         } else {
             engine->status_callback("Warning: Failed to initialize microphone");
@@ -113,13 +891,13 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
     // Initialize system audio if needed  
     if (use_system) {
 #ifdef MUXSW_ENABLE_AUDIO
-        system_result = system_init(&system_ctx);
+        system_result = system_init(&session->system_ctx, (UINT32)params->audio_buffer_ms);
         if (system_result == 0) {
             // Use system audio format if microphone wasn't initialized
             if (!use_microphone || microphone_result != 0) {
-                engine->stats.audio_sample_rate = system_ctx.wave_format->nSamplesPerSec;
-                engine->stats.audio_channels = system_ctx.wave_format->nChannels;
-                engine->stats.audio_bits_per_sample = system_ctx.wave_format->wBitsPerSample;
+                engine->stats.audio_sample_rate = session->system_ctx.wave_format->nSamplesPerSec;
+                engine->stats.audio_channels = session->system_ctx.wave_format->nChannels;
+                engine->stats.audio_bits_per_sample = session->system_ctx.wave_format->wBitsPerSample;
             }
             engine->status_callback("System audio initialized successfully");
         } else {
@@ -153,31 +931,31 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
         BOOL test_success = FALSE;
         
         if (use_microphone && microphone_result == 0) {
-            if (microphone_start_capture(&microphone_ctx) == 0) {
+            if (microphone_start_capture(&session->microphone_ctx) == 0) {
                 // Test microphone data
                 BYTE* test_data = NULL;
                 UINT32 test_frames = 0;
                 for (int attempt = 0; attempt < 5 && !test_success; attempt++) {
                     Sleep(100);
-                    if (microphone_get_buffer(&microphone_ctx, &test_data, &test_frames) == 0 && test_frames > 0) {
-                        microphone_release_buffer(&microphone_ctx, test_frames);
+                    if (microphone_get_buffer(&session->microphone_ctx, &test_data, &test_frames) == 0 && test_frames > 0) {
+                        microphone_release_buffer(&session->microphone_ctx, test_frames);
                         test_success = TRUE;
                         engine->status_callback("Microphone test successful");
                     }
                 }
-                microphone_stop_capture(&microphone_ctx);
+                microphone_stop_capture(&session->microphone_ctx);
             }
         }
         
         if (use_system && system_result == 0) {
-            if (system_start_capture(&system_ctx) == 0) {
+            if (system_start_capture(&session->system_ctx) == 0) {
                 // Test system audio data (more lenient since audio might not be playing)
                 BYTE* test_data = NULL;
                 UINT32 test_frames = 0;
                 for (int attempt = 0; attempt < 3 && !test_success; attempt++) {
                     Sleep(100);
-                    if (system_get_buffer(&system_ctx, &test_data, &test_frames) == 0 && test_frames > 0) {
-                        system_release_buffer(&system_ctx, test_frames);
+                    if (system_get_buffer(&session->system_ctx, &test_data, &test_frames) == 0 && test_frames > 0) {
+                        system_release_buffer(&session->system_ctx, test_frames);
                         test_success = TRUE;
                         engine->status_callback("System audio test successful");
                     }
@@ -187,7 +965,7 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
                     engine->status_callback("System audio capture ready (no audio currently playing)");
                     test_success = TRUE; // Allow system audio even if silent
                 }
-                system_stop_capture(&system_ctx);
+                system_stop_capture(&session->system_ctx);
             }
         }
         
@@ -201,14 +979,14 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
         engine->status_callback("Audio-only mode: starting audio capture directly");
         
         if (use_microphone && microphone_result == 0) {
-            if (microphone_start_capture(&microphone_ctx) != 0) {
+            if (microphone_start_capture(&session->microphone_ctx) != 0) {
                 engine->status_callback("Error: Failed to start microphone capture for audio-only mode");
                 audio_available = FALSE;
             }
         }
         
         if (use_system && system_result == 0) {
-            if (system_start_capture(&system_ctx) != 0) {
+            if (system_start_capture(&session->system_ctx) != 0) {
                 engine->status_callback("Error: Failed to start system audio capture for audio-only mode");
                 audio_available = FALSE;
             }
@@ -226,28 +1004,72 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
     int channels = engine->stats.audio_enabled ? engine->stats.audio_channels : 0;
     int bits_per_sample = engine->stats.audio_enabled ? engine->stats.audio_bits_per_sample : 0;
     
-    int encoder_result = -1;
-    if (params->audio_only_mode) {
-        if (use_dual_track && audio_available) {
+    memset(&session->encoder_config, 0, sizeof(session->encoder_config));
+    session->encoder_config.video = !params->audio_only_mode;
+    session->encoder_config.width = encode_width;
+    session->encoder_config.height = encode_height;
+    session->encoder_config.fps = params->fps;
+    session->encoder_config.format = session->convert_enabled ? ENCODER_INPUT_NV12 : ENCODER_INPUT_BGRA;
+    session->encoder_config.matrix = params->color_matrix;
+    session->encoder_config.range = params->color_range;
+    session->encoder_config.timing = params->variable_frame_rate ? FRAME_TIMING_VFR : FRAME_TIMING_CFR;
+    session->encoder_config.fragmented = params->fragmented_output;
+    session->encoder_config.audio_streams = !audio_available ? 0 : use_dual_track ? 2 : 1;
+    session->encoder_config.sample_rate = sample_rate;
+    session->encoder_config.channels = channels;
+    session->encoder_config.bits_per_sample = bits_per_sample;
+    
+    // Segmented recordings start in name-001.mp4
+    char first_segment[MAX_PATH];
+    const char* encoder_filename = params->output_filename;
+    if (session->segmenting) {
+        if (segmenter_path(params->output_filename, 1, first_segment, sizeof(first_segment)) != 0) {
+            engine->status_callback("Error: Output filename too long for segment numbers");
+            goto cleanup;
+        }
+        encoder_filename = first_segment;
+    }
+    
+    // Replay mode keeps packets in memory and writes nothing until a save is requested
+    if (params->replay_seconds > 0) {
+        if (engine_start_replay(session, params) != 0) {
+            engine->status_callback("Error: Failed to allocate the replay buffer");
+            goto cleanup;
+        }
+        char replay_msg[192];
+        sprintf(replay_msg, "Replay buffer: keeping the last %d seconds in memory (up to %d MB)",
+                params->replay_seconds, params->replay_budget_mb);
+        engine->status_callback(replay_msg);
+        
+        // Saves are cut to whatever fits, so say up front when a busy screen will not
+        double worst_rate = engine_replay_worst_rate(session, params);
+        double budget = (double)params->replay_budget_mb * 1024 * 1024;
+        if (worst_rate > 0.0 && worst_rate * params->replay_seconds > budget) {
+            sprintf(replay_msg, "Warning: When every frame changes, only %.1f of the %d replay seconds fit; "
+                    "--replay-budget %d keeps them all", budget / worst_rate, params->replay_seconds,
+                    (int)(worst_rate * params->replay_seconds / (1024 * 1024)) + 1);
+            engine->status_callback(replay_msg);
+        }
+    }
+    
+    int encoder_result = engine_open_encoder(session, encoder_filename);
+    if (params->encoder_backend == ENCODER_BACKEND_SPOOL) {
+        if (encoder_result == 0) engine->status_callback("Writing a capture spool (video only)");
+    } else if (params->encoder_backend != ENCODER_BACKEND_MEDIA_FOUNDATION) {
+        char backend_msg[128];
+        sprintf(backend_msg, "Encoder: %s (video only)", encoder_backend_name(&session->encoder_backend));
+        if (encoder_result == 0) engine->status_callback(backend_msg);
+    } else if (params->audio_only_mode) {
+        if (session->encoder_config.audio_streams == 2) {
             // Dual-track audio mode for audio-only recording
-            encoder_result = encoder_init_audio_only_dual_track(&encoder_ctx, params->output_filename, sample_rate, channels, bits_per_sample);
             engine->status_callback("Initialized audio-only dual-track encoder (system + mic as separate tracks)");
         } else {
             // Single-track audio-only recording
-            encoder_result = encoder_init_audio_only(&encoder_ctx, params->output_filename, sample_rate, channels, bits_per_sample);
             engine->status_callback("Initialized audio-only encoder (MP4 output)");
         }
-    } else {
-        if (use_dual_track && audio_available) {
-            // Dual-track mode for video + audio recording
-            encoder_result = encoder_init_dual_track(&encoder_ctx, params->output_filename, screen_ctx.width, screen_ctx.height, 
-                                 params->fps, sample_rate, channels, bits_per_sample);
-            engine->status_callback("Initialized dual-track encoder (video + system audio + microphone)");
-        } else {
-            // Single-track or no audio recording
-            encoder_result = encoder_init(&encoder_ctx, params->output_filename, screen_ctx.width, screen_ctx.height, 
-                                 params->fps, sample_rate, channels, bits_per_sample);
-        }
+    } else if (session->encoder_config.audio_streams == 2) {
+        // Dual-track mode for video + audio recording
+        engine->status_callback("Initialized dual-track encoder (video + system audio + microphone)");
     }
     
     if (encoder_result != 0) {
@@ -255,43 +1077,53 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
         goto cleanup;
     }
     
+    memset(&session->recording, 0, sizeof(session->recording));
+    session->recording.video_enabled = !params->audio_only_mode;
+    session->recording.high_frame_rate = params->fps >= CAPTURE_HIGH_FRAME_RATE;
+    session->recording.microphone_ok = audio_available && use_microphone && microphone_result == 0;
+    session->recording.system_ok = audio_available && use_system && system_result == 0;
+    if (frame_pacer_init(&session->recording.pacer, (uint32_t)params->fps, 1, NULL) != 0 || engine_build_pipeline(session) != 0) {
+        engine->status_callback("Error: Failed to set up the recording pipeline");
+        goto cleanup;
+    }
+    
     // Start screen capture (skip for audio-only mode)
     if (!params->audio_only_mode) {
-        if (screen_start_capture(&screen_ctx) != 0) {
+        if (capture_source_start(&session->capture_source) != 0) {
             engine->status_callback("Error: Failed to start screen capture");
             goto cleanup;
         }
     }
     
-    // Start/restart audio capture to sync with encoder timestamps
-    // This ensures consistent audio handling for both audio-only and video+audio modes
+    // Audio capture threads start with the recording so their samples line up with the encoder clock;
+    // audio-only recordings already started the endpoints and keep them running
     if (audio_available) {
-        // For audio-only mode, audio is already started; for video+audio, restart after test
-        if (!params->audio_only_mode) {
-            // Restart audio capture fresh for recording
-            if (use_microphone && microphone_result == 0) {
-                if (microphone_start_capture(&microphone_ctx) != 0) {
-                    engine->status_callback("Warning: Failed to restart microphone capture");
-                    use_microphone = FALSE;
-                }
-            }
-            
-            if (use_system && system_result == 0) {
-                if (system_start_capture(&system_ctx) != 0) {
-                    engine->status_callback("Warning: Failed to restart system audio capture");
-                    use_system = FALSE;
-                }
-            }
-            
-            // Update audio availability
-            audio_available = (use_microphone && microphone_result == 0) || (use_system && system_result == 0);
-            engine->stats.audio_enabled = audio_available;
+        if (session->recording.microphone_ok && audio_capture_start(&session->microphone_capture) != 0) {
+            engine->status_callback("Warning: Failed to restart microphone capture");
+            session->recording.microphone_ok = FALSE;
         }
+        if (session->recording.system_ok && audio_capture_start(&session->system_capture) != 0) {
+            engine->status_callback("Warning: Failed to restart system audio capture");
+            session->recording.system_ok = FALSE;
+        }
+        
+        // Update audio availability
+        audio_available = session->recording.microphone_ok || session->recording.system_ok;
+        engine->stats.audio_enabled = audio_available;
+    }
+    
+    if (session->segmenting && engine_start_segmenter(session, params, &engine->stats) != 0) {
+        engine->status_callback("Error: Failed to set up segmented output");
+        goto cleanup;
     }
     
-    // Synchronize recording start time
-    DWORD start_time = GetTickCount();
-    encoder_set_recording_start_time(start_time);
+    // Synchronize recording start time; frame times are exact fractions of a second from here
+    encoder_set_recording_start_time(&session->encoder_ctx, GetTickCount());
+    frame_pacer_start(&session->recording.pacer);
+    if (pipeline_start(&session->pipeline) != 0) {
+        engine->status_callback("Error: Failed to start recording threads");
+        goto cleanup;
+    }
     
     engine->is_running = TRUE;
     char status_msg[256];
@@ -299,183 +1131,123 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
             audio_available ? "with audio" : "video only");
     engine->status_callback(status_msg);
     
-    // Main capture loop
-    DWORD frame_interval = 1000 / params->fps;
-    DWORD next_frame_time = start_time;
-    int frame_count = 0;
-    int failed_frame_attempts = 0;
-    int consecutive_audio_failures = 0; // Track audio failures
-    
-    // CRITICAL MEMORY LEAK PROTECTION: Emergency termination counters
-    DWORD emergency_check_interval = 1000; // Check every 1 second
-    DWORD next_emergency_check = start_time + emergency_check_interval;
-    int loop_iterations = 0;
-    const int MAX_LOOP_ITERATIONS_PER_SECOND = 2000; // Safety limit
-    
-    while (engine->is_running && !engine->force_stop && !params->force_stop) {
-        DWORD current_time = GetTickCount();
-        loop_iterations++;
+    // The stage threads record; this thread watches the clock and reports progress
+    BOOL capped = params_is_capped(params);
+    int reported_frames = 0;
+    fps_meter_t fps_meter;
+    fps_meter_init(&fps_meter, params->fps);
+    fps_meter_start(&fps_meter, 0);
+    while (engine->is_running && !platform_atomic_load(&session->stop_requested) && !params->force_stop &&
+           !pipeline_finished(&session->pipeline)) {
+        uint64_t elapsed_ns = frame_pacer_elapsed_ns(&session->recording.pacer);
+        DWORD elapsed_ms = (DWORD)(elapsed_ns / 1000000);
         
-        // EMERGENCY TERMINATION: Prevent runaway processes
-        if (current_time >= next_emergency_check) {
-            if (loop_iterations > MAX_LOOP_ITERATIONS_PER_SECOND) {
-                engine->status_callback("EMERGENCY: Loop frequency too high, terminating to prevent memory leak");
-                break;
-            }
-            
-            // Reset counters for next interval
-            loop_iterations = 0;
-            next_emergency_check = current_time + emergency_check_interval;
-            
-            // Additional safety: terminate if running too long without duration limit
-            if (params->duration == 0 && (current_time - start_time) > (60 * 1000)) {
-                engine->status_callback("EMERGENCY: Unlimited recording running over 60 seconds, auto-terminating");
-                break;
-            }
+        // Additional safety: terminate if running too long without duration limit
+        if (capped && elapsed_ms > (60 * 1000)) {
+            engine->status_callback("EMERGENCY: Unlimited recording running over 60 seconds, auto-terminating");
+            break;
         }
         
         // Check duration limit
-        if (params->duration > 0 && (current_time - start_time) >= (DWORD)(params->duration * 1000)) {
+        if (params->duration > 0 && elapsed_ms >= (DWORD)(params->duration * 1000)) {
             break;
         }
         
-        // Capture frame at specified FPS (skip in audio-only mode)
-        if (!params->audio_only_mode && current_time >= next_frame_time) {
-            void* frame_data = NULL;
-            size_t frame_size = 0;
-            
-            // Use dual-track aware frame capture to fix video flipping issue
-            int frame_result = screen_get_frame_dual_track(&screen_ctx, &frame_data, &frame_size, encoder_ctx.dual_track_mode);
-            if (frame_result == 0 && frame_data) {
-                encoder_add_video_frame(&encoder_ctx, frame_data, frame_size, current_time - start_time);
-                free(frame_data);
-                frame_count++;
-                
-                // Update progress
-                engine->progress_callback(frame_count, current_time - start_time);
-            } else {
-                failed_frame_attempts++;
-            }
-            
-            next_frame_time += frame_interval;
+        // For audio-only mode, a capture thread that gave up on its endpoint ends the recording
+        if (params->audio_only_mode &&
+            !(session->recording.microphone_ok && !audio_capture_failed(&session->microphone_capture)) &&
+            !(session->recording.system_ok && !audio_capture_failed(&session->system_capture))) {
+            engine->status_callback("Error: Too many audio capture failures in audio-only mode, stopping recording");
+            break;
         }
         
-        // Capture audio if enabled (run continuously, not tied to video FPS)
-        if (audio_available) {
-            BOOL audio_success = FALSE;
-            
-            if (use_dual_track && use_microphone && use_system) {
-                // Dual-track mode: capture system and microphone separately
-                BYTE* system_data = NULL;
-                BYTE* mic_data = NULL;
-                UINT32 system_frames = 0;
-                UINT32 mic_frames = 0;
-                
-                // Get system audio buffer
-                if (system_result == 0) {
-                    int sys_result = system_get_buffer(&system_ctx, &system_data, &system_frames);
-                    if (sys_result == 0 && system_frames > 0) {
-                        encoder_add_system_audio_frame(&encoder_ctx, system_data, system_frames, current_time - start_time);
-                        system_release_buffer(&system_ctx, system_frames);
-                        audio_success = TRUE;
-                    }
-                }
-                
-                // Get microphone buffer  
-                if (microphone_result == 0) {
-                    int mic_result = microphone_get_buffer(&microphone_ctx, &mic_data, &mic_frames);
-                    if (mic_result == 0 && mic_frames > 0) {
-                        encoder_add_mic_audio_frame(&encoder_ctx, mic_data, mic_frames, current_time - start_time);
-                        microphone_release_buffer(&microphone_ctx, mic_frames);
-                        audio_success = TRUE;
-                    }
-                }
-            } else {
-                // Single audio source mode
-                if (use_microphone && microphone_result == 0) {
-                    BYTE* audio_data = NULL;
-                    UINT32 num_frames = 0;
-                    int mic_result = microphone_get_buffer(&microphone_ctx, &audio_data, &num_frames);
-                    if (mic_result == 0 && num_frames > 0) {
-                        encoder_add_audio_frame(&encoder_ctx, audio_data, num_frames, current_time - start_time);
-                        microphone_release_buffer(&microphone_ctx, num_frames);
-                        audio_success = TRUE;
-                    }
-                }
-                
-                if (use_system && system_result == 0) {
-                    BYTE* audio_data = NULL;
-                    UINT32 num_frames = 0;
-                    int sys_result = system_get_buffer(&system_ctx, &audio_data, &num_frames);
-                    if (sys_result == 0 && num_frames > 0) {
-                        encoder_add_audio_frame(&encoder_ctx, audio_data, num_frames, current_time - start_time);
-                        system_release_buffer(&system_ctx, num_frames);
-                        audio_success = TRUE;
-                    }
-                }
-            }
-            
-            // Track audio failures for audio-only mode
-            if (audio_success) {
-                consecutive_audio_failures = 0;
-            } else {
-                consecutive_audio_failures++;
-                
-                // For audio-only mode, if we have too many consecutive failures, abort
-                if (params->audio_only_mode && consecutive_audio_failures > 1000) {
-                    engine->status_callback("Error: Too many audio capture failures in audio-only mode, stopping recording");
-                    break;
-                }
-            }
+        // Update progress
+        int mux_frames = (int)platform_atomic_load(&session->recording.frame_count);
+        while (reported_frames < mux_frames) {
+            reported_frames++;
+            engine->progress_callback(reported_frames, elapsed_ms);
         }
         
-        // Sleep management: prevent memory leak by controlling loop frequency
-        DWORD time_until_next_frame = (next_frame_time > current_time) ? (next_frame_time - current_time) : 0;
-        if (audio_available) {
-            // CRITICAL FIX: Balanced sleep for audio capture with time-based silent generation
-            // Audio modules now handle timing internally, so we can use moderate polling frequency
-            Sleep(5);  // Balanced sleep for audio capture - works with time-based silent generation
-        } else {
-            // When no audio, use normal sleep to reduce CPU usage
-            if (time_until_next_frame > 5) {
-                Sleep(5);  // Standard sleep when no audio
-            } else if (time_until_next_frame > 1) {
-                Sleep(time_until_next_frame - 1);
-            } else {
-                Sleep(3);  // Increased minimum sleep to 3ms
-            }
+        // Achieved against requested rate, every second at high frame rates
+        if (fps_meter_update(&fps_meter, elapsed_ns, (uint64_t)mux_frames) && session->recording.high_frame_rate) {
+            sprintf(status_msg, "Frame rate: %.1f / %d fps", fps_meter.last_fps, params->fps);
+            engine->status_callback(status_msg);
         }
+        
+        Sleep(10);
     }
     
+    engine->status_callback("Stopping capture...");
+    
+    // Sources stop first; frames and audio already queued still reach the encoder
+    audio_capture_stop(&session->system_capture);
+    audio_capture_stop(&session->microphone_capture);
+    pipeline_stop(&session->pipeline);
+    
     // Update final statistics
+    int frame_count = (int)platform_atomic_load(&session->recording.frame_count);
     engine->stats.total_frames = frame_count;
-    engine->stats.failed_frames = failed_frame_attempts;
-    engine->stats.recording_duration_ms = GetTickCount() - start_time;
-    
-    engine->status_callback("Stopping capture...");
+    engine->stats.failed_frames = session->recording.failed_frame_attempts + session->recording.dropped_frames + session->recording.failed_transforms;
+    engine->stats.recording_duration_ms = (DWORD)(frame_pacer_elapsed_ns(&session->recording.pacer) / 1000000);
     
-    // Stop captures
+    // Stop captures; the audio endpoints stopped with their threads
     if (!params->audio_only_mode) {
-        screen_stop_capture(&screen_ctx);
+        capture_source_stop(&session->capture_source);
     }
-    if (audio_available) {
-        if (use_microphone && microphone_result == 0) {
-            microphone_stop_capture(&microphone_ctx);
+    
+    engine->status_callback("Finalizing recording...");
+    if (session->segmenting && session->segmenter_started) {
+        // Frames and audio held at the last boundary go to the open segment; closed ones finish first
+        if (segmenter_finish(&session->segmenter) != 0) {
+            engine->status_callback("Warning: A segment failed to write or finalize");
         }
-        if (use_system && system_result == 0) {
-            system_stop_capture(&system_ctx);
+    }
+    if (encoder_backend_finalize(&session->encoder_backend) != 0) {
+        engine->status_callback("Warning: The encoder failed to finalize the output");
+    }
+    
+    if (!params->audio_only_mode) {
+        frame_pool_stats_t pool_stats;
+        frame_pool_get_stats(&session->frame_pool, &pool_stats);
+        sprintf(status_msg, "Frame pool: %d/%d frames high-water, %llu exhausted",
+                pool_stats.high_water, pool_stats.capacity, (unsigned long long)pool_stats.exhausted);
+        engine->status_callback(status_msg);
+        
+        capture_source_report(&session->capture_source, engine->status_callback);
+        
+        if (session->change_detect_enabled) {
+            sprintf(status_msg, "Change detection: %llu of %llu reported frames unchanged",
+                    (unsigned long long)session->change_detector.unchanged_frames, (unsigned long long)session->change_detector.frames);
+            engine->status_callback(status_msg);
         }
     }
     
-    engine->status_callback("Finalizing recording...");
-    encoder_finalize(&encoder_ctx);
+    pipeline_report(&session->pipeline, engine->status_callback);
+    frame_pacer_report(&session->recording.pacer, engine->status_callback);
+    if (session->recording.video_enabled) {
+        fps_meter_report(&fps_meter, (uint64_t)engine->stats.recording_duration_ms * 1000000, engine->status_callback);
+    }
+    audio_capture_report(&session->system_capture, engine->status_callback);
+    audio_capture_report(&session->microphone_capture, engine->status_callback);
+    if (session->recording.dropped_frames > 0) {
+        sprintf(status_msg, "Pipeline: %d frames dropped at capture", session->recording.dropped_frames);
+        engine->status_callback(status_msg);
+    }
+    if (session->segmenter_started) {
+        segmenter_report(&session->segmenter, engine->status_callback);
+    }
+    encoder_backend_report(&session->encoder_backend, engine->status_callback);
+    engine_cleanup_replay(session, engine->status_callback);
+    engine_cleanup_pipeline(session);
+    engine_cleanup_segmenter(session);
+    encoder_backend_destroy(&session->encoder_backend);
     
     if (params->audio_only_mode) {
         sprintf(status_msg, "Audio recording completed: %lu ms", 
-                GetTickCount() - start_time);
+                (unsigned long)engine->stats.recording_duration_ms);
     } else {
         sprintf(status_msg, "Recording completed: %d frames, %lu ms", 
-                frame_count, GetTickCount() - start_time);
+                frame_count, (unsigned long)engine->stats.recording_duration_ms);
     }
     engine->status_callback(status_msg);
     
@@ -484,24 +1256,31 @@ int engine_start(capture_engine_t* engine, const capture_params_t* params) {
     
 cleanup:
     engine->is_running = FALSE;
+    engine_cleanup_pipeline(session);
+    engine_cleanup_segmenter(session);
+    engine_cleanup_replay(session, NULL);
     
     // CRITICAL MEMORY LEAK FIX: Ensure all resources are properly cleaned up
     if (!params->audio_only_mode) {
-        screen_stop_capture(&screen_ctx);
-        screen_cleanup(&screen_ctx);
+        capture_source_stop(&session->capture_source);
+        capture_source_destroy(&session->capture_source);
     }
     
     if (use_microphone && microphone_result == 0) {
-        microphone_stop_capture(&microphone_ctx);
-        microphone_cleanup(&microphone_ctx);
+        microphone_stop_capture(&session->microphone_ctx);
+        microphone_cleanup(&session->microphone_ctx);
     }
     
     if (use_system && system_result == 0) {
-        system_stop_capture(&system_ctx);
-        system_cleanup(&system_ctx);
+        system_stop_capture(&session->system_ctx);
+        system_cleanup(&session->system_ctx);
     }
     
-    encoder_cleanup(&encoder_ctx);
+    encoder_backend_destroy(&session->encoder_backend);
+    
+    // Pools go last: the screen cache and MF samples hold frame references
+    engine_cleanup_transform(session);
+    frame_pool_cleanup(&session->frame_pool);
     
     // Force garbage collection
     Sleep(100);
@@ -512,7 +1291,9 @@ cleanup:
 int engine_stop(capture_engine_t* engine) {
     if (!engine || !engine->is_running) return -1;
     
+    // The recording thread polls the flag; force_stop stays for callers that read it
     engine->force_stop = TRUE;
+    if (engine->session) platform_atomic_store(&engine->session->stop_requested, 1);
     engine->status_callback("Stopping and encoding, please wait...");
     
     // CRITICAL: More aggressive termination - shorter timeout
@@ -529,6 +1310,30 @@ int engine_stop(capture_engine_t* engine) {
     return 0;
 }
 
+int engine_save_replay(capture_engine_t* engine, char* path, size_t path_size) {
+    if (!engine || !engine->session) return -1;
+    engine_session_t* session = engine->session;
+    
+    // Numbered after the output name: capture.mp4 -> capture-replay-001.mp4
+    char save_path[MAX_PATH];
+    int result = -1;
+    platform_mutex_lock(&session->replay_lock);
+    if (session->replaying &&
+        replay_buffer_path(engine->params.output_filename, session->replay_saves + 1, save_path, sizeof(save_path)) == 0 &&
+        replay_buffer_request_save(&session->replay, save_path) == 0) {
+        session->replay_saves++;
+        result = 0;
+    }
+    platform_mutex_unlock(&session->replay_lock);
+    
+    if (result == 0 && path && path_size > 0) snprintf(path, path_size, "%s", save_path);
+    return result;
+}
+
+BOOL engine_is_replaying(const capture_engine_t* engine) {
+    return engine && engine->session && engine->is_running && engine->params.replay_seconds > 0;
+}
+
 void engine_cleanup(capture_engine_t* engine) {
     if (!engine) return;
     
@@ -536,18 +1341,26 @@ void engine_cleanup(capture_engine_t* engine) {
         engine_stop(engine);
     }
     
+    engine_session_t* session = engine->session;
+    if (!session) {
+        memset(engine, 0, sizeof(capture_engine_t));
+        return;
+    }
+    
     // Cleanup contexts (these functions already check for NULL/invalid contexts)
     // The individual cleanup functions are designed to be idempotent
-    screen_cleanup(&screen_ctx);
-    microphone_cleanup(&microphone_ctx);
-    system_cleanup(&system_ctx);
-    encoder_cleanup(&encoder_ctx);
-    
-    // CRITICAL: Reset static contexts to prevent any carryover state
-    memset(&screen_ctx, 0, sizeof(screen_ctx));
-    memset(&microphone_ctx, 0, sizeof(microphone_ctx));
-    memset(&system_ctx, 0, sizeof(system_ctx));
-    memset(&encoder_ctx, 0, sizeof(encoder_ctx));
+    capture_source_destroy(&session->capture_source);
+    microphone_cleanup(&session->microphone_ctx);
+    system_cleanup(&session->system_ctx);
+    engine_cleanup_pipeline(session);
+    engine_cleanup_segmenter(session);
+    engine_cleanup_replay(session, NULL);
+    encoder_backend_destroy(&session->encoder_backend);
+    engine_cleanup_transform(session);
+    frame_pool_cleanup(&session->frame_pool);
+    platform_mutex_destroy(&session->replay_lock);
     
+    // The session goes with the engine, so nothing carries over to the next one
+    free(session);
     memset(engine, 0, sizeof(capture_engine_t));
 }
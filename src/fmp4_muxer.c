@@ -0,0 +1,698 @@
+#include "fmp4_muxer.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// trun/trex sample_flags: depends on others and not a sync sample, or
+// depends on nothing (keyframes, AAC frames)
+#define FMP4_FLAGS_NON_SYNC 0x01010000u
+#define FMP4_FLAGS_SYNC 0x02000000u
+
+#define FMP4_TFHD_DEFAULT_BASE_IS_MOOF 0x020000u
+#define FMP4_TRUN_DATA_OFFSET 0x000001u
+#define FMP4_TRUN_DURATION 0x000100u
+#define FMP4_TRUN_SIZE 0x000200u
+#define FMP4_TRUN_FLAGS 0x000400u
+
+static const uint32_t fmp4_unity_matrix[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+
+static int fmp4_file_write(void* context, const uint8_t* data, size_t size) {
+    return fwrite(data, 1, size, (FILE*)context) == size ? 0 : -1;
+}
+
+static uint64_t fmp4_video_time(int64_t time) {
+    // 100 ns units to 90 kHz, rounded so 1/30 s frames land on whole ticks
+    return time > 0 ? ((uint64_t)time * 9 + 500) / 1000 : 0;
+}
+
+static int fmp4_output(fmp4_muxer_t* muxer, const uint8_t* data, size_t size) {
+    if (size == 0) return 0;
+    if (muxer->write(muxer->context, data, size) != 0) {
+        fprintf(stderr, "MP4: Write failed\n");
+        muxer->failed = 1;
+        return -1;
+    }
+    muxer->stats.bytes_written += size;
+    return 0;
+}
+
+size_t fmp4_muxer_buffered_bytes(const fmp4_muxer_t* muxer) {
+    if (!muxer) return 0;
+    return muxer->tracks[FMP4_TRACK_VIDEO].data.size + muxer->tracks[FMP4_TRACK_AUDIO].data.size +
+           (muxer->has_pending ? muxer->pending.size : 0);
+}
+
+int fmp4_muxer_init(fmp4_muxer_t* muxer, const fmp4_config_t* config, fmp4_write_fn write, void* context) {
+    if (!muxer) return -1;
+    memset(muxer, 0, sizeof(fmp4_muxer_t));
+    if (!config || !write || (!config->video && !config->audio)) return -1;
+
+    muxer->config = *config;
+    if (muxer->config.fragment_ms == 0) muxer->config.fragment_ms = FMP4_DEFAULT_FRAGMENT_MS;
+    if (muxer->config.max_buffered_bytes == 0) muxer->config.max_buffered_bytes = FMP4_DEFAULT_MAX_BUFFERED;
+    if (muxer->config.frame_duration == 0) muxer->config.frame_duration = 10000000 / 30;
+    muxer->write = write;
+    muxer->context = context;
+    muxer->sequence = 1;
+    muxer->last_duration = (uint32_t)fmp4_video_time(muxer->config.frame_duration);
+
+    if (config->audio && config->audio_sample_rate) {
+        if (aac_audio_specific_config(AAC_OBJECT_TYPE_LC, config->audio_sample_rate, config->audio_channels,
+                                      muxer->audio_config) != 0) {
+            fprintf(stderr, "MP4: Unsupported AAC format %u Hz, %d channels\n",
+                    config->audio_sample_rate, config->audio_channels);
+            return -1;
+        }
+        muxer->audio_ready = 1;
+    }
+
+    mp4_buffer_init(&muxer->boxes);
+    mp4_buffer_init(&muxer->pending);
+    for (int i = 0; i < FMP4_TRACK_COUNT; i++) {
+        fmp4_track_t* track = &muxer->tracks[i];
+        track->track_id = (uint32_t)i + 1;
+        track->timescale = i == FMP4_TRACK_VIDEO ? FMP4_VIDEO_TIMESCALE : config->audio_sample_rate;
+        mp4_buffer_init(&track->data);
+        track->samples = (fmp4_sample_t*)malloc(FMP4_MAX_FRAGMENT_SAMPLES * sizeof(fmp4_sample_t));
+        if (!track->samples) {
+            fmp4_muxer_cleanup(muxer);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int fmp4_muxer_open(fmp4_muxer_t* muxer, const fmp4_config_t* config, const char* path) {
+    if (!muxer || !path) return -1;
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "MP4: Failed to create %s\n", path);
+        return -1;
+    }
+    if (fmp4_muxer_init(muxer, config, fmp4_file_write, file) != 0) {
+        fclose(file);
+        return -1;
+    }
+    muxer->file = file;
+    return 0;
+}
+
+void fmp4_muxer_cleanup(fmp4_muxer_t* muxer) {
+    if (!muxer) return;
+    if (muxer->file) fclose(muxer->file);
+    mp4_buffer_free(&muxer->boxes);
+    mp4_buffer_free(&muxer->pending);
+    for (int i = 0; i < FMP4_TRACK_COUNT; i++) {
+        mp4_buffer_free(&muxer->tracks[i].data);
+        free(muxer->tracks[i].samples);
+    }
+    memset(muxer, 0, sizeof(fmp4_muxer_t));
+}
+
+// ---------------------------------------------------------------------------
+// Header: ftyp and moov
+// ---------------------------------------------------------------------------
+
+static void fmp4_put_matrix(mp4_buffer_t* out) {
+    for (int i = 0; i < 9; i++) mp4_put_u32(out, fmp4_unity_matrix[i]);
+}
+
+static void fmp4_put_avc1(fmp4_muxer_t* muxer, mp4_buffer_t* out) {
+    const h264_sps_info_t* info = &muxer->sps_info;
+    size_t avc1 = mp4_box_begin(out, MP4_FOURCC('a', 'v', 'c', '1'));
+    mp4_put_zeros(out, 6);
+    mp4_put_u16(out, 1);                                    // data_reference_index
+    mp4_put_zeros(out, 16);
+    mp4_put_u16(out, (uint16_t)info->width);
+    mp4_put_u16(out, (uint16_t)info->height);
+    mp4_put_u32(out, 0x00480000);                           // 72 dpi
+    mp4_put_u32(out, 0x00480000);
+    mp4_put_u32(out, 0);
+    mp4_put_u16(out, 1);                                    // frame_count
+    mp4_put_zeros(out, 32);                                 // compressorname
+    mp4_put_u16(out, 0x0018);                               // depth
+    mp4_put_u16(out, 0xFFFF);
+
+    size_t avcc = mp4_box_begin(out, MP4_FOURCC('a', 'v', 'c', 'C'));
+    mp4_put_u8(out, 1);
+    mp4_put_u8(out, muxer->sps[1]);
+    mp4_put_u8(out, muxer->sps[2]);
+    mp4_put_u8(out, muxer->sps[3]);
+    mp4_put_u8(out, 0xFF);                                  // 4-byte NAL lengths
+    mp4_put_u8(out, 0xE1);                                  // One SPS
+    mp4_put_u16(out, (uint16_t)muxer->sps_size);
+    mp4_put_bytes(out, muxer->sps, muxer->sps_size);
+    mp4_put_u8(out, 1);                                     // One PPS
+    mp4_put_u16(out, (uint16_t)muxer->pps_size);
+    mp4_put_bytes(out, muxer->pps, muxer->pps_size);
+    if (info->profile_idc == 100 || info->profile_idc == 110 || info->profile_idc == 122 || info->profile_idc == 144) {
+        mp4_put_u8(out, (uint8_t)(0xFC | info->chroma_format_idc));
+        mp4_put_u8(out, (uint8_t)(0xF8 | (info->bit_depth_luma - 8)));
+        mp4_put_u8(out, (uint8_t)(0xF8 | (info->bit_depth_chroma - 8)));
+        mp4_put_u8(out, 0);                                 // No SPS extensions
+    }
+    mp4_box_end(out, avcc);
+    mp4_box_end(out, avc1);
+}
+
+static void fmp4_put_mp4a(fmp4_muxer_t* muxer, mp4_buffer_t* out) {
+    uint32_t rate = muxer->config.audio_sample_rate;
+    size_t mp4a = mp4_box_begin(out, MP4_FOURCC('m', 'p', '4', 'a'));
+    mp4_put_zeros(out, 6);
+    mp4_put_u16(out, 1);                                    // data_reference_index
+    mp4_put_zeros(out, 8);
+    mp4_put_u16(out, (uint16_t)muxer->config.audio_channels);
+    mp4_put_u16(out, 16);                                   // samplesize
+    mp4_put_zeros(out, 4);
+    mp4_put_u32(out, rate <= 0xFFFF ? rate << 16 : 0);
+
+    // ES_Descriptor > DecoderConfigDescriptor > DecoderSpecificInfo, SLConfigDescriptor
+    size_t esds = mp4_full_box_begin(out, MP4_FOURCC('e', 's', 'd', 's'), 0, 0);
+    mp4_put_u8(out, 0x03);
+    mp4_put_u8(out, 25);
+    mp4_put_u16(out, (uint16_t)muxer->tracks[FMP4_TRACK_AUDIO].track_id);
+    mp4_put_u8(out, 0);
+    mp4_put_u8(out, 0x04);
+    mp4_put_u8(out, 17);
+    mp4_put_u8(out, 0x40);                                  // MPEG-4 audio
+    mp4_put_u8(out, 0x15);                                  // Audio stream
+    mp4_put_u24(out, 0);                                    // bufferSizeDB
+    mp4_put_u32(out, 0);                                    // maxBitrate
+    mp4_put_u32(out, 0);                                    // avgBitrate
+    mp4_put_u8(out, 0x05);
+    mp4_put_u8(out, 2);
+    mp4_put_bytes(out, muxer->audio_config, 2);
+    mp4_put_u8(out, 0x06);
+    mp4_put_u8(out, 1);
+    mp4_put_u8(out, 0x02);
+    mp4_box_end(out, esds);
+    mp4_box_end(out, mp4a);
+}
+
+static void fmp4_put_trak(fmp4_muxer_t* muxer, mp4_buffer_t* out, int index) {
+    fmp4_track_t* track = &muxer->tracks[index];
+    int video = index == FMP4_TRACK_VIDEO;
+
+    size_t trak = mp4_box_begin(out, MP4_FOURCC('t', 'r', 'a', 'k'));
+    size_t tkhd = mp4_full_box_begin(out, MP4_FOURCC('t', 'k', 'h', 'd'), 0, 3);   // Enabled, in movie
+    mp4_put_u32(out, 0);                                    // creation_time
+    mp4_put_u32(out, 0);                                    // modification_time
+    mp4_put_u32(out, track->track_id);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, 0);                                    // duration: in the fragments
+    mp4_put_zeros(out, 8);
+    mp4_put_u16(out, 0);                                    // layer
+    mp4_put_u16(out, 0);                                    // alternate_group
+    mp4_put_u16(out, video ? 0 : 0x0100);                   // volume
+    mp4_put_u16(out, 0);
+    fmp4_put_matrix(out);
+    mp4_put_u32(out, video ? (uint32_t)muxer->sps_info.width << 16 : 0);
+    mp4_put_u32(out, video ? (uint32_t)muxer->sps_info.height << 16 : 0);
+    mp4_box_end(out, tkhd);
+
+    size_t mdia = mp4_box_begin(out, MP4_FOURCC('m', 'd', 'i', 'a'));
+    size_t mdhd = mp4_full_box_begin(out, MP4_FOURCC('m', 'd', 'h', 'd'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, track->timescale);
+    mp4_put_u32(out, 0);
+    mp4_put_u16(out, 0x55C4);                               // "und"
+    mp4_put_u16(out, 0);
+    mp4_box_end(out, mdhd);
+
+    const char* name = video ? "VideoHandler" : "SoundHandler";
+    size_t hdlr = mp4_full_box_begin(out, MP4_FOURCC('h', 'd', 'l', 'r'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, video ? MP4_FOURCC('v', 'i', 'd', 'e') : MP4_FOURCC('s', 'o', 'u', 'n'));
+    mp4_put_zeros(out, 12);
+    mp4_put_bytes(out, name, strlen(name) + 1);
+    mp4_box_end(out, hdlr);
+
+    size_t minf = mp4_box_begin(out, MP4_FOURCC('m', 'i', 'n', 'f'));
+    if (video) {
+        size_t vmhd = mp4_full_box_begin(out, MP4_FOURCC('v', 'm', 'h', 'd'), 0, 1);
+        mp4_put_zeros(out, 8);
+        mp4_box_end(out, vmhd);
+    } else {
+        size_t smhd = mp4_full_box_begin(out, MP4_FOURCC('s', 'm', 'h', 'd'), 0, 0);
+        mp4_put_zeros(out, 4);
+        mp4_box_end(out, smhd);
+    }
+    size_t dinf = mp4_box_begin(out, MP4_FOURCC('d', 'i', 'n', 'f'));
+    size_t dref = mp4_full_box_begin(out, MP4_FOURCC('d', 'r', 'e', 'f'), 0, 0);
+    mp4_put_u32(out, 1);
+    mp4_box_end(out, mp4_full_box_begin(out, MP4_FOURCC('u', 'r', 'l', ' '), 0, 1));   // Media in this file
+    mp4_box_end(out, dref);
+    mp4_box_end(out, dinf);
+
+    // Sample tables stay empty; the samples are described by the fragments
+    size_t stbl = mp4_box_begin(out, MP4_FOURCC('s', 't', 'b', 'l'));
+    size_t stsd = mp4_full_box_begin(out, MP4_FOURCC('s', 't', 's', 'd'), 0, 0);
+    mp4_put_u32(out, 1);
+    if (video) {
+        fmp4_put_avc1(muxer, out);
+    } else {
+        fmp4_put_mp4a(muxer, out);
+    }
+    mp4_box_end(out, stsd);
+    size_t stts = mp4_full_box_begin(out, MP4_FOURCC('s', 't', 't', 's'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_box_end(out, stts);
+    size_t stsc = mp4_full_box_begin(out, MP4_FOURCC('s', 't', 's', 'c'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_box_end(out, stsc);
+    size_t stsz = mp4_full_box_begin(out, MP4_FOURCC('s', 't', 's', 'z'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, 0);
+    mp4_box_end(out, stsz);
+    size_t stco = mp4_full_box_begin(out, MP4_FOURCC('s', 't', 'c', 'o'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_box_end(out, stco);
+    mp4_box_end(out, stbl);
+
+    mp4_box_end(out, minf);
+    mp4_box_end(out, mdia);
+    mp4_box_end(out, trak);
+}
+
+// Both tracks' formats known: SPS/PPS from the first keyframe, AAC config
+static int fmp4_header_ready(const fmp4_muxer_t* muxer) {
+    if (muxer->config.video && !muxer->keyframe_seen) return 0;
+    if (muxer->config.audio && !muxer->audio_ready) return 0;
+    return 1;
+}
+
+static int fmp4_write_header(fmp4_muxer_t* muxer) {
+    mp4_buffer_t* out = &muxer->boxes;
+    mp4_buffer_reset(out);
+
+    size_t ftyp = mp4_box_begin(out, MP4_FOURCC('f', 't', 'y', 'p'));
+    mp4_put_u32(out, MP4_FOURCC('i', 's', 'o', 'm'));
+    mp4_put_u32(out, 0x200);
+    mp4_put_u32(out, MP4_FOURCC('i', 's', 'o', 'm'));
+    mp4_put_u32(out, MP4_FOURCC('i', 's', 'o', '6'));
+    mp4_put_u32(out, MP4_FOURCC('i', 's', 'o', '2'));
+    mp4_put_u32(out, MP4_FOURCC('a', 'v', 'c', '1'));
+    mp4_put_u32(out, MP4_FOURCC('m', 'p', '4', '1'));
+    mp4_box_end(out, ftyp);
+
+    size_t moov = mp4_box_begin(out, MP4_FOURCC('m', 'o', 'o', 'v'));
+    size_t mvhd = mp4_full_box_begin(out, MP4_FOURCC('m', 'v', 'h', 'd'), 0, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, 0);
+    mp4_put_u32(out, 1000);                                 // timescale
+    mp4_put_u32(out, 0);                                    // duration: in the fragments
+    mp4_put_u32(out, 0x00010000);                           // rate 1.0
+    mp4_put_u16(out, 0x0100);                               // volume 1.0
+    mp4_put_zeros(out, 10);
+    fmp4_put_matrix(out);
+    mp4_put_zeros(out, 24);
+    mp4_put_u32(out, FMP4_TRACK_COUNT + 1);                 // next_track_ID
+    mp4_box_end(out, mvhd);
+
+    if (muxer->config.video) fmp4_put_trak(muxer, out, FMP4_TRACK_VIDEO);
+    if (muxer->config.audio) fmp4_put_trak(muxer, out, FMP4_TRACK_AUDIO);
+
+    size_t mvex = mp4_box_begin(out, MP4_FOURCC('m', 'v', 'e', 'x'));
+    for (int i = 0; i < FMP4_TRACK_COUNT; i++) {
+        if ((i == FMP4_TRACK_VIDEO && !muxer->config.video) || (i == FMP4_TRACK_AUDIO && !muxer->config.audio)) continue;
+        size_t trex = mp4_full_box_begin(out, MP4_FOURCC('t', 'r', 'e', 'x'), 0, 0);
+        mp4_put_u32(out, muxer->tracks[i].track_id);
+        mp4_put_u32(out, 1);                                // default_sample_description_index
+        mp4_put_u32(out, 0);                                // default_sample_duration
+        mp4_put_u32(out, 0);                                // default_sample_size
+        mp4_put_u32(out, i == FMP4_TRACK_VIDEO ? FMP4_FLAGS_NON_SYNC : FMP4_FLAGS_SYNC);
+        mp4_box_end(out, trex);
+    }
+    mp4_box_end(out, mvex);
+    mp4_box_end(out, moov);
+
+    if (out->failed) {
+        muxer->failed = 1;
+        return -1;
+    }
+    if (fmp4_output(muxer, out->data, out->size) != 0) return -1;
+    muxer->header_written = 1;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Fragments: moof and mdat
+// ---------------------------------------------------------------------------
+
+static void fmp4_reset_fragment(fmp4_track_t* track) {
+    mp4_buffer_reset(&track->data);
+    track->sample_count = 0;
+    track->fragment_start = track->next_time;
+}
+
+static void fmp4_note_buffered(fmp4_muxer_t* muxer) {
+    size_t buffered = fmp4_muxer_buffered_bytes(muxer);
+    if (buffered > muxer->stats.peak_buffered) muxer->stats.peak_buffered = buffered;
+}
+
+int fmp4_muxer_flush(fmp4_muxer_t* muxer) {
+    if (!muxer || !muxer->write || muxer->failed) return -1;
+    fmp4_track_t* tracks = muxer->tracks;
+    if (tracks[FMP4_TRACK_VIDEO].sample_count == 0 && tracks[FMP4_TRACK_AUDIO].sample_count == 0) return 0;
+
+    if (!muxer->header_written) {
+        if (muxer->keyframe_seen && muxer->config.audio && !muxer->audio_ready) {
+            // Video is waiting on an audio format that never came; it cannot wait longer than a fragment
+            fprintf(stderr, "MP4: No audio by the first fragment; writing video only\n");
+            muxer->config.audio = 0;
+            muxer->audio_abandoned = 1;
+        }
+        if (!fmp4_header_ready(muxer)) {
+            // Only audio can be waiting on the first keyframe; keep its timeline, drop the oldest
+            if (fmp4_muxer_buffered_bytes(muxer) >= muxer->config.max_buffered_bytes ||
+                tracks[FMP4_TRACK_AUDIO].sample_count >= FMP4_MAX_FRAGMENT_SAMPLES) {
+                muxer->stats.dropped_audio += tracks[FMP4_TRACK_AUDIO].sample_count;
+                fmp4_reset_fragment(&tracks[FMP4_TRACK_AUDIO]);
+            }
+            return 0;
+        }
+        if (fmp4_write_header(muxer) != 0) return -1;
+    }
+
+    mp4_buffer_t* out = &muxer->boxes;
+    mp4_buffer_reset(out);
+    size_t data_offset_at[FMP4_TRACK_COUNT] = { 0, 0 };
+
+    size_t moof = mp4_box_begin(out, MP4_FOURCC('m', 'o', 'o', 'f'));
+    size_t mfhd = mp4_full_box_begin(out, MP4_FOURCC('m', 'f', 'h', 'd'), 0, 0);
+    mp4_put_u32(out, muxer->sequence);
+    mp4_box_end(out, mfhd);
+    for (int i = 0; i < FMP4_TRACK_COUNT; i++) {
+        fmp4_track_t* track = &tracks[i];
+        if (track->sample_count == 0) continue;
+        int video = i == FMP4_TRACK_VIDEO;
+
+        size_t traf = mp4_box_begin(out, MP4_FOURCC('t', 'r', 'a', 'f'));
+        size_t tfhd = mp4_full_box_begin(out, MP4_FOURCC('t', 'f', 'h', 'd'), 0, FMP4_TFHD_DEFAULT_BASE_IS_MOOF);
+        mp4_put_u32(out, track->track_id);
+        mp4_box_end(out, tfhd);
+        size_t tfdt = mp4_full_box_begin(out, MP4_FOURCC('t', 'f', 'd', 't'), 1, 0);
+        mp4_put_u64(out, track->fragment_start);
+        mp4_box_end(out, tfdt);
+
+        uint32_t trun_flags = FMP4_TRUN_DATA_OFFSET | FMP4_TRUN_DURATION | FMP4_TRUN_SIZE;
+        if (video) trun_flags |= FMP4_TRUN_FLAGS;
+        size_t trun = mp4_full_box_begin(out, MP4_FOURCC('t', 'r', 'u', 'n'), 0, trun_flags);
+        mp4_put_u32(out, track->sample_count);
+        data_offset_at[i] = out->size;
+        mp4_put_u32(out, 0);                                // data_offset, patched below
+        for (uint32_t s = 0; s < track->sample_count; s++) {
+            mp4_put_u32(out, track->samples[s].duration);
+            mp4_put_u32(out, track->samples[s].size);
+            if (video) mp4_put_u32(out, track->samples[s].flags);
+        }
+        mp4_box_end(out, trun);
+        mp4_box_end(out, traf);
+    }
+    mp4_box_end(out, moof);
+
+    // Sample data follows the mdat header, video first; offsets are from the moof
+    size_t data_size = tracks[FMP4_TRACK_VIDEO].data.size + tracks[FMP4_TRACK_AUDIO].data.size;
+    size_t offset = out->size + MP4_BOX_HEADER_SIZE;
+    for (int i = 0; i < FMP4_TRACK_COUNT; i++) {
+        if (tracks[i].sample_count == 0) continue;
+        mp4_patch_u32(out, data_offset_at[i], (uint32_t)offset);
+        offset += tracks[i].data.size;
+    }
+    mp4_put_u32(out, (uint32_t)(MP4_BOX_HEADER_SIZE + data_size));
+    mp4_put_u32(out, MP4_FOURCC('m', 'd', 'a', 't'));
+
+    if (out->failed) {
+        muxer->failed = 1;
+        return -1;
+    }
+    if (fmp4_output(muxer, out->data, out->size) != 0 ||
+        fmp4_output(muxer, tracks[FMP4_TRACK_VIDEO].data.data, tracks[FMP4_TRACK_VIDEO].data.size) != 0 ||
+        fmp4_output(muxer, tracks[FMP4_TRACK_AUDIO].data.data, tracks[FMP4_TRACK_AUDIO].data.size) != 0) {
+        return -1;
+    }
+    if (muxer->file) {
+        int synced = muxer->config.durable ? platform_file_sync(muxer->file) : fflush(muxer->file);
+        if (synced != 0) {
+            fprintf(stderr, "MP4: Failed to flush fragment %u to disk\n", muxer->sequence);
+            muxer->failed = 1;
+            return -1;
+        }
+    }
+
+    fmp4_reset_fragment(&tracks[FMP4_TRACK_VIDEO]);
+    fmp4_reset_fragment(&tracks[FMP4_TRACK_AUDIO]);
+    muxer->sequence++;
+    muxer->stats.fragments++;
+    return 0;
+}
+
+// Append a sample to a track's open fragment
+static int fmp4_append_sample(fmp4_muxer_t* muxer, int index, const uint8_t* data, size_t size,
+                              uint32_t duration, uint32_t flags) {
+    fmp4_track_t* track = &muxer->tracks[index];
+    if (track->sample_count >= FMP4_MAX_FRAGMENT_SAMPLES) {
+        muxer->stats.forced_fragments++;
+        if (fmp4_muxer_flush(muxer) != 0) return -1;
+    }
+
+    mp4_put_bytes(&track->data, data, size);
+    if (track->data.failed) {
+        fprintf(stderr, "MP4: Out of memory for sample data\n");
+        muxer->failed = 1;
+        return -1;
+    }
+    fmp4_sample_t* sample = &track->samples[track->sample_count++];
+    sample->size = (uint32_t)size;
+    sample->duration = duration;
+    sample->flags = flags;
+    track->next_time += duration;
+    fmp4_note_buffered(muxer);
+
+    if (fmp4_muxer_buffered_bytes(muxer) >= muxer->config.max_buffered_bytes) {
+        muxer->stats.forced_fragments++;
+        return fmp4_muxer_flush(muxer);
+    }
+    return 0;
+}
+
+// Span of the open fragment in milliseconds, measured on the video track when there is one
+static uint64_t fmp4_fragment_ms(const fmp4_muxer_t* muxer) {
+    const fmp4_track_t* track = &muxer->tracks[muxer->config.video ? FMP4_TRACK_VIDEO : FMP4_TRACK_AUDIO];
+    if (track->sample_count == 0 || track->timescale == 0) return 0;
+    return (track->next_time - track->fragment_start) * 1000 / track->timescale;
+}
+
+static int fmp4_commit_pending(fmp4_muxer_t* muxer, uint32_t duration) {
+    if (!muxer->has_pending) return 0;
+    muxer->has_pending = 0;
+    uint32_t flags = muxer->pending_keyframe ? FMP4_FLAGS_SYNC : FMP4_FLAGS_NON_SYNC;
+    int result = fmp4_append_sample(muxer, FMP4_TRACK_VIDEO, muxer->pending.data, muxer->pending.size, duration, flags);
+    mp4_buffer_reset(&muxer->pending);
+    muxer->stats.video_frames++;
+    return result;
+}
+
+static int fmp4_store_parameter_set(fmp4_muxer_t* muxer, const uint8_t* nal, size_t size) {
+    int sps = H264_NAL_TYPE(nal[0]) == H264_NAL_SPS;
+    uint8_t* stored = sps ? muxer->sps : muxer->pps;
+    size_t* stored_size = sps ? &muxer->sps_size : &muxer->pps_size;
+
+    if (muxer->header_written) {
+        // Repeated with every keyframe; a changed one cannot be signalled once the moov is out
+        if (size != *stored_size || memcmp(nal, stored, size) != 0) {
+            fprintf(stderr, "MP4: %s changed mid-stream; keeping the first\n", sps ? "SPS" : "PPS");
+        }
+        return 0;
+    }
+    if (size > FMP4_MAX_PARAMETER_SET) {
+        fprintf(stderr, "MP4: %s too large (%zu bytes)\n", sps ? "SPS" : "PPS", size);
+        return -1;
+    }
+    if (sps && h264_parse_sps(nal, size, &muxer->sps_info) != 0) {
+        fprintf(stderr, "MP4: Unreadable SPS\n");
+        return -1;
+    }
+    memcpy(stored, nal, size);
+    *stored_size = size;
+    return 0;
+}
+
+int fmp4_muxer_write_video(fmp4_muxer_t* muxer, const uint8_t* data, size_t size, int64_t time) {
+    if (!muxer || !muxer->write || muxer->failed || !muxer->config.video || !data) return -1;
+
+    int keyframe = h264_is_keyframe(data, size);
+    if (!muxer->keyframe_seen && !keyframe) {
+        muxer->stats.dropped_video++;
+        return 0;
+    }
+
+    uint64_t video_time = fmp4_video_time(time);
+    if (muxer->has_pending) {
+        if (video_time <= muxer->pending_time) {
+            fprintf(stderr, "MP4: Video timestamps must increase\n");
+            return -1;
+        }
+        uint32_t duration = (uint32_t)(video_time - muxer->pending_time);
+        muxer->last_duration = duration;
+        if (fmp4_commit_pending(muxer, duration) != 0) return -1;
+    } else {
+        // First frame: the track's timeline starts at its timestamp
+        muxer->tracks[FMP4_TRACK_VIDEO].fragment_start = video_time;
+        muxer->tracks[FMP4_TRACK_VIDEO].next_time = video_time;
+    }
+
+    // Cut before this frame: at a keyframe once the fragment is long enough, anywhere at twice that
+    uint64_t span = fmp4_fragment_ms(muxer);
+    if (span >= muxer->config.fragment_ms && (keyframe || span >= 2 * (uint64_t)muxer->config.fragment_ms)) {
+        if (!keyframe) muxer->stats.forced_fragments++;
+        if (fmp4_muxer_flush(muxer) != 0) return -1;
+    }
+
+    // Length-prefixed NAL units; parameter sets go to avcC, delimiters are dropped
+    size_t offset = 0;
+    const uint8_t* nal;
+    size_t nal_size;
+    while (h264_next_nal(data, size, &offset, &nal, &nal_size)) {
+        if (nal_size == 0) continue;
+        int type = H264_NAL_TYPE(nal[0]);
+        if (type == H264_NAL_SPS || type == H264_NAL_PPS) {
+            if (fmp4_store_parameter_set(muxer, nal, nal_size) != 0) {
+                mp4_buffer_reset(&muxer->pending);
+                return -1;
+            }
+            continue;
+        }
+        if (type == H264_NAL_AUD) continue;
+        mp4_put_u32(&muxer->pending, (uint32_t)nal_size);
+        mp4_put_bytes(&muxer->pending, nal, nal_size);
+    }
+    if (muxer->pending.failed) {
+        muxer->failed = 1;
+        return -1;
+    }
+    if (keyframe && !muxer->keyframe_seen) {
+        if (muxer->sps_size == 0 || muxer->pps_size == 0) {
+            fprintf(stderr, "MP4: First keyframe has no SPS/PPS\n");
+            mp4_buffer_reset(&muxer->pending);
+            muxer->stats.dropped_video++;
+            return 0;
+        }
+        muxer->keyframe_seen = 1;
+    }
+
+    muxer->has_pending = 1;
+    muxer->pending_keyframe = keyframe;
+    muxer->pending_time = video_time;
+    fmp4_note_buffered(muxer);
+    return 0;
+}
+
+static int fmp4_append_audio_frame(fmp4_muxer_t* muxer, const uint8_t* data, size_t size) {
+    if (fmp4_append_sample(muxer, FMP4_TRACK_AUDIO, data, size, AAC_SAMPLES_PER_FRAME, FMP4_FLAGS_SYNC) != 0) return -1;
+    muxer->stats.audio_frames++;
+
+    // Without video, audio alone sets the fragment length
+    if (!muxer->config.video && fmp4_fragment_ms(muxer) >= muxer->config.fragment_ms) return fmp4_muxer_flush(muxer);
+    return 0;
+}
+
+int fmp4_muxer_write_audio(fmp4_muxer_t* muxer, const uint8_t* data, size_t size) {
+    if (muxer && muxer->audio_abandoned && !muxer->failed) {
+        muxer->stats.dropped_audio++;
+        return 0;
+    }
+    if (!muxer || !muxer->write || muxer->failed || !muxer->config.audio || !data) return -1;
+
+    // A configured format means raw frames; otherwise the ADTS headers carry it
+    if (muxer->config.audio_sample_rate && muxer->audio_ready && !muxer->adts_format) {
+        return fmp4_append_audio_frame(muxer, data, size);
+    }
+
+    aac_adts_header_t header;
+    size_t offset = 0;
+    while (offset < size) {
+        if (aac_adts_parse(data + offset, size - offset, &header) != 0) {
+            fprintf(stderr, "MP4: Truncated or invalid ADTS frame\n");
+            return -1;
+        }
+        if (!muxer->audio_ready) {
+            if (aac_audio_specific_config(header.object_type, header.sample_rate, header.channels,
+                                          muxer->audio_config) != 0) {
+                return -1;
+            }
+            muxer->config.audio_sample_rate = header.sample_rate;
+            muxer->config.audio_channels = header.channels;
+            muxer->tracks[FMP4_TRACK_AUDIO].timescale = header.sample_rate;
+            muxer->audio_ready = 1;
+            muxer->adts_format = 1;
+        } else if (header.sample_rate != muxer->config.audio_sample_rate || header.channels != muxer->config.audio_channels) {
+            fprintf(stderr, "MP4: AAC format changed mid-stream\n");
+            return -1;
+        }
+        if (fmp4_append_audio_frame(muxer, data + offset + header.header_size, header.frame_size - header.header_size) != 0) {
+            return -1;
+        }
+        offset += header.frame_size;
+    }
+    return 0;
+}
+
+int fmp4_muxer_finish(fmp4_muxer_t* muxer) {
+    if (!muxer || !muxer->write || muxer->failed) return -1;
+
+    // The last frame has no successor; it lasts as long as the one before it
+    if (fmp4_commit_pending(muxer, muxer->last_duration) != 0) return -1;
+
+    if (!muxer->header_written && muxer->config.video && !muxer->keyframe_seen) {
+        if (!muxer->config.audio || muxer->tracks[FMP4_TRACK_AUDIO].sample_count == 0) {
+            fprintf(stderr, "MP4: No keyframe received; nothing to write\n");
+            return -1;
+        }
+        fprintf(stderr, "MP4: No keyframe received; writing audio only\n");
+        muxer->config.video = 0;
+    }
+    if (fmp4_muxer_flush(muxer) != 0) return -1;
+    if (!muxer->header_written) {
+        if (muxer->keyframe_seen && muxer->config.audio && !muxer->audio_ready) {
+            // Video is waiting on an audio format that never came; it cannot wait longer than a fragment
+            fprintf(stderr, "MP4: No audio by the first fragment; writing video only\n");
+            muxer->config.audio = 0;
+            muxer->audio_abandoned = 1;
+        }
+        if (!fmp4_header_ready(muxer)) {
+            fprintf(stderr, "MP4: No samples received; nothing to write\n");
+            return -1;
+        }
+        if (fmp4_write_header(muxer) != 0) return -1;
+    }
+    if (muxer->file && fflush(muxer->file) != 0) {
+        muxer->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+void fmp4_muxer_get_stats(const fmp4_muxer_t* muxer, fmp4_muxer_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(fmp4_muxer_stats_t));
+    if (muxer) *stats = muxer->stats;
+}
+
+void fmp4_muxer_report(const fmp4_muxer_t* muxer, fmp4_muxer_report_fn report) {
+    if (!muxer || !report) return;
+    const fmp4_muxer_stats_t* stats = &muxer->stats;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "MP4: %llu fragments (%llu forced), %.1f MB, %llu video and %llu audio frames, peak %zu KB buffered",
+             (unsigned long long)stats->fragments, (unsigned long long)stats->forced_fragments,
+             stats->bytes_written / (1024.0 * 1024.0), (unsigned long long)stats->video_frames,
+             (unsigned long long)stats->audio_frames, stats->peak_buffered / 1024);
+    report(message);
+    if (stats->dropped_video || stats->dropped_audio) {
+        snprintf(message, sizeof(message), "MP4: %llu video frames before the first keyframe and %llu audio frames dropped",
+                 (unsigned long long)stats->dropped_video, (unsigned long long)stats->dropped_audio);
+        report(message);
+    }
+}
@@ -0,0 +1,61 @@
+#include "fps_meter.h"
+#include <stdio.h>
+#include <string.h>
+
+int fps_meter_init(fps_meter_t* meter, int requested_fps) {
+    if (!meter) return -1;
+    memset(meter, 0, sizeof(fps_meter_t));
+    if (requested_fps <= 0) return -1;
+    meter->requested_fps = requested_fps;
+    return 0;
+}
+
+void fps_meter_start(fps_meter_t* meter, uint64_t now_ns) {
+    if (!meter) return;
+    int requested_fps = meter->requested_fps;
+    memset(meter, 0, sizeof(fps_meter_t));
+    meter->requested_fps = requested_fps;
+    meter->started = 1;
+    meter->start_ns = now_ns;
+    meter->window_start_ns = now_ns;
+}
+
+int fps_meter_update(fps_meter_t* meter, uint64_t now_ns, uint64_t total_frames) {
+    if (!meter || !meter->started || now_ns < meter->window_start_ns) return 0;
+    meter->frames = total_frames;
+
+    uint64_t elapsed = now_ns - meter->window_start_ns;
+    if (elapsed < FPS_METER_WINDOW_NS) return 0;
+
+    // Late updates stretch the window; the rate is still frames over its real length
+    double fps = (double)(total_frames - meter->window_start_frames) * 1e9 / (double)elapsed;
+    meter->last_fps = fps;
+    if (meter->windows == 0 || fps < meter->min_fps) meter->min_fps = fps;
+    if (meter->windows == 0 || fps > meter->max_fps) meter->max_fps = fps;
+    if (fps * 100.0 < (double)meter->requested_fps * FPS_METER_SHORT_PERCENT) meter->short_windows++;
+    meter->windows++;
+
+    meter->window_start_ns = now_ns;
+    meter->window_start_frames = total_frames;
+    return 1;
+}
+
+double fps_meter_average(const fps_meter_t* meter, uint64_t now_ns) {
+    if (!meter || !meter->started || now_ns <= meter->start_ns) return 0.0;
+    return (double)meter->frames * 1e9 / (double)(now_ns - meter->start_ns);
+}
+
+void fps_meter_report(const fps_meter_t* meter, uint64_t now_ns, fps_meter_report_fn report) {
+    if (!meter || !meter->started || !report) return;
+    char message[192];
+    if (meter->windows == 0) {
+        snprintf(message, sizeof(message), "Frame rate: %.1f of %d fps requested",
+                 fps_meter_average(meter, now_ns), meter->requested_fps);
+    } else {
+        snprintf(message, sizeof(message),
+                 "Frame rate: %.1f of %d fps requested, %.1f-%.1f per second, %llu of %llu seconds below %d%%",
+                 fps_meter_average(meter, now_ns), meter->requested_fps, meter->min_fps, meter->max_fps,
+                 (unsigned long long)meter->short_windows, (unsigned long long)meter->windows, FPS_METER_SHORT_PERCENT);
+    }
+    report(message);
+}
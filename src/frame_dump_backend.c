@@ -0,0 +1,199 @@
+#include "encoder_backend.h"
+#include "capture_spool.h"
+#include "replay_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Backends that store frames as captured, to be encoded later: a raw frame
+// file holds every frame in full, a capture spool each distinct tile once.
+// Both are video only and take top-down BGRA.
+
+// Never called: init refuses audio streams for backends without audio
+static int dump_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time) {
+    (void)backend;
+    (void)stream;
+    (void)data;
+    (void)frames;
+    (void)time;
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Raw frame file
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    replay_writer_t writer;
+    frame_pool_t* last_pool;        // Held for repeats: the file has no timing, every tick is a frame
+    frame_handle_t last;
+} raw_backend_t;
+
+static void raw_release_last(raw_backend_t* raw) {
+    if (raw->last_pool && raw->last != FRAME_HANDLE_INVALID) frame_pool_release(raw->last_pool, raw->last);
+    raw->last_pool = NULL;
+    raw->last = FRAME_HANDLE_INVALID;
+}
+
+static int raw_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    if (!config->video) return -1;
+    raw_release_last(raw);
+    return replay_writer_open(&raw->writer, config->path, config->width, config->height, config->fps);
+}
+
+static int raw_write(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    if (replay_writer_append(&raw->writer, (const uint8_t*)frame_pool_data(pool, frame), (size_t)raw->writer.width * 4) != 0) {
+        fprintf(stderr, "Raw: Failed to write frame %llu\n", (unsigned long long)raw->writer.frames);
+        backend->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static int raw_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    (void)time;
+    if (frame_pool_frame_size(pool) < (size_t)raw->writer.width * raw->writer.height * 4) return -1;
+    if (raw_write(backend, pool, frame) != 0) return -1;
+    frame_pool_addref(pool, frame);
+    raw_release_last(raw);
+    raw->last_pool = pool;
+    raw->last = frame;
+    return 0;
+}
+
+static int raw_repeat_video(encoder_backend_t* backend, int64_t time) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    (void)time;
+    if (!raw->last_pool) return -1;
+    return raw_write(backend, raw->last_pool, raw->last);
+}
+
+static int raw_flush(encoder_backend_t* backend) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    return fflush(raw->writer.file) == 0 ? 0 : -1;
+}
+
+static int raw_finalize(encoder_backend_t* backend) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    raw_release_last(raw);
+    return replay_writer_close(&raw->writer);
+}
+
+static void raw_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    if (raw->writer.width > 0) {
+        stats->bytes = REPLAY_FILE_HEADER_SIZE + raw->writer.frames * (uint64_t)raw->writer.width * raw->writer.height * 4;
+    }
+}
+
+static void raw_destroy(encoder_backend_t* backend) {
+    raw_backend_t* raw = (raw_backend_t*)backend->impl;
+    if (!raw) return;
+    raw_release_last(raw);
+    if (raw->writer.file) replay_writer_close(&raw->writer);
+    free(raw);
+    backend->impl = NULL;
+}
+
+static const encoder_backend_ops_t raw_ops = {
+    "raw",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_BGRA),
+    0,
+    raw_init,
+    raw_push_video,
+    raw_repeat_video,
+    dump_push_audio,
+    raw_flush,
+    raw_finalize,
+    raw_stats,
+    NULL,
+    raw_destroy
+};
+
+int raw_backend_create(encoder_backend_t* backend) {
+    if (!backend) return -1;
+    memset(backend, 0, sizeof(encoder_backend_t));
+    raw_backend_t* raw = (raw_backend_t*)calloc(1, sizeof(raw_backend_t));
+    if (!raw) return -1;
+    raw->last = FRAME_HANDLE_INVALID;
+    backend->ops = &raw_ops;
+    backend->impl = raw;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Capture spool
+// ---------------------------------------------------------------------------
+
+static int spool_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    if (!config->video) return -1;
+    return capture_spool_writer_open((capture_spool_writer_t*)backend->impl, config->path,
+                                     config->width, config->height, config->fps);
+}
+
+static int spool_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    capture_spool_writer_t* writer = (capture_spool_writer_t*)backend->impl;
+    if (frame_pool_frame_size(pool) < (size_t)writer->width * writer->height * 4) return -1;
+    // Out of disk: the recording stops rather than leave a gap
+    if (capture_spool_writer_append(writer, (const uint8_t*)frame_pool_data(pool, frame), (size_t)writer->width * 4, time) != 0) {
+        backend->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static int spool_repeat_video(encoder_backend_t* backend, int64_t time) {
+    if (capture_spool_writer_repeat((capture_spool_writer_t*)backend->impl, time) != 0) {
+        backend->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+static int spool_finalize(encoder_backend_t* backend) {
+    return capture_spool_writer_close((capture_spool_writer_t*)backend->impl);
+}
+
+static void spool_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats) {
+    stats->bytes = ((capture_spool_writer_t*)backend->impl)->stats.bytes;
+}
+
+static void spool_report(encoder_backend_t* backend, encoder_backend_report_fn report) {
+    capture_spool_writer_report((capture_spool_writer_t*)backend->impl, report);
+}
+
+static void spool_destroy(encoder_backend_t* backend) {
+    capture_spool_writer_t* writer = (capture_spool_writer_t*)backend->impl;
+    if (!writer) return;
+    capture_spool_writer_close(writer);
+    free(writer);
+    backend->impl = NULL;
+}
+
+static const encoder_backend_ops_t spool_ops = {
+    "spool",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_BGRA),
+    0,
+    spool_init,
+    spool_push_video,
+    spool_repeat_video,
+    dump_push_audio,
+    NULL,
+    spool_finalize,
+    spool_stats,
+    spool_report,
+    spool_destroy
+};
+
+int spool_backend_create(encoder_backend_t* backend) {
+    if (!backend) return -1;
+    memset(backend, 0, sizeof(encoder_backend_t));
+    capture_spool_writer_t* writer = (capture_spool_writer_t*)calloc(1, sizeof(capture_spool_writer_t));
+    if (!writer) return -1;
+    backend->ops = &spool_ops;
+    backend->impl = writer;
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "frame_pacer.h"
+#include <stdio.h>
+#include <string.h>
+
+static const uint64_t frame_pacer_bucket_limits_ns[FRAME_PACER_JITTER_BUCKETS - 1] = {
+    100000ULL, 500000ULL, 1000000ULL, 2000000ULL, 5000000ULL
+};
+
+static uint64_t frame_pacer_platform_now(void* context) {
+    (void)context;
+    return platform_time_ns();
+}
+
+static void frame_pacer_platform_wait(void* context, uint64_t deadline_ns) {
+    platform_timer_wait_until_ns((platform_timer_t*)context, deadline_ns);
+}
+
+int frame_pacer_init(frame_pacer_t* pacer, uint32_t rate_num, uint32_t rate_den, const frame_clock_t* clock) {
+    if (!pacer) return -1;
+    memset(pacer, 0, sizeof(frame_pacer_t));
+    if (rate_num == 0 || rate_den == 0) return -1;
+    if (clock && (!clock->now_ns || !clock->wait_until_ns)) return -1;
+
+    pacer->rate_num = rate_num;
+    pacer->rate_den = rate_den;
+    pacer->whole_seconds_ns = (uint64_t)rate_den * FRAME_PACER_NS_PER_SECOND;
+
+    if (clock) {
+        pacer->clock = *clock;
+    } else {
+        if (platform_timer_init(&pacer->timer) != 0) return -1;
+        pacer->own_timer = 1;
+        pacer->clock.now_ns = frame_pacer_platform_now;
+        pacer->clock.wait_until_ns = frame_pacer_platform_wait;
+        pacer->clock.context = &pacer->timer;
+    }
+    return 0;
+}
+
+void frame_pacer_cleanup(frame_pacer_t* pacer) {
+    if (!pacer) return;
+    if (pacer->own_timer) platform_timer_destroy(&pacer->timer);
+    memset(pacer, 0, sizeof(frame_pacer_t));
+}
+
+void frame_pacer_start(frame_pacer_t* pacer) {
+    if (!pacer || !pacer->clock.now_ns) return;
+    pacer->start_ns = pacer->clock.now_ns(pacer->clock.context);
+    pacer->next_frame = 0;
+    memset(&pacer->stats, 0, sizeof(frame_pacer_stats_t));
+}
+
+uint64_t frame_pacer_frame_time_ns(const frame_pacer_t* pacer, uint64_t frame) {
+    if (!pacer || pacer->rate_num == 0) return 0;
+    // Whole groups of rate_num frames span exactly rate_den seconds; only the
+    // remainder is divided, which keeps the product far from overflowing
+    uint64_t groups = frame / pacer->rate_num;
+    uint64_t remainder = frame % pacer->rate_num;
+    return groups * pacer->whole_seconds_ns + remainder * pacer->whole_seconds_ns / pacer->rate_num;
+}
+
+uint32_t frame_pacer_frames_within(uint32_t rate_num, uint32_t rate_den, uint32_t milliseconds) {
+    if (rate_den == 0) return 0;
+    uint64_t span = (uint64_t)rate_den * 1000;
+    return (uint32_t)(((uint64_t)rate_num * milliseconds + span - 1) / span);
+}
+
+// Latest slot due at or before an offset from start
+static uint64_t frame_pacer_frame_at(const frame_pacer_t* pacer, uint64_t offset_ns) {
+    uint64_t groups = offset_ns / pacer->whole_seconds_ns;
+    uint64_t remainder = offset_ns % pacer->whole_seconds_ns;
+    return groups * pacer->rate_num + remainder * pacer->rate_num / pacer->whole_seconds_ns;
+}
+
+int frame_pacer_wait(frame_pacer_t* pacer, frame_pacer_tick_t* tick) {
+    if (!pacer || !tick || !pacer->clock.now_ns) return -1;
+
+    uint64_t now = pacer->clock.now_ns(pacer->clock.context);
+    uint64_t frame = pacer->next_frame;
+    uint64_t skipped = 0;
+
+    // Already past the following slot: resume on the latest due one
+    if (now > pacer->start_ns + frame_pacer_frame_time_ns(pacer, frame + 1)) {
+        uint64_t latest = frame_pacer_frame_at(pacer, now - pacer->start_ns);
+        skipped = latest - frame;
+        frame = latest;
+    }
+
+    uint64_t due = pacer->start_ns + frame_pacer_frame_time_ns(pacer, frame);
+    if (now < due) {
+        pacer->clock.wait_until_ns(pacer->clock.context, due);
+        now = pacer->clock.now_ns(pacer->clock.context);
+    }
+
+    tick->index = frame;
+    tick->time_ns = due - pacer->start_ns;
+    tick->jitter_ns = now > due ? now - due : 0;
+    tick->skipped = skipped;
+    pacer->next_frame = frame + 1;
+
+    pacer->stats.frames++;
+    pacer->stats.skipped += skipped;
+    pacer->stats.total_jitter_ns += tick->jitter_ns;
+    if (tick->jitter_ns > pacer->stats.max_jitter_ns) pacer->stats.max_jitter_ns = tick->jitter_ns;
+    int bucket = 0;
+    while (bucket < FRAME_PACER_JITTER_BUCKETS - 1 && tick->jitter_ns >= frame_pacer_bucket_limits_ns[bucket]) bucket++;
+    pacer->stats.jitter_buckets[bucket]++;
+    return 0;
+}
+
+uint64_t frame_pacer_elapsed_ns(const frame_pacer_t* pacer) {
+    if (!pacer || !pacer->clock.now_ns) return 0;
+    uint64_t now = pacer->clock.now_ns(pacer->clock.context);
+    return now > pacer->start_ns ? now - pacer->start_ns : 0;
+}
+
+void frame_pacer_get_stats(const frame_pacer_t* pacer, frame_pacer_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(frame_pacer_stats_t));
+    if (pacer) *stats = pacer->stats;
+}
+
+void frame_pacer_report(const frame_pacer_t* pacer, frame_pacer_report_fn report) {
+    if (!pacer || !report || pacer->stats.frames == 0) return;
+    const frame_pacer_stats_t* stats = &pacer->stats;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Pacer: %llu frames, %llu skipped, jitter avg %.3f ms, max %.3f ms "
+             "(<0.1: %llu, <0.5: %llu, <1: %llu, <2: %llu, <5: %llu, more: %llu)",
+             (unsigned long long)stats->frames, (unsigned long long)stats->skipped,
+             stats->total_jitter_ns / 1e6 / (double)stats->frames, stats->max_jitter_ns / 1e6,
+             (unsigned long long)stats->jitter_buckets[0], (unsigned long long)stats->jitter_buckets[1],
+             (unsigned long long)stats->jitter_buckets[2], (unsigned long long)stats->jitter_buckets[3],
+             (unsigned long long)stats->jitter_buckets[4], (unsigned long long)stats->jitter_buckets[5]);
+    report(message);
+}
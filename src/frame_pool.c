@@ -0,0 +1,136 @@
+#include "frame_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int frame_pool_valid_handle(const frame_pool_t* pool, frame_handle_t handle) {
+    return pool && pool->slots && handle >= 0 && handle < pool->capacity;
+}
+
+int frame_pool_init(frame_pool_t* pool, size_t frame_size, int capacity) {
+    if (!pool || frame_size == 0 || capacity <= 0) return -1;
+
+    memset(pool, 0, sizeof(frame_pool_t));
+    pool->frame_size = frame_size;
+    pool->frame_stride = (frame_size + FRAME_POOL_ALIGNMENT - 1) & ~(size_t)(FRAME_POOL_ALIGNMENT - 1);
+    pool->capacity = capacity;
+
+    pool->slots = (frame_slot_t*)calloc((size_t)capacity, sizeof(frame_slot_t));
+    if (!pool->slots) {
+        fprintf(stderr, "Frame pool: Failed to allocate slot table\n");
+        return -1;
+    }
+
+    pool->storage = (uint8_t*)platform_aligned_alloc(pool->frame_stride * (size_t)capacity, FRAME_POOL_ALIGNMENT);
+    if (!pool->storage) {
+        fprintf(stderr, "Frame pool: Failed to allocate %d frames of %zu bytes\n", capacity, frame_size);
+        free(pool->slots);
+        pool->slots = NULL;
+        return -1;
+    }
+
+    // Touch every page up front so steady-state capture never page-faults
+    memset(pool->storage, 0, pool->frame_stride * (size_t)capacity);
+
+    for (int i = 0; i < capacity; i++) {
+        pool->slots[i].data = pool->storage + pool->frame_stride * (size_t)i;
+        pool->slots[i].refcount = 0;
+        pool->slots[i].next_free = (i + 1 < capacity) ? i + 1 : FRAME_HANDLE_INVALID;
+    }
+    pool->free_head = 0;
+    pool->stats.capacity = capacity;
+
+    if (platform_mutex_init(&pool->lock) != 0) {
+        platform_aligned_free(pool->storage);
+        free(pool->slots);
+        memset(pool, 0, sizeof(frame_pool_t));
+        return -1;
+    }
+
+    return 0;
+}
+
+void frame_pool_cleanup(frame_pool_t* pool) {
+    if (!pool || !pool->slots) return;
+
+    platform_mutex_destroy(&pool->lock);
+    platform_aligned_free(pool->storage);
+    free(pool->slots);
+    memset(pool, 0, sizeof(frame_pool_t));
+}
+
+frame_handle_t frame_pool_acquire(frame_pool_t* pool) {
+    if (!pool || !pool->slots) return FRAME_HANDLE_INVALID;
+
+    platform_mutex_lock(&pool->lock);
+
+    frame_handle_t handle = pool->free_head;
+    if (handle == FRAME_HANDLE_INVALID) {
+        pool->stats.exhausted++;
+        platform_mutex_unlock(&pool->lock);
+        return FRAME_HANDLE_INVALID;
+    }
+
+    pool->free_head = pool->slots[handle].next_free;
+    pool->slots[handle].next_free = FRAME_HANDLE_INVALID;
+    platform_atomic_store(&pool->slots[handle].refcount, 1);
+
+    pool->stats.acquired++;
+    pool->stats.in_use++;
+    if (pool->stats.in_use > pool->stats.high_water) {
+        pool->stats.high_water = pool->stats.in_use;
+    }
+
+    platform_mutex_unlock(&pool->lock);
+    return handle;
+}
+
+void frame_pool_addref(frame_pool_t* pool, frame_handle_t handle) {
+    if (!frame_pool_valid_handle(pool, handle)) return;
+    platform_atomic_inc(&pool->slots[handle].refcount);
+}
+
+void frame_pool_release(frame_pool_t* pool, frame_handle_t handle) {
+    if (!frame_pool_valid_handle(pool, handle)) return;
+
+    long remaining = platform_atomic_dec(&pool->slots[handle].refcount);
+    if (remaining > 0) return;
+
+    if (remaining < 0) {
+        // Over-release is a caller bug; clamp so the frame is not queued twice
+        fprintf(stderr, "Frame pool: Frame %d released more often than acquired\n", handle);
+        platform_atomic_store(&pool->slots[handle].refcount, 0);
+        return;
+    }
+
+    platform_mutex_lock(&pool->lock);
+    pool->slots[handle].next_free = pool->free_head;
+    pool->free_head = handle;
+    pool->stats.in_use--;
+    platform_mutex_unlock(&pool->lock);
+}
+
+void* frame_pool_data(const frame_pool_t* pool, frame_handle_t handle) {
+    if (!frame_pool_valid_handle(pool, handle)) return NULL;
+    return pool->slots[handle].data;
+}
+
+size_t frame_pool_frame_size(const frame_pool_t* pool) {
+    return pool ? pool->frame_size : 0;
+}
+
+int frame_pool_refcount(frame_pool_t* pool, frame_handle_t handle) {
+    if (!frame_pool_valid_handle(pool, handle)) return 0;
+    return (int)platform_atomic_load(&pool->slots[handle].refcount);
+}
+
+void frame_pool_get_stats(frame_pool_t* pool, frame_pool_stats_t* stats) {
+    if (!stats) return;
+
+    memset(stats, 0, sizeof(frame_pool_stats_t));
+    if (!pool || !pool->slots) return;
+
+    platform_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    platform_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,100 @@
+#include "frame_timeline.h"
+#include <string.h>
+
+int frame_timeline_init(frame_timeline_t* timeline, frame_timing_t mode, int fps) {
+    if (!timeline || fps <= 0) return -1;
+    if (mode != FRAME_TIMING_CFR && mode != FRAME_TIMING_VFR) return -1;
+
+    memset(timeline, 0, sizeof(frame_timeline_t));
+    timeline->mode = mode;
+    timeline->fps = fps;
+    timeline->refresh_interval = FRAME_TIMELINE_REFRESH_SECONDS * FRAME_TIMELINE_UNITS_PER_SECOND;
+    return 0;
+}
+
+int64_t frame_timeline_slot_time(const frame_timeline_t* timeline, uint64_t tick) {
+    return (int64_t)(tick * FRAME_TIMELINE_UNITS_PER_SECOND / (uint64_t)timeline->fps);
+}
+
+// CFR sample time: the slot nearest the capture time, never one already used.
+// Slots skipped on the way are covered by the held sample.
+static int64_t frame_timeline_cfr_time(frame_timeline_t* timeline, int64_t capture_time) {
+    uint64_t slot = 0;
+    if (capture_time > 0) {
+        slot = ((uint64_t)capture_time * (uint64_t)timeline->fps + FRAME_TIMELINE_UNITS_PER_SECOND / 2) /
+               FRAME_TIMELINE_UNITS_PER_SECOND;
+    }
+    if (slot < timeline->ticks) slot = timeline->ticks;
+    if (timeline->pending) timeline->gap_slots += slot - timeline->ticks;
+    timeline->ticks = slot;
+    return frame_timeline_slot_time(timeline, slot);
+}
+
+// VFR sample time: the capture time, kept strictly after the held sample
+static int64_t frame_timeline_vfr_time(const frame_timeline_t* timeline, int64_t capture_time) {
+    int64_t time = capture_time < 0 ? 0 : capture_time;
+    if (time < timeline->last_time) time = timeline->last_time;
+    if (timeline->pending && time <= timeline->pending_time) time = timeline->pending_time + 1;
+    return time;
+}
+
+// Close the held sample at `time` and hold a new one from there
+static void frame_timeline_start(frame_timeline_t* timeline, int64_t time, frame_timeline_step_t* step) {
+    if (timeline->pending) {
+        step->write_pending = 1;
+        step->pending_duration = time - timeline->pending_time;
+        timeline->end_time = time;
+    }
+    step->start_sample = 1;
+    step->time = time;
+
+    timeline->pending = 1;
+    timeline->pending_time = time;
+    timeline->samples++;
+}
+
+int frame_timeline_new_frame(frame_timeline_t* timeline, int64_t capture_time, frame_timeline_step_t* step) {
+    if (!timeline || !step || timeline->fps <= 0) return -1;
+    memset(step, 0, sizeof(frame_timeline_step_t));
+
+    int64_t time = timeline->mode == FRAME_TIMING_CFR ? frame_timeline_cfr_time(timeline, capture_time)
+                                                      : frame_timeline_vfr_time(timeline, capture_time);
+    frame_timeline_start(timeline, time, step);
+    timeline->last_time = time;
+    timeline->ticks++;
+    return 0;
+}
+
+int frame_timeline_repeat_frame(frame_timeline_t* timeline, int64_t capture_time, frame_timeline_step_t* step) {
+    if (!timeline || !step || !timeline->pending) return -1;
+    memset(step, 0, sizeof(frame_timeline_step_t));
+
+    int64_t time = timeline->mode == FRAME_TIMING_CFR ? frame_timeline_cfr_time(timeline, capture_time)
+                                                      : frame_timeline_vfr_time(timeline, capture_time);
+    if (time - timeline->pending_time >= timeline->refresh_interval) {
+        frame_timeline_start(timeline, time, step);
+        timeline->refreshes++;
+    }
+    timeline->last_time = time;
+    timeline->ticks++;
+    timeline->repeats++;
+    return 0;
+}
+
+int64_t frame_timeline_finish(frame_timeline_t* timeline) {
+    if (!timeline || !timeline->pending) return -1;
+
+    // CFR ends on the next slot; VFR gives the last tick one frame interval
+    int64_t end = timeline->mode == FRAME_TIMING_CFR
+        ? frame_timeline_slot_time(timeline, timeline->ticks)
+        : timeline->last_time + FRAME_TIMELINE_UNITS_PER_SECOND / timeline->fps;
+    if (end <= timeline->pending_time) end = timeline->pending_time + 1;
+
+    timeline->pending = 0;
+    timeline->end_time = end;
+    return end - timeline->pending_time;
+}
+
+const char* frame_timing_name(frame_timing_t mode) {
+    return mode == FRAME_TIMING_VFR ? "variable" : "constant";
+}
@@ -35,6 +35,8 @@
 #define ID_VIDEO_CHECKBOX       1014
 #define ID_SYSTEM_CHECKBOX      1015
 #define ID_MICROPHONE_CHECKBOX  1016
+#define ID_REPLAY_EDIT          1017
+#define ID_SAVE_REPLAY_BUTTON   1018
 
 // Global variables
 HWND g_hMainWindow = NULL;
@@ -49,11 +51,14 @@ HWND g_hProgressBar = NULL;
 HWND g_hVideoCheckbox = NULL;
 HWND g_hSystemCheckbox = NULL;
 HWND g_hMicrophoneCheckbox = NULL;
+HWND g_hReplayEdit = NULL;
+HWND g_hSaveReplayButton = NULL;
 
 // Capture engine and thread
 capture_engine_t g_engine = {0};
 HANDLE g_recordingThread = NULL;
 BOOL g_isRecording = FALSE;
+BOOL g_isReplaying = FALSE;     // Recording into the replay buffer; Save Replay writes it out
 
 // Thread parameter structure
 typedef struct {
@@ -65,6 +70,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 void CreateControls(HWND hwnd);
 void OnStartRecording(void);
 void OnStopRecording(void);
+void OnSaveReplay(void);
 void OnBrowseOutputFile(HWND hwnd);
 DWORD WINAPI RecordingThread(LPVOID lpParam);
 void UpdateUI(BOOL isRecording);
@@ -151,6 +157,9 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case ID_STOP_BUTTON:
                     OnStopRecording();
                     break;
+                case ID_SAVE_REPLAY_BUTTON:
+                    OnSaveReplay();
+                    break;
                 case ID_BROWSE_BUTTON:
                     OnBrowseOutputFile(hwnd);
                     break;
@@ -169,6 +178,17 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                         BOOL video_enabled = (SendMessage(g_hVideoCheckbox, BM_GETCHECK, 0, 0) == BST_CHECKED);
                         BOOL system_enabled = (SendMessage(g_hSystemCheckbox, BM_GETCHECK, 0, 0) == BST_CHECKED);
                         BOOL mic_enabled = (SendMessage(g_hMicrophoneCheckbox, BM_GETCHECK, 0, 0) == BST_CHECKED);
+    
+    // The replay buffer takes its packets from the software H.264 encoder, which has no audio
+    if (params->params.replay_seconds > 0) {
+        if (system_enabled || mic_enabled) {
+            MessageBox(g_hMainWindow, "The replay buffer records video only. Uncheck System and Microphone to use it.",
+                      "Replay Buffer", MB_OK | MB_ICONWARNING);
+            free(params);
+            return;
+        }
+        params->params.encoder_backend = ENCODER_BACKEND_H264;
+    }
                         
                         // Validate: at least one option must be selected
                         if (!video_enabled && !system_enabled && !mic_enabled) {
@@ -219,6 +239,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             
             g_isRecording = FALSE;
+            g_isReplaying = FALSE;
             UpdateUI(FALSE);
             SetStatus("Ready");
             break;
@@ -314,6 +335,17 @@ void CreateControls(HWND hwnd) {
                                         hwnd, (HMENU)ID_MICROPHONE_CHECKBOX, GetModuleHandle(NULL), NULL);
     SendMessage(g_hMicrophoneCheckbox, BM_SETCHECK, BST_CHECKED, 0); // Default checked
 
+    // Replay buffer length; 0 records to the file as usual
+    CreateWindow("STATIC", "Replay:",
+                WS_VISIBLE | WS_CHILD,
+                280, 77, 45, 18,
+                hwnd, NULL, GetModuleHandle(NULL), NULL);
+
+    g_hReplayEdit = CreateWindow("EDIT", "0",
+                                WS_VISIBLE | WS_CHILD | WS_BORDER | ES_NUMBER,
+                                330, 75, 35, 22,
+                                hwnd, (HMENU)ID_REPLAY_EDIT, GetModuleHandle(NULL), NULL);
+
     // Control buttons
     g_hStartButton = CreateWindow("BUTTON", "Start Recording",
                                  WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
@@ -326,6 +358,12 @@ void CreateControls(HWND hwnd) {
                                 hwnd, (HMENU)ID_STOP_BUTTON, GetModuleHandle(NULL), NULL);
     EnableWindow(g_hStopButton, FALSE);
 
+    g_hSaveReplayButton = CreateWindow("BUTTON", "Save Replay",
+                                      WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON,
+                                      255, 110, 110, 35,
+                                      hwnd, (HMENU)ID_SAVE_REPLAY_BUTTON, GetModuleHandle(NULL), NULL);
+    EnableWindow(g_hSaveReplayButton, FALSE);
+
     // Status and progress
     CreateWindow("STATIC", "Status:",
                 WS_VISIBLE | WS_CHILD,
@@ -378,6 +416,12 @@ void OnStartRecording(void) {
     GetWindowText(g_hDurationEdit, durationText, sizeof(durationText));
     params->params.duration = atoi(durationText);
 
+    // Replay seconds keep the recording in memory until Save Replay
+    char replayText[16];
+    GetWindowText(g_hReplayEdit, replayText, sizeof(replayText));
+    params->params.replay_seconds = atoi(replayText);
+    if (params->params.replay_seconds < 0) params->params.replay_seconds = 0;
+
     // Get recording mode selection from checkboxes
     BOOL video_enabled = (SendMessage(g_hVideoCheckbox, BM_GETCHECK, 0, 0) == BST_CHECKED);
     BOOL system_enabled = (SendMessage(g_hSystemCheckbox, BM_GETCHECK, 0, 0) == BST_CHECKED);
@@ -410,7 +454,8 @@ void OnStartRecording(void) {
         SetWindowText(g_hOutputEdit, params->params.output_filename);
     }
 
-    // Start recording thread
+    // Start recording thread; it owns and frees params
+    BOOL replaying = params->params.replay_seconds > 0;
     g_recordingThread = CreateThread(NULL, 0, RecordingThread, params, 0, NULL);
     if (!g_recordingThread) {
         free(params);
@@ -419,6 +464,7 @@ void OnStartRecording(void) {
     }
 
     g_isRecording = TRUE;
+    g_isReplaying = replaying;
     UpdateUI(TRUE);
 }
 
@@ -435,6 +481,20 @@ void OnStopRecording(void) {
     // The recording thread will send WM_USER + 2 when it's done
 }
 
+// Save the replay buffer; the engine writes it in the background and keeps recording
+void OnSaveReplay(void) {
+    if (!g_isRecording || !g_isReplaying) return;
+
+    char path[MAX_PATH];
+    char status[MAX_PATH + 32];
+    if (engine_save_replay(&g_engine, path, sizeof(path)) == 0) {
+        snprintf(status, sizeof(status), "Saving replay to %s", path);
+    } else {
+        snprintf(status, sizeof(status), "Replay not saved: buffer not ready");
+    }
+    SetStatus(status);
+}
+
 // Browse for output file
 void OnBrowseOutputFile(HWND hwnd) {
     OPENFILENAME ofn = {0};
@@ -464,7 +524,8 @@ DWORD WINAPI RecordingThread(LPVOID lpParam) {
     
     // No COM initialization here - let record_start() handle it consistently
     
-    // Initialize capture engine and set callbacks
+    // Release the previous recording's session, then initialize capture engine and set callbacks
+    engine_cleanup(&g_engine);
     if (engine_init(&g_engine) != 0) {
         free(params);
         PostMessage(g_hMainWindow, WM_USER + 1, 0, (LPARAM)"Failed to initialize capture engine");
@@ -516,6 +577,8 @@ void UpdateUI(BOOL isRecording) {
     EnableWindow(g_hVideoCheckbox, !isRecording);
     EnableWindow(g_hSystemCheckbox, !isRecording);
     EnableWindow(g_hMicrophoneCheckbox, !isRecording);
+    EnableWindow(g_hReplayEdit, !isRecording);
+    EnableWindow(g_hSaveReplayButton, isRecording && g_isReplaying);
 }
 
 // Set status text
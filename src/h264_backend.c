@@ -0,0 +1,325 @@
+#include "encoder_backend.h"
+#include "fmp4_muxer.h"
+#include "h264_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef MUXSW_HAVE_X264
+#include <x264.h>
+#endif
+
+// Backends that encode H.264 in process and mux it with fmp4_muxer: the
+// in-tree software writer, available everywhere, and libx264 when the build
+// found it. Both take top-down NV12 and record video only; fragmented MP4
+// needs AAC for audio and there is no portable AAC encoder in the tree.
+
+typedef struct {
+    fmp4_muxer_t muxer;
+    int muxer_open;
+    uint64_t bytes;                 // Of the last finished file
+    h264_writer_t writer;
+#ifdef MUXSW_HAVE_X264
+    x264_t* x264;
+    frame_pool_t* last_pool;        // Held for repeats, which x264 encodes again as skips
+    frame_handle_t last;
+#endif
+} h264_backend_t;
+
+// Nothing to open when the packets only go to the packet sink
+static int h264_open_muxer(encoder_backend_t* backend, const encoder_backend_config_t* config, size_t max_buffered) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (config->packets_only) return 0;
+    fmp4_config_t muxer;
+    memset(&muxer, 0, sizeof(muxer));
+    muxer.video = 1;
+    muxer.max_buffered_bytes = max_buffered;
+    muxer.frame_duration = (uint32_t)(ENCODER_BACKEND_UNITS_PER_SECOND / config->fps);
+    if (fmp4_muxer_open(&impl->muxer, &muxer, config->path) != 0) return -1;
+    impl->muxer_open = 1;
+    return 0;
+}
+
+static int h264_write(encoder_backend_t* backend, const uint8_t* data, size_t size, int64_t time) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (impl->muxer_open && fmp4_muxer_write_video(&impl->muxer, data, size, time) != 0) {
+        backend->failed = 1;
+        return -1;
+    }
+    if (backend->packet_sink) backend->packet_sink(backend->packet_context, ENCODER_PACKET_VIDEO, data, size, time);
+    return 0;
+}
+
+static void h264_close_muxer(h264_backend_t* impl) {
+    if (!impl->muxer_open) return;
+    impl->bytes = impl->muxer.stats.bytes_written;
+    fmp4_muxer_cleanup(&impl->muxer);
+    impl->muxer_open = 0;
+}
+
+static int h264_flush(encoder_backend_t* backend) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    return impl->muxer_open ? fmp4_muxer_flush(&impl->muxer) : 0;
+}
+
+static void h264_stats(encoder_backend_t* backend, encoder_backend_stats_t* stats) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    stats->bytes = impl->muxer_open ? impl->muxer.stats.bytes_written : impl->bytes;
+}
+
+// Never called: init refuses audio streams for backends without audio
+static int h264_push_audio(encoder_backend_t* backend, int stream, const uint8_t* data, uint32_t frames, int64_t time) {
+    (void)backend;
+    (void)stream;
+    (void)data;
+    (void)frames;
+    (void)time;
+    return -1;
+}
+
+static h264_backend_t* h264_create_impl(encoder_backend_t* backend, const encoder_backend_ops_t* ops) {
+    if (!backend) return NULL;
+    memset(backend, 0, sizeof(encoder_backend_t));
+    h264_backend_t* impl = (h264_backend_t*)calloc(1, sizeof(h264_backend_t));
+    if (!impl) return NULL;
+    backend->ops = ops;
+    backend->impl = impl;
+    return impl;
+}
+
+// ---------------------------------------------------------------------------
+// Software H.264 (h264_writer)
+// ---------------------------------------------------------------------------
+
+static int h264_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!config->video) return -1;
+    // The previous file's writer stays until here for its report
+    h264_writer_cleanup(&impl->writer);
+    h264_writer_config_t writer = { config->width, config->height, config->fps, config->keyframe_interval,
+                                    config->matrix, config->range };
+    if (h264_writer_init(&impl->writer, &writer) != 0) return -1;
+
+    // Changed macroblocks go out uncompressed; let a fragment hold a few pictures of them
+    size_t picture = color_frame_size(COLOR_FORMAT_NV12, config->width, config->height);
+    if (h264_open_muxer(backend, config, picture * 8 + FMP4_DEFAULT_MAX_BUFFERED) != 0) {
+        h264_writer_cleanup(&impl->writer);
+        return -1;
+    }
+    return 0;
+}
+
+static int h264_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    const encoder_backend_config_t* config = &backend->config;
+    if (frame_pool_frame_size(pool) < color_frame_size(COLOR_FORMAT_NV12, config->width, config->height)) return -1;
+
+    color_planes_t planes;
+    const uint8_t* data;
+    size_t size;
+    color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(pool, frame), config->width, config->height, &planes);
+    if (h264_writer_encode(&impl->writer, &planes, 0, &data, &size, NULL) != 0) return -1;
+    return h264_write(backend, data, size, time);
+}
+
+static int h264_repeat_video(encoder_backend_t* backend, int64_t time) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    const uint8_t* data;
+    size_t size;
+    if (h264_writer_repeat(&impl->writer, &data, &size, NULL) != 0) return -1;
+    return h264_write(backend, data, size, time);
+}
+
+static int h264_finalize(encoder_backend_t* backend) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!impl->muxer_open) return 0;
+    int result = fmp4_muxer_finish(&impl->muxer);
+    if (result != 0) fprintf(stderr, "H264: Failed to finish %s\n", backend->path);
+    h264_close_muxer(impl);
+    return result;
+}
+
+static void h264_report(encoder_backend_t* backend, encoder_backend_report_fn report) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    h264_writer_report(&impl->writer, report);
+}
+
+static void h264_destroy(encoder_backend_t* backend) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!impl) return;
+    h264_close_muxer(impl);
+    h264_writer_cleanup(&impl->writer);
+    free(impl);
+    backend->impl = NULL;
+}
+
+static const encoder_backend_ops_t h264_ops = {
+    "h264",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_NV12),
+    0,
+    h264_init,
+    h264_push_video,
+    h264_repeat_video,
+    h264_push_audio,
+    h264_flush,
+    h264_finalize,
+    h264_stats,
+    h264_report,
+    h264_destroy
+};
+
+int h264_backend_create(encoder_backend_t* backend) {
+    return h264_create_impl(backend, &h264_ops) ? 0 : -1;
+}
+
+// ---------------------------------------------------------------------------
+// libx264
+// ---------------------------------------------------------------------------
+
+#ifdef MUXSW_HAVE_X264
+
+static void x264_release_last(h264_backend_t* impl) {
+    if (impl->last_pool && impl->last != FRAME_HANDLE_INVALID) frame_pool_release(impl->last_pool, impl->last);
+    impl->last_pool = NULL;
+    impl->last = FRAME_HANDLE_INVALID;
+}
+
+static int x264_backend_init(encoder_backend_t* backend, const encoder_backend_config_t* config) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!config->video) return -1;
+
+    // No B-frames or lookahead: each picture comes out of the call that took it
+    x264_param_t param;
+    if (x264_param_default_preset(&param, "veryfast", "zerolatency") < 0) return -1;
+    param.i_width = config->width;
+    param.i_height = config->height;
+    param.i_csp = X264_CSP_NV12;
+    param.i_fps_num = (uint32_t)config->fps;
+    param.i_fps_den = 1;
+    param.i_timebase_num = 1;
+    param.i_timebase_den = (uint32_t)ENCODER_BACKEND_UNITS_PER_SECOND;
+    param.b_vfr_input = config->timing == FRAME_TIMING_VFR;
+    param.i_keyint_max = config->keyframe_interval > 0 ? config->keyframe_interval : 2 * config->fps;
+    param.b_repeat_headers = 1;
+    param.b_annexb = 1;
+    param.vui.b_fullrange = config->range == COLOR_RANGE_FULL;
+    // 1 = BT.709, 6 = SMPTE 170M (BT.601), as h264_writer signals them
+    param.vui.i_colorprim = config->matrix == COLOR_MATRIX_BT709 ? 1 : 6;
+    param.vui.i_transfer = param.vui.i_colorprim;
+    param.vui.i_colmatrix = param.vui.i_colorprim;
+    if (x264_param_apply_profile(&param, "high") < 0) return -1;
+
+    impl->x264 = x264_encoder_open(&param);
+    if (!impl->x264) {
+        fprintf(stderr, "X264: Failed to open the encoder for %dx%d\n", config->width, config->height);
+        return -1;
+    }
+    if (h264_open_muxer(backend, config, 0) != 0) {
+        x264_encoder_close(impl->x264);
+        impl->x264 = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int x264_backend_encode(encoder_backend_t* backend, x264_picture_t* input) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    x264_nal_t* nals;
+    int count;
+    x264_picture_t output;
+    int size = x264_encoder_encode(impl->x264, &nals, &count, input, &output);
+    if (size < 0) return -1;
+    // The NAL payloads of one picture are contiguous, start codes included
+    return size > 0 ? h264_write(backend, nals[0].p_payload, (size_t)size, (int64_t)output.i_pts) : 0;
+}
+
+static int x264_backend_picture(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    const encoder_backend_config_t* config = &backend->config;
+    color_planes_t planes;
+    color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(pool, frame), config->width, config->height, &planes);
+
+    x264_picture_t picture;
+    x264_picture_init(&picture);
+    picture.img.i_csp = X264_CSP_NV12;
+    picture.img.i_plane = 2;
+    picture.img.plane[0] = planes.planes[0];
+    picture.img.i_stride[0] = (int)planes.pitches[0];
+    picture.img.plane[1] = planes.planes[1];
+    picture.img.i_stride[1] = (int)planes.pitches[1];
+    picture.i_pts = time;
+    return x264_backend_encode(backend, &picture);
+}
+
+static int x264_backend_push_video(encoder_backend_t* backend, frame_pool_t* pool, frame_handle_t frame, int64_t time) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    const encoder_backend_config_t* config = &backend->config;
+    if (frame_pool_frame_size(pool) < color_frame_size(COLOR_FORMAT_NV12, config->width, config->height)) return -1;
+    if (x264_backend_picture(backend, pool, frame, time) != 0) return -1;
+    frame_pool_addref(pool, frame);
+    x264_release_last(impl);
+    impl->last_pool = pool;
+    impl->last = frame;
+    return 0;
+}
+
+static int x264_backend_repeat_video(encoder_backend_t* backend, int64_t time) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!impl->last_pool) return -1;
+    return x264_backend_picture(backend, impl->last_pool, impl->last, time);
+}
+
+static int x264_backend_finalize(encoder_backend_t* backend) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    int result = 0;
+    while (result == 0 && x264_encoder_delayed_frames(impl->x264) > 0) {
+        result = x264_backend_encode(backend, NULL);
+    }
+    if (result == 0 && impl->muxer_open) result = fmp4_muxer_finish(&impl->muxer);
+    if (result != 0) fprintf(stderr, "X264: Failed to finish %s\n", backend->path);
+    h264_close_muxer(impl);
+    x264_release_last(impl);
+    x264_encoder_close(impl->x264);
+    impl->x264 = NULL;
+    return result;
+}
+
+static void x264_backend_destroy(encoder_backend_t* backend) {
+    h264_backend_t* impl = (h264_backend_t*)backend->impl;
+    if (!impl) return;
+    h264_close_muxer(impl);
+    x264_release_last(impl);
+    if (impl->x264) x264_encoder_close(impl->x264);
+    free(impl);
+    backend->impl = NULL;
+}
+
+static const encoder_backend_ops_t x264_ops = {
+    "x264",
+    ENCODER_FORMAT_BIT(ENCODER_INPUT_NV12),
+    0,
+    x264_backend_init,
+    x264_backend_push_video,
+    x264_backend_repeat_video,
+    h264_push_audio,
+    h264_flush,
+    x264_backend_finalize,
+    h264_stats,
+    NULL,
+    x264_backend_destroy
+};
+
+int x264_backend_create(encoder_backend_t* backend) {
+    h264_backend_t* impl = h264_create_impl(backend, &x264_ops);
+    if (!impl) return -1;
+    impl->last = FRAME_HANDLE_INVALID;
+    return 0;
+}
+
+#else
+
+int x264_backend_create(encoder_backend_t* backend) {
+    if (backend) memset(backend, 0, sizeof(encoder_backend_t));
+    fprintf(stderr, "X264: This build has no libx264; use the h264 encoder\n");
+    return -1;
+}
+
+#endif // MUXSW_HAVE_X264
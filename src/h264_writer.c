@@ -0,0 +1,430 @@
+#include "h264_writer.h"
+#include "elementary_stream.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define H264_NAL_REF_IDC 3
+#define H264_PROFILE_BASELINE 66
+#define H264_CONSTRAINED_BASELINE 0xC0  // constraint_set0 and constraint_set1
+#define H264_LOG2_MAX_FRAME_NUM 4
+#define H264_SLICE_TYPE_P 5             // 5 and 7: every slice of the picture has this type
+#define H264_SLICE_TYPE_I 7
+#define H264_MB_TYPE_I_PCM_IN_I 25
+#define H264_MB_TYPE_I_PCM_IN_P 30      // Intra types follow the five P types
+#define H264_PCM_BYTES 384              // 256 luma + 2 * 64 chroma samples
+
+typedef enum {
+    H264_PICTURE_IDR,                   // Every macroblock coded
+    H264_PICTURE_CHANGES,               // Changed macroblocks coded, the rest skipped
+    H264_PICTURE_SKIP                   // Every macroblock skipped
+} h264_picture_mode_t;
+
+// Table A-1: max macroblocks per second and per frame
+static const struct {
+    int level_idc;
+    long max_mbps;
+    long max_fs;
+} h264_levels[] = {
+    { 10, 1485, 99 }, { 11, 3000, 396 }, { 12, 6000, 396 }, { 13, 11880, 396 },
+    { 20, 11880, 396 }, { 21, 19800, 792 }, { 22, 20250, 1620 }, { 30, 40500, 1620 },
+    { 31, 108000, 3600 }, { 32, 216000, 5120 }, { 40, 245760, 8192 }, { 42, 522240, 8704 },
+    { 50, 589824, 22080 }, { 51, 983040, 36864 }, { 52, 2073600, 36864 }, { 60, 4177920, 139264 },
+    { 61, 8355840, 139264 }, { 62, 16711680, 139264 }
+};
+
+// Smallest level whose frame size and macroblock rate fit, each side within sqrt(8 * MaxFS).
+// Bit rate is left out: I_PCM pictures exceed every level's, and decoders do not enforce it.
+static int h264_pick_level(int mb_width, int mb_height, int fps) {
+    long frame_mbs = (long)mb_width * mb_height;
+    int count = (int)(sizeof(h264_levels) / sizeof(h264_levels[0]));
+    for (int i = 0; i < count; i++) {
+        long max_fs = h264_levels[i].max_fs;
+        if (frame_mbs <= max_fs && frame_mbs * fps <= h264_levels[i].max_mbps &&
+            (long)mb_width * mb_width <= 8 * max_fs && (long)mb_height * mb_height <= 8 * max_fs) {
+            return h264_levels[i].level_idc;
+        }
+    }
+    return h264_levels[count - 1].level_idc;
+}
+
+// ---------------------------------------------------------------------------
+// Bit writing into the RBSP buffer
+// ---------------------------------------------------------------------------
+
+static void h264_put_bits(h264_writer_t* writer, uint32_t value, int count) {
+    writer->bits = (writer->bits << count) | (value & (count < 32 ? ((1u << count) - 1) : 0xFFFFFFFFu));
+    writer->bit_count += count;
+    while (writer->bit_count >= 8) {
+        writer->bit_count -= 8;
+        mp4_put_u8(&writer->rbsp, (uint8_t)(writer->bits >> writer->bit_count));
+    }
+}
+
+static void h264_put_flag(h264_writer_t* writer, int flag) {
+    h264_put_bits(writer, flag ? 1 : 0, 1);
+}
+
+// Exp-Golomb ue(v): length - 1 zeros, then value + 1 in length bits
+static void h264_put_ue(h264_writer_t* writer, uint32_t value) {
+    uint32_t code = value + 1;
+    int length = 0;
+    while ((code >> length) > 1) length++;
+    h264_put_bits(writer, 0, length);
+    h264_put_bits(writer, code, length + 1);
+}
+
+static void h264_put_se(h264_writer_t* writer, int32_t value) {
+    h264_put_ue(writer, value > 0 ? (uint32_t)value * 2 - 1 : (uint32_t)(-value) * 2);
+}
+
+// Zero bits up to the next byte boundary
+static void h264_align(h264_writer_t* writer) {
+    if (writer->bit_count > 0) h264_put_bits(writer, 0, 8 - writer->bit_count);
+}
+
+static void h264_put_trailing_bits(h264_writer_t* writer) {
+    h264_put_bits(writer, 1, 1);
+    h264_align(writer);
+}
+
+static void h264_begin_rbsp(h264_writer_t* writer) {
+    mp4_buffer_reset(&writer->rbsp);
+    writer->bits = 0;
+    writer->bit_count = 0;
+}
+
+// Append the RBSP to the access unit as a NAL unit: start code, header, and
+// an emulation prevention byte wherever two zeros precede a byte <= 3
+static int h264_end_nal(h264_writer_t* writer, int nal_type) {
+    const mp4_buffer_t* rbsp = &writer->rbsp;
+    mp4_buffer_t* output = &writer->output;
+    if (rbsp->failed || mp4_buffer_reserve(output, output->size + 5 + rbsp->size + rbsp->size / 2) != 0) {
+        fprintf(stderr, "H264: Out of memory\n");
+        return -1;
+    }
+    uint8_t* dst = output->data + output->size;
+    *dst++ = 0;
+    *dst++ = 0;
+    *dst++ = 0;
+    *dst++ = 1;
+    *dst++ = (uint8_t)(H264_NAL_REF_IDC << 5 | nal_type);
+    int zeros = 0;
+    for (size_t i = 0; i < rbsp->size; i++) {
+        uint8_t byte = rbsp->data[i];
+        if (zeros == 2 && byte <= 3) {
+            *dst++ = 3;
+            zeros = 0;
+        }
+        *dst++ = byte;
+        zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    output->size = (size_t)(dst - output->data);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Parameter sets
+// ---------------------------------------------------------------------------
+
+static void h264_write_vui(h264_writer_t* writer) {
+    int bt709 = writer->config.matrix == COLOR_MATRIX_BT709;
+    h264_put_flag(writer, 0);               // aspect_ratio_info_present_flag
+    h264_put_flag(writer, 0);               // overscan_info_present_flag
+    h264_put_flag(writer, 1);               // video_signal_type_present_flag
+    h264_put_bits(writer, 5, 3);            // video_format: unspecified
+    h264_put_flag(writer, writer->config.range == COLOR_RANGE_FULL);
+    h264_put_flag(writer, 1);               // colour_description_present_flag
+    h264_put_bits(writer, bt709 ? 1 : 6, 8); // colour_primaries: BT.709 or SMPTE 170M
+    h264_put_bits(writer, bt709 ? 1 : 6, 8); // transfer_characteristics
+    h264_put_bits(writer, bt709 ? 1 : 6, 8); // matrix_coefficients
+    h264_put_flag(writer, 0);               // chroma_loc_info_present_flag
+    h264_put_flag(writer, 0);               // timing_info_present_flag: the container has the times
+    h264_put_flag(writer, 0);               // nal_hrd_parameters_present_flag
+    h264_put_flag(writer, 0);               // vcl_hrd_parameters_present_flag
+    h264_put_flag(writer, 0);               // pic_struct_present_flag
+    h264_put_flag(writer, 1);               // bitstream_restriction_flag
+    h264_put_flag(writer, 1);               // motion_vectors_over_pic_boundaries_flag
+    h264_put_ue(writer, 0);                 // max_bytes_per_pic_denom
+    h264_put_ue(writer, 0);                 // max_bits_per_mb_denom
+    h264_put_ue(writer, 15);                // log2_max_mv_length_horizontal
+    h264_put_ue(writer, 15);                // log2_max_mv_length_vertical
+    h264_put_ue(writer, 0);                 // max_num_reorder_frames: output at once
+    h264_put_ue(writer, 1);                 // max_dec_frame_buffering
+}
+
+static int h264_write_sps(h264_writer_t* writer) {
+    int crop_right = writer->mb_width * 16 - writer->config.width;
+    int crop_bottom = writer->mb_height * 16 - writer->config.height;
+    h264_begin_rbsp(writer);
+    h264_put_bits(writer, H264_PROFILE_BASELINE, 8);
+    h264_put_bits(writer, H264_CONSTRAINED_BASELINE, 8);
+    h264_put_bits(writer, (uint32_t)writer->level_idc, 8);
+    h264_put_ue(writer, 0);                 // seq_parameter_set_id
+    h264_put_ue(writer, H264_LOG2_MAX_FRAME_NUM - 4);
+    h264_put_ue(writer, 2);                 // pic_order_cnt_type: output order is decode order
+    h264_put_ue(writer, 1);                 // max_num_ref_frames
+    h264_put_flag(writer, 0);               // gaps_in_frame_num_value_allowed_flag
+    h264_put_ue(writer, (uint32_t)writer->mb_width - 1);
+    h264_put_ue(writer, (uint32_t)writer->mb_height - 1);
+    h264_put_flag(writer, 1);               // frame_mbs_only_flag
+    h264_put_flag(writer, 1);               // direct_8x8_inference_flag
+    h264_put_flag(writer, crop_right || crop_bottom);
+    if (crop_right || crop_bottom) {
+        // In chroma sample pairs for 4:2:0 frames
+        h264_put_ue(writer, 0);
+        h264_put_ue(writer, (uint32_t)crop_right / 2);
+        h264_put_ue(writer, 0);
+        h264_put_ue(writer, (uint32_t)crop_bottom / 2);
+    }
+    h264_put_flag(writer, 1);               // vui_parameters_present_flag
+    h264_write_vui(writer);
+    h264_put_trailing_bits(writer);
+    return h264_end_nal(writer, H264_NAL_SPS);
+}
+
+static int h264_write_pps(h264_writer_t* writer) {
+    h264_begin_rbsp(writer);
+    h264_put_ue(writer, 0);                 // pic_parameter_set_id
+    h264_put_ue(writer, 0);                 // seq_parameter_set_id
+    h264_put_flag(writer, 0);               // entropy_coding_mode_flag: CAVLC
+    h264_put_flag(writer, 0);               // bottom_field_pic_order_in_frame_present_flag
+    h264_put_ue(writer, 0);                 // num_slice_groups_minus1
+    h264_put_ue(writer, 0);                 // num_ref_idx_l0_default_active_minus1
+    h264_put_ue(writer, 0);                 // num_ref_idx_l1_default_active_minus1
+    h264_put_flag(writer, 0);               // weighted_pred_flag
+    h264_put_bits(writer, 0, 2);            // weighted_bipred_idc
+    h264_put_se(writer, 0);                 // pic_init_qp_minus26
+    h264_put_se(writer, 0);                 // pic_init_qs_minus26
+    h264_put_se(writer, 0);                 // chroma_qp_index_offset
+    h264_put_flag(writer, 1);               // deblocking_filter_control_present_flag
+    h264_put_flag(writer, 0);               // constrained_intra_pred_flag
+    h264_put_flag(writer, 0);               // redundant_pic_cnt_present_flag
+    h264_put_trailing_bits(writer);
+    return h264_end_nal(writer, H264_NAL_PPS);
+}
+
+// ---------------------------------------------------------------------------
+// Pictures
+// ---------------------------------------------------------------------------
+
+// Copy an NV12 picture into a padded buffer, repeating the last column and row
+static void h264_load_picture(h264_writer_t* writer, const color_planes_t* picture) {
+    int width = writer->config.width;
+    int height = writer->config.height;
+    size_t pitch = writer->luma_pitch;
+    int padded_width = writer->mb_width * 16;
+    int padded_height = writer->mb_height * 16;
+    for (int plane = 0; plane < 2; plane++) {
+        uint8_t* dst = writer->current + (plane ? writer->luma_size : 0);
+        int rows = plane ? height / 2 : height;
+        int padded_rows = plane ? padded_height / 2 : padded_height;
+        int step = plane ? 2 : 1;               // Bytes per sample position: interleaved UV pairs
+        for (int y = 0; y < rows; y++) {
+            uint8_t* row = dst + (size_t)y * pitch;
+            memcpy(row, picture->planes[plane] + (size_t)y * picture->pitches[plane], (size_t)width);
+            for (int x = width; x < padded_width; x += step) memcpy(row + x, row + width - step, (size_t)step);
+        }
+        for (int y = rows; y < padded_rows; y++) {
+            memcpy(dst + (size_t)y * pitch, dst + (size_t)(rows - 1) * pitch, pitch);
+        }
+    }
+}
+
+static int h264_macroblock_changed(const h264_writer_t* writer, int mb_x, int mb_y) {
+    size_t pitch = writer->luma_pitch;
+    size_t offset = (size_t)mb_y * 16 * pitch + (size_t)mb_x * 16;
+    for (int y = 0; y < 16; y++) {
+        if (memcmp(writer->current + offset + (size_t)y * pitch, writer->reference + offset + (size_t)y * pitch, 16) != 0) {
+            return 1;
+        }
+    }
+    offset = writer->luma_size + (size_t)mb_y * 8 * pitch + (size_t)mb_x * 16;
+    for (int y = 0; y < 8; y++) {
+        if (memcmp(writer->current + offset + (size_t)y * pitch, writer->reference + offset + (size_t)y * pitch, 16) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// I_PCM samples: the 16x16 luma block, then the 8x8 Cb and Cr blocks
+static void h264_put_pcm(h264_writer_t* writer, const uint8_t* picture, int mb_x, int mb_y) {
+    size_t pitch = writer->luma_pitch;
+    uint8_t samples[H264_PCM_BYTES];
+    const uint8_t* luma = picture + (size_t)mb_y * 16 * pitch + (size_t)mb_x * 16;
+    for (int y = 0; y < 16; y++) memcpy(samples + y * 16, luma + (size_t)y * pitch, 16);
+    const uint8_t* chroma = picture + writer->luma_size + (size_t)mb_y * 8 * pitch + (size_t)mb_x * 16;
+    for (int y = 0; y < 8; y++) {
+        const uint8_t* row = chroma + (size_t)y * pitch;
+        for (int x = 0; x < 8; x++) {
+            samples[256 + y * 8 + x] = row[x * 2];
+            samples[320 + y * 8 + x] = row[x * 2 + 1];
+        }
+    }
+    mp4_put_bytes(&writer->rbsp, samples, sizeof(samples));
+}
+
+static int h264_write_slice(h264_writer_t* writer, const uint8_t* picture, h264_picture_mode_t mode) {
+    int idr = mode == H264_PICTURE_IDR;
+    int total = writer->mb_width * writer->mb_height;
+    h264_begin_rbsp(writer);
+    if (mode != H264_PICTURE_SKIP && mp4_buffer_reserve(&writer->rbsp, (size_t)total * (H264_PCM_BYTES + 8) + 64) != 0) {
+        fprintf(stderr, "H264: Out of memory\n");
+        return -1;
+    }
+
+    h264_put_ue(writer, 0);                 // first_mb_in_slice
+    h264_put_ue(writer, idr ? H264_SLICE_TYPE_I : H264_SLICE_TYPE_P);
+    h264_put_ue(writer, 0);                 // pic_parameter_set_id
+    h264_put_bits(writer, idr ? 0 : (uint32_t)writer->frame_num, H264_LOG2_MAX_FRAME_NUM);
+    if (idr) {
+        h264_put_ue(writer, (uint32_t)writer->idr_pic_id);
+    } else {
+        h264_put_flag(writer, 0);           // num_ref_idx_active_override_flag
+        h264_put_flag(writer, 0);           // ref_pic_list_modification_flag_l0
+    }
+    if (idr) {
+        h264_put_flag(writer, 0);           // no_output_of_prior_pics_flag
+        h264_put_flag(writer, 0);           // long_term_reference_flag
+    } else {
+        h264_put_flag(writer, 0);           // adaptive_ref_pic_marking_mode_flag: sliding window
+    }
+    h264_put_se(writer, 0);                 // slice_qp_delta
+    h264_put_ue(writer, 1);                 // disable_deblocking_filter_idc: nothing to smooth in exact samples
+
+    // A P_Skip macroblock copies the reference: every motion vector in the
+    // stream is zero, so the predicted one for a skip is zero as well
+    uint32_t skip_run = 0;
+    uint64_t coded = 0;
+    for (int mb_y = 0; mb_y < writer->mb_height; mb_y++) {
+        for (int mb_x = 0; mb_x < writer->mb_width; mb_x++) {
+            if (mode == H264_PICTURE_SKIP || (mode == H264_PICTURE_CHANGES && !h264_macroblock_changed(writer, mb_x, mb_y))) {
+                skip_run++;
+                continue;
+            }
+            if (idr) {
+                h264_put_ue(writer, H264_MB_TYPE_I_PCM_IN_I);
+            } else {
+                h264_put_ue(writer, skip_run);
+                h264_put_ue(writer, H264_MB_TYPE_I_PCM_IN_P);
+                skip_run = 0;
+            }
+            h264_align(writer);
+            h264_put_pcm(writer, picture, mb_x, mb_y);
+            coded++;
+        }
+    }
+    if (skip_run > 0) h264_put_ue(writer, skip_run);
+    h264_put_trailing_bits(writer);
+
+    writer->stats.coded_macroblocks += coded;
+    writer->stats.skipped_macroblocks += (uint64_t)total - coded;
+    return h264_end_nal(writer, idr ? H264_NAL_IDR : H264_NAL_SLICE);
+}
+
+static int h264_code_picture(h264_writer_t* writer, const uint8_t* picture, h264_picture_mode_t mode,
+                             const uint8_t** data, size_t* size, int* keyframe) {
+    int idr = mode == H264_PICTURE_IDR;
+    mp4_buffer_reset(&writer->output);
+    if (idr && (h264_write_sps(writer) != 0 || h264_write_pps(writer) != 0)) return -1;
+    if (h264_write_slice(writer, picture, mode) != 0) return -1;
+
+    if (idr) {
+        writer->idr_pic_id = (writer->idr_pic_id + 1) & 0xFFFF;
+        writer->frame_num = 1;
+        writer->since_keyframe = 1;
+        writer->stats.keyframes++;
+    } else {
+        writer->frame_num = (writer->frame_num + 1) % (1 << H264_LOG2_MAX_FRAME_NUM);
+        writer->since_keyframe++;
+    }
+    writer->stats.pictures++;
+    writer->stats.bytes += writer->output.size;
+
+    *data = writer->output.data;
+    *size = writer->output.size;
+    if (keyframe) *keyframe = idr;
+    return 0;
+}
+
+int h264_writer_init(h264_writer_t* writer, const h264_writer_config_t* config) {
+    if (!writer || !config) return -1;
+    memset(writer, 0, sizeof(h264_writer_t));
+    if (config->width < 2 || config->height < 2 || (config->width | config->height) & 1 ||
+        config->width > H264_WRITER_MAX_DIMENSION || config->height > H264_WRITER_MAX_DIMENSION) {
+        fprintf(stderr, "H264: Unsupported picture size %dx%d\n", config->width, config->height);
+        return -1;
+    }
+    writer->config = *config;
+    if (writer->config.fps <= 0) writer->config.fps = 30;
+    if (writer->config.keyframe_interval <= 0) writer->config.keyframe_interval = writer->config.fps * 2;
+    writer->mb_width = (config->width + 15) / 16;
+    writer->mb_height = (config->height + 15) / 16;
+    writer->level_idc = h264_pick_level(writer->mb_width, writer->mb_height, writer->config.fps);
+    writer->luma_pitch = (size_t)writer->mb_width * 16;
+    writer->luma_size = writer->luma_pitch * writer->mb_height * 16;
+
+    size_t picture_size = writer->luma_size + writer->luma_size / 2;
+    writer->current = (uint8_t*)platform_aligned_alloc(picture_size, 64);
+    writer->reference = (uint8_t*)platform_aligned_alloc(picture_size, 64);
+    mp4_buffer_init(&writer->rbsp);
+    mp4_buffer_init(&writer->output);
+    if (!writer->current || !writer->reference) {
+        fprintf(stderr, "H264: Out of memory\n");
+        h264_writer_cleanup(writer);
+        return -1;
+    }
+    return 0;
+}
+
+void h264_writer_cleanup(h264_writer_t* writer) {
+    if (!writer) return;
+    platform_aligned_free(writer->current);
+    platform_aligned_free(writer->reference);
+    mp4_buffer_free(&writer->rbsp);
+    mp4_buffer_free(&writer->output);
+    memset(writer, 0, sizeof(h264_writer_t));
+}
+
+int h264_writer_encode(h264_writer_t* writer, const color_planes_t* picture, int force_keyframe,
+                       const uint8_t** data, size_t* size, int* keyframe) {
+    if (!writer || !writer->current || !picture || !picture->planes[0] || !picture->planes[1] || !data || !size) {
+        return -1;
+    }
+    int idr = force_keyframe || !writer->has_reference || writer->since_keyframe >= writer->config.keyframe_interval;
+    h264_load_picture(writer, picture);
+    if (h264_code_picture(writer, writer->current, idr ? H264_PICTURE_IDR : H264_PICTURE_CHANGES,
+                          data, size, keyframe) != 0) {
+        return -1;
+    }
+
+    // What was just coded is what the decoder now holds
+    uint8_t* previous = writer->reference;
+    writer->reference = writer->current;
+    writer->current = previous;
+    writer->has_reference = 1;
+    return 0;
+}
+
+int h264_writer_repeat(h264_writer_t* writer, const uint8_t** data, size_t* size, int* keyframe) {
+    if (!writer || !writer->has_reference || !data || !size) return -1;
+    int idr = writer->since_keyframe >= writer->config.keyframe_interval;
+    return h264_code_picture(writer, writer->reference, idr ? H264_PICTURE_IDR : H264_PICTURE_SKIP,
+                             data, size, keyframe);
+}
+
+void h264_writer_report(const h264_writer_t* writer, h264_writer_report_fn report) {
+    if (!writer || !report) return;
+    const h264_writer_stats_t* stats = &writer->stats;
+    uint64_t macroblocks = stats->coded_macroblocks + stats->skipped_macroblocks;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "H264: %llu pictures (%llu IDR), level %d.%d, %.1f%% of macroblocks skipped, %.1f MB",
+             (unsigned long long)stats->pictures, (unsigned long long)stats->keyframes,
+             writer->level_idc / 10, writer->level_idc % 10,
+             macroblocks ? stats->skipped_macroblocks * 100.0 / macroblocks : 0.0,
+             stats->bytes / (1024.0 * 1024.0));
+    report(message);
+}
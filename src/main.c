@@ -1,12 +1,16 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "engine.h"
 #include "record.h"
 #include "params.h"
 #include "arguments.h"
+#include "worker_pool.h"
 #include "signals.h"
 #include "callbacks.h"
+#include "mp4_repair.h"
+#include "transcoder.h"
 
 // Global capture engine
 static capture_engine_t g_engine = {0};
@@ -21,7 +25,9 @@ void print_usage(const char* program_name) {
     printf("  -v, --video            Enable video capture\n");
     printf("  -s, --system           Enable system audio capture\n");
     printf("  -m, --microphone       Enable microphone capture\n");
-    printf("  --fps <rate>           Frame rate (default: 30)\n");
+    printf("  --fps <rate>           Frame rate, up to 240 (default: 30)\n");
+    printf("  --repair <in> [out]    Rebuild a playable file from a recording cut short\n");
+    printf("  --transcode <in> [out] Encode a capture spool or raw frame file to MP4\n");
     printf("  -h, --help             Show this help message\n");
     printf("\nNotes:\n");
     printf("  - Default: Video + both audio (MP4) unlimited time and 30 FPS\n");
@@ -31,10 +37,145 @@ void print_usage(const char* program_name) {
 
 // Note: Console callback functions are now in callbacks.c module
 
+static void repair_report(const char* message) {
+    printf("%s\n", message);
+}
+
+// muxsw --repair <input> [output]: salvage a recording that was never finalized
+static int run_repair(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "Usage: %s --repair <input.mp4> [output.mp4]\n", argv[0]);
+        return 1;
+    }
+    
+    // Default output: the input name with -repaired before the extension
+    char output[MAX_PATH];
+    const char* input = argv[2];
+    if (argc == 4) {
+        snprintf(output, sizeof(output), "%s", argv[3]);
+    } else {
+        const char* dot = strrchr(input, '.');
+        const char* slash = strrchr(input, '\\');
+        if (!dot || (slash && dot < slash)) dot = input + strlen(input);
+        snprintf(output, sizeof(output), "%.*s-repaired%s", (int)(dot - input), input, dot);
+    }
+    
+    mp4_repair_result_t result;
+    if (mp4_repair_file(input, output, &result) != 0) {
+        fprintf(stderr, "Could not repair %s\n", input);
+        return 1;
+    }
+    mp4_repair_report(&result, repair_report);
+    printf("Saved to: %s\n", output);
+    return 0;
+}
+
+// muxsw --transcode <input> [output] [options]: encode a spool or raw frame file offline
+static int run_transcode(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s --transcode <input.spool|input.raw> [output.mp4] [--scale f] [--output-size WxH]\n"
+                        "       [--threads n] [--fps n] [--color-matrix bt709|bt601] [--color-range limited|full] [--follow]\n"
+                        "       [--encoder h264|x264|null]\n", argv[0]);
+        return 1;
+    }
+    
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    config.input = argv[2];
+    config.progress = repair_report;
+    const char* output_arg = NULL;
+    for (int i = 3; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--scale") == 0 && value) {
+            config.scale = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--output-size") == 0 && value) {
+            if (sscanf(value, "%dx%d", &config.width, &config.height) != 2) {
+                fprintf(stderr, "Error: --output-size expects WIDTHxHEIGHT, e.g. 1920x1080\n");
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            config.threads = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--fps") == 0 && value) {
+            config.fps = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--color-matrix") == 0 && value) {
+            if (strcmp(value, "bt709") == 0) {
+                config.matrix = COLOR_MATRIX_BT709;
+            } else if (strcmp(value, "bt601") == 0) {
+                config.matrix = COLOR_MATRIX_BT601;
+            } else {
+                fprintf(stderr, "Error: Invalid color matrix '%s'. Use bt709 or bt601\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--color-range") == 0 && value) {
+            if (strcmp(value, "limited") == 0) {
+                config.range = COLOR_RANGE_LIMITED;
+            } else if (strcmp(value, "full") == 0) {
+                config.range = COLOR_RANGE_FULL;
+            } else {
+                fprintf(stderr, "Error: Invalid color range '%s'. Use limited or full\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--encoder") == 0 && value) {
+            if (encoder_backend_parse(value, &config.encoder) != 0) {
+                fprintf(stderr, "Error: Invalid encoder '%s'. Use h264, x264 or null\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--follow") == 0) {
+            config.follow = 1;
+        } else if (argv[i][0] != '-' && !output_arg) {
+            output_arg = argv[i];
+        } else {
+            fprintf(stderr, "Error: Unknown or incomplete transcode option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (config.scale < 0.0 || config.scale > 1.0 || config.width < 0 || config.height < 0 ||
+        config.threads < 0 || config.threads > WORKER_POOL_MAX_THREADS || config.fps < 0 || config.fps > CAPTURE_MAX_FPS) {
+        fprintf(stderr, "Error: Invalid transcode option\n");
+        return 1;
+    }
+    
+    // Default output: the input name with .mp4 in place of its extension
+    char output[MAX_PATH];
+    if (output_arg) {
+        snprintf(output, sizeof(output), "%s", output_arg);
+    } else {
+        const char* input = config.input;
+        const char* dot = strrchr(input, '.');
+        const char* slash = strrchr(input, '\\');
+        if (!dot || (slash && dot < slash)) dot = input + strlen(input);
+        snprintf(output, sizeof(output), "%.*s.mp4", (int)(dot - input), input);
+    }
+    config.output = output;
+    
+    transcode_stats_t stats;
+    if (transcode_file(&config, &stats) != 0) {
+        fprintf(stderr, "Could not transcode %s\n", config.input);
+        return 1;
+    }
+    transcode_report(&stats, repair_report);
+    printf("Saved to: %s\n", output);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     // Initialize default parameters and parse arguments using modular components
     capture_params_t params;
     
+    if (argc >= 2 && strcmp(argv[1], "--repair") == 0) {
+        return run_repair(argc, argv);
+    }
+    if (argc >= 2 && strcmp(argv[1], "--transcode") == 0) {
+        return run_transcode(argc, argv);
+    }
+    
     // Parse command line arguments using modular parser
     int parse_result = arguments_parse(argc, argv, &params);
     if (parse_result != 0) {
@@ -54,13 +195,47 @@ int main(int argc, char* argv[]) {
     printf("Output file: %s\n", params.output_filename);
     if (!params.audio_only_mode) {
         printf("FPS: %d\n", params.fps);
-        printf("Monitor: %d\n", params.monitor_index);
+        if (params.capture_source == CAPTURE_SOURCE_SYNTHETIC) {
+            printf("Source: synthetic %s %dx%d\n", synthetic_pattern_name(params.synthetic_pattern),
+                   params.source_width, params.source_height);
+        } else if (params.capture_source == CAPTURE_SOURCE_REPLAY) {
+            printf("Source: replay %s%s\n", params.replay_filename, params.replay_loop ? " (looped)" : "");
+        } else if (params.virtual_desktop) {
+            printf("Monitor: all (virtual desktop)\n");
+        } else {
+            printf("Monitor: %d\n", params.monitor_index);
+        }
         printf("Cursor: %s\n", params.cursor_enabled ? "Enabled" : "Disabled");
         if (params.region_enabled) {
             printf("Region: %d,%d %dx%d\n", params.region_x, params.region_y, params.region_w, params.region_h);
         } else {
             printf("Region: Full screen\n");
         }
+        if (params.output_scale > 0.0) {
+            printf("Output: %.2fx capture size\n", params.output_scale);
+        } else if (params.output_width > 0 || params.output_height > 0) {
+            printf("Output: %dx%d\n", params.output_width, params.output_height);
+        }
+        if (params.encode_nv12) {
+            printf("Pixel format: NV12 (%s, %s range)\n", color_matrix_name(params.color_matrix),
+                   color_range_name(params.color_range));
+        } else {
+            printf("Pixel format: BGRA\n");
+        }
+        printf("Frame rate: %s%s\n", params.variable_frame_rate ? "variable" : "constant",
+               params.change_detection ? ", unchanged frames skipped" : "");
+        if (params.encoder_backend == ENCODER_BACKEND_SPOOL) {
+            printf("Container: capture spool (encode later)\n");
+        } else if (params.encoder_backend != ENCODER_BACKEND_MEDIA_FOUNDATION) {
+            printf("Encoder: %s\n", encoder_backend_kind_name(params.encoder_backend));
+        } else {
+            printf("Container: %s\n", params.fragmented_output ? "fragmented MP4" : "MP4 (finalized at stop)");
+        }
+        if (params.worker_threads > 0) {
+            printf("Threads: %d\n", params.worker_threads);
+        } else {
+            printf("Threads: auto (%d CPUs)\n", platform_cpu_count());
+        }
     }
     
 #ifdef MUXSW_ENABLE_AUDIO
@@ -69,6 +244,9 @@ int main(int argc, char* argv[]) {
     else if (params.audio_sources == AUDIO_SOURCE_MICROPHONE) audio_desc = "Microphone";
     else if (params.audio_sources == AUDIO_SOURCE_BOTH) audio_desc = "System + Microphone";
     printf("Audio: %s\n", audio_desc);
+    if (params.audio_sources != AUDIO_SOURCE_NONE) {
+        printf("Audio buffer: %d ms\n", params.audio_buffer_ms);
+    }
 #else
     printf("Audio: Disabled (MVP)\n");
 #endif
@@ -76,7 +254,18 @@ int main(int argc, char* argv[]) {
     if (params.duration > 0) {
         printf("Duration: %d seconds\n", params.duration);
     } else {
-        printf("Duration: Unlimited (press Ctrl+C to stop)\n");
+        printf("Duration: %s\n", params_is_capped(&params) ?
+               "Unlimited, stopped after 60 s as a safety net (use --time for longer)" : "Unlimited (press Ctrl+C to stop)");
+    }
+    if (params.segment_time > 0 || params.segment_size > 0) {
+        printf("Segments: every");
+        if (params.segment_time > 0) printf(" %d s", params.segment_time);
+        if (params.segment_time > 0 && params.segment_size > 0) printf(" or");
+        if (params.segment_size > 0) printf(" %llu MB", params.segment_size / (1024 * 1024));
+        printf(", at the next keyframe\n");
+    }
+    if (params.replay_seconds > 0) {
+        printf("Replay buffer: last %d s in memory, press Ctrl+Break to save them\n", params.replay_seconds);
     }
     printf("Press Ctrl+C to stop recording.\n\n");
 
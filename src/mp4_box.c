@@ -0,0 +1,186 @@
+#include "mp4_box.h"
+#include <stdlib.h>
+#include <string.h>
+
+void mp4_buffer_init(mp4_buffer_t* buffer) {
+    if (!buffer) return;
+    memset(buffer, 0, sizeof(mp4_buffer_t));
+}
+
+void mp4_buffer_free(mp4_buffer_t* buffer) {
+    if (!buffer) return;
+    free(buffer->data);
+    memset(buffer, 0, sizeof(mp4_buffer_t));
+}
+
+void mp4_buffer_reset(mp4_buffer_t* buffer) {
+    if (!buffer) return;
+    buffer->size = 0;
+    buffer->failed = 0;
+}
+
+int mp4_buffer_reserve(mp4_buffer_t* buffer, size_t size) {
+    if (!buffer || buffer->failed) return -1;
+    if (size <= buffer->capacity) return 0;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 256;
+    while (capacity < size) {
+        if (capacity > (size_t)-1 / 2) {
+            capacity = size;
+            break;
+        }
+        capacity *= 2;
+    }
+    uint8_t* data = (uint8_t*)realloc(buffer->data, capacity);
+    if (!data) {
+        buffer->failed = 1;
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+// Room for count more bytes, or NULL once the buffer has failed
+static uint8_t* mp4_buffer_extend(mp4_buffer_t* buffer, size_t count) {
+    if (buffer->size + count < buffer->size || mp4_buffer_reserve(buffer, buffer->size + count) != 0) {
+        buffer->failed = 1;
+        return NULL;
+    }
+    uint8_t* dst = buffer->data + buffer->size;
+    buffer->size += count;
+    return dst;
+}
+
+static void mp4_store_be(uint8_t* dst, uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+        dst[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+static void mp4_put_be(mp4_buffer_t* buffer, uint64_t value, int bytes) {
+    uint8_t* dst = mp4_buffer_extend(buffer, (size_t)bytes);
+    if (dst) mp4_store_be(dst, value, bytes);
+}
+
+void mp4_put_u8(mp4_buffer_t* buffer, uint8_t value) {
+    mp4_put_be(buffer, value, 1);
+}
+
+void mp4_put_u16(mp4_buffer_t* buffer, uint16_t value) {
+    mp4_put_be(buffer, value, 2);
+}
+
+void mp4_put_u24(mp4_buffer_t* buffer, uint32_t value) {
+    mp4_put_be(buffer, value, 3);
+}
+
+void mp4_put_u32(mp4_buffer_t* buffer, uint32_t value) {
+    mp4_put_be(buffer, value, 4);
+}
+
+void mp4_put_u64(mp4_buffer_t* buffer, uint64_t value) {
+    mp4_put_be(buffer, value, 8);
+}
+
+void mp4_put_bytes(mp4_buffer_t* buffer, const void* data, size_t size) {
+    if (size == 0) return;
+    uint8_t* dst = mp4_buffer_extend(buffer, size);
+    if (dst) memcpy(dst, data, size);
+}
+
+void mp4_put_zeros(mp4_buffer_t* buffer, size_t count) {
+    if (count == 0) return;
+    uint8_t* dst = mp4_buffer_extend(buffer, count);
+    if (dst) memset(dst, 0, count);
+}
+
+size_t mp4_box_begin(mp4_buffer_t* buffer, uint32_t type) {
+    size_t offset = buffer->size;
+    mp4_put_u32(buffer, 0);
+    mp4_put_u32(buffer, type);
+    return offset;
+}
+
+size_t mp4_full_box_begin(mp4_buffer_t* buffer, uint32_t type, uint8_t version, uint32_t flags) {
+    size_t offset = mp4_box_begin(buffer, type);
+    mp4_put_u8(buffer, version);
+    mp4_put_u24(buffer, flags);
+    return offset;
+}
+
+void mp4_box_end(mp4_buffer_t* buffer, size_t offset) {
+    if (buffer->failed || offset + MP4_BOX_HEADER_SIZE > buffer->size) return;
+    mp4_patch_u32(buffer, offset, (uint32_t)(buffer->size - offset));
+}
+
+void mp4_patch_u32(mp4_buffer_t* buffer, size_t offset, uint32_t value) {
+    if (buffer->failed || offset + 4 > buffer->size) return;
+    mp4_store_be(buffer->data + offset, value, 4);
+}
+
+uint16_t mp4_read_u16(const uint8_t* data) {
+    return (uint16_t)(data[0] << 8 | data[1]);
+}
+
+uint32_t mp4_read_u24(const uint8_t* data) {
+    return (uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2];
+}
+
+uint32_t mp4_read_u32(const uint8_t* data) {
+    return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+}
+
+uint64_t mp4_read_u64(const uint8_t* data) {
+    return (uint64_t)mp4_read_u32(data) << 32 | mp4_read_u32(data + 4);
+}
+
+int mp4_box_parse(const uint8_t* data, size_t size, mp4_box_t* box) {
+    if (!data || !box || size < MP4_BOX_HEADER_SIZE) return -1;
+    memset(box, 0, sizeof(mp4_box_t));
+
+    uint64_t box_size = mp4_read_u32(data);
+    box->type = mp4_read_u32(data + 4);
+    box->header_size = MP4_BOX_HEADER_SIZE;
+    if (box_size == 1) {
+        if (size < MP4_LARGE_BOX_HEADER_SIZE) return -1;
+        box_size = mp4_read_u64(data + 8);
+        box->header_size = MP4_LARGE_BOX_HEADER_SIZE;
+    } else if (box_size == 0) {
+        box_size = size;
+    }
+    if (box_size < box->header_size) return -1;
+
+    box->size = box_size;
+    box->payload = data + box->header_size;
+    if (box_size > size) {
+        box->payload_size = size - box->header_size;
+        return 1;
+    }
+    box->payload_size = (size_t)(box_size - box->header_size);
+    return 0;
+}
+
+int mp4_box_next(const uint8_t* data, size_t size, size_t* offset, mp4_box_t* box) {
+    if (!data || !offset || *offset >= size) return 0;
+    if (mp4_box_parse(data + *offset, size - *offset, box) != 0) return -1;
+    *offset += (size_t)box->size;
+    return 1;
+}
+
+int mp4_box_find(const uint8_t* data, size_t size, uint32_t type, mp4_box_t* box) {
+    size_t offset = 0;
+    while (mp4_box_next(data, size, &offset, box) == 1) {
+        if (box->type == type) return 0;
+    }
+    return -1;
+}
+
+void mp4_fourcc_string(uint32_t type, char text[5]) {
+    for (int i = 0; i < 4; i++) {
+        char c = (char)(type >> (24 - i * 8));
+        text[i] = (c >= 32 && c < 127) ? c : '?';
+    }
+    text[4] = '\0';
+}
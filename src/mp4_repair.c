@@ -0,0 +1,461 @@
+#include "mp4_repair.h"
+#include "mp4_box.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MP4_REPAIR_CHUNK 65536
+
+#define TFHD_BASE_DATA_OFFSET 0x000001u
+#define TFHD_SAMPLE_DESCRIPTION 0x000002u
+#define TFHD_DEFAULT_DURATION 0x000008u
+#define TFHD_DEFAULT_SIZE 0x000010u
+#define TFHD_DEFAULT_BASE_IS_MOOF 0x020000u
+#define TRUN_DATA_OFFSET 0x000001u
+#define TRUN_FIRST_SAMPLE_FLAGS 0x000004u
+#define TRUN_DURATION 0x000100u
+#define TRUN_SIZE 0x000200u
+#define TRUN_FLAGS 0x000400u
+#define TRUN_COMPOSITION 0x000800u
+
+typedef struct {
+    FILE* input;
+    FILE* output;
+    mp4_repair_result_t* result;
+    mp4_buffer_t box;               // Current top-level box as read, header included
+    mp4_buffer_t moov;              // For trex defaults
+    mp4_buffer_t mdat;              // Payload of the fragment being checked
+    mp4_buffer_t rebuilt;           // Trimmed moof
+    uint64_t accepted;              // Input bytes covered by the output
+    int failed;                     // Output error
+} mp4_repair_t;
+
+typedef struct {
+    uint32_t type;
+    uint64_t size;                  // Whole box; 0 runs to the end of the file
+    size_t header_size;
+} repair_header_t;
+
+static size_t repair_read(mp4_repair_t* repair, void* data, size_t size) {
+    size_t got = fread(data, 1, size, repair->input);
+    repair->result->bytes_read += got;
+    return got;
+}
+
+static int repair_write(mp4_repair_t* repair, const void* data, size_t size) {
+    if (size == 0) return 0;
+    if (fwrite(data, 1, size, repair->output) != size) {
+        fprintf(stderr, "Repair: Write failed\n");
+        repair->failed = 1;
+        return -1;
+    }
+    repair->result->bytes_written += size;
+    return 0;
+}
+
+// Read a top-level box header into repair->box. Returns 1 for a header,
+// 0 at a clean end of file, -1 if the file ends inside the header.
+static int repair_read_header(mp4_repair_t* repair, repair_header_t* header) {
+    mp4_buffer_reset(&repair->box);
+    if (mp4_buffer_reserve(&repair->box, MP4_LARGE_BOX_HEADER_SIZE) != 0) return -1;
+    uint8_t* bytes = repair->box.data;
+
+    size_t got = repair_read(repair, bytes, MP4_BOX_HEADER_SIZE);
+    if (got == 0) return 0;
+    if (got < MP4_BOX_HEADER_SIZE) return -1;
+    header->type = mp4_read_u32(bytes + 4);
+    header->size = mp4_read_u32(bytes);
+    header->header_size = MP4_BOX_HEADER_SIZE;
+    if (header->size == 1) {
+        if (repair_read(repair, bytes + 8, 8) < 8) return -1;
+        header->size = mp4_read_u64(bytes + 8);
+        header->header_size = MP4_LARGE_BOX_HEADER_SIZE;
+    }
+    // Zero fill left by a crash reads as an empty type; nothing after it is a box
+    if ((header->size != 0 && header->size < header->header_size) || header->type == 0) return -1;
+    repair->box.size = header->header_size;
+    return 1;
+}
+
+// Append up to size bytes of input to a buffer; returns the bytes read
+static uint64_t repair_read_into(mp4_repair_t* repair, mp4_buffer_t* buffer, uint64_t size) {
+    uint64_t total = 0;
+    while (total < size) {
+        size_t chunk = size - total < MP4_REPAIR_CHUNK ? (size_t)(size - total) : MP4_REPAIR_CHUNK;
+        if (mp4_buffer_reserve(buffer, buffer->size + chunk) != 0) break;
+        size_t got = repair_read(repair, buffer->data + buffer->size, chunk);
+        buffer->size += got;
+        total += got;
+        if (got < chunk) break;
+    }
+    return total;
+}
+
+// Read the rest of a box whose header is in repair->box. Returns 0 when the
+// box is whole, 1 when the file ends first, -1 if it is too large to hold.
+static int repair_read_body(mp4_repair_t* repair, const repair_header_t* header) {
+    if (header->size == 0 || header->size > MP4_REPAIR_MAX_BOX) return -1;
+    uint64_t payload = header->size - header->header_size;
+    return repair_read_into(repair, &repair->box, payload) == payload ? 0 : 1;
+}
+
+// trex default_sample_size for a track, or 0
+static uint32_t repair_trex_default_size(const mp4_repair_t* repair, uint32_t track_id) {
+    mp4_box_t moov, mvex, trex;
+    size_t offset = 0;
+    if (mp4_box_parse(repair->moov.data, repair->moov.size, &moov) != 0 ||
+        mp4_box_find(moov.payload, moov.payload_size, MP4_FOURCC('m', 'v', 'e', 'x'), &mvex) != 0) {
+        return 0;
+    }
+    while (mp4_box_next(mvex.payload, mvex.payload_size, &offset, &trex) == 1) {
+        if (trex.type == MP4_FOURCC('t', 'r', 'e', 'x') && trex.payload_size >= 24 &&
+            mp4_read_u32(trex.payload + 4) == track_id) {
+            return mp4_read_u32(trex.payload + 16);
+        }
+    }
+    return 0;
+}
+
+// Samples described by a moof
+static uint64_t repair_count_samples(const uint8_t* moof, size_t moof_size) {
+    mp4_box_t box, traf, trun;
+    uint64_t samples = 0;
+    if (mp4_box_parse(moof, moof_size, &box) != 0) return 0;
+    size_t offset = 0;
+    while (mp4_box_next(box.payload, box.payload_size, &offset, &traf) == 1) {
+        if (traf.type != MP4_FOURCC('t', 'r', 'a', 'f')) continue;
+        size_t inner = 0;
+        while (mp4_box_next(traf.payload, traf.payload_size, &inner, &trun) == 1) {
+            if (trun.type == MP4_FOURCC('t', 'r', 'u', 'n') && trun.payload_size >= 8) samples += mp4_read_u32(trun.payload + 4);
+        }
+    }
+    return samples;
+}
+
+// Rewrite a trun keeping the samples whose data lies within the mdat bytes
+// read. base is the position of the mdat payload from the moof start.
+// Returns the samples kept (0 drops the trun), or -1 for a layout it cannot
+// trim. *data_end receives the end of the kept data within the mdat payload.
+static long repair_trim_trun(mp4_repair_t* repair, const mp4_box_t* trun, uint32_t default_size, uint64_t base,
+                             uint64_t available, size_t* offset_at, int64_t* data_start, uint64_t* data_end) {
+    if (trun->payload_size < 8) return -1;
+    uint8_t version = trun->payload[0];
+    uint32_t flags = mp4_read_u24(trun->payload + 1);
+    uint32_t count = mp4_read_u32(trun->payload + 4);
+    if (!(flags & TRUN_DATA_OFFSET)) return -1;
+    if (!(flags & TRUN_SIZE) && default_size == 0) return -1;
+
+    size_t fields = 8 + 4 + ((flags & TRUN_FIRST_SAMPLE_FLAGS) ? 4 : 0);
+    size_t entry_size = 4 * (size_t)(!!(flags & TRUN_DURATION) + !!(flags & TRUN_SIZE) +
+                                     !!(flags & TRUN_FLAGS) + !!(flags & TRUN_COMPOSITION));
+    if (fields + (uint64_t)count * entry_size > trun->payload_size) return -1;
+
+    int32_t data_offset = (int32_t)mp4_read_u32(trun->payload + 8);
+    if (data_offset < 0 || (uint64_t)data_offset < base) return -1;
+    uint64_t position = (uint64_t)data_offset - base;
+    size_t size_field = 4 * (size_t)!!(flags & TRUN_DURATION);
+
+    uint32_t kept = 0;
+    const uint8_t* entry = trun->payload + fields;
+    for (; kept < count; kept++, entry += entry_size) {
+        uint32_t size = (flags & TRUN_SIZE) ? mp4_read_u32(entry + size_field) : default_size;
+        if (position + size > available) break;
+        position += size;
+    }
+    if (kept == 0) return 0;
+
+    mp4_buffer_t* out = &repair->rebuilt;
+    size_t box = mp4_full_box_begin(out, MP4_FOURCC('t', 'r', 'u', 'n'), version, flags);
+    mp4_put_u32(out, kept);
+    *offset_at = out->size;
+    mp4_put_u32(out, 0);                                    // data_offset, set once the moof size is known
+    if (flags & TRUN_FIRST_SAMPLE_FLAGS) mp4_put_bytes(out, trun->payload + 12, 4);
+    mp4_put_bytes(out, trun->payload + fields, (size_t)kept * entry_size);
+    mp4_box_end(out, box);
+
+    *data_start = (int64_t)data_offset - (int64_t)base;
+    *data_end = position;
+    return (long)kept;
+}
+
+#define REPAIR_MAX_TRUNS 64
+
+// Write the part of a cut-short fragment whose sample data was read. The
+// moof is in repair->box, the mdat payload read so far in repair->mdat.
+static int repair_trim_fragment(mp4_repair_t* repair, size_t moof_size, size_t mdat_header_size) {
+    const uint8_t* moof_data = repair->box.data;
+    uint64_t available = repair->mdat.size;
+    uint64_t base = moof_size + mdat_header_size;
+    uint64_t total = repair_count_samples(moof_data, moof_size);
+    mp4_box_t moof, child;
+    if (mp4_box_parse(moof_data, moof_size, &moof) != 0) return -1;
+
+    size_t offsets_at[REPAIR_MAX_TRUNS];
+    int64_t data_starts[REPAIR_MAX_TRUNS];
+    int truns = 0;
+    uint64_t kept = 0, data_end = 0;
+
+    mp4_buffer_t* out = &repair->rebuilt;
+    mp4_buffer_reset(out);
+    size_t moof_box = mp4_box_begin(out, MP4_FOURCC('m', 'o', 'o', 'f'));
+    size_t offset = 0;
+    int traf_index = 0;
+    int supported = 1;
+    while (supported && mp4_box_next(moof.payload, moof.payload_size, &offset, &child) == 1) {
+        if (child.type == MP4_FOURCC('m', 'f', 'h', 'd')) {
+            mp4_put_bytes(out, child.payload - child.header_size, (size_t)child.size);
+            continue;
+        }
+        if (child.type != MP4_FOURCC('t', 'r', 'a', 'f')) continue;
+
+        mp4_box_t tfhd, part;
+        if (mp4_box_find(child.payload, child.payload_size, MP4_FOURCC('t', 'f', 'h', 'd'), &tfhd) != 0 ||
+            tfhd.payload_size < 8) {
+            supported = 0;
+            break;
+        }
+        // Data offsets must be relative to this moof
+        uint32_t tfhd_flags = mp4_read_u24(tfhd.payload + 1);
+        if ((tfhd_flags & TFHD_BASE_DATA_OFFSET) || (!(tfhd_flags & TFHD_DEFAULT_BASE_IS_MOOF) && traf_index > 0)) {
+            supported = 0;
+            break;
+        }
+        traf_index++;
+        uint32_t track_id = mp4_read_u32(tfhd.payload + 4);
+        uint32_t default_size = repair_trex_default_size(repair, track_id);
+        if (tfhd_flags & TFHD_DEFAULT_SIZE) {
+            size_t at = 8 + ((tfhd_flags & TFHD_SAMPLE_DESCRIPTION) ? 4 : 0) + ((tfhd_flags & TFHD_DEFAULT_DURATION) ? 4 : 0);
+            if (at + 4 > tfhd.payload_size) {
+                supported = 0;
+                break;
+            }
+            default_size = mp4_read_u32(tfhd.payload + at);
+        }
+
+        // tfhd and tfdt as they were, truns trimmed; per-sample side boxes are dropped
+        size_t traf_box = mp4_box_begin(out, MP4_FOURCC('t', 'r', 'a', 'f'));
+        mp4_put_bytes(out, tfhd.payload - tfhd.header_size, (size_t)tfhd.size);
+        if (mp4_box_find(child.payload, child.payload_size, MP4_FOURCC('t', 'f', 'd', 't'), &part) == 0) {
+            mp4_put_bytes(out, part.payload - part.header_size, (size_t)part.size);
+        }
+        size_t traf_header = out->size;
+        size_t inner = 0;
+        while (mp4_box_next(child.payload, child.payload_size, &inner, &part) == 1) {
+            if (part.type != MP4_FOURCC('t', 'r', 'u', 'n')) continue;
+            if (truns == REPAIR_MAX_TRUNS) {
+                supported = 0;
+                break;
+            }
+            uint64_t end = 0;
+            long samples = repair_trim_trun(repair, &part, default_size, base, available,
+                                            &offsets_at[truns], &data_starts[truns], &end);
+            if (samples < 0) {
+                supported = 0;
+                break;
+            }
+            if (samples == 0) continue;
+            kept += (uint64_t)samples;
+            if (end > data_end) data_end = end;
+            truns++;
+        }
+        if (out->size == traf_header) {
+            out->size = traf_box;                           // No samples left in this track
+        } else {
+            mp4_box_end(out, traf_box);
+        }
+    }
+    mp4_box_end(out, moof_box);
+
+    repair->result->trimmed_samples += total - (supported ? kept : 0);
+    if (!supported || kept == 0 || out->failed) return 0;
+
+    // Sample data now starts right after the rebuilt moof and an 8-byte mdat header
+    for (int i = 0; i < truns; i++) {
+        mp4_patch_u32(out, offsets_at[i], (uint32_t)(data_starts[i] + (int64_t)out->size + MP4_BOX_HEADER_SIZE));
+    }
+    uint8_t mdat_header[MP4_BOX_HEADER_SIZE];
+    uint64_t mdat_size = MP4_BOX_HEADER_SIZE + data_end;
+    for (int i = 0; i < 4; i++) mdat_header[i] = (uint8_t)(mdat_size >> (24 - 8 * i));
+    memcpy(mdat_header + 4, "mdat", 4);
+
+    if (repair_write(repair, out->data, out->size) != 0 || repair_write(repair, mdat_header, sizeof(mdat_header)) != 0 ||
+        repair_write(repair, repair->mdat.data, (size_t)data_end) != 0) {
+        return -1;
+    }
+    repair->accepted += base + data_end;
+    repair->result->fragments++;
+    repair->result->samples += kept;
+    return 0;
+}
+
+// A moof is in repair->box: read its mdat, then copy the pair or trim it.
+// Returns 1 to continue with the next box, 0 when the input ended, -1 on error.
+static int repair_fragment(mp4_repair_t* repair) {
+    size_t moof_size = repair->box.size;
+    uint8_t mdat_header[MP4_LARGE_BOX_HEADER_SIZE];
+    size_t got = repair_read(repair, mdat_header, MP4_BOX_HEADER_SIZE);
+    if (got < MP4_BOX_HEADER_SIZE || mp4_read_u32(mdat_header + 4) != MP4_FOURCC('m', 'd', 'a', 't')) {
+        repair->result->trimmed_samples += repair_count_samples(repair->box.data, moof_size);
+        return 0;
+    }
+
+    size_t header_size = MP4_BOX_HEADER_SIZE;
+    uint64_t size = mp4_read_u32(mdat_header);
+    if (size == 1) {
+        if (repair_read(repair, mdat_header + 8, 8) < 8) {
+            repair->result->trimmed_samples += repair_count_samples(repair->box.data, moof_size);
+            return 0;
+        }
+        size = mp4_read_u64(mdat_header + 8);
+        header_size = MP4_LARGE_BOX_HEADER_SIZE;
+    }
+    int to_end = size == 0;
+    if (!to_end && size < header_size) return 0;
+    uint64_t payload = to_end ? MP4_REPAIR_MAX_FRAGMENT : size - header_size;
+    if (payload > MP4_REPAIR_MAX_FRAGMENT) {
+        fprintf(stderr, "Repair: Fragment larger than %u MB; stopping there\n", MP4_REPAIR_MAX_FRAGMENT >> 20);
+        return 0;
+    }
+
+    mp4_buffer_reset(&repair->mdat);
+    uint64_t got_payload = repair_read_into(repair, &repair->mdat, payload);
+    if (!to_end && got_payload == payload) {
+        if (repair_write(repair, repair->box.data, moof_size) != 0 || repair_write(repair, mdat_header, header_size) != 0 ||
+            repair_write(repair, repair->mdat.data, repair->mdat.size) != 0) {
+            return -1;
+        }
+        repair->accepted += moof_size + header_size + payload;
+        repair->result->fragments++;
+        repair->result->samples += repair_count_samples(repair->box.data, moof_size);
+        return 1;
+    }
+
+    // Cut short (or open-ended): keep what was read
+    if (repair_trim_fragment(repair, moof_size, header_size) != 0) return -1;
+    return 0;
+}
+
+int mp4_repair_stream(FILE* input, FILE* output, mp4_repair_result_t* result) {
+    if (!result) return -1;
+    memset(result, 0, sizeof(mp4_repair_result_t));
+    if (!input || !output) return -1;
+
+    mp4_repair_t repair;
+    memset(&repair, 0, sizeof(repair));
+    repair.input = input;
+    repair.output = output;
+    repair.result = result;
+    mp4_buffer_init(&repair.box);
+    mp4_buffer_init(&repair.moov);
+    mp4_buffer_init(&repair.mdat);
+    mp4_buffer_init(&repair.rebuilt);
+
+    int status = -1;
+    int have_moov = 0;
+    for (;;) {
+        repair_header_t header;
+        int read = repair_read_header(&repair, &header);
+        if (read == 0) {
+            result->complete = 1;
+            break;
+        }
+        if (read < 0) break;
+
+        if (!have_moov) {
+            if (header.type == MP4_FOURCC('m', 'd', 'a', 't') || header.type == MP4_FOURCC('m', 'o', 'o', 'f')) {
+                fprintf(stderr, "Repair: Media data before any moov; the recording was not fragmented "
+                                "and its sample index was never written\n");
+                break;
+            }
+            int body = repair_read_body(&repair, &header);
+            if (body != 0) {
+                fprintf(stderr, "Repair: The file ends before its moov is complete; nothing to recover\n");
+                break;
+            }
+            if (header.type == MP4_FOURCC('m', 'o', 'o', 'v')) {
+                mp4_box_t moov, mvex;
+                mp4_box_parse(repair.box.data, repair.box.size, &moov);
+                if (mp4_box_find(moov.payload, moov.payload_size, MP4_FOURCC('m', 'v', 'e', 'x'), &mvex) != 0) {
+                    // A finished plain MP4: nothing to repair, copied as is
+                    fprintf(stderr, "Repair: Not a fragmented MP4; copying it unchanged\n");
+                }
+                mp4_buffer_reset(&repair.moov);
+                mp4_put_bytes(&repair.moov, repair.box.data, repair.box.size);
+                have_moov = 1;
+            }
+            if (repair_write(&repair, repair.box.data, repair.box.size) != 0) goto done;
+            repair.accepted += repair.box.size;
+            continue;
+        }
+
+        if (header.type == MP4_FOURCC('m', 'o', 'o', 'f')) {
+            if (repair_read_body(&repair, &header) != 0) break;
+            int next = repair_fragment(&repair);
+            if (next < 0) goto done;
+            if (next == 0) break;
+            continue;
+        }
+
+        // Other top-level boxes (free, sidx, mfra, ...) are copied when whole
+        if (repair_read_body(&repair, &header) != 0) break;
+        if (repair_write(&repair, repair.box.data, repair.box.size) != 0) goto done;
+        repair.accepted += repair.box.size;
+    }
+
+    if (have_moov && !repair.failed && fflush(output) == 0) status = 0;
+
+    // Account for whatever follows the last recoverable byte
+    if (!result->complete) {
+        uint8_t skip[4096];
+        while (repair_read(&repair, skip, sizeof(skip)) == sizeof(skip)) {
+        }
+    }
+    result->discarded_bytes = result->bytes_read - repair.accepted;
+
+done:
+    mp4_buffer_free(&repair.box);
+    mp4_buffer_free(&repair.moov);
+    mp4_buffer_free(&repair.mdat);
+    mp4_buffer_free(&repair.rebuilt);
+    return status;
+}
+
+int mp4_repair_file(const char* input_path, const char* output_path, mp4_repair_result_t* result) {
+    if (!input_path || !output_path || !result) return -1;
+    if (strcmp(input_path, output_path) == 0) {
+        fprintf(stderr, "Repair: Output must be a different file from the input\n");
+        return -1;
+    }
+    FILE* input = fopen(input_path, "rb");
+    if (!input) {
+        fprintf(stderr, "Repair: Cannot open %s\n", input_path);
+        return -1;
+    }
+    FILE* output = fopen(output_path, "wb");
+    if (!output) {
+        fprintf(stderr, "Repair: Cannot create %s\n", output_path);
+        fclose(input);
+        return -1;
+    }
+
+    int status = mp4_repair_stream(input, output, result);
+    fclose(input);
+    if (fclose(output) != 0) status = -1;
+    if (status != 0) remove(output_path);
+    return status;
+}
+
+void mp4_repair_report(const mp4_repair_result_t* result, mp4_repair_report_fn report) {
+    if (!result || !report) return;
+    char message[256];
+    if (result->complete) {
+        snprintf(message, sizeof(message), "Repair: The file was complete; %llu fragments, %llu samples copied",
+                 (unsigned long long)result->fragments, (unsigned long long)result->samples);
+    } else {
+        snprintf(message, sizeof(message),
+                 "Repair: Recovered %llu fragments, %llu samples (%llu cut off); wrote %.1f MB of %.1f MB read",
+                 (unsigned long long)result->fragments, (unsigned long long)result->samples,
+                 (unsigned long long)result->trimmed_samples, result->bytes_written / (1024.0 * 1024.0),
+                 result->bytes_read / (1024.0 * 1024.0));
+    }
+    report(message);
+}
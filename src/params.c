@@ -17,19 +17,57 @@ void params_init_defaults(capture_params_t* params) {
     params->audio_sources = AUDIO_SOURCE_NONE;
     // MVP: Video capture defaults
     params->monitor_index = 0;
+    params->virtual_desktop = FALSE;
     params->cursor_enabled = TRUE;
     params->region_enabled = FALSE;
     params->region_x = 0;
     params->region_y = 0;
     params->region_w = 0;
     params->region_h = 0;
+    params->output_scale = 0.0;
+    params->output_width = 0;
+    params->output_height = 0;
+    params->encode_nv12 = TRUE;
+    params->color_matrix = COLOR_MATRIX_BT709;
+    params->color_range = COLOR_RANGE_LIMITED;
+    params->worker_threads = 0;
+    params->change_detection = TRUE;
+    params->variable_frame_rate = FALSE;
+    params->capture_source = CAPTURE_SOURCE_DXGI;
+    params->synthetic_pattern = SYNTHETIC_PATTERN_BLOCKS;
+    params->source_width = 1920;
+    params->source_height = 1080;
+    params->replay_filename[0] = '\0';
+    params->replay_loop = FALSE;
+    params->audio_buffer_ms = 50;
+    params->fragmented_output = TRUE;
+    params->segment_time = 0;
+    params->segment_size = 0;
+    params->spool_output = FALSE;
+    params->encoder_backend = ENCODER_BACKEND_MEDIA_FOUNDATION;
+    params->replay_seconds = 0;
+    params->replay_budget_mb = CAPTURE_DEFAULT_REPLAY_BUDGET_MB;
 }
 
 int params_validate_and_finalize(capture_params_t* params) {
     if (!params) return -1;
     
+    // The replay buffer holds the packets an encoder hands back. Media Foundation
+    // hands back none, and the encoders that do record video only, so an explicit
+    // request for either is refused rather than quietly recorded some other way
+    if (params->replay_seconds > 0) {
+        if (params->encoder_backend != ENCODER_BACKEND_H264 && params->encoder_backend != ENCODER_BACKEND_X264) {
+            fprintf(stderr, "Error: --replay-buffer needs --encoder h264 or x264\n");
+            return -1;
+        }
+        if (params->enable_system_audio || params->enable_microphone) {
+            fprintf(stderr, "Error: --replay-buffer records video only; leave out --system and --microphone\n");
+            return -1;
+        }
+    }
+    
     // Validate FPS
-    if (params->fps <= 0 || params->fps > 120) {
+    if (params->fps <= 0 || params->fps > CAPTURE_MAX_FPS) {
         params->fps = 30; // Default to 30 FPS
     }
     
@@ -54,6 +92,15 @@ int params_validate_and_finalize(capture_params_t* params) {
     params->enable_microphone = FALSE;
 #endif
     
+    // The capture spool and the portable encoders hold video frames only
+    if (params->spool_output) params->encoder_backend = ENCODER_BACKEND_SPOOL;
+
+    if (params->encoder_backend != ENCODER_BACKEND_MEDIA_FOUNDATION && params->encoder_backend != ENCODER_BACKEND_NULL) {
+        params->enable_video = TRUE;
+        params->enable_system_audio = FALSE;
+        params->enable_microphone = FALSE;
+    }
+    
     // Set up audio sources based on enabled options
     params->audio_sources = AUDIO_SOURCE_NONE;
     if (params->enable_system_audio && params->enable_microphone) {
@@ -94,6 +141,11 @@ void params_adjust_filename_extension(capture_params_t* params) {
     
     char* ext = strrchr(params->output_filename, '.');
     const char* target_ext = ".mp4";
+    if (params->encoder_backend == ENCODER_BACKEND_SPOOL) {
+        target_ext = ".spool";
+    } else if (params->encoder_backend == ENCODER_BACKEND_RAW) {
+        target_ext = ".raw";
+    }
     
     // Check if extension needs to be changed
     if (!ext || _stricmp(ext, target_ext) != 0) {
@@ -104,3 +156,8 @@ void params_adjust_filename_extension(capture_params_t* params) {
         strcat(params->output_filename, target_ext);
     }
 }
+
+BOOL params_is_capped(const capture_params_t* params) {
+    if (!params) return FALSE;
+    return params->duration <= 0 && params->segment_time <= 0 && params->segment_size == 0 && params->replay_seconds <= 0;
+}
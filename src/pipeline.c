@@ -0,0 +1,199 @@
+#include "pipeline.h"
+#include <stdio.h>
+#include <string.h>
+
+#define PIPELINE_DEFAULT_IDLE_MS 10
+
+int pipeline_init(pipeline_t* pipeline) {
+    if (!pipeline) return -1;
+    memset(pipeline, 0, sizeof(pipeline_t));
+    return 0;
+}
+
+int pipeline_add_stage(pipeline_t* pipeline, const pipeline_stage_desc_t* desc) {
+    if (!pipeline || !desc || !desc->step || pipeline->running) return -1;
+    if (pipeline->stage_count >= PIPELINE_MAX_STAGES) return -1;
+
+    pipeline_stage_t* stage = &pipeline->stages[pipeline->stage_count];
+    memset(stage, 0, sizeof(pipeline_stage_t));
+    if (platform_mutex_init(&stage->mutex) != 0) return -1;
+    if (platform_cond_init(&stage->wake) != 0) {
+        platform_mutex_destroy(&stage->mutex);
+        return -1;
+    }
+    stage->desc = *desc;
+    if (stage->desc.idle_ms == 0) stage->desc.idle_ms = PIPELINE_DEFAULT_IDLE_MS;
+    if (!stage->desc.name) stage->desc.name = "stage";
+    stage->pipeline = pipeline;
+    stage->index = pipeline->stage_count;
+    return pipeline->stage_count++;
+}
+
+int pipeline_add_queue(pipeline_t* pipeline, spsc_ring_t* queue) {
+    if (!pipeline || !queue || pipeline->queue_count >= PIPELINE_MAX_QUEUES) return -1;
+    pipeline->queues[pipeline->queue_count++] = queue;
+    return 0;
+}
+
+void pipeline_notify(pipeline_t* pipeline, int stage_index) {
+    if (!pipeline || stage_index < 0 || stage_index >= pipeline->stage_count) return;
+    pipeline_stage_t* stage = &pipeline->stages[stage_index];
+    platform_mutex_lock(&stage->mutex);
+    stage->signaled = 1;
+    platform_cond_signal(&stage->wake);
+    platform_mutex_unlock(&stage->mutex);
+}
+
+static void pipeline_notify_all(pipeline_t* pipeline) {
+    for (int i = 0; i < pipeline->stage_count; i++) pipeline_notify(pipeline, i);
+}
+
+// Sleep until notified, stopping, or the timeout
+static void pipeline_stage_wait(pipeline_stage_t* stage, unsigned int milliseconds) {
+    platform_mutex_lock(&stage->mutex);
+    if (!stage->signaled && !platform_atomic_load(&stage->pipeline->stopping)) {
+        stage->idle_waits++;
+        platform_cond_wait_ms(&stage->wake, &stage->mutex, milliseconds);
+    }
+    stage->signaled = 0;
+    platform_mutex_unlock(&stage->mutex);
+}
+
+static int pipeline_upstream_exited(const pipeline_stage_t* stage) {
+    pipeline_t* pipeline = stage->pipeline;
+    for (int i = 0; i < stage->index; i++) {
+        if (!platform_atomic_load(&pipeline->stages[i].exited)) return 0;
+    }
+    return 1;
+}
+
+static void pipeline_stage_thread(void* arg) {
+    pipeline_stage_t* stage = (pipeline_stage_t*)arg;
+    pipeline_t* pipeline = stage->pipeline;
+    int done = 0;
+
+    if (stage->desc.thread_init) stage->desc.thread_init(stage->desc.context);
+
+    for (;;) {
+        int stopping = (int)platform_atomic_load(&pipeline->stopping);
+        int draining = stopping && pipeline_upstream_exited(stage);
+
+        // Sources have no input to drain; they simply stop producing
+        if (stopping && stage->desc.source) break;
+
+        if (done) {
+            // Finished stages have nothing left to produce; wait for the stop
+            if (stopping) break;
+            pipeline_stage_wait(stage, stage->desc.idle_ms);
+            continue;
+        }
+
+        int result = stage->desc.step(stage->desc.context);
+        stage->steps++;
+        if (result == PIPELINE_STEP_BUSY) {
+            stage->busy_steps++;
+            continue;
+        }
+        if (result == PIPELINE_STEP_ERROR) {
+            platform_atomic_store(&pipeline->failed, 1);
+            platform_atomic_store(&pipeline->finished, 1);
+            break;
+        }
+        if (result == PIPELINE_STEP_DONE) {
+            platform_atomic_store(&pipeline->finished, 1);
+            done = 1;
+            continue;
+        }
+
+        // Idle: with the upstream gone and nothing left, this stage is drained
+        if (draining && result == PIPELINE_STEP_IDLE) break;
+        pipeline_stage_wait(stage, stage->desc.idle_ms);
+    }
+
+    if (stage->desc.thread_exit) stage->desc.thread_exit(stage->desc.context);
+
+    // Downstream stages re-check their drain condition
+    platform_atomic_store(&stage->exited, 1);
+    pipeline_notify_all(pipeline);
+}
+
+int pipeline_start(pipeline_t* pipeline) {
+    if (!pipeline || pipeline->running || pipeline->stage_count == 0) return -1;
+
+    platform_atomic_store(&pipeline->stopping, 0);
+    platform_atomic_store(&pipeline->finished, 0);
+    platform_atomic_store(&pipeline->failed, 0);
+    pipeline->running = 1;
+
+    // Reset every stage before any starts: a running stage may already notify the next
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        platform_atomic_store(&pipeline->stages[i].exited, 0);
+        pipeline->stages[i].signaled = 0;
+    }
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        pipeline_stage_t* stage = &pipeline->stages[i];
+        if (platform_thread_create(&stage->thread, pipeline_stage_thread, stage) != 0) {
+            fprintf(stderr, "Pipeline: Failed to start stage %s\n", stage->desc.name);
+            pipeline_stop(pipeline);
+            return -1;
+        }
+        stage->started = 1;
+    }
+    return 0;
+}
+
+int pipeline_finished(pipeline_t* pipeline) {
+    return pipeline ? (int)platform_atomic_load(&pipeline->finished) : 1;
+}
+
+int pipeline_failed(pipeline_t* pipeline) {
+    return pipeline ? (int)platform_atomic_load(&pipeline->failed) : 1;
+}
+
+void pipeline_stop(pipeline_t* pipeline) {
+    if (!pipeline || !pipeline->running) return;
+
+    platform_atomic_store(&pipeline->stopping, 1);
+    pipeline_notify_all(pipeline);
+
+    // Join in order; later stages are still draining what earlier ones queued
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        pipeline_stage_t* stage = &pipeline->stages[i];
+        if (stage->started) {
+            platform_thread_join(stage->thread);
+            stage->started = 0;
+        }
+    }
+    pipeline->running = 0;
+}
+
+void pipeline_report(pipeline_t* pipeline, pipeline_report_fn report) {
+    if (!pipeline || !report) return;
+    char message[192];
+
+    for (int i = 0; i < pipeline->queue_count; i++) {
+        spsc_ring_stats_t stats;
+        spsc_ring_get_stats(pipeline->queues[i], &stats);
+        snprintf(message, sizeof(message), "Queue %s: %llu passed, high-water %u/%u, %llu full stalls",
+                 pipeline->queues[i]->name, (unsigned long long)stats.popped, stats.high_water, stats.capacity,
+                 (unsigned long long)stats.full);
+        report(message);
+    }
+
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        const pipeline_stage_t* stage = &pipeline->stages[i];
+        snprintf(message, sizeof(message), "Stage %s: %llu busy steps, %llu idle waits",
+                 stage->desc.name, (unsigned long long)stage->busy_steps, (unsigned long long)stage->idle_waits);
+        report(message);
+    }
+}
+
+void pipeline_cleanup(pipeline_t* pipeline) {
+    if (!pipeline) return;
+    pipeline_stop(pipeline);
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        platform_cond_destroy(&pipeline->stages[i].wake);
+        platform_mutex_destroy(&pipeline->stages[i].mutex);
+    }
+    memset(pipeline, 0, sizeof(pipeline_t));
+}
@@ -0,0 +1,466 @@
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#include <process.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+int platform_mutex_init(platform_mutex_t* mutex) {
+    if (!mutex) return -1;
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+    return 0;
+#else
+    return pthread_mutex_init(mutex, NULL) == 0 ? 0 : -1;
+#endif
+}
+
+void platform_mutex_lock(platform_mutex_t* mutex) {
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+void platform_mutex_unlock(platform_mutex_t* mutex) {
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+void platform_mutex_destroy(platform_mutex_t* mutex) {
+    if (!mutex) return;
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+int platform_cond_init(platform_cond_t* cond) {
+    if (!cond) return -1;
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+    return 0;
+#else
+    return pthread_cond_init(cond, NULL) == 0 ? 0 : -1;
+#endif
+}
+
+void platform_cond_wait(platform_cond_t* cond, platform_mutex_t* mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+int platform_cond_wait_ms(platform_cond_t* cond, platform_mutex_t* mutex, unsigned int milliseconds) {
+#ifdef _WIN32
+    if (SleepConditionVariableCS(cond, mutex, milliseconds)) return 0;
+    return GetLastError() == ERROR_TIMEOUT ? 1 : 0;
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &deadline) == ETIMEDOUT ? 1 : 0;
+#endif
+}
+
+void platform_cond_signal(platform_cond_t* cond) {
+#ifdef _WIN32
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+void platform_cond_broadcast(platform_cond_t* cond) {
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+void platform_cond_destroy(platform_cond_t* cond) {
+    if (!cond) return;
+#ifdef _WIN32
+    // Win32 condition variables hold no resources
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+// Both thread APIs want their own entry point signature; bounce through a small start record
+typedef struct {
+    platform_thread_fn fn;
+    void* arg;
+} platform_thread_start_t;
+
+#ifdef _WIN32
+static unsigned __stdcall platform_thread_entry(void* param) {
+#else
+static void* platform_thread_entry(void* param) {
+#endif
+    platform_thread_start_t start = *(platform_thread_start_t*)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+
+int platform_thread_create(platform_thread_t* thread, platform_thread_fn fn, void* arg) {
+    if (!thread || !fn) return -1;
+
+    platform_thread_start_t* start = (platform_thread_start_t*)malloc(sizeof(platform_thread_start_t));
+    if (!start) return -1;
+    start->fn = fn;
+    start->arg = arg;
+
+#ifdef _WIN32
+    uintptr_t handle = _beginthreadex(NULL, 0, platform_thread_entry, start, 0, NULL);
+    if (handle == 0) {
+        free(start);
+        return -1;
+    }
+    *thread = (HANDLE)handle;
+    return 0;
+#else
+    if (pthread_create(thread, NULL, platform_thread_entry, start) != 0) {
+        free(start);
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+void platform_thread_join(platform_thread_t thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+int platform_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+void platform_sleep_ms(unsigned int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    struct timespec delay;
+    delay.tv_sec = milliseconds / 1000;
+    delay.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    while (nanosleep(&delay, &delay) != 0) {
+        // Interrupted by a signal: sleep for the remainder
+    }
+#endif
+}
+
+void platform_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+uint64_t platform_time_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+// Coarse timers fire on the ~15.6 ms scheduler tick; they stop this far early and spin the rest
+#define PLATFORM_TIMER_SPIN_NS 2000000ULL
+#endif
+
+int platform_timer_init(platform_timer_t* timer) {
+    if (!timer) return -1;
+#ifdef _WIN32
+    timer->handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    timer->high_resolution = timer->handle != NULL;
+    if (!timer->handle) {
+        // Windows before 10 1803
+        timer->handle = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    }
+    return timer->handle ? 0 : -1;
+#else
+    timer->unused = 0;
+    return 0;
+#endif
+}
+
+void platform_timer_wait_until_ns(platform_timer_t* timer, uint64_t deadline_ns) {
+#ifdef _WIN32
+    uint64_t now = platform_time_ns();
+    if (now >= deadline_ns) return;
+
+    uint64_t timer_deadline = deadline_ns;
+    if (!timer || !timer->high_resolution) {
+        timer_deadline = deadline_ns > PLATFORM_TIMER_SPIN_NS ? deadline_ns - PLATFORM_TIMER_SPIN_NS : 0;
+    }
+    if (timer && timer->handle && timer_deadline > now) {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)((timer_deadline - now) / 100);   // Relative, in 100 ns units
+        if (SetWaitableTimer(timer->handle, &due, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject(timer->handle, INFINITE);
+        }
+    }
+    while (platform_time_ns() < deadline_ns) {
+        SwitchToThread();
+    }
+#else
+    (void)timer;
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+        // Interrupted by a signal: the deadline is absolute, just wait again
+    }
+#endif
+}
+
+void platform_timer_destroy(platform_timer_t* timer) {
+    if (!timer) return;
+#ifdef _WIN32
+    if (timer->handle) CloseHandle(timer->handle);
+    timer->handle = NULL;
+    timer->high_resolution = 0;
+#endif
+}
+
+int platform_file_sync(FILE* file) {
+    if (!file || fflush(file) != 0) return -1;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0 ? 0 : -1;
+#else
+    return fsync(fileno(file)) == 0 ? 0 : -1;
+#endif
+}
+
+// Map the first map->size bytes of the open file
+static int platform_map_view(platform_map_t* map) {
+#ifdef _WIN32
+    ULONGLONG size = map->size;
+    map->mapping = CreateFileMappingA(map->file, NULL, map->writable ? PAGE_READWRITE : PAGE_READONLY,
+                                      (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (!map->mapping) return -1;
+    map->data = (uint8_t*)MapViewOfFile(map->mapping, map->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, map->size);
+    if (!map->data) {
+        CloseHandle(map->mapping);
+        map->mapping = NULL;
+        return -1;
+    }
+    return 0;
+#else
+    void* data = mmap(NULL, map->size, map->writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, map->fd, 0);
+    if (data == MAP_FAILED) return -1;
+    map->data = (uint8_t*)data;
+    return 0;
+#endif
+}
+
+static void platform_map_unview(platform_map_t* map) {
+    if (!map->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    map->mapping = NULL;
+#else
+    munmap(map->data, map->size);
+#endif
+    map->data = NULL;
+}
+
+// Current length of the open file
+static int platform_map_file_size(platform_map_t* map, size_t* size) {
+#ifdef _WIN32
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(map->file, &length) || (ULONGLONG)length.QuadPart > (ULONGLONG)(size_t)-1) return -1;
+    *size = (size_t)length.QuadPart;
+#else
+    struct stat info;
+    if (fstat(map->fd, &info) != 0 || info.st_size < 0) return -1;
+    *size = (size_t)info.st_size;
+#endif
+    return 0;
+}
+
+// Set the open file's length; growing fills with zeros
+static int platform_map_set_length(platform_map_t* map, size_t length) {
+#ifdef _WIN32
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG)length;
+    return SetFilePointerEx(map->file, position, NULL, FILE_BEGIN) && SetEndOfFile(map->file) ? 0 : -1;
+#else
+    return ftruncate(map->fd, (off_t)length) == 0 ? 0 : -1;
+#endif
+}
+
+static void platform_map_close_file(platform_map_t* map) {
+#ifdef _WIN32
+    CloseHandle(map->file);
+#else
+    close(map->fd);
+#endif
+    memset(map, 0, sizeof(platform_map_t));
+}
+
+int platform_map_create(platform_map_t* map, const char* path, size_t size) {
+    if (!map || !path || size == 0) return -1;
+    memset(map, 0, sizeof(platform_map_t));
+    map->writable = 1;
+    map->size = size;
+#ifdef _WIN32
+    // Readers may follow the file while it is written
+    map->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) {
+        memset(map, 0, sizeof(platform_map_t));
+        return -1;
+    }
+#else
+    map->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (map->fd < 0) {
+        memset(map, 0, sizeof(platform_map_t));
+        return -1;
+    }
+#endif
+    if (platform_map_set_length(map, size) != 0 || platform_map_view(map) != 0) {
+        platform_map_close_file(map);
+        remove(path);
+        return -1;
+    }
+    return 0;
+}
+
+int platform_map_open(platform_map_t* map, const char* path) {
+    if (!map || !path) return -1;
+    memset(map, 0, sizeof(platform_map_t));
+#ifdef _WIN32
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) {
+        memset(map, 0, sizeof(platform_map_t));
+        return -1;
+    }
+#else
+    map->fd = open(path, O_RDONLY);
+    if (map->fd < 0) {
+        memset(map, 0, sizeof(platform_map_t));
+        return -1;
+    }
+#endif
+    // An empty file cannot be mapped
+    if (platform_map_file_size(map, &map->size) != 0 || map->size == 0 || platform_map_view(map) != 0) {
+        platform_map_close_file(map);
+        return -1;
+    }
+    return 0;
+}
+
+int platform_map_resize(platform_map_t* map, size_t size) {
+    if (!map || !map->data || !map->writable || size == 0) return -1;
+    platform_map_unview(map);
+    size_t old_size = map->size;
+    map->size = size;
+    if (platform_map_set_length(map, size) == 0 && platform_map_view(map) == 0) return 0;
+    // Put the old view back so what was written stays reachable
+    map->size = old_size;
+    platform_map_set_length(map, old_size);
+    platform_map_view(map);
+    return -1;
+}
+
+int platform_map_refresh(platform_map_t* map) {
+    if (!map || !map->data || map->writable) return -1;
+    size_t size;
+    if (platform_map_file_size(map, &size) != 0) return -1;
+    if (size <= map->size) return 0;
+    platform_map_unview(map);
+    size_t old_size = map->size;
+    map->size = size;
+    if (platform_map_view(map) == 0) return 0;
+    map->size = old_size;
+    platform_map_view(map);
+    return -1;
+}
+
+int platform_map_sync(platform_map_t* map) {
+    if (!map || !map->data || !map->writable) return -1;
+#ifdef _WIN32
+    return FlushViewOfFile(map->data, map->size) && FlushFileBuffers(map->file) ? 0 : -1;
+#else
+    return msync(map->data, map->size, MS_SYNC) == 0 ? 0 : -1;
+#endif
+}
+
+void platform_map_close(platform_map_t* map, size_t length) {
+    if (!map || map->size == 0) return;
+    platform_map_unview(map);
+    if (map->writable && length < map->size) platform_map_set_length(map, length);
+    platform_map_close_file(map);
+}
+
+void* platform_aligned_alloc(size_t size, size_t alignment) {
+    if (size == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0) return NULL;
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = NULL;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    if (posix_memalign(&ptr, alignment, size) != 0) return NULL;
+    return ptr;
+#endif
+}
+
+void platform_aligned_free(void* ptr) {
+    if (!ptr) return;
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
@@ -0,0 +1,52 @@
+#include "readback_ring.h"
+#include <string.h>
+
+int readback_ring_init(readback_ring_t* ring, int depth, int latency) {
+    if (!ring) return -1;
+    if (depth <= 0 || depth > READBACK_RING_MAX_DEPTH || latency < 0 || latency >= depth) return -1;
+
+    memset(ring, 0, sizeof(readback_ring_t));
+    ring->depth = depth;
+    ring->latency = latency;
+    return 0;
+}
+
+void readback_ring_reset(readback_ring_t* ring) {
+    if (!ring) return;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->in_flight = 0;
+}
+
+int readback_ring_begin(const readback_ring_t* ring) {
+    if (!ring || ring->depth <= 0 || ring->in_flight >= ring->depth) return -1;
+    return ring->head;
+}
+
+void readback_ring_submit(readback_ring_t* ring) {
+    if (!ring || ring->depth <= 0 || ring->in_flight >= ring->depth) return;
+    ring->head = (ring->head + 1) % ring->depth;
+    ring->in_flight++;
+    ring->submitted++;
+}
+
+readback_action_t readback_ring_next(const readback_ring_t* ring, int idle, int* slot) {
+    if (!ring || !slot || ring->in_flight == 0) return READBACK_IDLE;
+    *slot = ring->tail;
+
+    // Past the latency, or the ring is full and the next copy needs the slot
+    if (ring->in_flight > ring->latency || ring->in_flight >= ring->depth) return READBACK_WAIT;
+    return idle ? READBACK_TRY : READBACK_IDLE;
+}
+
+void readback_ring_retire(readback_ring_t* ring, int stalled) {
+    if (!ring || ring->in_flight == 0) return;
+    ring->tail = (ring->tail + 1) % ring->depth;
+    ring->in_flight--;
+    ring->retired++;
+    if (stalled) ring->stalls++;
+}
+
+void readback_ring_defer(readback_ring_t* ring) {
+    if (ring) ring->deferred++;
+}
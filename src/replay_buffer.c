@@ -0,0 +1,456 @@
+#include "replay_buffer.h"
+#include "elementary_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static replay_packet_t* replay_packet(replay_buffer_t* buffer, uint64_t sequence) {
+    return &buffer->packets[sequence % buffer->config.max_packets];
+}
+
+static uint64_t replay_first_keyframe(const replay_buffer_t* buffer) {
+    return buffer->keyframes[buffer->keyframe_first];
+}
+
+// Where a packet of size bytes goes, if it fits in the free part of the block
+static int replay_fit(const replay_buffer_t* buffer, size_t size, size_t* offset, size_t* span) {
+    size_t capacity = buffer->config.budget_bytes;
+    if (buffer->used == 0) {
+        *offset = 0;
+        *span = size;
+        return size <= capacity;
+    }
+    if (buffer->used == capacity) return 0;
+
+    size_t head = (buffer->tail + capacity - buffer->used) % capacity;
+    if (buffer->tail > head) {
+        // Live bytes in [head, tail): free space at the end, then from the start
+        if (capacity - buffer->tail >= size) {
+            *offset = buffer->tail;
+            *span = size;
+            return 1;
+        }
+        if (head >= size) {
+            *offset = 0;
+            *span = capacity - buffer->tail + size;
+            return 1;
+        }
+        return 0;
+    }
+    if (head - buffer->tail >= size) {
+        *offset = buffer->tail;
+        *span = size;
+        return 1;
+    }
+    return 0;
+}
+
+// The oldest packet is only kept for the GOP it belongs to: video before the
+// first keyframe, and audio that ends before it, can go
+static int replay_front_unused(replay_buffer_t* buffer) {
+    if (!buffer->config.video || buffer->keyframe_count == 0) return 1;
+    uint64_t first = replay_first_keyframe(buffer);
+    const replay_packet_t* packet = replay_packet(buffer, buffer->head);
+    if (packet->type == REPLAY_PACKET_VIDEO) return buffer->head < first;
+    return packet->time + packet->duration <= replay_packet(buffer, first)->time;
+}
+
+static void replay_free_front(replay_buffer_t* buffer) {
+    buffer->used -= replay_packet(buffer, buffer->head)->span;
+    buffer->head++;
+    buffer->stats.packets_evicted++;
+    if (buffer->used == 0) buffer->tail = 0;
+}
+
+// Free the front packets no GOP needs any more, short of what the saver still reads
+static void replay_free_unused(replay_buffer_t* buffer) {
+    while (buffer->head != buffer->tail_sequence && replay_front_unused(buffer) &&
+           !(buffer->saving && buffer->head >= buffer->save_cursor)) {
+        replay_free_front(buffer);
+    }
+}
+
+// Free the oldest packet, or give up the oldest GOP so its packets can be
+// freed next. Fails when the saver still needs the front.
+static int replay_evict(replay_buffer_t* buffer) {
+    if (buffer->head == buffer->tail_sequence) return -1;
+    if (buffer->saving && buffer->head >= buffer->save_cursor) return -1;
+    if (replay_front_unused(buffer)) {
+        replay_free_front(buffer);
+        return 0;
+    }
+
+    // The front is live, so there is a keyframe: start at the next one
+    buffer->keyframe_first = (buffer->keyframe_first + 1) % buffer->config.max_packets;
+    buffer->keyframe_count--;
+    buffer->stats.gops_evicted++;
+    if (buffer->keyframe_count == 0) {
+        // The only GOP outgrew the budget: nothing decodable is left until the next keyframe
+        buffer->need_keyframe = 1;
+        buffer->stats.dropped_oversize++;
+    }
+    replay_free_unused(buffer);
+    return 0;
+}
+
+// Keep no GOP that max_duration does not need
+static void replay_trim_duration(replay_buffer_t* buffer) {
+    if (buffer->config.max_duration <= 0 || !buffer->config.video) return;
+    int64_t keep_from = buffer->last_time - buffer->config.max_duration;
+    while (buffer->keyframe_count > 1) {
+        uint32_t next = (buffer->keyframe_first + 1) % buffer->config.max_packets;
+        if (replay_packet(buffer, buffer->keyframes[next])->time > keep_from) break;
+        buffer->keyframe_first = next;
+        buffer->keyframe_count--;
+        buffer->stats.gops_evicted++;
+    }
+    replay_free_unused(buffer);
+}
+
+// Audio-only buffers hold max_duration of packets, oldest out first
+static void replay_trim_audio(replay_buffer_t* buffer) {
+    if (buffer->config.max_duration <= 0 || buffer->config.video) return;
+    while (buffer->tail_sequence - buffer->head > 1 &&
+           replay_packet(buffer, buffer->head + 1)->time + buffer->config.max_duration <= buffer->last_time &&
+           !(buffer->saving && buffer->head >= buffer->save_cursor)) {
+        replay_free_front(buffer);
+    }
+}
+
+static int replay_write(replay_buffer_t* buffer, int type, const uint8_t* data, size_t size, int64_t time,
+                        int64_t duration) {
+    int keyframe = type == REPLAY_PACKET_VIDEO && h264_is_keyframe(data, size);
+
+    platform_mutex_lock(&buffer->mutex);
+    if (type == REPLAY_PACKET_VIDEO && !keyframe && (buffer->need_keyframe || buffer->keyframe_count == 0)) {
+        buffer->stats.dropped_before_keyframe++;
+        platform_mutex_unlock(&buffer->mutex);
+        return 0;
+    }
+    if (size > buffer->config.budget_bytes) {
+        buffer->stats.dropped_oversize++;
+        if (type == REPLAY_PACKET_VIDEO) buffer->need_keyframe = 1;
+        platform_mutex_unlock(&buffer->mutex);
+        return 0;
+    }
+
+    size_t offset = 0;
+    size_t span = 0;
+    while (buffer->tail_sequence - buffer->head == buffer->config.max_packets ||
+           !replay_fit(buffer, size, &offset, &span)) {
+        if (replay_evict(buffer) != 0) {
+            // The saver has not reached the front yet; never block capture for it
+            buffer->stats.dropped_while_saving++;
+            if (type == REPLAY_PACKET_VIDEO) buffer->need_keyframe = 1;
+            platform_mutex_unlock(&buffer->mutex);
+            return 0;
+        }
+    }
+    // Making room may have dropped the GOP this frame belongs to
+    if (type == REPLAY_PACKET_VIDEO && !keyframe && buffer->need_keyframe) {
+        platform_mutex_unlock(&buffer->mutex);
+        return 0;
+    }
+
+    memcpy(buffer->data + offset, data, size);
+    replay_packet_t* packet = replay_packet(buffer, buffer->tail_sequence);
+    packet->type = type;
+    packet->keyframe = keyframe;
+    packet->time = time;
+    packet->duration = duration;
+    packet->offset = offset;
+    packet->size = size;
+    packet->span = span;
+    if (keyframe) {
+        uint32_t slot = (buffer->keyframe_first + buffer->keyframe_count) % buffer->config.max_packets;
+        buffer->keyframes[slot] = buffer->tail_sequence;
+        buffer->keyframe_count++;
+        buffer->need_keyframe = 0;
+    }
+    buffer->tail_sequence++;
+    buffer->used += span;
+    buffer->tail = (offset + size) % buffer->config.budget_bytes;
+    if (time + duration > buffer->last_time) buffer->last_time = time + duration;
+
+    buffer->stats.packets++;
+    buffer->stats.bytes += size;
+    replay_trim_duration(buffer);
+    replay_trim_audio(buffer);
+    if (buffer->used > buffer->stats.peak_bytes) buffer->stats.peak_bytes = buffer->used;
+    platform_mutex_unlock(&buffer->mutex);
+    return 0;
+}
+
+int replay_buffer_write_video(replay_buffer_t* buffer, const uint8_t* data, size_t size, int64_t time) {
+    if (!buffer || !buffer->data || !buffer->config.video || !data || size == 0) return -1;
+    return replay_write(buffer, REPLAY_PACKET_VIDEO, data, size, time, 0);
+}
+
+int replay_buffer_write_audio(replay_buffer_t* buffer, const uint8_t* data, size_t size, int64_t time) {
+    if (!buffer || !buffer->data || !buffer->config.audio || !data || size == 0) return -1;
+
+    // The length decides which GOP the packet plays under
+    int64_t duration = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        aac_adts_header_t header;
+        if (aac_adts_parse(data + offset, size - offset, &header) != 0) {
+            fprintf(stderr, "Replay: Audio packet is not whole ADTS frames\n");
+            return -1;
+        }
+        duration += AAC_SAMPLES_PER_FRAME * REPLAY_UNITS_PER_SECOND / header.sample_rate;
+        offset += header.frame_size;
+    }
+    return replay_write(buffer, REPLAY_PACKET_AUDIO, data, size, time, duration);
+}
+
+int replay_buffer_path(const char* base_path, uint32_t index, char* path, size_t size) {
+    if (!base_path || !path || size == 0) return -1;
+    const char* dot = strrchr(base_path, '.');
+    const char* slash = strrchr(base_path, '/');
+    const char* backslash = strrchr(base_path, '\\');
+    if (backslash > slash) slash = backslash;
+    if (!dot || (slash && dot < slash)) dot = base_path + strlen(base_path);
+
+    int written = snprintf(path, size, "%.*s-replay-%03u%s", (int)(dot - base_path), base_path, index, dot);
+    return written > 0 && (size_t)written < size ? 0 : -1;
+}
+
+static void replay_saver(void* arg) {
+    replay_buffer_t* buffer = (replay_buffer_t*)arg;
+    char path[REPLAY_MAX_PATH];
+    platform_mutex_lock(&buffer->mutex);
+    for (;;) {
+        while (buffer->request_count == 0 && !buffer->stopping) {
+            platform_cond_wait(&buffer->cond, &buffer->mutex);
+        }
+        if (buffer->request_count == 0) break;
+
+        strcpy(path, buffer->requests[0]);
+        buffer->request_count--;
+        memmove(buffer->requests[0], buffer->requests[1], (size_t)buffer->request_count * REPLAY_MAX_PATH);
+        buffer->busy = 1;
+        platform_mutex_unlock(&buffer->mutex);
+
+        replay_save_result_t result;
+        if (replay_buffer_save(buffer, path, &result) == 0) {
+            printf("Replay saved: %s (%.1f s)\n", path, result.duration / (double)REPLAY_UNITS_PER_SECOND);
+        }
+
+        platform_mutex_lock(&buffer->mutex);
+        buffer->busy = 0;
+        platform_cond_broadcast(&buffer->cond);
+    }
+    platform_mutex_unlock(&buffer->mutex);
+}
+
+int replay_buffer_init(replay_buffer_t* buffer, const replay_config_t* config) {
+    if (!buffer || !config) return -1;
+    memset(buffer, 0, sizeof(replay_buffer_t));
+    if (config->budget_bytes == 0 || (!config->video && !config->audio)) {
+        fprintf(stderr, "Replay: Invalid configuration\n");
+        return -1;
+    }
+    buffer->config = *config;
+    if (buffer->config.max_packets == 0) buffer->config.max_packets = REPLAY_DEFAULT_MAX_PACKETS;
+
+    buffer->data = (uint8_t*)malloc(buffer->config.budget_bytes);
+    buffer->packets = (replay_packet_t*)calloc(buffer->config.max_packets, sizeof(replay_packet_t));
+    buffer->keyframes = (uint64_t*)calloc(buffer->config.max_packets, sizeof(uint64_t));
+    if (!buffer->data || !buffer->packets || !buffer->keyframes) {
+        fprintf(stderr, "Replay: Failed to allocate %zu bytes\n", buffer->config.budget_bytes);
+        replay_buffer_cleanup(buffer);
+        return -1;
+    }
+
+    int mutex_ok = platform_mutex_init(&buffer->mutex) == 0;
+    int cond_ok = mutex_ok && platform_cond_init(&buffer->cond) == 0;
+    if (!cond_ok || platform_thread_create(&buffer->thread, replay_saver, buffer) != 0) {
+        fprintf(stderr, "Replay: Failed to start the saver thread\n");
+        if (cond_ok) platform_cond_destroy(&buffer->cond);
+        if (mutex_ok) platform_mutex_destroy(&buffer->mutex);
+        replay_buffer_cleanup(buffer);
+        return -1;
+    }
+    buffer->thread_started = 1;
+    return 0;
+}
+
+int replay_buffer_save(replay_buffer_t* buffer, const char* path, replay_save_result_t* result) {
+    if (!buffer || !buffer->thread_started || !path) return -1;
+    replay_save_result_t local;
+    if (!result) result = &local;
+    memset(result, 0, sizeof(replay_save_result_t));
+    uint64_t started = platform_time_ns();
+
+    // One save at a time; the range is what the buffer holds now
+    platform_mutex_lock(&buffer->mutex);
+    while (buffer->saving) platform_cond_wait(&buffer->cond, &buffer->mutex);
+    uint64_t start = buffer->head;
+    uint64_t end = buffer->tail_sequence;
+    uint64_t keyframe = 0;
+    int64_t keyframe_time = 0;
+    int64_t origin = 0;
+    int empty = start == end;
+    if (buffer->config.video) {
+        empty = buffer->keyframe_count == 0;
+        if (!empty) {
+            keyframe = replay_first_keyframe(buffer);
+            keyframe_time = replay_packet(buffer, keyframe)->time;
+            origin = keyframe_time;
+        }
+    }
+    // Audio that is already playing at the first keyframe starts the file
+    for (uint64_t sequence = start; sequence < end && !empty; sequence++) {
+        const replay_packet_t* packet = replay_packet(buffer, sequence);
+        if (packet->type != REPLAY_PACKET_AUDIO) continue;
+        if (buffer->config.video && packet->time + packet->duration <= keyframe_time) continue;
+        if (!buffer->config.video || packet->time < origin) origin = packet->time;
+        break;
+    }
+    if (empty) {
+        platform_mutex_unlock(&buffer->mutex);
+        fprintf(stderr, "Replay: Nothing to save yet\n");
+        return -1;
+    }
+    buffer->saving = 1;
+    buffer->save_cursor = start;
+    platform_mutex_unlock(&buffer->mutex);
+
+    // Packets in [save_cursor, end) stay put until written; reading them needs no lock
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { buffer->config.video, buffer->config.audio, 0, 0, 0, 0, buffer->config.frame_duration, 0 };
+    int status = fmp4_muxer_open(&muxer, &config, path);
+    int64_t end_time = origin;
+    for (uint64_t sequence = start; sequence < end && status == 0; sequence++) {
+        platform_mutex_lock(&buffer->mutex);
+        replay_packet_t packet = *replay_packet(buffer, sequence);
+        platform_mutex_unlock(&buffer->mutex);
+
+        const uint8_t* data = buffer->data + packet.offset;
+        if (packet.type == REPLAY_PACKET_VIDEO && sequence >= keyframe) {
+            status = fmp4_muxer_write_video(&muxer, data, packet.size, packet.time - origin);
+            result->video_frames++;
+        } else if (packet.type == REPLAY_PACKET_AUDIO &&
+                   (!buffer->config.video || packet.time + packet.duration > keyframe_time)) {
+            status = fmp4_muxer_write_audio(&muxer, data, packet.size);
+            result->audio_frames++;
+        }
+        if (packet.time + packet.duration > end_time) end_time = packet.time + packet.duration;
+
+        platform_mutex_lock(&buffer->mutex);
+        buffer->save_cursor = sequence + 1;
+        platform_mutex_unlock(&buffer->mutex);
+    }
+    if (status == 0) status = fmp4_muxer_finish(&muxer);
+    result->bytes_written = muxer.stats.bytes_written;
+    if (status == 0 && buffer->config.video && muxer.stats.video_frames == 0) status = -1;
+    fmp4_muxer_cleanup(&muxer);
+    if (status != 0) {
+        fprintf(stderr, "Replay: Failed to write %s\n", path);
+        remove(path);
+    }
+
+    result->start_time = origin;
+    if (buffer->config.video) end_time += config.frame_duration ? config.frame_duration : REPLAY_UNITS_PER_SECOND / 30;
+    result->duration = end_time - origin;
+
+    platform_mutex_lock(&buffer->mutex);
+    buffer->saving = 0;
+    if (status == 0) {
+        buffer->stats.saves++;
+        buffer->stats.last_save_duration = result->duration;
+    } else {
+        buffer->stats.save_failures++;
+    }
+    buffer->stats.last_save_ns = platform_time_ns() - started;
+    platform_cond_broadcast(&buffer->cond);
+    platform_mutex_unlock(&buffer->mutex);
+    return status;
+}
+
+int replay_buffer_request_save(replay_buffer_t* buffer, const char* path) {
+    if (!buffer || !buffer->thread_started || !path || strlen(path) >= REPLAY_MAX_PATH) return -1;
+    platform_mutex_lock(&buffer->mutex);
+    if (buffer->request_count == REPLAY_MAX_REQUESTS) {
+        platform_mutex_unlock(&buffer->mutex);
+        fprintf(stderr, "Replay: %d saves already waiting\n", REPLAY_MAX_REQUESTS);
+        return -1;
+    }
+    strcpy(buffer->requests[buffer->request_count++], path);
+    platform_cond_broadcast(&buffer->cond);
+    platform_mutex_unlock(&buffer->mutex);
+    return 0;
+}
+
+void replay_buffer_wait_saves(replay_buffer_t* buffer) {
+    if (!buffer || !buffer->thread_started) return;
+    platform_mutex_lock(&buffer->mutex);
+    while (buffer->request_count > 0 || buffer->busy) platform_cond_wait(&buffer->cond, &buffer->mutex);
+    platform_mutex_unlock(&buffer->mutex);
+}
+
+int64_t replay_buffer_duration(replay_buffer_t* buffer) {
+    if (!buffer || !buffer->thread_started) return 0;
+    platform_mutex_lock(&buffer->mutex);
+    int64_t duration = 0;
+    if (buffer->config.video && buffer->keyframe_count > 0) {
+        duration = buffer->last_time - replay_packet(buffer, replay_first_keyframe(buffer))->time;
+    } else if (!buffer->config.video && buffer->head != buffer->tail_sequence) {
+        duration = buffer->last_time - replay_packet(buffer, buffer->head)->time;
+    }
+    platform_mutex_unlock(&buffer->mutex);
+    return duration;
+}
+
+size_t replay_buffer_bytes(replay_buffer_t* buffer) {
+    if (!buffer || !buffer->thread_started) return 0;
+    platform_mutex_lock(&buffer->mutex);
+    size_t used = buffer->used;
+    platform_mutex_unlock(&buffer->mutex);
+    return used;
+}
+
+void replay_buffer_get_stats(replay_buffer_t* buffer, replay_stats_t* stats) {
+    if (!buffer || !stats) return;
+    if (!buffer->thread_started) {
+        memset(stats, 0, sizeof(replay_stats_t));
+        return;
+    }
+    platform_mutex_lock(&buffer->mutex);
+    *stats = buffer->stats;
+    platform_mutex_unlock(&buffer->mutex);
+}
+
+void replay_buffer_report(replay_buffer_t* buffer, replay_report_fn report) {
+    if (!buffer || !report || !buffer->thread_started) return;
+    replay_stats_t stats;
+    replay_buffer_get_stats(buffer, &stats);
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Replay buffer: %.1f s held in %zu of %zu KB (peak %zu KB), %llu GOPs evicted; %llu saves, %llu failed; "
+             "dropped %llu oversize, %llu while saving",
+             replay_buffer_duration(buffer) / (double)REPLAY_UNITS_PER_SECOND, replay_buffer_bytes(buffer) / 1024,
+             buffer->config.budget_bytes / 1024, stats.peak_bytes / 1024, (unsigned long long)stats.gops_evicted,
+             (unsigned long long)stats.saves, (unsigned long long)stats.save_failures,
+             (unsigned long long)stats.dropped_oversize, (unsigned long long)stats.dropped_while_saving);
+    report(message);
+}
+
+void replay_buffer_cleanup(replay_buffer_t* buffer) {
+    if (!buffer) return;
+    if (buffer->thread_started) {
+        // Requested saves are written before the thread exits
+        platform_mutex_lock(&buffer->mutex);
+        buffer->stopping = 1;
+        platform_cond_broadcast(&buffer->cond);
+        platform_mutex_unlock(&buffer->mutex);
+        platform_thread_join(buffer->thread);
+        platform_cond_destroy(&buffer->cond);
+        platform_mutex_destroy(&buffer->mutex);
+    }
+    free(buffer->data);
+    free(buffer->packets);
+    free(buffer->keyframes);
+    memset(buffer, 0, sizeof(replay_buffer_t));
+}
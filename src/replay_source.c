@@ -0,0 +1,192 @@
+#include "replay_source.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    FILE* file;
+    int loop;
+    size_t row_bytes;
+    uint64_t frames_read;           // Frames read since the last rewind
+    uint64_t rewinds;
+} replay_state_t;
+
+static void replay_put_u32(uint8_t* dst, uint32_t value) {
+    for (int i = 0; i < 4; i++) dst[i] = (uint8_t)(value >> (i * 8));
+}
+
+static uint32_t replay_get_u32(const uint8_t* src) {
+    return (uint32_t)src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+int replay_writer_open(replay_writer_t* writer, const char* path, int width, int height, int fps) {
+    if (!writer || !path) return -1;
+    memset(writer, 0, sizeof(replay_writer_t));
+    if (width <= 0 || height <= 0 || width > REPLAY_MAX_DIMENSION || height > REPLAY_MAX_DIMENSION || fps < 0) return -1;
+
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        fprintf(stderr, "Replay: Failed to create %s\n", path);
+        return -1;
+    }
+
+    uint8_t header[REPLAY_FILE_HEADER_SIZE] = {0};
+    memcpy(header, REPLAY_FILE_MAGIC, 8);
+    replay_put_u32(header + 8, REPLAY_FILE_VERSION);
+    replay_put_u32(header + 12, (uint32_t)width);
+    replay_put_u32(header + 16, (uint32_t)height);
+    replay_put_u32(header + 20, (uint32_t)fps);
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return -1;
+    }
+
+    writer->width = width;
+    writer->height = height;
+    return 0;
+}
+
+int replay_writer_append(replay_writer_t* writer, const uint8_t* pixels, size_t pitch) {
+    if (!writer || !writer->file || !pixels || pitch < (size_t)writer->width * 4) return -1;
+
+    size_t row_bytes = (size_t)writer->width * 4;
+    for (int y = 0; y < writer->height; y++) {
+        if (fwrite(pixels + (size_t)y * pitch, 1, row_bytes, writer->file) != row_bytes) return -1;
+    }
+    writer->frames++;
+    return 0;
+}
+
+int replay_writer_close(replay_writer_t* writer) {
+    if (!writer || !writer->file) return -1;
+    int result = fclose(writer->file) == 0 ? 0 : -1;
+    writer->file = NULL;
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Source
+// ---------------------------------------------------------------------------
+
+// Read one frame into dst; returns 1 on success, 0 at end of file, -1 on error
+static int replay_read_frame(capture_source_t* source, replay_state_t* state, uint8_t* dst, int top_down) {
+    for (int y = 0; y < source->height; y++) {
+        uint8_t* row = dst + (size_t)(top_down ? y : source->height - 1 - y) * state->row_bytes;
+        size_t read = fread(row, 1, state->row_bytes, state->file);
+        if (read != state->row_bytes) {
+            // A truncated last frame is treated as the end of the file
+            return ferror(state->file) ? -1 : 0;
+        }
+    }
+    return 1;
+}
+
+static int replay_get_frame(capture_source_t* source, frame_handle_t* frame, int top_down) {
+    replay_state_t* state = (replay_state_t*)source->impl;
+    if (source->finished) return CAPTURE_FRAME_NONE;
+
+    frame_handle_t handle = frame_pool_acquire(source->pool);
+    if (handle == FRAME_HANDLE_INVALID) return CAPTURE_FRAME_NONE;
+    uint8_t* dst = (uint8_t*)frame_pool_data(source->pool, handle);
+
+    int result = replay_read_frame(source, state, dst, top_down);
+    if (result == 0 && state->loop && state->frames_read > 0) {
+        clearerr(state->file);
+        if (fseek(state->file, REPLAY_FILE_HEADER_SIZE, SEEK_SET) == 0) {
+            state->frames_read = 0;
+            state->rewinds++;
+            result = replay_read_frame(source, state, dst, top_down);
+        } else {
+            result = -1;
+        }
+    }
+
+    if (result <= 0) {
+        frame_pool_release(source->pool, handle);
+        if (result < 0) {
+            fprintf(stderr, "Replay: Read error after %llu frames\n", (unsigned long long)state->frames_read);
+            return -1;
+        }
+        source->finished = 1;
+        return CAPTURE_FRAME_NONE;
+    }
+
+    state->frames_read++;
+    *frame = handle;
+    return CAPTURE_FRAME_NEW;
+}
+
+static void replay_report(capture_source_t* source, capture_report_fn report) {
+    replay_state_t* state = (replay_state_t*)source->impl;
+    char message[128];
+    snprintf(message, sizeof(message), "Replay source: %llu frames delivered, %llu rewinds",
+             (unsigned long long)source->frames_delivered, (unsigned long long)state->rewinds);
+    report(message);
+}
+
+static void replay_destroy(capture_source_t* source) {
+    replay_state_t* state = (replay_state_t*)source->impl;
+    if (!state) return;
+    if (state->file) fclose(state->file);
+    free(state);
+    source->impl = NULL;
+}
+
+static const capture_source_ops_t replay_ops = {
+    "replay",
+    NULL,
+    NULL,
+    replay_get_frame,
+    NULL,
+    replay_report,
+    replay_destroy
+};
+
+int replay_source_create(capture_source_t* source, const char* path, int loop) {
+    if (!source || !path) return -1;
+    memset(source, 0, sizeof(capture_source_t));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Replay: Cannot open %s\n", path);
+        return -1;
+    }
+
+    uint8_t header[REPLAY_FILE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, REPLAY_FILE_MAGIC, 8) != 0) {
+        fprintf(stderr, "Replay: %s is not a raw frame file\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    uint32_t version = replay_get_u32(header + 8);
+    uint32_t width = replay_get_u32(header + 12);
+    uint32_t height = replay_get_u32(header + 16);
+    uint32_t fps = replay_get_u32(header + 20);
+    if (version != REPLAY_FILE_VERSION || width == 0 || height == 0 ||
+        width > REPLAY_MAX_DIMENSION || height > REPLAY_MAX_DIMENSION || fps > 1000) {
+        fprintf(stderr, "Replay: Unsupported header in %s (version %u, %ux%u)\n", path, version, width, height);
+        fclose(file);
+        return -1;
+    }
+
+    replay_state_t* state = (replay_state_t*)calloc(1, sizeof(replay_state_t));
+    if (!state) {
+        fclose(file);
+        return -1;
+    }
+    state->file = file;
+    state->loop = loop;
+    state->row_bytes = (size_t)width * 4;
+
+    source->ops = &replay_ops;
+    source->impl = state;
+    source->width = (int)width;
+    source->height = (int)height;
+    source->fps = (int)fps;
+    return 0;
+}
@@ -0,0 +1,545 @@
+#include "scaler.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCALER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCALER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SCALER_TARGET(isa)
+#endif
+
+// The vertical pass keeps 7 fractional bits so the intermediate row still fits
+// signed 16-bit lanes (255 << 7 = 32640) for the horizontal multiply-add
+#define SCALER_ROW_SHIFT 7
+#define SCALER_OUT_SHIFT (2 * SCALER_WEIGHT_BITS - SCALER_ROW_SHIFT)
+
+// Output rows per slice below which spreading over workers costs more than it saves
+#define SCALER_MIN_SLICE_ROWS 16
+
+static uint8_t scaler_clamp_u8(int32_t value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+// ---------------------------------------------------------------------------
+// Filter weights
+// ---------------------------------------------------------------------------
+
+static void scaler_axis_free(scaler_axis_t* axis) {
+    free(axis->spans);
+    free(axis->weights);
+    memset(axis, 0, sizeof(scaler_axis_t));
+}
+
+// Round the taps of a span to fixed point so they sum to exactly SCALER_WEIGHT_ONE
+static void scaler_normalize_span(int16_t* taps, const double* exact, int count) {
+    int sum = 0;
+    int largest = 0;
+    for (int t = 0; t < count; t++) {
+        taps[t] = (int16_t)(exact[t] * SCALER_WEIGHT_ONE + 0.5);
+        sum += taps[t];
+        if (taps[t] > taps[largest]) largest = t;
+    }
+    taps[largest] = (int16_t)(taps[largest] + SCALER_WEIGHT_ONE - sum);
+}
+
+// Area weights: output pixel i covers source interval [i*src/dst, (i+1)*src/dst),
+// and each source pixel contributes by its overlap. Computed in units of
+// 1/dst so the interval ends are exact integers.
+static int scaler_axis_area(scaler_axis_t* axis, int src, int dst) {
+    int max_taps = (src + dst - 1) / dst + 1;
+    axis->spans = (scaler_span_t*)calloc((size_t)dst, sizeof(scaler_span_t));
+    axis->weights = (int16_t*)calloc((size_t)dst * max_taps, sizeof(int16_t));
+    double* exact = (double*)malloc((size_t)max_taps * sizeof(double));
+    if (!axis->spans || !axis->weights || !exact) {
+        free(exact);
+        return -1;
+    }
+
+    int offset = 0;
+    for (int i = 0; i < dst; i++) {
+        long long begin = (long long)i * src;
+        long long end = begin + src;
+        int first = (int)(begin / dst);
+        int last = (int)((end - 1) / dst);
+        int count = last - first + 1;
+
+        for (int t = 0; t < count; t++) {
+            long long pixel_begin = (long long)(first + t) * dst;
+            long long pixel_end = pixel_begin + dst;
+            long long lo = pixel_begin > begin ? pixel_begin : begin;
+            long long hi = pixel_end < end ? pixel_end : end;
+            exact[t] = (double)(hi - lo) / (double)src;
+        }
+
+        axis->spans[i].start = first;
+        axis->spans[i].count = count;
+        axis->spans[i].offset = offset;
+        scaler_normalize_span(axis->weights + offset, exact, count);
+        offset += count;
+        if (count > axis->max_taps) axis->max_taps = count;
+    }
+
+    free(exact);
+    return 0;
+}
+
+// Bilinear weights with pixel centres aligned: output i samples source
+// position (i + 0.5) * src / dst - 0.5, clamped at the edges
+static int scaler_axis_bilinear(scaler_axis_t* axis, int src, int dst) {
+    axis->spans = (scaler_span_t*)calloc((size_t)dst, sizeof(scaler_span_t));
+    axis->weights = (int16_t*)calloc((size_t)dst * 2, sizeof(int16_t));
+    if (!axis->spans || !axis->weights) return -1;
+
+    int offset = 0;
+    for (int i = 0; i < dst; i++) {
+        // Position in units of 1/(2*dst): (2i + 1) * src - dst
+        long long numerator = (long long)(2 * i + 1) * src - dst;
+        long long denominator = 2LL * dst;
+        long long k0 = numerator >= 0 ? numerator / denominator : -1;
+        double frac = (double)(numerator - k0 * denominator) / (double)denominator;
+
+        scaler_span_t* span = &axis->spans[i];
+        span->offset = offset;
+        if (k0 < 0) {
+            span->start = 0;
+            span->count = 1;
+            axis->weights[offset] = SCALER_WEIGHT_ONE;
+        } else if (k0 >= src - 1) {
+            span->start = src - 1;
+            span->count = 1;
+            axis->weights[offset] = SCALER_WEIGHT_ONE;
+        } else {
+            double exact[2] = { 1.0 - frac, frac };
+            span->start = (int)k0;
+            span->count = 2;
+            scaler_normalize_span(axis->weights + offset, exact, 2);
+        }
+        offset += span->count;
+        if (span->count > axis->max_taps) axis->max_taps = span->count;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// 2x2 box kernels: dst pixel = rounded mean of a 2x2 source block
+// ---------------------------------------------------------------------------
+
+typedef int (*scaler_box2_fn)(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int dst_width);
+
+// Returns the number of output pixels written; the caller finishes the tail
+static int scaler_box2_row_scalar(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int dst_width) {
+    for (int x = 0; x < dst_width; x++) {
+        const uint8_t* a = row0 + (size_t)x * 8;
+        const uint8_t* b = row1 + (size_t)x * 8;
+        for (int c = 0; c < 4; c++) {
+            dst[(size_t)x * 4 + c] = (uint8_t)((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+        }
+    }
+    return dst_width;
+}
+
+#ifdef SCALER_X86
+
+SCALER_TARGET("sse2")
+static __m128i scaler_box2_sse2_quad(const uint8_t* row0, const uint8_t* row1) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128((const __m128i*)row0);
+    __m128i b = _mm_loadu_si128((const __m128i*)row1);
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));  // p0, p1
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));  // p2, p3
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi)); // p0+p1, p2+p3
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+SCALER_TARGET("sse2")
+static int scaler_box2_row_sse2(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int dst_width) {
+    int x = 0;
+    for (; x + 4 <= dst_width; x += 4) {
+        __m128i first = scaler_box2_sse2_quad(row0 + (size_t)x * 8, row1 + (size_t)x * 8);
+        __m128i second = scaler_box2_sse2_quad(row0 + (size_t)x * 8 + 16, row1 + (size_t)x * 8 + 16);
+        _mm_storeu_si128((__m128i*)(dst + (size_t)x * 4), _mm_packus_epi16(first, second));
+    }
+    return x;
+}
+
+SCALER_TARGET("avx2")
+static __m256i scaler_box2_avx2_oct(const uint8_t* row0, const uint8_t* row1) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a = _mm256_loadu_si256((const __m256i*)row0);
+    __m256i b = _mm256_loadu_si256((const __m256i*)row1);
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));  // p0,p1 | p4,p5
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));  // p2,p3 | p6,p7
+    __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+SCALER_TARGET("avx2")
+static int scaler_box2_row_avx2(uint8_t* dst, const uint8_t* row0, const uint8_t* row1, int dst_width) {
+    int x = 0;
+    for (; x + 8 <= dst_width; x += 8) {
+        __m256i first = scaler_box2_avx2_oct(row0 + (size_t)x * 8, row1 + (size_t)x * 8);
+        __m256i second = scaler_box2_avx2_oct(row0 + (size_t)x * 8 + 32, row1 + (size_t)x * 8 + 32);
+        // packus works per 128-bit lane; restore pixel order across lanes
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8);
+        _mm256_storeu_si256((__m256i*)(dst + (size_t)x * 4), packed);
+    }
+    return x;
+}
+
+#endif // SCALER_X86
+
+// ---------------------------------------------------------------------------
+// Separable filter kernels
+// ---------------------------------------------------------------------------
+
+// Vertical pass: weighted sum of source rows into a 16-bit intermediate row.
+// Returns the number of channel elements written; the caller finishes the tail.
+typedef int (*scaler_vertical_fn)(int16_t* out, const uint8_t* const* rows, const int16_t* weights, int taps, int elements);
+
+static void scaler_vertical_tail(int16_t* out, const uint8_t* const* rows, const int16_t* weights, int taps, int begin, int elements) {
+    for (int c = begin; c < elements; c++) {
+        int32_t acc = 0;
+        for (int t = 0; t < taps; t++) acc += weights[t] * rows[t][c];
+        out[c] = (int16_t)((acc + (1 << (SCALER_ROW_SHIFT - 1))) >> SCALER_ROW_SHIFT);
+    }
+}
+
+static int scaler_vertical_scalar(int16_t* out, const uint8_t* const* rows, const int16_t* weights, int taps, int elements) {
+    scaler_vertical_tail(out, rows, weights, taps, 0, elements);
+    return elements;
+}
+
+// Horizontal pass: weighted sum of intermediate pixels into one BGRA output pixel
+typedef void (*scaler_horizontal_fn)(uint8_t* dst, const int16_t* row, const scaler_axis_t* axis, int dst_width);
+
+static void scaler_horizontal_scalar(uint8_t* dst, const int16_t* row, const scaler_axis_t* axis, int dst_width) {
+    for (int x = 0; x < dst_width; x++) {
+        const scaler_span_t* span = &axis->spans[x];
+        const int16_t* weights = axis->weights + span->offset;
+        const int16_t* px = row + (size_t)span->start * 4;
+        int32_t acc[4] = { 0, 0, 0, 0 };
+        for (int t = 0; t < span->count; t++) {
+            for (int c = 0; c < 4; c++) acc[c] += weights[t] * px[t * 4 + c];
+        }
+        for (int c = 0; c < 4; c++) {
+            dst[(size_t)x * 4 + c] = scaler_clamp_u8((acc[c] + (1 << (SCALER_OUT_SHIFT - 1))) >> SCALER_OUT_SHIFT);
+        }
+    }
+}
+
+#ifdef SCALER_X86
+
+// Weights for two taps interleaved as (w0, w1) pairs for madd
+SCALER_TARGET("sse2")
+static __m128i scaler_weight_pair_sse2(int16_t w0, int16_t w1) {
+    return _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)w1 << 16) | (uint16_t)w0));
+}
+
+SCALER_TARGET("sse2")
+static int scaler_vertical_sse2(int16_t* out, const uint8_t* const* rows, const int16_t* weights, int taps, int elements) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (SCALER_ROW_SHIFT - 1));
+    int c = 0;
+    for (; c + 16 <= elements; c += 16) {
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        for (int t = 0; t < taps; t += 2) {
+            // Odd tap counts pair the last row with itself at zero weight
+            int second = t + 1 < taps ? t + 1 : t;
+            __m128i w = scaler_weight_pair_sse2(weights[t], t + 1 < taps ? weights[t + 1] : 0);
+            __m128i a = _mm_loadu_si128((const __m128i*)(rows[t] + c));
+            __m128i b = _mm_loadu_si128((const __m128i*)(rows[second] + c));
+            __m128i ab_lo = _mm_unpacklo_epi8(a, b);
+            __m128i ab_hi = _mm_unpackhi_epi8(a, b);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(ab_lo, zero), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(ab_lo, zero), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(ab_hi, zero), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(ab_hi, zero), w));
+        }
+        acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, round), SCALER_ROW_SHIFT);
+        acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, round), SCALER_ROW_SHIFT);
+        acc2 = _mm_srai_epi32(_mm_add_epi32(acc2, round), SCALER_ROW_SHIFT);
+        acc3 = _mm_srai_epi32(_mm_add_epi32(acc3, round), SCALER_ROW_SHIFT);
+        _mm_storeu_si128((__m128i*)(out + c), _mm_packs_epi32(acc0, acc1));
+        _mm_storeu_si128((__m128i*)(out + c + 8), _mm_packs_epi32(acc2, acc3));
+    }
+    return c;
+}
+
+SCALER_TARGET("avx2")
+static int scaler_vertical_avx2(int16_t* out, const uint8_t* const* rows, const int16_t* weights, int taps, int elements) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(1 << (SCALER_ROW_SHIFT - 1));
+    int c = 0;
+    for (; c + 32 <= elements; c += 32) {
+        __m256i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        for (int t = 0; t < taps; t += 2) {
+            int second = t + 1 < taps ? t + 1 : t;
+            int16_t w1 = t + 1 < taps ? weights[t + 1] : 0;
+            __m256i w = _mm256_set1_epi32((int32_t)(((uint32_t)(uint16_t)w1 << 16) | (uint16_t)weights[t]));
+            __m256i a = _mm256_loadu_si256((const __m256i*)(rows[t] + c));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(rows[second] + c));
+            __m256i ab_lo = _mm256_unpacklo_epi8(a, b);
+            __m256i ab_hi = _mm256_unpackhi_epi8(a, b);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(ab_lo, zero), w));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(ab_lo, zero), w));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(ab_hi, zero), w));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(ab_hi, zero), w));
+        }
+        acc0 = _mm256_srai_epi32(_mm256_add_epi32(acc0, round), SCALER_ROW_SHIFT);
+        acc1 = _mm256_srai_epi32(_mm256_add_epi32(acc1, round), SCALER_ROW_SHIFT);
+        acc2 = _mm256_srai_epi32(_mm256_add_epi32(acc2, round), SCALER_ROW_SHIFT);
+        acc3 = _mm256_srai_epi32(_mm256_add_epi32(acc3, round), SCALER_ROW_SHIFT);
+        // Per-lane unpack and pack leave elements 0-7,16-23 and 8-15,24-31 together
+        __m256i p01 = _mm256_packs_epi32(acc0, acc1);
+        __m256i p23 = _mm256_packs_epi32(acc2, acc3);
+        _mm256_storeu_si256((__m256i*)(out + c), _mm256_permute2x128_si256(p01, p23, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + c + 16), _mm256_permute2x128_si256(p01, p23, 0x31));
+    }
+    return c;
+}
+
+SCALER_TARGET("sse2")
+static void scaler_horizontal_sse2(uint8_t* dst, const int16_t* row, const scaler_axis_t* axis, int dst_width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (SCALER_OUT_SHIFT - 1));
+    for (int x = 0; x < dst_width; x++) {
+        const scaler_span_t* span = &axis->spans[x];
+        const int16_t* weights = axis->weights + span->offset;
+        const int16_t* px = row + (size_t)span->start * 4;
+        __m128i acc = zero;
+        int t = 0;
+        for (; t + 2 <= span->count; t += 2) {
+            // Two pixels, interleaved per channel: (c0 t, c0 t+1, c1 t, c1 t+1, ...)
+            __m128i pair = _mm_loadu_si128((const __m128i*)(px + t * 4));
+            __m128i mixed = _mm_unpacklo_epi16(pair, _mm_srli_si128(pair, 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(mixed, scaler_weight_pair_sse2(weights[t], weights[t + 1])));
+        }
+        if (t < span->count) {
+            __m128i single = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(px + t * 4)), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(single, scaler_weight_pair_sse2(weights[t], 0)));
+        }
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, round), SCALER_OUT_SHIFT);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(acc, zero), zero);
+        int32_t value = _mm_cvtsi128_si32(packed);
+        memcpy(dst + (size_t)x * 4, &value, 4);
+    }
+}
+
+#endif // SCALER_X86
+
+typedef struct {
+    scaler_box2_fn box2;
+    scaler_vertical_fn vertical;
+    scaler_horizontal_fn horizontal;
+} scaler_kernels_t;
+
+// AVX-512 machines run the AVX2 kernels: the gather-free filters are
+// load-bound well before the extra width pays off
+static scaler_kernels_t scaler_kernels_for(copy_kernel_level_t level) {
+    scaler_kernels_t kernels = { scaler_box2_row_scalar, scaler_vertical_scalar, scaler_horizontal_scalar };
+#ifdef SCALER_X86
+    if (level >= COPY_KERNEL_AVX2) {
+        kernels.box2 = scaler_box2_row_avx2;
+        kernels.vertical = scaler_vertical_avx2;
+        kernels.horizontal = scaler_horizontal_sse2;
+    } else if (level == COPY_KERNEL_SSE2) {
+        kernels.box2 = scaler_box2_row_sse2;
+        kernels.vertical = scaler_vertical_sse2;
+        kernels.horizontal = scaler_horizontal_sse2;
+    }
+#else
+    (void)level;
+#endif
+    return kernels;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+const char* scaler_filter_name(scaler_filter_t filter) {
+    switch (filter) {
+        case SCALER_FILTER_AUTO: return "auto";
+        case SCALER_FILTER_BOX2: return "box 2:1";
+        case SCALER_FILTER_AREA: return "area";
+        case SCALER_FILTER_BILINEAR: return "bilinear";
+    }
+    return "unknown";
+}
+
+int scaler_output_size(int src_width, int src_height, double scale, int width, int height,
+                       int* out_width, int* out_height) {
+    if (src_width <= 0 || src_height <= 0 || !out_width || !out_height) return -1;
+
+    double w;
+    double h;
+    if (scale > 0.0) {
+        w = src_width * scale;
+        h = src_height * scale;
+    } else if (width > 0 && height > 0) {
+        w = width;
+        h = height;
+    } else if (width > 0) {
+        // One side given: keep the source aspect ratio
+        w = width;
+        h = (double)width * src_height / src_width;
+    } else if (height > 0) {
+        h = height;
+        w = (double)height * src_width / src_height;
+    } else {
+        return -1;
+    }
+
+    // Encoders need even dimensions for 4:2:0 chroma
+    int rw = ((int)(w + 0.5)) & ~1;
+    int rh = ((int)(h + 0.5)) & ~1;
+    if (rw < 2 || rh < 2) return -1;
+
+    *out_width = rw;
+    *out_height = rh;
+    return 0;
+}
+
+int scaler_init(scaler_t* scaler, int src_width, int src_height, int dst_width, int dst_height,
+                scaler_filter_t filter, worker_pool_t* pool) {
+    if (!scaler || src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) return -1;
+
+    memset(scaler, 0, sizeof(scaler_t));
+    scaler->src_width = src_width;
+    scaler->src_height = src_height;
+    scaler->dst_width = dst_width;
+    scaler->dst_height = dst_height;
+
+    int exact_half = src_width == dst_width * 2 && src_height == dst_height * 2;
+    if (filter == SCALER_FILTER_AUTO) {
+        if (exact_half) {
+            filter = SCALER_FILTER_BOX2;
+        } else if (dst_width <= src_width && dst_height <= src_height) {
+            filter = SCALER_FILTER_AREA;
+        } else {
+            filter = SCALER_FILTER_BILINEAR;
+        }
+    }
+    if (filter == SCALER_FILTER_BOX2 && !exact_half) {
+        fprintf(stderr, "Scaler: Box filter needs an exact 2:1 reduction (%dx%d -> %dx%d)\n",
+                src_width, src_height, dst_width, dst_height);
+        return -1;
+    }
+    scaler->filter = filter;
+    scaler->level = copy_kernels_best_level();
+
+    scaler->pool = pool;
+    scaler->workers = worker_pool_threads(pool);
+    int workers = scaler->workers;
+
+    if (filter == SCALER_FILTER_BOX2) return 0;
+
+    int result;
+    if (filter == SCALER_FILTER_AREA) {
+        result = scaler_axis_area(&scaler->horizontal, src_width, dst_width);
+        if (result == 0) result = scaler_axis_area(&scaler->vertical, src_height, dst_height);
+    } else {
+        result = scaler_axis_bilinear(&scaler->horizontal, src_width, dst_width);
+        if (result == 0) result = scaler_axis_bilinear(&scaler->vertical, src_height, dst_height);
+    }
+
+    if (result == 0) {
+        scaler->row_buffer_stride = ((size_t)src_width * 4 + 31) & ~(size_t)31;
+        scaler->row_buffers = (int16_t*)platform_aligned_alloc(scaler->row_buffer_stride * sizeof(int16_t) * (size_t)workers, 64);
+        scaler->tap_rows = (const uint8_t**)malloc((size_t)scaler->vertical.max_taps * workers * sizeof(uint8_t*));
+    }
+    if (result != 0 || !scaler->row_buffers || !scaler->tap_rows) {
+        fprintf(stderr, "Scaler: Failed to allocate %s filter for %dx%d -> %dx%d\n",
+                scaler_filter_name(filter), src_width, src_height, dst_width, dst_height);
+        scaler_cleanup(scaler);
+        return -1;
+    }
+    return 0;
+}
+
+void scaler_cleanup(scaler_t* scaler) {
+    if (!scaler) return;
+    scaler_axis_free(&scaler->horizontal);
+    scaler_axis_free(&scaler->vertical);
+    if (scaler->row_buffers) platform_aligned_free(scaler->row_buffers);
+    free((void*)scaler->tap_rows);
+    memset(scaler, 0, sizeof(scaler_t));
+}
+
+int scaler_set_level(scaler_t* scaler, copy_kernel_level_t level) {
+    if (!scaler || level < COPY_KERNEL_SCALAR || level >= COPY_KERNEL_COUNT) return -1;
+    if (!copy_kernels_supported(level)) return -1;
+    scaler->level = level;
+    return 0;
+}
+
+int scaler_process_rows(scaler_t* scaler, int worker, uint8_t* dst, size_t dst_pitch,
+                        const uint8_t* src, size_t src_pitch, int dst_row_begin, int dst_row_end) {
+    if (!scaler || !dst || !src || worker < 0 || worker >= scaler->workers) return -1;
+    if (dst_row_begin < 0 || dst_row_end > scaler->dst_height || dst_row_begin > dst_row_end) return -1;
+
+    scaler_kernels_t kernels = scaler_kernels_for(scaler->level);
+
+    if (scaler->filter == SCALER_FILTER_BOX2) {
+        for (int y = dst_row_begin; y < dst_row_end; y++) {
+            const uint8_t* row0 = src + (size_t)(2 * y) * src_pitch;
+            uint8_t* out = dst + (size_t)y * dst_pitch;
+            int done = kernels.box2(out, row0, row0 + src_pitch, scaler->dst_width);
+            scaler_box2_row_scalar(out + (size_t)done * 4, row0 + (size_t)done * 8, row0 + src_pitch + (size_t)done * 8,
+                                   scaler->dst_width - done);
+        }
+        return 0;
+    }
+
+    int16_t* row = scaler->row_buffers + (size_t)worker * scaler->row_buffer_stride;
+    int elements = scaler->src_width * 4;
+    const uint8_t** taps = scaler->tap_rows + (size_t)worker * scaler->vertical.max_taps;
+
+    for (int y = dst_row_begin; y < dst_row_end; y++) {
+        const scaler_span_t* span = &scaler->vertical.spans[y];
+        const int16_t* weights = scaler->vertical.weights + span->offset;
+        for (int t = 0; t < span->count; t++) {
+            taps[t] = src + (size_t)(span->start + t) * src_pitch;
+        }
+        int done = kernels.vertical(row, taps, weights, span->count, elements);
+        scaler_vertical_tail(row, taps, weights, span->count, done, elements);
+        kernels.horizontal(dst + (size_t)y * dst_pitch, row, &scaler->horizontal, scaler->dst_width);
+    }
+    return 0;
+}
+
+typedef struct {
+    scaler_t* scaler;
+    uint8_t* dst;
+    size_t dst_pitch;
+    const uint8_t* src;
+    size_t src_pitch;
+    int slices;
+} scaler_job_t;
+
+static int scaler_slice_task(void* context, int task, int worker) {
+    scaler_job_t* job = (scaler_job_t*)context;
+    int rows = job->scaler->dst_height;
+    return scaler_process_rows(job->scaler, worker, job->dst, job->dst_pitch, job->src, job->src_pitch,
+                               (int)((long long)rows * task / job->slices),
+                               (int)((long long)rows * (task + 1) / job->slices));
+}
+
+int scaler_process(scaler_t* scaler, uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch) {
+    if (!scaler || !dst || !src) return -1;
+
+    int slices = worker_pool_slices(scaler->pool, scaler->dst_height, SCALER_MIN_SLICE_ROWS);
+    if (!scaler->pool || slices <= 1) {
+        return scaler_process_rows(scaler, 0, dst, dst_pitch, src, src_pitch, 0, scaler->dst_height);
+    }
+
+    scaler_job_t job = { scaler, dst, dst_pitch, src, src_pitch, slices };
+    return worker_pool_run(scaler->pool, slices, scaler_slice_task, &job);
+}
@@ -1,21 +1,74 @@
 #include "screen.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// DXGI rects are handed to the dirty frame without conversion
+typedef char screen_rect_layout_check[(sizeof(RECT) == sizeof(frame_rect_t)) ? 1 : -1];
+typedef char screen_move_layout_check[(sizeof(DXGI_OUTDUPL_MOVE_RECT) == sizeof(frame_move_t)) ? 1 : -1];
+
 #ifndef UNREFERENCED_PARAMETER
 #define UNREFERENCED_PARAMETER(P) (P)
 #endif
 
+// Find an output by its position in a flat list across all adapters
+static int screen_find_output(IDXGIFactory1* factory, int monitor_index, IDXGIAdapter1** adapter_out, IDXGIOutput** output_out) {
+    int index = 0;
+    IDXGIAdapter1* adapter = NULL;
+    
+    for (UINT a = 0; IDXGIFactory1_EnumAdapters1(factory, a, &adapter) != DXGI_ERROR_NOT_FOUND; a++) {
+        IDXGIOutput* output = NULL;
+        for (UINT o = 0; IDXGIAdapter1_EnumOutputs(adapter, o, &output) != DXGI_ERROR_NOT_FOUND; o++) {
+            if (index == monitor_index) {
+                *adapter_out = adapter;
+                *output_out = output;
+                return 0;
+            }
+            IDXGIOutput_Release(output);
+            index++;
+        }
+        IDXGIAdapter1_Release(adapter);
+    }
+    
+    return -1;
+}
+
+// Number of outputs attached to the desktop across all adapters
+int screen_count_outputs(void) {
+    IDXGIFactory1* factory = NULL;
+    if (FAILED(CreateDXGIFactory1(&IID_IDXGIFactory1, (void**)&factory))) return 0;
+    
+    int count = 0;
+    IDXGIAdapter1* adapter = NULL;
+    for (UINT a = 0; IDXGIFactory1_EnumAdapters1(factory, a, &adapter) != DXGI_ERROR_NOT_FOUND; a++) {
+        IDXGIOutput* output = NULL;
+        for (UINT o = 0; IDXGIAdapter1_EnumOutputs(adapter, o, &output) != DXGI_ERROR_NOT_FOUND; o++) {
+            IDXGIOutput_Release(output);
+            count++;
+        }
+        IDXGIAdapter1_Release(adapter);
+    }
+    
+    IDXGIFactory1_Release(factory);
+    return count;
+}
+
 int screen_init(screen_capture_t* capture) {
-    if (!capture) return -1;
+    return screen_init_output(capture, 0);
+}
+
+int screen_init_output(screen_capture_t* capture, int monitor_index) {
+    if (!capture || monitor_index < 0) return -1;
     
     memset(capture, 0, sizeof(screen_capture_t));
+    cursor_compositor_init(&capture->cursor);
     
     HRESULT hr;
     IDXGIFactory1* factory = NULL;
     IDXGIAdapter1* adapter = NULL;
     IDXGIOutput* output = NULL;
     IDXGIOutput1* output1 = NULL;
+    DXGI_OUTPUT_DESC output_desc;
     D3D_FEATURE_LEVEL feature_level;
     
     hr = CreateDXGIFactory1(&IID_IDXGIFactory1, (void**)&factory);
@@ -24,20 +77,18 @@ int screen_init(screen_capture_t* capture) {
         return -1;
     }
     
-    hr = IDXGIFactory1_EnumAdapters1(factory, 0, &adapter);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to enumerate adapters: 0x%08X\n", hr);
+    if (screen_find_output(factory, monitor_index, &adapter, &output) != 0) {
+        fprintf(stderr, "Monitor %d not found (%d monitors attached)\n", monitor_index, screen_count_outputs());
         IDXGIFactory1_Release(factory);
         return -1;
     }
     
-    hr = IDXGIAdapter1_EnumOutputs(adapter, 0, &output);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to enumerate outputs: 0x%08X\n", hr);
-        IDXGIAdapter1_Release(adapter);
-        IDXGIFactory1_Release(factory);
-        return -1;
-    }
+    IDXGIOutput_GetDesc(output, &output_desc);
+    capture->monitor_index = monitor_index;
+    capture->output_bounds.x = output_desc.DesktopCoordinates.left;
+    capture->output_bounds.y = output_desc.DesktopCoordinates.top;
+    capture->output_bounds.width = output_desc.DesktopCoordinates.right - output_desc.DesktopCoordinates.left;
+    capture->output_bounds.height = output_desc.DesktopCoordinates.bottom - output_desc.DesktopCoordinates.top;
     
     hr = IDXGIOutput_QueryInterface(output, &IID_IDXGIOutput1, (void**)&output1);
     if (FAILED(hr)) {
@@ -48,6 +99,7 @@ int screen_init(screen_capture_t* capture) {
         return -1;
     }
     
+    // The device must live on the adapter that drives this output
     hr = D3D11CreateDevice(
         (IDXGIAdapter*)adapter,
         D3D_DRIVER_TYPE_UNKNOWN,
@@ -85,8 +137,10 @@ int screen_init(screen_capture_t* capture) {
     IDXGIOutputDuplication_GetDesc(capture->duplication, &capture->duplication_desc);
     capture->width = capture->duplication_desc.ModeDesc.Width;
     capture->height = capture->duplication_desc.ModeDesc.Height;
+    capture_region_full(&capture->region, capture->width, capture->height);
     
-    printf("Screen capture initialized: %dx%d\n", capture->width, capture->height);
+    printf("Screen capture initialized: monitor %d, %dx%d at %d,%d\n", monitor_index,
+           capture->width, capture->height, capture->output_bounds.x, capture->output_bounds.y);
     
     // Cleanup temporary objects
     IDXGIOutput1_Release(output1);
@@ -97,24 +151,207 @@ int screen_init(screen_capture_t* capture) {
     return 0;
 }
 
+// Attach the frame pool that captured frames are written into
+void screen_set_frame_pool(screen_capture_t* capture, frame_pool_t* pool) {
+    if (!capture) return;
+    
+    capture->frame_pool = pool;
+    capture->has_previous_frame = FALSE;
+    
+    // Pool frames start out with unknown contents and need a full copy
+    free(capture->slot_generation);
+    free(capture->slot_cursor);
+    capture->slot_generation = NULL;
+    capture->slot_cursor = NULL;
+    if (pool && pool->capacity > 0) {
+        capture->slot_generation = (uint64_t*)calloc((size_t)pool->capacity, sizeof(uint64_t));
+        capture->slot_cursor = (frame_rect_t*)calloc((size_t)pool->capacity, sizeof(frame_rect_t));
+    }
+}
+
+// Blend the mouse pointer into delivered frames
+void screen_set_cursor(screen_capture_t* capture, BOOL enabled) {
+    if (capture) capture->cursor_enabled = enabled;
+}
+
+// Restrict capture to part of the desktop; must be called before screen_start_capture.
+// The region is clipped to the desktop and its size rounded down to the codec alignment.
+int screen_set_region(screen_capture_t* capture, int x, int y, int width, int height) {
+    if (!capture || !capture->duplication || capture->is_capturing || capture->staging[0]) return -1;
+    
+    capture_region_t region = { x, y, width, height };
+    if (capture_region_resolve(&region, capture->width, capture->height) != 0) return -1;
+    
+    if (region.x != x || region.y != y || region.width != width || region.height != height) {
+        printf("Capture region adjusted to %d,%d %dx%d\n", region.x, region.y, region.width, region.height);
+    }
+    capture->region = region;
+    return 0;
+}
+
 int screen_start_capture(screen_capture_t* capture) {
     if (!capture || !capture->duplication) return -1;
     
+    // Without a pool the capture only feeds screen_capture_into (virtual desktop outputs)
+    if (capture->frame_pool && (!capture->slot_generation || !capture->slot_cursor)) return -1;
+    if (capture->frame_pool &&
+        (size_t)capture->region.width * capture->region.height * 4 > frame_pool_frame_size(capture->frame_pool)) {
+        fprintf(stderr, "Capture region (%dx%d) exceeds frame pool buffers\n", capture->region.width, capture->region.height);
+        return -1;
+    }
+    
+    // Persistent region-sized staging ring; each slot receives the dirty rects of one update
+    if (!capture->staging[0]) {
+        if (readback_ring_init(&capture->readback_ring, READBACK_RING_DEFAULT_DEPTH, READBACK_RING_DEFAULT_LATENCY) != 0) {
+            return -1;
+        }
+        
+        D3D11_TEXTURE2D_DESC staging_desc;
+        memset(&staging_desc, 0, sizeof(staging_desc));
+        staging_desc.Width = capture->region.width;
+        staging_desc.Height = capture->region.height;
+        staging_desc.MipLevels = 1;
+        staging_desc.ArraySize = 1;
+        staging_desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        staging_desc.SampleDesc.Count = 1;
+        staging_desc.Usage = D3D11_USAGE_STAGING;
+        staging_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        
+        for (int i = 0; i < capture->readback_ring.depth; i++) {
+            HRESULT hr = ID3D11Device_CreateTexture2D(capture->device, &staging_desc, NULL, &capture->staging[i]);
+            if (FAILED(hr)) {
+                fprintf(stderr, "Failed to create staging texture: 0x%08X\n", hr);
+                return -1;
+            }
+        }
+    }
+    
+    if (!capture->dirty_frame.pixels && dirty_frame_init(&capture->dirty_frame, capture->region.width, capture->region.height) != 0) {
+        return -1;
+    }
+    
     capture->is_capturing = TRUE;
     printf("Screen capture started\n");
     return 0;
 }
 
-// Enhanced frame capture with dual-track mode awareness to fix video flipping issue
-int screen_get_frame_dual_track(screen_capture_t* capture, void** frame_data, size_t* frame_size, BOOL dual_track_mode) {
-    if (!capture || !capture->duplication || !capture->is_capturing) return -1;
+// Track the pointer shape and position reported with a frame. Failures only
+// cost the cursor, never the desktop image.
+static void screen_update_pointer(screen_capture_t* capture, const DXGI_OUTDUPL_FRAME_INFO* frame_info) {
+    if (frame_info->PointerShapeBufferSize > 0) {
+        if (frame_info->PointerShapeBufferSize > capture->pointer_shape_capacity) {
+            BYTE* grown = (BYTE*)realloc(capture->pointer_shape, frame_info->PointerShapeBufferSize);
+            if (grown) {
+                capture->pointer_shape = grown;
+                capture->pointer_shape_capacity = frame_info->PointerShapeBufferSize;
+            }
+        }
+        
+        DXGI_OUTDUPL_POINTER_SHAPE_INFO shape_info;
+        UINT required = 0;
+        if (capture->pointer_shape && frame_info->PointerShapeBufferSize <= capture->pointer_shape_capacity &&
+            SUCCEEDED(IDXGIOutputDuplication_GetFramePointerShape(capture->duplication, capture->pointer_shape_capacity,
+                                                                  capture->pointer_shape, &required, &shape_info))) {
+            cursor_compositor_set_shape(&capture->cursor, (cursor_shape_type_t)shape_info.Type, capture->pointer_shape,
+                                        (int)shape_info.Width, (int)shape_info.Height, (int)shape_info.Pitch,
+                                        shape_info.HotSpot.x, shape_info.HotSpot.y);
+        }
+    }
+    
+    // Position is only reported when the mouse moved; it is relative to the output
+    if (frame_info->LastMouseUpdateTime.QuadPart != 0) {
+        cursor_compositor_set_position(&capture->cursor,
+                                       frame_info->PointerPosition.Position.x - capture->region.x,
+                                       frame_info->PointerPosition.Position.y - capture->region.y,
+                                       frame_info->PointerPosition.Visible);
+    }
+}
+
+// Map the staging slot holding the oldest update and apply it to the dirty
+// frame. Without wait a copy the GPU is still running is left for later.
+// Returns 0 when applied, 1 when deferred, -1 on error.
+static int screen_retire_readback(screen_capture_t* capture, int slot, BOOL wait) {
+    screen_readback_t* update = &capture->readback[slot];
+    int result;
+    
+    // Move-only updates never touch the staging texture, so skip the map entirely
+    if (!update->full && update->dirty_count == 0) {
+        result = dirty_frame_apply(&capture->dirty_frame, NULL, 0, update->moves, update->move_count, NULL, 0);
+        readback_ring_retire(&capture->readback_ring, 0);
+    } else {
+        D3D11_MAPPED_SUBRESOURCE mapped_resource;
+        BOOL stalled = FALSE;
+        ID3D11Resource* staging = (ID3D11Resource*)capture->staging[slot];
+        
+        HRESULT hr = ID3D11DeviceContext_Map(capture->context, staging, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped_resource);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING) {
+            if (!wait) {
+                readback_ring_defer(&capture->readback_ring);
+                return 1;
+            }
+            stalled = TRUE;
+            hr = ID3D11DeviceContext_Map(capture->context, staging, 0, D3D11_MAP_READ, 0, &mapped_resource);
+        }
+        if (FAILED(hr)) {
+            fprintf(stderr, "Failed to map staging texture: 0x%08X\n", hr);
+            return -1;
+        }
+        
+        const uint8_t* src = (const uint8_t*)mapped_resource.pData;
+        if (update->full) {
+            result = dirty_frame_full_update(&capture->dirty_frame, src, mapped_resource.RowPitch);
+        } else {
+            result = dirty_frame_apply(&capture->dirty_frame, src, mapped_resource.RowPitch,
+                                       update->moves, update->move_count, update->dirty, update->dirty_count);
+        }
+        
+        ID3D11DeviceContext_Unmap(capture->context, staging, 0);
+        readback_ring_retire(&capture->readback_ring, stalled);
+    }
     
+    if (result != 0) {
+        fprintf(stderr, "Failed to apply desktop update\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Apply the staged updates the ring says are due. When idle (no new update
+// this poll) finished copies are picked up early, without waiting on the GPU.
+static int screen_drain_readback(screen_capture_t* capture, BOOL idle) {
+    int slot;
+    readback_action_t action;
+    
+    while ((action = readback_ring_next(&capture->readback_ring, idle, &slot)) != READBACK_IDLE) {
+        int result = screen_retire_readback(capture, slot, action == READBACK_WAIT);
+        if (result < 0) return -1;
+        if (result > 0) break; // Still copying; the next poll tries again
+    }
+    return 0;
+}
+
+// Grow a staging slot's rect lists to hold count entries
+static int screen_reserve_readback(screen_readback_t* update, int count) {
+    if (count <= update->capacity) return 0;
+    
+    frame_move_t* moves = (frame_move_t*)realloc(update->moves, (size_t)count * sizeof(frame_move_t));
+    if (moves) update->moves = moves;
+    frame_rect_t* dirty = (frame_rect_t*)realloc(update->dirty, (size_t)count * sizeof(frame_rect_t));
+    if (dirty) update->dirty = dirty;
+    if (!moves || !dirty) return -1;
+    
+    update->capacity = count;
+    return 0;
+}
+
+// Pull the next desktop update, if any, into the staging ring, and apply the
+// staged updates that are due to the persistent dirty frame.
+// Returns 0 whether or not anything changed, -1 on error.
+static int screen_update(screen_capture_t* capture) {
     HRESULT hr;
     IDXGIResource* desktop_resource = NULL;
     DXGI_OUTDUPL_FRAME_INFO frame_info;
     ID3D11Texture2D* desktop_texture = NULL;
-    ID3D11Texture2D* staging_texture = NULL;
-    D3D11_MAPPED_SUBRESOURCE mapped_resource;
     D3D11_TEXTURE2D_DESC texture_desc;
     
     // Try to acquire next frame with minimal timeout for polling
@@ -127,21 +364,24 @@ int screen_get_frame_dual_track(screen_capture_t* capture, void** frame_data, si
     
     if (FAILED(hr)) {
         if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
-            // No new frame available, use cached frame if we have one
-            if (capture->has_cached_frame && capture->cached_frame) {
-                *frame_size = capture->cached_frame_size;
-                *frame_data = malloc(*frame_size);
-                if (*frame_data) {
-                    memcpy(*frame_data, capture->cached_frame, *frame_size);
-                    return 0; // Success with cached frame
-                }
-            }
-            return 1; // No frame available and no cache
+            return screen_drain_readback(capture, TRUE); // No new frame; catch up on staged ones
         }
         fprintf(stderr, "Failed to acquire frame: 0x%08X\n", hr);
         return -1;
     }
     
+    if (capture->cursor_enabled) {
+        screen_update_pointer(capture, &frame_info);
+    }
+    
+    // Pointer-only updates leave the desktop image untouched
+    BOOL has_base = capture->readback_ring.submitted > 0;
+    if (frame_info.LastPresentTime.QuadPart == 0 && has_base) {
+        IDXGIResource_Release(desktop_resource);
+        IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
+        return screen_drain_readback(capture, TRUE);
+    }
+    
     // Get texture interface
     hr = IDXGIResource_QueryInterface(desktop_resource, &IID_ID3D11Texture2D, (void**)&desktop_texture);
     if (FAILED(hr)) {
@@ -154,106 +394,216 @@ int screen_get_frame_dual_track(screen_capture_t* capture, void** frame_data, si
     // Get texture description
     ID3D11Texture2D_GetDesc(desktop_texture, &texture_desc);
     
-    // Create staging texture for CPU access
-    texture_desc.Usage = D3D11_USAGE_STAGING;
-    texture_desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-    texture_desc.BindFlags = 0;
-    texture_desc.MiscFlags = 0;
-    
-    hr = ID3D11Device_CreateTexture2D(capture->device, &texture_desc, NULL, &staging_texture);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to create staging texture: 0x%08X\n", hr);
+    if ((int)texture_desc.Width != capture->width || (int)texture_desc.Height != capture->height) {
+        fprintf(stderr, "Desktop frame (%ux%u) no longer matches capture size %dx%d\n",
+                texture_desc.Width, texture_desc.Height, capture->width, capture->height);
         ID3D11Texture2D_Release(desktop_texture);
         IDXGIResource_Release(desktop_resource);
         IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
         return -1;
     }
     
-    // Copy desktop texture to staging texture
-    ID3D11DeviceContext_CopyResource(capture->context, (ID3D11Resource*)staging_texture, (ID3D11Resource*)desktop_texture);
-    
-    // Map staging texture for reading
-    hr = ID3D11DeviceContext_Map(capture->context, (ID3D11Resource*)staging_texture, 0, D3D11_MAP_READ, 0, &mapped_resource);
-    if (FAILED(hr)) {
-        fprintf(stderr, "Failed to map staging texture: 0x%08X\n", hr);
-        ID3D11Texture2D_Release(staging_texture);
+    // Due updates leave first, so a slot is free for this one
+    int slot = -1;
+    if (screen_drain_readback(capture, FALSE) == 0) {
+        slot = readback_ring_begin(&capture->readback_ring);
+    }
+    if (slot < 0) {
         ID3D11Texture2D_Release(desktop_texture);
         IDXGIResource_Release(desktop_resource);
         IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
         return -1;
     }
+    screen_readback_t* update = &capture->readback[slot];
+    
+    // Fetch move and dirty rects; any failure falls back to a full-frame update
+    DXGI_OUTDUPL_MOVE_RECT* move_rects = NULL;
+    RECT* dirty_rects = NULL;
+    UINT move_count = 0;
+    UINT dirty_count = 0;
+    BOOL incremental = FALSE;
+    
+    if (has_base && frame_info.TotalMetadataBufferSize > 0) {
+        if (frame_info.TotalMetadataBufferSize > capture->metadata_capacity) {
+            BYTE* grown = (BYTE*)realloc(capture->metadata, frame_info.TotalMetadataBufferSize);
+            if (grown) {
+                capture->metadata = grown;
+                capture->metadata_capacity = frame_info.TotalMetadataBufferSize;
+            }
+        }
+        
+        if (capture->metadata && frame_info.TotalMetadataBufferSize <= capture->metadata_capacity) {
+            UINT move_bytes = 0;
+            UINT dirty_bytes = 0;
+            hr = IDXGIOutputDuplication_GetFrameMoveRects(capture->duplication, capture->metadata_capacity,
+                                                          (DXGI_OUTDUPL_MOVE_RECT*)capture->metadata, &move_bytes);
+            if (SUCCEEDED(hr)) {
+                hr = IDXGIOutputDuplication_GetFrameDirtyRects(capture->duplication, capture->metadata_capacity - move_bytes,
+                                                               (RECT*)(capture->metadata + move_bytes), &dirty_bytes);
+            }
+            if (SUCCEEDED(hr)) {
+                move_rects = (DXGI_OUTDUPL_MOVE_RECT*)capture->metadata;
+                dirty_rects = (RECT*)(capture->metadata + move_bytes);
+                move_count = move_bytes / sizeof(DXGI_OUTDUPL_MOVE_RECT);
+                dirty_count = dirty_bytes / sizeof(RECT);
+                incremental = TRUE;
+            }
+        }
+    }
     
-    // Calculate frame size (assuming BGRA format, 4 bytes per pixel)
-    *frame_size = texture_desc.Width * texture_desc.Height * 4;
-    *frame_data = malloc(*frame_size);
+    // Translate desktop rects into the capture region, straight into the slot;
+    // changes outside the region are dropped
+    update->full = !incremental;
+    update->move_count = 0;
+    update->dirty_count = 0;
+    if (incremental) {
+        if (screen_reserve_readback(update, (int)(move_count + dirty_count)) == 0) {
+            capture_region_map_updates(&capture->region,
+                                       (const frame_move_t*)move_rects, (int)move_count,
+                                       (const frame_rect_t*)dirty_rects, (int)dirty_count,
+                                       update->moves, &update->move_count,
+                                       update->dirty, &update->dirty_count);
+        } else {
+            update->full = TRUE;
+        }
+    }
     
-    if (!*frame_data) {
-        fprintf(stderr, "Failed to allocate frame buffer\n");
-        ID3D11DeviceContext_Unmap(capture->context, (ID3D11Resource*)staging_texture, 0);
-        ID3D11Texture2D_Release(staging_texture);
+    // Nothing inside the region changed
+    if (!update->full && update->move_count == 0 && update->dirty_count == 0) {
         ID3D11Texture2D_Release(desktop_texture);
         IDXGIResource_Release(desktop_resource);
         IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
-        return -1;
+        return 0;
     }
     
-    // Copy frame data with conditional flipping based on dual-track mode
-    // DirectX screen capture needs flipping for proper video orientation
-    // Single-track mode: Copy with vertical flip (bottom-up) - correct orientation
-    // Dual-track mode: Copy normally (top-down) - matches dual-track encoder expectations
-    BYTE* src = (BYTE*)mapped_resource.pData;
-    BYTE* dst = (BYTE*)*frame_data;
-    
-    if (dual_track_mode) {
-        // Dual-track mode: Copy normally (top to bottom) - no flip needed
-        for (UINT y = 0; y < texture_desc.Height; y++) {
-            memcpy(dst + y * texture_desc.Width * 4, 
-                   src + y * mapped_resource.RowPitch, 
-                   texture_desc.Width * 4);
-        }
-    } else {
-        // Single-track mode: Flip vertically (copy from bottom to top) for correct orientation
-        for (UINT y = 0; y < texture_desc.Height; y++) {
-            UINT src_row = texture_desc.Height - 1 - y; // Read from bottom to top
-            memcpy(dst + y * texture_desc.Width * 4, 
-                   src + src_row * mapped_resource.RowPitch, 
-                   texture_desc.Width * 4);
+    // Moves with no copies in flight can be replayed on the CPU frame right away
+    if (!update->full && update->dirty_count == 0 && capture->readback_ring.in_flight == 0) {
+        ID3D11Texture2D_Release(desktop_texture);
+        IDXGIResource_Release(desktop_resource);
+        IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
+        
+        if (dirty_frame_apply(&capture->dirty_frame, NULL, 0, update->moves, update->move_count, NULL, 0) != 0) {
+            fprintf(stderr, "Failed to apply desktop update\n");
+            return -1;
         }
+        return 0;
     }
     
-    // Cache this frame for future use when no new frames are available
-    // MEMORY LEAK FIX: Limit cache size and prevent unbounded growth
-    if (capture->cached_frame) {
-        free(capture->cached_frame);
-        capture->cached_frame = NULL;
-    }
-    
-    // Only cache frames up to reasonable size limit (prevent memory leak)
-    const size_t MAX_CACHE_SIZE = 32 * 1024 * 1024; // 32MB max cache
-    if (*frame_size <= MAX_CACHE_SIZE) {
-        capture->cached_frame = malloc(*frame_size);
-        if (capture->cached_frame) {
-            memcpy(capture->cached_frame, *frame_data, *frame_size);
-            capture->cached_frame_size = *frame_size;
-            capture->has_cached_frame = TRUE;
+    // Queue the copy into the slot's staging texture: only dirty rects when
+    // incremental, moves are replayed on the CPU frame when the slot retires
+    ID3D11Resource* staging = (ID3D11Resource*)capture->staging[slot];
+    if (!update->full) {
+        for (int i = 0; i < update->dirty_count; i++) {
+            const frame_rect_t* rect = &update->dirty[i];
+            D3D11_BOX box = { (UINT)(rect->left + capture->region.x), (UINT)(rect->top + capture->region.y), 0,
+                              (UINT)(rect->right + capture->region.x), (UINT)(rect->bottom + capture->region.y), 1 };
+            ID3D11DeviceContext_CopySubresourceRegion(capture->context, staging, 0, (UINT)rect->left, (UINT)rect->top, 0,
+                                                      (ID3D11Resource*)desktop_texture, 0, &box);
         }
+    } else if (capture_region_is_full(&capture->region, capture->width, capture->height)) {
+        ID3D11DeviceContext_CopyResource(capture->context, staging, (ID3D11Resource*)desktop_texture);
     } else {
-        capture->has_cached_frame = FALSE;
+        D3D11_BOX box = { (UINT)capture->region.x, (UINT)capture->region.y, 0,
+                          (UINT)(capture->region.x + capture->region.width), (UINT)(capture->region.y + capture->region.height), 1 };
+        ID3D11DeviceContext_CopySubresourceRegion(capture->context, staging, 0, 0, 0, 0,
+                                                  (ID3D11Resource*)desktop_texture, 0, &box);
     }
     
-    // Cleanup
-    ID3D11DeviceContext_Unmap(capture->context, (ID3D11Resource*)staging_texture, 0);
-    ID3D11Texture2D_Release(staging_texture);
+    // The copies are queued ahead of the release, so the desktop image can be handed back now
     ID3D11Texture2D_Release(desktop_texture);
     IDXGIResource_Release(desktop_resource);
     IDXGIOutputDuplication_ReleaseFrame(capture->duplication);
     
-    return 0;
+    // Start the GPU on the copy now rather than when the slot is mapped
+    ID3D11DeviceContext_Flush(capture->context);
+    readback_ring_submit(&capture->readback_ring);
+    
+    // Retire what is now past the latency; with a latency of 0 that is this update
+    return screen_drain_readback(capture, FALSE);
+}
+
+// Enhanced frame capture with dual-track mode awareness to fix video flipping issue
+// Returns SCREEN_FRAME_NEW with a pool reference in *frame that the caller must release,
+// SCREEN_FRAME_REPEAT when the desktop is unchanged, SCREEN_FRAME_NONE or -1 on error
+int screen_get_frame_dual_track(screen_capture_t* capture, frame_handle_t* frame, BOOL dual_track_mode) {
+    if (!frame) return -1;
+    *frame = FRAME_HANDLE_INVALID;
+    if (!capture || !capture->duplication || !capture->is_capturing || !capture->frame_pool) return -1;
+    
+    if (screen_update(capture) != 0) return -1;
+    
+    // Nothing new since the last delivered frame: signal a repeat instead of copying pixels again
+    uint64_t cursor_generation = capture->cursor_enabled ? capture->cursor.generation : 0;
+    if (capture->dirty_frame.generation == 0) return SCREEN_FRAME_NONE;
+    if (capture->dirty_frame.generation == capture->delivered_generation && cursor_generation == capture->delivered_cursor) {
+        return capture->has_previous_frame ? SCREEN_FRAME_REPEAT : SCREEN_FRAME_NONE;
+    }
+    
+    // The persistent frame is current even if no pool frame is free; the
+    // damage history lets the next delivered frame catch up
+    frame_handle_t pool_frame = frame_pool_acquire(capture->frame_pool);
+    if (pool_frame == FRAME_HANDLE_INVALID) {
+        return SCREEN_FRAME_NONE; // Every frame is still referenced downstream
+    }
+    
+    // DirectX screen capture needs flipping for proper video orientation
+    // Single-track mode: Copy with vertical flip (bottom-up) - correct orientation
+    // Dual-track mode: Copy normally (top-down) - matches dual-track encoder expectations
+    BOOL flip = !dual_track_mode;
+    if (flip != capture->slots_flipped) {
+        memset(capture->slot_generation, 0, (size_t)capture->frame_pool->capacity * sizeof(uint64_t));
+        capture->slots_flipped = flip;
+    }
+    
+    BYTE* dst = (BYTE*)frame_pool_data(capture->frame_pool, pool_frame);
+    size_t dst_pitch = (size_t)capture->region.width * 4;
+    
+    // Undo the cursor this frame carried last time; the damage history does not know about it.
+    // A cursor-only update therefore costs two cursor-sized rects, not a frame copy.
+    frame_rect_t* drawn = &capture->slot_cursor[pool_frame];
+    if (capture->slot_generation[pool_frame] != 0 && frame_rect_area(drawn) > 0) {
+        dirty_frame_copy_rect(&capture->dirty_frame, dst, dst_pitch, drawn, flip);
+    }
+    memset(drawn, 0, sizeof(frame_rect_t));
+    
+    if (dirty_frame_copy_out(&capture->dirty_frame, dst, dst_pitch, capture->slot_generation[pool_frame], flip) < 0) {
+        frame_pool_release(capture->frame_pool, pool_frame);
+        return -1;
+    }
+    capture->slot_generation[pool_frame] = capture->dirty_frame.generation;
+    capture->delivered_generation = capture->dirty_frame.generation;
+    
+    if (capture->cursor_enabled) {
+        cursor_compositor_draw(&capture->cursor, dst, dst_pitch, capture->region.width, capture->region.height,
+                               0, 0, flip, drawn);
+    }
+    capture->delivered_cursor = cursor_generation;
+    
+    // The encoder keeps the previous sample alive, so later timeouts can simply repeat it
+    capture->has_previous_frame = TRUE;
+    *frame = pool_frame;
+    
+    return SCREEN_FRAME_NEW;
+}
+
+// Bring an external top-down buffer of region size up to date, copying only
+// what changed since the buffer was last synced. Used for virtual desktop
+// outputs, which write straight into their window of the shared canvas.
+int screen_capture_into(screen_capture_t* capture, uint8_t* dst, size_t dst_pitch) {
+    if (!capture || !capture->duplication || !capture->is_capturing || !dst) return -1;
+    
+    if (screen_update(capture) != 0) return -1;
+    if (capture->dirty_frame.generation == 0) return SCREEN_FRAME_NONE;
+    if (capture->dirty_frame.generation == capture->external_generation) return SCREEN_FRAME_REPEAT;
+    
+    if (dirty_frame_copy_out(&capture->dirty_frame, dst, dst_pitch, capture->external_generation, 0) < 0) return -1;
+    capture->external_generation = capture->dirty_frame.generation;
+    return SCREEN_FRAME_NEW;
 }
 
 // Original frame capture function (for backward compatibility)
-int screen_get_frame(screen_capture_t* capture, void** frame_data, size_t* frame_size) {
-    return screen_get_frame_dual_track(capture, frame_data, frame_size, FALSE);
+int screen_get_frame(screen_capture_t* capture, frame_handle_t* frame) {
+    return screen_get_frame_dual_track(capture, frame, FALSE);
 }
 
 void screen_stop_capture(screen_capture_t* capture) {
@@ -266,6 +616,22 @@ void screen_stop_capture(screen_capture_t* capture) {
 void screen_cleanup(screen_capture_t* capture) {
     if (!capture) return;
     
+    for (int i = 0; i < READBACK_RING_MAX_DEPTH; i++) {
+        if (capture->staging[i]) {
+            ID3D11Texture2D_Release(capture->staging[i]);
+            capture->staging[i] = NULL;
+        }
+        free(capture->readback[i].moves);
+        free(capture->readback[i].dirty);
+    }
+    
+    dirty_frame_cleanup(&capture->dirty_frame);
+    free(capture->metadata);
+    free(capture->slot_generation);
+    free(capture->slot_cursor);
+    free(capture->pointer_shape);
+    cursor_compositor_cleanup(&capture->cursor);
+    
     if (capture->duplication) {
         IDXGIOutputDuplication_Release(capture->duplication);
         capture->duplication = NULL;
@@ -281,12 +647,6 @@ void screen_cleanup(screen_capture_t* capture) {
         capture->device = NULL;
     }
     
-    // Free cached frame
-    if (capture->cached_frame) {
-        free(capture->cached_frame);
-        capture->cached_frame = NULL;
-    }
-    
     memset(capture, 0, sizeof(screen_capture_t));
     printf("Screen capture cleaned up\n");
 }
@@ -0,0 +1,368 @@
+#include "segmenter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int segmenter_path(const char* base_path, uint32_t index, char* path, size_t size) {
+    if (!base_path || !path || size == 0) return -1;
+    const char* dot = strrchr(base_path, '.');
+    const char* slash = strrchr(base_path, '/');
+    const char* backslash = strrchr(base_path, '\\');
+    if (backslash > slash) slash = backslash;
+    if (!dot || (slash && dot < slash)) dot = base_path + strlen(base_path);
+
+    int written = snprintf(path, size, "%.*s-%03u%s", (int)(dot - base_path), base_path, index, dot);
+    return written > 0 && (size_t)written < size ? 0 : -1;
+}
+
+// Sample frame of a stream at a recording time, and back
+static uint64_t segmenter_sample_at(const segmenter_t* segmenter, int stream, int64_t time) {
+    if (time <= 0) return 0;
+    uint64_t rate = segmenter->config.audio_rate[stream];
+    return ((uint64_t)time * rate + SEGMENTER_UNITS_PER_SECOND / 2) / SEGMENTER_UNITS_PER_SECOND;
+}
+
+static int64_t segmenter_sample_time(const segmenter_t* segmenter, int stream, uint64_t sample) {
+    uint64_t rate = segmenter->config.audio_rate[stream];
+    return (int64_t)((sample * SEGMENTER_UNITS_PER_SECOND + rate / 2) / rate);
+}
+
+static int segmenter_write_audio(segmenter_t* segmenter, int stream, const uint8_t* data, uint32_t frames) {
+    segmenter_audio_t* audio = &segmenter->audio[stream];
+    if (frames == 0) return 0;
+    // Counted even when the sink fails, so positions stay on the recording timeline
+    int result = segmenter->sink.audio(segmenter->context, stream, data, frames, audio->written);
+    audio->written += frames;
+    return result;
+}
+
+// Write held audio before sample frame `until` to the open segment
+static int segmenter_release_audio(segmenter_t* segmenter, int stream, uint64_t until) {
+    segmenter_audio_t* audio = &segmenter->audio[stream];
+    uint32_t frame_bytes = segmenter->config.audio_frame_bytes[stream];
+    uint64_t held = audio->size / frame_bytes;
+    uint64_t first = audio->received - held;
+    if (held == 0 || until <= first) return 0;
+
+    uint64_t frames = until - first < held ? until - first : held;
+    int result = segmenter_write_audio(segmenter, stream, audio->data, (uint32_t)frames);
+    size_t bytes = (size_t)frames * frame_bytes;
+    memmove(audio->data, audio->data + bytes, audio->size - bytes);
+    audio->size -= bytes;
+    return result;
+}
+
+static void segmenter_finalizer(void* arg) {
+    segmenter_t* segmenter = (segmenter_t*)arg;
+    platform_mutex_lock(&segmenter->mutex);
+    for (;;) {
+        while (segmenter->pending_count == 0 && !segmenter->stopping) {
+            platform_cond_wait(&segmenter->cond, &segmenter->mutex);
+        }
+        if (segmenter->pending_count == 0) break;
+
+        void* segment = segmenter->pending[0];
+        segmenter->pending_count--;
+        memmove(segmenter->pending, segmenter->pending + 1, (size_t)segmenter->pending_count * sizeof(void*));
+        segmenter->finalizing = 1;
+        platform_mutex_unlock(&segmenter->mutex);
+
+        uint64_t start = platform_time_ns();
+        int result = segmenter->sink.finalize(segmenter->context, segment);
+        uint64_t elapsed = platform_time_ns() - start;
+
+        platform_mutex_lock(&segmenter->mutex);
+        segmenter->finalizing = 0;
+        segmenter->stats.finalized++;
+        if (result != 0) segmenter->stats.finalize_failures++;
+        if (elapsed > segmenter->stats.finalize_ns_max) segmenter->stats.finalize_ns_max = elapsed;
+        platform_cond_broadcast(&segmenter->cond);
+    }
+    platform_mutex_unlock(&segmenter->mutex);
+}
+
+// Close the open segment at the boundary and open the next; the boundary's
+// audio was released into the old segment by the caller
+static int segmenter_roll(segmenter_t* segmenter, int64_t boundary) {
+    void* segment = segmenter->sink.close(segmenter->context, boundary - segmenter->segment_start);
+    if (!segment) {
+        fprintf(stderr, "Segment: Failed to close segment %u\n", segmenter->index);
+        segmenter->failed = 1;
+        return -1;
+    }
+
+    platform_mutex_lock(&segmenter->mutex);
+    if (segmenter->pending_count == SEGMENTER_MAX_PENDING) segmenter->stats.finalize_waits++;
+    while (segmenter->pending_count == SEGMENTER_MAX_PENDING) {
+        platform_cond_wait(&segmenter->cond, &segmenter->mutex);
+    }
+    segmenter->pending[segmenter->pending_count++] = segment;
+    platform_cond_broadcast(&segmenter->cond);
+    platform_mutex_unlock(&segmenter->mutex);
+
+    segmenter->index++;
+    segmenter->rollover_due = 0;
+    segmenter->video_frames = 0;
+    segmenter->segment_start = boundary;
+    for (int stream = 0; stream < segmenter->config.audio_streams; stream++) {
+        segmenter->audio[stream].written = 0;
+        segmenter->audio[stream].segment_start = segmenter_sample_at(segmenter, stream, boundary);
+    }
+    if (segmenter_path(segmenter->base_path, segmenter->index, segmenter->path, sizeof(segmenter->path)) != 0 ||
+        segmenter->sink.open(segmenter->context, segmenter->index, segmenter->path, boundary) != 0) {
+        fprintf(stderr, "Segment: Failed to open segment %u\n", segmenter->index);
+        segmenter->failed = 1;
+        return -1;
+    }
+    segmenter->stats.segments++;
+    segmenter->stats.last_start_time = boundary;
+    return 0;
+}
+
+static int segmenter_size_reached(segmenter_t* segmenter) {
+    return segmenter->config.max_bytes && segmenter->sink.bytes &&
+           segmenter->sink.bytes(segmenter->context) >= segmenter->config.max_bytes;
+}
+
+int segmenter_init(segmenter_t* segmenter, const segmenter_config_t* config, const char* base_path,
+                   const segment_sink_t* sink, void* context) {
+    if (!segmenter || !config || !base_path || !sink) return -1;
+    memset(segmenter, 0, sizeof(segmenter_t));
+    if (config->audio_streams < 0 || config->audio_streams > SEGMENTER_MAX_AUDIO ||
+        (!config->video && config->audio_streams == 0) || !sink->open || !sink->close || !sink->finalize ||
+        (config->video && !sink->video) || (config->audio_streams > 0 && !sink->audio) ||
+        config->video_item_size > SEGMENTER_MAX_VIDEO_ITEM) {
+        fprintf(stderr, "Segment: Invalid configuration\n");
+        return -1;
+    }
+    for (int stream = 0; stream < config->audio_streams; stream++) {
+        if (config->audio_rate[stream] == 0 || config->audio_frame_bytes[stream] == 0) {
+            fprintf(stderr, "Segment: Audio stream %d has no format\n", stream);
+            return -1;
+        }
+    }
+    if (strlen(base_path) >= sizeof(segmenter->base_path)) return -1;
+
+    segmenter->config = *config;
+    if (segmenter->config.hold_ms == 0) segmenter->config.hold_ms = SEGMENTER_DEFAULT_HOLD_MS;
+    segmenter->sink = *sink;
+    segmenter->context = context;
+    strcpy(segmenter->base_path, base_path);
+    segmenter->index = 1;
+    if (segmenter_path(base_path, 1, segmenter->path, sizeof(segmenter->path)) != 0) return -1;
+
+    for (int stream = 0; stream < config->audio_streams; stream++) {
+        segmenter_audio_t* audio = &segmenter->audio[stream];
+        audio->capacity = (size_t)config->audio_rate[stream] * SEGMENTER_AUDIO_HOLD_MS / 1000 *
+                          config->audio_frame_bytes[stream];
+        audio->data = (uint8_t*)malloc(audio->capacity);
+        if (!audio->data) {
+            segmenter_cleanup(segmenter);
+            return -1;
+        }
+    }
+
+    int mutex_ok = platform_mutex_init(&segmenter->mutex) == 0;
+    int cond_ok = mutex_ok && platform_cond_init(&segmenter->cond) == 0;
+    if (!cond_ok || platform_thread_create(&segmenter->thread, segmenter_finalizer, segmenter) != 0) {
+        fprintf(stderr, "Segment: Failed to start the finalizer thread\n");
+        if (cond_ok) platform_cond_destroy(&segmenter->cond);
+        if (mutex_ok) platform_mutex_destroy(&segmenter->mutex);
+        segmenter_cleanup(segmenter);
+        return -1;
+    }
+    segmenter->thread_started = 1;
+    segmenter->stats.segments = 1;
+    return 0;
+}
+
+// Every stream from `first` has received the audio before time
+static int segmenter_caught_up(const segmenter_t* segmenter, int first, int64_t time) {
+    for (int stream = first; stream < segmenter->config.audio_streams; stream++) {
+        if (segmenter->audio[stream].received < segmenter_sample_at(segmenter, stream, time)) return 0;
+    }
+    return 1;
+}
+
+static int segmenter_release_all(segmenter_t* segmenter, int first, int64_t time) {
+    for (int stream = first; stream < segmenter->config.audio_streams; stream++) {
+        if (segmenter_release_audio(segmenter, stream, segmenter_sample_at(segmenter, stream, time)) != 0) return -1;
+    }
+    return 0;
+}
+
+// Write held frames in order. A frame that starts a segment waits until the
+// audio before it has arrived, unless forced or the wait runs past hold_ms.
+static int segmenter_process_video(segmenter_t* segmenter, int force) {
+    int64_t hold = (int64_t)segmenter->config.hold_ms * (SEGMENTER_UNITS_PER_SECOND / 1000);
+    while (segmenter->video_held > 0) {
+        int64_t time = segmenter->video_times[0];
+        if (!segmenter->rollover_due && segmenter->video_frames > 0) {
+            segmenter->rollover_due = (segmenter->config.max_duration &&
+                                       time - segmenter->segment_start >= segmenter->config.max_duration) ||
+                                      segmenter_size_reached(segmenter);
+        }
+        int roll = segmenter->rollover_due && segmenter->video_can_start[0];
+        if (roll && !segmenter_caught_up(segmenter, 0, time)) {
+            int64_t waited = segmenter->video_times[segmenter->video_held - 1] - time;
+            if (!force && segmenter->video_held < SEGMENTER_MAX_VIDEO_HOLD && waited < hold) return 0;
+            segmenter->stats.late_boundaries++;
+        }
+
+        // Audio before this frame belongs to the open segment whatever happens next
+        if (segmenter_release_all(segmenter, 0, time) != 0) return -1;
+        if (roll && segmenter_roll(segmenter, time) != 0) return -1;
+
+        // The frame is consumed whatever the sink makes of it
+        uint8_t item[SEGMENTER_MAX_VIDEO_ITEM];
+        memcpy(item, segmenter->video_items[0], segmenter->config.video_item_size);
+        segmenter->video_frames++;
+        segmenter->video_time = time;
+        segmenter->video_held--;
+        memmove(segmenter->video_items[0], segmenter->video_items[1],
+                (size_t)segmenter->video_held * sizeof(segmenter->video_items[0]));
+        memmove(segmenter->video_times, segmenter->video_times + 1, (size_t)segmenter->video_held * sizeof(int64_t));
+        memmove(segmenter->video_can_start, segmenter->video_can_start + 1, (size_t)segmenter->video_held * sizeof(int));
+        if (segmenter->sink.video(segmenter->context, item, time - segmenter->segment_start) != 0) return -1;
+    }
+    return 0;
+}
+
+// Audio-only recordings: stream 0 places the boundaries, on any sample. Its
+// audio is held like the others so a boundary can wait for them.
+static int segmenter_process_clock(segmenter_t* segmenter, int force) {
+    segmenter_audio_t* audio = &segmenter->audio[0];
+    uint32_t frame_bytes = segmenter->config.audio_frame_bytes[0];
+    uint64_t rate = segmenter->config.audio_rate[0];
+    uint64_t segment_frames = (uint64_t)segmenter->config.max_duration * rate / SEGMENTER_UNITS_PER_SECOND;
+    if (segmenter->config.max_duration && segment_frames == 0) segment_frames = 1;
+    uint64_t hold = rate * segmenter->config.hold_ms / 1000;
+
+    while (audio->size > 0) {
+        uint64_t held = audio->size / frame_bytes;
+        uint64_t position = audio->received - held;
+        int64_t time = segmenter_sample_time(segmenter, 0, position);
+        if (!segmenter->rollover_due && audio->written > 0) {
+            segmenter->rollover_due = (segment_frames && position - audio->segment_start >= segment_frames) ||
+                                      segmenter_size_reached(segmenter);
+        }
+        if (segmenter->rollover_due) {
+            if (!segmenter_caught_up(segmenter, 1, time)) {
+                if (!force && audio->size < audio->capacity && held < hold) return 0;
+                segmenter->stats.late_boundaries++;
+            }
+            if (segmenter_release_all(segmenter, 1, time) != 0) return -1;
+            if (segmenter_roll(segmenter, time) != 0) return -1;
+            audio->segment_start = position;
+        }
+
+        // Up to the duration limit; the rest starts the next segment
+        uint64_t chunk = held;
+        if (segment_frames && chunk > audio->segment_start + segment_frames - position) {
+            chunk = audio->segment_start + segment_frames - position;
+        }
+        if (segmenter_release_audio(segmenter, 0, position + chunk) != 0) return -1;
+        if (segmenter_release_all(segmenter, 1, segmenter_sample_time(segmenter, 0, position + chunk)) != 0) return -1;
+    }
+    return 0;
+}
+
+static int segmenter_process(segmenter_t* segmenter, int force) {
+    if (segmenter->failed) return -1;
+    return segmenter->config.video ? segmenter_process_video(segmenter, force)
+                                   : segmenter_process_clock(segmenter, force);
+}
+
+int segmenter_video(segmenter_t* segmenter, const void* frame, int64_t time, int can_start) {
+    if (!segmenter || segmenter->failed || !segmenter->config.video || !frame) return -1;
+    if (segmenter->video_held == SEGMENTER_MAX_VIDEO_HOLD && segmenter_process_video(segmenter, 1) != 0) return -1;
+
+    int slot = segmenter->video_held++;
+    memcpy(segmenter->video_items[slot], frame, segmenter->config.video_item_size);
+    segmenter->video_times[slot] = time;
+    segmenter->video_can_start[slot] = can_start;
+    if ((uint64_t)segmenter->video_held > segmenter->stats.held_video_peak) {
+        segmenter->stats.held_video_peak = (uint64_t)segmenter->video_held;
+    }
+    return segmenter_process_video(segmenter, 0);
+}
+
+int segmenter_audio(segmenter_t* segmenter, int stream, const uint8_t* data, uint32_t frames) {
+    if (!segmenter || segmenter->failed || stream < 0 || stream >= segmenter->config.audio_streams || !data) return -1;
+
+    // Held until the clock (video, or audio stream 0) has passed it
+    segmenter_audio_t* audio = &segmenter->audio[stream];
+    uint32_t frame_bytes = segmenter->config.audio_frame_bytes[stream];
+    while (frames > 0) {
+        size_t room = (audio->capacity - audio->size) / frame_bytes;
+        if (room == 0) {
+            if (segmenter_process(segmenter, 0) != 0) return -1;
+            room = (audio->capacity - audio->size) / frame_bytes;
+        }
+        if (room == 0) {
+            // The clock stalled: keep audio flowing, at the cost of an exact boundary
+            uint64_t oldest = audio->received - audio->size / frame_bytes;
+            segmenter->stats.hold_overflows++;
+            if (segmenter_release_audio(segmenter, stream, oldest + (audio->size / frame_bytes + 1) / 2) != 0) return -1;
+            continue;
+        }
+        uint32_t chunk = frames < room ? frames : (uint32_t)room;
+        memcpy(audio->data + audio->size, data, (size_t)chunk * frame_bytes);
+        audio->size += (size_t)chunk * frame_bytes;
+        audio->received += chunk;
+        data += (size_t)chunk * frame_bytes;
+        frames -= chunk;
+    }
+    if (audio->size > segmenter->stats.held_audio_peak) segmenter->stats.held_audio_peak = audio->size;
+
+    // New audio may let a waiting boundary go; anything the clock passed can go too
+    if (segmenter_process(segmenter, 0) != 0) return -1;
+    if (!segmenter->config.video) return 0;
+    return segmenter_release_audio(segmenter, stream, segmenter_sample_at(segmenter, stream, segmenter->video_time));
+}
+
+int segmenter_finish(segmenter_t* segmenter) {
+    if (!segmenter || !segmenter->thread_started) return -1;
+    int result = segmenter_process(segmenter, 1);
+    for (int stream = 0; stream < segmenter->config.audio_streams && result == 0; stream++) {
+        result = segmenter_release_audio(segmenter, stream, segmenter->audio[stream].received);
+    }
+
+    platform_mutex_lock(&segmenter->mutex);
+    while (segmenter->pending_count > 0 || segmenter->finalizing) {
+        platform_cond_wait(&segmenter->cond, &segmenter->mutex);
+    }
+    if (segmenter->stats.finalize_failures > 0) result = -1;
+    platform_mutex_unlock(&segmenter->mutex);
+    return result;
+}
+
+void segmenter_cleanup(segmenter_t* segmenter) {
+    if (!segmenter) return;
+    if (segmenter->thread_started) {
+        // Segments still queued are finalized before the thread exits
+        platform_mutex_lock(&segmenter->mutex);
+        segmenter->stopping = 1;
+        platform_cond_broadcast(&segmenter->cond);
+        platform_mutex_unlock(&segmenter->mutex);
+        platform_thread_join(segmenter->thread);
+        platform_cond_destroy(&segmenter->cond);
+        platform_mutex_destroy(&segmenter->mutex);
+    }
+    for (int stream = 0; stream < SEGMENTER_MAX_AUDIO; stream++) free(segmenter->audio[stream].data);
+    memset(segmenter, 0, sizeof(segmenter_t));
+}
+
+void segmenter_report(const segmenter_t* segmenter, segmenter_report_fn report) {
+    if (!segmenter || !report || !segmenter->thread_started) return;
+    const segmenter_stats_t* stats = &segmenter->stats;
+    char message[256];
+    snprintf(message, sizeof(message),
+             "Segments: %u written, last starts at %.3f s; finalize max %.1f ms off the recording thread, "
+             "%u failed, %llu waits; held peak %llu KB audio, %llu frames; %llu late boundaries, %llu overflows",
+             stats->segments, stats->last_start_time / (double)SEGMENTER_UNITS_PER_SECOND,
+             stats->finalize_ns_max / 1e6, stats->finalize_failures, (unsigned long long)stats->finalize_waits,
+             (unsigned long long)(stats->held_audio_peak / 1024), (unsigned long long)stats->held_video_peak,
+             (unsigned long long)stats->late_boundaries, (unsigned long long)stats->hold_overflows);
+    report(message);
+}
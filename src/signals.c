@@ -1,5 +1,6 @@
 #include "signals.h"
 #include "engine.h"
+#include "params.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -8,6 +9,15 @@
 static capture_engine_t* g_signal_engine = NULL;
 static volatile BOOL g_shutdown_requested = FALSE;
 
+// Before a forced exit: a fragmented recording is playable up to its last
+// fragment, and --repair trims off the one being written
+static void print_recovery_hint(void) {
+    if (g_signal_engine && g_signal_engine->params.fragmented_output) {
+        printf("Recover what was written with: muxsw --repair \"%s\"\n", g_signal_engine->params.output_filename);
+    }
+    fflush(stdout);
+}
+
 // Signal handler for graceful shutdown
 void signal_handler(int sig) {
     printf("Received signal %d, stopping capture...\n", sig);
@@ -20,12 +30,24 @@ void signal_handler(int sig) {
     Sleep(5000);
     if (g_signal_engine && engine_is_running(g_signal_engine)) {
         printf("EMERGENCY: Force terminating due to timeout\n");
+        print_recovery_hint();
         exit(1);
     }
 }
 
-// Windows console control handler for Ctrl+C
+// Windows console control handler for Ctrl+C; Ctrl+Break saves the replay buffer in replay mode
 BOOL WINAPI console_ctrl_handler(DWORD ctrl_type) {
+    if (ctrl_type == CTRL_BREAK_EVENT && g_signal_engine && engine_is_replaying(g_signal_engine)) {
+        char path[MAX_PATH];
+        if (engine_save_replay(g_signal_engine, path, sizeof(path)) == 0) {
+            printf("Saving replay to %s\n", path);
+        } else {
+            printf("Replay save failed, recording continues\n");
+        }
+        fflush(stdout);
+        return TRUE;
+    }
+    
     switch (ctrl_type) {
         case CTRL_C_EVENT:
         case CTRL_BREAK_EVENT:
@@ -48,7 +70,9 @@ DWORD WINAPI emergency_timeout_thread(LPVOID lpParam) {
     
     Sleep(5 * 60 * 1000);
     
-    if (!g_shutdown_requested && g_signal_engine && engine_is_running(g_signal_engine)) {
+    // Recordings with a duration, segments or a replay buffer are left to run
+    if (!g_shutdown_requested && g_signal_engine && engine_is_running(g_signal_engine) &&
+        params_is_capped(&g_signal_engine->params)) {
         printf("EMERGENCY TIMEOUT: Force terminating after 5 minutes\n");
         if (g_signal_engine) {
             engine_stop(g_signal_engine);
@@ -56,6 +80,7 @@ DWORD WINAPI emergency_timeout_thread(LPVOID lpParam) {
         Sleep(2000);
         if (g_signal_engine && engine_is_running(g_signal_engine)) {
             printf("CRITICAL: Emergency exit due to unresponsive engine\n");
+            print_recovery_hint();
             exit(2);
         }
     }
@@ -0,0 +1,199 @@
+#include "simulated_audio.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    simulated_audio_config_t config;
+    int16_t* buffer;                // Device buffer, buffer_frames interleaved frames
+    uint32_t buffer_frames;
+    uint32_t period_frames;
+
+    platform_mutex_t lock;
+    platform_cond_t ready;
+    int signaled;
+    uint64_t write_pos;             // Frames written into the buffer
+    uint64_t read_pos;              // Frames released by the consumer
+    uint32_t held;                  // Handed out by get_buffer, not yet released
+    uint64_t next_index;            // Frame index the timer generates next (lost frames included)
+    uint64_t signal_ns;             // Oldest signal nobody has picked up yet, 0 = none
+
+    platform_thread_t timer;
+    int timer_started;
+    platform_atomic_t running;
+    simulated_audio_stats_t stats;
+} simulated_audio_t;
+
+static const audio_source_ops_t simulated_audio_ops;
+
+static void simulated_audio_timer(void* arg) {
+    simulated_audio_t* device = (simulated_audio_t*)arg;
+    uint64_t start_ns = platform_time_ns();
+    int channels = device->config.channels;
+
+    while (platform_atomic_load(&device->running)) {
+        platform_sleep_ms(device->config.period_ms);
+        uint64_t now = platform_time_ns();
+        uint64_t due = (now - start_ns) * (uint64_t)device->config.sample_rate / 1000000000ULL;
+
+        platform_mutex_lock(&device->lock);
+        while (device->next_index < due) {
+            if (device->write_pos - device->read_pos >= device->buffer_frames) {
+                // Overrun: the consumer did not drain in time
+                device->stats.lost_frames += due - device->next_index;
+                device->next_index = due;
+                break;
+            }
+            int16_t* frame = device->buffer + (size_t)(device->write_pos % device->buffer_frames) * channels;
+            for (int c = 0; c < channels; c++) frame[c] = (int16_t)(device->next_index + (uint64_t)c);
+            device->next_index++;
+            device->write_pos++;
+            device->stats.produced_frames++;
+        }
+        device->signaled = 1;
+        device->stats.signals++;
+        if (device->signal_ns == 0) device->signal_ns = now;
+        platform_cond_signal(&device->ready);
+        platform_mutex_unlock(&device->lock);
+    }
+}
+
+static int simulated_audio_start(audio_source_t* source) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    if (device->timer_started) return 0;
+
+    platform_atomic_store(&device->running, 1);
+    if (platform_thread_create(&device->timer, simulated_audio_timer, device) != 0) {
+        platform_atomic_store(&device->running, 0);
+        return -1;
+    }
+    device->timer_started = 1;
+    return 0;
+}
+
+static int simulated_audio_wait(audio_source_t* source, unsigned int timeout_ms) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    if (!device->config.event_driven) {
+        platform_sleep_ms(timeout_ms);
+        return AUDIO_WAIT_TIMEOUT;
+    }
+
+    platform_mutex_lock(&device->lock);
+    if (!device->signaled) platform_cond_wait_ms(&device->ready, &device->lock, timeout_ms);
+    int result = device->signaled ? AUDIO_WAIT_READY : AUDIO_WAIT_TIMEOUT;
+    device->signaled = 0;
+    platform_mutex_unlock(&device->lock);
+    return result;
+}
+
+static int simulated_audio_get_buffer(audio_source_t* source, const uint8_t** data, uint32_t* frames) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+
+    platform_mutex_lock(&device->lock);
+    uint64_t available = device->write_pos - device->read_pos;
+    if (available > 0) {
+        // One period at most, and never across the end of the buffer
+        uint32_t offset = (uint32_t)(device->read_pos % device->buffer_frames);
+        uint32_t count = device->buffer_frames - offset;
+        if (count > available) count = (uint32_t)available;
+        if (count > device->period_frames) count = device->period_frames;
+
+        *data = (const uint8_t*)(device->buffer + (size_t)offset * device->config.channels);
+        *frames = count;
+        device->held = count;
+
+        if (device->signal_ns != 0) {
+            uint64_t latency = platform_time_ns() - device->signal_ns;
+            device->stats.pickups++;
+            device->stats.total_latency_ns += latency;
+            if (latency > device->stats.max_latency_ns) device->stats.max_latency_ns = latency;
+            device->signal_ns = 0;
+        }
+    }
+    platform_mutex_unlock(&device->lock);
+    return 0;
+}
+
+static void simulated_audio_release_buffer(audio_source_t* source, uint32_t frames) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    platform_mutex_lock(&device->lock);
+    device->read_pos += frames < device->held ? frames : device->held;
+    device->held = 0;
+    platform_mutex_unlock(&device->lock);
+}
+
+static void simulated_audio_stop(audio_source_t* source) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    if (!device->timer_started) return;
+    platform_atomic_store(&device->running, 0);
+    platform_thread_join(device->timer);
+    device->timer_started = 0;
+}
+
+static void simulated_audio_destroy(audio_source_t* source) {
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    if (!device) return;
+    simulated_audio_stop(source);
+    platform_cond_destroy(&device->ready);
+    platform_mutex_destroy(&device->lock);
+    free(device->buffer);
+    free(device);
+    source->impl = NULL;
+}
+
+static const audio_source_ops_t simulated_audio_ops = {
+    "simulated",
+    simulated_audio_start,
+    simulated_audio_wait,
+    simulated_audio_get_buffer,
+    simulated_audio_release_buffer,
+    simulated_audio_stop,
+    NULL,
+    NULL,
+    simulated_audio_destroy
+};
+
+int simulated_audio_create(audio_source_t* source, const simulated_audio_config_t* config) {
+    if (!source || !config) return -1;
+    memset(source, 0, sizeof(audio_source_t));
+    if (config->sample_rate <= 0 || config->channels <= 0 || config->period_ms == 0) return -1;
+    if (config->buffer_ms < config->period_ms) return -1;
+
+    simulated_audio_t* device = (simulated_audio_t*)calloc(1, sizeof(simulated_audio_t));
+    if (!device) return -1;
+    device->config = *config;
+    device->period_frames = (uint32_t)((uint64_t)config->sample_rate * config->period_ms / 1000);
+    device->buffer_frames = (uint32_t)((uint64_t)config->sample_rate * config->buffer_ms / 1000);
+    if (device->period_frames == 0) device->period_frames = 1;
+    device->buffer = (int16_t*)calloc(device->buffer_frames, (size_t)config->channels * sizeof(int16_t));
+    if (!device->buffer || platform_mutex_init(&device->lock) != 0) {
+        free(device->buffer);
+        free(device);
+        return -1;
+    }
+    if (platform_cond_init(&device->ready) != 0) {
+        platform_mutex_destroy(&device->lock);
+        free(device->buffer);
+        free(device);
+        return -1;
+    }
+
+    source->ops = &simulated_audio_ops;
+    source->impl = device;
+    source->sample_rate = config->sample_rate;
+    source->channels = config->channels;
+    source->bits_per_sample = 16;
+    source->block_align = config->channels * 2;
+    source->period_ms = config->period_ms;
+    source->buffer_ms = config->buffer_ms;
+    return 0;
+}
+
+int simulated_audio_get_stats(audio_source_t* source, simulated_audio_stats_t* stats) {
+    if (!source || source->ops != &simulated_audio_ops || !source->impl || !stats) return -1;
+    simulated_audio_t* device = (simulated_audio_t*)source->impl;
+    platform_mutex_lock(&device->lock);
+    *stats = device->stats;
+    platform_mutex_unlock(&device->lock);
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+int spsc_ring_init(spsc_ring_t* ring, const char* name, unsigned int capacity, size_t element_size) {
+    if (!ring || capacity == 0 || capacity > (1u << 24) || element_size == 0 || element_size > SPSC_RING_MAX_ELEMENT) return -1;
+
+    unsigned long rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    memset(ring, 0, sizeof(spsc_ring_t));
+    ring->slots = (uint8_t*)platform_aligned_alloc(rounded * element_size, SPSC_RING_CACHE_LINE);
+    if (!ring->slots) return -1;
+
+    ring->name = name ? name : "queue";
+    ring->element_size = element_size;
+    ring->capacity = rounded;
+    ring->mask = rounded - 1;
+    return 0;
+}
+
+void spsc_ring_cleanup(spsc_ring_t* ring) {
+    if (!ring) return;
+    platform_aligned_free(ring->slots);
+    memset(ring, 0, sizeof(spsc_ring_t));
+}
+
+int spsc_ring_push(spsc_ring_t* ring, const void* element) {
+    // Only the producer writes head, so a plain read of it is current
+    unsigned long head = (unsigned long)ring->head;
+    if (head - ring->cached_tail >= ring->capacity) {
+        ring->cached_tail = (unsigned long)platform_atomic_load(&ring->tail);
+        if (head - ring->cached_tail >= ring->capacity) {
+            ring->full++;
+            return -1;
+        }
+    }
+
+    memcpy(ring->slots + (head & ring->mask) * ring->element_size, element, ring->element_size);
+    // Release: the element is visible before the consumer can see the new head
+    platform_atomic_store(&ring->head, (long)(head + 1));
+
+    unsigned long depth = head + 1 - ring->cached_tail;
+    if (depth > ring->high_water) ring->high_water = depth;
+    ring->pushed++;
+    return 0;
+}
+
+int spsc_ring_pop(spsc_ring_t* ring, void* element) {
+    unsigned long tail = (unsigned long)ring->tail;
+    if (tail == ring->cached_head) {
+        ring->cached_head = (unsigned long)platform_atomic_load(&ring->head);
+        if (tail == ring->cached_head) {
+            ring->empty++;
+            return -1;
+        }
+    }
+
+    memcpy(element, ring->slots + (tail & ring->mask) * ring->element_size, ring->element_size);
+    // Release: the slot is read out before the producer may overwrite it
+    platform_atomic_store(&ring->tail, (long)(tail + 1));
+    ring->popped++;
+    return 0;
+}
+
+unsigned int spsc_ring_depth(spsc_ring_t* ring) {
+    if (!ring || !ring->slots) return 0;
+    unsigned long tail = (unsigned long)platform_atomic_load(&ring->tail);
+    unsigned long head = (unsigned long)platform_atomic_load(&ring->head);
+    unsigned long depth = head - tail;
+    return depth > ring->capacity ? (unsigned int)ring->capacity : (unsigned int)depth;
+}
+
+void spsc_ring_get_stats(spsc_ring_t* ring, spsc_ring_stats_t* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(spsc_ring_stats_t));
+    if (!ring || !ring->slots) return;
+
+    stats->capacity = (uint32_t)ring->capacity;
+    stats->depth = spsc_ring_depth(ring);
+    stats->high_water = (uint32_t)ring->high_water;
+    stats->pushed = ring->pushed;
+    stats->popped = ring->popped;
+    stats->full = ring->full;
+    stats->empty = ring->empty;
+}
@@ -0,0 +1,320 @@
+#include "synthetic_source.h"
+#include "copy_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYNTHETIC_BLOCK_COUNT 6
+#define SYNTHETIC_BLOCK_SPEED 240           // Pixels per second, per axis at most
+#define SYNTHETIC_LINE_HEIGHT 16
+#define SYNTHETIC_GLYPH_WIDTH 8
+#define SYNTHETIC_SCROLL_LINES_PER_SECOND 4 // A terminal printing a few lines per second
+
+typedef struct {
+    int x;                          // Position at frame 0
+    int y;
+    int size;
+    int speed_x;                    // Pixels per second
+    int speed_y;
+    uint8_t color[4];
+} synthetic_block_t;
+
+typedef struct {
+    synthetic_source_config_t config;
+    uint8_t* texture;               // blocks: background gradient; text: page (texture_rows tall), top-down
+    int texture_rows;
+    size_t stride;
+    synthetic_block_t blocks[SYNTHETIC_BLOCK_COUNT];
+    uint64_t frame;                 // Index of the next frame
+    int last_offset;                // Text scroll offset last delivered
+    uint64_t noise_state;
+    int delivered;
+} synthetic_state_t;
+
+static uint64_t synthetic_mix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// ---------------------------------------------------------------------------
+// Pattern setup
+// ---------------------------------------------------------------------------
+
+static void synthetic_init_blocks(synthetic_state_t* state) {
+    int width = state->config.width;
+    int height = state->config.height;
+
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = state->texture + (size_t)y * state->stride;
+        for (int x = 0; x < width; x++) {
+            row[x * 4 + 0] = (uint8_t)(x * 255 / (width > 1 ? width - 1 : 1));
+            row[x * 4 + 1] = (uint8_t)(y * 255 / (height > 1 ? height - 1 : 1));
+            row[x * 4 + 2] = 0x40;
+            row[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    int min_side = width < height ? width : height;
+    for (int i = 0; i < SYNTHETIC_BLOCK_COUNT; i++) {
+        uint64_t random = synthetic_mix(state->config.seed * 131u + (uint64_t)i);
+        synthetic_block_t* block = &state->blocks[i];
+        block->size = min_side / 8 + (int)(random % (uint64_t)(min_side / 8 + 1));
+        if (block->size < 1) block->size = 1;
+        block->x = (int)((random >> 8) % (uint64_t)width);
+        block->y = (int)((random >> 24) % (uint64_t)height);
+        block->speed_x = (int)((random >> 40) % (SYNTHETIC_BLOCK_SPEED * 2 + 1)) - SYNTHETIC_BLOCK_SPEED;
+        block->speed_y = (int)((random >> 52) % (SYNTHETIC_BLOCK_SPEED * 2 + 1)) - SYNTHETIC_BLOCK_SPEED;
+        block->color[0] = (uint8_t)(random >> 16);
+        block->color[1] = (uint8_t)(random >> 32);
+        block->color[2] = (uint8_t)(random >> 48);
+        block->color[3] = 0xFF;
+    }
+}
+
+// Lines of 6x10 pseudo-random glyphs in 8x16 cells, dark on light, ragged right
+static void synthetic_init_text(synthetic_state_t* state) {
+    int width = state->config.width;
+    int columns = width / SYNTHETIC_GLYPH_WIDTH;
+
+    for (int y = 0; y < state->texture_rows; y++) {
+        uint8_t* row = state->texture + (size_t)y * state->stride;
+        for (int x = 0; x < width; x++) {
+            row[x * 4 + 0] = 0xF0;
+            row[x * 4 + 1] = 0xF0;
+            row[x * 4 + 2] = 0xF0;
+            row[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    for (int line = 0; line < state->texture_rows / SYNTHETIC_LINE_HEIGHT; line++) {
+        uint64_t line_random = synthetic_mix(((uint64_t)state->config.seed << 32) | (uint64_t)line);
+        int length = columns > 0 ? (int)(line_random % (uint64_t)columns) : 0;
+        for (int column = 0; column < length; column++) {
+            uint64_t glyph = synthetic_mix(line_random ^ ((uint64_t)column << 20));
+            if (glyph % 6 == 0) continue; // Space between words
+
+            for (int gy = 0; gy < 10; gy++) {
+                uint8_t* row = state->texture + (size_t)(line * SYNTHETIC_LINE_HEIGHT + 3 + gy) * state->stride;
+                for (int gx = 0; gx < 6; gx++) {
+                    if (!((glyph >> (gy * 6 + gx)) & 1)) continue;
+                    uint8_t* pixel = row + (size_t)(column * SYNTHETIC_GLYPH_WIDTH + 1 + gx) * 4;
+                    pixel[0] = 0x20;
+                    pixel[1] = 0x20;
+                    pixel[2] = 0x20;
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Frame rendering
+// ---------------------------------------------------------------------------
+
+// Copy texture rows [src_row, src_row + rows) to screen rows starting at screen_row
+static void synthetic_copy_rows(const synthetic_state_t* state, uint8_t* dst, int src_row, int screen_row, int rows,
+                                int top_down) {
+    int height = state->config.height;
+    int dst_top = top_down ? screen_row : height - screen_row - rows;
+    copy_plane(dst + (size_t)dst_top * state->stride, state->stride,
+               state->texture + (size_t)src_row * state->stride, state->stride,
+               state->stride, rows, !top_down);
+}
+
+// Position along one axis bouncing between 0 and limit
+static int synthetic_bounce(int start, int speed, uint64_t frame, int fps, int limit) {
+    if (limit <= 0) return 0;
+    long long period = 2LL * limit;
+    long long position = (start + (long long)speed * (long long)frame / fps) % period;
+    if (position < 0) position += period;
+    return (int)(position > limit ? period - position : position);
+}
+
+static void synthetic_render_blocks(synthetic_state_t* state, uint8_t* dst, int top_down) {
+    int width = state->config.width;
+    int height = state->config.height;
+    synthetic_copy_rows(state, dst, 0, 0, height, top_down);
+
+    for (int i = 0; i < SYNTHETIC_BLOCK_COUNT; i++) {
+        const synthetic_block_t* block = &state->blocks[i];
+        int size_x = block->size < width ? block->size : width;
+        int size_y = block->size < height ? block->size : height;
+        int left = synthetic_bounce(block->x, block->speed_x, state->frame, state->config.fps, width - size_x);
+        int top = synthetic_bounce(block->y, block->speed_y, state->frame, state->config.fps, height - size_y);
+
+        for (int y = top; y < top + size_y; y++) {
+            uint8_t* row = dst + (size_t)(top_down ? y : height - 1 - y) * state->stride + (size_t)left * 4;
+            for (int x = 0; x < size_x; x++) {
+                memcpy(row + x * 4, block->color, 4);
+            }
+        }
+    }
+}
+
+static int synthetic_text_offset(const synthetic_state_t* state) {
+    uint64_t lines = state->frame * SYNTHETIC_SCROLL_LINES_PER_SECOND / (uint64_t)state->config.fps;
+    return (int)((lines * SYNTHETIC_LINE_HEIGHT) % (uint64_t)state->texture_rows);
+}
+
+static void synthetic_render_text(synthetic_state_t* state, uint8_t* dst, int top_down, int offset) {
+    int height = state->config.height;
+    int first = state->texture_rows - offset < height ? state->texture_rows - offset : height;
+    synthetic_copy_rows(state, dst, offset, 0, first, top_down);
+    if (first < height) {
+        synthetic_copy_rows(state, dst, 0, first, height - first, top_down);
+    }
+}
+
+static void synthetic_render_noise(synthetic_state_t* state, uint8_t* dst, int top_down) {
+    int height = state->config.height;
+    size_t words = state->stride / 8;
+    uint64_t x = state->noise_state;
+
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = dst + (size_t)(top_down ? y : height - 1 - y) * state->stride;
+        for (size_t i = 0; i < words; i++) {
+            x ^= x >> 12;
+            x ^= x << 25;
+            x ^= x >> 27;
+            uint64_t value = (x * 0x2545F4914F6CDD1Dull) | 0xFF000000FF000000ull;
+            memcpy(row + i * 8, &value, 8);
+        }
+        if (state->stride % 8) {
+            uint32_t value = (uint32_t)(x >> 7) | 0xFF000000u;
+            memcpy(row + words * 8, &value, 4);
+        }
+    }
+    state->noise_state = x;
+}
+
+// ---------------------------------------------------------------------------
+// Backend
+// ---------------------------------------------------------------------------
+
+static int synthetic_get_frame(capture_source_t* source, frame_handle_t* frame, int top_down) {
+    synthetic_state_t* state = (synthetic_state_t*)source->impl;
+
+    // Text only changes when the page scrolls a line; in between it is a static desktop
+    int offset = 0;
+    if (state->config.pattern == SYNTHETIC_PATTERN_TEXT) {
+        offset = synthetic_text_offset(state);
+        if (state->delivered && offset == state->last_offset) {
+            state->frame++;
+            return CAPTURE_FRAME_REPEAT;
+        }
+    }
+
+    frame_handle_t handle = frame_pool_acquire(source->pool);
+    if (handle == FRAME_HANDLE_INVALID) return CAPTURE_FRAME_NONE;
+    uint8_t* dst = (uint8_t*)frame_pool_data(source->pool, handle);
+
+    switch (state->config.pattern) {
+    case SYNTHETIC_PATTERN_BLOCKS:
+        synthetic_render_blocks(state, dst, top_down);
+        break;
+    case SYNTHETIC_PATTERN_TEXT:
+        synthetic_render_text(state, dst, top_down, offset);
+        state->last_offset = offset;
+        break;
+    case SYNTHETIC_PATTERN_NOISE:
+        synthetic_render_noise(state, dst, top_down);
+        break;
+    }
+
+    state->frame++;
+    state->delivered = 1;
+    *frame = handle;
+    return CAPTURE_FRAME_NEW;
+}
+
+static void synthetic_report(capture_source_t* source, capture_report_fn report) {
+    synthetic_state_t* state = (synthetic_state_t*)source->impl;
+    char message[128];
+    snprintf(message, sizeof(message), "Synthetic source: %llu ticks, %llu frames rendered (%s)",
+             (unsigned long long)state->frame, (unsigned long long)source->frames_delivered,
+             synthetic_pattern_name(state->config.pattern));
+    report(message);
+}
+
+static void synthetic_destroy(capture_source_t* source) {
+    synthetic_state_t* state = (synthetic_state_t*)source->impl;
+    if (!state) return;
+    free(state->texture);
+    free(state);
+    source->impl = NULL;
+}
+
+static const capture_source_ops_t synthetic_ops = {
+    "synthetic",
+    NULL,
+    NULL,
+    synthetic_get_frame,
+    NULL,
+    synthetic_report,
+    synthetic_destroy
+};
+
+int synthetic_source_create(capture_source_t* source, const synthetic_source_config_t* config) {
+    if (!source || !config) return -1;
+    memset(source, 0, sizeof(capture_source_t));
+    if (config->width <= 0 || config->height <= 0 || config->fps <= 0) {
+        fprintf(stderr, "Synthetic source: Invalid size %dx%d at %d fps\n", config->width, config->height, config->fps);
+        return -1;
+    }
+    if (config->pattern != SYNTHETIC_PATTERN_BLOCKS && config->pattern != SYNTHETIC_PATTERN_TEXT &&
+        config->pattern != SYNTHETIC_PATTERN_NOISE) {
+        fprintf(stderr, "Synthetic source: Unknown pattern %d\n", (int)config->pattern);
+        return -1;
+    }
+
+    synthetic_state_t* state = (synthetic_state_t*)calloc(1, sizeof(synthetic_state_t));
+    if (!state) return -1;
+    state->config = *config;
+    state->stride = (size_t)config->width * 4;
+    state->last_offset = -1;
+    state->noise_state = synthetic_mix(config->seed) | 1;
+
+    // The text page is twice the screen so the visible text does not repeat
+    int lines = (config->height + SYNTHETIC_LINE_HEIGHT - 1) / SYNTHETIC_LINE_HEIGHT;
+    state->texture_rows = config->pattern == SYNTHETIC_PATTERN_TEXT ? lines * 2 * SYNTHETIC_LINE_HEIGHT : config->height;
+    if (config->pattern != SYNTHETIC_PATTERN_NOISE) {
+        state->texture = (uint8_t*)malloc(state->stride * (size_t)state->texture_rows);
+        if (!state->texture) {
+            fprintf(stderr, "Synthetic source: Failed to allocate %dx%d pattern\n", config->width, state->texture_rows);
+            free(state);
+            return -1;
+        }
+        if (config->pattern == SYNTHETIC_PATTERN_BLOCKS) {
+            synthetic_init_blocks(state);
+        } else {
+            synthetic_init_text(state);
+        }
+    }
+
+    source->ops = &synthetic_ops;
+    source->impl = state;
+    source->width = config->width;
+    source->height = config->height;
+    source->fps = config->fps;
+    return 0;
+}
+
+const char* synthetic_pattern_name(synthetic_pattern_t pattern) {
+    switch (pattern) {
+    case SYNTHETIC_PATTERN_BLOCKS: return "blocks";
+    case SYNTHETIC_PATTERN_TEXT: return "text";
+    case SYNTHETIC_PATTERN_NOISE: return "noise";
+    }
+    return "unknown";
+}
+
+int synthetic_pattern_parse(const char* name, synthetic_pattern_t* pattern) {
+    if (!name || !pattern) return -1;
+    if (strcmp(name, "blocks") == 0) *pattern = SYNTHETIC_PATTERN_BLOCKS;
+    else if (strcmp(name, "text") == 0) *pattern = SYNTHETIC_PATTERN_TEXT;
+    else if (strcmp(name, "noise") == 0) *pattern = SYNTHETIC_PATTERN_NOISE;
+    else return -1;
+    return 0;
+}
@@ -5,10 +5,11 @@
 #include <stdio.h>
 #include <string.h>
 
-int system_init(system_context_t* ctx) {
+int system_init(system_context_t* ctx, UINT32 buffer_ms) {
     if (!ctx) return -1;
     
     memset(ctx, 0, sizeof(system_context_t));
+    ctx->buffer_ms = buffer_ms ? buffer_ms : SYSTEM_DEFAULT_BUFFER_MS;
     ctx->using_silent_buffer = FALSE;
     
     HRESULT hr;
@@ -87,18 +88,33 @@ int system_init(system_context_t* ctx) {
     AUDCLNT_SHAREMODE share_mode = AUDCLNT_SHAREMODE_SHARED;
     DWORD stream_flags = AUDCLNT_STREAMFLAGS_LOOPBACK;  // Critical for system audio
     
-    // Use smaller buffer (50ms) to reduce latency
-    REFERENCE_TIME buffer_duration = 500000; // 50ms in 100-nanosecond units
+    // Event-driven: the device signals ready_event once per period instead of being polled
+    REFERENCE_TIME buffer_duration = (REFERENCE_TIME)ctx->buffer_ms * 10000; // 100-nanosecond units
     
     hr = IAudioClient_Initialize(
         ctx->audio_client,
         share_mode,
-        stream_flags,
+        stream_flags | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
         buffer_duration,
         0,
         ctx->wave_format,
         NULL
     );
+    ctx->event_driven = SUCCEEDED(hr);
+    
+    // Endpoints that refuse event callbacks are drained on the capture thread's wait timeout.
+    // Loopback before Windows 10 1703 accepts the flag but never signals; the timeout covers that too.
+    if (!ctx->event_driven) {
+        hr = IAudioClient_Initialize(
+            ctx->audio_client,
+            share_mode,
+            stream_flags,
+            buffer_duration,
+            0,
+            ctx->wave_format,
+            NULL
+        );
+    }
     
     if (FAILED(hr)) {
         fprintf(stderr, "System: Failed to initialize audio client: 0x%08X\n", hr);
@@ -136,10 +152,35 @@ int system_init(system_context_t* ctx) {
         return -1;
     }
     
-    printf("System audio initialized: %d Hz, %d channels, %d bits\n",
+    // Device period, for the capture thread's wait timeout
+    REFERENCE_TIME default_period = 0;
+    if (SUCCEEDED(IAudioClient_GetDevicePeriod(ctx->audio_client, &default_period, NULL)) && default_period > 0) {
+        ctx->period_ms = (UINT32)((default_period + 9999) / 10000);
+    } else {
+        ctx->period_ms = 10;
+    }
+    
+    if (ctx->event_driven) {
+        ctx->ready_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+        if (!ctx->ready_event || FAILED(IAudioClient_SetEventHandle(ctx->audio_client, ctx->ready_event))) {
+            fprintf(stderr, "System: Failed to set the buffer-ready event\n");
+            if (ctx->ready_event) CloseHandle(ctx->ready_event);
+            IAudioCaptureClient_Release(ctx->capture_client);
+            CoTaskMemFree(ctx->wave_format);
+            IAudioClient_Release(ctx->audio_client);
+            IMMDevice_Release(ctx->device);
+            IMMDeviceEnumerator_Release(ctx->enumerator);
+            memset(ctx, 0, sizeof(system_context_t));
+            return -1;
+        }
+    }
+    
+    printf("System audio initialized: %d Hz, %d channels, %d bits, %u ms buffer (%s)\n",
            ctx->wave_format->nSamplesPerSec,
            ctx->wave_format->nChannels,
-           ctx->wave_format->wBitsPerSample);
+           ctx->wave_format->wBitsPerSample,
+           ctx->buffer_ms,
+           ctx->event_driven ? "event-driven" : "polled");
     
     return 0;
 }
@@ -162,6 +203,21 @@ int system_start_capture(system_context_t* ctx) {
     return 0;
 }
 
+int system_wait(system_context_t* ctx, DWORD timeout_ms) {
+    if (!ctx || !ctx->audio_client) return -1;
+    
+    // Polled endpoints wake often enough to drain the buffer well before it fills
+    if (!ctx->event_driven) {
+        DWORD poll_ms = ctx->buffer_ms / 4;
+        Sleep(poll_ms == 0 ? 1 : (poll_ms < timeout_ms ? poll_ms : timeout_ms));
+        return 1;
+    }
+    
+    DWORD result = WaitForSingleObject(ctx->ready_event, timeout_ms);
+    if (result == WAIT_OBJECT_0) return 0;
+    return result == WAIT_TIMEOUT ? 1 : -1;
+}
+
 int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames) {
     if (!ctx || !ctx->capture_client || !ctx->is_capturing) {
         if (data) *data = NULL;
@@ -181,37 +237,30 @@ int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames) {
     if (*num_frames == 0) {
         // For system audio capture, generate silent frames when no audio is playing
         // This ensures continuous audio stream for proper MP4 encoding and matching video duration
-        static BYTE* silent_buffer = NULL;
-        static UINT32 silent_buffer_size = 0;
-        static UINT32 silent_call_count = 0;
-        static DWORD recording_start_time = 0;
-        static UINT64 total_generated_samples = 0;
-        static DWORD last_silent_generation = 0;
-        
-        silent_call_count++;
+        ctx->silent_call_count++;
         DWORD current_time = GetTickCount();
         
         // Initialize timing on first call
-        if (recording_start_time == 0) {
-            recording_start_time = current_time;
-            last_silent_generation = current_time;
-            total_generated_samples = 0;
+        if (ctx->silent_start_time == 0) {
+            ctx->silent_start_time = current_time;
+            ctx->last_silent_generation = current_time;
+            ctx->silent_samples = 0;
         }
         
         // CRITICAL TIMING FIX: Generate audio based on recording elapsed time
         // Calculate how many total samples should exist based on recording duration
-        DWORD recording_elapsed_ms = current_time - recording_start_time;
+        DWORD recording_elapsed_ms = current_time - ctx->silent_start_time;
         UINT64 expected_total_samples = ((UINT64)ctx->wave_format->nSamplesPerSec * recording_elapsed_ms) / 1000;
         
         // Only generate more samples if we're behind the expected total
-        if (total_generated_samples >= expected_total_samples) {
+        if (ctx->silent_samples >= expected_total_samples) {
             *data = NULL;
             *num_frames = 0;
             return 0; // We're already caught up
         }
         
         // Calculate how many samples we need to generate to catch up
-        UINT64 samples_needed = expected_total_samples - total_generated_samples;
+        UINT64 samples_needed = expected_total_samples - ctx->silent_samples;
         
         // Limit to reasonable chunk size (50ms worth max)
         UINT32 max_chunk_samples = (ctx->wave_format->nSamplesPerSec * 50) / 1000;
@@ -219,37 +268,37 @@ int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames) {
             samples_needed = max_chunk_samples;
         }
         
-        if (silent_call_count % 100 == 0) {
+        if (ctx->silent_call_count % 100 == 0) {
             printf("System audio: Recording %ums, expected %llu samples, generated %llu, need %llu\n", 
-                   recording_elapsed_ms, expected_total_samples, total_generated_samples, samples_needed);
+                   recording_elapsed_ms, expected_total_samples, ctx->silent_samples, samples_needed);
         }
         
         UINT32 frames_to_generate = (UINT32)samples_needed;
         UINT32 bytes_needed = frames_to_generate * ctx->wave_format->nBlockAlign;
         
         // Expand buffer if needed
-        if (silent_buffer_size < bytes_needed) {
-            if (silent_buffer) {
-                free(silent_buffer);
+        if (ctx->silent_buffer_size < bytes_needed) {
+            if (ctx->silent_buffer) {
+                free(ctx->silent_buffer);
             }
-            silent_buffer = (BYTE*)malloc(bytes_needed);
-            if (!silent_buffer) {
+            ctx->silent_buffer = (BYTE*)malloc(bytes_needed);
+            if (!ctx->silent_buffer) {
                 *data = NULL;
                 *num_frames = 0;
                 return -1;
             }
-            silent_buffer_size = bytes_needed;
+            ctx->silent_buffer_size = bytes_needed;
         }
         
         // Fill with silent audio
-        memset(silent_buffer, 0, bytes_needed);
+        memset(ctx->silent_buffer, 0, bytes_needed);
         
-        *data = silent_buffer;
+        *data = ctx->silent_buffer;
         *num_frames = frames_to_generate;
         ctx->using_silent_buffer = TRUE;
         
         // Update our total generated samples count
-        total_generated_samples += frames_to_generate;
+        ctx->silent_samples += frames_to_generate;
         
         return 0; // Return success with silent frames
     }
@@ -280,14 +329,14 @@ int system_get_buffer(system_context_t* ctx, BYTE** data, UINT32* num_frames) {
 void system_release_buffer(system_context_t* ctx, UINT32 num_frames) {
     if (!ctx || !ctx->capture_client) return;
     
-    // Only release real audio buffers, not our static silent buffers
+    // Only release real audio buffers, not our silent buffers
     if (!ctx->using_silent_buffer) {
         HRESULT hr = IAudioCaptureClient_ReleaseBuffer(ctx->capture_client, num_frames);
         if (FAILED(hr)) {
             fprintf(stderr, "System: Failed to release buffer: 0x%08X\n", hr);
         }
     }
-    // For silent buffers, no release is needed since they're static
+    // For silent buffers, no release is needed since the context owns them
 }
 
 void system_stop_capture(system_context_t* ctx) {
@@ -320,6 +369,11 @@ void system_cleanup(system_context_t* ctx) {
         ctx->wave_format = NULL;
     }
     
+    if (ctx->ready_event) {
+        CloseHandle(ctx->ready_event);
+        ctx->ready_event = NULL;
+    }
+    
     if (ctx->device) {
         IMMDevice_Release(ctx->device);
         ctx->device = NULL;
@@ -330,6 +384,11 @@ void system_cleanup(system_context_t* ctx) {
         ctx->enumerator = NULL;
     }
     
+    if (ctx->silent_buffer) {
+        free(ctx->silent_buffer);
+        ctx->silent_buffer = NULL;
+    }
+    
     memset(ctx, 0, sizeof(system_context_t));
     printf("System audio capture cleaned up\n");
 }
@@ -0,0 +1,316 @@
+#include "tile_hash.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TILE_HASH_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TILE_HASH_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TILE_HASH_TARGET(isa)
+#endif
+
+#define TILE_HASH_STRIPE 32         // Bytes consumed per accumulate step, four 64-bit lanes
+
+#define TILE_HASH_PRIME32 0x9E3779B1u
+#define TILE_HASH_PRIME64_1 0x9E3779B185EBCA87ull
+#define TILE_HASH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define TILE_HASH_PRIME64_3 0x165667B19E3779F9ull
+#define TILE_HASH_PRIME64_4 0x85EBCA77C2B2AE63ull
+
+// XORed into each lane when a row is folded in, so rows do not commute
+static const uint64_t tile_hash_scramble_keys[4] = {
+    0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull, 0x78E5C0CC4EE679CBull
+};
+
+static const uint64_t tile_hash_seeds[4] = {
+    TILE_HASH_PRIME64_1, TILE_HASH_PRIME64_2, TILE_HASH_PRIME64_3, TILE_HASH_PRIME64_4
+};
+
+// ---------------------------------------------------------------------------
+// Row kernels: fold `rows` rows of `row_bytes` bytes into the four lanes. A
+// row's trailing partial stripe is zero-padded, one key per 8-byte word keeps
+// stripes within a row from commuting, and each row ends with a scramble.
+// ---------------------------------------------------------------------------
+
+typedef void (*tile_hash_rows_fn)(uint64_t acc[4], const uint8_t* src, size_t pitch, int row_bytes, int rows,
+                                  const uint64_t* keys);
+
+static void tile_hash_stripe_scalar(uint64_t acc[4], const uint8_t* data, const uint64_t* keys) {
+    for (int lane = 0; lane < 4; lane++) {
+        uint64_t word;
+        memcpy(&word, data + lane * 8, 8);
+        uint64_t mixed = word ^ keys[lane];
+        acc[lane] += (mixed & 0xFFFFFFFFu) * (mixed >> 32) + word;
+    }
+}
+
+static void tile_hash_rows_scalar(uint64_t acc[4], const uint8_t* src, size_t pitch, int row_bytes, int rows,
+                                  const uint64_t* keys) {
+    int stripes = row_bytes / TILE_HASH_STRIPE;
+    int tail = row_bytes - stripes * TILE_HASH_STRIPE;
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* row = src + (size_t)y * pitch;
+        for (int s = 0; s < stripes; s++) {
+            tile_hash_stripe_scalar(acc, row + s * TILE_HASH_STRIPE, keys + s * 4);
+        }
+        if (tail) {
+            uint8_t padded[TILE_HASH_STRIPE] = {0};
+            memcpy(padded, row + stripes * TILE_HASH_STRIPE, (size_t)tail);
+            tile_hash_stripe_scalar(acc, padded, keys + stripes * 4);
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t value = acc[lane];
+            value ^= value >> 47;
+            value ^= tile_hash_scramble_keys[lane];
+            acc[lane] = value * TILE_HASH_PRIME32;
+        }
+    }
+}
+
+#ifdef TILE_HASH_X86
+
+// value * PRIME32 modulo 2^64 from two 32x32->64 multiplies
+TILE_HASH_TARGET("sse2")
+static __m128i tile_hash_scramble_sse2(__m128i acc, __m128i key) {
+    const __m128i prime = _mm_set1_epi32((int)TILE_HASH_PRIME32);
+    acc = _mm_xor_si128(_mm_xor_si128(acc, _mm_srli_epi64(acc, 47)), key);
+    __m128i low = _mm_mul_epu32(acc, prime);
+    __m128i high = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(acc, 32), prime), 32);
+    return _mm_add_epi64(low, high);
+}
+
+TILE_HASH_TARGET("sse2")
+static __m128i tile_hash_accumulate_sse2(__m128i acc, __m128i data, __m128i key) {
+    __m128i mixed = _mm_xor_si128(data, key);
+    __m128i product = _mm_mul_epu32(mixed, _mm_srli_epi64(mixed, 32));
+    return _mm_add_epi64(acc, _mm_add_epi64(product, data));
+}
+
+TILE_HASH_TARGET("sse2")
+static void tile_hash_rows_sse2(uint64_t acc[4], const uint8_t* src, size_t pitch, int row_bytes, int rows,
+                                const uint64_t* keys) {
+    int stripes = row_bytes / TILE_HASH_STRIPE;
+    int tail = row_bytes - stripes * TILE_HASH_STRIPE;
+    __m128i acc0 = _mm_loadu_si128((const __m128i*)acc);
+    __m128i acc1 = _mm_loadu_si128((const __m128i*)(acc + 2));
+    const __m128i scramble0 = _mm_loadu_si128((const __m128i*)tile_hash_scramble_keys);
+    const __m128i scramble1 = _mm_loadu_si128((const __m128i*)(tile_hash_scramble_keys + 2));
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* row = src + (size_t)y * pitch;
+        for (int s = 0; s < stripes; s++) {
+            const uint8_t* data = row + s * TILE_HASH_STRIPE;
+            acc0 = tile_hash_accumulate_sse2(acc0, _mm_loadu_si128((const __m128i*)data),
+                                             _mm_loadu_si128((const __m128i*)(keys + s * 4)));
+            acc1 = tile_hash_accumulate_sse2(acc1, _mm_loadu_si128((const __m128i*)(data + 16)),
+                                             _mm_loadu_si128((const __m128i*)(keys + s * 4 + 2)));
+        }
+        if (tail) {
+            uint8_t padded[TILE_HASH_STRIPE] = {0};
+            memcpy(padded, row + stripes * TILE_HASH_STRIPE, (size_t)tail);
+            acc0 = tile_hash_accumulate_sse2(acc0, _mm_loadu_si128((const __m128i*)padded),
+                                             _mm_loadu_si128((const __m128i*)(keys + stripes * 4)));
+            acc1 = tile_hash_accumulate_sse2(acc1, _mm_loadu_si128((const __m128i*)(padded + 16)),
+                                             _mm_loadu_si128((const __m128i*)(keys + stripes * 4 + 2)));
+        }
+        acc0 = tile_hash_scramble_sse2(acc0, scramble0);
+        acc1 = tile_hash_scramble_sse2(acc1, scramble1);
+    }
+
+    _mm_storeu_si128((__m128i*)acc, acc0);
+    _mm_storeu_si128((__m128i*)(acc + 2), acc1);
+}
+
+TILE_HASH_TARGET("avx2")
+static __m256i tile_hash_accumulate_avx2(__m256i acc, __m256i data, __m256i key) {
+    __m256i mixed = _mm256_xor_si256(data, key);
+    __m256i product = _mm256_mul_epu32(mixed, _mm256_srli_epi64(mixed, 32));
+    return _mm256_add_epi64(acc, _mm256_add_epi64(product, data));
+}
+
+TILE_HASH_TARGET("avx2")
+static void tile_hash_rows_avx2(uint64_t acc[4], const uint8_t* src, size_t pitch, int row_bytes, int rows,
+                                const uint64_t* keys) {
+    int stripes = row_bytes / TILE_HASH_STRIPE;
+    int tail = row_bytes - stripes * TILE_HASH_STRIPE;
+    __m256i lanes = _mm256_loadu_si256((const __m256i*)acc);
+    const __m256i scramble = _mm256_loadu_si256((const __m256i*)tile_hash_scramble_keys);
+    const __m256i prime = _mm256_set1_epi32((int)TILE_HASH_PRIME32);
+
+    for (int y = 0; y < rows; y++) {
+        const uint8_t* row = src + (size_t)y * pitch;
+        for (int s = 0; s < stripes; s++) {
+            lanes = tile_hash_accumulate_avx2(lanes, _mm256_loadu_si256((const __m256i*)(row + s * TILE_HASH_STRIPE)),
+                                              _mm256_loadu_si256((const __m256i*)(keys + s * 4)));
+        }
+        if (tail) {
+            uint8_t padded[TILE_HASH_STRIPE] = {0};
+            memcpy(padded, row + stripes * TILE_HASH_STRIPE, (size_t)tail);
+            lanes = tile_hash_accumulate_avx2(lanes, _mm256_loadu_si256((const __m256i*)padded),
+                                              _mm256_loadu_si256((const __m256i*)(keys + stripes * 4)));
+        }
+        lanes = _mm256_xor_si256(_mm256_xor_si256(lanes, _mm256_srli_epi64(lanes, 47)), scramble);
+        __m256i low = _mm256_mul_epu32(lanes, prime);
+        __m256i high = _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(lanes, 32), prime), 32);
+        lanes = _mm256_add_epi64(low, high);
+    }
+
+    _mm256_storeu_si256((__m256i*)acc, lanes);
+}
+
+#endif // TILE_HASH_X86
+
+static tile_hash_rows_fn tile_hash_kernel_for(copy_kernel_level_t level) {
+#ifdef TILE_HASH_X86
+    if (level >= COPY_KERNEL_AVX2) return tile_hash_rows_avx2;
+    if (level == COPY_KERNEL_SSE2) return tile_hash_rows_sse2;
+#else
+    (void)level;
+#endif
+    return tile_hash_rows_scalar;
+}
+
+// Fold the lanes into one value with a full avalanche
+static uint64_t tile_hash_finish(const uint64_t acc[4], int width, int height) {
+    uint64_t hash = ((uint64_t)(uint32_t)width << 32 | (uint32_t)height) * TILE_HASH_PRIME64_3;
+    for (int lane = 0; lane < 4; lane++) {
+        uint64_t value = acc[lane] * TILE_HASH_PRIME64_2;
+        value = (value << 31) | (value >> 33);
+        hash ^= value * TILE_HASH_PRIME64_1;
+        hash = ((hash << 27) | (hash >> 37)) * TILE_HASH_PRIME64_1 + TILE_HASH_PRIME64_4;
+    }
+    hash ^= hash >> 33;
+    hash *= TILE_HASH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= TILE_HASH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+int tile_hash_init(tile_hash_t* hash, int width, int height, int tile_size) {
+    if (!hash || width <= 0 || height <= 0) return -1;
+    if (tile_size == 0) tile_size = TILE_HASH_DEFAULT_TILE;
+    if (tile_size < 8 || tile_size > TILE_HASH_MAX_TILE || (tile_size % 8) != 0) {
+        fprintf(stderr, "Tile hash: Tile size %d must be a multiple of 8 up to %d\n", tile_size, TILE_HASH_MAX_TILE);
+        return -1;
+    }
+
+    memset(hash, 0, sizeof(tile_hash_t));
+    hash->width = width;
+    hash->height = height;
+    hash->tile_size = tile_size;
+    hash->tiles_x = (width + tile_size - 1) / tile_size;
+    hash->tiles_y = (height + tile_size - 1) / tile_size;
+    hash->level = copy_kernels_best_level();
+
+    size_t tiles = (size_t)hash->tiles_x * hash->tiles_y;
+    hash->hashes = (uint64_t*)calloc(tiles, sizeof(uint64_t));
+    hash->changed = (uint8_t*)calloc(tiles, 1);
+    if (!hash->hashes || !hash->changed) {
+        fprintf(stderr, "Tile hash: Failed to allocate %zu tiles\n", tiles);
+        tile_hash_cleanup(hash);
+        return -1;
+    }
+
+    // Fixed keys (splitmix64) so hashes are comparable across runs and machines
+    uint64_t state = 0x6D7578737754696Cull;
+    for (size_t i = 0; i < sizeof(hash->keys) / sizeof(hash->keys[0]); i++) {
+        uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        hash->keys[i] = value ^ (value >> 31);
+    }
+    return 0;
+}
+
+void tile_hash_cleanup(tile_hash_t* hash) {
+    if (!hash) return;
+    free(hash->hashes);
+    free(hash->changed);
+    memset(hash, 0, sizeof(tile_hash_t));
+}
+
+int tile_hash_set_level(tile_hash_t* hash, copy_kernel_level_t level) {
+    if (!hash || level < COPY_KERNEL_SCALAR || level >= COPY_KERNEL_COUNT) return -1;
+    if (!copy_kernels_supported(level)) return -1;
+    hash->level = level;
+    return 0;
+}
+
+void tile_hash_set_pool(tile_hash_t* hash, worker_pool_t* pool) {
+    if (hash) hash->pool = pool;
+}
+
+void tile_hash_reset(tile_hash_t* hash) {
+    if (hash) hash->has_frame = 0;
+}
+
+uint64_t tile_hash_block(const tile_hash_t* hash, const uint8_t* pixels, size_t pitch, int width, int height) {
+    uint64_t acc[4];
+    memcpy(acc, tile_hash_seeds, sizeof(acc));
+    tile_hash_kernel_for(hash->level)(acc, pixels, pitch, width * 4, height, hash->keys);
+    return tile_hash_finish(acc, width, height);
+}
+
+typedef struct {
+    tile_hash_t* hash;
+    const uint8_t* pixels;
+    size_t pitch;
+} tile_hash_job_t;
+
+// One task per row of tiles
+static int tile_hash_row_task(void* context, int task, int worker) {
+    tile_hash_job_t* job = (tile_hash_job_t*)context;
+    tile_hash_t* hash = job->hash;
+    int size = hash->tile_size;
+    int top = task * size;
+    int rows = hash->height - top < size ? hash->height - top : size;
+    (void)worker;
+
+    for (int tx = 0; tx < hash->tiles_x; tx++) {
+        int left = tx * size;
+        int columns = hash->width - left < size ? hash->width - left : size;
+        size_t index = (size_t)task * hash->tiles_x + tx;
+        uint64_t value = tile_hash_block(hash, job->pixels + (size_t)top * job->pitch + (size_t)left * 4, job->pitch,
+                                         columns, rows);
+        hash->changed[index] = !hash->has_frame || value != hash->hashes[index];
+        hash->hashes[index] = value;
+    }
+    return 0;
+}
+
+int tile_hash_update(tile_hash_t* hash, const uint8_t* pixels, size_t pitch) {
+    if (!hash || !hash->hashes || !pixels || pitch < (size_t)hash->width * 4) return -1;
+
+    tile_hash_job_t job = { hash, pixels, pitch };
+    if (hash->pool && worker_pool_threads(hash->pool) > 1 && hash->tiles_y > 1) {
+        if (worker_pool_run(hash->pool, hash->tiles_y, tile_hash_row_task, &job) != 0) return -1;
+    } else {
+        for (int ty = 0; ty < hash->tiles_y; ty++) {
+            tile_hash_row_task(&job, ty, 0);
+        }
+    }
+
+    int changed = 0;
+    size_t tiles = (size_t)hash->tiles_x * hash->tiles_y;
+    for (size_t i = 0; i < tiles; i++) {
+        changed += hash->changed[i] != 0;
+    }
+
+    hash->has_frame = 1;
+    hash->changed_tiles = changed;
+    hash->frames++;
+    if (changed == 0) hash->unchanged_frames++;
+    return changed;
+}
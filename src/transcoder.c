@@ -0,0 +1,449 @@
+#include "transcoder.h"
+#include "capture_spool.h"
+#include "encoder_backend.h"
+#include "frame_pool.h"
+#include "pipeline.h"
+#include "platform.h"
+#include "replay_source.h"
+#include "scaler.h"
+#include "spsc_ring.h"
+#include "worker_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRANSCODE_TICKS_PER_SECOND 10000000LL
+
+typedef struct {
+    frame_handle_t frame;           // FRAME_HANDLE_INVALID: the previous frame again
+    int64_t time;                   // 100 ns units
+} transcode_item_t;
+
+typedef struct {
+    const transcode_config_t* config;
+    transcode_stats_t* stats;
+
+    // Input
+    capture_spool_reader_t spool;
+    platform_map_t raw;
+    uint64_t raw_frames;
+    uint64_t next_frame;
+    int fps;
+    size_t input_pitch;
+
+    // Stages, in pipeline order, and the queues between them
+    pipeline_t pipeline;
+    int read_stage;
+    int convert_stage;
+    int encode_stage;
+    spsc_ring_t read_queue;         // BGRA frames
+    spsc_ring_t convert_queue;      // NV12 frames
+    frame_pool_t input_pool;
+    frame_pool_t output_pool;
+
+    worker_pool_t workers;
+    color_converter_t converter;
+    scaler_t scaler;
+    int scaling;
+    uint8_t* scaled;                // Scaler output, converted from there
+
+    encoder_backend_t encoder;
+    int has_time;
+    int64_t first_time;
+    int64_t last_time;
+    platform_atomic_t encoded;      // For progress from the calling thread
+} transcoder_t;
+
+void transcode_config_defaults(transcode_config_t* config) {
+    if (!config) return;
+    memset(config, 0, sizeof(transcode_config_t));
+    config->matrix = COLOR_MATRIX_BT709;
+    config->range = COLOR_RANGE_LIMITED;
+    config->queue_depth = TRANSCODE_DEFAULT_QUEUE;
+    config->encoder = ENCODER_BACKEND_H264;
+}
+
+// ---------------------------------------------------------------------------
+// Stages
+// ---------------------------------------------------------------------------
+
+static int transcode_read_spool(transcoder_t* transcoder, transcode_item_t* item) {
+    // The frame is taken before the reader moves on, so a full pool never loses one
+    frame_handle_t frame = frame_pool_acquire(&transcoder->input_pool);
+    if (frame == FRAME_HANDLE_INVALID) return PIPELINE_STEP_BLOCKED;
+
+    capture_spool_frame_t info;
+    int result = capture_spool_reader_next(&transcoder->spool, NULL, 0, &info);
+    if (result != 1) {
+        frame_pool_release(&transcoder->input_pool, frame);
+        if (result < 0) return PIPELINE_STEP_ERROR;
+        if (transcoder->spool.complete || !transcoder->config->follow) return PIPELINE_STEP_DONE;
+        return PIPELINE_STEP_IDLE;
+    }
+
+    item->time = info.time;
+    if (info.changed_tiles == 0 && transcoder->spool.frames > 1) {
+        frame_pool_release(&transcoder->input_pool, frame);
+        item->frame = FRAME_HANDLE_INVALID;
+        return PIPELINE_STEP_BUSY;
+    }
+    capture_spool_reader_compose(&transcoder->spool, (uint8_t*)frame_pool_data(&transcoder->input_pool, frame),
+                                 transcoder->input_pitch);
+    item->frame = frame;
+    return PIPELINE_STEP_BUSY;
+}
+
+static int transcode_read_raw(transcoder_t* transcoder, transcode_item_t* item) {
+    if (transcoder->next_frame >= transcoder->raw_frames) return PIPELINE_STEP_DONE;
+    frame_handle_t frame = frame_pool_acquire(&transcoder->input_pool);
+    if (frame == FRAME_HANDLE_INVALID) return PIPELINE_STEP_BLOCKED;
+
+    // Copying out of the mapping is what pulls the file in from disk
+    size_t frame_size = transcoder->input_pitch * (size_t)transcoder->stats->input_height;
+    const uint8_t* src = transcoder->raw.data + REPLAY_FILE_HEADER_SIZE + transcoder->next_frame * frame_size;
+    memcpy(frame_pool_data(&transcoder->input_pool, frame), src, frame_size);
+    item->frame = frame;
+    item->time = (int64_t)(transcoder->next_frame * TRANSCODE_TICKS_PER_SECOND / (uint64_t)transcoder->fps);
+    transcoder->next_frame++;
+    return PIPELINE_STEP_BUSY;
+}
+
+static int transcode_read_step(void* context) {
+    transcoder_t* transcoder = (transcoder_t*)context;
+    if (spsc_ring_depth(&transcoder->read_queue) >= transcoder->read_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    uint64_t start = platform_time_ns();
+    transcode_item_t item;
+    int result = transcoder->stats->input == TRANSCODE_INPUT_SPOOL ? transcode_read_spool(transcoder, &item)
+                                                                    : transcode_read_raw(transcoder, &item);
+    if (result != PIPELINE_STEP_BUSY) return result;
+
+    // Only this thread pushes here and the depth was checked above
+    spsc_ring_push(&transcoder->read_queue, &item);
+    pipeline_notify(&transcoder->pipeline, transcoder->convert_stage);
+    transcoder->stats->read.frames++;
+    transcoder->stats->read.busy_ns += platform_time_ns() - start;
+    return PIPELINE_STEP_BUSY;
+}
+
+static int transcode_convert_step(void* context) {
+    transcoder_t* transcoder = (transcoder_t*)context;
+    transcode_stats_t* stats = transcoder->stats;
+    if (spsc_ring_depth(&transcoder->read_queue) == 0) return PIPELINE_STEP_IDLE;
+    if (spsc_ring_depth(&transcoder->convert_queue) >= transcoder->convert_queue.capacity) return PIPELINE_STEP_BLOCKED;
+    frame_handle_t output = frame_pool_acquire(&transcoder->output_pool);
+    if (output == FRAME_HANDLE_INVALID) return PIPELINE_STEP_BLOCKED;
+
+    uint64_t start = platform_time_ns();
+    transcode_item_t item;
+    spsc_ring_pop(&transcoder->read_queue, &item);
+
+    if (item.frame == FRAME_HANDLE_INVALID) {
+        // A repeat has nothing to convert
+        frame_pool_release(&transcoder->output_pool, output);
+    } else {
+        const uint8_t* src = (const uint8_t*)frame_pool_data(&transcoder->input_pool, item.frame);
+        size_t src_pitch = transcoder->input_pitch;
+        int result = 0;
+        if (transcoder->scaling) {
+            result = scaler_process(&transcoder->scaler, transcoder->scaled, (size_t)stats->output_width * 4, src, src_pitch);
+            src = transcoder->scaled;
+            src_pitch = (size_t)stats->output_width * 4;
+        }
+        color_planes_t planes;
+        if (result == 0) {
+            result = color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(&transcoder->output_pool, output),
+                                             stats->output_width, stats->output_height, &planes);
+        }
+        if (result == 0) {
+            result = color_convert_frame(&transcoder->converter, COLOR_FORMAT_NV12, &planes, src, src_pitch,
+                                         stats->output_width, stats->output_height);
+        }
+        frame_pool_release(&transcoder->input_pool, item.frame);
+        if (result != 0) {
+            fprintf(stderr, "Transcode: Conversion failed\n");
+            frame_pool_release(&transcoder->output_pool, output);
+            return PIPELINE_STEP_ERROR;
+        }
+        item.frame = output;
+    }
+
+    spsc_ring_push(&transcoder->convert_queue, &item);
+    pipeline_notify(&transcoder->pipeline, transcoder->encode_stage);
+    // Room in the queue and the pool for a blocked read stage
+    pipeline_notify(&transcoder->pipeline, transcoder->read_stage);
+    stats->convert.frames++;
+    stats->convert.busy_ns += platform_time_ns() - start;
+    return PIPELINE_STEP_BUSY;
+}
+
+static int transcode_encode_step(void* context) {
+    transcoder_t* transcoder = (transcoder_t*)context;
+    transcode_stats_t* stats = transcoder->stats;
+    transcode_item_t item;
+    if (spsc_ring_pop(&transcoder->convert_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+
+    uint64_t start = platform_time_ns();
+    // The output starts at zero; capture times that stall are nudged forward
+    // so the muxer always sees them increase
+    if (!transcoder->has_time) {
+        transcoder->first_time = item.time;
+        transcoder->last_time = -1;
+        transcoder->has_time = 1;
+    }
+    int64_t time = item.time - transcoder->first_time;
+    if (time <= transcoder->last_time) time = transcoder->last_time + 1;
+    transcoder->last_time = time;
+
+    int result;
+    if (item.frame == FRAME_HANDLE_INVALID) {
+        result = encoder_backend_repeat_video(&transcoder->encoder, time);
+        stats->repeats++;
+    } else {
+        // A backend that keeps the frame takes its own reference
+        result = encoder_backend_push_video(&transcoder->encoder, &transcoder->output_pool, item.frame, time);
+        frame_pool_release(&transcoder->output_pool, item.frame);
+    }
+    if (result != 0) {
+        fprintf(stderr, "Transcode: Encoding failed at frame %llu\n", (unsigned long long)stats->encode.frames);
+        return PIPELINE_STEP_ERROR;
+    }
+
+    pipeline_notify(&transcoder->pipeline, transcoder->convert_stage);
+    stats->encode.frames++;
+    stats->encode.busy_ns += platform_time_ns() - start;
+    platform_atomic_inc(&transcoder->encoded);
+    return PIPELINE_STEP_BUSY;
+}
+
+// ---------------------------------------------------------------------------
+// Setup
+// ---------------------------------------------------------------------------
+
+static uint32_t transcode_get_u32(const uint8_t* data) {
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static int transcode_open_input(transcoder_t* transcoder) {
+    const transcode_config_t* config = transcoder->config;
+    transcode_stats_t* stats = transcoder->stats;
+    char magic[8] = { 0 };
+    FILE* file = fopen(config->input, "rb");
+    if (!file) {
+        fprintf(stderr, "Transcode: Cannot open %s\n", config->input);
+        return -1;
+    }
+    size_t got = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    if (got == sizeof(magic) && memcmp(magic, CAPTURE_SPOOL_MAGIC, 8) == 0) {
+        if (capture_spool_reader_open(&transcoder->spool, config->input) != 0) return -1;
+        stats->input = TRANSCODE_INPUT_SPOOL;
+        stats->input_width = transcoder->spool.width;
+        stats->input_height = transcoder->spool.height;
+        transcoder->fps = transcoder->spool.fps;
+        stats->input_bytes = transcoder->spool.map.size;
+    } else if (got == sizeof(magic) && memcmp(magic, REPLAY_FILE_MAGIC, 8) == 0) {
+        if (platform_map_open(&transcoder->raw, config->input) != 0 || transcoder->raw.size < REPLAY_FILE_HEADER_SIZE) {
+            fprintf(stderr, "Transcode: Cannot map %s\n", config->input);
+            return -1;
+        }
+        const uint8_t* header = transcoder->raw.data;
+        uint32_t version = transcode_get_u32(header + 8);
+        uint32_t width = transcode_get_u32(header + 12);
+        uint32_t height = transcode_get_u32(header + 16);
+        transcoder->fps = (int)transcode_get_u32(header + 20);
+        if (version != REPLAY_FILE_VERSION || width == 0 || height == 0 ||
+            width > REPLAY_MAX_DIMENSION || height > REPLAY_MAX_DIMENSION || transcoder->fps > 1000) {
+            fprintf(stderr, "Transcode: Bad raw frame file header in %s\n", config->input);
+            return -1;
+        }
+        stats->input = TRANSCODE_INPUT_RAW;
+        stats->input_width = (int)width;
+        stats->input_height = (int)height;
+        stats->input_bytes = transcoder->raw.size;
+        // A frame cut short at the end is left out
+        transcoder->raw_frames = (transcoder->raw.size - REPLAY_FILE_HEADER_SIZE) / ((size_t)width * height * 4);
+        if (config->fps > 0 && transcoder->fps <= 0) transcoder->fps = config->fps;
+    } else {
+        fprintf(stderr, "Transcode: %s is neither a capture spool nor a raw frame file\n", config->input);
+        return -1;
+    }
+    if (transcoder->fps <= 0) transcoder->fps = 30;
+    transcoder->input_pitch = (size_t)stats->input_width * 4;
+    return 0;
+}
+
+static int transcode_open_stages(transcoder_t* transcoder) {
+    const transcode_config_t* config = transcoder->config;
+    transcode_stats_t* stats = transcoder->stats;
+    int in_width = stats->input_width, in_height = stats->input_height;
+
+    // Without scaling an odd size loses its last column or row: 4:2:0 needs even
+    int out_width = in_width & ~1, out_height = in_height & ~1;
+    if ((config->scale > 0.0 || config->width > 0 || config->height > 0) &&
+        scaler_output_size(in_width, in_height, config->scale, config->width, config->height, &out_width, &out_height) != 0) {
+        fprintf(stderr, "Transcode: Invalid output size\n");
+        return -1;
+    }
+    stats->output_width = out_width;
+    stats->output_height = out_height;
+
+    if (worker_pool_init(&transcoder->workers, config->threads) != 0) return -1;
+    stats->threads = worker_pool_threads(&transcoder->workers);
+    if (color_converter_init(&transcoder->converter, config->matrix, config->range) != 0) return -1;
+    color_converter_set_pool(&transcoder->converter, &transcoder->workers);
+    if ((out_width & ~1) != (in_width & ~1) || (out_height & ~1) != (in_height & ~1)) {
+        if (scaler_init(&transcoder->scaler, in_width, in_height, out_width, out_height, SCALER_FILTER_AUTO,
+                        &transcoder->workers) != 0) {
+            return -1;
+        }
+        transcoder->scaling = 1;
+        transcoder->scaled = (uint8_t*)platform_aligned_alloc((size_t)out_width * out_height * 4, FRAME_POOL_ALIGNMENT);
+        if (!transcoder->scaled) return -1;
+    }
+
+    int depth = config->queue_depth > 0 ? config->queue_depth : TRANSCODE_DEFAULT_QUEUE;
+    if (depth > TRANSCODE_MAX_QUEUE) depth = TRANSCODE_MAX_QUEUE;
+    // Each pool also covers the frame its producer is filling and the one its consumer holds,
+    // and the output pool the one an encoder keeps for repeats (x264)
+    if (spsc_ring_init(&transcoder->read_queue, "read", (unsigned int)depth, sizeof(transcode_item_t)) != 0 ||
+        spsc_ring_init(&transcoder->convert_queue, "convert", (unsigned int)depth, sizeof(transcode_item_t)) != 0 ||
+        frame_pool_init(&transcoder->input_pool, transcoder->input_pitch * in_height,
+                        (int)transcoder->read_queue.capacity + 2) != 0 ||
+        frame_pool_init(&transcoder->output_pool, color_frame_size(COLOR_FORMAT_NV12, out_width, out_height),
+                        (int)transcoder->convert_queue.capacity + 3) != 0) {
+        fprintf(stderr, "Transcode: Out of memory for %d frames in flight\n", depth);
+        return -1;
+    }
+
+    if (encoder_backend_create(&transcoder->encoder, config->encoder) != 0) return -1;
+    if (!encoder_backend_takes(&transcoder->encoder, ENCODER_INPUT_NV12)) {
+        fprintf(stderr, "Transcode: The %s encoder does not take NV12 frames; use h264, x264 or null\n",
+                encoder_backend_name(&transcoder->encoder));
+        return -1;
+    }
+    encoder_backend_config_t encoder;
+    memset(&encoder, 0, sizeof(encoder));
+    encoder.path = config->output;
+    encoder.video = 1;
+    encoder.width = out_width;
+    encoder.height = out_height;
+    encoder.fps = transcoder->fps;
+    encoder.format = ENCODER_INPUT_NV12;
+    encoder.matrix = config->matrix;
+    encoder.range = config->range;
+    // Spool frames keep their capture times, so the output is variable rate like the recording
+    encoder.timing = stats->input == TRANSCODE_INPUT_SPOOL ? FRAME_TIMING_VFR : FRAME_TIMING_CFR;
+    encoder.fragmented = 1;
+    encoder.keyframe_interval = config->keyframe_interval;
+    if (encoder_backend_init(&transcoder->encoder, &encoder) != 0) return -1;
+
+    pipeline_stage_desc_t read = { "read", transcode_read_step, NULL, NULL, transcoder, 0, 0 };
+    pipeline_stage_desc_t convert = { "convert", transcode_convert_step, NULL, NULL, transcoder, 0, 0 };
+    pipeline_stage_desc_t encode = { "encode", transcode_encode_step, NULL, NULL, transcoder, 0, 0 };
+    if (pipeline_init(&transcoder->pipeline) != 0) return -1;
+    pipeline_add_queue(&transcoder->pipeline, &transcoder->read_queue);
+    pipeline_add_queue(&transcoder->pipeline, &transcoder->convert_queue);
+    transcoder->read_stage = pipeline_add_stage(&transcoder->pipeline, &read);
+    transcoder->convert_stage = pipeline_add_stage(&transcoder->pipeline, &convert);
+    transcoder->encode_stage = pipeline_add_stage(&transcoder->pipeline, &encode);
+    if (transcoder->read_stage < 0 || transcoder->convert_stage < 0 || transcoder->encode_stage < 0) return -1;
+    return 0;
+}
+
+static void transcode_cleanup(transcoder_t* transcoder) {
+    pipeline_cleanup(&transcoder->pipeline);
+    encoder_backend_destroy(&transcoder->encoder);
+    spsc_ring_cleanup(&transcoder->read_queue);
+    spsc_ring_cleanup(&transcoder->convert_queue);
+    frame_pool_cleanup(&transcoder->input_pool);
+    frame_pool_cleanup(&transcoder->output_pool);
+    scaler_cleanup(&transcoder->scaler);
+    platform_aligned_free(transcoder->scaled);
+    worker_pool_cleanup(&transcoder->workers);
+    capture_spool_reader_close(&transcoder->spool);
+    platform_map_close(&transcoder->raw, 0);
+    free(transcoder);
+}
+
+int transcode_file(const transcode_config_t* config, transcode_stats_t* stats) {
+    if (!config || !config->input || !config->output || !stats) return -1;
+    memset(stats, 0, sizeof(transcode_stats_t));
+    stats->encoder = config->encoder;
+    transcoder_t* transcoder = (transcoder_t*)calloc(1, sizeof(transcoder_t));
+    if (!transcoder) return -1;
+    transcoder->config = config;
+    transcoder->stats = stats;
+
+    uint64_t start = platform_time_ns();
+    if (transcode_open_input(transcoder) != 0 || transcode_open_stages(transcoder) != 0 ||
+        pipeline_start(&transcoder->pipeline) != 0) {
+        transcode_cleanup(transcoder);
+        return -1;
+    }
+
+    uint64_t total = stats->input == TRANSCODE_INPUT_RAW ? transcoder->raw_frames : 0;
+    uint64_t last_progress = start;
+    while (!pipeline_finished(&transcoder->pipeline)) {
+        platform_sleep_ms(20);
+        uint64_t now = platform_time_ns();
+        if (config->progress && now - last_progress >= 1000000000ull) {
+            char message[128];
+            long done = platform_atomic_load(&transcoder->encoded);
+            if (total > 0) {
+                snprintf(message, sizeof(message), "Transcode: %ld/%llu frames", done, (unsigned long long)total);
+            } else {
+                snprintf(message, sizeof(message), "Transcode: %ld frames", done);
+            }
+            config->progress(message);
+            last_progress = now;
+        }
+    }
+    // The read stage is done; the others drain what is queued
+    pipeline_stop(&transcoder->pipeline);
+
+    int result = 0;
+    if (pipeline_failed(&transcoder->pipeline)) {
+        result = -1;
+    } else if (encoder_backend_finalize(&transcoder->encoder) != 0) {
+        fprintf(stderr, "Transcode: Failed to finish %s\n", config->output);
+        result = -1;
+    }
+    if (result == 0 && stats->input == TRANSCODE_INPUT_SPOOL && !transcoder->spool.complete && config->progress) {
+        config->progress("Transcode: The spool was never closed; transcoded up to its last whole frame");
+    }
+    stats->frames = stats->encode.frames;
+    encoder_backend_stats_t encoded;
+    encoder_backend_get_stats(&transcoder->encoder, &encoded);
+    stats->output_bytes = encoded.bytes;
+    stats->elapsed_ns = platform_time_ns() - start;
+    transcode_cleanup(transcoder);
+    return result;
+}
+
+static double transcode_rate(uint64_t frames, uint64_t ns) {
+    return ns > 0 ? frames * 1e9 / (double)ns : 0.0;
+}
+
+void transcode_report(const transcode_stats_t* stats, transcode_report_fn report) {
+    if (!stats || !report) return;
+    char message[256];
+    snprintf(message, sizeof(message), "Transcode: %s %dx%d -> %s %dx%d, %d conversion threads",
+             stats->input == TRANSCODE_INPUT_SPOOL ? "spool" : "raw frames", stats->input_width, stats->input_height,
+             encoder_backend_kind_name(stats->encoder), stats->output_width, stats->output_height, stats->threads);
+    report(message);
+    snprintf(message, sizeof(message), "Transcode: %llu frames (%llu repeats) in %.2f s, %.1f fps overall",
+             (unsigned long long)stats->frames, (unsigned long long)stats->repeats, stats->elapsed_ns / 1e9,
+             transcode_rate(stats->frames, stats->elapsed_ns));
+    report(message);
+    // A stage's rate over its busy time is what it could sustain alone; the lowest one sets the pace
+    snprintf(message, sizeof(message), "Transcode: read %.1f fps, convert %.1f fps, encode %.1f fps while busy",
+             transcode_rate(stats->read.frames, stats->read.busy_ns),
+             transcode_rate(stats->convert.frames, stats->convert.busy_ns),
+             transcode_rate(stats->encode.frames, stats->encode.busy_ns));
+    report(message);
+    snprintf(message, sizeof(message), "Transcode: %.1f MB in, %.1f MB out",
+             stats->input_bytes / (1024.0 * 1024.0), stats->output_bytes / (1024.0 * 1024.0));
+    report(message);
+}
@@ -0,0 +1,149 @@
+#ifdef MUXSW_ENABLE_AUDIO
+
+#include "wasapi_source.h"
+#include <avrt.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    microphone_context_t* microphone;   // Exactly one of the two is set
+    system_context_t* system;
+    HANDLE mmcss_task;
+    BOOL com_initialized;
+} wasapi_source_t;
+
+static int wasapi_source_start(audio_source_t* source) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+
+    // Audio-only recordings start the endpoint early to find out whether it works
+    if (wasapi->microphone) {
+        return wasapi->microphone->is_capturing ? 0 : microphone_start_capture(wasapi->microphone);
+    }
+    return wasapi->system->is_capturing ? 0 : system_start_capture(wasapi->system);
+}
+
+static int wasapi_source_wait(audio_source_t* source, unsigned int timeout_ms) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    int result = wasapi->microphone ? microphone_wait(wasapi->microphone, timeout_ms)
+                                    : system_wait(wasapi->system, timeout_ms);
+    if (result < 0) return -1;
+    return result == 0 ? AUDIO_WAIT_READY : AUDIO_WAIT_TIMEOUT;
+}
+
+static int wasapi_source_get_buffer(audio_source_t* source, const uint8_t** data, uint32_t* frames) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    BYTE* buffer = NULL;
+    UINT32 count = 0;
+    int result = wasapi->microphone ? microphone_get_buffer(wasapi->microphone, &buffer, &count)
+                                    : system_get_buffer(wasapi->system, &buffer, &count);
+    if (result != 0) return -1;
+
+    *data = buffer;
+    *frames = buffer ? count : 0;
+    return 0;
+}
+
+static void wasapi_source_release_buffer(audio_source_t* source, uint32_t frames) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    if (wasapi->microphone) {
+        microphone_release_buffer(wasapi->microphone, frames);
+    } else {
+        system_release_buffer(wasapi->system, frames);
+    }
+}
+
+static void wasapi_source_stop(audio_source_t* source) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    if (wasapi->microphone) {
+        microphone_stop_capture(wasapi->microphone);
+    } else {
+        system_stop_capture(wasapi->system);
+    }
+}
+
+// The capture thread runs in the MTA with MMCSS scheduling, like any audio engine client
+static void wasapi_source_thread_init(audio_source_t* source) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    wasapi->com_initialized = SUCCEEDED(CoInitializeEx(NULL, COINIT_MULTITHREADED));
+
+    DWORD task_index = 0;
+    wasapi->mmcss_task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+}
+
+static void wasapi_source_thread_exit(audio_source_t* source) {
+    wasapi_source_t* wasapi = (wasapi_source_t*)source->impl;
+    if (wasapi->mmcss_task) {
+        AvRevertMmThreadCharacteristics(wasapi->mmcss_task);
+        wasapi->mmcss_task = NULL;
+    }
+    if (wasapi->com_initialized) {
+        CoUninitialize();
+        wasapi->com_initialized = FALSE;
+    }
+}
+
+static void wasapi_source_destroy(audio_source_t* source) {
+    free(source->impl);
+    source->impl = NULL;
+}
+
+static const audio_source_ops_t wasapi_microphone_ops = {
+    "microphone",
+    wasapi_source_start,
+    wasapi_source_wait,
+    wasapi_source_get_buffer,
+    wasapi_source_release_buffer,
+    wasapi_source_stop,
+    wasapi_source_thread_init,
+    wasapi_source_thread_exit,
+    wasapi_source_destroy
+};
+
+static const audio_source_ops_t wasapi_system_ops = {
+    "system",
+    wasapi_source_start,
+    wasapi_source_wait,
+    wasapi_source_get_buffer,
+    wasapi_source_release_buffer,
+    wasapi_source_stop,
+    wasapi_source_thread_init,
+    wasapi_source_thread_exit,
+    wasapi_source_destroy
+};
+
+static int wasapi_source_create(audio_source_t* source, const audio_source_ops_t* ops, wasapi_source_t* wasapi,
+                                const WAVEFORMATEX* format, UINT32 period_ms, UINT32 buffer_ms) {
+    source->ops = ops;
+    source->impl = wasapi;
+    source->sample_rate = (int)format->nSamplesPerSec;
+    source->channels = format->nChannels;
+    source->bits_per_sample = format->wBitsPerSample;
+    source->block_align = format->nBlockAlign;
+    source->period_ms = period_ms;
+    source->buffer_ms = buffer_ms;
+    return 0;
+}
+
+int wasapi_source_create_microphone(audio_source_t* source, microphone_context_t* ctx) {
+    if (!source) return -1;
+    memset(source, 0, sizeof(audio_source_t));
+    if (!ctx || !ctx->audio_client || !ctx->wave_format) return -1;
+
+    wasapi_source_t* wasapi = (wasapi_source_t*)calloc(1, sizeof(wasapi_source_t));
+    if (!wasapi) return -1;
+    wasapi->microphone = ctx;
+    return wasapi_source_create(source, &wasapi_microphone_ops, wasapi, ctx->wave_format, ctx->period_ms, ctx->buffer_ms);
+}
+
+int wasapi_source_create_system(audio_source_t* source, system_context_t* ctx) {
+    if (!source) return -1;
+    memset(source, 0, sizeof(audio_source_t));
+    if (!ctx || !ctx->audio_client || !ctx->wave_format) return -1;
+
+    wasapi_source_t* wasapi = (wasapi_source_t*)calloc(1, sizeof(wasapi_source_t));
+    if (!wasapi) return -1;
+    wasapi->system = ctx;
+    return wasapi_source_create(source, &wasapi_system_ops, wasapi, ctx->wave_format, ctx->period_ms, ctx->buffer_ms);
+}
+
+#endif // MUXSW_ENABLE_AUDIO
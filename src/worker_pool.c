@@ -0,0 +1,162 @@
+#include "worker_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slices handed to each worker per run; more slices balance better, fewer cost less to claim
+#define WORKER_POOL_SLICES_PER_THREAD 4
+
+// Claim and run tasks, own share first, then steal round the other shares
+static void worker_pool_drain(worker_pool_t* pool, int worker) {
+    for (int i = 0; i < pool->threads; i++) {
+        int victim = (worker + i) % pool->threads;
+        worker_pool_queue_t* queue = &pool->queues[victim];
+        for (;;) {
+            long task = platform_atomic_inc(&queue->next) - 1;
+            if (task >= queue->end) break;
+            if (victim != worker) platform_atomic_inc(&pool->steals);
+            if (pool->fn(pool->context, (int)task, worker) != 0) {
+                platform_atomic_store(&pool->failed, 1);
+            }
+        }
+    }
+}
+
+static void worker_pool_helper(void* arg) {
+    worker_pool_t* pool = (worker_pool_t*)arg;
+    int worker = (int)platform_atomic_inc(&pool->started);
+    unsigned long seen = 0;
+
+    platform_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            platform_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        platform_mutex_unlock(&pool->mutex);
+
+        worker_pool_drain(pool, worker);
+
+        platform_mutex_lock(&pool->mutex);
+        if (--pool->busy == 0) {
+            platform_cond_signal(&pool->idle);
+        }
+    }
+    platform_mutex_unlock(&pool->mutex);
+}
+
+int worker_pool_init(worker_pool_t* pool, int threads) {
+    if (!pool) return -1;
+
+    memset(pool, 0, sizeof(worker_pool_t));
+    if (threads <= 0) threads = platform_cpu_count();
+    if (threads > WORKER_POOL_MAX_THREADS) threads = WORKER_POOL_MAX_THREADS;
+    if (threads < 1) threads = 1;
+
+    pool->queues = (worker_pool_queue_t*)platform_aligned_alloc(sizeof(worker_pool_queue_t) * (size_t)threads, 64);
+    pool->handles = (platform_thread_t*)calloc((size_t)threads, sizeof(platform_thread_t));
+    if (!pool->queues || !pool->handles) {
+        fprintf(stderr, "Worker pool: Failed to allocate %d workers\n", threads);
+        if (pool->queues) platform_aligned_free(pool->queues);
+        free(pool->handles);
+        memset(pool, 0, sizeof(worker_pool_t));
+        return -1;
+    }
+    memset(pool->queues, 0, sizeof(worker_pool_queue_t) * (size_t)threads);
+
+    if (platform_mutex_init(&pool->mutex) != 0 || platform_mutex_init(&pool->run_mutex) != 0 ||
+        platform_cond_init(&pool->wake) != 0 || platform_cond_init(&pool->idle) != 0) {
+        fprintf(stderr, "Worker pool: Failed to create synchronization objects\n");
+        platform_aligned_free(pool->queues);
+        free(pool->handles);
+        memset(pool, 0, sizeof(worker_pool_t));
+        return -1;
+    }
+
+    // Helpers number themselves 1.. as they start. Workers that fail to start are
+    // simply not there; the pool shrinks to what did start.
+    pool->threads = 1;
+    for (int i = 1; i < threads; i++) {
+        if (platform_thread_create(&pool->handles[i], worker_pool_helper, pool) != 0) {
+            fprintf(stderr, "Worker pool: Started %d of %d workers\n", pool->threads, threads);
+            break;
+        }
+        pool->threads++;
+    }
+    return 0;
+}
+
+void worker_pool_cleanup(worker_pool_t* pool) {
+    if (!pool || !pool->queues) return;
+
+    platform_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    platform_cond_broadcast(&pool->wake);
+    platform_mutex_unlock(&pool->mutex);
+
+    for (int i = 1; i < pool->threads; i++) {
+        platform_thread_join(pool->handles[i]);
+    }
+
+    platform_cond_destroy(&pool->wake);
+    platform_cond_destroy(&pool->idle);
+    platform_mutex_destroy(&pool->mutex);
+    platform_mutex_destroy(&pool->run_mutex);
+    platform_aligned_free(pool->queues);
+    free(pool->handles);
+    memset(pool, 0, sizeof(worker_pool_t));
+}
+
+int worker_pool_run(worker_pool_t* pool, int task_count, worker_pool_task_fn fn, void* context) {
+    if (!pool || !pool->queues || !fn || task_count < 0) return -1;
+    if (task_count == 0) return 0;
+
+    platform_mutex_lock(&pool->run_mutex);
+
+    // Contiguous shares keep neighbouring slices on one worker until stealing starts
+    int threads = pool->threads;
+    for (int i = 0; i < threads; i++) {
+        platform_atomic_store(&pool->queues[i].next, (long)((long long)task_count * i / threads));
+        pool->queues[i].end = (long)((long long)task_count * (i + 1) / threads);
+    }
+    pool->fn = fn;
+    pool->context = context;
+    platform_atomic_store(&pool->failed, 0);
+    pool->runs++;
+
+    if (threads > 1) {
+        platform_mutex_lock(&pool->mutex);
+        pool->generation++;
+        pool->busy = threads - 1;
+        platform_cond_broadcast(&pool->wake);
+        platform_mutex_unlock(&pool->mutex);
+    }
+
+    worker_pool_drain(pool, 0);
+
+    // Join: every helper has left the run, so every task has returned
+    if (threads > 1) {
+        platform_mutex_lock(&pool->mutex);
+        while (pool->busy > 0) {
+            platform_cond_wait(&pool->idle, &pool->mutex);
+        }
+        platform_mutex_unlock(&pool->mutex);
+    }
+
+    int result = platform_atomic_load(&pool->failed) ? -1 : 0;
+    platform_mutex_unlock(&pool->run_mutex);
+    return result;
+}
+
+int worker_pool_threads(const worker_pool_t* pool) {
+    return (pool && pool->threads > 0) ? pool->threads : 1;
+}
+
+int worker_pool_slices(const worker_pool_t* pool, int units, int min_units) {
+    int threads = worker_pool_threads(pool);
+    if (threads == 1) return 1;
+    int slices = threads * WORKER_POOL_SLICES_PER_THREAD;
+    if (min_units > 0 && slices > units / min_units) slices = units / min_units;
+    return slices < 1 ? 1 : slices;
+}
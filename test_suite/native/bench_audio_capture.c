@@ -0,0 +1,70 @@
+#include "bench_common.h"
+#include "audio_capture.h"
+#include "simulated_audio.h"
+#include "platform.h"
+#include <stdlib.h>
+
+// How long a ready device buffer waits before the capture thread picks it
+// up: woken by the device event against the old 5 ms polling loop, at a few
+// device periods. Shorter waits let the device buffer (and so capture
+// latency) shrink without overruns.
+//
+//   bench_audio_capture [milliseconds per run]
+
+#define BENCH_POLL_MS 5
+
+static void run(const char* mode, unsigned int period_ms, int event_driven, unsigned int duration_ms) {
+    audio_source_t source;
+    simulated_audio_config_t config = { 48000, 2, period_ms, period_ms * 4, event_driven };
+    if (simulated_audio_create(&source, &config) != 0) return;
+
+    audio_capture_t capture;
+    if (audio_capture_init(&capture, mode, &source, 0) != 0) {
+        audio_source_destroy(&source);
+        return;
+    }
+    if (!event_driven) capture.wait_ms = BENCH_POLL_MS;
+
+    if (audio_capture_start(&capture) != 0) {
+        audio_capture_cleanup(&capture);
+        audio_source_destroy(&source);
+        return;
+    }
+
+    // Consume like the mux thread would
+    uint64_t end = bench_now_ns() + (uint64_t)duration_ms * 1000000ULL;
+    while (bench_now_ns() < end) {
+        audio_packet_t packet;
+        while (audio_capture_pop(&capture, &packet) == 0) audio_capture_release(&capture, &packet);
+        platform_sleep_ms(2);
+    }
+    audio_capture_stop(&capture);
+
+    simulated_audio_stats_t device;
+    audio_capture_stats_t stats;
+    simulated_audio_get_stats(&source, &device);
+    audio_capture_get_stats(&capture, &stats);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %u ms period", mode, period_ms);
+    double average = device.pickups ? (double)device.total_latency_ns / device.pickups / 1e6 : 0.0;
+    printf("%-32s avg %6.2f ms, max %6.2f ms to pickup, %5llu wakes, %5llu timeouts, %llu frames lost\n",
+           label, average, device.max_latency_ns / 1e6, (unsigned long long)stats.wakes,
+           (unsigned long long)stats.timeouts, (unsigned long long)device.lost_frames);
+
+    audio_capture_cleanup(&capture);
+    audio_source_destroy(&source);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int duration_ms = (argc > 1) ? (unsigned int)atoi(argv[1]) : 2000;
+    if (duration_ms == 0) duration_ms = 2000;
+
+    printf("Audio capture benchmark: 48 kHz stereo, device buffer 4 periods, %u ms per run\n", duration_ms);
+    const unsigned int periods[] = { 10, 3 };
+    for (size_t p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        run("polling", periods[p], 0, duration_ms);
+        run("event", periods[p], 1, duration_ms);
+    }
+    return 0;
+}
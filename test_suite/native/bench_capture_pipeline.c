@@ -0,0 +1,126 @@
+#include "bench_common.h"
+#include "capture_source.h"
+#include "synthetic_source.h"
+#include "replay_source.h"
+#include "tile_hash.h"
+#include "scaler.h"
+#include "color_convert.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Capture side of the recording loop without a desktop: a synthetic or
+// replayed source feeds change detection, 1080p -> 720p scaling and NV12
+// conversion, the work the engine does on every frame before the encoder.
+// Reports frames per second through the whole chain; frames the tile hash
+// finds unchanged skip scaling and conversion, as they do when recording.
+//
+//   bench_capture_pipeline [frames] [replay file]
+
+#define BENCH_SRC_WIDTH 1920
+#define BENCH_SRC_HEIGHT 1080
+#define BENCH_DST_WIDTH 1280
+#define BENCH_DST_HEIGHT 720
+
+typedef struct {
+    tile_hash_t hash;
+    scaler_t scaler;
+    color_converter_t converter;
+    uint8_t* scaled;
+    uint8_t* converted;
+    color_planes_t planes;
+} bench_pipeline_t;
+
+static int pipeline_init(bench_pipeline_t* pipeline, int width, int height) {
+    memset(pipeline, 0, sizeof(bench_pipeline_t));
+    if (tile_hash_init(&pipeline->hash, width, height, 0) != 0) return -1;
+    if (scaler_init(&pipeline->scaler, width, height, BENCH_DST_WIDTH, BENCH_DST_HEIGHT, SCALER_FILTER_AUTO, NULL) != 0) return -1;
+    if (color_converter_init(&pipeline->converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0) return -1;
+
+    pipeline->scaled = (uint8_t*)platform_aligned_alloc((size_t)BENCH_DST_WIDTH * BENCH_DST_HEIGHT * 4, 64);
+    pipeline->converted = (uint8_t*)platform_aligned_alloc(color_frame_size(COLOR_FORMAT_NV12, BENCH_DST_WIDTH, BENCH_DST_HEIGHT), 64);
+    if (!pipeline->scaled || !pipeline->converted) return -1;
+    return color_planes_for_buffer(COLOR_FORMAT_NV12, pipeline->converted, BENCH_DST_WIDTH, BENCH_DST_HEIGHT, &pipeline->planes);
+}
+
+static void pipeline_cleanup(bench_pipeline_t* pipeline) {
+    tile_hash_cleanup(&pipeline->hash);
+    scaler_cleanup(&pipeline->scaler);
+    platform_aligned_free(pipeline->scaled);
+    platform_aligned_free(pipeline->converted);
+}
+
+// Pull frames through the chain; returns the frames taken from the source
+static int run_source(const char* label, capture_source_t* source, int frames) {
+    frame_pool_t pool;
+    bench_pipeline_t pipeline;
+    if (frame_pool_init(&pool, (size_t)source->width * source->height * 4, 4) != 0) return -1;
+    if (capture_source_set_pool(source, &pool) != 0 || capture_source_start(source) != 0 ||
+        pipeline_init(&pipeline, source->width, source->height) != 0) {
+        frame_pool_cleanup(&pool);
+        return -1;
+    }
+
+    size_t pitch = (size_t)source->width * 4;
+    int taken = 0, encoded = 0;
+    uint64_t start = bench_now_ns();
+    while (taken < frames && !source->finished) {
+        frame_handle_t frame;
+        int result = capture_source_get_frame(source, &frame, 1);
+        if (result < 0) break;
+        if (result == CAPTURE_FRAME_NONE) continue;
+        taken++;
+        if (result == CAPTURE_FRAME_REPEAT) continue;
+
+        const uint8_t* pixels = (const uint8_t*)frame_pool_data(&pool, frame);
+        if (tile_hash_update(&pipeline.hash, pixels, pitch) > 0) {
+            scaler_process(&pipeline.scaler, pipeline.scaled, (size_t)BENCH_DST_WIDTH * 4, pixels, pitch);
+            color_convert_frame(&pipeline.converter, COLOR_FORMAT_NV12, &pipeline.planes, pipeline.scaled,
+                                (size_t)BENCH_DST_WIDTH * 4, BENCH_DST_WIDTH, BENCH_DST_HEIGHT);
+            encoded++;
+        }
+        frame_pool_release(&pool, frame);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char name[96];
+    snprintf(name, sizeof(name), "%s (%d/%d frames converted)", label, encoded, taken);
+    bench_report(name, elapsed, taken > 0 ? taken : 1, (double)pitch * source->height);
+    printf("    %.1f fps\n", elapsed > 0 ? taken * 1e9 / (double)elapsed : 0.0);
+
+    pipeline_cleanup(&pipeline);
+    frame_pool_cleanup(&pool);
+    return taken;
+}
+
+int main(int argc, char* argv[]) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 60;
+    if (frames <= 0) frames = 60;
+    const char* replay_path = (argc > 2) ? argv[2] : NULL;
+
+    printf("Capture pipeline benchmark (%d frames, %dx%d -> %dx%d NV12), best kernel %s\n",
+           frames, BENCH_SRC_WIDTH, BENCH_SRC_HEIGHT, BENCH_DST_WIDTH, BENCH_DST_HEIGHT,
+           copy_kernels_level_name(copy_kernels_best_level()));
+
+    for (int pattern = SYNTHETIC_PATTERN_BLOCKS; pattern <= SYNTHETIC_PATTERN_NOISE; pattern++) {
+        synthetic_source_config_t config = { (synthetic_pattern_t)pattern, BENCH_SRC_WIDTH, BENCH_SRC_HEIGHT, 30, 1 };
+        capture_source_t source;
+        if (synthetic_source_create(&source, &config) != 0) return 1;
+
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic %s", synthetic_pattern_name((synthetic_pattern_t)pattern));
+        int result = run_source(label, &source, frames);
+        capture_source_destroy(&source);
+        if (result < 0) return 1;
+    }
+
+    if (replay_path) {
+        capture_source_t source;
+        if (replay_source_create(&source, replay_path, 1) != 0) return 1;
+        int result = run_source("replay", &source, frames);
+        capture_source_destroy(&source);
+        if (result < 0) return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "bench_common.h"
+#include "color_convert.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// BGRA to NV12/I420 throughput per kernel level at the resolutions we record.
+// Throughput is BGRA source bytes consumed per second.
+
+typedef struct {
+    const char* name;
+    int width;
+    int height;
+} bench_resolution_t;
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 30;
+    if (iterations <= 0) iterations = 30;
+
+    const bench_resolution_t resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    printf("Colour conversion benchmark (%d frames per run), best kernel %s\n",
+           iterations, copy_kernels_level_name(copy_kernels_best_level()));
+
+    color_converter_t converter;
+    if (color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0) return 1;
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+        int width = resolutions[r].width;
+        int height = resolutions[r].height;
+        size_t src_size = (size_t)width * height * 4;
+        size_t dst_size = color_frame_size(COLOR_FORMAT_I420, width, height);
+
+        uint8_t* src = (uint8_t*)platform_aligned_alloc(src_size, 64);
+        uint8_t* dst = (uint8_t*)platform_aligned_alloc(dst_size, 64);
+        if (!src || !dst) return 1;
+        unsigned seed = 1u;
+        for (size_t i = 0; i < src_size; i++) {
+            seed = seed * 1103515245u + 12345u;
+            src[i] = (uint8_t)(seed >> 16);
+        }
+        memset(dst, 0, dst_size);
+
+        for (int format = COLOR_FORMAT_NV12; format <= COLOR_FORMAT_I420; format++) {
+            color_planes_t planes;
+            color_planes_for_buffer((color_format_t)format, dst, width, height, &planes);
+
+            for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+                if (color_converter_set_level(&converter, (copy_kernel_level_t)level) != 0) continue;
+
+                uint64_t start = bench_now_ns();
+                for (int i = 0; i < iterations; i++) {
+                    color_convert_frame(&converter, (color_format_t)format, &planes, src, (size_t)width * 4, width, height);
+                }
+                uint64_t elapsed = bench_now_ns() - start;
+
+                char label[64];
+                snprintf(label, sizeof(label), "%s %s %s", resolutions[r].name,
+                         color_format_name((color_format_t)format), copy_kernels_level_name((copy_kernel_level_t)level));
+                bench_report(label, elapsed, iterations, (double)src_size);
+            }
+        }
+
+        platform_aligned_free(src);
+        platform_aligned_free(dst);
+    }
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Monotonic nanosecond timer for the native benchmarks
+static inline uint64_t bench_now_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Print one result row: name, per-iteration time and throughput
+static inline void bench_report(const char* name, uint64_t elapsed_ns, int iterations, double bytes_per_iteration) {
+    double ns_per_iter = (double)elapsed_ns / (iterations > 0 ? iterations : 1);
+    double gb_per_sec = ns_per_iter > 0.0 ? bytes_per_iteration / ns_per_iter : 0.0;
+    printf("%-40s %12.1f us/iter %8.2f GB/s\n", name, ns_per_iter / 1000.0, gb_per_sec);
+}
+
+#endif // BENCH_COMMON_H
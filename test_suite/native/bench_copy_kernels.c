@@ -0,0 +1,90 @@
+#include "bench_common.h"
+#include "copy_kernels.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Compares the per-row memcpy loops historically used for readback (straight
+// and bottom-up flip) against the dispatched SIMD kernels, reading from a
+// padded staging-style pitch into a tightly packed frame.
+
+#define BENCH_PITCH_PADDING 256
+
+typedef struct {
+    const char* name;
+    int width;
+    int height;
+} bench_resolution_t;
+
+static void legacy_copy(uint8_t* dst, const uint8_t* src, size_t src_pitch, int width, int height, int flip) {
+    if (!flip) {
+        for (int y = 0; y < height; y++) {
+            memcpy(dst + (size_t)y * width * 4, src + (size_t)y * src_pitch, (size_t)width * 4);
+        }
+    } else {
+        for (int y = 0; y < height; y++) {
+            int src_row = height - 1 - y;
+            memcpy(dst + (size_t)y * width * 4, src + (size_t)src_row * src_pitch, (size_t)width * 4);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 30;
+    if (iterations <= 0) iterations = 30;
+
+    const bench_resolution_t resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    printf("Copy kernel benchmark (%d frames per run), best kernel %s, non-temporal above %zu bytes\n",
+           iterations, copy_kernels_level_name(copy_kernels_best_level()), copy_kernels_nt_threshold());
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+        int width = resolutions[r].width;
+        int height = resolutions[r].height;
+        size_t row_bytes = (size_t)width * 4;
+        size_t src_pitch = row_bytes + BENCH_PITCH_PADDING;
+        size_t frame_size = row_bytes * height;
+
+        uint8_t* src = (uint8_t*)platform_aligned_alloc(src_pitch * height, 64);
+        uint8_t* dst = (uint8_t*)platform_aligned_alloc(frame_size, 64);
+        if (!src || !dst) return 1;
+        memset(src, 0x5A, src_pitch * height);
+        memset(dst, 0, frame_size);
+
+        for (int flip = 0; flip <= 1; flip++) {
+            char label[64];
+
+            uint64_t start = bench_now_ns();
+            for (int i = 0; i < iterations; i++) {
+                legacy_copy(dst, src, src_pitch, width, height, flip);
+            }
+            uint64_t legacy_ns = bench_now_ns() - start;
+            snprintf(label, sizeof(label), "%s %s row memcpy", resolutions[r].name, flip ? "flip" : "copy");
+            bench_report(label, legacy_ns, iterations, (double)frame_size);
+
+            for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+                if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+
+                start = bench_now_ns();
+                for (int i = 0; i < iterations; i++) {
+                    copy_plane_with((copy_kernel_level_t)level, dst, row_bytes, src, src_pitch, row_bytes, height, flip);
+                }
+                uint64_t kernel_ns = bench_now_ns() - start;
+                snprintf(label, sizeof(label), "%s %s %s", resolutions[r].name, flip ? "flip" : "copy",
+                         copy_kernels_level_name((copy_kernel_level_t)level));
+                bench_report(label, kernel_ns, iterations, (double)frame_size);
+                printf("%-40s %12.2fx vs row memcpy\n", "", kernel_ns > 0 ? (double)legacy_ns / (double)kernel_ns : 0.0);
+            }
+        }
+
+        platform_aligned_free(src);
+        platform_aligned_free(dst);
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "bench_common.h"
+#include "test_common.h"
+#include "cursor_compositor.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Cursor cost per frame: blending the cursor rectangle into a 1080p frame
+// per kernel level and shape size, against the full-frame copy a
+// cursor-only update would otherwise cost. Throughput is cursor bytes blended.
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (iterations <= 0) iterations = 20000;
+
+    const int width = 1920, height = 1080;
+    size_t pitch = (size_t)width * 4;
+    uint8_t* frame = (uint8_t*)platform_aligned_alloc(pitch * height, 64);
+    uint8_t* copy = (uint8_t*)platform_aligned_alloc(pitch * height, 64);
+    uint8_t* shape = (uint8_t*)malloc((size_t)CURSOR_MAX_SIZE * CURSOR_MAX_SIZE * 4);
+    if (!frame || !copy || !shape) return 1;
+    fill_random(frame, pitch * height, 1);
+    fill_random(shape, (size_t)CURSOR_MAX_SIZE * CURSOR_MAX_SIZE * 4, 2);
+
+    printf("Cursor compositor benchmark (%d blends per run, %dx%d frame), best kernel %s\n",
+           iterations, width, height, copy_kernels_level_name(copy_kernels_best_level()));
+
+    const int sizes[] = { 32, 48, 64, 128 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int size = sizes[s];
+        cursor_compositor_t cursor;
+        if (cursor_compositor_init(&cursor) != 0) return 1;
+        if (cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shape, size, size, CURSOR_MAX_SIZE * 4, 0, 0) != 0) {
+            return 1;
+        }
+
+        for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+            if (cursor_compositor_set_level(&cursor, (copy_kernel_level_t)level) != 0) continue;
+            uint64_t start = bench_now_ns();
+            for (int i = 0; i < iterations; i++) {
+                // Wander over the frame like a moving pointer
+                cursor_compositor_set_position(&cursor, (i * 37) % (width - size), (i * 23) % (height - size), 1);
+                cursor_compositor_draw(&cursor, frame, pitch, width, height, 0, 0, 0, NULL);
+            }
+            uint64_t elapsed = bench_now_ns() - start;
+
+            char label[64];
+            snprintf(label, sizeof(label), "blend %dx%d %s", size, size, copy_kernels_level_name((copy_kernel_level_t)level));
+            bench_report(label, elapsed, iterations, (double)size * size * 4);
+        }
+        cursor_compositor_cleanup(&cursor);
+    }
+
+    // What a cursor-only update costs when the whole frame is copied again
+    int copies = iterations / 200 > 0 ? iterations / 200 : 1;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < copies; i++) {
+        copy_plane(copy, pitch, frame, pitch, pitch, height, 0);
+    }
+    bench_report("full-frame copy 1080p", bench_now_ns() - start, copies, (double)pitch * height);
+
+    platform_aligned_free(frame);
+    platform_aligned_free(copy);
+    free(shape);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "bench_common.h"
+#include "dirty_frame.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Compares the full-frame readback path (every pixel copied every frame)
+// against applying dirty and move rects to a persistent frame and catching up
+// a downstream buffer from the damage history, over typical desktop workloads.
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_STRIDE (BENCH_WIDTH * 4)
+#define BENCH_BUFFERS 4     // Downstream buffers in rotation, like the capture frame pool
+
+typedef struct {
+    const char* name;
+    frame_move_t moves[2];
+    int move_count;
+    frame_rect_t dirty[8];
+    int dirty_count;
+} bench_workload_t;
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 240;
+    if (iterations <= 0) iterations = 240;
+
+    const bench_workload_t workloads[] = {
+        { "caret blink", { { 0 } }, 0,
+          { { 600, 400, 602, 420 } }, 1 },
+        { "typing", { { 0 } }, 0,
+          { { 600, 400, 616, 420 }, { 616, 400, 618, 420 }, { 0, 1040, 1920, 1080 } }, 3 },
+        { "window drag", { { 300, 200, { 310, 205, 1110, 805 } } }, 1,
+          { { 300, 200, 1110, 205 }, { 300, 205, 310, 805 } }, 2 },
+        { "scroll", { { 200, 140, { 200, 100, 1720, 1000 } } }, 1,
+          { { 200, 1000, 1720, 1040 } }, 1 },
+        { "full-screen video", { { 0 } }, 0,
+          { { 0, 0, BENCH_WIDTH, BENCH_HEIGHT } }, 1 },
+    };
+
+    size_t frame_size = (size_t)BENCH_STRIDE * BENCH_HEIGHT;
+    uint8_t* source = (uint8_t*)malloc(frame_size);
+    uint8_t* buffers[BENCH_BUFFERS];
+    if (!source) return 1;
+    memset(source, 0x5A, frame_size);
+    for (int b = 0; b < BENCH_BUFFERS; b++) {
+        buffers[b] = (uint8_t*)malloc(frame_size);
+        if (!buffers[b]) return 1;
+    }
+
+    printf("Dirty rect benchmark, %dx%d (%d frames per run)\n", BENCH_WIDTH, BENCH_HEIGHT, iterations);
+
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        const bench_workload_t* workload = &workloads[w];
+        char label[64];
+        volatile uint8_t sink = 0;
+
+        // Baseline: copy the whole surface row by row into the next buffer
+        uint64_t start = bench_now_ns();
+        for (int i = 0; i < iterations; i++) {
+            uint8_t* dst = buffers[i % BENCH_BUFFERS];
+            for (int y = 0; y < BENCH_HEIGHT; y++) {
+                memcpy(dst + (size_t)y * BENCH_STRIDE, source + (size_t)y * BENCH_STRIDE, BENCH_STRIDE);
+            }
+            sink ^= dst[i % frame_size];
+        }
+        uint64_t full_ns = bench_now_ns() - start;
+        snprintf(label, sizeof(label), "%s full frame", workload->name);
+        bench_report(label, full_ns, iterations, (double)frame_size);
+
+        // Incremental: patch the persistent frame, then catch up the next buffer
+        dirty_frame_t frame;
+        uint64_t synced[BENCH_BUFFERS] = { 0 };
+        if (dirty_frame_init(&frame, BENCH_WIDTH, BENCH_HEIGHT) != 0) return 1;
+        if (dirty_frame_full_update(&frame, source, BENCH_STRIDE) != 0) return 1;
+        frame.total_bytes_copied = 0;
+
+        long long out_bytes = 0;
+        start = bench_now_ns();
+        for (int i = 0; i < iterations; i++) {
+            int b = i % BENCH_BUFFERS;
+            if (dirty_frame_apply(&frame, source, BENCH_STRIDE, workload->moves, workload->move_count,
+                                  workload->dirty, workload->dirty_count) != 0) return 1;
+            long long copied = dirty_frame_copy_out(&frame, buffers[b], BENCH_STRIDE, synced[b], 0);
+            if (copied < 0) return 1;
+            out_bytes += copied;
+            synced[b] = frame.generation;
+            sink ^= buffers[b][i % frame_size];
+        }
+        uint64_t dirty_ns = bench_now_ns() - start;
+
+        double bytes_per_frame = (double)(frame.total_bytes_copied + frame.total_bytes_moved + (uint64_t)out_bytes) / iterations;
+        snprintf(label, sizeof(label), "%s dirty rects", workload->name);
+        bench_report(label, dirty_ns, iterations, bytes_per_frame);
+        printf("%-40s %12.2fx speedup, %.1f%% of full-frame bytes\n", "",
+               dirty_ns > 0 ? (double)full_ns / (double)dirty_ns : 0.0,
+               100.0 * bytes_per_frame / (double)frame_size);
+
+        dirty_frame_cleanup(&frame);
+        (void)sink;
+    }
+
+    for (int b = 0; b < BENCH_BUFFERS; b++) free(buffers[b]);
+    free(source);
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include "bench_common.h"
+#include "capture_source.h"
+#include "synthetic_source.h"
+#include "color_convert.h"
+#include "worker_pool.h"
+#include "frame_pool.h"
+#include "spsc_ring.h"
+#include "pipeline.h"
+#include "encoder_backend.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The whole recording path on any platform: a synthetic source on the
+// capture thread, NV12 conversion (slices across the worker pool) on the
+// video thread when the backend wants it, and the mux thread pushing into
+// each encoder backend in turn. Unpaced, so the achieved frame rate is what
+// the path sustains; the backend's share of the mux thread shows where the
+// time goes. Every fourth frame is a repeat, as a static desktop would be.
+//
+//   bench_encoder_backend [frames] [width] [height] [pattern]
+
+#define BENCH_FPS 60
+#define BENCH_QUEUE_DEPTH 4
+#define BENCH_POOL_FRAMES 12
+#define BENCH_OUTPUT "bench_encoder_backend.out"
+
+typedef struct {
+    uint64_t handle;
+    frame_pool_t* pool;             // NULL for a repeat
+    int64_t time;
+} bench_frame_t;
+
+typedef struct {
+    capture_source_t* source;
+    encoder_backend_t* backend;
+    frame_pool_t capture_pool;
+    frame_pool_t nv12_pool;
+    color_converter_t converter;
+    int convert;
+    int width;
+    int height;
+    int frames;
+    spsc_ring_t capture_queue;
+    spsc_ring_t video_queue;
+    pipeline_t pipeline;
+    int video_stage;
+    int mux_stage;
+    int captured;                   // Capture thread
+    platform_atomic_t muxed;        // Mux thread
+} bench_run_t;
+
+static int capture_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    if (run->captured >= run->frames) return PIPELINE_STEP_DONE;
+    if (spsc_ring_depth(&run->capture_queue) >= run->capture_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    bench_frame_t item = { 0, NULL, (int64_t)run->captured * ENCODER_BACKEND_UNITS_PER_SECOND / BENCH_FPS };
+    if (run->captured % 4 != 3) {
+        frame_handle_t frame;
+        int result = capture_source_get_frame(run->source, &frame, 1);
+        if (result < 0) return PIPELINE_STEP_ERROR;
+        // Pool empty: the later stages still hold every frame
+        if (result != CAPTURE_FRAME_NEW) return PIPELINE_STEP_BLOCKED;
+        item.handle = (uint64_t)frame;
+        item.pool = &run->capture_pool;
+    }
+    spsc_ring_push(&run->capture_queue, &item);
+    run->captured++;
+    pipeline_notify(&run->pipeline, run->video_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int video_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    if (spsc_ring_depth(&run->video_queue) >= run->video_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    bench_frame_t item;
+    if (spsc_ring_pop(&run->capture_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    pipeline_notify(&run->pipeline, 0);
+
+    if (item.pool && run->convert) {
+        frame_handle_t nv12 = frame_pool_acquire(&run->nv12_pool);
+        if (nv12 == FRAME_HANDLE_INVALID) {
+            frame_pool_release(item.pool, (frame_handle_t)item.handle);
+            return PIPELINE_STEP_ERROR;
+        }
+        color_planes_t planes;
+        color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(&run->nv12_pool, nv12), run->width, run->height, &planes);
+        color_convert_frame(&run->converter, COLOR_FORMAT_NV12, &planes,
+                            (const uint8_t*)frame_pool_data(item.pool, (frame_handle_t)item.handle),
+                            (size_t)run->width * 4, run->width, run->height);
+        frame_pool_release(item.pool, (frame_handle_t)item.handle);
+        item.handle = (uint64_t)nv12;
+        item.pool = &run->nv12_pool;
+    }
+    spsc_ring_push(&run->video_queue, &item);
+    pipeline_notify(&run->pipeline, run->mux_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int mux_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    bench_frame_t item;
+    if (spsc_ring_pop(&run->video_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    pipeline_notify(&run->pipeline, run->video_stage);
+    int result;
+    if (item.pool) {
+        result = encoder_backend_push_video(run->backend, item.pool, (frame_handle_t)item.handle, item.time);
+        frame_pool_release(item.pool, (frame_handle_t)item.handle);
+    } else {
+        result = encoder_backend_repeat_video(run->backend, item.time);
+    }
+    if (result != 0) return PIPELINE_STEP_ERROR;
+    platform_atomic_inc(&run->muxed);
+    return PIPELINE_STEP_BUSY;
+}
+
+static void print_line(const char* message) {
+    printf("    %s\n", message);
+}
+
+static int run_backend(encoder_backend_kind_t kind, synthetic_pattern_t pattern, int frames, int width, int height,
+                       worker_pool_t* workers) {
+    encoder_backend_t backend;
+    if (encoder_backend_create(&backend, kind) != 0) {
+        printf("%s: not built\n", encoder_backend_kind_name(kind));
+        return 0;
+    }
+    synthetic_source_config_t source_config = { pattern, width, height, BENCH_FPS, 1 };
+    capture_source_t source;
+    if (synthetic_source_create(&source, &source_config) != 0) {
+        encoder_backend_destroy(&backend);
+        return -1;
+    }
+
+    bench_run_t* run = (bench_run_t*)calloc(1, sizeof(bench_run_t));
+    if (!run) {
+        capture_source_destroy(&source);
+        encoder_backend_destroy(&backend);
+        return -1;
+    }
+    run->source = &source;
+    run->backend = &backend;
+    run->width = width;
+    run->height = height;
+    run->frames = frames;
+    run->convert = encoder_backend_takes(&backend, ENCODER_INPUT_NV12) && !encoder_backend_takes(&backend, ENCODER_INPUT_BGRA);
+
+    encoder_backend_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.path = BENCH_OUTPUT;
+    config.video = 1;
+    config.width = width;
+    config.height = height;
+    config.fps = BENCH_FPS;
+    config.format = run->convert ? ENCODER_INPUT_NV12 : ENCODER_INPUT_BGRA;
+    config.matrix = COLOR_MATRIX_BT709;
+    config.range = COLOR_RANGE_LIMITED;
+    config.timing = FRAME_TIMING_CFR;
+    config.fragmented = 1;
+
+    int result = -1;
+    if (frame_pool_init(&run->capture_pool, (size_t)width * height * 4, BENCH_POOL_FRAMES) != 0 ||
+        (run->convert && frame_pool_init(&run->nv12_pool, color_frame_size(COLOR_FORMAT_NV12, width, height), BENCH_POOL_FRAMES) != 0) ||
+        color_converter_init(&run->converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0 ||
+        spsc_ring_init(&run->capture_queue, "capture->video", BENCH_QUEUE_DEPTH, sizeof(bench_frame_t)) != 0 ||
+        spsc_ring_init(&run->video_queue, "video->mux", BENCH_QUEUE_DEPTH, sizeof(bench_frame_t)) != 0 ||
+        capture_source_set_pool(&source, &run->capture_pool) != 0 || capture_source_start(&source) != 0 ||
+        encoder_backend_init(&backend, &config) != 0) {
+        goto done;
+    }
+    color_converter_set_pool(&run->converter, workers);
+
+    pipeline_init(&run->pipeline);
+    pipeline_stage_desc_t capture = { "capture", capture_step, NULL, NULL, run, 0, 1 };
+    pipeline_stage_desc_t video = { "video", video_step, NULL, NULL, run, 0, 0 };
+    pipeline_stage_desc_t mux = { "mux", mux_step, NULL, NULL, run, 0, 0 };
+    pipeline_add_stage(&run->pipeline, &capture);
+    run->video_stage = pipeline_add_stage(&run->pipeline, &video);
+    run->mux_stage = pipeline_add_stage(&run->pipeline, &mux);
+    pipeline_add_queue(&run->pipeline, &run->capture_queue);
+    pipeline_add_queue(&run->pipeline, &run->video_queue);
+
+    printf("%s (%s input):\n", encoder_backend_name(&backend), run->convert ? "NV12" : "BGRA");
+    uint64_t start = bench_now_ns();
+    if (pipeline_start(&run->pipeline) != 0) goto done;
+    while (!pipeline_finished(&run->pipeline)) platform_sleep_ms(5);
+    pipeline_stop(&run->pipeline);
+    int finalized = encoder_backend_finalize(&backend);
+    uint64_t elapsed = bench_now_ns() - start;
+    if (pipeline_failed(&run->pipeline) || finalized != 0) {
+        printf("    failed\n");
+        goto done;
+    }
+
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(&backend, &stats);
+    uint64_t muxed = (uint64_t)platform_atomic_load(&run->muxed);
+    printf("    %llu frames in %.2f s: %.1f fps, encoder busy %.0f%% of the time, %.2f MB written\n",
+           (unsigned long long)muxed, elapsed / 1e9, muxed * 1e9 / (double)elapsed,
+           100.0 * stats.busy_ns / (double)elapsed, stats.bytes / 1e6);
+    encoder_backend_report(&backend, print_line);
+    pipeline_report(&run->pipeline, print_line);
+    result = 0;
+
+done:
+    pipeline_cleanup(&run->pipeline);
+    encoder_backend_destroy(&backend);
+    capture_source_stop(&source);
+    capture_source_destroy(&source);
+    spsc_ring_cleanup(&run->capture_queue);
+    spsc_ring_cleanup(&run->video_queue);
+    frame_pool_cleanup(&run->nv12_pool);
+    frame_pool_cleanup(&run->capture_pool);
+    free(run);
+    remove(BENCH_OUTPUT);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 240;
+    int width = (argc > 2) ? atoi(argv[2]) : 1280;
+    int height = (argc > 3) ? atoi(argv[3]) : 720;
+    if (frames <= 0) frames = 240;
+    // The H.264 backends take 4:2:0, which needs an even size
+    if (width < 16 || height < 16 || (width & 1) || (height & 1)) {
+        fprintf(stderr, "Frame size must be even and at least 16x16\n");
+        return 1;
+    }
+    synthetic_pattern_t pattern = SYNTHETIC_PATTERN_BLOCKS;
+    if (argc > 4 && synthetic_pattern_parse(argv[4], &pattern) != 0) {
+        fprintf(stderr, "Unknown pattern: %s\n", argv[4]);
+        return 1;
+    }
+
+    worker_pool_t workers;
+    if (worker_pool_init(&workers, 0) != 0) return 1;
+    printf("Encoder backend benchmark: %d frames %dx%d %s, %d worker threads\n",
+           frames, width, height, synthetic_pattern_name(pattern), worker_pool_threads(&workers));
+
+    const encoder_backend_kind_t kinds[] = {
+        ENCODER_BACKEND_NULL, ENCODER_BACKEND_RAW, ENCODER_BACKEND_SPOOL, ENCODER_BACKEND_H264, ENCODER_BACKEND_X264
+    };
+    int result = 0;
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]) && result == 0; i++) {
+        result = run_backend(kinds[i], pattern, frames, width, height, &workers);
+    }
+    worker_pool_cleanup(&workers);
+    return result == 0 ? 0 : 1;
+}
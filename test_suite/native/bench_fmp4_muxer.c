@@ -0,0 +1,92 @@
+#include "bench_common.h"
+#include "mp4_fixtures.h"
+#include "fmp4_muxer.h"
+#include <stdlib.h>
+
+// Whether muxing cost and memory stay flat as recordings get longer. Canned
+// 1080p60 H.264 at about 8 Mbit/s (a keyframe every 2 s) and 48 kHz AAC are
+// muxed into 1-second fragments for 1, 10 and 60 minutes of media. Output
+// goes to a counting sink, or to a file when a path is given. Reports mux
+// throughput, the most sample data held at once, and how long finishing
+// takes: with fragments written as they close, neither should grow with
+// duration.
+//
+//   bench_fmp4_muxer [output.mp4]
+
+#define BENCH_FPS 60
+#define BENCH_GOP 120
+#define BENCH_SLICE_BASE 16000
+#define BENCH_SAMPLE_RATE 48000
+
+typedef struct {
+    uint64_t bytes;
+    uint64_t writes;
+} bench_sink_t;
+
+static int bench_sink_write(void* context, const uint8_t* data, size_t size) {
+    bench_sink_t* sink = (bench_sink_t*)context;
+    (void)data;
+    sink->bytes += size;
+    sink->writes++;
+    return 0;
+}
+
+static int run_duration(int minutes, const char* path) {
+    static uint8_t unit[131072];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 42, 1920, 1080);
+
+    fmp4_muxer_t muxer;
+    bench_sink_t sink = { 0, 0 };
+    fmp4_config_t config = { 1, 1, 0, 0, 1000, 0, 0, 0 };
+    int result = path ? fmp4_muxer_open(&muxer, &config, path)
+                      : fmp4_muxer_init(&muxer, &config, bench_sink_write, &sink);
+    if (result != 0) return -1;
+
+    uint64_t frames = (uint64_t)minutes * 60 * BENCH_FPS;
+    uint64_t audio = 0;
+    uint64_t media_bytes = 0;
+    uint64_t start = bench_now_ns();
+    for (uint64_t frame = 0; frame < frames && result == 0; frame++) {
+        int keyframe = frame % BENCH_GOP == 0;
+        size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframe,
+                                          fixture_slice_size(frame, keyframe, BENCH_SLICE_BASE), sps, sps_size);
+        media_bytes += size;
+        result = fmp4_muxer_write_video(&muxer, unit, size, (int64_t)(frame * 10000000 / BENCH_FPS));
+        while (result == 0 && audio * AAC_SAMPLES_PER_FRAME * BENCH_FPS <= (frame + 1) * BENCH_SAMPLE_RATE) {
+            size = fixture_adts_frame(unit, audio++, BENCH_SAMPLE_RATE, 2);
+            media_bytes += size;
+            result = fmp4_muxer_write_audio(&muxer, unit, size);
+        }
+    }
+    uint64_t muxed = bench_now_ns();
+    if (result == 0) result = fmp4_muxer_finish(&muxer);
+    uint64_t finished = bench_now_ns();
+
+    if (result == 0) {
+        double seconds = (muxed - start) / 1e9;
+        printf("%3d min: %7.1f MB in %6.2f s (%7.1f MB/s, %6.0fx realtime), %llu fragments, "
+               "peak %zu KB buffered, finish %.3f ms\n",
+               minutes, muxer.stats.bytes_written / (1024.0 * 1024.0), seconds,
+               media_bytes / (1024.0 * 1024.0) / seconds, minutes * 60.0 / seconds,
+               (unsigned long long)muxer.stats.fragments, muxer.stats.peak_buffered / 1024,
+               (finished - muxed) / 1e6);
+    }
+    fmp4_muxer_cleanup(&muxer);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = argc > 1 ? argv[1] : NULL;
+    printf("fMP4 muxer benchmark: 1080p%d H.264 (~8 Mbit/s, GOP %d) + AAC, 1 s fragments, to %s\n",
+           BENCH_FPS, BENCH_GOP, path ? path : "a counting sink");
+
+    const int minutes[] = { 1, 10, 60 };
+    for (size_t i = 0; i < sizeof(minutes) / sizeof(minutes[0]); i++) {
+        if (run_duration(minutes[i], path) != 0) {
+            fprintf(stderr, "Muxing failed\n");
+            return 1;
+        }
+    }
+    return 0;
+}
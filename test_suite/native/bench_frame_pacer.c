@@ -0,0 +1,62 @@
+#include "bench_common.h"
+#include "frame_pacer.h"
+#include "platform.h"
+#include <stdlib.h>
+
+// Capture pacing on the real clock at 60 fps. The legacy loop adds a
+// truncated millisecond interval to the next frame time and polls with
+// millisecond sleeps; the pacer sleeps on the high-resolution timer until
+// each exact frame time. Drift is how far the last frame landed from where
+// 60 fps says it belongs.
+//
+//   bench_frame_pacer [frames]
+
+#define BENCH_FPS 60
+
+static void report(const char* name, uint64_t frames, uint64_t total_jitter, uint64_t max_jitter, int64_t drift) {
+    printf("%-8s %6llu frames, jitter avg %6.3f ms, max %6.3f ms, drift %+8.3f ms\n", name,
+           (unsigned long long)frames, total_jitter / 1e6 / (double)frames, max_jitter / 1e6, drift / 1e6);
+}
+
+static void run_legacy(uint64_t frames) {
+    uint64_t interval_ms = 1000 / BENCH_FPS;
+    uint64_t start = platform_time_ns() / 1000000ULL;
+    uint64_t next = start;
+    uint64_t total_jitter = 0, max_jitter = 0, last = 0;
+    for (uint64_t n = 0; n < frames; n++) {
+        uint64_t now;
+        while ((now = platform_time_ns()) / 1000000ULL < next) platform_sleep_ms(1);
+        uint64_t jitter = now - next * 1000000ULL;
+        total_jitter += jitter;
+        if (jitter > max_jitter) max_jitter = jitter;
+        last = now;
+        next += interval_ms;
+    }
+    uint64_t ideal = (frames - 1) * FRAME_PACER_NS_PER_SECOND / BENCH_FPS;
+    report("legacy", frames, total_jitter, max_jitter, (int64_t)(last - start * 1000000ULL) - (int64_t)ideal);
+}
+
+static void run_pacer(uint64_t frames) {
+    frame_pacer_t pacer;
+    if (frame_pacer_init(&pacer, BENCH_FPS, 1, NULL) != 0) return;
+    frame_pacer_start(&pacer);
+    frame_pacer_tick_t tick;
+    uint64_t last = 0;
+    for (uint64_t n = 0; n < frames; n++) {
+        frame_pacer_wait(&pacer, &tick);
+        last = frame_pacer_elapsed_ns(&pacer);
+    }
+    uint64_t ideal = (frames - 1) * FRAME_PACER_NS_PER_SECOND / BENCH_FPS;
+    report("pacer", pacer.stats.frames, pacer.stats.total_jitter_ns, pacer.stats.max_jitter_ns, (int64_t)last - (int64_t)ideal);
+    frame_pacer_cleanup(&pacer);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t frames = (argc > 1) ? (uint64_t)atoi(argv[1]) : 300;
+    if (frames == 0) frames = 300;
+
+    printf("Frame pacing benchmark: %d fps, %llu frames per run\n", BENCH_FPS, (unsigned long long)frames);
+    run_legacy(frames);
+    run_pacer(frames);
+    return 0;
+}
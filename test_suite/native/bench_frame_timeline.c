@@ -0,0 +1,68 @@
+#include "bench_common.h"
+#include "frame_timeline.h"
+#include <stdlib.h>
+
+// Samples handed to the encoder for a long, mostly idle recording, and the
+// cost of the per-tick timing decision. The capture API reports a new frame
+// on every tick (an application repainting identical pixels), while real
+// content changes on a small fraction of ticks.
+//
+//   reported - every reported frame is a new sample (no change detection)
+//   cfr      - unchanged frames become repeats on the fixed fps grid
+//   vfr      - unchanged frames are skipped, samples carry capture times
+
+typedef struct {
+    const char* name;
+    int change_permille;    // Ticks with real content changes, per thousand
+} bench_scenario_t;
+
+static uint64_t run_timeline(frame_timing_t mode, int fps, int ticks, int change_permille, int detect, uint64_t* ns) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    frame_timeline_init(&timeline, mode, fps);
+
+    unsigned seed = 7u;
+    uint64_t start = bench_now_ns();
+    for (int tick = 0; tick < ticks; tick++) {
+        seed = seed * 1103515245u + 12345u;
+        int changed = tick == 0 || (int)((seed >> 16) % 1000) < change_permille;
+        int64_t time = (int64_t)tick * FRAME_TIMELINE_UNITS_PER_SECOND / fps + (seed >> 8) % 20000;
+        if (changed || !detect) {
+            frame_timeline_new_frame(&timeline, time, &step);
+        } else {
+            frame_timeline_repeat_frame(&timeline, time, &step);
+        }
+    }
+    frame_timeline_finish(&timeline);
+    *ns = bench_now_ns() - start;
+    return timeline.samples;
+}
+
+int main(int argc, char* argv[]) {
+    int minutes = (argc > 1) ? atoi(argv[1]) : 60;
+    if (minutes <= 0) minutes = 60;
+    const int fps = 30;
+    int ticks = minutes * 60 * fps;
+
+    const bench_scenario_t scenarios[] = {
+        { "idle", 0 },
+        { "reading", 5 },
+        { "typing", 50 },
+        { "video", 1000 },
+    };
+
+    printf("Frame timeline benchmark: %d min at %d fps (%d ticks)\n", minutes, fps, ticks);
+    printf("%-10s %12s %12s %12s %10s %12s\n", "scenario", "reported", "cfr", "vfr", "reduction", "ns/tick");
+
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+        uint64_t ns_reported, ns_cfr, ns_vfr;
+        uint64_t reported = run_timeline(FRAME_TIMING_CFR, fps, ticks, scenarios[s].change_permille, 0, &ns_reported);
+        uint64_t cfr = run_timeline(FRAME_TIMING_CFR, fps, ticks, scenarios[s].change_permille, 1, &ns_cfr);
+        uint64_t vfr = run_timeline(FRAME_TIMING_VFR, fps, ticks, scenarios[s].change_permille, 1, &ns_vfr);
+        printf("%-10s %12llu %12llu %12llu %9.1fx %12.1f\n", scenarios[s].name,
+               (unsigned long long)reported, (unsigned long long)cfr, (unsigned long long)vfr,
+               vfr ? (double)reported / vfr : 0.0, (double)ns_vfr / ticks);
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "bench_common.h"
+#include "capture_source.h"
+#include "synthetic_source.h"
+#include "color_convert.h"
+#include "worker_pool.h"
+#include "frame_pool.h"
+#include "spsc_ring.h"
+#include "pipeline.h"
+#include "frame_pacer.h"
+#include "fps_meter.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Whether the staged recorder sustains high-refresh frame rates. A synthetic
+// 1080p source is paced at 144, 165 and 240 fps on the capture thread,
+// converted to NV12 on the video thread (slices across the worker pool) and
+// consumed on a third thread standing in for the mux. Queues and pools are
+// sized in time the way the engine sizes them. Prints achieved against
+// requested fps for every second, and the frames lost to a full queue.
+//
+//   bench_high_frame_rate [seconds per rate] [pattern]
+
+#define BENCH_WIDTH 1920
+#define BENCH_HEIGHT 1080
+#define BENCH_QUEUE_MS 16
+#define BENCH_ENCODER_QUEUE_MS 33
+
+typedef struct {
+    uint64_t handle;
+    frame_pool_t* pool;
+} bench_frame_t;
+
+typedef struct {
+    capture_source_t* source;
+    frame_pool_t capture_pool;
+    frame_pool_t nv12_pool;
+    color_converter_t converter;
+    spsc_ring_t capture_queue;
+    spsc_ring_t video_queue;
+    frame_pacer_t pacer;
+    pipeline_t pipeline;
+    int video_stage;
+    int sink_stage;
+    uint64_t dropped;               // Capture thread: queue full or pool empty
+    platform_atomic_t consumed;     // Sink thread
+} bench_run_t;
+
+static int frames_within(int fps, unsigned int milliseconds) {
+    int frames = (int)frame_pacer_frames_within((uint32_t)fps, 1, milliseconds);
+    return frames < 2 ? 2 : frames;
+}
+
+static int capture_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    frame_pacer_tick_t tick;
+    if (frame_pacer_wait(&run->pacer, &tick) != 0) return PIPELINE_STEP_ERROR;
+
+    frame_handle_t frame;
+    int result = capture_source_get_frame(run->source, &frame, 1);
+    if (result < 0) return PIPELINE_STEP_ERROR;
+    if (result != CAPTURE_FRAME_NEW) {
+        run->dropped++;
+        return PIPELINE_STEP_BUSY;
+    }
+    bench_frame_t item = { (uint64_t)frame, &run->capture_pool };
+    if (spsc_ring_push(&run->capture_queue, &item) != 0) {
+        frame_pool_release(&run->capture_pool, frame);
+        run->dropped++;
+        return PIPELINE_STEP_BUSY;
+    }
+    pipeline_notify(&run->pipeline, run->video_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int video_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    if (spsc_ring_depth(&run->video_queue) >= run->video_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    bench_frame_t item;
+    if (spsc_ring_pop(&run->capture_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+
+    frame_handle_t nv12 = frame_pool_acquire(&run->nv12_pool);
+    if (nv12 != FRAME_HANDLE_INVALID) {
+        color_planes_t planes;
+        color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(&run->nv12_pool, nv12), BENCH_WIDTH, BENCH_HEIGHT, &planes);
+        color_convert_frame(&run->converter, COLOR_FORMAT_NV12, &planes,
+                            (const uint8_t*)frame_pool_data(&run->capture_pool, (frame_handle_t)item.handle),
+                            (size_t)BENCH_WIDTH * 4, BENCH_WIDTH, BENCH_HEIGHT);
+    }
+    frame_pool_release(&run->capture_pool, (frame_handle_t)item.handle);
+    if (nv12 == FRAME_HANDLE_INVALID) return PIPELINE_STEP_BUSY;
+
+    bench_frame_t converted = { (uint64_t)nv12, &run->nv12_pool };
+    spsc_ring_push(&run->video_queue, &converted);
+    pipeline_notify(&run->pipeline, run->sink_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int sink_step(void* context) {
+    bench_run_t* run = (bench_run_t*)context;
+    bench_frame_t item;
+    if (spsc_ring_pop(&run->video_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    pipeline_notify(&run->pipeline, run->video_stage);
+    frame_pool_release(item.pool, (frame_handle_t)item.handle);
+    platform_atomic_inc(&run->consumed);
+    return PIPELINE_STEP_BUSY;
+}
+
+static void print_line(const char* message) {
+    printf("    %s\n", message);
+}
+
+static int run_rate(synthetic_pattern_t pattern, int fps, int seconds, worker_pool_t* workers) {
+    synthetic_source_config_t config = { pattern, BENCH_WIDTH, BENCH_HEIGHT, fps, 1 };
+    capture_source_t source;
+    if (synthetic_source_create(&source, &config) != 0) return -1;
+
+    bench_run_t* run = (bench_run_t*)calloc(1, sizeof(bench_run_t));
+    if (!run) {
+        capture_source_destroy(&source);
+        return -1;
+    }
+    run->source = &source;
+
+    int depth = frames_within(fps, BENCH_QUEUE_MS);
+    int capacity = 4 + 2 * depth + frames_within(fps, BENCH_ENCODER_QUEUE_MS);
+    int result = -1;
+    if (frame_pool_init(&run->capture_pool, (size_t)BENCH_WIDTH * BENCH_HEIGHT * 4, capacity) != 0 ||
+        frame_pool_init(&run->nv12_pool, color_frame_size(COLOR_FORMAT_NV12, BENCH_WIDTH, BENCH_HEIGHT), capacity) != 0 ||
+        color_converter_init(&run->converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0 ||
+        spsc_ring_init(&run->capture_queue, "capture->video", (unsigned int)depth, sizeof(bench_frame_t)) != 0 ||
+        spsc_ring_init(&run->video_queue, "video->sink", (unsigned int)depth, sizeof(bench_frame_t)) != 0 ||
+        frame_pacer_init(&run->pacer, (uint32_t)fps, 1, NULL) != 0 ||
+        capture_source_set_pool(&source, &run->capture_pool) != 0 || capture_source_start(&source) != 0) {
+        goto done;
+    }
+    color_converter_set_pool(&run->converter, workers);
+
+    pipeline_init(&run->pipeline);
+    pipeline_stage_desc_t capture = { "capture", capture_step, NULL, NULL, run, 1, 1 };
+    pipeline_stage_desc_t video = { "video", video_step, NULL, NULL, run, 0, 0 };
+    pipeline_stage_desc_t sink = { "sink", sink_step, NULL, NULL, run, 0, 0 };
+    pipeline_add_stage(&run->pipeline, &capture);
+    run->video_stage = pipeline_add_stage(&run->pipeline, &video);
+    run->sink_stage = pipeline_add_stage(&run->pipeline, &sink);
+    pipeline_add_queue(&run->pipeline, &run->capture_queue);
+    pipeline_add_queue(&run->pipeline, &run->video_queue);
+
+    printf("%d fps (%d frames per queue, %d per pool):\n", fps, depth, capacity);
+    fps_meter_t meter;
+    fps_meter_init(&meter, fps);
+    frame_pacer_start(&run->pacer);
+    fps_meter_start(&meter, 0);
+    if (pipeline_start(&run->pipeline) != 0) goto done;
+
+    // Supervise like the engine: poll every 10 ms
+    uint64_t elapsed = 0;
+    while (meter.windows < (uint64_t)seconds) {
+        platform_sleep_ms(10);
+        elapsed = frame_pacer_elapsed_ns(&run->pacer);
+        if (fps_meter_update(&meter, elapsed, (uint64_t)platform_atomic_load(&run->consumed))) {
+            printf("    second %llu: %.1f / %d fps\n", (unsigned long long)meter.windows, meter.last_fps, fps);
+        }
+    }
+    pipeline_stop(&run->pipeline);
+
+    fps_meter_report(&meter, elapsed, print_line);
+    frame_pacer_report(&run->pacer, print_line);
+    printf("    %llu frames dropped at capture\n", (unsigned long long)run->dropped);
+    result = 0;
+
+done:
+    pipeline_cleanup(&run->pipeline);
+    capture_source_stop(&source);
+    capture_source_destroy(&source);
+    frame_pacer_cleanup(&run->pacer);
+    spsc_ring_cleanup(&run->capture_queue);
+    spsc_ring_cleanup(&run->video_queue);
+    frame_pool_cleanup(&run->nv12_pool);
+    frame_pool_cleanup(&run->capture_pool);
+    free(run);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int seconds = (argc > 1) ? atoi(argv[1]) : 3;
+    if (seconds <= 0) seconds = 3;
+    synthetic_pattern_t pattern = SYNTHETIC_PATTERN_BLOCKS;
+    if (argc > 2 && synthetic_pattern_parse(argv[2], &pattern) != 0) {
+        fprintf(stderr, "Unknown pattern: %s\n", argv[2]);
+        return 1;
+    }
+
+    worker_pool_t workers;
+    if (worker_pool_init(&workers, 0) != 0) return 1;
+    printf("High frame rate benchmark: %dx%d %s -> NV12, %d worker threads, %d s per rate\n",
+           BENCH_WIDTH, BENCH_HEIGHT, synthetic_pattern_name(pattern), worker_pool_threads(&workers), seconds);
+
+    const int rates[] = { 144, 165, 240 };
+    int result = 0;
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]) && result == 0; i++) {
+        result = run_rate(pattern, rates[i], seconds, &workers);
+    }
+    worker_pool_cleanup(&workers);
+    return result == 0 ? 0 : 1;
+}
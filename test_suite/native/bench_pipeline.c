@@ -0,0 +1,224 @@
+#include "bench_common.h"
+#include "spsc_ring.h"
+#include "pipeline.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// 1. Raw handoff cost: elements per second through an spsc_ring between two
+//    threads, against the same handoff through a mutex-protected queue.
+// 2. Why the recorder is staged: a capture loop ticking every few ms feeding
+//    a writer that now and then takes tens of ms (a slow WriteSample). Run
+//    serially the slow write delays the next grab; across a pipeline the
+//    capture ticks stay on time while the queue absorbs the spike.
+//
+//   bench_pipeline [handoff elements]
+
+#define BENCH_TICK_MS 4
+#define BENCH_TICKS 250
+#define BENCH_SPIKE_EVERY 50
+#define BENCH_SPIKE_MS 40
+
+typedef struct {
+    uint64_t handle;
+    int64_t time;
+} bench_item_t;
+
+// --- Handoff throughput ------------------------------------------------------
+
+typedef struct {
+    spsc_ring_t* ring;
+    platform_mutex_t* mutex;        // Set for the locked variant
+    bench_item_t* locked_slots;
+    unsigned long* locked_head;
+    unsigned long* locked_tail;
+    unsigned long capacity;
+    unsigned long count;
+} handoff_context_t;
+
+static int locked_push(handoff_context_t* context, const bench_item_t* item) {
+    platform_mutex_lock(context->mutex);
+    int ok = *context->locked_head - *context->locked_tail < context->capacity;
+    if (ok) {
+        context->locked_slots[*context->locked_head % context->capacity] = *item;
+        (*context->locked_head)++;
+    }
+    platform_mutex_unlock(context->mutex);
+    return ok ? 0 : -1;
+}
+
+static int locked_pop(handoff_context_t* context, bench_item_t* item) {
+    platform_mutex_lock(context->mutex);
+    int ok = *context->locked_tail != *context->locked_head;
+    if (ok) {
+        *item = context->locked_slots[*context->locked_tail % context->capacity];
+        (*context->locked_tail)++;
+    }
+    platform_mutex_unlock(context->mutex);
+    return ok ? 0 : -1;
+}
+
+static void handoff_producer(void* arg) {
+    handoff_context_t* context = (handoff_context_t*)arg;
+    for (unsigned long i = 0; i < context->count; i++) {
+        bench_item_t item = { i, (int64_t)i };
+        while ((context->mutex ? locked_push(context, &item) : spsc_ring_push(context->ring, &item)) != 0) {
+            platform_yield();
+        }
+    }
+}
+
+static uint64_t run_handoff(handoff_context_t* context) {
+    platform_thread_t producer;
+    uint64_t start = bench_now_ns();
+    if (platform_thread_create(&producer, handoff_producer, context) != 0) return 0;
+
+    unsigned long received = 0;
+    uint64_t checksum = 0;
+    while (received < context->count) {
+        bench_item_t item;
+        if ((context->mutex ? locked_pop(context, &item) : spsc_ring_pop(context->ring, &item)) != 0) {
+            platform_yield();
+            continue;
+        }
+        checksum += item.handle;
+        received++;
+    }
+    platform_thread_join(producer);
+    uint64_t elapsed = bench_now_ns() - start;
+    if (checksum != (uint64_t)context->count * (context->count - 1) / 2) printf("    checksum mismatch\n");
+    return elapsed;
+}
+
+// --- Capture jitter ----------------------------------------------------------
+
+typedef struct {
+    pipeline_t pipeline;
+    spsc_ring_t queue;
+    int writer_stage;
+    uint64_t start_ns;
+    int tick;
+    int64_t worst_late_ns;
+    int dropped;
+    int written;
+} jitter_context_t;
+
+static void simulated_write(int index) {
+    if (index > 0 && index % BENCH_SPIKE_EVERY == 0) {
+        platform_sleep_ms(BENCH_SPIKE_MS);
+    }
+}
+
+// Record how late this tick is against its schedule
+static void note_tick(jitter_context_t* context, uint64_t now) {
+    int64_t due = (int64_t)context->tick * BENCH_TICK_MS * 1000000LL;
+    int64_t late = (int64_t)(now - context->start_ns) - due;
+    if (late > context->worst_late_ns) context->worst_late_ns = late;
+}
+
+static int capture_step(void* arg) {
+    jitter_context_t* context = (jitter_context_t*)arg;
+    if (context->tick >= BENCH_TICKS) return PIPELINE_STEP_DONE;
+
+    uint64_t now = bench_now_ns();
+    if ((int64_t)(now - context->start_ns) < (int64_t)context->tick * BENCH_TICK_MS * 1000000LL) return PIPELINE_STEP_IDLE;
+    note_tick(context, now);
+
+    bench_item_t item = { (uint64_t)context->tick, (int64_t)now };
+    if (spsc_ring_push(&context->queue, &item) != 0) context->dropped++;
+    pipeline_notify(&context->pipeline, context->writer_stage);
+    context->tick++;
+    return PIPELINE_STEP_BUSY;
+}
+
+static int writer_step(void* arg) {
+    jitter_context_t* context = (jitter_context_t*)arg;
+    bench_item_t item;
+    if (spsc_ring_pop(&context->queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    simulated_write((int)item.handle);
+    context->written++;
+    return PIPELINE_STEP_BUSY;
+}
+
+static void report_jitter(const char* label, const jitter_context_t* context) {
+    printf("%-40s worst tick %6.1f ms late, %d written, %d dropped\n",
+           label, context->worst_late_ns / 1e6, context->written, context->dropped);
+}
+
+int main(int argc, char* argv[]) {
+    long count = (argc > 1) ? atol(argv[1]) : 2000000;
+    if (count <= 0) count = 2000000;
+
+    printf("Pipeline benchmark (%d CPUs)\n", platform_cpu_count());
+
+    // Handoff throughput
+    const unsigned int capacities[] = { 8, 64, 1024 };
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        spsc_ring_t ring;
+        if (spsc_ring_init(&ring, "bench", capacities[c], sizeof(bench_item_t)) != 0) return 1;
+        handoff_context_t context;
+        memset(&context, 0, sizeof(context));
+        context.ring = &ring;
+        context.count = (unsigned long)count;
+        uint64_t elapsed = run_handoff(&context);
+
+        char label[64];
+        snprintf(label, sizeof(label), "spsc ring, depth %u", capacities[c]);
+        printf("%-40s %12.1f ns/element %8.1f M/s\n", label, (double)elapsed / count, count * 1e3 / (double)elapsed);
+        spsc_ring_cleanup(&ring);
+
+        platform_mutex_t mutex;
+        bench_item_t* slots = (bench_item_t*)malloc(capacities[c] * sizeof(bench_item_t));
+        unsigned long head = 0, tail = 0;
+        if (!slots || platform_mutex_init(&mutex) != 0) return 1;
+        memset(&context, 0, sizeof(context));
+        context.mutex = &mutex;
+        context.locked_slots = slots;
+        context.locked_head = &head;
+        context.locked_tail = &tail;
+        context.capacity = capacities[c];
+        context.count = (unsigned long)count;
+        elapsed = run_handoff(&context);
+
+        snprintf(label, sizeof(label), "mutex queue, depth %u", capacities[c]);
+        printf("%-40s %12.1f ns/element %8.1f M/s\n", label, (double)elapsed / count, count * 1e3 / (double)elapsed);
+        platform_mutex_destroy(&mutex);
+        free(slots);
+    }
+
+    // Capture jitter: one loop doing both
+    jitter_context_t serial;
+    memset(&serial, 0, sizeof(serial));
+    serial.start_ns = bench_now_ns();
+    while (serial.tick < BENCH_TICKS) {
+        uint64_t now = bench_now_ns();
+        if ((int64_t)(now - serial.start_ns) < (int64_t)serial.tick * BENCH_TICK_MS * 1000000LL) {
+            platform_sleep_ms(1);
+            continue;
+        }
+        note_tick(&serial, now);
+        simulated_write(serial.tick);
+        serial.written++;
+        serial.tick++;
+    }
+    report_jitter("serial capture + write", &serial);
+
+    // Capture jitter: capture and writer stages with a queue between them
+    jitter_context_t staged;
+    memset(&staged, 0, sizeof(staged));
+    if (pipeline_init(&staged.pipeline) != 0) return 1;
+    if (spsc_ring_init(&staged.queue, "capture->write", 16, sizeof(bench_item_t)) != 0) return 1;
+    pipeline_stage_desc_t capture = { "capture", capture_step, NULL, NULL, &staged, 1, 1 };
+    pipeline_stage_desc_t writer = { "write", writer_step, NULL, NULL, &staged, 0, 0 };
+    pipeline_add_stage(&staged.pipeline, &capture);
+    staged.writer_stage = pipeline_add_stage(&staged.pipeline, &writer);
+    staged.start_ns = bench_now_ns();
+    if (pipeline_start(&staged.pipeline) != 0) return 1;
+    while (!pipeline_finished(&staged.pipeline)) platform_sleep_ms(5);
+    pipeline_stop(&staged.pipeline);
+    report_jitter("pipelined capture -> write", &staged);
+    pipeline_cleanup(&staged.pipeline);
+    spsc_ring_cleanup(&staged.queue);
+
+    return 0;
+}
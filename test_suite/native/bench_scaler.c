@@ -0,0 +1,103 @@
+#include "bench_common.h"
+#include "scaler.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Downscale throughput for the sizes we record and deliver: scalar versus the
+// dispatched SIMD kernels on one thread, then the best kernel across threads.
+// Throughput is source bytes consumed per second.
+
+typedef struct {
+    const char* name;
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    scaler_filter_t filter;
+} bench_case_t;
+
+static void fill_frame(uint8_t* data, size_t size) {
+    unsigned seed = 12345u;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+static void run_case(const bench_case_t* bench, copy_kernel_level_t level, int threads, int iterations,
+                     uint8_t* dst, const uint8_t* src) {
+    worker_pool_t pool;
+    if (worker_pool_init(&pool, threads) != 0) return;
+    scaler_t scaler;
+    if (scaler_init(&scaler, bench->src_width, bench->src_height, bench->dst_width, bench->dst_height,
+                    bench->filter, &pool) != 0) {
+        worker_pool_cleanup(&pool);
+        return;
+    }
+    if (scaler_set_level(&scaler, level) != 0) {
+        scaler_cleanup(&scaler);
+        worker_pool_cleanup(&pool);
+        return;
+    }
+
+    size_t src_pitch = (size_t)bench->src_width * 4;
+    size_t dst_pitch = (size_t)bench->dst_width * 4;
+    scaler_process(&scaler, dst, dst_pitch, src, src_pitch);   // Warm up caches and page in the destination
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        scaler_process(&scaler, dst, dst_pitch, src, src_pitch);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char label[96];
+    snprintf(label, sizeof(label), "%s %s %s x%d", bench->name, scaler_filter_name(scaler.filter),
+             copy_kernels_level_name(level), scaler.workers);
+    bench_report(label, elapsed, iterations, (double)src_pitch * bench->src_height);
+    scaler_cleanup(&scaler);
+    worker_pool_cleanup(&pool);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if (iterations <= 0) iterations = 20;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : platform_cpu_count();
+    if (max_threads <= 0) max_threads = 1;
+
+    const bench_case_t cases[] = {
+        { "4K->1080p", 3840, 2160, 1920, 1080, SCALER_FILTER_BOX2 },
+        { "4K->1080p", 3840, 2160, 1920, 1080, SCALER_FILTER_AREA },
+        { "4K->720p", 3840, 2160, 1280, 720, SCALER_FILTER_AREA },
+        { "1440p->1080p", 2560, 1440, 1920, 1080, SCALER_FILTER_AREA },
+        { "1440p->1080p", 2560, 1440, 1920, 1080, SCALER_FILTER_BILINEAR },
+        { "8K->4K", 7680, 4320, 3840, 2160, SCALER_FILTER_BOX2 },
+    };
+
+    printf("Scaler benchmark (%d frames per run), best kernel %s, up to %d threads\n",
+           iterations, copy_kernels_level_name(copy_kernels_best_level()), max_threads);
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const bench_case_t* bench = &cases[c];
+        size_t src_size = (size_t)bench->src_width * bench->src_height * 4;
+        size_t dst_size = (size_t)bench->dst_width * bench->dst_height * 4;
+        uint8_t* src = (uint8_t*)platform_aligned_alloc(src_size, 64);
+        uint8_t* dst = (uint8_t*)platform_aligned_alloc(dst_size, 64);
+        if (!src || !dst) return 1;
+        fill_frame(src, src_size);
+
+        for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+            if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+            run_case(bench, (copy_kernel_level_t)level, 1, iterations, dst, src);
+        }
+        for (int threads = 2; threads <= max_threads; threads *= 2) {
+            run_case(bench, copy_kernels_best_level(), threads, iterations, dst, src);
+        }
+
+        platform_aligned_free(src);
+        platform_aligned_free(dst);
+        printf("\n");
+    }
+
+    return 0;
+}
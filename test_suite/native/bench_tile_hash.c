@@ -0,0 +1,81 @@
+#include "bench_common.h"
+#include "tile_hash.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Change detection cost per captured frame: hash every tile of an unchanged
+// frame (the common idle case) per kernel level, then the best kernel on the
+// worker pool. Throughput is frame bytes hashed per second.
+
+typedef struct {
+    const char* name;
+    int width;
+    int height;
+} bench_resolution_t;
+
+static void run_case(const char* name, tile_hash_t* hash, int iterations, const uint8_t* frame, size_t pitch,
+                     const char* variant) {
+    tile_hash_update(hash, frame, pitch);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        tile_hash_update(hash, frame, pitch);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s %s", name, variant);
+    bench_report(label, elapsed, iterations, (double)pitch * hash->height);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 50;
+    if (iterations <= 0) iterations = 50;
+    int threads = (argc > 2) ? atoi(argv[2]) : 0;
+
+    const bench_resolution_t resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    worker_pool_t pool;
+    if (worker_pool_init(&pool, threads) != 0) return 1;
+    printf("Tile hash benchmark (%d frames per run, %dpx tiles), best kernel %s, %d pool workers\n",
+           iterations, TILE_HASH_DEFAULT_TILE, copy_kernels_level_name(copy_kernels_best_level()),
+           worker_pool_threads(&pool));
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+        int width = resolutions[r].width;
+        int height = resolutions[r].height;
+        size_t pitch = (size_t)width * 4;
+        uint8_t* frame = (uint8_t*)platform_aligned_alloc(pitch * height, 64);
+        if (!frame) return 1;
+        unsigned seed = 99u;
+        for (size_t i = 0; i < pitch * height; i++) {
+            seed = seed * 1103515245u + 12345u;
+            frame[i] = (uint8_t)(seed >> 16);
+        }
+
+        tile_hash_t hash;
+        if (tile_hash_init(&hash, width, height, 0) != 0) return 1;
+        for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+            if (tile_hash_set_level(&hash, (copy_kernel_level_t)level) != 0) continue;
+            run_case(resolutions[r].name, &hash, iterations, frame, pitch, copy_kernels_level_name((copy_kernel_level_t)level));
+        }
+
+        char variant[32];
+        snprintf(variant, sizeof(variant), "%s x%d", copy_kernels_level_name(copy_kernels_best_level()),
+                 worker_pool_threads(&pool));
+        tile_hash_set_level(&hash, copy_kernels_best_level());
+        tile_hash_set_pool(&hash, &pool);
+        run_case(resolutions[r].name, &hash, iterations, frame, pitch, variant);
+
+        tile_hash_cleanup(&hash);
+        platform_aligned_free(frame);
+    }
+
+    worker_pool_cleanup(&pool);
+    return 0;
+}
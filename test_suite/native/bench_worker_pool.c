@@ -0,0 +1,118 @@
+#include "bench_common.h"
+#include "color_convert.h"
+#include "scaler.h"
+#include "worker_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Multi-core scaling of the per-frame pixel stages: NV12 conversion at the
+// capture size and a 2:3 area downscale, each run on a worker pool of 1..N
+// threads. Speedup is relative to the single-worker run of the same stage.
+// Throughput is source bytes consumed per second.
+
+typedef struct {
+    const char* name;
+    int width;
+    int height;
+} bench_resolution_t;
+
+static void fill_frame(uint8_t* data, size_t size) {
+    unsigned seed = 4242u;
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+// 1, 2, 3, 4, then doubling, always ending on max_threads
+static int next_thread_count(int threads, int max_threads) {
+    int next = threads < 4 ? threads + 1 : threads * 2;
+    return (next > max_threads && threads < max_threads) ? max_threads : next;
+}
+
+static uint64_t run_convert(worker_pool_t* pool, int iterations, uint8_t* dst, const uint8_t* src, int width, int height) {
+    color_converter_t converter;
+    color_planes_t planes;
+    if (color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0) return 0;
+    if (color_planes_for_buffer(COLOR_FORMAT_NV12, dst, width, height, &planes) != 0) return 0;
+    color_converter_set_pool(&converter, pool);
+
+    color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, src, (size_t)width * 4, width, height);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, src, (size_t)width * 4, width, height);
+    }
+    return bench_now_ns() - start;
+}
+
+static uint64_t run_scale(worker_pool_t* pool, int iterations, uint8_t* dst, const uint8_t* src, int width, int height) {
+    int dst_width = (width * 2 / 3) & ~1;
+    int dst_height = (height * 2 / 3) & ~1;
+    scaler_t scaler;
+    if (scaler_init(&scaler, width, height, dst_width, dst_height, SCALER_FILTER_AREA, pool) != 0) return 0;
+
+    scaler_process(&scaler, dst, (size_t)dst_width * 4, src, (size_t)width * 4);
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        scaler_process(&scaler, dst, (size_t)dst_width * 4, src, (size_t)width * 4);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    scaler_cleanup(&scaler);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if (iterations <= 0) iterations = 20;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : platform_cpu_count();
+    if (max_threads <= 0) max_threads = 1;
+    if (max_threads > WORKER_POOL_MAX_THREADS) max_threads = WORKER_POOL_MAX_THREADS;
+
+    const bench_resolution_t resolutions[] = {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    printf("Worker pool benchmark (%d frames per run), best kernel %s, 1..%d workers\n",
+           iterations, copy_kernels_level_name(copy_kernels_best_level()), max_threads);
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++) {
+        int width = resolutions[r].width;
+        int height = resolutions[r].height;
+        size_t src_size = (size_t)width * height * 4;
+        uint8_t* src = (uint8_t*)platform_aligned_alloc(src_size, 64);
+        uint8_t* dst = (uint8_t*)platform_aligned_alloc(src_size, 64);
+        if (!src || !dst) return 1;
+        fill_frame(src, src_size);
+        memset(dst, 0, src_size);
+
+        uint64_t convert_base = 0;
+        uint64_t scale_base = 0;
+        for (int threads = 1; threads <= max_threads; threads = next_thread_count(threads, max_threads)) {
+            worker_pool_t pool;
+            if (worker_pool_init(&pool, threads) != 0) return 1;
+
+            char label[96];
+            uint64_t elapsed = run_convert(&pool, iterations, dst, src, width, height);
+            if (threads == 1) convert_base = elapsed;
+            snprintf(label, sizeof(label), "%s NV12 x%d (%.2fx)", resolutions[r].name, worker_pool_threads(&pool),
+                     elapsed ? (double)convert_base / elapsed : 0.0);
+            bench_report(label, elapsed, iterations, (double)src_size);
+
+            elapsed = run_scale(&pool, iterations, dst, src, width, height);
+            if (threads == 1) scale_base = elapsed;
+            snprintf(label, sizeof(label), "%s area 2:3 x%d (%.2fx)", resolutions[r].name, worker_pool_threads(&pool),
+                     elapsed ? (double)scale_base / elapsed : 0.0);
+            bench_report(label, elapsed, iterations, (double)src_size);
+
+            worker_pool_cleanup(&pool);
+        }
+
+        platform_aligned_free(src);
+        platform_aligned_free(dst);
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,324 @@
+#ifndef H264_FIXTURES_H
+#define H264_FIXTURES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "elementary_stream.h"
+
+// Decoder for the subset of H.264 that h264_writer produces: one slice per
+// picture, I_PCM and P_Skip macroblocks, CAVLC. Every syntax element is read
+// in the order the standard gives it and checked against the values the
+// stream may use, so a field written out of place fails here the way it
+// would in a real decoder instead of decoding by luck.
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t bit;
+    int overrun;
+} fixture_reader_t;
+
+static inline uint32_t fixture_read_bits(fixture_reader_t* reader, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++) {
+        if (reader->bit >= reader->size * 8) {
+            reader->overrun = 1;
+            return 0;
+        }
+        value = value << 1 | ((reader->data[reader->bit / 8] >> (7 - reader->bit % 8)) & 1);
+        reader->bit++;
+    }
+    return value;
+}
+
+static inline uint32_t fixture_read_ue(fixture_reader_t* reader) {
+    int zeros = 0;
+    while (fixture_read_bits(reader, 1) == 0 && !reader->overrun) {
+        if (++zeros > 31) {
+            reader->overrun = 1;
+            return 0;
+        }
+    }
+    return ((uint32_t)1 << zeros) - 1 + fixture_read_bits(reader, zeros);
+}
+
+static inline int32_t fixture_read_se(fixture_reader_t* reader) {
+    uint32_t code = fixture_read_ue(reader);
+    return code & 1 ? (int32_t)((code + 1) / 2) : -(int32_t)(code / 2);
+}
+
+// rbsp_trailing_bits: a one, zeros to the byte boundary, and nothing after
+static inline int fixture_read_trailing(fixture_reader_t* reader) {
+    if (fixture_read_bits(reader, 1) != 1) return -1;
+    while (reader->bit % 8) {
+        if (fixture_read_bits(reader, 1) != 0) return -1;
+    }
+    return reader->overrun || reader->bit != reader->size * 8 ? -1 : 0;
+}
+
+typedef struct {
+    int have_sps;
+    int have_pps;
+    int width;                      // Cropped
+    int height;
+    int mb_width;
+    int mb_height;
+    int log2_max_frame_num;
+    int level_idc;
+    int full_range;
+    int matrix_coefficients;
+
+    uint8_t* luma;                  // Decoded picture, padded to whole macroblocks
+    uint8_t* chroma[2];
+    int has_picture;
+    int expected_frame_num;
+    int idr_pic_id;
+    int last_was_idr;               // Consecutive IDR pictures need different idr_pic_id
+
+    uint64_t pictures;
+    uint64_t idr_pictures;
+    uint64_t coded_macroblocks;     // In the latest picture
+    uint8_t* rbsp;                  // Scratch for the unescaped NAL unit
+    size_t rbsp_capacity;
+    const char* error;
+} fixture_decoder_t;
+
+static inline int fixture_decoder_fail(fixture_decoder_t* decoder, const char* error) {
+    decoder->error = error;
+    return -1;
+}
+
+static inline void fixture_decoder_free(fixture_decoder_t* decoder) {
+    free(decoder->luma);
+    free(decoder->chroma[0]);
+    free(decoder->chroma[1]);
+    free(decoder->rbsp);
+    memset(decoder, 0, sizeof(fixture_decoder_t));
+}
+
+static inline int fixture_decode_vui(fixture_decoder_t* decoder, fixture_reader_t* reader) {
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "aspect ratio info");
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "overscan info");
+    if (fixture_read_bits(reader, 1)) {
+        fixture_read_bits(reader, 3);                       // video_format
+        decoder->full_range = (int)fixture_read_bits(reader, 1);
+        if (fixture_read_bits(reader, 1)) {
+            fixture_read_bits(reader, 8);                   // colour_primaries
+            fixture_read_bits(reader, 8);                   // transfer_characteristics
+            decoder->matrix_coefficients = (int)fixture_read_bits(reader, 8);
+        }
+    }
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "chroma location");
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "timing info");
+    if (fixture_read_bits(reader, 1) || fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "HRD");
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "pic_struct");
+    if (fixture_read_bits(reader, 1)) {
+        fixture_read_bits(reader, 1);
+        fixture_read_ue(reader);
+        fixture_read_ue(reader);
+        if (fixture_read_ue(reader) > 16 || fixture_read_ue(reader) > 16) return fixture_decoder_fail(decoder, "mv length");
+        if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "reordering");
+        if (fixture_read_ue(reader) < 1) return fixture_decoder_fail(decoder, "dpb size");
+    }
+    return 0;
+}
+
+static inline int fixture_decode_sps(fixture_decoder_t* decoder, fixture_reader_t* reader) {
+    if (fixture_read_bits(reader, 8) != 66) return fixture_decoder_fail(decoder, "not baseline");
+    fixture_read_bits(reader, 8);                           // constraint flags
+    decoder->level_idc = (int)fixture_read_bits(reader, 8);
+    if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "sps id");
+    decoder->log2_max_frame_num = (int)fixture_read_ue(reader) + 4;
+    if (fixture_read_ue(reader) != 2) return fixture_decoder_fail(decoder, "poc type");
+    if (fixture_read_ue(reader) < 1) return fixture_decoder_fail(decoder, "no reference frames");
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "frame num gaps");
+    int mb_width = (int)fixture_read_ue(reader) + 1;
+    int mb_height = (int)fixture_read_ue(reader) + 1;
+    if (fixture_read_bits(reader, 1) != 1) return fixture_decoder_fail(decoder, "fields");
+    fixture_read_bits(reader, 1);                           // direct_8x8_inference_flag
+    int crop[4] = { 0, 0, 0, 0 };
+    if (fixture_read_bits(reader, 1)) {
+        for (int i = 0; i < 4; i++) crop[i] = (int)fixture_read_ue(reader);
+    }
+    if (fixture_read_bits(reader, 1) && fixture_decode_vui(decoder, reader) != 0) return -1;
+    if (fixture_read_trailing(reader) != 0) return fixture_decoder_fail(decoder, "sps trailing bits");
+
+    if (mb_width > 1024 || mb_height > 1024) return fixture_decoder_fail(decoder, "picture too large");
+    decoder->width = mb_width * 16 - 2 * (crop[0] + crop[1]);
+    decoder->height = mb_height * 16 - 2 * (crop[2] + crop[3]);
+    if (decoder->have_sps && mb_width == decoder->mb_width && mb_height == decoder->mb_height) return 0;
+    free(decoder->luma);
+    free(decoder->chroma[0]);
+    free(decoder->chroma[1]);
+    decoder->mb_width = mb_width;
+    decoder->mb_height = mb_height;
+    decoder->luma = (uint8_t*)calloc((size_t)mb_width * mb_height, 256);
+    decoder->chroma[0] = (uint8_t*)calloc((size_t)mb_width * mb_height, 64);
+    decoder->chroma[1] = (uint8_t*)calloc((size_t)mb_width * mb_height, 64);
+    decoder->has_picture = 0;
+    decoder->have_sps = decoder->luma && decoder->chroma[0] && decoder->chroma[1];
+    return decoder->have_sps ? 0 : fixture_decoder_fail(decoder, "out of memory");
+}
+
+static inline int fixture_decode_pps(fixture_decoder_t* decoder, fixture_reader_t* reader) {
+    if (fixture_read_ue(reader) != 0 || fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "pps id");
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "CABAC");
+    fixture_read_bits(reader, 1);                           // bottom_field_pic_order_in_frame_present_flag
+    if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "slice groups");
+    if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "l0 references");
+    fixture_read_ue(reader);
+    if (fixture_read_bits(reader, 1) || fixture_read_bits(reader, 2)) return fixture_decoder_fail(decoder, "weighted prediction");
+    fixture_read_se(reader);
+    fixture_read_se(reader);
+    fixture_read_se(reader);
+    if (fixture_read_bits(reader, 1) != 1) return fixture_decoder_fail(decoder, "deblocking control");
+    fixture_read_bits(reader, 1);                           // constrained_intra_pred_flag
+    if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "redundant pictures");
+    if (fixture_read_trailing(reader) != 0) return fixture_decoder_fail(decoder, "pps trailing bits");
+    decoder->have_pps = 1;
+    return 0;
+}
+
+static inline int fixture_decode_pcm(fixture_decoder_t* decoder, fixture_reader_t* reader, int mb) {
+    while (reader->bit % 8) {
+        if (fixture_read_bits(reader, 1) != 0) return fixture_decoder_fail(decoder, "pcm alignment");
+    }
+    size_t offset = reader->bit / 8;
+    if (offset + 384 > reader->size) return fixture_decoder_fail(decoder, "pcm overrun");
+    size_t pitch = (size_t)decoder->mb_width * 16;
+    int mb_x = mb % decoder->mb_width;
+    int mb_y = mb / decoder->mb_width;
+    const uint8_t* samples = reader->data + offset;
+    for (int y = 0; y < 16; y++) {
+        memcpy(decoder->luma + (size_t)(mb_y * 16 + y) * pitch + mb_x * 16, samples + y * 16, 16);
+    }
+    for (int plane = 0; plane < 2; plane++) {
+        for (int y = 0; y < 8; y++) {
+            memcpy(decoder->chroma[plane] + (size_t)(mb_y * 8 + y) * (pitch / 2) + mb_x * 8,
+                   samples + 256 + plane * 64 + y * 8, 8);
+        }
+    }
+    reader->bit += 384 * 8;
+    decoder->coded_macroblocks++;
+    return 0;
+}
+
+static inline int fixture_decode_slice(fixture_decoder_t* decoder, fixture_reader_t* reader, int idr) {
+    if (!decoder->have_sps || !decoder->have_pps) return fixture_decoder_fail(decoder, "slice before parameter sets");
+    if (!idr && !decoder->has_picture) return fixture_decoder_fail(decoder, "P slice without a reference");
+    if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "first_mb_in_slice");
+    uint32_t slice_type = fixture_read_ue(reader);
+    int p_slice = slice_type % 5 == 0;
+    if ((slice_type % 5 != 2 && !p_slice) || (idr && p_slice)) return fixture_decoder_fail(decoder, "slice type");
+    if (fixture_read_ue(reader) != 0) return fixture_decoder_fail(decoder, "slice pps id");
+    int frame_num = (int)fixture_read_bits(reader, decoder->log2_max_frame_num);
+    if (idr) {
+        if (frame_num != 0) return fixture_decoder_fail(decoder, "IDR frame_num");
+        int idr_pic_id = (int)fixture_read_ue(reader);
+        if (decoder->has_picture && decoder->last_was_idr && idr_pic_id == decoder->idr_pic_id) {
+            return fixture_decoder_fail(decoder, "repeated idr_pic_id");
+        }
+        decoder->idr_pic_id = idr_pic_id;
+    } else if (frame_num != decoder->expected_frame_num) {
+        return fixture_decoder_fail(decoder, "frame_num gap");
+    }
+    if (p_slice) {
+        if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "reference count override");
+        if (fixture_read_bits(reader, 1)) return fixture_decoder_fail(decoder, "reference list modification");
+    }
+    if (idr) {
+        fixture_read_bits(reader, 2);                       // no_output_of_prior_pics, long_term_reference
+    } else if (fixture_read_bits(reader, 1)) {
+        return fixture_decoder_fail(decoder, "adaptive reference marking");
+    }
+    fixture_read_se(reader);                                // slice_qp_delta
+    if (fixture_read_ue(reader) != 1) return fixture_decoder_fail(decoder, "deblocking enabled");
+
+    int total = decoder->mb_width * decoder->mb_height;
+    decoder->coded_macroblocks = 0;
+    for (int mb = 0; mb < total;) {
+        if (p_slice) {
+            mb += (int)fixture_read_ue(reader);
+            if (mb > total) return fixture_decoder_fail(decoder, "skip run past the picture");
+            if (mb == total) break;
+        }
+        uint32_t mb_type = fixture_read_ue(reader);
+        if (mb_type != (p_slice ? 30u : 25u)) return fixture_decoder_fail(decoder, "macroblock type");
+        if (fixture_decode_pcm(decoder, reader, mb) != 0) return -1;
+        mb++;
+    }
+    if (fixture_read_trailing(reader) != 0) return fixture_decoder_fail(decoder, "slice trailing bits");
+
+    decoder->has_picture = 1;
+    decoder->pictures++;
+    if (idr) decoder->idr_pictures++;
+    decoder->last_was_idr = idr;
+    decoder->expected_frame_num = (frame_num + 1) % (1 << decoder->log2_max_frame_num);
+    return 0;
+}
+
+// One NAL unit, header byte included, emulation prevention still in place
+static inline int fixture_decode_nal(fixture_decoder_t* decoder, const uint8_t* nal, size_t size) {
+    if (size < 1 || (nal[0] & 0x80)) return fixture_decoder_fail(decoder, "bad NAL header");
+    if (size > decoder->rbsp_capacity) {
+        free(decoder->rbsp);
+        decoder->rbsp = (uint8_t*)malloc(size);
+        decoder->rbsp_capacity = decoder->rbsp ? size : 0;
+        if (!decoder->rbsp) return fixture_decoder_fail(decoder, "out of memory");
+    }
+    size_t length = 0;
+    int zeros = 0;
+    for (size_t i = 1; i < size; i++) {
+        if (zeros == 2 && nal[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        if (zeros == 2 && nal[i] < 3) return fixture_decoder_fail(decoder, "start code inside a NAL unit");
+        decoder->rbsp[length++] = nal[i];
+        zeros = nal[i] == 0 ? zeros + 1 : 0;
+    }
+    fixture_reader_t reader = { decoder->rbsp, length, 0, 0 };
+    int type = H264_NAL_TYPE(nal[0]);
+    int result = 0;
+    if (type == H264_NAL_SPS) {
+        result = fixture_decode_sps(decoder, &reader);
+    } else if (type == H264_NAL_PPS) {
+        result = fixture_decode_pps(decoder, &reader);
+    } else if (type == H264_NAL_IDR || type == H264_NAL_SLICE) {
+        if ((nal[0] >> 5) == 0) return fixture_decoder_fail(decoder, "non-reference picture");
+        result = fixture_decode_slice(decoder, &reader, type == H264_NAL_IDR);
+    }
+    if (result == 0 && reader.overrun) return fixture_decoder_fail(decoder, "read past the NAL unit");
+    return result;
+}
+
+static inline int fixture_decode_annexb(fixture_decoder_t* decoder, const uint8_t* data, size_t size) {
+    size_t offset = 0;
+    const uint8_t* nal;
+    size_t nal_size;
+    while (h264_next_nal(data, size, &offset, &nal, &nal_size) == 1) {
+        if (fixture_decode_nal(decoder, nal, nal_size) != 0) return -1;
+    }
+    return 0;
+}
+
+// 0 if the decoded picture matches an NV12 picture exactly
+static inline int fixture_decoder_compare(const fixture_decoder_t* decoder, const uint8_t* y_plane, size_t y_pitch,
+                                          const uint8_t* uv_plane, size_t uv_pitch) {
+    size_t pitch = (size_t)decoder->mb_width * 16;
+    for (int y = 0; y < decoder->height; y++) {
+        if (memcmp(decoder->luma + y * pitch, y_plane + y * y_pitch, (size_t)decoder->width) != 0) return -1;
+    }
+    for (int y = 0; y < decoder->height / 2; y++) {
+        for (int x = 0; x < decoder->width / 2; x++) {
+            if (decoder->chroma[0][y * (pitch / 2) + x] != uv_plane[y * uv_pitch + x * 2] ||
+                decoder->chroma[1][y * (pitch / 2) + x] != uv_plane[y * uv_pitch + x * 2 + 1]) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+#endif // H264_FIXTURES_H
@@ -0,0 +1,405 @@
+#ifndef MP4_FIXTURES_H
+#define MP4_FIXTURES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mp4_box.h"
+#include "elementary_stream.h"
+
+// Canned encoded streams and an fMP4 checker for the muxer tests, so files
+// are validated without ffprobe. The H.264 stream is structurally real (a
+// genuine SPS, a PPS, IDR and non-IDR slice NAL units behind start codes) with
+// deterministic slice payloads that can be regenerated to compare against
+// what the file stores. AAC frames are ADTS headers over patterned payloads.
+
+#define FIXTURE_MAX_SPS 64
+
+static const uint8_t fixture_pps[] = { 0x68, 0xCE, 0x3C, 0x80 };
+
+// ---------------------------------------------------------------------------
+// H.264
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t rbsp[FIXTURE_MAX_SPS];
+    size_t bits;
+} fixture_bits_t;
+
+static inline void fixture_put_bit(fixture_bits_t* bits, unsigned int bit) {
+    if (bit) bits->rbsp[bits->bits / 8] |= (uint8_t)(0x80 >> (bits->bits % 8));
+    bits->bits++;
+}
+
+static inline void fixture_put_bits(fixture_bits_t* bits, uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) fixture_put_bit(bits, (value >> i) & 1);
+}
+
+static inline void fixture_put_ue(fixture_bits_t* bits, uint32_t value) {
+    uint32_t code = value + 1;
+    int length = 0;
+    while ((code >> length) > 1) length++;
+    fixture_put_bits(bits, 0, length);
+    fixture_put_bits(bits, code, length + 1);
+}
+
+// SPS NAL unit (header byte included) for a 4:2:0 progressive stream;
+// dimensions that are not whole macroblocks are cropped. Returns the size.
+static inline size_t fixture_sps(uint8_t* out, int profile_idc, int constraint_flags, int level_idc, int width, int height) {
+    fixture_bits_t bits;
+    memset(&bits, 0, sizeof(bits));
+    int width_mbs = (width + 15) / 16;
+    int height_mbs = (height + 15) / 16;
+
+    fixture_put_bits(&bits, (uint32_t)profile_idc, 8);
+    fixture_put_bits(&bits, (uint32_t)constraint_flags, 8);
+    fixture_put_bits(&bits, (uint32_t)level_idc, 8);
+    fixture_put_ue(&bits, 0);                               // seq_parameter_set_id
+    if (profile_idc == 100) {
+        fixture_put_ue(&bits, 1);                           // chroma_format_idc
+        fixture_put_ue(&bits, 0);                           // bit_depth_luma_minus8
+        fixture_put_ue(&bits, 0);                           // bit_depth_chroma_minus8
+        fixture_put_bit(&bits, 0);
+        fixture_put_bit(&bits, 0);                          // No scaling matrices
+    }
+    fixture_put_ue(&bits, 0);                               // log2_max_frame_num_minus4
+    fixture_put_ue(&bits, 2);                               // pic_order_cnt_type
+    fixture_put_ue(&bits, 1);                               // max_num_ref_frames
+    fixture_put_bit(&bits, 0);
+    fixture_put_ue(&bits, (uint32_t)width_mbs - 1);
+    fixture_put_ue(&bits, (uint32_t)height_mbs - 1);
+    fixture_put_bit(&bits, 1);                              // frame_mbs_only_flag
+    fixture_put_bit(&bits, 1);                              // direct_8x8_inference_flag
+    int crop_right = width_mbs * 16 - width;
+    int crop_bottom = height_mbs * 16 - height;
+    if (crop_right || crop_bottom) {
+        fixture_put_bit(&bits, 1);
+        fixture_put_ue(&bits, 0);
+        fixture_put_ue(&bits, (uint32_t)crop_right / 2);
+        fixture_put_ue(&bits, 0);
+        fixture_put_ue(&bits, (uint32_t)crop_bottom / 2);
+    } else {
+        fixture_put_bit(&bits, 0);
+    }
+    fixture_put_bit(&bits, 0);                              // No VUI
+    fixture_put_bit(&bits, 1);                              // rbsp_stop_one_bit
+
+    // Emulation prevention: no 00 00 0x (x <= 3) in the NAL payload
+    size_t size = 0, zeros = 0;
+    out[size++] = 0x67;
+    for (size_t i = 0; i < (bits.bits + 7) / 8; i++) {
+        if (zeros >= 2 && bits.rbsp[i] <= 3) {
+            out[size++] = 3;
+            zeros = 0;
+        }
+        out[size++] = bits.rbsp[i];
+        zeros = bits.rbsp[i] == 0 ? zeros + 1 : 0;
+    }
+    return size;
+}
+
+// Slice payload for a frame; never zero, so it needs no emulation prevention
+static inline void fixture_slice_payload(uint64_t frame, uint8_t* out, size_t size) {
+    for (size_t i = 0; i < size; i++) out[i] = (uint8_t)(0x80 | ((frame * 31 + i * 7) & 0x7F));
+}
+
+// Slice size that varies per frame; keyframes are larger
+static inline size_t fixture_slice_size(uint64_t frame, int keyframe, size_t base) {
+    return (keyframe ? base * 4 : base) + (size_t)(frame * 37 % 101);
+}
+
+// Annex B access unit: AUD, then SPS and PPS on keyframes, then one slice.
+// Returns the size, or 0 if it does not fit.
+static inline size_t fixture_access_unit(uint8_t* out, size_t capacity, uint64_t frame, int keyframe, size_t slice_size,
+                                         const uint8_t* sps, size_t sps_size) {
+    static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+    static const uint8_t aud[2] = { 0x09, 0xF0 };
+    size_t needed = 4 + sizeof(aud) + 4 + 1 + slice_size + (keyframe ? 8 + sps_size + sizeof(fixture_pps) : 0);
+    if (needed > capacity) return 0;
+
+    size_t size = 0;
+    memcpy(out + size, start_code, 4);
+    size += 4;
+    memcpy(out + size, aud, sizeof(aud));
+    size += sizeof(aud);
+    if (keyframe) {
+        memcpy(out + size, start_code, 4);
+        memcpy(out + size + 4, sps, sps_size);
+        size += 4 + sps_size;
+        memcpy(out + size, start_code + 1, 3);              // 3-byte start codes are valid too
+        memcpy(out + size + 3, fixture_pps, sizeof(fixture_pps));
+        size += 3 + sizeof(fixture_pps);
+    }
+    memcpy(out + size, start_code, 4);
+    size += 4;
+    out[size++] = keyframe ? 0x65 : 0x41;
+    fixture_slice_payload(frame, out + size, slice_size);
+    return size + slice_size;
+}
+
+// ---------------------------------------------------------------------------
+// AAC
+// ---------------------------------------------------------------------------
+
+static inline void fixture_aac_payload(uint64_t index, uint8_t* out, size_t size) {
+    for (size_t i = 0; i < size; i++) out[i] = (uint8_t)(index * 13 + i * 3 + 1);
+}
+
+static inline size_t fixture_aac_size(uint64_t index) {
+    return 180 + (size_t)(index * 53 % 211);
+}
+
+// ADTS frame (header and payload); returns the size
+static inline size_t fixture_adts_frame(uint8_t* out, uint64_t index, uint32_t sample_rate, int channels) {
+    size_t payload = fixture_aac_size(index);
+    if (aac_adts_write_header(out, AAC_OBJECT_TYPE_LC, sample_rate, channels, payload) != 0) return 0;
+    fixture_aac_payload(index, out + AAC_ADTS_HEADER_SIZE, payload);
+    return AAC_ADTS_HEADER_SIZE + payload;
+}
+
+// ---------------------------------------------------------------------------
+// Output capture
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    uint64_t writes;
+} fixture_output_t;
+
+static inline int fixture_output_write(void* context, const uint8_t* data, size_t size) {
+    fixture_output_t* output = (fixture_output_t*)context;
+    if (output->size + size > output->capacity) {
+        size_t capacity = output->capacity ? output->capacity * 2 : 65536;
+        while (capacity < output->size + size) capacity *= 2;
+        uint8_t* grown = (uint8_t*)realloc(output->data, capacity);
+        if (!grown) return -1;
+        output->data = grown;
+        output->capacity = capacity;
+    }
+    memcpy(output->data + output->size, data, size);
+    output->size += size;
+    output->writes++;
+    return 0;
+}
+
+static inline void fixture_output_free(fixture_output_t* output) {
+    free(output->data);
+    memset(output, 0, sizeof(fixture_output_t));
+}
+
+// ---------------------------------------------------------------------------
+// fMP4 checker
+// ---------------------------------------------------------------------------
+
+#define FIXTURE_VIDEO 0
+#define FIXTURE_AUDIO 1
+
+// Called for every sample in file order; returns 0 to continue
+typedef int (*fixture_sample_fn)(void* context, int track, uint64_t index, uint64_t time,
+                                 const uint8_t* data, uint32_t size, uint32_t flags);
+
+typedef struct {
+    int tracks[2];                  // Present in the moov
+    uint32_t track_ids[2];
+    uint32_t timescales[2];
+    int width;                      // tkhd
+    int height;
+    uint8_t sps[FIXTURE_MAX_SPS];   // avcC
+    size_t sps_size;
+    uint8_t audio_config[2];        // esds
+    int channels;
+
+    uint64_t fragments;
+    uint64_t samples[2];
+    uint64_t first_time[2];         // tfdt of the track's first fragment
+    uint64_t end_time[2];           // Decode time after its last sample
+    uint64_t sync_starts;           // Fragments whose video run starts on a sync sample
+    uint64_t video_runs;
+    uint64_t bytes;                 // Through the last complete fragment
+    const char* error;
+} fixture_mp4_t;
+
+static inline int fixture_fail(fixture_mp4_t* info, const char* error) {
+    info->error = error;
+    return -1;
+}
+
+static inline int fixture_track_index(const fixture_mp4_t* info, uint32_t track_id) {
+    for (int t = 0; t < 2; t++) {
+        if (info->tracks[t] && info->track_ids[t] == track_id) return t;
+    }
+    return -1;
+}
+
+static inline int fixture_parse_trak(const mp4_box_t* trak, fixture_mp4_t* info) {
+    mp4_box_t tkhd, mdia, mdhd, hdlr, minf, stbl, stsd;
+    if (mp4_box_find(trak->payload, trak->payload_size, MP4_FOURCC('t', 'k', 'h', 'd'), &tkhd) != 0 ||
+        mp4_box_find(trak->payload, trak->payload_size, MP4_FOURCC('m', 'd', 'i', 'a'), &mdia) != 0 ||
+        mp4_box_find(mdia.payload, mdia.payload_size, MP4_FOURCC('m', 'd', 'h', 'd'), &mdhd) != 0 ||
+        mp4_box_find(mdia.payload, mdia.payload_size, MP4_FOURCC('h', 'd', 'l', 'r'), &hdlr) != 0 ||
+        mp4_box_find(mdia.payload, mdia.payload_size, MP4_FOURCC('m', 'i', 'n', 'f'), &minf) != 0 ||
+        mp4_box_find(minf.payload, minf.payload_size, MP4_FOURCC('s', 't', 'b', 'l'), &stbl) != 0 ||
+        mp4_box_find(stbl.payload, stbl.payload_size, MP4_FOURCC('s', 't', 's', 'd'), &stsd) != 0) {
+        return fixture_fail(info, "incomplete trak");
+    }
+    if (tkhd.payload_size < 84 || mdhd.payload_size < 24 || hdlr.payload_size < 12 || stsd.payload_size < 16) {
+        return fixture_fail(info, "short trak boxes");
+    }
+
+    int video = mp4_read_u32(hdlr.payload + 8) == MP4_FOURCC('v', 'i', 'd', 'e');
+    int t = video ? FIXTURE_VIDEO : FIXTURE_AUDIO;
+    if (info->tracks[t]) return fixture_fail(info, "duplicate track");
+    info->tracks[t] = 1;
+    info->track_ids[t] = mp4_read_u32(tkhd.payload + 12);
+    info->timescales[t] = mp4_read_u32(mdhd.payload + 12);
+
+    // stsd: full box header, entry count, then the sample entry
+    mp4_box_t entry, config;
+    if (mp4_box_parse(stsd.payload + 8, stsd.payload_size - 8, &entry) != 0) return fixture_fail(info, "bad stsd");
+    if (video) {
+        info->width = (int)(mp4_read_u32(tkhd.payload + 76) >> 16);
+        info->height = (int)(mp4_read_u32(tkhd.payload + 80) >> 16);
+        if (entry.type != MP4_FOURCC('a', 'v', 'c', '1') || entry.payload_size < 78 ||
+            mp4_box_find(entry.payload + 78, entry.payload_size - 78, MP4_FOURCC('a', 'v', 'c', 'C'), &config) != 0 ||
+            config.payload_size < 8) {
+            return fixture_fail(info, "no avcC");
+        }
+        info->sps_size = mp4_read_u16(config.payload + 6);
+        if (info->sps_size > FIXTURE_MAX_SPS || 8 + info->sps_size > config.payload_size) return fixture_fail(info, "bad avcC");
+        memcpy(info->sps, config.payload + 8, info->sps_size);
+    } else {
+        if (entry.type != MP4_FOURCC('m', 'p', '4', 'a') || entry.payload_size < 28 ||
+            mp4_box_find(entry.payload + 28, entry.payload_size - 28, MP4_FOURCC('e', 's', 'd', 's'), &config) != 0) {
+            return fixture_fail(info, "no esds");
+        }
+        info->channels = mp4_read_u16(entry.payload + 16);
+        // DecoderSpecificInfo: tag 5, length 2
+        for (size_t i = 4; i + 4 <= config.payload_size; i++) {
+            if (config.payload[i] == 0x05 && config.payload[i + 1] == 2) {
+                memcpy(info->audio_config, config.payload + i + 2, 2);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static inline int fixture_parse_moov(const mp4_box_t* moov, fixture_mp4_t* info) {
+    size_t offset = 0;
+    mp4_box_t box, mvex;
+    int traks = 0;
+    while (mp4_box_next(moov->payload, moov->payload_size, &offset, &box) == 1) {
+        if (box.type != MP4_FOURCC('t', 'r', 'a', 'k')) continue;
+        if (fixture_parse_trak(&box, info) != 0) return -1;
+        traks++;
+    }
+    if (traks == 0) return fixture_fail(info, "no tracks");
+    if (mp4_box_find(moov->payload, moov->payload_size, MP4_FOURCC('m', 'v', 'e', 'x'), &mvex) != 0) {
+        return fixture_fail(info, "no mvex");
+    }
+    int trex = 0;
+    offset = 0;
+    while (mp4_box_next(mvex.payload, mvex.payload_size, &offset, &box) == 1) {
+        if (box.type == MP4_FOURCC('t', 'r', 'e', 'x')) trex++;
+    }
+    return trex == traks ? 0 : fixture_fail(info, "trex count does not match tracks");
+}
+
+static inline int fixture_parse_fragment(const uint8_t* moof_start, const mp4_box_t* moof, const mp4_box_t* mdat,
+                                         fixture_mp4_t* info, fixture_sample_fn on_sample, void* context) {
+    mp4_box_t mfhd;
+    if (mp4_box_find(moof->payload, moof->payload_size, MP4_FOURCC('m', 'f', 'h', 'd'), &mfhd) != 0 ||
+        mfhd.payload_size < 8 || mp4_read_u32(mfhd.payload + 4) != info->fragments + 1) {
+        return fixture_fail(info, "bad mfhd sequence");
+    }
+
+    size_t offset = 0;
+    mp4_box_t traf;
+    const uint8_t* mdat_data = mdat->payload;
+    const uint8_t* mdat_end = mdat->payload + mdat->payload_size;
+    while (mp4_box_next(moof->payload, moof->payload_size, &offset, &traf) == 1) {
+        if (traf.type != MP4_FOURCC('t', 'r', 'a', 'f')) continue;
+        mp4_box_t tfhd, tfdt, trun;
+        if (mp4_box_find(traf.payload, traf.payload_size, MP4_FOURCC('t', 'f', 'h', 'd'), &tfhd) != 0 ||
+            mp4_box_find(traf.payload, traf.payload_size, MP4_FOURCC('t', 'f', 'd', 't'), &tfdt) != 0 ||
+            mp4_box_find(traf.payload, traf.payload_size, MP4_FOURCC('t', 'r', 'u', 'n'), &trun) != 0 ||
+            tfhd.payload_size < 8 || tfdt.payload_size < 12 || trun.payload_size < 12) {
+            return fixture_fail(info, "incomplete traf");
+        }
+        if (!(mp4_read_u24(tfhd.payload + 1) & 0x020000)) return fixture_fail(info, "tfhd not moof-relative");
+        int t = fixture_track_index(info, mp4_read_u32(tfhd.payload + 4));
+        if (t < 0) return fixture_fail(info, "traf for an unknown track");
+
+        uint64_t time = mp4_read_u64(tfdt.payload + 4);
+        if (info->samples[t] == 0) {
+            info->first_time[t] = time;
+        } else if (time != info->end_time[t]) {
+            return fixture_fail(info, "tfdt does not continue the previous fragment");
+        }
+
+        uint32_t flags = mp4_read_u24(trun.payload + 1);
+        uint32_t count = mp4_read_u32(trun.payload + 4);
+        if (!(flags & 0x000001) || !(flags & 0x000100) || !(flags & 0x000200)) return fixture_fail(info, "unexpected trun layout");
+        size_t entry_size = (flags & 0x000400) ? 12 : 8;
+        if (12 + (size_t)count * entry_size > trun.payload_size) return fixture_fail(info, "trun too short");
+        const uint8_t* sample_data = moof_start + mp4_read_u32(trun.payload + 8);
+        const uint8_t* entry = trun.payload + 12;
+        for (uint32_t s = 0; s < count; s++, entry += entry_size) {
+            uint32_t duration = mp4_read_u32(entry);
+            uint32_t size = mp4_read_u32(entry + 4);
+            uint32_t sample_flags = (flags & 0x000400) ? mp4_read_u32(entry + 8) : 0x02000000;
+            if (sample_data < mdat_data || sample_data + size > mdat_end) return fixture_fail(info, "sample outside mdat");
+            if (t == FIXTURE_VIDEO && s == 0) {
+                info->video_runs++;
+                if (!(sample_flags & 0x00010000)) info->sync_starts++;
+            }
+            if (on_sample && on_sample(context, t, info->samples[t], time, sample_data, size, sample_flags) != 0) {
+                return fixture_fail(info, "sample content mismatch");
+            }
+            sample_data += size;
+            time += duration;
+            info->samples[t]++;
+        }
+        info->end_time[t] = time;
+    }
+    info->fragments++;
+    return 0;
+}
+
+// Check an fMP4 file and visit its samples. Returns 0 if every box is
+// well formed; a file cut short is accepted up to its last complete
+// fragment when allow_truncated is set.
+static inline int fixture_parse_fmp4(const uint8_t* data, size_t size, int allow_truncated, fixture_mp4_t* info,
+                                     fixture_sample_fn on_sample, void* context) {
+    memset(info, 0, sizeof(fixture_mp4_t));
+    mp4_box_t box;
+    size_t offset = 0;
+    if (mp4_box_next(data, size, &offset, &box) != 1 || box.type != MP4_FOURCC('f', 't', 'y', 'p')) {
+        return fixture_fail(info, "no ftyp");
+    }
+    if (mp4_box_next(data, size, &offset, &box) != 1 || box.type != MP4_FOURCC('m', 'o', 'o', 'v') || offset > size) {
+        return fixture_fail(info, "no moov");
+    }
+    if (fixture_parse_moov(&box, info) != 0) return -1;
+    info->bytes = offset;
+
+    while (offset < size) {
+        size_t moof_offset = offset;
+        mp4_box_t moof, mdat;
+        int complete = mp4_box_next(data, size, &offset, &moof) == 1 && offset <= size &&
+                       moof.type == MP4_FOURCC('m', 'o', 'o', 'f') &&
+                       mp4_box_next(data, size, &offset, &mdat) == 1 && offset <= size &&
+                       mdat.type == MP4_FOURCC('m', 'd', 'a', 't');
+        if (!complete) {
+            if (allow_truncated) break;
+            return fixture_fail(info, "incomplete fragment");
+        }
+        if (fixture_parse_fragment(data + moof_offset, &moof, &mdat, info, on_sample, context) != 0) return -1;
+        info->bytes = offset;
+    }
+    return 0;
+}
+
+#endif // MP4_FIXTURES_H
@@ -0,0 +1,208 @@
+#include "test_common.h"
+#include "audio_capture.h"
+#include "simulated_audio.h"
+#include "platform.h"
+#include <string.h>
+
+// Pop everything queued, checking that each packet carries the frame indices
+// its position says it should. Returns the number of frames popped or -1.
+static long drain_and_check(audio_capture_t* capture, int channels, uint64_t* next_position, int allow_gaps) {
+    long frames = 0;
+    audio_packet_t packet;
+    while (audio_capture_pop(capture, &packet) == 0) {
+        if (packet.position < *next_position) return -1;
+        if (!allow_gaps && packet.position != *next_position) return -1;
+        const int16_t* samples = (const int16_t*)audio_capture_packet_data(capture, &packet);
+        for (uint32_t i = 0; i < packet.frames; i++) {
+            for (int c = 0; c < channels; c++) {
+                if (samples[i * channels + c] != (int16_t)(packet.position + i + (uint64_t)c)) return -1;
+            }
+        }
+        *next_position = packet.position + packet.frames;
+        frames += packet.frames;
+        audio_capture_release(capture, &packet);
+    }
+    return frames;
+}
+
+static void count_notify(void* context) {
+    platform_atomic_inc((platform_atomic_t*)context);
+}
+
+static int test_simulated_config_validation(void) {
+    audio_source_t source;
+    simulated_audio_config_t config = { 48000, 2, 10, 5, 1 };
+    TEST_ASSERT(simulated_audio_create(&source, &config) != 0);          // Buffer shorter than a period
+    config.buffer_ms = 50;
+    config.channels = 0;
+    TEST_ASSERT(simulated_audio_create(&source, &config) != 0);
+    config.channels = 2;
+    TEST_ASSERT(simulated_audio_create(&source, &config) == 0);
+    TEST_ASSERT_EQ(4, source.block_align);
+    TEST_ASSERT(strcmp(audio_source_name(&source), "simulated") == 0);
+
+    audio_capture_t capture;
+    TEST_ASSERT(audio_capture_init(&capture, "bad", NULL, 0) != 0);
+    TEST_ASSERT(audio_capture_init(&capture, "sim", &source, 5) == 0);
+    TEST_ASSERT_EQ(8, (int)capture.queue.capacity);
+    audio_capture_cleanup(&capture);
+    audio_source_destroy(&source);
+
+    audio_source_t empty;
+    memset(&empty, 0, sizeof(empty));
+    simulated_audio_stats_t stats;
+    TEST_ASSERT(simulated_audio_get_stats(&empty, &stats) != 0);
+    TEST_ASSERT(audio_source_wait(&empty, 1) < 0);
+    return 0;
+}
+
+// The device timer wakes the capture thread; every frame arrives once, in order
+static int test_event_driven_capture(void) {
+    audio_source_t source;
+    simulated_audio_config_t config = { 48000, 2, 10, 200, 1 };
+    TEST_ASSERT(simulated_audio_create(&source, &config) == 0);
+
+    audio_capture_t capture;
+    platform_atomic_t notified = 0;
+    TEST_ASSERT(audio_capture_init(&capture, "sim", &source, 0) == 0);
+    audio_capture_set_notify(&capture, count_notify, (void*)&notified);
+    TEST_ASSERT(audio_capture_start(&capture) == 0);
+
+    uint64_t next_position = 0;
+    long frames = 0;
+    for (int i = 0; i < 30; i++) {
+        platform_sleep_ms(10);
+        long popped = drain_and_check(&capture, 2, &next_position, 0);
+        TEST_ASSERT(popped >= 0);
+        frames += popped;
+    }
+    audio_capture_stop(&capture);
+    long popped = drain_and_check(&capture, 2, &next_position, 0);
+    TEST_ASSERT(popped >= 0);
+    frames += popped;
+
+    simulated_audio_stats_t device;
+    audio_capture_stats_t stats;
+    TEST_ASSERT(simulated_audio_get_stats(&source, &device) == 0);
+    audio_capture_get_stats(&capture, &stats);
+    TEST_ASSERT_EQ(0, (int)device.lost_frames);
+    // The last drain runs just before the device stops; at most a timer tick can slip in between
+    TEST_ASSERT(frames <= (long)device.produced_frames);
+    TEST_ASSERT((long)device.produced_frames - frames <= 48000 / 100 * 2);
+    TEST_ASSERT(frames > 48000 / 10);                                    // Well over 100 ms of audio
+    TEST_ASSERT_EQ(0, (int)stats.dropped_frames);
+    TEST_ASSERT(stats.wakes > stats.timeouts);                           // Woken by the device, not by polling
+    TEST_ASSERT(platform_atomic_load(&notified) > 0);
+
+    audio_capture_cleanup(&capture);
+    audio_source_destroy(&source);
+    return 0;
+}
+
+// Without device signals the thread still drains on its wait timeout
+static int test_polling_fallback(void) {
+    audio_source_t source;
+    simulated_audio_config_t config = { 16000, 1, 5, 500, 0 };
+    TEST_ASSERT(simulated_audio_create(&source, &config) == 0);
+
+    audio_capture_t capture;
+    TEST_ASSERT(audio_capture_init(&capture, "poll", &source, 0) == 0);
+    TEST_ASSERT(audio_capture_start(&capture) == 0);
+    platform_sleep_ms(100);
+    audio_capture_stop(&capture);
+
+    uint64_t next_position = 0;
+    long frames = drain_and_check(&capture, 1, &next_position, 0);
+    audio_capture_stats_t stats;
+    audio_capture_get_stats(&capture, &stats);
+    TEST_ASSERT(frames > 0);
+    TEST_ASSERT_EQ(0, (int)stats.wakes);
+    TEST_ASSERT(stats.timeouts > 0);
+
+    audio_capture_cleanup(&capture);
+    audio_source_destroy(&source);
+    return 0;
+}
+
+// A stalled consumer loses packets at the ring; the device itself never overruns
+static int test_stalled_consumer_drops_at_ring(void) {
+    audio_source_t source;
+    simulated_audio_config_t config = { 48000, 2, 5, 50, 1 };
+    TEST_ASSERT(simulated_audio_create(&source, &config) == 0);
+
+    audio_capture_t capture;
+    TEST_ASSERT(audio_capture_init(&capture, "stall", &source, 2) == 0);
+    TEST_ASSERT(audio_capture_start(&capture) == 0);
+    platform_sleep_ms(200);
+    audio_capture_stop(&capture);
+
+    uint64_t next_position = 0;
+    long frames = drain_and_check(&capture, 2, &next_position, 1);
+    TEST_ASSERT(frames > 0);
+
+    simulated_audio_stats_t device;
+    audio_capture_stats_t stats;
+    TEST_ASSERT(simulated_audio_get_stats(&source, &device) == 0);
+    audio_capture_get_stats(&capture, &stats);
+    TEST_ASSERT(stats.dropped_frames > 0);
+    TEST_ASSERT_EQ(0, (int)device.lost_frames);
+    TEST_ASSERT(frames + (long)stats.dropped_frames <= (long)device.produced_frames);
+    TEST_ASSERT((long)device.produced_frames - frames - (long)stats.dropped_frames <= 48000 / 200 * 2);
+
+    audio_capture_cleanup(&capture);
+    audio_source_destroy(&source);
+    return 0;
+}
+
+// A source that signals constantly and fails every read
+static int broken_wait(audio_source_t* source, unsigned int timeout_ms) {
+    (void)source;
+    (void)timeout_ms;
+    return AUDIO_WAIT_READY;
+}
+
+static int broken_get_buffer(audio_source_t* source, const uint8_t** data, uint32_t* frames) {
+    (void)source;
+    (void)data;
+    (void)frames;
+    return -1;
+}
+
+static int test_source_errors_fail_capture(void) {
+    static const audio_source_ops_t broken_ops = {
+        "broken", NULL, broken_wait, broken_get_buffer, NULL, NULL, NULL, NULL, NULL
+    };
+    audio_source_t source;
+    memset(&source, 0, sizeof(source));
+    source.ops = &broken_ops;
+    source.sample_rate = 8000;
+    source.channels = 1;
+    source.bits_per_sample = 16;
+    source.block_align = 2;
+    source.period_ms = 1;
+
+    audio_capture_t capture;
+    TEST_ASSERT(audio_capture_init(&capture, "broken", &source, 0) == 0);
+    TEST_ASSERT(audio_capture_start(&capture) == 0);
+    for (int waited = 0; waited < 5000 && !audio_capture_failed(&capture); waited++) platform_sleep_ms(1);
+    TEST_ASSERT(audio_capture_failed(&capture));
+    audio_capture_stop(&capture);
+
+    audio_capture_stats_t stats;
+    audio_capture_get_stats(&capture, &stats);
+    TEST_ASSERT_EQ(AUDIO_CAPTURE_MAX_ERRORS + 1, (int)stats.errors);
+    audio_capture_cleanup(&capture);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_simulated_config_validation);
+    RUN_TEST(test_event_driven_capture);
+    RUN_TEST(test_polling_fallback);
+    RUN_TEST(test_stalled_consumer_drops_at_ring);
+    RUN_TEST(test_source_errors_fail_capture);
+
+    return failures == 0 ? 0 : 1;
+}
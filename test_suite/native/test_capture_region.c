@@ -0,0 +1,139 @@
+#include "test_common.h"
+#include "capture_region.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DESKTOP_WIDTH 3840
+#define DESKTOP_HEIGHT 2160
+
+static int test_resolve_clips_and_aligns(void) {
+    capture_region_t region = { 100, 200, 641, 479 };
+    TEST_ASSERT(capture_region_resolve(&region, DESKTOP_WIDTH, DESKTOP_HEIGHT) == 0);
+    TEST_ASSERT_EQ(100, region.x);
+    TEST_ASSERT_EQ(200, region.y);
+    TEST_ASSERT_EQ(640, region.width);
+    TEST_ASSERT_EQ(478, region.height);
+
+    // Hanging off the bottom-right corner is clipped to the desktop
+    capture_region_t corner = { DESKTOP_WIDTH - 300, DESKTOP_HEIGHT - 100, 640, 480 };
+    TEST_ASSERT(capture_region_resolve(&corner, DESKTOP_WIDTH, DESKTOP_HEIGHT) == 0);
+    TEST_ASSERT_EQ(300, corner.width);
+    TEST_ASSERT_EQ(100, corner.height);
+
+    // Negative origins clip too
+    capture_region_t negative = { -50, -50, 150, 150 };
+    TEST_ASSERT(capture_region_resolve(&negative, DESKTOP_WIDTH, DESKTOP_HEIGHT) == 0);
+    TEST_ASSERT_EQ(0, negative.x);
+    TEST_ASSERT_EQ(100, negative.width);
+
+    capture_region_t full;
+    capture_region_full(&full, DESKTOP_WIDTH, DESKTOP_HEIGHT);
+    TEST_ASSERT(capture_region_is_full(&full, DESKTOP_WIDTH, DESKTOP_HEIGHT));
+    TEST_ASSERT(!capture_region_is_full(&region, DESKTOP_WIDTH, DESKTOP_HEIGHT));
+    return 0;
+}
+
+static int test_resolve_rejects_unusable_regions(void) {
+    capture_region_t outside = { DESKTOP_WIDTH, 0, 100, 100 };
+    capture_region_t empty = { 10, 10, 0, 100 };
+    capture_region_t sliver = { DESKTOP_WIDTH - 1, 0, 100, 100 };   // 1 pixel wide after clipping
+    TEST_ASSERT(capture_region_resolve(&outside, DESKTOP_WIDTH, DESKTOP_HEIGHT) != 0);
+    TEST_ASSERT(capture_region_resolve(&empty, DESKTOP_WIDTH, DESKTOP_HEIGHT) != 0);
+    TEST_ASSERT(capture_region_resolve(&sliver, DESKTOP_WIDTH, DESKTOP_HEIGHT) != 0);
+    TEST_ASSERT(capture_region_resolve(NULL, DESKTOP_WIDTH, DESKTOP_HEIGHT) != 0);
+    return 0;
+}
+
+static int test_dirty_rects_translate_to_region(void) {
+    capture_region_t region = { 1000, 500, 640, 480 };
+    frame_rect_t dirty[] = {
+        { 0, 0, DESKTOP_WIDTH, DESKTOP_HEIGHT },    // Whole desktop, clipped to the region
+        { 1100, 600, 1120, 620 },                   // Inside
+        { 0, 0, 100, 100 },                         // Outside, dropped
+    };
+    frame_rect_t dirty_out[3];
+    frame_move_t moves_out[1];
+    int move_count = -1;
+    int dirty_count = -1;
+
+    capture_region_map_updates(&region, NULL, 0, dirty, 3, moves_out, &move_count, dirty_out, &dirty_count);
+    TEST_ASSERT_EQ(0, move_count);
+    TEST_ASSERT_EQ(2, dirty_count);
+    TEST_ASSERT_EQ(0, dirty_out[0].left);
+    TEST_ASSERT_EQ(640, dirty_out[0].right);
+    TEST_ASSERT_EQ(480, dirty_out[0].bottom);
+    TEST_ASSERT_EQ(100, dirty_out[1].left);
+    TEST_ASSERT_EQ(100, dirty_out[1].top);
+    TEST_ASSERT_EQ(120, dirty_out[1].bottom);
+    return 0;
+}
+
+static int test_moves_from_outside_become_dirty(void) {
+    capture_region_t region = { 1000, 500, 640, 480 };
+    frame_move_t moves[] = {
+        // Scroll inside the region: stays a move in local coordinates
+        { 1000, 520, { 1000, 500, 1640, 960 } },
+        // Window dragged in from the left: its source is outside the region
+        { 700, 600, { 900, 600, 1200, 800 } },
+        // Move entirely outside the region
+        { 0, 0, { 10, 10, 50, 50 } },
+    };
+    frame_move_t moves_out[3];
+    frame_rect_t dirty_out[3];
+    int move_count = 0;
+    int dirty_count = 0;
+
+    capture_region_map_updates(&region, moves, 3, NULL, 0, moves_out, &move_count, dirty_out, &dirty_count);
+    TEST_ASSERT_EQ(1, move_count);
+    TEST_ASSERT_EQ(0, moves_out[0].source_x);
+    TEST_ASSERT_EQ(20, moves_out[0].source_y);
+    TEST_ASSERT_EQ(0, moves_out[0].destination.top);
+    TEST_ASSERT_EQ(460, moves_out[0].destination.bottom);
+
+    TEST_ASSERT_EQ(1, dirty_count);
+    TEST_ASSERT_EQ(0, dirty_out[0].left);
+    TEST_ASSERT_EQ(200, dirty_out[0].right);
+    TEST_ASSERT_EQ(100, dirty_out[0].top);
+    TEST_ASSERT_EQ(300, dirty_out[0].bottom);
+    return 0;
+}
+
+static int test_region_readback_cost(void) {
+    // A full-desktop change on 4K only copies the 640x480 region into the frame
+    capture_region_t region = { 1600, 800, 640, 480 };
+    frame_rect_t desktop_dirty = { 0, 0, DESKTOP_WIDTH, DESKTOP_HEIGHT };
+    frame_rect_t dirty_out[1];
+    int move_count = 0;
+    int dirty_count = 0;
+    capture_region_map_updates(&region, NULL, 0, &desktop_dirty, 1, NULL, &move_count, dirty_out, &dirty_count);
+    TEST_ASSERT_EQ(1, dirty_count);
+
+    size_t staging_size = (size_t)region.width * region.height * 4;
+    uint8_t* staging = (uint8_t*)malloc(staging_size);
+    TEST_ASSERT(staging != NULL);
+    memset(staging, 0x33, staging_size);
+
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, region.width, region.height) == 0);
+    TEST_ASSERT(dirty_frame_full_update(&frame, staging, (size_t)region.width * 4) == 0);
+    TEST_ASSERT(dirty_frame_apply(&frame, staging, (size_t)region.width * 4, NULL, 0, dirty_out, dirty_count) == 0);
+    TEST_ASSERT_EQ(640 * 480 * 4, frame.bytes_copied);
+    TEST_ASSERT(frame.bytes_copied * 25 < (uint64_t)DESKTOP_WIDTH * DESKTOP_HEIGHT * 4);
+
+    dirty_frame_cleanup(&frame);
+    free(staging);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_resolve_clips_and_aligns);
+    RUN_TEST(test_resolve_rejects_unusable_regions);
+    RUN_TEST(test_dirty_rects_translate_to_region);
+    RUN_TEST(test_moves_from_outside_become_dirty);
+    RUN_TEST(test_region_readback_cost);
+
+    return failures == 0 ? 0 : 1;
+}
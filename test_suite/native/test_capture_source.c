@@ -0,0 +1,322 @@
+#include "test_common.h"
+#include "capture_source.h"
+#include "synthetic_source.h"
+#include "replay_source.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_TEST_FILE "test_capture_source.raw"
+
+static int create_synthetic(capture_source_t* source, frame_pool_t* pool, synthetic_pattern_t pattern,
+                            int width, int height, uint32_t seed) {
+    synthetic_source_config_t config = { pattern, width, height, 30, seed };
+    if (synthetic_source_create(source, &config) != 0) return -1;
+    if (frame_pool_init(pool, (size_t)width * height * 4, 4) != 0) return -1;
+    if (capture_source_set_pool(source, pool) != 0) return -1;
+    return capture_source_start(source);
+}
+
+// Fetch the next frame and copy it out, releasing the pool reference
+static int next_frame(capture_source_t* source, frame_pool_t* pool, uint8_t* out, int top_down) {
+    frame_handle_t frame = FRAME_HANDLE_INVALID;
+    int result = capture_source_get_frame(source, &frame, top_down);
+    if (result == CAPTURE_FRAME_NEW) {
+        memcpy(out, frame_pool_data(pool, frame), frame_pool_frame_size(pool));
+        frame_pool_release(pool, frame);
+    }
+    return result;
+}
+
+static int rows_flipped(const uint8_t* a, const uint8_t* b, int width, int height) {
+    size_t row_bytes = (size_t)width * 4;
+    for (int y = 0; y < height; y++) {
+        if (memcmp(a + (size_t)y * row_bytes, b + (size_t)(height - 1 - y) * row_bytes, row_bytes) != 0) return 0;
+    }
+    return 1;
+}
+
+static int test_pattern_names(void) {
+    synthetic_pattern_t pattern;
+    TEST_ASSERT(synthetic_pattern_parse("blocks", &pattern) == 0);
+    TEST_ASSERT_EQ(SYNTHETIC_PATTERN_BLOCKS, pattern);
+    TEST_ASSERT(synthetic_pattern_parse("text", &pattern) == 0);
+    TEST_ASSERT_EQ(SYNTHETIC_PATTERN_TEXT, pattern);
+    TEST_ASSERT(synthetic_pattern_parse("noise", &pattern) == 0);
+    TEST_ASSERT_EQ(SYNTHETIC_PATTERN_NOISE, pattern);
+    TEST_ASSERT(synthetic_pattern_parse("plasma", &pattern) != 0);
+    TEST_ASSERT(strcmp(synthetic_pattern_name(SYNTHETIC_PATTERN_TEXT), "text") == 0);
+
+    synthetic_source_config_t config = { SYNTHETIC_PATTERN_BLOCKS, 0, 64, 30, 1 };
+    capture_source_t source;
+    TEST_ASSERT(synthetic_source_create(&source, &config) != 0);
+    capture_source_destroy(&source);
+    return 0;
+}
+
+static int test_synthetic_is_deterministic(void) {
+    const int width = 320, height = 200;
+    size_t size = (size_t)width * height * 4;
+    uint8_t* a = (uint8_t*)malloc(size);
+    uint8_t* b = (uint8_t*)malloc(size);
+    TEST_ASSERT(a != NULL && b != NULL);
+
+    for (int pattern = SYNTHETIC_PATTERN_BLOCKS; pattern <= SYNTHETIC_PATTERN_NOISE; pattern++) {
+        capture_source_t first, second;
+        frame_pool_t first_pool, second_pool;
+        TEST_ASSERT(create_synthetic(&first, &first_pool, (synthetic_pattern_t)pattern, width, height, 7) == 0);
+        TEST_ASSERT(create_synthetic(&second, &second_pool, (synthetic_pattern_t)pattern, width, height, 7) == 0);
+        TEST_ASSERT_EQ(width, first.width);
+        TEST_ASSERT_EQ(height, first.height);
+        TEST_ASSERT(strcmp(capture_source_name(&first), "synthetic") == 0);
+
+        for (int i = 0; i < 10; i++) {
+            int ra = next_frame(&first, &first_pool, a, 1);
+            int rb = next_frame(&second, &second_pool, b, 1);
+            TEST_ASSERT_EQ(ra, rb);
+            if (ra == CAPTURE_FRAME_NEW) TEST_ASSERT(memcmp(a, b, size) == 0);
+        }
+
+        capture_source_destroy(&first);
+        capture_source_destroy(&second);
+        frame_pool_cleanup(&first_pool);
+        frame_pool_cleanup(&second_pool);
+    }
+
+    free(a);
+    free(b);
+    return 0;
+}
+
+static int test_synthetic_orientation(void) {
+    const int width = 96, height = 64;
+    size_t size = (size_t)width * height * 4;
+    uint8_t* top = (uint8_t*)malloc(size);
+    uint8_t* bottom = (uint8_t*)malloc(size);
+    TEST_ASSERT(top != NULL && bottom != NULL);
+
+    capture_source_t a, b;
+    frame_pool_t pool_a, pool_b;
+    TEST_ASSERT(create_synthetic(&a, &pool_a, SYNTHETIC_PATTERN_BLOCKS, width, height, 3) == 0);
+    TEST_ASSERT(create_synthetic(&b, &pool_b, SYNTHETIC_PATTERN_BLOCKS, width, height, 3) == 0);
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&a, &pool_a, top, 1));
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&b, &pool_b, bottom, 0));
+    TEST_ASSERT(rows_flipped(top, bottom, width, height));
+
+    // Every pixel is opaque
+    for (size_t i = 3; i < size; i += 4) TEST_ASSERT_EQ(0xFF, top[i]);
+
+    capture_source_destroy(&a);
+    capture_source_destroy(&b);
+    frame_pool_cleanup(&pool_a);
+    frame_pool_cleanup(&pool_b);
+    free(top);
+    free(bottom);
+    return 0;
+}
+
+static int test_pattern_motion(void) {
+    const int width = 320, height = 240;
+    size_t size = (size_t)width * height * 4;
+    uint8_t* previous = (uint8_t*)malloc(size);
+    uint8_t* current = (uint8_t*)malloc(size);
+    TEST_ASSERT(previous != NULL && current != NULL);
+
+    // Blocks and noise change on every frame
+    for (int pattern = SYNTHETIC_PATTERN_BLOCKS; pattern <= SYNTHETIC_PATTERN_NOISE; pattern += 2) {
+        capture_source_t source;
+        frame_pool_t pool;
+        TEST_ASSERT(create_synthetic(&source, &pool, (synthetic_pattern_t)pattern, width, height, 1) == 0);
+        TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, previous, 1));
+        for (int i = 0; i < 5; i++) {
+            TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, current, 1));
+            TEST_ASSERT(memcmp(previous, current, size) != 0);
+            memcpy(previous, current, size);
+        }
+        TEST_ASSERT_EQ(6, (int)source.frames_delivered);
+        capture_source_destroy(&source);
+        frame_pool_cleanup(&pool);
+    }
+
+    // Text scrolls in whole-line steps and repeats in between
+    capture_source_t text;
+    frame_pool_t pool;
+    TEST_ASSERT(create_synthetic(&text, &pool, SYNTHETIC_PATTERN_TEXT, width, height, 1) == 0);
+    int fresh = 0, repeats = 0;
+    for (int i = 0; i < 30; i++) {
+        int result = next_frame(&text, &pool, current, 1);
+        if (result == CAPTURE_FRAME_NEW) {
+            if (fresh > 0) TEST_ASSERT(memcmp(previous, current, size) != 0);
+            memcpy(previous, current, size);
+            fresh++;
+        } else {
+            TEST_ASSERT_EQ(CAPTURE_FRAME_REPEAT, result);
+            repeats++;
+        }
+    }
+    TEST_ASSERT(fresh >= 4 && fresh <= 5);    // 4 lines per second at 30 fps
+    TEST_ASSERT_EQ(30, fresh + repeats);
+    capture_source_destroy(&text);
+    frame_pool_cleanup(&pool);
+
+    free(previous);
+    free(current);
+    return 0;
+}
+
+static int test_pool_exhaustion_and_size_check(void) {
+    const int width = 64, height = 32;
+    synthetic_source_config_t config = { SYNTHETIC_PATTERN_NOISE, width, height, 30, 1 };
+    capture_source_t source;
+    TEST_ASSERT(synthetic_source_create(&source, &config) == 0);
+
+    frame_pool_t small;
+    TEST_ASSERT(frame_pool_init(&small, (size_t)width * height * 4 - 4, 2) == 0);
+    TEST_ASSERT(capture_source_set_pool(&source, &small) != 0);
+    frame_pool_cleanup(&small);
+
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, (size_t)width * height * 4, 2) == 0);
+    TEST_ASSERT(capture_source_set_pool(&source, &pool) == 0);
+
+    frame_handle_t held[2];
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, capture_source_get_frame(&source, &held[0], 1));
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, capture_source_get_frame(&source, &held[1], 1));
+    frame_handle_t extra = FRAME_HANDLE_INVALID;
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NONE, capture_source_get_frame(&source, &extra, 1));
+    TEST_ASSERT_EQ(2, (int)source.frames_delivered);
+
+    frame_pool_release(&pool, held[0]);
+    frame_pool_release(&pool, held[1]);
+    capture_source_destroy(&source);
+    frame_pool_cleanup(&pool);
+
+    // A destroyed source is inert
+    TEST_ASSERT(capture_source_get_frame(&source, &extra, 1) < 0);
+    return 0;
+}
+
+static int write_replay_file(int width, int height, int frames, uint8_t** contents) {
+    size_t size = (size_t)width * height * 4;
+    replay_writer_t writer;
+    if (replay_writer_open(&writer, REPLAY_TEST_FILE, width, height, 25) != 0) return -1;
+
+    uint8_t* data = (uint8_t*)malloc(size * frames);
+    if (!data) return -1;
+    for (size_t i = 0; i < size * frames; i++) data[i] = (uint8_t)(i * 7 + i / size);
+    for (int f = 0; f < frames; f++) {
+        if (replay_writer_append(&writer, data + size * f, (size_t)width * 4) != 0) return -1;
+    }
+    if (writer.frames != (uint64_t)frames) return -1;
+    if (replay_writer_close(&writer) != 0) return -1;
+    *contents = data;
+    return 0;
+}
+
+static int test_replay_round_trip(void) {
+    const int width = 40, height = 24, frames = 3;
+    size_t size = (size_t)width * height * 4;
+    uint8_t* contents = NULL;
+    TEST_ASSERT(write_replay_file(width, height, frames, &contents) == 0);
+    uint8_t* frame = (uint8_t*)malloc(size);
+    TEST_ASSERT(frame != NULL);
+
+    // Single pass: every frame once, then finished
+    capture_source_t source;
+    frame_pool_t pool;
+    TEST_ASSERT(replay_source_create(&source, REPLAY_TEST_FILE, 0) == 0);
+    TEST_ASSERT_EQ(width, source.width);
+    TEST_ASSERT_EQ(height, source.height);
+    TEST_ASSERT_EQ(25, source.fps);
+    TEST_ASSERT(frame_pool_init(&pool, size, 2) == 0);
+    TEST_ASSERT(capture_source_set_pool(&source, &pool) == 0);
+    for (int f = 0; f < frames; f++) {
+        TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, frame, f != 1));
+        if (f != 1) {
+            TEST_ASSERT(memcmp(frame, contents + size * f, size) == 0);
+        } else {
+            TEST_ASSERT(rows_flipped(frame, contents + size * f, width, height));
+        }
+    }
+    TEST_ASSERT(!source.finished);
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NONE, next_frame(&source, &pool, frame, 1));
+    TEST_ASSERT(source.finished);
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NONE, next_frame(&source, &pool, frame, 1));
+    capture_source_destroy(&source);
+
+    // Looped: wraps back to the first frame
+    TEST_ASSERT(replay_source_create(&source, REPLAY_TEST_FILE, 1) == 0);
+    TEST_ASSERT(capture_source_set_pool(&source, &pool) == 0);
+    for (int f = 0; f < frames * 3; f++) {
+        TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, frame, 1));
+        TEST_ASSERT(memcmp(frame, contents + size * (f % frames), size) == 0);
+    }
+    TEST_ASSERT(!source.finished);
+    capture_source_destroy(&source);
+
+    frame_pool_cleanup(&pool);
+    free(frame);
+    free(contents);
+    remove(REPLAY_TEST_FILE);
+    return 0;
+}
+
+static int test_replay_rejects_bad_files(void) {
+    const int width = 16, height = 8;
+    size_t size = (size_t)width * height * 4;
+    capture_source_t source;
+    TEST_ASSERT(replay_source_create(&source, "does_not_exist.raw", 0) != 0);
+
+    // Wrong magic
+    FILE* file = fopen(REPLAY_TEST_FILE, "wb");
+    TEST_ASSERT(file != NULL);
+    uint8_t header[REPLAY_FILE_HEADER_SIZE] = "NOTARAWFILE";
+    fwrite(header, 1, sizeof(header), file);
+    fclose(file);
+    TEST_ASSERT(replay_source_create(&source, REPLAY_TEST_FILE, 0) != 0);
+
+    // A truncated last frame ends the replay after the whole frames
+    uint8_t* contents = NULL;
+    TEST_ASSERT(write_replay_file(width, height, 2, &contents) == 0);
+    file = fopen(REPLAY_TEST_FILE, "ab");
+    TEST_ASSERT(file != NULL);
+    fwrite(contents, 1, size / 2, file);
+    fclose(file);
+
+    frame_pool_t pool;
+    uint8_t* frame = (uint8_t*)malloc(size);
+    TEST_ASSERT(frame != NULL);
+    TEST_ASSERT(frame_pool_init(&pool, size, 2) == 0);
+    TEST_ASSERT(replay_source_create(&source, REPLAY_TEST_FILE, 0) == 0);
+    TEST_ASSERT(capture_source_set_pool(&source, &pool) == 0);
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, frame, 1));
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, next_frame(&source, &pool, frame, 1));
+    TEST_ASSERT_EQ(CAPTURE_FRAME_NONE, next_frame(&source, &pool, frame, 1));
+    TEST_ASSERT(source.finished);
+
+    frame_pool_stats_t stats;
+    frame_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(0, (int)stats.in_use);                   // The frame of the failed read went back
+    capture_source_destroy(&source);
+
+    frame_pool_cleanup(&pool);
+    free(frame);
+    free(contents);
+    remove(REPLAY_TEST_FILE);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_pattern_names);
+    RUN_TEST(test_synthetic_is_deterministic);
+    RUN_TEST(test_synthetic_orientation);
+    RUN_TEST(test_pattern_motion);
+    RUN_TEST(test_pool_exhaustion_and_size_check);
+    RUN_TEST(test_replay_round_trip);
+    RUN_TEST(test_replay_rejects_bad_files);
+
+    return failures == 0 ? 0 : 1;
+}
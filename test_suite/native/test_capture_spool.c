@@ -0,0 +1,320 @@
+#include "test_common.h"
+#include "capture_spool.h"
+#include "synthetic_source.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPOOL_TEST_FILE "test_capture_spool.spool"
+
+static int create_synthetic(capture_source_t* source, frame_pool_t* pool, synthetic_pattern_t pattern,
+                            int width, int height) {
+    synthetic_source_config_t config = { pattern, width, height, 30, 3 };
+    if (synthetic_source_create(source, &config) != 0) return -1;
+    if (frame_pool_init(pool, (size_t)width * height * 4, 4) != 0) return -1;
+    if (capture_source_set_pool(source, pool) != 0) return -1;
+    return capture_source_start(source);
+}
+
+static void destroy_synthetic(capture_source_t* source, frame_pool_t* pool) {
+    capture_source_destroy(source);
+    frame_pool_cleanup(pool);
+}
+
+static void fill_noise(uint8_t* pixels, size_t size, uint32_t seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        pixels[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+static long file_size(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Synthetic frames, repeats included, come back pixel for pixel with their
+// capture times; the frame size is not a multiple of the tile size
+static int test_round_trip(void) {
+    const int width = 200, height = 136;
+    size_t frame_size = (size_t)width * height * 4;
+    uint8_t* frames = (uint8_t*)malloc(frame_size * 60);
+    uint8_t* out = (uint8_t*)malloc(frame_size);
+    TEST_ASSERT(frames != NULL && out != NULL);
+
+    for (int pattern = SYNTHETIC_PATTERN_BLOCKS; pattern <= SYNTHETIC_PATTERN_TEXT; pattern++) {
+        capture_source_t source;
+        frame_pool_t pool;
+        TEST_ASSERT(create_synthetic(&source, &pool, (synthetic_pattern_t)pattern, width, height) == 0);
+        capture_spool_writer_t writer;
+        TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, width, height, 30) == 0);
+
+        int repeats = 0;
+        for (int i = 0; i < 60; i++) {
+            frame_handle_t frame = FRAME_HANDLE_INVALID;
+            int result = capture_source_get_frame(&source, &frame, 1);
+            int64_t time = (int64_t)i * 333333;
+            if (result == CAPTURE_FRAME_NEW) {
+                memcpy(frames + frame_size * i, frame_pool_data(&pool, frame), frame_size);
+                frame_pool_release(&pool, frame);
+                TEST_ASSERT(capture_spool_writer_append(&writer, frames + frame_size * i, (size_t)width * 4, time) == 0);
+            } else {
+                TEST_ASSERT(i > 0);
+                memcpy(frames + frame_size * i, frames + frame_size * (i - 1), frame_size);
+                TEST_ASSERT(capture_spool_writer_repeat(&writer, time) == 0);
+                repeats++;
+            }
+        }
+        TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+        TEST_ASSERT_EQ(60, writer.stats.frames);
+        TEST_ASSERT(writer.stats.repeats >= (uint64_t)repeats);
+        TEST_ASSERT_EQ(writer.stats.bytes, file_size(SPOOL_TEST_FILE));
+        destroy_synthetic(&source, &pool);
+
+        capture_spool_reader_t reader;
+        TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) == 0);
+        TEST_ASSERT_EQ(width, reader.width);
+        TEST_ASSERT_EQ(height, reader.height);
+        TEST_ASSERT_EQ(30, reader.fps);
+        TEST_ASSERT(reader.complete);
+        TEST_ASSERT(capture_spool_reader_compose(&reader, out, (size_t)width * 4) != 0);
+        for (int i = 0; i < 60; i++) {
+            capture_spool_frame_t info;
+            // Every other frame moved to first and rebuilt afterwards
+            if (i % 2) {
+                memset(out, 0, frame_size);
+                TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, NULL, 0, &info));
+                TEST_ASSERT(capture_spool_reader_compose(&reader, out, (size_t)width * 4) == 0);
+            } else {
+                TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, (size_t)width * 4, &info));
+            }
+            TEST_ASSERT_EQ((int64_t)i * 333333, info.time);
+            TEST_ASSERT(memcmp(out, frames + frame_size * i, frame_size) == 0);
+            if (i > 0 && memcmp(frames + frame_size * i, frames + frame_size * (i - 1), frame_size) == 0) {
+                TEST_ASSERT_EQ(0, info.changed_tiles);
+            }
+        }
+        TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, out, (size_t)width * 4, NULL));
+        TEST_ASSERT_EQ(writer.stats.tiles_stored, reader.tile_count);
+        capture_spool_reader_close(&reader);
+        remove(SPOOL_TEST_FILE);
+    }
+    free(frames);
+    free(out);
+    return 0;
+}
+
+// Unchanged frames cost a frame record, identical tiles are stored once
+static int test_static_desktop(void) {
+    const int width = 1280, height = 720;
+    size_t pitch = (size_t)width * 4;
+    uint8_t* pixels = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(pixels != NULL);
+    for (size_t i = 0; i < pitch * height; i += 4) {
+        pixels[i] = 0x30;
+        pixels[i + 1] = 0x60;
+        pixels[i + 2] = 0x90;
+        pixels[i + 3] = 0xFF;
+    }
+    // One distinct window in the middle
+    fill_noise(pixels + 300 * pitch + 640 * 4, 256, 9);
+
+    capture_spool_writer_t writer;
+    TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, width, height, 60) == 0);
+    TEST_ASSERT(capture_spool_writer_append(&writer, pixels, pitch, 0) == 0);
+    // Solid tiles: the full size one and the short bottom row's; plus the one with noise
+    TEST_ASSERT_EQ(3, writer.stats.tiles_stored);
+    uint64_t first = writer.stats.bytes;
+    TEST_ASSERT(first < 64 * 1024);
+
+    for (int i = 1; i <= 600; i++) {
+        TEST_ASSERT(capture_spool_writer_append(&writer, pixels, pitch, (int64_t)i * 166667) == 0);
+    }
+    TEST_ASSERT_EQ(3, writer.stats.tiles_stored);
+    TEST_ASSERT_EQ(600, writer.stats.repeats);
+    TEST_ASSERT_EQ(first + 600 * 24, writer.stats.bytes);
+    TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+    // 10 s of 720p in well under 1/1000 of the raw size
+    TEST_ASSERT(writer.stats.bytes * 1000 < writer.stats.raw_bytes);
+    remove(SPOOL_TEST_FILE);
+    free(pixels);
+    return 0;
+}
+
+// Content moved by whole tiles is referenced, not stored again
+static int test_moved_content(void) {
+    const int width = 512, height = 256;
+    size_t pitch = (size_t)width * 4;
+    uint8_t* a = (uint8_t*)malloc(pitch * height);
+    uint8_t* b = (uint8_t*)malloc(pitch * height);
+    uint8_t* out = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(a != NULL && b != NULL && out != NULL);
+    fill_noise(a, pitch * height, 1);
+    fill_noise(b, pitch * height, 2);
+    for (int y = 0; y < height; y++) memcpy(b + y * pitch + 64 * 4, a + y * pitch, pitch - 64 * 4);
+
+    capture_spool_writer_t writer;
+    TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, width, height, 0) == 0);
+    TEST_ASSERT(capture_spool_writer_append(&writer, a, pitch, 0) == 0);
+    TEST_ASSERT_EQ(32, writer.stats.tiles_stored);
+    TEST_ASSERT(capture_spool_writer_append(&writer, b, pitch, 1) == 0);
+    // Only the new left column is stored; every position changed
+    TEST_ASSERT_EQ(36, writer.stats.tiles_stored);
+    TEST_ASSERT_EQ(28, writer.stats.tiles_reused);
+    TEST_ASSERT_EQ(64, writer.stats.tile_refs);
+    TEST_ASSERT(capture_spool_writer_append(&writer, a, pitch, 2) == 0);
+    TEST_ASSERT_EQ(36, writer.stats.tiles_stored);
+    TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+
+    capture_spool_reader_t reader;
+    capture_spool_frame_t info;
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) == 0);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT(memcmp(out, a, pitch * height) == 0);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT(memcmp(out, b, pitch * height) == 0);
+    TEST_ASSERT_EQ(32, info.changed_tiles);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT(memcmp(out, a, pitch * height) == 0);
+    capture_spool_reader_close(&reader);
+    remove(SPOOL_TEST_FILE);
+    free(a);
+    free(b);
+    free(out);
+    return 0;
+}
+
+// A reader follows the spool while it is written, across the file growing
+static int test_follow_writer(void) {
+    const int width = 640, height = 480;
+    size_t pitch = (size_t)width * 4;
+    uint8_t* pixels = (uint8_t*)malloc(pitch * height);
+    uint8_t* out = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(pixels != NULL && out != NULL);
+
+    capture_spool_writer_t writer;
+    TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, width, height, 30) == 0);
+    fill_noise(pixels, pitch * height, 100);
+    TEST_ASSERT(capture_spool_writer_append(&writer, pixels, pitch, 0) == 0);
+
+    capture_spool_reader_t reader;
+    capture_spool_frame_t info;
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) == 0);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT(!reader.complete);
+
+    // Every frame new: 1.2 MB each, past the initial mapping
+    for (int i = 1; i <= 40; i++) {
+        fill_noise(pixels, pitch * height, 100 + (uint32_t)i);
+        TEST_ASSERT(capture_spool_writer_append(&writer, pixels, pitch, i) == 0);
+        if (i % 3 == 0) {
+            for (int j = i - 2; j <= i; j++) {
+                TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+                TEST_ASSERT_EQ(j, info.time);
+            }
+            TEST_ASSERT(memcmp(out, pixels, pitch * height) == 0);
+            TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, out, pitch, &info));
+        }
+    }
+    TEST_ASSERT(writer.stats.remaps > 0);
+    TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT_EQ(40, info.time);
+    TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, out, pitch, &info));
+    TEST_ASSERT(reader.complete);
+    capture_spool_reader_close(&reader);
+    remove(SPOOL_TEST_FILE);
+    free(pixels);
+    free(out);
+    return 0;
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t size) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return -1;
+    size_t written = fwrite(data, 1, size, file);
+    fclose(file);
+    return written == size ? 0 : -1;
+}
+
+// Damaged files are refused, never read past
+static int test_damaged(void) {
+    const int width = 128, height = 128;
+    size_t pitch = (size_t)width * 4;
+    uint8_t pixels[128 * 128 * 4];
+    fill_noise(pixels, sizeof(pixels), 5);
+    capture_spool_writer_t writer;
+    TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, width, height, 30) == 0);
+    TEST_ASSERT(capture_spool_writer_repeat(&writer, 0) != 0);
+    TEST_ASSERT(capture_spool_writer_append(&writer, pixels, pitch, 0) == 0);
+    TEST_ASSERT(capture_spool_writer_repeat(&writer, 1) == 0);
+    TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+
+    static uint8_t data[128 * 1024];
+    FILE* file = fopen(SPOOL_TEST_FILE, "rb");
+    TEST_ASSERT(file != NULL);
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    TEST_ASSERT_EQ(writer.stats.bytes, size);
+
+    static uint8_t damaged[128 * 1024];
+    capture_spool_reader_t reader;
+    uint8_t out[128 * 128 * 4];
+
+    // Not a spool, and a header counting past the end
+    memcpy(damaged, data, size);
+    damaged[0] = 'X';
+    TEST_ASSERT(write_file(SPOOL_TEST_FILE, damaged, size) == 0);
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) != 0);
+    memcpy(damaged, data, size);
+    damaged[32] = 0xFF;
+    damaged[33] = 0xFF;
+    damaged[34] = 0xFF;
+    TEST_ASSERT(write_file(SPOOL_TEST_FILE, damaged, size) == 0);
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) != 0);
+
+    // The last frame record refers to tile 4 of 4
+    memcpy(damaged, data, size);
+    size_t first_frame = size - 24 - 24 - 4 * 8;
+    TEST_ASSERT_EQ(CAPTURE_SPOOL_RECORD_FRAME, damaged[first_frame]);
+    damaged[first_frame + 24 + 4] = 4;
+    TEST_ASSERT(write_file(SPOOL_TEST_FILE, damaged, size) == 0);
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) == 0);
+    TEST_ASSERT_EQ(-1, capture_spool_reader_next(&reader, out, pitch, NULL));
+    capture_spool_reader_close(&reader);
+
+    // Cut short of its committed length, as after a crash: frames up to the count still read
+    memcpy(damaged, data, size);
+    damaged[28] = 0;
+    for (int i = 0; i < 8; i++) damaged[32 + i] = (uint8_t)((uint64_t)(size - 24) >> (i * 8));
+    TEST_ASSERT(write_file(SPOOL_TEST_FILE, damaged, size - 24) == 0);
+    TEST_ASSERT(capture_spool_reader_open(&reader, SPOOL_TEST_FILE) == 0);
+    TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, out, pitch, NULL));
+    TEST_ASSERT(memcmp(out, pixels, sizeof(out)) == 0);
+    TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, out, pitch, NULL));
+    TEST_ASSERT(!reader.complete);
+    capture_spool_reader_close(&reader);
+    remove(SPOOL_TEST_FILE);
+
+    TEST_ASSERT(capture_spool_writer_open(&writer, SPOOL_TEST_FILE, 0, 100, 30) != 0);
+    TEST_ASSERT(capture_spool_reader_open(&reader, "missing.spool") != 0);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_static_desktop);
+    RUN_TEST(test_moved_content);
+    RUN_TEST(test_follow_writer);
+    RUN_TEST(test_damaged);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+#include "test_common.h"
+#include "color_convert.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void fill_color(uint8_t* data, int width, int height, uint8_t b, uint8_t g, uint8_t r) {
+    for (int i = 0; i < width * height; i++) {
+        data[i * 4 + 0] = b;
+        data[i * 4 + 1] = g;
+        data[i * 4 + 2] = r;
+        data[i * 4 + 3] = 255;
+    }
+}
+
+// Floating-point reference straight from the matrix definitions
+static void reference_yuv(color_matrix_t matrix, color_range_t range, double b, double g, double r,
+                          double* y, double* u, double* v) {
+    double kr = matrix == COLOR_MATRIX_BT709 ? 0.2126 : 0.299;
+    double kb = matrix == COLOR_MATRIX_BT709 ? 0.0722 : 0.114;
+    double luma = kr * r + (1.0 - kr - kb) * g + kb * b;
+    double y_scale = range == COLOR_RANGE_LIMITED ? 219.0 / 255.0 : 1.0;
+    double c_scale = range == COLOR_RANGE_LIMITED ? 224.0 / 255.0 : 1.0;
+    *y = (range == COLOR_RANGE_LIMITED ? 16.0 : 0.0) + y_scale * luma;
+    *u = 128.0 + c_scale * (b - luma) / (2.0 * (1.0 - kb));
+    *v = 128.0 + c_scale * (r - luma) / (2.0 * (1.0 - kr));
+}
+
+static int convert(const color_converter_t* converter, color_format_t format, const uint8_t* src,
+                   int width, int height, uint8_t* buffer) {
+    color_planes_t planes;
+    if (color_planes_for_buffer(format, buffer, width, height, &planes) != 0) return -1;
+    return color_convert_frame(converter, format, &planes, src, (size_t)width * 4, width, height);
+}
+
+static int test_known_colors(void) {
+    uint8_t src[4 * 4 * 4];
+    uint8_t out[4 * 4 + 2 * 2 * 2];
+    color_converter_t converter;
+
+    TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) == 0);
+    fill_color(src, 4, 4, 255, 255, 255);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, 4, 4, out) == 0);
+    TEST_ASSERT_EQ(235, out[0]);
+    TEST_ASSERT_EQ(128, out[16]);
+    TEST_ASSERT_EQ(128, out[17]);
+
+    fill_color(src, 4, 4, 0, 0, 0);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, 4, 4, out) == 0);
+    TEST_ASSERT_EQ(16, out[0]);
+    TEST_ASSERT_EQ(128, out[16]);
+
+    // Pure red: Y 63, Cb 102, Cr 240 in BT.709 limited range
+    fill_color(src, 4, 4, 0, 0, 255);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, 4, 4, out) == 0);
+    TEST_ASSERT_EQ(63, out[0]);
+    TEST_ASSERT_EQ(102, out[16]);
+    TEST_ASSERT_EQ(240, out[17]);
+
+    // Full range spans 0-255 and greys stay neutral
+    TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT601, COLOR_RANGE_FULL) == 0);
+    fill_color(src, 4, 4, 255, 255, 255);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, 4, 4, out) == 0);
+    TEST_ASSERT_EQ(255, out[0]);
+    for (int grey = 0; grey < 256; grey += 17) {
+        fill_color(src, 4, 4, (uint8_t)grey, (uint8_t)grey, (uint8_t)grey);
+        TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, 4, 4, out) == 0);
+        TEST_ASSERT_EQ(grey, out[5]);
+        TEST_ASSERT_EQ(128, out[16]);
+        TEST_ASSERT_EQ(128, out[19]);
+    }
+    return 0;
+}
+
+static int check_reference(color_matrix_t matrix, color_range_t range, copy_kernel_level_t level) {
+    const int width = 70, height = 18;      // Not a multiple of any SIMD block
+    uint8_t* src = (uint8_t*)malloc((size_t)width * height * 4);
+    uint8_t* out = (uint8_t*)malloc(color_frame_size(COLOR_FORMAT_I420, width, height));
+    TEST_ASSERT(src != NULL && out != NULL);
+    fill_random(src, (size_t)width * height * 4, (unsigned)(matrix * 7 + range * 3 + level));
+
+    color_converter_t converter;
+    TEST_ASSERT(color_converter_init(&converter, matrix, range) == 0);
+    TEST_ASSERT(color_converter_set_level(&converter, level) == 0);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_I420, src, width, height, out) == 0);
+
+    const uint8_t* y_plane = out;
+    const uint8_t* u_plane = out + width * height;
+    const uint8_t* v_plane = u_plane + (width / 2) * (height / 2);
+    double worst = 0.0;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const uint8_t* p = src + ((size_t)y * width + x) * 4;
+            double ry, ru, rv;
+            reference_yuv(matrix, range, p[0], p[1], p[2], &ry, &ru, &rv);
+            worst = fmax(worst, fabs(y_plane[y * width + x] - ry));
+        }
+    }
+    for (int y = 0; y < height / 2; y++) {
+        for (int x = 0; x < width / 2; x++) {
+            double b = 0, g = 0, r = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    const uint8_t* p = src + ((size_t)(2 * y + dy) * width + 2 * x + dx) * 4;
+                    b += p[0] / 4.0;
+                    g += p[1] / 4.0;
+                    r += p[2] / 4.0;
+                }
+            }
+            double ry, ru, rv;
+            reference_yuv(matrix, range, b, g, r, &ry, &ru, &rv);
+            worst = fmax(worst, fabs(u_plane[y * (width / 2) + x] - ru));
+            worst = fmax(worst, fabs(v_plane[y * (width / 2) + x] - rv));
+        }
+    }
+
+    if (worst > 1.0) {
+        fprintf(stderr, "  %s %s level %d: max error %.2f\n", color_matrix_name(matrix), color_range_name(range),
+                (int)level, worst);
+    }
+    TEST_ASSERT(worst <= 1.0);
+
+    free(src);
+    free(out);
+    return 0;
+}
+
+static int test_matches_reference(void) {
+    for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+        if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+        for (int matrix = COLOR_MATRIX_BT601; matrix <= COLOR_MATRIX_BT709; matrix++) {
+            for (int range = COLOR_RANGE_LIMITED; range <= COLOR_RANGE_FULL; range++) {
+                TEST_ASSERT(check_reference((color_matrix_t)matrix, (color_range_t)range, (copy_kernel_level_t)level) == 0);
+            }
+        }
+    }
+    return 0;
+}
+
+static int test_simd_levels_are_bit_exact(void) {
+    const int widths[] = { 2, 8, 14, 16, 18, 34, 1920 };
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        int width = widths[w], height = 6;
+        size_t size = color_frame_size(COLOR_FORMAT_NV12, width, height);
+        uint8_t* src = (uint8_t*)malloc((size_t)width * height * 4);
+        uint8_t* expected = (uint8_t*)malloc(size);
+        uint8_t* actual = (uint8_t*)malloc(size);
+        TEST_ASSERT(src != NULL && expected != NULL && actual != NULL);
+        fill_random(src, (size_t)width * height * 4, (unsigned)w + 1);
+
+        for (int format = COLOR_FORMAT_NV12; format <= COLOR_FORMAT_I420; format++) {
+            color_converter_t converter;
+            TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) == 0);
+            TEST_ASSERT(color_converter_set_level(&converter, COPY_KERNEL_SCALAR) == 0);
+            TEST_ASSERT(convert(&converter, (color_format_t)format, src, width, height, expected) == 0);
+
+            for (int level = COPY_KERNEL_SSE2; level < COPY_KERNEL_COUNT; level++) {
+                if (color_converter_set_level(&converter, (copy_kernel_level_t)level) != 0) continue;
+                memset(actual, 0xCD, size);
+                TEST_ASSERT(convert(&converter, (color_format_t)format, src, width, height, actual) == 0);
+                TEST_ASSERT(memcmp(expected, actual, size) == 0);
+            }
+        }
+
+        free(src);
+        free(expected);
+        free(actual);
+    }
+    return 0;
+}
+
+static int test_nv12_and_i420_agree(void) {
+    const int width = 64, height = 32;
+    uint8_t* src = (uint8_t*)malloc((size_t)width * height * 4);
+    uint8_t* nv12 = (uint8_t*)malloc(color_frame_size(COLOR_FORMAT_NV12, width, height));
+    uint8_t* i420 = (uint8_t*)malloc(color_frame_size(COLOR_FORMAT_I420, width, height));
+    TEST_ASSERT(src != NULL && nv12 != NULL && i420 != NULL);
+    fill_random(src, (size_t)width * height * 4, 5);
+
+    color_converter_t converter;
+    TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT601, COLOR_RANGE_LIMITED) == 0);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, width, height, nv12) == 0);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_I420, src, width, height, i420) == 0);
+
+    TEST_ASSERT(memcmp(nv12, i420, (size_t)width * height) == 0);
+    const uint8_t* uv = nv12 + width * height;
+    const uint8_t* u = i420 + width * height;
+    const uint8_t* v = u + (width / 2) * (height / 2);
+    for (int i = 0; i < (width / 2) * (height / 2); i++) {
+        TEST_ASSERT_EQ(u[i], uv[i * 2]);
+        TEST_ASSERT_EQ(v[i], uv[i * 2 + 1]);
+    }
+
+    free(src);
+    free(nv12);
+    free(i420);
+    return 0;
+}
+
+static int test_row_ranges_and_validation(void) {
+    const int width = 32, height = 16;
+    size_t size = color_frame_size(COLOR_FORMAT_NV12, width, height);
+    TEST_ASSERT_EQ((size_t)width * height * 3 / 2, size);
+
+    uint8_t* src = (uint8_t*)malloc((size_t)width * height * 4);
+    uint8_t* whole = (uint8_t*)malloc(size);
+    uint8_t* sliced = (uint8_t*)malloc(size);
+    TEST_ASSERT(src != NULL && whole != NULL && sliced != NULL);
+    fill_random(src, (size_t)width * height * 4, 11);
+
+    color_converter_t converter;
+    TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_FULL) == 0);
+    TEST_ASSERT(convert(&converter, COLOR_FORMAT_NV12, src, width, height, whole) == 0);
+
+    // Slices converted independently produce the same frame
+    color_planes_t planes;
+    TEST_ASSERT(color_planes_for_buffer(COLOR_FORMAT_NV12, sliced, width, height, &planes) == 0);
+    TEST_ASSERT(color_convert_rows(&converter, COLOR_FORMAT_NV12, &planes, src, width * 4, width, 0, 6) == 0);
+    TEST_ASSERT(color_convert_rows(&converter, COLOR_FORMAT_NV12, &planes, src, width * 4, width, 6, 16) == 0);
+    TEST_ASSERT(memcmp(whole, sliced, size) == 0);
+
+    // 4:2:0 needs even dimensions and even slice boundaries
+    TEST_ASSERT(color_convert_rows(&converter, COLOR_FORMAT_NV12, &planes, src, width * 4, width, 1, 4) != 0);
+    TEST_ASSERT(color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, src, width * 4, width - 1, height) != 0);
+    TEST_ASSERT(color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, src, width * 4, width, height - 1) != 0);
+    TEST_ASSERT(color_planes_for_buffer(COLOR_FORMAT_I420, sliced, 7, 4, &planes) != 0);
+
+    free(src);
+    free(whole);
+    free(sliced);
+    return 0;
+}
+
+static int test_pool_matches_single_thread(void) {
+    const int width = 320, height = 198;       // Row pairs that do not split evenly
+    size_t size = color_frame_size(COLOR_FORMAT_I420, width, height);
+    uint8_t* src = (uint8_t*)malloc((size_t)width * height * 4);
+    uint8_t* single = (uint8_t*)malloc(size);
+    uint8_t* parallel = (uint8_t*)malloc(size);
+    TEST_ASSERT(src != NULL && single != NULL && parallel != NULL);
+    fill_random(src, (size_t)width * height * 4, 17);
+
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(&pool, 3) == 0);
+
+    for (int format = COLOR_FORMAT_NV12; format <= COLOR_FORMAT_I420; format++) {
+        color_converter_t converter;
+        TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) == 0);
+        TEST_ASSERT(convert(&converter, (color_format_t)format, src, width, height, single) == 0);
+
+        color_converter_set_pool(&converter, &pool);
+        for (int run = 0; run < 8; run++) {
+            memset(parallel, 0, size);
+            TEST_ASSERT(convert(&converter, (color_format_t)format, src, width, height, parallel) == 0);
+            TEST_ASSERT(memcmp(single, parallel, size) == 0);
+        }
+    }
+
+    worker_pool_cleanup(&pool);
+    free(src);
+    free(single);
+    free(parallel);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_known_colors);
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_simd_levels_are_bit_exact);
+    RUN_TEST(test_nv12_and_i420_agree);
+    RUN_TEST(test_row_ranges_and_validation);
+    RUN_TEST(test_pool_matches_single_thread);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Minimal assertion helpers for the native C unit tests (no framework dependency)
+
+#define TEST_ASSERT(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #cond); \
+        return 1; \
+    } \
+} while (0)
+
+#define TEST_ASSERT_EQ(expected, actual) do { \
+    long long test_expected_ = (long long)(expected); \
+    long long test_actual_ = (long long)(actual); \
+    if (test_expected_ != test_actual_) { \
+        fprintf(stderr, "%s:%d: expected %s == %lld, got %lld\n", __FILE__, __LINE__, #actual, test_expected_, test_actual_); \
+        return 1; \
+    } \
+} while (0)
+
+#define RUN_TEST(fn) do { \
+    if (fn() != 0) { \
+        fprintf(stderr, "[FAIL] %s\n", #fn); \
+        failures++; \
+    } else { \
+        printf("[PASS] %s\n", #fn); \
+    } \
+} while (0)
+
+// Deterministic test pattern: the same seed always gives the same bytes
+static inline void fill_random(uint8_t* data, size_t size, unsigned seed) {
+    for (size_t i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+#endif // TEST_COMMON_H
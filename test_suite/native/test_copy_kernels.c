@@ -0,0 +1,154 @@
+#include "test_common.h"
+#include "copy_kernels.h"
+#include "platform.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GUARD_BYTE 0xCD
+#define FIRST_USE_THREADS 4
+
+// Reference copy, plus a check that nothing outside the rows was written
+static int check_plane(const uint8_t* dst, size_t dst_pitch, size_t dst_size, const uint8_t* src, size_t src_pitch,
+                       size_t row_bytes, int rows, int flip_vertical) {
+    for (int y = 0; y < rows; y++) {
+        int dst_row = flip_vertical ? rows - 1 - y : y;
+        const uint8_t* d = dst + (size_t)dst_row * dst_pitch;
+        if (memcmp(d, src + (size_t)y * src_pitch, row_bytes) != 0) return 0;
+        for (size_t x = row_bytes; x < dst_pitch && (size_t)dst_row * dst_pitch + x < dst_size; x++) {
+            if (d[x] != GUARD_BYTE) return 0;
+        }
+    }
+    return 1;
+}
+
+static int run_level(copy_kernel_level_t level) {
+    // Odd widths and offsets exercise the unaligned heads and sub-vector tails
+    const size_t row_sizes[] = { 1, 3, 15, 16, 17, 63, 64, 65, 127, 255, 256, 257, 1023, 7680 };
+    const int offsets[] = { 0, 1, 7, 33 };
+
+    for (size_t r = 0; r < sizeof(row_sizes) / sizeof(row_sizes[0]); r++) {
+        for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+            for (int flip = 0; flip <= 1; flip++) {
+                size_t row_bytes = row_sizes[r];
+                int rows = 9;
+                size_t src_pitch = row_bytes + (size_t)offsets[o] * 3;
+                size_t dst_pitch = flip ? row_bytes + 64 : row_bytes;
+                size_t src_size = src_pitch * rows + 64;
+                size_t dst_size = dst_pitch * rows + 64;
+
+                uint8_t* src = (uint8_t*)malloc(src_size);
+                uint8_t* dst = (uint8_t*)malloc(dst_size);
+                TEST_ASSERT(src != NULL && dst != NULL);
+                fill_random(src, src_size, (unsigned)(r * 31 + o));
+                memset(dst, GUARD_BYTE, dst_size);
+
+                uint8_t* d = dst + offsets[o];
+                const uint8_t* s = src + offsets[(o + 1) % 4];
+                TEST_ASSERT(copy_plane_with(level, d, dst_pitch, s, src_pitch, row_bytes, rows, flip) == 0);
+                TEST_ASSERT(check_plane(d, dst_pitch, dst_size - offsets[o], s, src_pitch, row_bytes, rows, flip));
+                for (int i = 0; i < offsets[o]; i++) TEST_ASSERT_EQ(GUARD_BYTE, dst[i]);
+
+                free(src);
+                free(dst);
+            }
+        }
+    }
+    return 0;
+}
+
+static int test_scalar_always_supported(void) {
+    TEST_ASSERT(copy_kernels_supported(COPY_KERNEL_SCALAR));
+    TEST_ASSERT(copy_kernels_supported(copy_kernels_best_level()));
+    TEST_ASSERT(!copy_kernels_supported(COPY_KERNEL_COUNT));
+    TEST_ASSERT(copy_kernels_nt_threshold() > 0);
+    return 0;
+}
+
+static int test_every_level_matches_reference(void) {
+    for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+        if (!copy_kernels_supported((copy_kernel_level_t)level)) {
+            printf("  %s not supported, skipped\n", copy_kernels_level_name((copy_kernel_level_t)level));
+            continue;
+        }
+        if (run_level((copy_kernel_level_t)level) != 0) return 1;
+    }
+    return 0;
+}
+
+static int test_non_temporal_path_matches_reference(void) {
+    // Force streaming stores for every copy
+    copy_kernels_set_nt_threshold(1);
+    int result = test_every_level_matches_reference();
+    copy_kernels_set_nt_threshold(0);
+    return result;
+}
+
+static int test_packed_planes_and_empty_copies(void) {
+    uint8_t src[4096];
+    uint8_t dst[4096];
+    fill_random(src, sizeof(src), 99);
+    memset(dst, 0, sizeof(dst));
+
+    // Tightly packed planes take the single-copy path
+    copy_plane(dst, 64, src, 64, 64, 64, 0);
+    TEST_ASSERT(memcmp(dst, src, sizeof(src)) == 0);
+
+    // Degenerate sizes are no-ops
+    memset(dst, GUARD_BYTE, sizeof(dst));
+    copy_plane(dst, 64, src, 64, 0, 8, 0);
+    copy_plane(dst, 64, src, 64, 64, 0, 1);
+    TEST_ASSERT_EQ(GUARD_BYTE, dst[0]);
+    TEST_ASSERT(copy_plane_with(COPY_KERNEL_COUNT, dst, 64, src, 64, 64, 1, 0) != 0);
+    return 0;
+}
+
+typedef struct {
+    copy_kernel_level_t level;
+    int mismatch;
+} first_use_t;
+
+static void first_use_thread(void* arg) {
+    first_use_t* use = (first_use_t*)arg;
+    uint8_t src[64 * 8];
+    uint8_t dst[64 * 8];
+    fill_random(src, sizeof(src), 11);
+    copy_plane(dst, 64, src, 64, 64, 8, 0);
+    use->mismatch = memcmp(dst, src, sizeof(src)) != 0;
+    use->level = copy_kernels_best_level();
+}
+
+// Has to run before anything else touches the kernels: every thread races to
+// trigger detection, and none may see a level other than the final one
+static int test_concurrent_first_use(void) {
+    platform_thread_t threads[FIRST_USE_THREADS];
+    first_use_t uses[FIRST_USE_THREADS];
+    memset(uses, 0, sizeof(uses));
+    for (int i = 0; i < FIRST_USE_THREADS; i++) {
+        TEST_ASSERT_EQ(0, platform_thread_create(&threads[i], first_use_thread, &uses[i]));
+    }
+    for (int i = 0; i < FIRST_USE_THREADS; i++) {
+        platform_thread_join(threads[i]);
+    }
+    for (int i = 0; i < FIRST_USE_THREADS; i++) {
+        TEST_ASSERT_EQ(0, uses[i].mismatch);
+        TEST_ASSERT_EQ(copy_kernels_best_level(), uses[i].level);
+    }
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_concurrent_first_use);
+
+    printf("Best copy kernel: %s, non-temporal threshold %zu bytes\n",
+           copy_kernels_level_name(copy_kernels_best_level()), copy_kernels_nt_threshold());
+
+    RUN_TEST(test_scalar_always_supported);
+    RUN_TEST(test_every_level_matches_reference);
+    RUN_TEST(test_non_temporal_path_matches_reference);
+    RUN_TEST(test_packed_planes_and_empty_copies);
+
+    return failures == 0 ? 0 : 1;
+}
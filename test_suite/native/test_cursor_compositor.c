@@ -0,0 +1,264 @@
+#include "test_common.h"
+#include "cursor_compositor.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void fill_pixels(uint8_t* frame, size_t pixels, uint8_t b, uint8_t g, uint8_t r, uint8_t a) {
+    for (size_t i = 0; i < pixels; i++) {
+        frame[i * 4 + 0] = b;
+        frame[i * 4 + 1] = g;
+        frame[i * 4 + 2] = r;
+        frame[i * 4 + 3] = a;
+    }
+}
+
+static int pixel_is(const uint8_t* pixel, int b, int g, int r, int a) {
+    return pixel[0] == b && pixel[1] == g && pixel[2] == r && pixel[3] == a;
+}
+
+static int test_monochrome_shape(void) {
+    // 8x1 cursor: AND row then XOR row, MSB is the leftmost pixel.
+    // Pixels 0-1 black, 2-3 white, 4-5 transparent, 6-7 inverted.
+    const uint8_t shape[2] = { 0x0F, 0x33 };
+    cursor_compositor_t cursor;
+    TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_MONOCHROME, shape, 8, 2, 1, 0, 0) == 0);
+    TEST_ASSERT_EQ(1, cursor.cache[cursor.current].height);
+    TEST_ASSERT(cursor.cache[cursor.current].xor_mask != NULL);
+
+    uint8_t frame[8 * 4];
+    fill_pixels(frame, 8, 0x10, 0x20, 0x30, 0xFF);
+    cursor_compositor_set_position(&cursor, 0, 0, 1);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, sizeof(frame), 8, 1, 0, 0, 0, NULL) == 0);
+
+    TEST_ASSERT(pixel_is(frame + 0, 0, 0, 0, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 4, 0, 0, 0, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 8, 0xFF, 0xFF, 0xFF, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 12, 0xFF, 0xFF, 0xFF, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 16, 0x10, 0x20, 0x30, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 20, 0x10, 0x20, 0x30, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 24, 0xEF, 0xDF, 0xCF, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 28, 0xEF, 0xDF, 0xCF, 0xFF));
+
+    // Odd heights leave no cursor rows
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_MONOCHROME, shape, 8, 1, 1, 0, 0) != 0);
+    cursor_compositor_cleanup(&cursor);
+    return 0;
+}
+
+static int test_color_shape_is_premultiplied(void) {
+    // Straight-alpha white at 50%, red at 100%, anything at 0%
+    const uint8_t shape[3 * 4] = { 0xFF, 0xFF, 0xFF, 0x80,   0x00, 0x00, 0xFF, 0xFF,   0x55, 0x66, 0x77, 0x00 };
+    uint32_t color[3], xor_mask[3];
+    int has_xor = 1;
+    TEST_ASSERT(cursor_decode_shape(CURSOR_SHAPE_COLOR, shape, 3, 1, 12, color, xor_mask, &has_xor) == 0);
+    TEST_ASSERT(!has_xor);
+    TEST_ASSERT(pixel_is((const uint8_t*)&color[0], 0x80, 0x80, 0x80, 0x80));
+    TEST_ASSERT(pixel_is((const uint8_t*)&color[2], 0, 0, 0, 0));
+
+    cursor_compositor_t cursor;
+    TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shape, 3, 1, 12, 0, 0) == 0);
+    TEST_ASSERT(cursor.cache[cursor.current].xor_mask == NULL);
+
+    uint8_t frame[3 * 4];
+    fill_pixels(frame, 3, 0, 0, 0, 0xFF);
+    cursor_compositor_set_position(&cursor, 0, 0, 1);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, sizeof(frame), 3, 1, 0, 0, 0, NULL) == 0);
+    TEST_ASSERT(pixel_is(frame + 0, 0x80, 0x80, 0x80, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 4, 0x00, 0x00, 0xFF, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 8, 0x00, 0x00, 0x00, 0xFF));
+    cursor_compositor_cleanup(&cursor);
+    return 0;
+}
+
+static int test_masked_color_shape(void) {
+    // Mask 0 replaces the screen pixel, 0xFF XORs the colour into it
+    const uint8_t shape[2 * 4] = { 0x11, 0x22, 0x33, 0x00,   0xFF, 0x0F, 0x00, 0xFF };
+    cursor_compositor_t cursor;
+    TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_MASKED_COLOR, shape, 2, 1, 8, 0, 0) == 0);
+
+    uint8_t frame[2 * 4];
+    fill_pixels(frame, 2, 0xA0, 0xB0, 0xC0, 0xFF);
+    cursor_compositor_set_position(&cursor, 0, 0, 1);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, sizeof(frame), 2, 1, 0, 0, 0, NULL) == 0);
+    TEST_ASSERT(pixel_is(frame + 0, 0x11, 0x22, 0x33, 0xFF));
+    TEST_ASSERT(pixel_is(frame + 4, 0x5F, 0xBF, 0xC0, 0xFF));
+
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, (cursor_shape_type_t)3, shape, 2, 1, 8, 0, 0) != 0);
+    cursor_compositor_cleanup(&cursor);
+    return 0;
+}
+
+static int test_clipping_flip_and_origin(void) {
+    const int width = 40, height = 30;
+    size_t pitch = (size_t)width * 4 + 8;
+    uint8_t* frame = (uint8_t*)malloc(pitch * height);
+    uint8_t* flipped = (uint8_t*)malloc(pitch * height);
+    uint8_t* before = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(frame != NULL && flipped != NULL && before != NULL);
+
+    // Opaque 16x16 colour cursor hanging off the top-left corner
+    uint8_t shape[16 * 16 * 4];
+    fill_random(shape, sizeof(shape), 5);
+    for (int i = 0; i < 16 * 16; i++) shape[i * 4 + 3] = 0xFF;
+
+    cursor_compositor_t cursor;
+    TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shape, 16, 16, 64, 0, 0) == 0);
+    cursor_compositor_set_position(&cursor, -4, -6, 1);
+
+    fill_random(frame, pitch * height, 9);
+    memcpy(before, frame, pitch * height);
+    frame_rect_t drawn;
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, pitch, width, height, 0, 0, 0, &drawn) == 0);
+    TEST_ASSERT_EQ(0, drawn.left);
+    TEST_ASSERT_EQ(0, drawn.top);
+    TEST_ASSERT_EQ(12, drawn.right);
+    TEST_ASSERT_EQ(10, drawn.bottom);
+    TEST_ASSERT(memcmp(frame, shape + (6 * 16 + 4) * 4, 12 * 4) == 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width + 2; x++) {
+            if (y < 10 && x < 12) continue;
+            TEST_ASSERT(memcmp(frame + y * pitch + x * 4, before + y * pitch + x * 4, 4) == 0);
+        }
+    }
+
+    // Bottom-up frames get the same picture mirrored by rows
+    memset(flipped, 0, pitch * height);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, flipped, pitch, width, height, 0, 0, 1, NULL) == 0);
+    for (int y = 0; y < 10; y++) {
+        TEST_ASSERT(memcmp(flipped + (height - 1 - y) * pitch, frame + y * pitch, 12 * 4) == 0);
+    }
+
+    // An origin offset places capture coordinates inside a larger frame; fully outside draws nothing
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, pitch, width, height, 30, 20, 0, &drawn) == 0);
+    TEST_ASSERT_EQ(26, drawn.left);
+    TEST_ASSERT_EQ(14, drawn.top);
+    TEST_ASSERT_EQ(40, drawn.right);
+    TEST_ASSERT_EQ(30, drawn.bottom);
+    memcpy(before, frame, pitch * height);
+    cursor_compositor_set_position(&cursor, 100, 100, 1);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, pitch, width, height, 0, 0, 0, &drawn) == 0);
+    TEST_ASSERT_EQ(0, frame_rect_area(&drawn));
+    cursor_compositor_set_position(&cursor, 0, 0, 0);
+    TEST_ASSERT(cursor_compositor_draw(&cursor, frame, pitch, width, height, 0, 0, 0, &drawn) == 0);
+    TEST_ASSERT_EQ(0, frame_rect_area(&drawn));
+    TEST_ASSERT(memcmp(frame, before, pitch * height) == 0);
+
+    cursor_compositor_cleanup(&cursor);
+    free(frame);
+    free(flipped);
+    free(before);
+    return 0;
+}
+
+static int test_simd_levels_are_bit_exact(void) {
+    const int widths[] = { 1, 3, 4, 7, 8, 13, 32, 37, 64 };
+    const int rows = 9;
+    uint8_t* shape = (uint8_t*)malloc(64 * 4 * rows);
+    uint8_t* background = (uint8_t*)malloc(64 * 4 * rows);
+    uint8_t* expected = (uint8_t*)malloc(64 * 4 * rows);
+    uint8_t* actual = (uint8_t*)malloc(64 * 4 * rows);
+    TEST_ASSERT(shape && background && expected && actual);
+    fill_random(background, 64 * 4 * rows, 17);
+
+    const cursor_shape_type_t types[] = { CURSOR_SHAPE_COLOR, CURSOR_SHAPE_MASKED_COLOR };
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        fill_random(shape, 64 * 4 * rows, 23 + (unsigned)t);
+        for (int i = 0; i < 64 * rows; i++) {
+            // Mix opaque, transparent and partial alpha; masked shapes only use 0 and 0xFF
+            if (types[t] == CURSOR_SHAPE_MASKED_COLOR) shape[i * 4 + 3] = (i % 3) ? 0x00 : 0xFF;
+            else if (i % 5 == 0) shape[i * 4 + 3] = 0xFF;
+            else if (i % 5 == 1) shape[i * 4 + 3] = 0x00;
+        }
+
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            int width = widths[w];
+            size_t pitch = (size_t)width * 4;
+            cursor_compositor_t cursor;
+            TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+            TEST_ASSERT(cursor_compositor_set_shape(&cursor, types[t], shape, width, rows, 64 * 4, 0, 0) == 0);
+            cursor_compositor_set_position(&cursor, 0, 0, 1);
+
+            TEST_ASSERT(cursor_compositor_set_level(&cursor, COPY_KERNEL_SCALAR) == 0);
+            memcpy(expected, background, pitch * rows);
+            TEST_ASSERT(cursor_compositor_draw(&cursor, expected, pitch, width, rows, 0, 0, 0, NULL) == 0);
+            for (int level = COPY_KERNEL_SSE2; level < COPY_KERNEL_COUNT; level++) {
+                if (cursor_compositor_set_level(&cursor, (copy_kernel_level_t)level) != 0) continue;
+                memcpy(actual, background, pitch * rows);
+                TEST_ASSERT(cursor_compositor_draw(&cursor, actual, pitch, width, rows, 0, 0, 0, NULL) == 0);
+                TEST_ASSERT(memcmp(actual, expected, pitch * rows) == 0);
+            }
+            cursor_compositor_cleanup(&cursor);
+        }
+    }
+
+    free(shape);
+    free(background);
+    free(expected);
+    free(actual);
+    return 0;
+}
+
+static int test_shape_cache_and_generation(void) {
+    uint8_t shapes[CURSOR_CACHE_SIZE + 1][8 * 8 * 4];
+    for (int i = 0; i <= CURSOR_CACHE_SIZE; i++) {
+        fill_random(shapes[i], sizeof(shapes[i]), 100 + (unsigned)i);
+    }
+
+    cursor_compositor_t cursor;
+    TEST_ASSERT(cursor_compositor_init(&cursor) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 0, 0) == 0);
+    cursor_compositor_set_position(&cursor, 5, 5, 1);
+    uint64_t generation = cursor.generation;
+
+    // Same shape again and the same position change nothing that would be drawn
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 0, 0) == 0);
+    cursor_compositor_set_position(&cursor, 5, 5, 1);
+    TEST_ASSERT_EQ(generation, cursor.generation);
+    TEST_ASSERT_EQ(1, cursor.cache_hits);
+
+    cursor_compositor_set_position(&cursor, 6, 5, 1);
+    TEST_ASSERT_EQ(generation + 1, cursor.generation);
+
+    // Switching between cached shapes does not decode again
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[1], 8, 8, 32, 0, 0) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 0, 0) == 0);
+    TEST_ASSERT_EQ(2, cursor.cache_hits);
+    TEST_ASSERT_EQ(generation + 3, cursor.generation);
+
+    // A different hot spot is a different shape
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 3, 3) == 0);
+    TEST_ASSERT_EQ(2, cursor.cache_hits);
+
+    // Seven more shapes overflow the cache by two: the two least recently used
+    // entries (shapes[1], then shapes[0] without the hot spot) are evicted
+    for (int i = 2; i <= CURSOR_CACHE_SIZE; i++) {
+        TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[i], 8, 8, 32, 0, 0) == 0);
+    }
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 3, 3) == 0);
+    TEST_ASSERT_EQ(3, cursor.cache_hits);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[1], 8, 8, 32, 0, 0) == 0);
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], 8, 8, 32, 0, 0) == 0);
+    TEST_ASSERT_EQ(3, cursor.cache_hits);
+
+    TEST_ASSERT(cursor_compositor_set_shape(&cursor, CURSOR_SHAPE_COLOR, shapes[0], CURSOR_MAX_SIZE + 1, 8, 2048, 0, 0) != 0);
+    cursor_compositor_cleanup(&cursor);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_monochrome_shape);
+    RUN_TEST(test_color_shape_is_premultiplied);
+    RUN_TEST(test_masked_color_shape);
+    RUN_TEST(test_clipping_flip_and_origin);
+    RUN_TEST(test_simd_levels_are_bit_exact);
+    RUN_TEST(test_shape_cache_and_generation);
+
+    return failures == 0 ? 0 : 1;
+}
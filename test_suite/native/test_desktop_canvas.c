@@ -0,0 +1,159 @@
+#include "test_common.h"
+#include "desktop_canvas.h"
+#include <stdint.h>
+#include <string.h>
+
+// Synthetic output: fills its window with a solid colour, optionally failing
+// or reporting no change, and records how many outputs were busy at once
+typedef struct {
+    int width;
+    int height;
+    uint8_t color;
+    int result;
+    int calls;
+} synthetic_output_t;
+
+static platform_atomic_t g_active = 0;
+static platform_atomic_t g_max_active = 0;
+
+static int synthetic_capture(void* context, uint8_t* dst, size_t dst_pitch) {
+    synthetic_output_t* output = (synthetic_output_t*)context;
+    output->calls++;
+
+    long active = platform_atomic_inc(&g_active);
+    if (active > platform_atomic_load(&g_max_active)) platform_atomic_store(&g_max_active, active);
+    platform_sleep_ms(20);   // Long enough that serial execution cannot overlap
+
+    if (output->result == CANVAS_OUTPUT_NEW) {
+        for (int y = 0; y < output->height; y++) {
+            memset(dst + (size_t)y * dst_pitch, output->color, (size_t)output->width * 4);
+        }
+    }
+    platform_atomic_dec(&g_active);
+    return output->result;
+}
+
+static uint8_t canvas_pixel(const desktop_canvas_t* canvas, int desktop_x, int desktop_y) {
+    return canvas->pixels[(size_t)(desktop_y - canvas->origin_y) * canvas->stride + (size_t)(desktop_x - canvas->origin_x) * 4];
+}
+
+static int test_layout_uses_desktop_coordinates(void) {
+    // Portrait monitor left of the primary, landscape monitor above-right
+    canvas_output_desc_t outputs[3] = {
+        { { 0, 0, 1920, 1080 }, synthetic_capture, NULL },
+        { { -1080, -400, 1080, 1920 }, synthetic_capture, NULL },
+        { { 1920, -300, 1280, 1024 }, synthetic_capture, NULL },
+    };
+    capture_region_t bounds;
+    TEST_ASSERT(desktop_canvas_layout(outputs, 3, &bounds) == 0);
+    TEST_ASSERT_EQ(-1080, bounds.x);
+    TEST_ASSERT_EQ(-400, bounds.y);
+    TEST_ASSERT_EQ(1080 + 1920 + 1280, bounds.width);
+    TEST_ASSERT_EQ(1920, bounds.height);
+
+    // Overlapping outputs cannot be composed by independent workers
+    canvas_output_desc_t overlapping[2] = {
+        { { 0, 0, 1920, 1080 }, synthetic_capture, NULL },
+        { { 1900, 0, 1920, 1080 }, synthetic_capture, NULL },
+    };
+    TEST_ASSERT(desktop_canvas_layout(overlapping, 2, &bounds) != 0);
+    TEST_ASSERT(desktop_canvas_layout(outputs, 0, &bounds) != 0);
+    return 0;
+}
+
+static int test_outputs_compose_in_parallel(void) {
+    synthetic_output_t sources[3] = {
+        { 64, 48, 0x10, CANVAS_OUTPUT_NEW, 0 },
+        { 32, 80, 0x20, CANVAS_OUTPUT_NEW, 0 },
+        { 40, 30, 0x30, CANVAS_OUTPUT_NEW, 0 },
+    };
+    canvas_output_desc_t outputs[3] = {
+        { { 0, 0, 64, 48 }, synthetic_capture, &sources[0] },
+        { { -32, -16, 32, 80 }, synthetic_capture, &sources[1] },
+        { { 64, -10, 40, 30 }, synthetic_capture, &sources[2] },
+    };
+
+    desktop_canvas_t canvas;
+    TEST_ASSERT(desktop_canvas_init(&canvas, outputs, 3) == 0);
+    TEST_ASSERT_EQ(-32, canvas.origin_x);
+    TEST_ASSERT_EQ(-16, canvas.origin_y);
+    TEST_ASSERT_EQ(136, canvas.width);
+    TEST_ASSERT_EQ(80, canvas.height);
+
+    platform_atomic_store(&g_max_active, 0);
+    TEST_ASSERT_EQ(3, desktop_canvas_capture(&canvas));
+    TEST_ASSERT(platform_atomic_load(&g_max_active) >= 2);
+
+    TEST_ASSERT_EQ(0x10, canvas_pixel(&canvas, 0, 0));
+    TEST_ASSERT_EQ(0x10, canvas_pixel(&canvas, 63, 47));
+    TEST_ASSERT_EQ(0x20, canvas_pixel(&canvas, -32, -16));
+    TEST_ASSERT_EQ(0x20, canvas_pixel(&canvas, -1, 63));
+    TEST_ASSERT_EQ(0x30, canvas_pixel(&canvas, 64, -10));
+    TEST_ASSERT_EQ(0x30, canvas_pixel(&canvas, 103, 19));
+
+    // Gaps between outputs stay black
+    TEST_ASSERT_EQ(0, canvas_pixel(&canvas, 0, -16));
+    TEST_ASSERT_EQ(0, canvas_pixel(&canvas, 100, 40));
+
+    for (int frame = 0; frame < 5; frame++) {
+        TEST_ASSERT_EQ(3, desktop_canvas_capture(&canvas));
+    }
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQ(6, sources[i].calls);
+        TEST_ASSERT_EQ(6, canvas.outputs[i].updates);
+    }
+
+    desktop_canvas_cleanup(&canvas);
+    return 0;
+}
+
+static int test_unchanged_and_failing_outputs(void) {
+    synthetic_output_t sources[2] = {
+        { 16, 16, 0x40, CANVAS_OUTPUT_UNCHANGED, 0 },
+        { 16, 16, 0x50, CANVAS_OUTPUT_NEW, 0 },
+    };
+    canvas_output_desc_t outputs[2] = {
+        { { 0, 0, 16, 16 }, synthetic_capture, &sources[0] },
+        { { 16, 0, 16, 16 }, synthetic_capture, &sources[1] },
+    };
+
+    desktop_canvas_t canvas;
+    TEST_ASSERT(desktop_canvas_init(&canvas, outputs, 2) == 0);
+    TEST_ASSERT_EQ(1, desktop_canvas_capture(&canvas));
+    TEST_ASSERT_EQ(0, canvas_pixel(&canvas, 0, 0));
+    TEST_ASSERT_EQ(0x50, canvas_pixel(&canvas, 16, 0));
+
+    sources[0].result = -1;
+    TEST_ASSERT_EQ(-1, desktop_canvas_capture(&canvas));
+    TEST_ASSERT_EQ(1, canvas.outputs[0].failures);
+
+    desktop_canvas_cleanup(&canvas);
+    return 0;
+}
+
+static int test_odd_layout_is_padded(void) {
+    synthetic_output_t source = { 15, 9, 0x60, CANVAS_OUTPUT_NEW, 0 };
+    canvas_output_desc_t output = { { 5, 5, 15, 9 }, synthetic_capture, &source };
+
+    desktop_canvas_t canvas;
+    TEST_ASSERT(desktop_canvas_init(&canvas, &output, 1) == 0);
+    TEST_ASSERT_EQ(16, canvas.width);
+    TEST_ASSERT_EQ(10, canvas.height);
+    TEST_ASSERT_EQ(1, desktop_canvas_capture(&canvas));
+    TEST_ASSERT_EQ(0x60, canvas_pixel(&canvas, 19, 13));
+    TEST_ASSERT_EQ(0, canvas_pixel(&canvas, 20, 13));
+
+    desktop_canvas_cleanup(&canvas);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_layout_uses_desktop_coordinates);
+    RUN_TEST(test_outputs_compose_in_parallel);
+    RUN_TEST(test_unchanged_and_failing_outputs);
+    RUN_TEST(test_odd_layout_is_padded);
+
+    return failures == 0 ? 0 : 1;
+}
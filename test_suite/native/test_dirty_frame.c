@@ -0,0 +1,253 @@
+#include "test_common.h"
+#include "dirty_frame.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+#define TEST_STRIDE (TEST_WIDTH * 4)
+
+// Every pixel encodes its own coordinates plus a seed, so misplaced rows or columns show up
+static void fill_pattern(uint8_t* image, size_t pitch, int seed) {
+    for (int y = 0; y < TEST_HEIGHT; y++) {
+        for (int x = 0; x < TEST_WIDTH; x++) {
+            uint8_t* p = image + (size_t)y * pitch + (size_t)x * 4;
+            p[0] = (uint8_t)x;
+            p[1] = (uint8_t)y;
+            p[2] = (uint8_t)seed;
+            p[3] = 0xFF;
+        }
+    }
+}
+
+static int frames_equal(const dirty_frame_t* frame, const uint8_t* expected) {
+    return memcmp(frame->pixels, expected, (size_t)TEST_STRIDE * TEST_HEIGHT) == 0;
+}
+
+static int test_init_rejects_invalid_arguments(void) {
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(NULL, 16, 16) != 0);
+    TEST_ASSERT(dirty_frame_init(&frame, 0, 16) != 0);
+    TEST_ASSERT(dirty_frame_init(&frame, 16, -1) != 0);
+
+    TEST_ASSERT(dirty_frame_init(&frame, 16, 16) == 0);
+    frame_move_t move = { 0, 0, { 0, 0, 4, 4 } };
+    // A move needs a previous image to move from
+    TEST_ASSERT(dirty_frame_apply(&frame, NULL, 0, &move, 1, NULL, 0) != 0);
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_dirty_rects_copy_only_changed_pixels(void) {
+    static uint8_t first[TEST_STRIDE * TEST_HEIGHT];
+    static uint8_t second[TEST_STRIDE * TEST_HEIGHT];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+
+    fill_pattern(first, TEST_STRIDE, 1);
+    TEST_ASSERT(dirty_frame_full_update(&frame, first, TEST_STRIDE) == 0);
+    TEST_ASSERT(frames_equal(&frame, first));
+
+    // The new image differs only inside the reported rect
+    memcpy(second, first, sizeof(second));
+    frame_rect_t rect = { 8, 4, 24, 12 };
+    for (int y = rect.top; y < rect.bottom; y++) {
+        memset(second + (size_t)y * TEST_STRIDE + rect.left * 4, 0xAB, (size_t)(rect.right - rect.left) * 4);
+    }
+
+    TEST_ASSERT(dirty_frame_apply(&frame, second, TEST_STRIDE, NULL, 0, &rect, 1) == 0);
+    TEST_ASSERT(frames_equal(&frame, second));
+    TEST_ASSERT_EQ(16 * 8 * 4, frame.bytes_copied);
+    TEST_ASSERT_EQ(0, frame.bytes_moved);
+
+    int count = 0;
+    const frame_rect_t* changed = dirty_frame_changed(&frame, &count);
+    TEST_ASSERT_EQ(1, count);
+    TEST_ASSERT_EQ(8, changed[0].left);
+    TEST_ASSERT_EQ(12, changed[0].bottom);
+
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_overlapping_scroll_moves(void) {
+    static uint8_t image[TEST_STRIDE * TEST_HEIGHT];
+    static uint8_t expected[TEST_STRIDE * TEST_HEIGHT];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+
+    fill_pattern(image, TEST_STRIDE, 2);
+    TEST_ASSERT(dirty_frame_full_update(&frame, image, TEST_STRIDE) == 0);
+
+    // Scroll up by 10 rows: rows 10.. move to 0.., the bottom strip is newly exposed
+    frame_move_t up = { 0, 10, { 0, 0, TEST_WIDTH, TEST_HEIGHT - 10 } };
+    frame_rect_t exposed = { 0, TEST_HEIGHT - 10, TEST_WIDTH, TEST_HEIGHT };
+    memmove(expected, image + 10 * TEST_STRIDE, (size_t)(TEST_HEIGHT - 10) * TEST_STRIDE);
+    memset(expected + (size_t)(TEST_HEIGHT - 10) * TEST_STRIDE, 0x11, (size_t)10 * TEST_STRIDE);
+
+    TEST_ASSERT(dirty_frame_apply(&frame, expected, TEST_STRIDE, &up, 1, &exposed, 1) == 0);
+    TEST_ASSERT(frames_equal(&frame, expected));
+    TEST_ASSERT_EQ((TEST_HEIGHT - 10) * TEST_STRIDE, frame.bytes_moved);
+    TEST_ASSERT_EQ(10 * TEST_STRIDE, frame.bytes_copied);
+
+    // Scroll down by 7 rows and right by 3 columns, overlapping in both directions
+    memcpy(image, frame.pixels, sizeof(image));
+    frame_move_t down = { 0, 0, { 3, 7, TEST_WIDTH, TEST_HEIGHT } };
+    memcpy(expected, image, sizeof(expected));
+    for (int y = TEST_HEIGHT - 1; y >= 7; y--) {
+        memmove(expected + (size_t)y * TEST_STRIDE + 3 * 4, image + (size_t)(y - 7) * TEST_STRIDE,
+                (size_t)(TEST_WIDTH - 3) * 4);
+    }
+
+    TEST_ASSERT(dirty_frame_apply(&frame, NULL, 0, &down, 1, NULL, 0) == 0);
+    TEST_ASSERT(frames_equal(&frame, expected));
+
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_rects_are_clipped(void) {
+    static uint8_t image[TEST_STRIDE * TEST_HEIGHT];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+
+    fill_pattern(image, TEST_STRIDE, 3);
+    frame_rect_t rects[] = {
+        { -10, -10, 4, 4 },                                         // Partly outside, clipped to 4x4
+        { TEST_WIDTH, 0, TEST_WIDTH + 8, 8 },                       // Entirely outside
+        { 10, 10, 10, 20 },                                         // Empty
+    };
+    TEST_ASSERT(dirty_frame_full_update(&frame, image, TEST_STRIDE) == 0);
+    TEST_ASSERT(dirty_frame_apply(&frame, image, TEST_STRIDE, NULL, 0, rects, 3) == 0);
+    TEST_ASSERT_EQ(4 * 4 * 4, frame.bytes_copied);
+
+    int count = 0;
+    const frame_rect_t* changed = dirty_frame_changed(&frame, &count);
+    TEST_ASSERT_EQ(1, count);
+    TEST_ASSERT_EQ(0, changed[0].left);
+    TEST_ASSERT_EQ(4, changed[0].right);
+
+    // A move whose source lies partly outside the frame only moves the valid part
+    frame_move_t move = { -8, 0, { 0, 0, 16, 8 } };
+    TEST_ASSERT(dirty_frame_apply(&frame, NULL, 0, &move, 1, NULL, 0) == 0);
+    TEST_ASSERT_EQ(8 * 8 * 4, frame.bytes_moved);
+
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_damage_collapses_to_bounding_box(void) {
+    static uint8_t image[TEST_STRIDE * TEST_HEIGHT];
+    frame_rect_t rects[DIRTY_FRAME_MAX_RECTS + 1];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+
+    fill_pattern(image, TEST_STRIDE, 4);
+    for (int i = 0; i <= DIRTY_FRAME_MAX_RECTS; i++) {
+        int x = i % TEST_WIDTH;
+        int y = (i / TEST_WIDTH) * 2;
+        frame_rect_t r = { x, y, x + 1, y + 1 };
+        rects[i] = r;
+    }
+    TEST_ASSERT(dirty_frame_full_update(&frame, image, TEST_STRIDE) == 0);
+    TEST_ASSERT(dirty_frame_apply(&frame, image, TEST_STRIDE, NULL, 0, rects, DIRTY_FRAME_MAX_RECTS + 1) == 0);
+
+    int count = 0;
+    const frame_rect_t* changed = dirty_frame_changed(&frame, &count);
+    TEST_ASSERT_EQ(1, count);
+    TEST_ASSERT_EQ(0, changed[0].left);
+    TEST_ASSERT_EQ(0, changed[0].top);
+    TEST_ASSERT_EQ(TEST_WIDTH, changed[0].right);
+    TEST_ASSERT_EQ(3, changed[0].bottom);
+
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_copy_out_catches_up_stale_buffers(void) {
+    static uint8_t image[TEST_STRIDE * TEST_HEIGHT];
+    static uint8_t stale[TEST_STRIDE * TEST_HEIGHT];
+    static uint8_t flipped[TEST_STRIDE * TEST_HEIGHT];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+
+    // Generation 0 buffers always get a full copy
+    fill_pattern(image, TEST_STRIDE, 5);
+    TEST_ASSERT(dirty_frame_full_update(&frame, image, TEST_STRIDE) == 0);
+    TEST_ASSERT_EQ(TEST_STRIDE * TEST_HEIGHT, dirty_frame_copy_out(&frame, stale, TEST_STRIDE, 0, 0));
+    uint64_t synced = frame.generation;
+    TEST_ASSERT_EQ(0, dirty_frame_copy_out(&frame, stale, TEST_STRIDE, synced, 0));
+
+    // A few small updates later the stale buffer only needs their union
+    for (int i = 0; i < 3; i++) {
+        frame_rect_t rect = { i * 8, i * 4, i * 8 + 8, i * 4 + 4 };
+        for (int y = rect.top; y < rect.bottom; y++) {
+            memset(image + (size_t)y * TEST_STRIDE + rect.left * 4, 0x40 + i, 8 * 4);
+        }
+        TEST_ASSERT(dirty_frame_apply(&frame, image, TEST_STRIDE, NULL, 0, &rect, 1) == 0);
+    }
+    TEST_ASSERT_EQ(3 * 8 * 4 * 4, dirty_frame_copy_out(&frame, stale, TEST_STRIDE, synced, 0));
+    TEST_ASSERT(frames_equal(&frame, stale));
+
+    // Flipped output matches the persistent frame read bottom-up
+    TEST_ASSERT(dirty_frame_copy_out(&frame, flipped, TEST_STRIDE, 0, 1) > 0);
+    for (int y = 0; y < TEST_HEIGHT; y++) {
+        TEST_ASSERT(memcmp(flipped + (size_t)(TEST_HEIGHT - 1 - y) * TEST_STRIDE,
+                           frame.pixels + (size_t)y * TEST_STRIDE, TEST_STRIDE) == 0);
+    }
+
+    // Lagging further than the history falls back to a full copy
+    synced = frame.generation;
+    frame_rect_t pixel = { 0, 0, 1, 1 };
+    for (int i = 0; i <= DIRTY_FRAME_HISTORY; i++) {
+        TEST_ASSERT(dirty_frame_apply(&frame, image, TEST_STRIDE, NULL, 0, &pixel, 1) == 0);
+    }
+    TEST_ASSERT_EQ(TEST_STRIDE * TEST_HEIGHT, dirty_frame_copy_out(&frame, stale, TEST_STRIDE, synced, 0));
+
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+static int test_copy_rect_restores_overdrawn_pixels(void) {
+    static uint8_t image[TEST_STRIDE * TEST_HEIGHT];
+    static uint8_t copy[TEST_STRIDE * TEST_HEIGHT];
+    dirty_frame_t frame;
+    TEST_ASSERT(dirty_frame_init(&frame, TEST_WIDTH, TEST_HEIGHT) == 0);
+    fill_pattern(image, TEST_STRIDE, 9);
+    TEST_ASSERT(dirty_frame_full_update(&frame, image, TEST_STRIDE) == 0);
+
+    // Something drawn over a bottom-up copy, partly off the edge, is undone by the rect alone
+    for (int flip = 0; flip <= 1; flip++) {
+        TEST_ASSERT(dirty_frame_copy_out(&frame, copy, TEST_STRIDE, 0, flip) > 0);
+        frame_rect_t rect = { 50, 40, 70, 60 };
+        for (int y = 40; y < TEST_HEIGHT; y++) {
+            int row = flip ? TEST_HEIGHT - 1 - y : y;
+            memset(copy + (size_t)row * TEST_STRIDE + 50 * 4, 0xEE, 14 * 4);
+        }
+        TEST_ASSERT_EQ(14 * 8 * 4, dirty_frame_copy_rect(&frame, copy, TEST_STRIDE, &rect, flip));
+        for (int y = 0; y < TEST_HEIGHT; y++) {
+            int row = flip ? TEST_HEIGHT - 1 - y : y;
+            TEST_ASSERT(memcmp(copy + (size_t)row * TEST_STRIDE, frame.pixels + (size_t)y * TEST_STRIDE, TEST_STRIDE) == 0);
+        }
+    }
+
+    frame_rect_t outside = { 100, 100, 110, 110 };
+    TEST_ASSERT_EQ(0, dirty_frame_copy_rect(&frame, copy, TEST_STRIDE, &outside, 0));
+    dirty_frame_cleanup(&frame);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_rejects_invalid_arguments);
+    RUN_TEST(test_dirty_rects_copy_only_changed_pixels);
+    RUN_TEST(test_overlapping_scroll_moves);
+    RUN_TEST(test_rects_are_clipped);
+    RUN_TEST(test_damage_collapses_to_bounding_box);
+    RUN_TEST(test_copy_out_catches_up_stale_buffers);
+    RUN_TEST(test_copy_rect_restores_overdrawn_pixels);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,477 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "h264_fixtures.h"
+#include "encoder_backend.h"
+#include "capture_spool.h"
+#include "replay_source.h"
+#include "color_convert.h"
+#include "replay_buffer.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BACKEND_TEST_RAW "test_encoder_backend.raw"
+#define BACKEND_TEST_SPOOL "test_encoder_backend.spool"
+#define BACKEND_TEST_MP4 "test_encoder_backend.mp4"
+
+// 100 ns units at 30 fps
+#define FRAME_TIME(i) ((int64_t)(i) * ENCODER_BACKEND_UNITS_PER_SECOND / 30)
+
+static void draw_frame(uint8_t* pixels, int width, int height, int frame) {
+    int square_x = (frame * 7) % (width - 16);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = pixels + ((size_t)y * width + x) * 4;
+            int inside = x >= square_x && x < square_x + 16 && y >= 8 && y < 24;
+            pixel[0] = inside ? 30 : (uint8_t)(x * 255 / width);
+            pixel[1] = inside ? 220 : (uint8_t)(y * 255 / height);
+            pixel[2] = inside ? 250 : 60;
+            pixel[3] = 255;
+        }
+    }
+}
+
+static void video_config(encoder_backend_config_t* config, const char* path, int width, int height,
+                         encoder_input_format_t format) {
+    memset(config, 0, sizeof(encoder_backend_config_t));
+    config->path = path;
+    config->video = 1;
+    config->width = width;
+    config->height = height;
+    config->fps = 30;
+    config->format = format;
+    config->matrix = COLOR_MATRIX_BT709;
+    config->range = COLOR_RANGE_LIMITED;
+    config->timing = FRAME_TIMING_CFR;
+    config->fragmented = 1;
+}
+
+// Pushes count frames drawn into BGRA pool frames; every third tick is a repeat
+static int push_bgra(encoder_backend_t* backend, frame_pool_t* pool, int width, int height, int count,
+                     uint8_t* written) {
+    size_t frame_size = (size_t)width * height * 4;
+    int drawn = 0;
+    for (int i = 0; i < count; i++) {
+        if (i % 3 == 2) {
+            if (encoder_backend_repeat_video(backend, FRAME_TIME(i)) != 0) return -1;
+            if (written) memcpy(written + frame_size * i, written + frame_size * (i - 1), frame_size);
+            continue;
+        }
+        frame_handle_t frame = frame_pool_acquire(pool);
+        if (frame == FRAME_HANDLE_INVALID) return -1;
+        draw_frame((uint8_t*)frame_pool_data(pool, frame), width, height, drawn++);
+        if (written) memcpy(written + frame_size * i, frame_pool_data(pool, frame), frame_size);
+        int result = encoder_backend_push_video(backend, pool, frame, FRAME_TIME(i));
+        frame_pool_release(pool, frame);
+        if (result != 0) return -1;
+    }
+    return 0;
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? (uint8_t*)malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+static int test_names(void) {
+    encoder_backend_kind_t kind;
+    TEST_ASSERT(encoder_backend_parse("h264", &kind) == 0);
+    TEST_ASSERT_EQ(ENCODER_BACKEND_H264, kind);
+    TEST_ASSERT(encoder_backend_parse("null", &kind) == 0);
+    TEST_ASSERT_EQ(ENCODER_BACKEND_NULL, kind);
+    TEST_ASSERT(encoder_backend_parse("mf", &kind) == 0);
+    TEST_ASSERT_EQ(ENCODER_BACKEND_MEDIA_FOUNDATION, kind);
+    TEST_ASSERT(encoder_backend_parse("H264", &kind) != 0);
+    TEST_ASSERT(encoder_backend_parse("vp9", &kind) != 0);
+    TEST_ASSERT(strcmp(encoder_backend_kind_name(ENCODER_BACKEND_SPOOL), "spool") == 0);
+    TEST_ASSERT(strcmp(encoder_backend_kind_name((encoder_backend_kind_t)99), "unknown") == 0);
+
+    // Media Foundation is Windows only and created through encoder.h
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_MEDIA_FOUNDATION) != 0);
+    TEST_ASSERT(strcmp(encoder_backend_name(&backend), "none") == 0);
+    return 0;
+}
+
+static int test_null_counts(void) {
+    const int width = 64, height = 32;
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, (size_t)width * height * 4, 2) == 0);
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_NULL) == 0);
+    TEST_ASSERT(encoder_backend_takes(&backend, ENCODER_INPUT_BGRA));
+    TEST_ASSERT(encoder_backend_takes(&backend, ENCODER_INPUT_NV12));
+
+    encoder_backend_config_t config;
+    video_config(&config, "unused.mp4", width, height, ENCODER_INPUT_BGRA);
+    config.audio_streams = 2;
+    config.sample_rate = 48000;
+    config.channels = 2;
+    config.bits_per_sample = 16;
+    TEST_ASSERT(encoder_backend_init(&backend, &config) == 0);
+    TEST_ASSERT(!backend.bottom_up);
+    TEST_ASSERT(push_bgra(&backend, &pool, width, height, 9, NULL) == 0);
+    int16_t samples[480 * 2] = {0};
+    TEST_ASSERT(encoder_backend_push_audio(&backend, 0, (const uint8_t*)samples, 480, 0) == 0);
+    TEST_ASSERT(encoder_backend_push_audio(&backend, 1, (const uint8_t*)samples, 480, 0) == 0);
+    TEST_ASSERT(encoder_backend_push_audio(&backend, 2, (const uint8_t*)samples, 480, 0) != 0);
+    TEST_ASSERT(encoder_backend_flush(&backend) == 0);
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+    // Closed: nothing more is taken
+    TEST_ASSERT(encoder_backend_repeat_video(&backend, FRAME_TIME(9)) != 0);
+
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(&backend, &stats);
+    TEST_ASSERT_EQ(6, stats.video_frames);
+    TEST_ASSERT_EQ(3, stats.repeated_frames);
+    TEST_ASSERT_EQ(960, stats.audio_frames);
+    TEST_ASSERT_EQ(0, stats.failures);
+    encoder_backend_destroy(&backend);
+
+    frame_pool_stats_t pool_stats;
+    frame_pool_get_stats(&pool, &pool_stats);
+    TEST_ASSERT_EQ(0, pool_stats.in_use);
+    frame_pool_cleanup(&pool);
+    return 0;
+}
+
+// The raw file plays back through the replay source, repeats included
+static int test_raw_replays(void) {
+    const int width = 48, height = 30, count = 8;
+    size_t frame_size = (size_t)width * height * 4;
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, frame_size, 2) == 0);
+    uint8_t* written = (uint8_t*)malloc(frame_size * count);
+    TEST_ASSERT(written != NULL);
+
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_RAW) == 0);
+    TEST_ASSERT(!encoder_backend_takes(&backend, ENCODER_INPUT_NV12));
+    encoder_backend_config_t config;
+    video_config(&config, BACKEND_TEST_RAW, width, height, ENCODER_INPUT_BGRA);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) == 0);
+    // A repeat before any frame has nothing to repeat
+    TEST_ASSERT(encoder_backend_repeat_video(&backend, 0) != 0);
+    TEST_ASSERT(push_bgra(&backend, &pool, width, height, count, written) == 0);
+    TEST_ASSERT(encoder_backend_flush(&backend) == 0);
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(&backend, &stats);
+    TEST_ASSERT_EQ(2, stats.repeated_frames);
+    TEST_ASSERT_EQ(1, stats.failures);
+    TEST_ASSERT_EQ(REPLAY_FILE_HEADER_SIZE + frame_size * count, stats.bytes);
+    encoder_backend_destroy(&backend);
+    // The frame held for repeats went back at finalize
+    frame_pool_stats_t pool_stats;
+    frame_pool_get_stats(&pool, &pool_stats);
+    TEST_ASSERT_EQ(0, pool_stats.in_use);
+
+    capture_source_t source;
+    TEST_ASSERT(replay_source_create(&source, BACKEND_TEST_RAW, 0) == 0);
+    TEST_ASSERT_EQ(width, source.width);
+    TEST_ASSERT_EQ(30, source.fps);
+    TEST_ASSERT(capture_source_set_pool(&source, &pool) == 0);
+    for (int i = 0; i < count; i++) {
+        frame_handle_t frame = FRAME_HANDLE_INVALID;
+        TEST_ASSERT_EQ(CAPTURE_FRAME_NEW, capture_source_get_frame(&source, &frame, 1));
+        TEST_ASSERT(memcmp(frame_pool_data(&pool, frame), written + frame_size * i, frame_size) == 0);
+        frame_pool_release(&pool, frame);
+    }
+    capture_source_destroy(&source);
+
+    free(written);
+    frame_pool_cleanup(&pool);
+    remove(BACKEND_TEST_RAW);
+    return 0;
+}
+
+static int test_spool_reads_back(void) {
+    const int width = 64, height = 48, count = 9;
+    size_t frame_size = (size_t)width * height * 4;
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, frame_size, 2) == 0);
+    uint8_t* written = (uint8_t*)malloc(frame_size * count);
+    uint8_t* pixels = (uint8_t*)malloc(frame_size);
+    TEST_ASSERT(written != NULL && pixels != NULL);
+
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_SPOOL) == 0);
+    encoder_backend_config_t config;
+    video_config(&config, BACKEND_TEST_SPOOL, width, height, ENCODER_INPUT_BGRA);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) == 0);
+    TEST_ASSERT(push_bgra(&backend, &pool, width, height, count, written) == 0);
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(&backend, &stats);
+    TEST_ASSERT(stats.bytes > 0);
+    encoder_backend_destroy(&backend);
+
+    capture_spool_reader_t reader;
+    TEST_ASSERT(capture_spool_reader_open(&reader, BACKEND_TEST_SPOOL) == 0);
+    TEST_ASSERT(reader.complete);
+    for (int i = 0; i < count; i++) {
+        capture_spool_frame_t frame;
+        TEST_ASSERT_EQ(1, capture_spool_reader_next(&reader, pixels, (size_t)width * 4, &frame));
+        TEST_ASSERT_EQ(FRAME_TIME(i), frame.time);
+        if (i % 3 == 2) TEST_ASSERT_EQ(0, frame.changed_tiles);
+        TEST_ASSERT(memcmp(pixels, written + frame_size * i, frame_size) == 0);
+    }
+    capture_spool_frame_t end;
+    TEST_ASSERT_EQ(0, capture_spool_reader_next(&reader, pixels, (size_t)width * 4, &end));
+    capture_spool_reader_close(&reader);
+
+    free(pixels);
+    free(written);
+    frame_pool_cleanup(&pool);
+    remove(BACKEND_TEST_SPOOL);
+    return 0;
+}
+
+typedef struct {
+    fixture_decoder_t decoder;
+    const uint8_t* expected;        // One NV12 picture per sample
+    size_t picture_size;
+    int width;
+    int height;
+    uint64_t samples;
+    uint64_t mismatches;
+} sample_check_t;
+
+static int check_sample(void* context, int track, uint64_t index, uint64_t time, const uint8_t* data,
+                        uint32_t size, uint32_t flags) {
+    sample_check_t* check = (sample_check_t*)context;
+    (void)time;
+    (void)flags;
+    if (track != FIXTURE_VIDEO) return 0;
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        uint32_t length = mp4_read_u32(data + offset);
+        if (length == 0 || length > size - offset - 4) return -1;
+        if (fixture_decode_nal(&check->decoder, data + offset + 4, length) != 0) return -1;
+        offset += 4 + length;
+    }
+    const uint8_t* picture = check->expected + check->picture_size * index;
+    const uint8_t* uv = picture + (size_t)check->width * check->height;
+    if (fixture_decoder_compare(&check->decoder, picture, (size_t)check->width, uv, (size_t)check->width) != 0) {
+        check->mismatches++;
+    }
+    check->samples++;
+    return 0;
+}
+
+// NV12 frames through the software encoder decode back to what went in
+static int test_h264_decodes(void) {
+    const int width = 96, height = 64, count = 12;
+    size_t picture_size = color_frame_size(COLOR_FORMAT_NV12, width, height);
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, picture_size, 2) == 0);
+    uint8_t* pictures = (uint8_t*)malloc(picture_size * count);
+    uint8_t* bgra = (uint8_t*)malloc((size_t)width * height * 4);
+    TEST_ASSERT(pictures != NULL && bgra != NULL);
+    color_converter_t converter;
+    TEST_ASSERT(color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) == 0);
+
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_H264) == 0);
+    TEST_ASSERT(encoder_backend_takes(&backend, ENCODER_INPUT_NV12));
+    encoder_backend_config_t config;
+    video_config(&config, BACKEND_TEST_MP4, width, height, ENCODER_INPUT_NV12);
+    config.keyframe_interval = 5;
+    TEST_ASSERT(encoder_backend_init(&backend, &config) == 0);
+    for (int i = 0; i < count; i++) {
+        uint8_t* picture = pictures + picture_size * i;
+        if (i % 4 == 3) {
+            memcpy(picture, picture - picture_size, picture_size);
+            TEST_ASSERT(encoder_backend_repeat_video(&backend, FRAME_TIME(i)) == 0);
+            continue;
+        }
+        draw_frame(bgra, width, height, i);
+        frame_handle_t frame = frame_pool_acquire(&pool);
+        TEST_ASSERT(frame != FRAME_HANDLE_INVALID);
+        color_planes_t planes;
+        color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(&pool, frame), width, height, &planes);
+        color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, bgra, (size_t)width * 4, width, height);
+        memcpy(picture, frame_pool_data(&pool, frame), picture_size);
+        TEST_ASSERT(encoder_backend_push_video(&backend, &pool, frame, FRAME_TIME(i)) == 0);
+        frame_pool_release(&pool, frame);
+    }
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+    encoder_backend_stats_t stats;
+    encoder_backend_get_stats(&backend, &stats);
+    TEST_ASSERT_EQ(9, stats.video_frames);
+    TEST_ASSERT_EQ(3, stats.repeated_frames);
+    encoder_backend_destroy(&backend);
+
+    size_t size;
+    uint8_t* data = read_file(BACKEND_TEST_MP4, &size);
+    TEST_ASSERT(data != NULL);
+    TEST_ASSERT_EQ(size, stats.bytes);
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, NULL, NULL) == 0);
+    TEST_ASSERT_EQ(width, info.width);
+    TEST_ASSERT_EQ(height, info.height);
+    TEST_ASSERT_EQ(0, info.tracks[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(count, info.samples[FIXTURE_VIDEO]);
+
+    sample_check_t check;
+    memset(&check, 0, sizeof(check));
+    check.expected = pictures;
+    check.picture_size = picture_size;
+    check.width = width;
+    check.height = height;
+    TEST_ASSERT(fixture_decode_nal(&check.decoder, info.sps, info.sps_size) == 0);
+    check.decoder.have_pps = 1;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, &check) == 0);
+    TEST_ASSERT_EQ(count, check.samples);
+    TEST_ASSERT_EQ(0, check.mismatches);
+
+    fixture_decoder_free(&check.decoder);
+    free(data);
+    free(bgra);
+    free(pictures);
+    frame_pool_cleanup(&pool);
+    remove(BACKEND_TEST_MP4);
+    return 0;
+}
+
+// As the engine's sink: each packet type to its own track
+static void replay_packet(void* context, int type, const uint8_t* data, size_t size, int64_t time) {
+    if (type == ENCODER_PACKET_AUDIO) {
+        replay_buffer_write_audio((replay_buffer_t*)context, data, size, time);
+    } else {
+        replay_buffer_write_video((replay_buffer_t*)context, data, size, time);
+    }
+}
+
+// Replay mode: packets reach the sink and no file is written until the buffer saves one
+static int test_h264_packet_sink(void) {
+    const int width = 64, height = 32, count = 20;
+    size_t picture_size = color_frame_size(COLOR_FORMAT_NV12, width, height);
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, picture_size, 2) == 0);
+    replay_buffer_t replay;
+    replay_config_t replay_config = { 1024 * 1024, 0, 0, 1, 0, 0 };
+    TEST_ASSERT(replay_buffer_init(&replay, &replay_config) == 0);
+
+    remove(BACKEND_TEST_MP4);
+    encoder_backend_t backend;
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_H264) == 0);
+    encoder_backend_set_packet_sink(&backend, replay_packet, &replay);
+    encoder_backend_config_t config;
+    video_config(&config, BACKEND_TEST_MP4, width, height, ENCODER_INPUT_NV12);
+    config.keyframe_interval = 5;
+    config.packets_only = 1;
+    TEST_ASSERT(encoder_backend_init(&backend, &config) == 0);
+    for (int i = 0; i < count; i++) {
+        frame_handle_t frame = frame_pool_acquire(&pool);
+        TEST_ASSERT(frame != FRAME_HANDLE_INVALID);
+        memset(frame_pool_data(&pool, frame), 16 + i * 8, picture_size);
+        TEST_ASSERT(encoder_backend_push_video(&backend, &pool, frame, FRAME_TIME(i)) == 0);
+        frame_pool_release(&pool, frame);
+    }
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+    encoder_backend_destroy(&backend);
+    FILE* file = fopen(BACKEND_TEST_MP4, "rb");
+    TEST_ASSERT(file == NULL);
+
+    replay_stats_t replay_stats;
+    replay_buffer_get_stats(&replay, &replay_stats);
+    TEST_ASSERT_EQ(count, replay_stats.packets);
+    replay_save_result_t result;
+    TEST_ASSERT(replay_buffer_save(&replay, BACKEND_TEST_MP4, &result) == 0);
+    TEST_ASSERT_EQ(count, result.video_frames);
+    replay_buffer_cleanup(&replay);
+
+    size_t size;
+    uint8_t* data = read_file(BACKEND_TEST_MP4, &size);
+    TEST_ASSERT(data != NULL);
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, NULL, NULL) == 0);
+    TEST_ASSERT_EQ(width, info.width);
+    TEST_ASSERT_EQ(count, info.samples[FIXTURE_VIDEO]);
+    free(data);
+    frame_pool_cleanup(&pool);
+    remove(BACKEND_TEST_MP4);
+    return 0;
+}
+
+static int test_rejections(void) {
+    encoder_backend_config_t config;
+    encoder_backend_t backend;
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, 64 * 32 * 4, 1) == 0);
+    frame_handle_t frame = frame_pool_acquire(&pool);
+
+    // Never created: every helper refuses or does nothing
+    memset(&backend, 0, sizeof(backend));
+    video_config(&config, BACKEND_TEST_MP4, 64, 32, ENCODER_INPUT_BGRA);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    TEST_ASSERT(encoder_backend_push_video(&backend, &pool, frame, 0) != 0);
+    TEST_ASSERT(encoder_backend_finalize(&backend) != 0);
+    encoder_backend_report(&backend, NULL);
+    encoder_backend_destroy(&backend);
+    TEST_ASSERT(encoder_backend_init(NULL, &config) != 0);
+
+    // Pushed before init
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_NULL) == 0);
+    TEST_ASSERT(encoder_backend_push_video(&backend, &pool, frame, 0) != 0);
+    TEST_ASSERT(encoder_backend_finalize(&backend) == 0);
+    encoder_backend_destroy(&backend);
+
+    // Formats and streams a backend does not take
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_H264) == 0);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    video_config(&config, BACKEND_TEST_MP4, 63, 32, ENCODER_INPUT_NV12);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    encoder_backend_destroy(&backend);
+
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_RAW) == 0);
+    video_config(&config, BACKEND_TEST_RAW, 64, 32, ENCODER_INPUT_NV12);
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    video_config(&config, BACKEND_TEST_RAW, 64, 32, ENCODER_INPUT_BGRA);
+    config.audio_streams = 1;
+    config.sample_rate = 48000;
+    config.channels = 2;
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    TEST_ASSERT(!backend.open);
+    encoder_backend_destroy(&backend);
+
+    TEST_ASSERT(encoder_backend_create(&backend, ENCODER_BACKEND_NULL) == 0);
+    video_config(&config, BACKEND_TEST_MP4, 64, 32, ENCODER_INPUT_BGRA);
+    config.audio_streams = 3;
+    config.sample_rate = 48000;
+    config.channels = 2;
+    TEST_ASSERT(encoder_backend_init(&backend, &config) != 0);
+    encoder_backend_destroy(&backend);
+
+    frame_pool_release(&pool, frame);
+    frame_pool_cleanup(&pool);
+    remove(BACKEND_TEST_RAW);
+    remove(BACKEND_TEST_MP4);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+    RUN_TEST(test_names);
+    RUN_TEST(test_null_counts);
+    RUN_TEST(test_raw_replays);
+    RUN_TEST(test_spool_reads_back);
+    RUN_TEST(test_h264_decodes);
+    RUN_TEST(test_h264_packet_sink);
+    RUN_TEST(test_rejections);
+    return failures ? 1 : 0;
+}
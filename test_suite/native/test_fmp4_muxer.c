@@ -0,0 +1,426 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "fmp4_muxer.h"
+#include <stdio.h>
+
+#define MUXER_TEST_FILE "test_fmp4_muxer.mp4"
+#define FRAME_TIME(frame, fps) ((int64_t)(frame) * 10000000 / (fps))
+
+// Expected content, regenerated from the fixture generators per sample
+typedef struct {
+    int gop;                        // Keyframe every gop frames
+    size_t slice_base;
+    uint64_t first_frame;           // Frame number of the first stored video sample
+    uint64_t first_audio;
+} expect_t;
+
+static int check_sample(void* context, int track, uint64_t index, uint64_t time,
+                        const uint8_t* data, uint32_t size, uint32_t flags) {
+    const expect_t* expect = (const expect_t*)context;
+    static uint8_t payload[65536];
+    (void)time;
+
+    if (track == FIXTURE_AUDIO) {
+        uint64_t frame = expect->first_audio + index;
+        if (size != fixture_aac_size(frame)) return -1;
+        fixture_aac_payload(frame, payload, size);
+        return memcmp(payload, data, size) == 0 ? 0 : -1;
+    }
+
+    // One length-prefixed slice: AUD, SPS and PPS are not stored in samples
+    uint64_t frame = expect->first_frame + index;
+    int keyframe = frame % (uint64_t)expect->gop == 0;
+    size_t slice = fixture_slice_size(frame, keyframe, expect->slice_base);
+    if (size != 4 + 1 + slice || mp4_read_u32(data) != 1 + slice) return -1;
+    if (data[4] != (keyframe ? 0x65 : 0x41)) return -1;
+    if (keyframe != !(flags & 0x00010000)) return -1;
+    if (slice > sizeof(payload)) return -1;
+    fixture_slice_payload(frame, payload, slice);
+    return memcmp(payload, data + 5, slice) == 0 ? 0 : -1;
+}
+
+// Feed video at fps with a keyframe every gop frames, and AAC frames as
+// their time comes due, the way an encoder's two outputs interleave
+static int feed(fmp4_muxer_t* muxer, int fps, int gop, size_t slice_base, uint64_t frames,
+                uint32_t sample_rate, uint64_t* audio_frames) {
+    static uint8_t unit[65536];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 42, 1920, 1080);
+    uint64_t audio = 0;
+
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        int keyframe = frame % (uint64_t)gop == 0;
+        size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframe,
+                                          fixture_slice_size(frame, keyframe, slice_base), sps, sps_size);
+        if (size == 0 || fmp4_muxer_write_video(muxer, unit, size, FRAME_TIME(frame, fps)) != 0) return -1;
+
+        while (sample_rate && audio * AAC_SAMPLES_PER_FRAME * (uint64_t)fps <= (frame + 1) * sample_rate) {
+            size = fixture_adts_frame(unit, audio, sample_rate, 2);
+            if (fmp4_muxer_write_audio(muxer, unit, size) != 0) return -1;
+            audio++;
+        }
+    }
+    if (audio_frames) *audio_frames = audio;
+    return 0;
+}
+
+static int test_sps_parse(void) {
+    uint8_t sps[FIXTURE_MAX_SPS + 1];
+    h264_sps_info_t info;
+
+    size_t size = fixture_sps(sps, 100, 0, 42, 1920, 1080);
+    TEST_ASSERT(h264_parse_sps(sps, size, &info) == 0);
+    TEST_ASSERT_EQ(100, info.profile_idc);
+    TEST_ASSERT_EQ(42, info.level_idc);
+    TEST_ASSERT_EQ(1, info.chroma_format_idc);
+    TEST_ASSERT_EQ(8, info.bit_depth_luma);
+    TEST_ASSERT_EQ(1920, info.width);
+    TEST_ASSERT_EQ(1080, info.height);
+
+    size = fixture_sps(sps, 66, 0xC0, 30, 1366, 768);
+    TEST_ASSERT(h264_parse_sps(sps, size, &info) == 0);
+    TEST_ASSERT_EQ(66, info.profile_idc);
+    TEST_ASSERT_EQ(0xC0, info.constraint_flags);
+    TEST_ASSERT_EQ(1366, info.width);
+    TEST_ASSERT_EQ(768, info.height);
+
+    // An emulation prevention byte after 00 00 is skipped
+    size = fixture_sps(sps, 66, 0, 0, 640, 480);
+    TEST_ASSERT(sps[2] == 0 && sps[3] == 0);
+    memmove(sps + 5, sps + 4, size - 4);
+    sps[4] = 3;
+    TEST_ASSERT(h264_parse_sps(sps, size + 1, &info) == 0);
+    TEST_ASSERT_EQ(640, info.width);
+    TEST_ASSERT_EQ(480, info.height);
+
+    // Truncated or not an SPS
+    TEST_ASSERT(h264_parse_sps(sps, 5, &info) != 0);
+    TEST_ASSERT(h264_parse_sps(fixture_pps, sizeof(fixture_pps), &info) != 0);
+    return 0;
+}
+
+static int test_annexb_split(void) {
+    uint8_t sps[FIXTURE_MAX_SPS];
+    uint8_t unit[1024];
+    size_t sps_size = fixture_sps(sps, 66, 0, 30, 320, 240);
+    size_t size = fixture_access_unit(unit, sizeof(unit), 7, 1, 100, sps, sps_size);
+    TEST_ASSERT(size > 0);
+    TEST_ASSERT(h264_is_keyframe(unit, size));
+
+    // AUD, SPS, PPS (behind a 3-byte start code), IDR slice
+    const int types[] = { H264_NAL_AUD, H264_NAL_SPS, H264_NAL_PPS, H264_NAL_IDR };
+    const size_t sizes[] = { 2, sps_size, sizeof(fixture_pps), 101 };
+    size_t offset = 0;
+    const uint8_t* nal;
+    size_t nal_size;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQ(1, h264_next_nal(unit, size, &offset, &nal, &nal_size));
+        TEST_ASSERT_EQ(types[i], H264_NAL_TYPE(nal[0]));
+        TEST_ASSERT_EQ(sizes[i], nal_size);
+    }
+    TEST_ASSERT_EQ(0, h264_next_nal(unit, size, &offset, &nal, &nal_size));
+
+    size = fixture_access_unit(unit, sizeof(unit), 8, 0, 100, sps, sps_size);
+    TEST_ASSERT(!h264_is_keyframe(unit, size));
+    return 0;
+}
+
+static int test_adts(void) {
+    uint8_t frame[1024];
+    aac_adts_header_t header;
+    size_t size = fixture_adts_frame(frame, 3, 48000, 2);
+    TEST_ASSERT_EQ(0, aac_adts_parse(frame, size, &header));
+    TEST_ASSERT_EQ(AAC_OBJECT_TYPE_LC, header.object_type);
+    TEST_ASSERT_EQ(48000, header.sample_rate);
+    TEST_ASSERT_EQ(2, header.channels);
+    TEST_ASSERT_EQ(AAC_ADTS_HEADER_SIZE, header.header_size);
+    TEST_ASSERT_EQ(size, header.frame_size);
+
+    // Cut short, or not ADTS at all
+    TEST_ASSERT_EQ(1, aac_adts_parse(frame, size - 1, &header));
+    frame[1] = 0x00;
+    TEST_ASSERT_EQ(-1, aac_adts_parse(frame, size, &header));
+
+    uint8_t config[2];
+    TEST_ASSERT(aac_audio_specific_config(AAC_OBJECT_TYPE_LC, 48000, 2, config) == 0);
+    TEST_ASSERT(config[0] == 0x11 && config[1] == 0x90);
+    TEST_ASSERT(aac_audio_specific_config(AAC_OBJECT_TYPE_LC, 44100, 1, config) == 0);
+    TEST_ASSERT(config[0] == 0x12 && config[1] == 0x08);
+    TEST_ASSERT(aac_audio_specific_config(AAC_OBJECT_TYPE_LC, 12345, 2, config) != 0);
+    return 0;
+}
+
+static int test_box_reader(void) {
+    mp4_buffer_t buffer;
+    mp4_buffer_init(&buffer);
+    size_t outer = mp4_box_begin(&buffer, MP4_FOURCC('m', 'o', 'o', 'v'));
+    size_t inner = mp4_full_box_begin(&buffer, MP4_FOURCC('m', 'v', 'h', 'd'), 1, 0x000102);
+    mp4_put_u64(&buffer, 0x0102030405060708ULL);
+    mp4_box_end(&buffer, inner);
+    mp4_box_end(&buffer, mp4_box_begin(&buffer, MP4_FOURCC('f', 'r', 'e', 'e')));
+    mp4_box_end(&buffer, outer);
+    TEST_ASSERT(!buffer.failed);
+    TEST_ASSERT_EQ(8 + 20 + 8, buffer.size);
+
+    mp4_box_t box, child;
+    TEST_ASSERT_EQ(0, mp4_box_parse(buffer.data, buffer.size, &box));
+    TEST_ASSERT_EQ(MP4_FOURCC('m', 'o', 'o', 'v'), box.type);
+    TEST_ASSERT(mp4_box_find(box.payload, box.payload_size, MP4_FOURCC('m', 'v', 'h', 'd'), &child) == 0);
+    TEST_ASSERT_EQ(1, child.payload[0]);
+    TEST_ASSERT_EQ(0x000102, mp4_read_u24(child.payload + 1));
+    TEST_ASSERT(mp4_read_u64(child.payload + 4) == 0x0102030405060708ULL);
+    TEST_ASSERT(mp4_box_find(box.payload, box.payload_size, MP4_FOURCC('f', 'r', 'e', 'e'), &child) == 0);
+    TEST_ASSERT(mp4_box_find(box.payload, box.payload_size, MP4_FOURCC('t', 'r', 'a', 'k'), &child) != 0);
+
+    // A box cut short says how big it should have been
+    TEST_ASSERT_EQ(1, mp4_box_parse(buffer.data, buffer.size - 3, &box));
+    TEST_ASSERT_EQ(buffer.size, box.size);
+    TEST_ASSERT_EQ(-1, mp4_box_parse(buffer.data, 7, &box));
+
+    char text[5];
+    mp4_fourcc_string(MP4_FOURCC('t', 'r', 'u', 'n'), text);
+    TEST_ASSERT(strcmp(text, "trun") == 0);
+    mp4_buffer_free(&buffer);
+    return 0;
+}
+
+// 10 s of 1080p30 with a keyframe per second, and 48 kHz stereo AAC
+static int test_audio_video_fragments(void) {
+    fixture_output_t output = { 0 };
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 1000, 0, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+
+    uint64_t audio_frames = 0;
+    TEST_ASSERT(feed(&muxer, 30, 30, 800, 300, 48000, &audio_frames) == 0);
+
+    // Fragments were written while recording, not at the end
+    uint64_t streamed = output.size;
+    TEST_ASSERT_EQ(9, muxer.stats.fragments);
+    TEST_ASSERT(streamed > 0);
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+    TEST_ASSERT_EQ(10, muxer.stats.fragments);
+    TEST_ASSERT_EQ(0, muxer.stats.forced_fragments);
+    TEST_ASSERT(output.size - streamed < output.size / 5);
+
+    fixture_mp4_t info;
+    expect_t expect = { 30, 800, 0, 0 };
+    int parsed = fixture_parse_fmp4(output.data, output.size, 0, &info, check_sample, &expect);
+    if (parsed != 0) fprintf(stderr, "fMP4 check: %s\n", info.error);
+    TEST_ASSERT(parsed == 0);
+    TEST_ASSERT_EQ(output.size, info.bytes);
+    TEST_ASSERT_EQ(10, info.fragments);
+
+    // moov describes both streams
+    TEST_ASSERT(info.tracks[FIXTURE_VIDEO] && info.tracks[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(1920, info.width);
+    TEST_ASSERT_EQ(1080, info.height);
+    TEST_ASSERT_EQ(FMP4_VIDEO_TIMESCALE, info.timescales[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(48000, info.timescales[FIXTURE_AUDIO]);
+    TEST_ASSERT(info.audio_config[0] == 0x11 && info.audio_config[1] == 0x90);
+    TEST_ASSERT_EQ(2, info.channels);
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 42, 1920, 1080);
+    TEST_ASSERT_EQ(sps_size, info.sps_size);
+    TEST_ASSERT(memcmp(sps, info.sps, sps_size) == 0);
+
+    // Every sample, every fragment on a keyframe, timelines continuous
+    TEST_ASSERT_EQ(300, info.samples[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(audio_frames, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(info.video_runs, info.sync_starts);
+    TEST_ASSERT_EQ(0, info.first_time[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(10 * FMP4_VIDEO_TIMESCALE, info.end_time[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(audio_frames * AAC_SAMPLES_PER_FRAME, info.end_time[FIXTURE_AUDIO]);
+
+    fmp4_muxer_cleanup(&muxer);
+    fixture_output_free(&output);
+    return 0;
+}
+
+// Large frames and no keyframes after the first: the byte budget and the
+// twice-fragment_ms rule cut fragments mid-GOP, and memory stays bounded
+static int test_bounded_buffering(void) {
+    fixture_output_t output = { 0 };
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 1000, 256 * 1024, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+
+    uint64_t audio_frames = 0;
+    TEST_ASSERT(feed(&muxer, 60, 100000, 12000, 600, 48000, &audio_frames) == 0);
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+
+    // ~12 KB per frame: a fragment closes about every 21 frames
+    TEST_ASSERT(muxer.stats.fragments > 20);
+    TEST_ASSERT(muxer.stats.forced_fragments > 20);
+    TEST_ASSERT(muxer.stats.peak_buffered <= config.max_buffered_bytes + 16 * 1024);
+
+    fixture_mp4_t info;
+    expect_t expect = { 100000, 12000, 0, 0 };
+    int parsed = fixture_parse_fmp4(output.data, output.size, 0, &info, check_sample, &expect);
+    if (parsed != 0) fprintf(stderr, "fMP4 check: %s\n", info.error);
+    TEST_ASSERT(parsed == 0);
+    TEST_ASSERT_EQ(600, info.samples[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(audio_frames, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(1, info.sync_starts);
+    TEST_ASSERT_EQ(10 * FMP4_VIDEO_TIMESCALE, info.end_time[FIXTURE_VIDEO]);
+    fmp4_muxer_cleanup(&muxer);
+    fixture_output_free(&output);
+
+    // Small frames with a 10 s GOP: cut by time at twice the fragment length
+    memset(&output, 0, sizeof(output));
+    config.audio = 0;
+    config.max_buffered_bytes = 0;
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+    TEST_ASSERT(feed(&muxer, 30, 300, 200, 300, 0, NULL) == 0);
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+    TEST_ASSERT_EQ(5, muxer.stats.fragments);
+    TEST_ASSERT_EQ(4, muxer.stats.forced_fragments);
+    fmp4_muxer_cleanup(&muxer);
+    fixture_output_free(&output);
+    return 0;
+}
+
+// Video before the first keyframe is dropped; audio keeps its timeline
+static int test_waits_for_keyframe(void) {
+    fixture_output_t output = { 0 };
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 500, 0, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+
+    static uint8_t unit[8192];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 66, 0, 30, 640, 360);
+    uint64_t audio = 0;
+    for (uint64_t frame = 5; frame < 65; frame++) {
+        // Keyframes at 10, 40
+        int keyframe = frame % 30 == 10;
+        size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframe, 300, sps, sps_size);
+        TEST_ASSERT(fmp4_muxer_write_video(&muxer, unit, size, FRAME_TIME(frame, 30)) == 0);
+        while (audio * AAC_SAMPLES_PER_FRAME * 30 <= (frame + 1) * 48000) {
+            size = fixture_adts_frame(unit, audio, 48000, 2);
+            TEST_ASSERT(fmp4_muxer_write_audio(&muxer, unit, size) == 0);
+            audio++;
+        }
+    }
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+    TEST_ASSERT_EQ(5, muxer.stats.dropped_video);
+
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(output.data, output.size, 0, &info, NULL, NULL) == 0);
+    TEST_ASSERT_EQ(640, info.width);
+    TEST_ASSERT_EQ(360, info.height);
+    TEST_ASSERT_EQ(55, info.samples[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(audio, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(FMP4_VIDEO_TIMESCALE / 3, info.first_time[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(0, info.first_time[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(2, info.fragments);
+    TEST_ASSERT_EQ(2, info.sync_starts);
+    fmp4_muxer_cleanup(&muxer);
+    fixture_output_free(&output);
+    return 0;
+}
+
+// Audio alone, as raw frames with a configured format, streamed to a file
+static int test_audio_only_file(void) {
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 0, 1, 44100, 1, 1000, 0, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_open(&muxer, &config, MUXER_TEST_FILE) == 0);
+
+    uint8_t payload[512];
+    for (uint64_t i = 0; i < 431; i++) {
+        size_t size = fixture_aac_size(i);
+        fixture_aac_payload(i, payload, size);
+        TEST_ASSERT(fmp4_muxer_write_audio(&muxer, payload, size) == 0);
+    }
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+    TEST_ASSERT(fmp4_muxer_write_video(&muxer, payload, 16, 0) != 0);
+    fmp4_muxer_cleanup(&muxer);
+
+    FILE* file = fopen(MUXER_TEST_FILE, "rb");
+    TEST_ASSERT(file != NULL);
+    static uint8_t data[262144];
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    remove(MUXER_TEST_FILE);
+
+    fixture_mp4_t info;
+    expect_t expect = { 1, 0, 0, 0 };
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, &expect) == 0);
+    TEST_ASSERT(!info.tracks[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(431, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(44100, info.timescales[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(1, info.channels);
+    // 1000 ms of 44.1 kHz is 43.07 frames: fragments close on the 44th
+    TEST_ASSERT_EQ(10, info.fragments);
+    return 0;
+}
+
+// Every prefix of a finished file parses up to its last complete fragment
+static int test_truncated_prefix(void) {
+    fixture_output_t output = { 0 };
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 200, 0, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+    TEST_ASSERT(feed(&muxer, 30, 6, 100, 60, 48000, NULL) == 0);
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) == 0);
+    fmp4_muxer_cleanup(&muxer);
+
+    // From the end of the moov, one cut every 97 bytes
+    mp4_box_t ftyp, moov;
+    TEST_ASSERT(mp4_box_parse(output.data, output.size, &ftyp) == 0);
+    TEST_ASSERT(mp4_box_parse(output.data + ftyp.size, output.size - ftyp.size, &moov) == 0);
+    fixture_mp4_t info;
+    uint64_t last_samples = 0;
+    for (size_t cut = (size_t)(ftyp.size + moov.size); cut <= output.size; cut += 97) {
+        TEST_ASSERT(fixture_parse_fmp4(output.data, cut, 1, &info, NULL, NULL) == 0);
+        TEST_ASSERT(info.samples[FIXTURE_VIDEO] >= last_samples);
+        last_samples = info.samples[FIXTURE_VIDEO];
+    }
+    TEST_ASSERT(fixture_parse_fmp4(output.data, output.size - 1, 0, &info, NULL, NULL) != 0);
+    fixture_output_free(&output);
+    return 0;
+}
+
+static int test_invalid_input(void) {
+    fixture_output_t output = { 0 };
+    fmp4_muxer_t muxer;
+    fmp4_config_t none = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    fmp4_config_t config = { 1, 0, 0, 0, 0, 0, 0, 0 };
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &none, fixture_output_write, &output) != 0);
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, NULL, &output) != 0);
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+
+    // Audio on a video-only muxer; non-increasing timestamps
+    uint8_t unit[2048];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 66, 0, 30, 320, 240);
+    size_t size = fixture_access_unit(unit, sizeof(unit), 0, 1, 64, sps, sps_size);
+    TEST_ASSERT(fmp4_muxer_write_audio(&muxer, unit, size) != 0);
+    TEST_ASSERT(fmp4_muxer_write_video(&muxer, unit, size, 1000000) == 0);
+    TEST_ASSERT(fmp4_muxer_write_video(&muxer, unit, size, 1000000) != 0);
+    fmp4_muxer_cleanup(&muxer);
+
+    // Nothing to write
+    TEST_ASSERT(fmp4_muxer_init(&muxer, &config, fixture_output_write, &output) == 0);
+    TEST_ASSERT(fmp4_muxer_finish(&muxer) != 0);
+    fmp4_muxer_cleanup(&muxer);
+    fixture_output_free(&output);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_sps_parse);
+    RUN_TEST(test_annexb_split);
+    RUN_TEST(test_adts);
+    RUN_TEST(test_box_reader);
+    RUN_TEST(test_audio_video_fragments);
+    RUN_TEST(test_bounded_buffering);
+    RUN_TEST(test_waits_for_keyframe);
+    RUN_TEST(test_audio_only_file);
+    RUN_TEST(test_truncated_prefix);
+    RUN_TEST(test_invalid_input);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "test_common.h"
+#include "fps_meter.h"
+#include <string.h>
+
+#define MS(value) ((uint64_t)(value) * 1000000ULL)
+
+static char last_report[256];
+
+static void capture_report(const char* message) {
+    strncpy(last_report, message, sizeof(last_report) - 1);
+    last_report[sizeof(last_report) - 1] = '\0';
+}
+
+static int test_init_validation(void) {
+    fps_meter_t meter;
+    TEST_ASSERT(fps_meter_init(NULL, 60) != 0);
+    TEST_ASSERT(fps_meter_init(&meter, 0) != 0);
+    TEST_ASSERT(fps_meter_init(&meter, 240) == 0);
+
+    // Updates before start are ignored
+    TEST_ASSERT_EQ(0, fps_meter_update(&meter, MS(5000), 1000));
+    TEST_ASSERT_EQ(0, (int)meter.windows);
+    return 0;
+}
+
+static int test_per_second_windows(void) {
+    fps_meter_t meter;
+    TEST_ASSERT(fps_meter_init(&meter, 240) == 0);
+    fps_meter_start(&meter, MS(100));
+
+    // Polled every 10 ms like the engine's supervisor; 240 frames in the first second
+    uint64_t frames = 0;
+    int closed = 0;
+    for (int tick = 1; tick <= 100; tick++) {
+        frames = (uint64_t)tick * 240 / 100;
+        closed += fps_meter_update(&meter, MS(100) + MS(tick * 10), frames);
+    }
+    TEST_ASSERT_EQ(1, closed);
+    TEST_ASSERT(meter.last_fps > 239.9 && meter.last_fps < 240.1);
+
+    // A second at 200 fps is short, one at 235 is not
+    TEST_ASSERT_EQ(1, fps_meter_update(&meter, MS(2100), frames + 200));
+    TEST_ASSERT(meter.last_fps > 199.9 && meter.last_fps < 200.1);
+    TEST_ASSERT_EQ(0, fps_meter_update(&meter, MS(2600), frames + 300));
+    TEST_ASSERT_EQ(1, fps_meter_update(&meter, MS(3100), frames + 435));
+    TEST_ASSERT_EQ(3, (int)meter.windows);
+    TEST_ASSERT_EQ(1, (int)meter.short_windows);
+    TEST_ASSERT(meter.min_fps > 199.9 && meter.min_fps < 200.1);
+    TEST_ASSERT(meter.max_fps > 239.9 && meter.max_fps < 240.1);
+
+    // 675 frames in 3 s
+    TEST_ASSERT(fps_meter_average(&meter, MS(3100)) > 224.9 && fps_meter_average(&meter, MS(3100)) < 225.1);
+    fps_meter_report(&meter, MS(3100), capture_report);
+    TEST_ASSERT(strstr(last_report, "225.0 of 240 fps requested") != NULL);
+    TEST_ASSERT(strstr(last_report, "1 of 3 seconds below 95%") != NULL);
+    return 0;
+}
+
+// A stalled poller closes one long window at its true rate
+static int test_late_update(void) {
+    fps_meter_t meter;
+    TEST_ASSERT(fps_meter_init(&meter, 144) == 0);
+    fps_meter_start(&meter, 0);
+    TEST_ASSERT_EQ(1, fps_meter_update(&meter, MS(2500), 360));
+    TEST_ASSERT(meter.last_fps > 143.9 && meter.last_fps < 144.1);
+    TEST_ASSERT_EQ(0, (int)meter.short_windows);
+
+    // Short recordings report the average alone
+    fps_meter_start(&meter, 0);
+    fps_meter_update(&meter, MS(500), 72);
+    fps_meter_report(&meter, MS(500), capture_report);
+    TEST_ASSERT(strcmp(last_report, "Frame rate: 144.0 of 144 fps requested") == 0);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_per_second_windows);
+    RUN_TEST(test_late_update);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include "test_common.h"
+#include "frame_pacer.h"
+#include <stdint.h>
+
+#define SECONDS(value) ((uint64_t)(value) * FRAME_PACER_NS_PER_SECOND)
+#define DAY_SECONDS (24ULL * 60 * 60)
+
+// Simulated clock: waking takes `lateness` past the deadline, and `stall`
+// is added once to the next wait to model a thread that was held up
+typedef struct {
+    uint64_t now;
+    uint64_t lateness;
+    uint64_t stall;
+    uint64_t waits;
+} fake_clock_t;
+
+static uint64_t fake_now(void* context) {
+    return ((fake_clock_t*)context)->now;
+}
+
+static void fake_wait_until(void* context, uint64_t deadline_ns) {
+    fake_clock_t* clock = (fake_clock_t*)context;
+    if (deadline_ns > clock->now) clock->now = deadline_ns;
+    clock->now += clock->lateness + clock->stall;
+    clock->stall = 0;
+    clock->waits++;
+}
+
+static void fake_clock_init(fake_clock_t* fake, frame_clock_t* clock, uint64_t start) {
+    fake->now = start;
+    fake->lateness = 0;
+    fake->stall = 0;
+    fake->waits = 0;
+    clock->now_ns = fake_now;
+    clock->wait_until_ns = fake_wait_until;
+    clock->context = fake;
+}
+
+static int test_init_validation(void) {
+    frame_pacer_t pacer;
+    frame_clock_t clock = { NULL, NULL, NULL };
+    frame_pacer_tick_t tick;
+    TEST_ASSERT(frame_pacer_init(NULL, 60, 1, NULL) != 0);
+    TEST_ASSERT(frame_pacer_init(&pacer, 0, 1, NULL) != 0);
+    TEST_ASSERT(frame_pacer_init(&pacer, 60, 0, NULL) != 0);
+    TEST_ASSERT(frame_pacer_init(&pacer, 60, 1, &clock) != 0);
+    TEST_ASSERT(frame_pacer_wait(&pacer, &tick) != 0);
+
+    // The platform clock paces real frames too
+    TEST_ASSERT(frame_pacer_init(&pacer, 500, 1, NULL) == 0);
+    frame_pacer_start(&pacer);
+    for (int i = 0; i < 3; i++) TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT(frame_pacer_elapsed_ns(&pacer) >= frame_pacer_frame_time_ns(&pacer, 2));
+    frame_pacer_cleanup(&pacer);
+    return 0;
+}
+
+static int test_exact_frame_times(void) {
+    frame_pacer_t pacer;
+    TEST_ASSERT(frame_pacer_init(&pacer, 60, 1, NULL) == 0);
+    TEST_ASSERT_EQ(0, frame_pacer_frame_time_ns(&pacer, 0));
+    TEST_ASSERT_EQ(16666666, frame_pacer_frame_time_ns(&pacer, 1));
+    TEST_ASSERT_EQ(33333333, frame_pacer_frame_time_ns(&pacer, 2));
+    TEST_ASSERT_EQ(SECONDS(1), frame_pacer_frame_time_ns(&pacer, 60));
+    frame_pacer_cleanup(&pacer);
+
+    // NTSC rates land on whole seconds every 30000 frames
+    TEST_ASSERT(frame_pacer_init(&pacer, 30000, 1001, NULL) == 0);
+    TEST_ASSERT_EQ(33366666, frame_pacer_frame_time_ns(&pacer, 1));
+    TEST_ASSERT_EQ(SECONDS(1001), frame_pacer_frame_time_ns(&pacer, 30000));
+    TEST_ASSERT_EQ(SECONDS(1001) * 86, frame_pacer_frame_time_ns(&pacer, 30000ULL * 86));
+    frame_pacer_cleanup(&pacer);
+    return 0;
+}
+
+static int test_frames_within(void) {
+    TEST_ASSERT_EQ(1, frame_pacer_frames_within(30, 1, 16));
+    TEST_ASSERT_EQ(2, frame_pacer_frames_within(120, 1, 16));
+    TEST_ASSERT_EQ(3, frame_pacer_frames_within(144, 1, 16));
+    TEST_ASSERT_EQ(4, frame_pacer_frames_within(240, 1, 16));
+    TEST_ASSERT_EQ(8, frame_pacer_frames_within(240, 1, 33));
+    TEST_ASSERT_EQ(1, frame_pacer_frames_within(30000, 1001, 33));   // 0.989 frames
+    TEST_ASSERT_EQ(0, frame_pacer_frames_within(60, 1, 0));
+    TEST_ASSERT_EQ(0, frame_pacer_frames_within(60, 0, 16));
+    return 0;
+}
+
+// A day at 60 fps on the simulated clock, waking 3 ms late every frame: the
+// schedule is absolute, so lateness never accumulates and the last frame of
+// the day is due at exactly 86400 s. Adding a 16 ms interval per frame would
+// have ended the day an hour early.
+static int test_no_drift_over_a_day(void) {
+    fake_clock_t fake;
+    frame_clock_t clock;
+    fake_clock_init(&fake, &clock, SECONDS(12345));
+    fake.lateness = 3000000;
+
+    frame_pacer_t pacer;
+    TEST_ASSERT(frame_pacer_init(&pacer, 60, 1, &clock) == 0);
+    frame_pacer_start(&pacer);
+
+    const uint64_t frames = DAY_SECONDS * 60;
+    frame_pacer_tick_t tick;
+    for (uint64_t n = 0; n <= frames; n++) {
+        TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+        if (tick.index != n || tick.time_ns != n * FRAME_PACER_NS_PER_SECOND / 60) {
+            fprintf(stderr, "frame %llu: index %llu, time %llu\n", (unsigned long long)n,
+                    (unsigned long long)tick.index, (unsigned long long)tick.time_ns);
+            return 1;
+        }
+    }
+    TEST_ASSERT_EQ(SECONDS(DAY_SECONDS), tick.time_ns);
+    TEST_ASSERT_EQ(SECONDS(DAY_SECONDS) + 3000000, frame_pacer_elapsed_ns(&pacer));
+
+    frame_pacer_stats_t stats;
+    frame_pacer_get_stats(&pacer, &stats);
+    TEST_ASSERT_EQ(frames + 1, stats.frames);
+    TEST_ASSERT_EQ(0, stats.skipped);
+    TEST_ASSERT_EQ(3000000, stats.max_jitter_ns);
+    TEST_ASSERT_EQ(1, stats.jitter_buckets[0]);                     // Frame 0 is due at start
+    TEST_ASSERT_EQ(frames, stats.jitter_buckets[4]);                // Every wake after it 3 ms late
+    TEST_ASSERT_EQ(frames * 3000000, stats.total_jitter_ns);
+    frame_pacer_cleanup(&pacer);
+    return 0;
+}
+
+// Same for 30000/1001, checked at every whole-second boundary of the day
+static int test_no_drift_ntsc(void) {
+    fake_clock_t fake;
+    frame_clock_t clock;
+    fake_clock_init(&fake, &clock, 0);
+
+    frame_pacer_t pacer;
+    TEST_ASSERT(frame_pacer_init(&pacer, 30000, 1001, &clock) == 0);
+    frame_pacer_start(&pacer);
+
+    frame_pacer_tick_t tick;
+    uint64_t n = 0;
+    for (; frame_pacer_frame_time_ns(&pacer, n) <= SECONDS(DAY_SECONDS); n++) {
+        TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+        TEST_ASSERT_EQ(n, tick.index);
+        if (n % 30000 == 0) TEST_ASSERT_EQ(SECONDS(1001) * (n / 30000), tick.time_ns);
+    }
+    TEST_ASSERT_EQ(2589411, n);                                     // floor(86400 * 30000 / 1001) + 1 frames
+    TEST_ASSERT_EQ(0, pacer.stats.total_jitter_ns);
+    frame_pacer_cleanup(&pacer);
+    return 0;
+}
+
+// A stalled caller resumes on the latest due slot instead of bursting
+static int test_skips_after_stall(void) {
+    fake_clock_t fake;
+    frame_clock_t clock;
+    fake_clock_init(&fake, &clock, SECONDS(1));
+
+    frame_pacer_t pacer;
+    TEST_ASSERT(frame_pacer_init(&pacer, 50, 1, &clock) == 0);       // 20 ms slots
+    frame_pacer_start(&pacer);
+
+    frame_pacer_tick_t tick;
+    for (int i = 0; i <= 10; i++) TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT_EQ(10, tick.index);
+
+    // Held up for 5 slots and a bit: slots 11-14 are gone, 15 is late by 4 ms
+    fake.now += 104000000;
+    TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT_EQ(15, tick.index);
+    TEST_ASSERT_EQ(4, tick.skipped);
+    TEST_ASSERT_EQ(300000000, tick.time_ns);
+    TEST_ASSERT_EQ(4000000, tick.jitter_ns);
+
+    // Back on the grid afterwards
+    uint64_t waits = fake.waits;
+    TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT_EQ(16, tick.index);
+    TEST_ASSERT_EQ(0, tick.skipped);
+    TEST_ASSERT_EQ(0, tick.jitter_ns);
+    TEST_ASSERT_EQ(waits + 1, fake.waits);
+
+    // A stall shorter than a slot is only jitter
+    fake.stall = 15000000;
+    TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT_EQ(17, tick.index);
+    TEST_ASSERT_EQ(15000000, tick.jitter_ns);
+    TEST_ASSERT(frame_pacer_wait(&pacer, &tick) == 0);
+    TEST_ASSERT_EQ(18, tick.index);
+
+    frame_pacer_stats_t stats;
+    frame_pacer_get_stats(&pacer, &stats);
+    TEST_ASSERT_EQ(4, stats.skipped);
+    TEST_ASSERT_EQ(15000000, stats.max_jitter_ns);
+    TEST_ASSERT_EQ(1, stats.jitter_buckets[FRAME_PACER_JITTER_BUCKETS - 1]);
+    frame_pacer_cleanup(&pacer);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_exact_frame_times);
+    RUN_TEST(test_frames_within);
+    RUN_TEST(test_no_drift_over_a_day);
+    RUN_TEST(test_no_drift_ntsc);
+    RUN_TEST(test_skips_after_stall);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include "test_common.h"
+#include "frame_pool.h"
+#include <stdint.h>
+#include <string.h>
+
+static int test_init_rejects_invalid_arguments(void) {
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(NULL, 1024, 4) != 0);
+    TEST_ASSERT(frame_pool_init(&pool, 0, 4) != 0);
+    TEST_ASSERT(frame_pool_init(&pool, 1024, 0) != 0);
+    return 0;
+}
+
+static int test_frames_are_aligned_and_distinct(void) {
+    frame_pool_t pool;
+    TEST_ASSERT(frame_pool_init(&pool, 1920 * 4 + 3, 3) == 0);
+
+    frame_handle_t handles[3];
+    for (int i = 0; i < 3; i++) {
+        handles[i] = frame_pool_acquire(&pool);
+        TEST_ASSERT(handles[i] != FRAME_HANDLE_INVALID);
+        uint8_t* data = (uint8_t*)frame_pool_data(&pool, handles[i]);
+        TEST_ASSERT(data != NULL);
+        TEST_ASSERT(((uintptr_t)data % FRAME_POOL_ALIGNMENT) == 0);
+        memset(data, i + 1, frame_pool_frame_size(&pool));
+    }
+
+    // Writing a whole frame must not bleed into its neighbours
+    for (int i = 0; i < 3; i++) {
+        uint8_t* data = (uint8_t*)frame_pool_data(&pool, handles[i]);
+        TEST_ASSERT_EQ(i + 1, data[0]);
+        TEST_ASSERT_EQ(i + 1, data[frame_pool_frame_size(&pool) - 1]);
+    }
+
+    frame_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_exhaustion_and_high_water(void) {
+    frame_pool_t pool;
+    frame_pool_stats_t stats;
+    TEST_ASSERT(frame_pool_init(&pool, 4096, 2) == 0);
+
+    frame_handle_t a = frame_pool_acquire(&pool);
+    frame_handle_t b = frame_pool_acquire(&pool);
+    TEST_ASSERT(a != FRAME_HANDLE_INVALID && b != FRAME_HANDLE_INVALID && a != b);
+    TEST_ASSERT_EQ(FRAME_HANDLE_INVALID, frame_pool_acquire(&pool));
+
+    frame_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(2, stats.capacity);
+    TEST_ASSERT_EQ(2, stats.in_use);
+    TEST_ASSERT_EQ(2, stats.high_water);
+    TEST_ASSERT_EQ(2, stats.acquired);
+    TEST_ASSERT_EQ(1, stats.exhausted);
+
+    frame_pool_release(&pool, a);
+    frame_pool_release(&pool, b);
+    frame_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(0, stats.in_use);
+    TEST_ASSERT_EQ(2, stats.high_water);
+
+    frame_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_refcount_keeps_frame_alive(void) {
+    frame_pool_t pool;
+    frame_pool_stats_t stats;
+    TEST_ASSERT(frame_pool_init(&pool, 4096, 1) == 0);
+
+    // Capture acquires, the cache adds a reference, the encoder adds another
+    frame_handle_t frame = frame_pool_acquire(&pool);
+    TEST_ASSERT(frame != FRAME_HANDLE_INVALID);
+    frame_pool_addref(&pool, frame);
+    frame_pool_addref(&pool, frame);
+    TEST_ASSERT_EQ(3, frame_pool_refcount(&pool, frame));
+
+    frame_pool_release(&pool, frame);
+    frame_pool_release(&pool, frame);
+    TEST_ASSERT_EQ(FRAME_HANDLE_INVALID, frame_pool_acquire(&pool));
+
+    frame_pool_release(&pool, frame);
+    frame_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(0, stats.in_use);
+
+    // The same slot is handed out again once fully released
+    TEST_ASSERT_EQ(frame, frame_pool_acquire(&pool));
+    frame_pool_release(&pool, frame);
+
+    frame_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_invalid_handles_are_ignored(void) {
+    frame_pool_t pool;
+    frame_pool_stats_t stats;
+    TEST_ASSERT(frame_pool_init(&pool, 4096, 2) == 0);
+
+    frame_pool_release(&pool, FRAME_HANDLE_INVALID);
+    frame_pool_release(&pool, 7);
+    frame_pool_addref(&pool, 7);
+    TEST_ASSERT(frame_pool_data(&pool, 7) == NULL);
+
+    // Over-release must not put a frame on the free list twice
+    frame_handle_t frame = frame_pool_acquire(&pool);
+    frame_pool_release(&pool, frame);
+    frame_pool_release(&pool, frame);
+    frame_pool_get_stats(&pool, &stats);
+    TEST_ASSERT_EQ(0, stats.in_use);
+
+    frame_handle_t a = frame_pool_acquire(&pool);
+    frame_handle_t b = frame_pool_acquire(&pool);
+    TEST_ASSERT(a != b);
+    TEST_ASSERT_EQ(FRAME_HANDLE_INVALID, frame_pool_acquire(&pool));
+
+    frame_pool_cleanup(&pool);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_rejects_invalid_arguments);
+    RUN_TEST(test_frames_are_aligned_and_distinct);
+    RUN_TEST(test_exhaustion_and_high_water);
+    RUN_TEST(test_refcount_keeps_frame_alive);
+    RUN_TEST(test_invalid_handles_are_ignored);
+
+    return failures == 0 ? 0 : 1;
+}
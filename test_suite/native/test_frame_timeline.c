@@ -0,0 +1,199 @@
+#include "test_common.h"
+#include "frame_timeline.h"
+#include <stdint.h>
+
+#define MS(value) ((int64_t)(value) * 10000)
+
+static int test_init_validation(void) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(NULL, FRAME_TIMING_CFR, 30) != 0);
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_CFR, 0) != 0);
+    TEST_ASSERT(frame_timeline_init(&timeline, (frame_timing_t)7, 30) != 0);
+
+    // Nothing to repeat or finish before the first frame
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_VFR, 30) == 0);
+    TEST_ASSERT(frame_timeline_repeat_frame(&timeline, 0, &step) != 0);
+    TEST_ASSERT_EQ(-1, frame_timeline_finish(&timeline));
+    return 0;
+}
+
+static int test_cfr_slots(void) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_CFR, 30) == 0);
+
+    // Capture jitter is ignored: samples sit on the 30 fps grid
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(5), &step) == 0);
+    TEST_ASSERT(step.start_sample && !step.write_pending);
+    TEST_ASSERT_EQ(0, step.time);
+
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(47), &step) == 0);
+    TEST_ASSERT(step.write_pending);
+    TEST_ASSERT_EQ(333333, step.pending_duration);
+    TEST_ASSERT_EQ(333333, step.time);
+
+    // Two repeats extend the held sample to three slots
+    TEST_ASSERT(frame_timeline_repeat_frame(&timeline, MS(70), &step) == 0);
+    TEST_ASSERT(!step.write_pending && !step.start_sample);
+    TEST_ASSERT(frame_timeline_repeat_frame(&timeline, MS(100), &step) == 0);
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(133), &step) == 0);
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&timeline, 4) - 333333, step.pending_duration);
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&timeline, 4), step.time);
+
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&timeline, 5) - frame_timeline_slot_time(&timeline, 4),
+                   frame_timeline_finish(&timeline));
+    TEST_ASSERT_EQ(2, timeline.repeats);
+    TEST_ASSERT_EQ(3, timeline.samples);
+    return 0;
+}
+
+static int test_cfr_refresh_every_two_seconds(void) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_CFR, 30) == 0);
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, 0, &step) == 0);
+
+    int refreshes = 0;
+    for (int tick = 1; tick <= 150; tick++) {
+        TEST_ASSERT(frame_timeline_repeat_frame(&timeline, 0, &step) == 0);
+        if (step.start_sample) {
+            refreshes++;
+            TEST_ASSERT(step.write_pending);
+            TEST_ASSERT_EQ(2 * FRAME_TIMELINE_UNITS_PER_SECOND, step.pending_duration);
+            TEST_ASSERT(tick == 60 || tick == 120);
+        }
+    }
+    TEST_ASSERT_EQ(2, refreshes);
+    TEST_ASSERT_EQ(2, timeline.refreshes);
+    return 0;
+}
+
+static int test_vfr_uses_capture_times(void) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_VFR, 30) == 0);
+
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(40), &step) == 0);
+    TEST_ASSERT_EQ(MS(40), step.time);
+
+    // Unchanged ticks start nothing
+    for (int t = 73; t < 1000; t += 33) {
+        TEST_ASSERT(frame_timeline_repeat_frame(&timeline, MS(t), &step) == 0);
+        TEST_ASSERT(!step.start_sample && !step.write_pending);
+    }
+
+    // The next change closes the held sample at its real capture time
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(1234), &step) == 0);
+    TEST_ASSERT(step.write_pending && step.start_sample);
+    TEST_ASSERT_EQ(MS(1234) - MS(40), step.pending_duration);
+    TEST_ASSERT_EQ(MS(1234), step.time);
+
+    // Same or earlier capture time still moves forward
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(1234), &step) == 0);
+    TEST_ASSERT_EQ(1, step.pending_duration);
+    TEST_ASSERT_EQ(MS(1234) + 1, step.time);
+    TEST_ASSERT(frame_timeline_new_frame(&timeline, MS(1000), &step) == 0);
+    TEST_ASSERT(step.time > MS(1234) + 1);
+
+    // The last sample lasts one frame interval past the last tick
+    TEST_ASSERT(frame_timeline_repeat_frame(&timeline, MS(1500), &step) == 0);
+    TEST_ASSERT_EQ(MS(1500) + 333333 - (MS(1234) + 2), frame_timeline_finish(&timeline));
+    TEST_ASSERT_EQ(4, timeline.samples);
+    return 0;
+}
+
+static int test_vfr_refresh_and_idle_savings(void) {
+    frame_timeline_t cfr, vfr;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&cfr, FRAME_TIMING_CFR, 30) == 0);
+    TEST_ASSERT(frame_timeline_init(&vfr, FRAME_TIMING_VFR, 30) == 0);
+
+    // One minute of desktop at 30 fps where content changes once every 10 seconds
+    int64_t written_until = 0;
+    for (int tick = 0; tick < 30 * 60; tick++) {
+        int64_t time = (int64_t)tick * FRAME_TIMELINE_UNITS_PER_SECOND / 30;
+        int changed = tick % 300 == 0;
+        TEST_ASSERT((changed ? frame_timeline_new_frame(&cfr, time, &step)
+                             : frame_timeline_repeat_frame(&cfr, time, &step)) == 0);
+        TEST_ASSERT((changed ? frame_timeline_new_frame(&vfr, time, &step)
+                             : frame_timeline_repeat_frame(&vfr, time, &step)) == 0);
+
+        // VFR samples tile the timeline without gaps or overlaps
+        if (step.write_pending) {
+            TEST_ASSERT_EQ(written_until, step.time - step.pending_duration);
+            written_until = step.time;
+        }
+    }
+    TEST_ASSERT(frame_timeline_finish(&vfr) > 0);
+
+    // Six changes plus a refresh every 2 s of each 10 s static stretch
+    TEST_ASSERT_EQ(6 + 6 * 4, vfr.samples);
+    TEST_ASSERT_EQ(vfr.samples, cfr.samples);
+    TEST_ASSERT_EQ(30 * 60 - 6, vfr.repeats);
+    return 0;
+}
+
+static int test_late_ticks_keep_real_time(void) {
+    frame_timeline_t cfr, vfr;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&cfr, FRAME_TIMING_CFR, 30) == 0);
+    TEST_ASSERT(frame_timeline_init(&vfr, FRAME_TIMING_VFR, 30) == 0);
+
+    // A loaded machine only manages every third tick
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT(frame_timeline_new_frame(&cfr, MS(100 * i), &step) == 0);
+        TEST_ASSERT(frame_timeline_new_frame(&vfr, MS(100 * i), &step) == 0);
+        if (i > 0) TEST_ASSERT_EQ(MS(100), step.pending_duration);
+    }
+    TEST_ASSERT_EQ(MS(900), vfr.pending_time);
+    // CFR stays on the grid and keeps real time: each frame covers the two slots it missed
+    TEST_ASSERT_EQ(MS(900), cfr.pending_time);
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&cfr, 27), cfr.pending_time);
+    TEST_ASSERT_EQ(9 * 2, cfr.gap_slots);
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&cfr, 28) - MS(900), frame_timeline_finish(&cfr));
+    return 0;
+}
+
+// Pacer slot times (floored to 100 ns) and dropped ticks at 60 fps: the file ends on the clock
+static int test_cfr_gaps_follow_the_clock(void) {
+    frame_timeline_t timeline;
+    frame_timeline_step_t step;
+    TEST_ASSERT(frame_timeline_init(&timeline, FRAME_TIMING_CFR, 60) == 0);
+
+    int64_t written_until = 0;
+    uint64_t delivered = 0, last_slot = 0;
+    for (uint64_t slot = 0; slot < 60 * 10; slot++) {
+        // Every seventh slot skipped by the pacer, every eleventh dropped on a full queue
+        if (slot % 7 == 3 || slot % 11 == 5) continue;
+        int64_t time = (int64_t)(slot * 1000000000ULL / 60 / 100);
+        int changed = slot % 4 == 0 || delivered == 0;
+        TEST_ASSERT((changed ? frame_timeline_new_frame(&timeline, time, &step)
+                             : frame_timeline_repeat_frame(&timeline, time, &step)) == 0);
+        TEST_ASSERT_EQ(frame_timeline_slot_time(&timeline, slot), timeline.last_time);
+        if (step.write_pending) {
+            TEST_ASSERT_EQ(written_until, step.time - step.pending_duration);
+            written_until = step.time;
+        }
+        delivered++;
+        last_slot = slot;
+    }
+    TEST_ASSERT(frame_timeline_finish(&timeline) > 0);
+    TEST_ASSERT_EQ(frame_timeline_slot_time(&timeline, last_slot + 1), timeline.end_time);
+    TEST_ASSERT_EQ(last_slot + 1 - delivered, timeline.gap_slots);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_cfr_slots);
+    RUN_TEST(test_cfr_refresh_every_two_seconds);
+    RUN_TEST(test_vfr_uses_capture_times);
+    RUN_TEST(test_vfr_refresh_and_idle_savings);
+    RUN_TEST(test_late_ticks_keep_real_time);
+    RUN_TEST(test_cfr_gaps_follow_the_clock);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+#include "test_common.h"
+#include "h264_fixtures.h"
+#include "h264_writer.h"
+#include "elementary_stream.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int width;
+    int height;
+    uint8_t* data;
+    color_planes_t planes;
+} nv12_picture_t;
+
+static int picture_alloc(nv12_picture_t* picture, int width, int height) {
+    memset(picture, 0, sizeof(nv12_picture_t));
+    picture->width = width;
+    picture->height = height;
+    picture->data = (uint8_t*)malloc(color_frame_size(COLOR_FORMAT_NV12, width, height));
+    if (!picture->data) return -1;
+    return color_planes_for_buffer(COLOR_FORMAT_NV12, picture->data, width, height, &picture->planes);
+}
+
+// Set a rectangle of luma, and the chroma under it; x, y, width and height even
+static void paint_rect(nv12_picture_t* picture, int x, int y, int width, int height, uint8_t value) {
+    for (int row = y; row < y + height; row++) {
+        memset(picture->planes.planes[0] + (size_t)row * picture->planes.pitches[0] + x, value, (size_t)width);
+    }
+    for (int row = y / 2; row < (y + height) / 2; row++) {
+        memset(picture->planes.planes[1] + (size_t)row * picture->planes.pitches[1] + x, value ^ 0x55, (size_t)width);
+    }
+}
+
+static int decode_and_compare(fixture_decoder_t* decoder, const uint8_t* data, size_t size, const nv12_picture_t* picture) {
+    if (fixture_decode_annexb(decoder, data, size) != 0) {
+        fprintf(stderr, "decode failed: %s\n", decoder->error);
+        return -1;
+    }
+    return fixture_decoder_compare(decoder, picture->planes.planes[0], picture->planes.pitches[0],
+                                   picture->planes.planes[1], picture->planes.pitches[1]);
+}
+
+static int test_round_trip(void) {
+    // Neither side a multiple of 16: padding and cropping on both
+    const int width = 100, height = 70;
+    h264_writer_config_t config = { width, height, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    h264_writer_t writer;
+    nv12_picture_t picture;
+    fixture_decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    TEST_ASSERT(picture_alloc(&picture, width, height) == 0);
+    fill_random(picture.data, color_frame_size(COLOR_FORMAT_NV12, width, height), 7);
+
+    for (int frame = 0; frame < 12; frame++) {
+        if (frame > 0) paint_rect(&picture, (frame * 14) % (width - 20), (frame * 6) % (height - 10), 20, 10, (uint8_t)(frame * 19));
+        const uint8_t* data;
+        size_t size;
+        int keyframe = -1;
+        TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, &keyframe) == 0);
+        TEST_ASSERT_EQ(frame == 0, keyframe);
+        TEST_ASSERT_EQ(keyframe, h264_is_keyframe(data, size));
+        TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+        if (frame > 0) {
+            // A 20x10 rectangle touches at most 2x2 macroblocks
+            TEST_ASSERT(decoder.coded_macroblocks >= 1 && decoder.coded_macroblocks <= 4);
+        }
+    }
+    TEST_ASSERT_EQ(width, decoder.width);
+    TEST_ASSERT_EQ(height, decoder.height);
+    TEST_ASSERT_EQ(12, decoder.pictures);
+    TEST_ASSERT_EQ(0, decoder.full_range);
+    TEST_ASSERT_EQ(1, decoder.matrix_coefficients);
+    TEST_ASSERT_EQ(writer.level_idc, decoder.level_idc);
+
+    fixture_decoder_free(&decoder);
+    free(picture.data);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+static int test_sps_matches_parser(void) {
+    h264_writer_config_t config = { 1366, 768, 60, 0, COLOR_MATRIX_BT601, COLOR_RANGE_FULL };
+    h264_writer_t writer;
+    nv12_picture_t picture;
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    TEST_ASSERT(picture_alloc(&picture, 1366, 768) == 0);
+    memset(picture.data, 128, color_frame_size(COLOR_FORMAT_NV12, 1366, 768));
+
+    const uint8_t* data;
+    size_t size;
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, NULL) == 0);
+
+    // The muxer's SPS parser reads the same picture size
+    size_t offset = 0;
+    const uint8_t* nal;
+    size_t nal_size;
+    TEST_ASSERT(h264_next_nal(data, size, &offset, &nal, &nal_size) == 1);
+    TEST_ASSERT_EQ(H264_NAL_SPS, H264_NAL_TYPE(nal[0]));
+    h264_sps_info_t info;
+    TEST_ASSERT(h264_parse_sps(nal, nal_size, &info) == 0);
+    TEST_ASSERT_EQ(1366, info.width);
+    TEST_ASSERT_EQ(768, info.height);
+    TEST_ASSERT_EQ(66, info.profile_idc);
+    // 86x48 macroblocks at 60 fps is just over level 4.1's macroblock rate
+    TEST_ASSERT_EQ(42, info.level_idc);
+
+    fixture_decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+    TEST_ASSERT_EQ(1, decoder.full_range);
+    TEST_ASSERT_EQ(6, decoder.matrix_coefficients);
+
+    fixture_decoder_free(&decoder);
+    free(picture.data);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+static int test_still_picture_is_tiny(void) {
+    h264_writer_config_t config = { 1280, 720, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    h264_writer_t writer;
+    nv12_picture_t picture;
+    fixture_decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    TEST_ASSERT(picture_alloc(&picture, 1280, 720) == 0);
+    fill_random(picture.data, color_frame_size(COLOR_FORMAT_NV12, 1280, 720), 3);
+
+    const uint8_t* data;
+    size_t size;
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, NULL) == 0);
+    // Every macroblock as PCM: at least 1.5 bytes per pixel
+    TEST_ASSERT(size >= (size_t)1280 * 720 * 3 / 2);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+
+    // Same picture, and the same again through repeat: all skipped
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, NULL) == 0);
+    TEST_ASSERT(size < 16);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+    TEST_ASSERT_EQ(0, decoder.coded_macroblocks);
+    TEST_ASSERT(h264_writer_repeat(&writer, &data, &size, NULL) == 0);
+    TEST_ASSERT(size < 16);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+
+    // One pixel changes one macroblock
+    picture.planes.planes[0][300 * picture.planes.pitches[0] + 700] ^= 1;
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, NULL) == 0);
+    TEST_ASSERT(size < 400 + 32);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+    TEST_ASSERT_EQ(1, decoder.coded_macroblocks);
+
+    TEST_ASSERT_EQ(4, writer.stats.pictures);
+    TEST_ASSERT_EQ(3600 + 1, writer.stats.coded_macroblocks);
+
+    fixture_decoder_free(&decoder);
+    free(picture.data);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+static int test_keyframe_interval(void) {
+    h264_writer_config_t config = { 64, 48, 30, 5, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    h264_writer_t writer;
+    nv12_picture_t picture;
+    fixture_decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    TEST_ASSERT(picture_alloc(&picture, 64, 48) == 0);
+    fill_random(picture.data, color_frame_size(COLOR_FORMAT_NV12, 64, 48), 11);
+
+    // IDR every 5 pictures whether they are encoded or repeated; frame_num
+    // wraps at 16 across the run without a gap
+    for (int frame = 0; frame < 40; frame++) {
+        const uint8_t* data;
+        size_t size;
+        int keyframe;
+        if (frame % 3 == 2) {
+            TEST_ASSERT(h264_writer_repeat(&writer, &data, &size, &keyframe) == 0);
+        } else {
+            paint_rect(&picture, 16, 16, 8, 8, (uint8_t)frame);
+            TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, &keyframe) == 0);
+        }
+        TEST_ASSERT_EQ(frame % 5 == 0, keyframe);
+        TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+    }
+    TEST_ASSERT_EQ(8, decoder.idr_pictures);
+
+    // A forced keyframe restarts the count
+    const uint8_t* data;
+    size_t size;
+    int keyframe;
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 1, &data, &size, &keyframe) == 0);
+    TEST_ASSERT_EQ(1, keyframe);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, &keyframe) == 0);
+    TEST_ASSERT_EQ(0, keyframe);
+
+    fixture_decoder_free(&decoder);
+    free(picture.data);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+static int test_emulation_prevention(void) {
+    // Black full-range pictures are runs of zero samples, which must not
+    // read as start codes; the decoder rejects any that slip through
+    h264_writer_config_t config = { 48, 32, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_FULL };
+    h264_writer_t writer;
+    nv12_picture_t picture;
+    fixture_decoder_t decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    TEST_ASSERT(picture_alloc(&picture, 48, 32) == 0);
+    memset(picture.data, 0, color_frame_size(COLOR_FORMAT_NV12, 48, 32));
+    for (int i = 0; i < 48; i += 3) picture.planes.planes[0][i] = (uint8_t)(i % 4);
+
+    const uint8_t* data;
+    size_t size;
+    TEST_ASSERT(h264_writer_encode(&writer, &picture.planes, 0, &data, &size, NULL) == 0);
+    TEST_ASSERT(decode_and_compare(&decoder, data, size, &picture) == 0);
+
+    int start_codes = 0;
+    for (size_t i = 0; i + 3 <= size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) start_codes++;
+    }
+    TEST_ASSERT_EQ(3, start_codes);         // SPS, PPS, slice
+
+    fixture_decoder_free(&decoder);
+    free(picture.data);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+static int test_rejects_bad_input(void) {
+    h264_writer_t writer;
+    h264_writer_config_t odd = { 101, 70, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    TEST_ASSERT(h264_writer_init(&writer, &odd) != 0);
+    h264_writer_config_t huge = { 32768, 64, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    TEST_ASSERT(h264_writer_init(&writer, &huge) != 0);
+
+    h264_writer_config_t config = { 32, 32, 30, 0, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED };
+    TEST_ASSERT(h264_writer_init(&writer, &config) == 0);
+    const uint8_t* data;
+    size_t size;
+    // Nothing to repeat yet
+    TEST_ASSERT(h264_writer_repeat(&writer, &data, &size, NULL) != 0);
+    h264_writer_cleanup(&writer);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_sps_matches_parser);
+    RUN_TEST(test_still_picture_is_tiny);
+    RUN_TEST(test_keyframe_interval);
+    RUN_TEST(test_emulation_prevention);
+    RUN_TEST(test_rejects_bad_input);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,231 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "fmp4_muxer.h"
+#include "mp4_repair.h"
+#include <stdio.h>
+
+#define REPAIR_TEST_FILE "test_mp4_repair.mp4"
+#define REPAIR_TEST_OUTPUT "test_mp4_repair-repaired.mp4"
+#define REPAIR_GOP 15
+#define REPAIR_SLICE_BASE 400
+
+// Sample content, regenerated from the fixture generators
+static int check_sample(void* context, int track, uint64_t index, uint64_t time,
+                        const uint8_t* data, uint32_t size, uint32_t flags) {
+    static uint8_t payload[8192];
+    (void)context;
+    (void)time;
+
+    if (track == FIXTURE_AUDIO) {
+        if (size != fixture_aac_size(index)) return -1;
+        fixture_aac_payload(index, payload, size);
+        return memcmp(payload, data, size) == 0 ? 0 : -1;
+    }
+    int keyframe = index % REPAIR_GOP == 0;
+    size_t slice = fixture_slice_size(index, keyframe, REPAIR_SLICE_BASE);
+    if (size != 4 + 1 + slice || slice > sizeof(payload) || keyframe != !(flags & 0x00010000)) return -1;
+    fixture_slice_payload(index, payload, slice);
+    return memcmp(payload, data + 5, slice) == 0 ? 0 : -1;
+}
+
+// 4 s of 30 fps video with a keyframe every half second, and 48 kHz AAC
+static int record(fmp4_muxer_t* muxer, uint64_t frames) {
+    static uint8_t unit[8192];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 40, 1280, 720);
+    uint64_t audio = 0;
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        int keyframe = frame % REPAIR_GOP == 0;
+        size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframe,
+                                          fixture_slice_size(frame, keyframe, REPAIR_SLICE_BASE), sps, sps_size);
+        if (fmp4_muxer_write_video(muxer, unit, size, (int64_t)frame * 10000000 / 30) != 0) return -1;
+        while (audio * AAC_SAMPLES_PER_FRAME * 30 <= (frame + 1) * 48000) {
+            size = fixture_adts_frame(unit, audio++, 48000, 2);
+            if (fmp4_muxer_write_audio(muxer, unit, size) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static int make_recording(fixture_output_t* output) {
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 500, 0, 0, 0 };
+    memset(output, 0, sizeof(fixture_output_t));
+    if (fmp4_muxer_init(&muxer, &config, fixture_output_write, output) != 0) return -1;
+    int result = record(&muxer, 120);
+    if (result == 0) result = fmp4_muxer_finish(&muxer);
+    fmp4_muxer_cleanup(&muxer);
+    return result;
+}
+
+// Run the repair over bytes in memory; the output lands in repaired
+static int repair_bytes(const uint8_t* data, size_t size, fixture_output_t* repaired, mp4_repair_result_t* result) {
+    FILE* input = tmpfile();
+    FILE* output = tmpfile();
+    int status = -1;
+    if (input && output && fwrite(data, 1, size, input) == size) {
+        rewind(input);
+        status = mp4_repair_stream(input, output, result);
+    }
+    memset(repaired, 0, sizeof(fixture_output_t));
+    if (status == 0) {
+        long length = ftell(output);
+        rewind(output);
+        repaired->data = (uint8_t*)malloc(length > 0 ? (size_t)length : 1);
+        repaired->size = fread(repaired->data, 1, (size_t)length, output);
+        repaired->capacity = (size_t)length;
+    }
+    if (input) fclose(input);
+    if (output) fclose(output);
+    return status;
+}
+
+// A finished file comes back byte for byte
+static int test_complete_file(void) {
+    fixture_output_t original, repaired;
+    mp4_repair_result_t result;
+    TEST_ASSERT(make_recording(&original) == 0);
+    TEST_ASSERT(repair_bytes(original.data, original.size, &repaired, &result) == 0);
+    TEST_ASSERT(result.complete);
+    TEST_ASSERT_EQ(original.size, repaired.size);
+    TEST_ASSERT(memcmp(original.data, repaired.data, original.size) == 0);
+    TEST_ASSERT_EQ(8, result.fragments);
+    TEST_ASSERT_EQ(0, result.trimmed_samples);
+    TEST_ASSERT_EQ(0, result.discarded_bytes);
+    fixture_output_free(&original);
+    fixture_output_free(&repaired);
+    return 0;
+}
+
+// Cut at pseudo-random offsets past the moov: every repair is a strictly
+// valid file holding at least each whole fragment, with the right content
+static int test_random_truncation(void) {
+    fixture_output_t original;
+    TEST_ASSERT(make_recording(&original) == 0);
+    mp4_box_t ftyp, moov;
+    TEST_ASSERT(mp4_box_parse(original.data, original.size, &ftyp) == 0);
+    TEST_ASSERT(mp4_box_parse(original.data + ftyp.size, original.size - ftyp.size, &moov) == 0);
+    size_t header = (size_t)(ftyp.size + moov.size);
+
+    uint32_t seed = 12345;
+    int trimmed = 0;
+    for (int i = 0; i < 300; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        size_t cut = header + (seed >> 8) % (original.size - header);
+
+        fixture_mp4_t whole;
+        TEST_ASSERT(fixture_parse_fmp4(original.data, cut, 1, &whole, NULL, NULL) == 0);
+
+        fixture_output_t repaired;
+        mp4_repair_result_t result;
+        TEST_ASSERT(repair_bytes(original.data, cut, &repaired, &result) == 0);
+        TEST_ASSERT(!result.complete || cut == whole.bytes);
+        TEST_ASSERT_EQ(cut, result.bytes_read);
+        TEST_ASSERT_EQ(repaired.size, result.bytes_written);
+
+        fixture_mp4_t info;
+        int parsed = fixture_parse_fmp4(repaired.data, repaired.size, 0, &info, check_sample, NULL);
+        if (parsed != 0) fprintf(stderr, "Cut at %zu: %s\n", cut, info.error);
+        TEST_ASSERT(parsed == 0);
+        TEST_ASSERT_EQ(result.fragments, info.fragments);
+        TEST_ASSERT_EQ(result.samples, info.samples[FIXTURE_VIDEO] + info.samples[FIXTURE_AUDIO]);
+        TEST_ASSERT(info.samples[FIXTURE_VIDEO] >= whole.samples[FIXTURE_VIDEO]);
+        TEST_ASSERT(info.samples[FIXTURE_AUDIO] >= whole.samples[FIXTURE_AUDIO]);
+        TEST_ASSERT(info.fragments >= whole.fragments && info.fragments <= whole.fragments + 1);
+        // Each fragment still starts on a keyframe
+        TEST_ASSERT_EQ(info.video_runs, info.sync_starts);
+        if (info.samples[FIXTURE_VIDEO] > whole.samples[FIXTURE_VIDEO]) trimmed++;
+        fixture_output_free(&repaired);
+    }
+    // Most cuts land inside a fragment's video data
+    TEST_ASSERT(trimmed > 100);
+    fixture_output_free(&original);
+    return 0;
+}
+
+// A crash leaves zero fill after the last write; it is dropped
+static int test_zero_tail(void) {
+    fixture_output_t original, repaired;
+    mp4_repair_result_t result;
+    TEST_ASSERT(make_recording(&original) == 0);
+    size_t size = original.size;
+    uint8_t zeros[4096] = { 0 };
+    TEST_ASSERT(fixture_output_write(&original, zeros, sizeof(zeros)) == 0);
+
+    TEST_ASSERT(repair_bytes(original.data, original.size, &repaired, &result) == 0);
+    TEST_ASSERT(!result.complete);
+    TEST_ASSERT_EQ(size, repaired.size);
+    TEST_ASSERT_EQ(sizeof(zeros), result.discarded_bytes);
+    TEST_ASSERT(memcmp(original.data, repaired.data, size) == 0);
+    fixture_output_free(&original);
+    fixture_output_free(&repaired);
+    return 0;
+}
+
+// Nothing to rebuild from: no moov yet, or a plain MP4 with media first
+static int test_unrecoverable(void) {
+    fixture_output_t original, repaired;
+    mp4_repair_result_t result;
+    TEST_ASSERT(make_recording(&original) == 0);
+    mp4_box_t ftyp, moov;
+    TEST_ASSERT(mp4_box_parse(original.data, original.size, &ftyp) == 0);
+    TEST_ASSERT(mp4_box_parse(original.data + ftyp.size, original.size - ftyp.size, &moov) == 0);
+
+    TEST_ASSERT(repair_bytes(original.data, (size_t)(ftyp.size + moov.size) - 1, &repaired, &result) != 0);
+    TEST_ASSERT(repair_bytes(original.data, 3, &repaired, &result) != 0);
+
+    mp4_buffer_t plain;
+    mp4_buffer_init(&plain);
+    mp4_put_bytes(&plain, original.data, (size_t)ftyp.size);
+    size_t mdat = mp4_box_begin(&plain, MP4_FOURCC('m', 'd', 'a', 't'));
+    mp4_put_zeros(&plain, 1000);
+    mp4_box_end(&plain, mdat);
+    TEST_ASSERT(repair_bytes(plain.data, plain.size, &repaired, &result) != 0);
+    mp4_buffer_free(&plain);
+
+    TEST_ASSERT(mp4_repair_file(REPAIR_TEST_FILE, REPAIR_TEST_FILE, &result) != 0);
+    fixture_output_free(&original);
+    return 0;
+}
+
+// The process dies mid-recording: every fragment synced so far survives
+static int test_crash_recovery(void) {
+    fmp4_muxer_t muxer;
+    fmp4_config_t config = { 1, 1, 0, 0, 500, 0, 0, 1 };
+    TEST_ASSERT(fmp4_muxer_open(&muxer, &config, REPAIR_TEST_FILE) == 0);
+    TEST_ASSERT(record(&muxer, 100) == 0);
+    uint64_t fragments = muxer.stats.fragments;
+    TEST_ASSERT(fragments >= 5);
+    // No finish: the last partial fragment never reaches the file
+    fmp4_muxer_cleanup(&muxer);
+
+    mp4_repair_result_t result;
+    TEST_ASSERT(mp4_repair_file(REPAIR_TEST_FILE, REPAIR_TEST_OUTPUT, &result) == 0);
+    TEST_ASSERT_EQ(fragments, result.fragments);
+
+    FILE* file = fopen(REPAIR_TEST_OUTPUT, "rb");
+    TEST_ASSERT(file != NULL);
+    static uint8_t data[1 << 20];
+    size_t size = fread(data, 1, sizeof(data), file);
+    fclose(file);
+    remove(REPAIR_TEST_FILE);
+    remove(REPAIR_TEST_OUTPUT);
+
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, NULL) == 0);
+    TEST_ASSERT_EQ(fragments, info.fragments);
+    TEST_ASSERT(info.samples[FIXTURE_VIDEO] >= 75);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_complete_file);
+    RUN_TEST(test_random_truncation);
+    RUN_TEST(test_zero_tail);
+    RUN_TEST(test_unrecoverable);
+    RUN_TEST(test_crash_recovery);
+
+    return failures == 0 ? 0 : 1;
+}
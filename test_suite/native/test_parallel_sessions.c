@@ -0,0 +1,368 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "h264_fixtures.h"
+#include "capture_source.h"
+#include "synthetic_source.h"
+#include "color_convert.h"
+#include "copy_kernels.h"
+#include "worker_pool.h"
+#include "frame_pool.h"
+#include "spsc_ring.h"
+#include "pipeline.h"
+#include "encoder_backend.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Several recordings at once in one process, each with its own synthetic
+// source, pools, worker threads, pipeline and software H.264 encoder. Every
+// session must write a file that decodes to exactly the frames it captured:
+// any state shared between sessions shows up as a wrong count, a corrupt
+// stream or one session's pictures in another's file.
+//
+// This covers the portable half of a session only. engine.c and encoder.c
+// (engine_session_t, encoder_context_t and the Media Foundation, WASAPI and
+// DXGI state they hold) build on Windows alone, so their concurrency is not
+// exercised here or anywhere else in this suite and remains unverified.
+//
+//   test_parallel_sessions [sessions] [frames]
+
+#define SESSION_MAX 16
+#define SESSION_WIDTH 128
+#define SESSION_HEIGHT 96
+#define SESSION_FPS 30
+#define SESSION_QUEUE_DEPTH 4
+#define SESSION_POOL_FRAMES 8
+
+typedef struct {
+    uint64_t handle;
+    frame_pool_t* pool;             // NULL for a repeat
+    int64_t time;
+} session_frame_t;
+
+typedef struct {
+    int index;
+    int frames;
+    char path[64];
+    capture_source_t source;
+    frame_pool_t capture_pool;
+    frame_pool_t nv12_pool;
+    worker_pool_t workers;
+    color_converter_t converter;
+    encoder_backend_t backend;
+    spsc_ring_t capture_queue;
+    spsc_ring_t video_queue;
+    pipeline_t pipeline;
+    int video_stage;
+    int mux_stage;
+    int captured;                   // Capture thread
+    int muxed;                      // Mux thread
+    uint8_t* pictures;              // Every NV12 picture the mux thread sent, repeats included
+    size_t picture_size;
+    copy_kernel_level_t copy_level; // As this session's thread saw it first
+    encoder_backend_stats_t stats;
+    int result;
+} session_t;
+
+static int capture_step(void* context) {
+    session_t* session = (session_t*)context;
+    if (session->captured >= session->frames) return PIPELINE_STEP_DONE;
+    if (spsc_ring_depth(&session->capture_queue) >= session->capture_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    session_frame_t item = { 0, NULL, (int64_t)session->captured * ENCODER_BACKEND_UNITS_PER_SECOND / SESSION_FPS };
+    if (session->captured % 4 != 3) {
+        frame_handle_t frame;
+        int result = capture_source_get_frame(&session->source, &frame, 1);
+        if (result < 0) return PIPELINE_STEP_ERROR;
+        if (result != CAPTURE_FRAME_NEW) return PIPELINE_STEP_BLOCKED;
+        item.handle = (uint64_t)frame;
+        item.pool = &session->capture_pool;
+    }
+    spsc_ring_push(&session->capture_queue, &item);
+    session->captured++;
+    pipeline_notify(&session->pipeline, session->video_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int video_step(void* context) {
+    session_t* session = (session_t*)context;
+    if (spsc_ring_depth(&session->video_queue) >= session->video_queue.capacity) return PIPELINE_STEP_BLOCKED;
+
+    session_frame_t item;
+    if (spsc_ring_pop(&session->capture_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    pipeline_notify(&session->pipeline, 0);
+
+    if (item.pool) {
+        frame_handle_t nv12 = frame_pool_acquire(&session->nv12_pool);
+        if (nv12 == FRAME_HANDLE_INVALID) {
+            frame_pool_release(item.pool, (frame_handle_t)item.handle);
+            return PIPELINE_STEP_ERROR;
+        }
+        color_planes_t planes;
+        color_planes_for_buffer(COLOR_FORMAT_NV12, (uint8_t*)frame_pool_data(&session->nv12_pool, nv12),
+                                SESSION_WIDTH, SESSION_HEIGHT, &planes);
+        color_convert_frame(&session->converter, COLOR_FORMAT_NV12, &planes,
+                            (const uint8_t*)frame_pool_data(item.pool, (frame_handle_t)item.handle),
+                            (size_t)SESSION_WIDTH * 4, SESSION_WIDTH, SESSION_HEIGHT);
+        frame_pool_release(item.pool, (frame_handle_t)item.handle);
+        item.handle = (uint64_t)nv12;
+        item.pool = &session->nv12_pool;
+    }
+    spsc_ring_push(&session->video_queue, &item);
+    pipeline_notify(&session->pipeline, session->mux_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int mux_step(void* context) {
+    session_t* session = (session_t*)context;
+    session_frame_t item;
+    if (spsc_ring_pop(&session->video_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    pipeline_notify(&session->pipeline, session->video_stage);
+
+    uint8_t* picture = session->pictures + session->picture_size * session->muxed;
+    int result;
+    if (item.pool) {
+        memcpy(picture, frame_pool_data(item.pool, (frame_handle_t)item.handle), session->picture_size);
+        result = encoder_backend_push_video(&session->backend, item.pool, (frame_handle_t)item.handle, item.time);
+        frame_pool_release(item.pool, (frame_handle_t)item.handle);
+    } else {
+        if (session->muxed == 0) return PIPELINE_STEP_ERROR;
+        memcpy(picture, picture - session->picture_size, session->picture_size);
+        result = encoder_backend_repeat_video(&session->backend, item.time);
+    }
+    if (result != 0) return PIPELINE_STEP_ERROR;
+    session->muxed++;
+    return PIPELINE_STEP_BUSY;
+}
+
+// One whole recording, start to finalize, on its own thread
+static int session_record(session_t* session) {
+    session->copy_level = copy_kernels_best_level();
+
+    synthetic_source_config_t source_config;
+    source_config.pattern = (synthetic_pattern_t)(session->index % 3);
+    source_config.width = SESSION_WIDTH;
+    source_config.height = SESSION_HEIGHT;
+    source_config.fps = SESSION_FPS;
+    source_config.seed = (uint32_t)session->index + 1;
+    if (synthetic_source_create(&session->source, &source_config) != 0) return -1;
+
+    encoder_backend_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.path = session->path;
+    config.video = 1;
+    config.width = SESSION_WIDTH;
+    config.height = SESSION_HEIGHT;
+    config.fps = SESSION_FPS;
+    config.format = ENCODER_INPUT_NV12;
+    config.matrix = COLOR_MATRIX_BT709;
+    config.range = COLOR_RANGE_LIMITED;
+    config.timing = FRAME_TIMING_CFR;
+    config.fragmented = 1;
+    config.keyframe_interval = 8;
+
+    session->picture_size = color_frame_size(COLOR_FORMAT_NV12, SESSION_WIDTH, SESSION_HEIGHT);
+    session->pictures = (uint8_t*)malloc(session->picture_size * session->frames);
+    if (!session->pictures ||
+        frame_pool_init(&session->capture_pool, (size_t)SESSION_WIDTH * SESSION_HEIGHT * 4, SESSION_POOL_FRAMES) != 0 ||
+        frame_pool_init(&session->nv12_pool, session->picture_size, SESSION_POOL_FRAMES) != 0 ||
+        worker_pool_init(&session->workers, 2) != 0 ||
+        color_converter_init(&session->converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED) != 0 ||
+        spsc_ring_init(&session->capture_queue, "capture->video", SESSION_QUEUE_DEPTH, sizeof(session_frame_t)) != 0 ||
+        spsc_ring_init(&session->video_queue, "video->mux", SESSION_QUEUE_DEPTH, sizeof(session_frame_t)) != 0 ||
+        capture_source_set_pool(&session->source, &session->capture_pool) != 0 ||
+        capture_source_start(&session->source) != 0 ||
+        encoder_backend_create(&session->backend, ENCODER_BACKEND_H264) != 0 ||
+        encoder_backend_init(&session->backend, &config) != 0) {
+        return -1;
+    }
+    color_converter_set_pool(&session->converter, &session->workers);
+
+    pipeline_init(&session->pipeline);
+    pipeline_stage_desc_t capture = { "capture", capture_step, NULL, NULL, session, 0, 1 };
+    pipeline_stage_desc_t video = { "video", video_step, NULL, NULL, session, 0, 0 };
+    pipeline_stage_desc_t mux = { "mux", mux_step, NULL, NULL, session, 0, 0 };
+    pipeline_add_stage(&session->pipeline, &capture);
+    session->video_stage = pipeline_add_stage(&session->pipeline, &video);
+    session->mux_stage = pipeline_add_stage(&session->pipeline, &mux);
+    pipeline_add_queue(&session->pipeline, &session->capture_queue);
+    pipeline_add_queue(&session->pipeline, &session->video_queue);
+    if (pipeline_start(&session->pipeline) != 0) return -1;
+    while (!pipeline_finished(&session->pipeline)) platform_sleep_ms(2);
+    pipeline_stop(&session->pipeline);
+    if (pipeline_failed(&session->pipeline)) return -1;
+
+    if (encoder_backend_finalize(&session->backend) != 0) return -1;
+    encoder_backend_get_stats(&session->backend, &session->stats);
+    return 0;
+}
+
+static void session_cleanup(session_t* session) {
+    pipeline_cleanup(&session->pipeline);
+    encoder_backend_destroy(&session->backend);
+    capture_source_stop(&session->source);
+    capture_source_destroy(&session->source);
+    spsc_ring_cleanup(&session->capture_queue);
+    spsc_ring_cleanup(&session->video_queue);
+    worker_pool_cleanup(&session->workers);
+    frame_pool_cleanup(&session->nv12_pool);
+    frame_pool_cleanup(&session->capture_pool);
+}
+
+static void session_thread(void* arg) {
+    session_t* session = (session_t*)arg;
+    session->result = session_record(session);
+    session_cleanup(session);
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? (uint8_t*)malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+typedef struct {
+    fixture_decoder_t decoder;
+    const session_t* session;
+    uint64_t samples;
+    uint64_t mismatches;
+} sample_check_t;
+
+static int check_sample(void* context, int track, uint64_t index, uint64_t time, const uint8_t* data,
+                        uint32_t size, uint32_t flags) {
+    sample_check_t* check = (sample_check_t*)context;
+    (void)time;
+    (void)flags;
+    if (track != FIXTURE_VIDEO) return 0;
+    if (index >= (uint64_t)check->session->muxed) return -1;
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        uint32_t length = mp4_read_u32(data + offset);
+        if (length == 0 || length > size - offset - 4) return -1;
+        if (fixture_decode_nal(&check->decoder, data + offset + 4, length) != 0) return -1;
+        offset += 4 + length;
+    }
+    const uint8_t* picture = check->session->pictures + check->session->picture_size * index;
+    const uint8_t* uv = picture + (size_t)SESSION_WIDTH * SESSION_HEIGHT;
+    if (fixture_decoder_compare(&check->decoder, picture, SESSION_WIDTH, uv, SESSION_WIDTH) != 0) {
+        check->mismatches++;
+    }
+    check->samples++;
+    return 0;
+}
+
+// The session's file holds every frame it muxed and nothing else
+static int check_session(const session_t* session) {
+    TEST_ASSERT_EQ(0, session->result);
+    TEST_ASSERT_EQ(session->frames, session->muxed);
+    int repeats = session->frames / 4;
+    TEST_ASSERT_EQ(session->frames - repeats, session->stats.video_frames);
+    TEST_ASSERT_EQ(repeats, session->stats.repeated_frames);
+
+    size_t size;
+    uint8_t* data = read_file(session->path, &size);
+    TEST_ASSERT(data != NULL);
+    TEST_ASSERT_EQ(size, session->stats.bytes);
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, NULL, NULL) == 0);
+    TEST_ASSERT_EQ(SESSION_WIDTH, info.width);
+    TEST_ASSERT_EQ(SESSION_HEIGHT, info.height);
+    TEST_ASSERT_EQ(session->frames, info.samples[FIXTURE_VIDEO]);
+
+    sample_check_t check;
+    memset(&check, 0, sizeof(check));
+    check.session = session;
+    TEST_ASSERT(fixture_decode_nal(&check.decoder, info.sps, info.sps_size) == 0);
+    check.decoder.have_pps = 1;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, &check) == 0);
+    TEST_ASSERT_EQ(session->frames, check.samples);
+    TEST_ASSERT_EQ(0, check.mismatches);
+    fixture_decoder_free(&check.decoder);
+    free(data);
+    return 0;
+}
+
+static int run_sessions(int count, int frames) {
+    session_t* sessions = (session_t*)calloc((size_t)count, sizeof(session_t));
+    platform_thread_t threads[SESSION_MAX];
+    TEST_ASSERT(sessions != NULL);
+    for (int i = 0; i < count; i++) {
+        sessions[i].index = i;
+        sessions[i].frames = frames;
+        snprintf(sessions[i].path, sizeof(sessions[i].path), "test_parallel_session_%d.mp4", i);
+    }
+    int started = 0;
+    while (started < count && platform_thread_create(&threads[started], session_thread, &sessions[started]) == 0) {
+        started++;
+    }
+    for (int i = 0; i < started; i++) platform_thread_join(threads[i]);
+    TEST_ASSERT_EQ(count, started);
+
+    int failed = 0;
+    for (int i = 0; i < count && !failed; i++) {
+        if (check_session(&sessions[i]) != 0) {
+            fprintf(stderr, "session %d of %d failed\n", i, count);
+            failed = 1;
+        }
+    }
+
+    // Every thread saw the finished CPU detection, never a scalar fallback mid-way
+    copy_kernel_level_t level = copy_kernels_best_level();
+    for (int i = 0; i < count && !failed; i++) {
+        if (sessions[i].copy_level != level) {
+            fprintf(stderr, "session %d saw copy level %s, not %s\n", i,
+                    copy_kernels_level_name(sessions[i].copy_level), copy_kernels_level_name(level));
+            failed = 1;
+        }
+    }
+
+    // Different seeds record different pictures, so no file is another's copy
+    for (int i = 1; i < count && !failed; i++) {
+        if (memcmp(sessions[0].pictures, sessions[i].pictures, sessions[0].picture_size) == 0) {
+            fprintf(stderr, "sessions 0 and %d recorded the same first frame\n", i);
+            failed = 1;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(sessions[i].pictures);
+        remove(sessions[i].path);
+    }
+    free(sessions);
+    return failed ? 1 : 0;
+}
+
+static int g_sessions = 4;
+static int g_frames = 24;
+
+static int test_one_session(void) {
+    return run_sessions(1, g_frames);
+}
+
+static int test_parallel_sessions(void) {
+    return run_sessions(g_sessions, g_frames);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) g_sessions = atoi(argv[1]);
+    if (argc > 2) g_frames = atoi(argv[2]);
+    if (g_sessions < 2 || g_sessions > SESSION_MAX) g_sessions = 4;
+    if (g_frames < 4) g_frames = 24;
+
+    int failures = 0;
+    RUN_TEST(test_one_session);
+    RUN_TEST(test_parallel_sessions);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+#include "test_common.h"
+#include "pipeline.h"
+#include "spsc_ring.h"
+#include "platform.h"
+#include <stdint.h>
+#include <string.h>
+
+// The recorder's shape in miniature: a paced "capture" source, an
+// independent "audio" source, a "video" transform and a "mux" sink reading
+// both queues.
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t value;
+} test_item_t;
+
+typedef struct {
+    pipeline_t pipeline;
+    spsc_ring_t capture_queue;      // capture -> video
+    spsc_ring_t video_queue;        // video -> mux
+    spsc_ring_t audio_queue;        // audio -> mux
+    int video_stage;
+    int mux_stage;
+
+    // capture
+    uint32_t capture_next;
+    uint32_t capture_limit;         // DONE after this many, 0 = until stopped
+    uint64_t capture_dropped;
+    // audio
+    uint32_t audio_next;
+    // video
+    int video_fail_at;              // Return an error at this sequence, -1 = never
+    // mux
+    uint32_t video_expected;
+    uint32_t audio_expected;
+    int order_broken;
+    int mux_delay_every;            // Slow sink: sleep 1 ms every n items
+    // thread hooks
+    platform_atomic_t inits;
+    platform_atomic_t exits;
+} test_graph_t;
+
+static void graph_thread_init(void* context) {
+    platform_atomic_inc(&((test_graph_t*)context)->inits);
+}
+
+static void graph_thread_exit(void* context) {
+    platform_atomic_inc(&((test_graph_t*)context)->exits);
+}
+
+static int capture_step(void* context) {
+    test_graph_t* graph = (test_graph_t*)context;
+    if (graph->capture_limit && graph->capture_next >= graph->capture_limit) return PIPELINE_STEP_DONE;
+
+    test_item_t item = { graph->capture_next, graph->capture_next * 3u };
+    if (spsc_ring_push(&graph->capture_queue, &item) != 0) {
+        // A full queue would mean a dropped frame when recording; here the source waits
+        pipeline_notify(&graph->pipeline, graph->video_stage);
+        return PIPELINE_STEP_IDLE;
+    }
+    graph->capture_next++;
+    pipeline_notify(&graph->pipeline, graph->video_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int audio_step(void* context) {
+    test_graph_t* graph = (test_graph_t*)context;
+    test_item_t item = { graph->audio_next, graph->audio_next + 7u };
+    if (spsc_ring_push(&graph->audio_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    graph->audio_next++;
+    pipeline_notify(&graph->pipeline, graph->mux_stage);
+    return graph->audio_next % 64 == 0 ? PIPELINE_STEP_IDLE : PIPELINE_STEP_BUSY;
+}
+
+static int video_step(void* context) {
+    test_graph_t* graph = (test_graph_t*)context;
+    test_item_t item;
+    if (spsc_ring_depth(&graph->capture_queue) == 0) return PIPELINE_STEP_IDLE;
+    if (spsc_ring_depth(&graph->video_queue) >= graph->video_queue.capacity) return PIPELINE_STEP_BLOCKED;
+    if (spsc_ring_pop(&graph->capture_queue, &item) != 0) return PIPELINE_STEP_IDLE;
+    if (graph->video_fail_at >= 0 && item.sequence == (uint32_t)graph->video_fail_at) return PIPELINE_STEP_ERROR;
+
+    pipeline_notify(&graph->pipeline, 0);                   // Room for the source again
+
+    item.value += 1;
+    // Only this stage pushes here and the depth was checked above
+    spsc_ring_push(&graph->video_queue, &item);
+    pipeline_notify(&graph->pipeline, graph->mux_stage);
+    return PIPELINE_STEP_BUSY;
+}
+
+static int mux_step(void* context) {
+    test_graph_t* graph = (test_graph_t*)context;
+    int worked = 0;
+    test_item_t item;
+
+    if (spsc_ring_pop(&graph->video_queue, &item) == 0) {
+        if (item.sequence != graph->video_expected || item.value != item.sequence * 3u + 1u) graph->order_broken = 1;
+        graph->video_expected++;
+        worked = 1;
+        if (graph->mux_delay_every && item.sequence % (uint32_t)graph->mux_delay_every == 0) platform_sleep_ms(1);
+    }
+    if (spsc_ring_pop(&graph->audio_queue, &item) == 0) {
+        if (item.sequence != graph->audio_expected || item.value != item.sequence + 7u) graph->order_broken = 1;
+        graph->audio_expected++;
+        worked = 1;
+    }
+    return worked ? PIPELINE_STEP_BUSY : PIPELINE_STEP_IDLE;
+}
+
+static int graph_init(test_graph_t* graph, unsigned int depth) {
+    memset(graph, 0, sizeof(test_graph_t));
+    graph->video_fail_at = -1;
+    if (pipeline_init(&graph->pipeline) != 0) return -1;
+    if (spsc_ring_init(&graph->capture_queue, "capture->video", depth, sizeof(test_item_t)) != 0) return -1;
+    if (spsc_ring_init(&graph->video_queue, "video->mux", depth, sizeof(test_item_t)) != 0) return -1;
+    if (spsc_ring_init(&graph->audio_queue, "audio->mux", depth, sizeof(test_item_t)) != 0) return -1;
+    pipeline_add_queue(&graph->pipeline, &graph->capture_queue);
+    pipeline_add_queue(&graph->pipeline, &graph->video_queue);
+    pipeline_add_queue(&graph->pipeline, &graph->audio_queue);
+
+    pipeline_stage_desc_t capture = { "capture", capture_step, graph_thread_init, graph_thread_exit, graph, 1, 1 };
+    pipeline_stage_desc_t audio = { "audio", audio_step, graph_thread_init, graph_thread_exit, graph, 1, 1 };
+    pipeline_stage_desc_t video = { "video", video_step, graph_thread_init, graph_thread_exit, graph, 0, 0 };
+    pipeline_stage_desc_t mux = { "mux", mux_step, graph_thread_init, graph_thread_exit, graph, 0, 0 };
+    if (pipeline_add_stage(&graph->pipeline, &capture) != 0) return -1;
+    if (pipeline_add_stage(&graph->pipeline, &audio) != 1) return -1;
+    graph->video_stage = pipeline_add_stage(&graph->pipeline, &video);
+    graph->mux_stage = pipeline_add_stage(&graph->pipeline, &mux);
+    return graph->mux_stage == 3 ? 0 : -1;
+}
+
+static void graph_cleanup(test_graph_t* graph) {
+    pipeline_cleanup(&graph->pipeline);
+    spsc_ring_cleanup(&graph->capture_queue);
+    spsc_ring_cleanup(&graph->video_queue);
+    spsc_ring_cleanup(&graph->audio_queue);
+}
+
+static int wait_finished(pipeline_t* pipeline, int timeout_ms) {
+    for (int waited = 0; waited < timeout_ms; waited++) {
+        if (pipeline_finished(pipeline)) return 1;
+        platform_sleep_ms(1);
+    }
+    return 0;
+}
+
+static void quiet_report(const char* message) {
+    (void)message;
+}
+
+static int test_stage_validation(void) {
+    pipeline_t pipeline;
+    TEST_ASSERT(pipeline_init(&pipeline) == 0);
+    TEST_ASSERT(pipeline_start(&pipeline) != 0);             // No stages
+
+    pipeline_stage_desc_t empty = { "empty", NULL, NULL, NULL, NULL, 0, 0 };
+    TEST_ASSERT(pipeline_add_stage(&pipeline, &empty) < 0);
+    pipeline_cleanup(&pipeline);
+    return 0;
+}
+
+// A finite source runs to the end; everything it produced reaches the sink in order
+static int test_finite_source_drains_everything(void) {
+    test_graph_t graph;
+    TEST_ASSERT(graph_init(&graph, 4) == 0);
+    graph.capture_limit = 20000;
+    graph.mux_delay_every = 2500;
+
+    TEST_ASSERT(pipeline_start(&graph.pipeline) == 0);
+    TEST_ASSERT(wait_finished(&graph.pipeline, 20000));
+    pipeline_stop(&graph.pipeline);
+
+    TEST_ASSERT(!pipeline_failed(&graph.pipeline));
+    TEST_ASSERT(!graph.order_broken);
+    TEST_ASSERT_EQ(20000, (int)graph.video_expected);
+    TEST_ASSERT_EQ((int)graph.audio_next, (int)graph.audio_expected);    // Audio drained too
+    TEST_ASSERT_EQ(4, (int)platform_atomic_load(&graph.inits));
+    TEST_ASSERT_EQ(4, (int)platform_atomic_load(&graph.exits));
+
+    spsc_ring_stats_t stats;
+    spsc_ring_get_stats(&graph.capture_queue, &stats);
+    TEST_ASSERT_EQ(0, (int)stats.depth);
+    TEST_ASSERT(stats.high_water <= 4);
+    TEST_ASSERT(stats.full > 0);                             // The slow sink backed the source up
+
+    pipeline_report(&graph.pipeline, quiet_report);
+    graph_cleanup(&graph);
+    return 0;
+}
+
+// Stopping an endless source mid-run still delivers everything already queued
+static int test_stop_while_running(void) {
+    for (int run = 0; run < 20; run++) {
+        test_graph_t graph;
+        TEST_ASSERT(graph_init(&graph, 8) == 0);
+        TEST_ASSERT(pipeline_start(&graph.pipeline) == 0);
+        platform_sleep_ms((unsigned int)(run % 5));
+        pipeline_stop(&graph.pipeline);
+
+        TEST_ASSERT(!graph.order_broken);
+        TEST_ASSERT_EQ((int)graph.capture_next, (int)graph.video_expected);
+        TEST_ASSERT_EQ((int)graph.audio_next, (int)graph.audio_expected);
+        TEST_ASSERT_EQ(0, (int)spsc_ring_depth(&graph.capture_queue));
+        TEST_ASSERT_EQ(0, (int)spsc_ring_depth(&graph.video_queue));
+        TEST_ASSERT(!pipeline_finished(&graph.pipeline));
+        graph_cleanup(&graph);
+    }
+    return 0;
+}
+
+// One pipeline started again and again: a stage that is already running may notify the
+// next before that one's thread exists, so every stage is reset before any starts
+static int test_restart(void) {
+    test_graph_t graph;
+    TEST_ASSERT(graph_init(&graph, 8) == 0);
+    for (int run = 0; run < 30; run++) {
+        TEST_ASSERT(pipeline_start(&graph.pipeline) == 0);
+        platform_sleep_ms((unsigned int)(run % 3));
+        pipeline_stop(&graph.pipeline);
+
+        TEST_ASSERT(!graph.order_broken);
+        TEST_ASSERT_EQ((int)graph.capture_next, (int)graph.video_expected);
+        TEST_ASSERT_EQ((int)graph.audio_next, (int)graph.audio_expected);
+        TEST_ASSERT_EQ(4 * (run + 1), (int)platform_atomic_load(&graph.exits));
+    }
+    graph_cleanup(&graph);
+    return 0;
+}
+
+static int test_stage_error_fails_pipeline(void) {
+    test_graph_t graph;
+    TEST_ASSERT(graph_init(&graph, 4) == 0);
+    graph.video_fail_at = 100;
+
+    TEST_ASSERT(pipeline_start(&graph.pipeline) == 0);
+    TEST_ASSERT(wait_finished(&graph.pipeline, 20000));
+    TEST_ASSERT(pipeline_failed(&graph.pipeline));
+    pipeline_stop(&graph.pipeline);
+
+    TEST_ASSERT(!graph.order_broken);
+    TEST_ASSERT_EQ(100, (int)graph.video_expected);
+    TEST_ASSERT_EQ(4, (int)platform_atomic_load(&graph.exits));
+    graph_cleanup(&graph);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_stage_validation);
+    RUN_TEST(test_finite_source_drains_everything);
+    RUN_TEST(test_stop_while_running);
+    RUN_TEST(test_restart);
+    RUN_TEST(test_stage_error_fails_pipeline);
+
+    return failures == 0 ? 0 : 1;
+}
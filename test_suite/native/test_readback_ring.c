@@ -0,0 +1,192 @@
+#include "test_common.h"
+#include "readback_ring.h"
+#include <string.h>
+
+// Mock device: a copy completes gpu_delay ticks after it was issued; mapping
+// before that either fails (try) or advances the clock until it completes (wait).
+typedef struct {
+    int gpu_delay;
+    int tick;
+    int ready_at[READBACK_RING_MAX_DEPTH];
+    int content[READBACK_RING_MAX_DEPTH];   // Update index each surface holds
+    int applied[64];                        // Update indices in the order they were consumed
+    int applied_count;
+    int waited_ticks;
+} mock_device_t;
+
+static void mock_copy(mock_device_t* device, int slot, int update) {
+    device->ready_at[slot] = device->tick + device->gpu_delay;
+    device->content[slot] = update;
+}
+
+// Returns 1 when mapped, 0 when a try found the copy running
+static int mock_map(mock_device_t* device, int slot, int wait, int* stalled) {
+    *stalled = 0;
+    if (device->tick < device->ready_at[slot]) {
+        if (!wait) return 0;
+        device->waited_ticks += device->ready_at[slot] - device->tick;
+        device->tick = device->ready_at[slot];
+        *stalled = 1;
+    }
+    device->applied[device->applied_count++] = device->content[slot];
+    return 1;
+}
+
+// The capture loop's use of the ring: drain what is due, then optionally copy a new update
+static void mock_drain(readback_ring_t* ring, mock_device_t* device, int idle) {
+    int slot;
+    readback_action_t action;
+    while ((action = readback_ring_next(ring, idle, &slot)) != READBACK_IDLE) {
+        int stalled;
+        if (!mock_map(device, slot, action == READBACK_WAIT, &stalled)) {
+            readback_ring_defer(ring);
+            break;
+        }
+        readback_ring_retire(ring, stalled);
+    }
+}
+
+static int mock_capture(readback_ring_t* ring, mock_device_t* device, int update) {
+    mock_drain(ring, device, 0);
+    int slot = readback_ring_begin(ring);
+    if (slot < 0) return -1;
+    mock_copy(device, slot, update);
+    readback_ring_submit(ring);
+    mock_drain(ring, device, 0);
+    device->tick++;
+    return 0;
+}
+
+static int test_init_validation(void) {
+    readback_ring_t ring;
+    TEST_ASSERT(readback_ring_init(NULL, 3, 2) != 0);
+    TEST_ASSERT(readback_ring_init(&ring, 0, 0) != 0);
+    TEST_ASSERT(readback_ring_init(&ring, READBACK_RING_MAX_DEPTH + 1, 1) != 0);
+    TEST_ASSERT(readback_ring_init(&ring, 3, 3) != 0);       // Latency must leave a free slot
+    TEST_ASSERT(readback_ring_init(&ring, 3, -1) != 0);
+    TEST_ASSERT(readback_ring_init(&ring, 1, 0) == 0);
+    TEST_ASSERT(readback_ring_init(&ring, READBACK_RING_DEFAULT_DEPTH, READBACK_RING_DEFAULT_LATENCY) == 0);
+
+    int slot = -1;
+    TEST_ASSERT_EQ(READBACK_IDLE, readback_ring_next(&ring, 1, &slot));
+    readback_ring_retire(&ring, 0);                          // Nothing in flight: ignored
+    TEST_ASSERT_EQ(0, (int)ring.retired);
+    return 0;
+}
+
+static int test_slots_rotate_and_fill(void) {
+    readback_ring_t ring;
+    TEST_ASSERT(readback_ring_init(&ring, 3, 2) == 0);
+
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQ(i, readback_ring_begin(&ring));
+        readback_ring_submit(&ring);
+    }
+    TEST_ASSERT_EQ(-1, readback_ring_begin(&ring));          // Every slot in flight
+
+    int slot = -1;
+    TEST_ASSERT_EQ(READBACK_WAIT, readback_ring_next(&ring, 0, &slot));
+    TEST_ASSERT_EQ(0, slot);
+    readback_ring_retire(&ring, 0);
+    TEST_ASSERT_EQ(0, readback_ring_begin(&ring));           // Oldest slot comes back first
+
+    // Two in flight at latency 2: nothing due unless idle
+    TEST_ASSERT_EQ(READBACK_IDLE, readback_ring_next(&ring, 0, &slot));
+    TEST_ASSERT_EQ(READBACK_TRY, readback_ring_next(&ring, 1, &slot));
+    TEST_ASSERT_EQ(1, slot);
+
+    readback_ring_reset(&ring);
+    TEST_ASSERT_EQ(0, ring.in_flight);
+    TEST_ASSERT_EQ(0, readback_ring_begin(&ring));
+    return 0;
+}
+
+// Copy N is issued and N - latency is mapped; with the GPU done in time nothing waits
+static int test_pipelined_capture_never_stalls(void) {
+    readback_ring_t ring;
+    mock_device_t device;
+    memset(&device, 0, sizeof(device));
+    device.gpu_delay = 2;
+    TEST_ASSERT(readback_ring_init(&ring, 3, 2) == 0);
+
+    for (int update = 0; update < 20; update++) {
+        TEST_ASSERT(mock_capture(&ring, &device, update) == 0);
+        TEST_ASSERT(ring.in_flight <= 2);
+        if (update >= 2) TEST_ASSERT_EQ(update - 1, device.applied_count);
+    }
+    TEST_ASSERT_EQ(0, (int)ring.stalls);
+    TEST_ASSERT_EQ(0, device.waited_ticks);
+
+    // Idle polls pick up the tail once the GPU is done, in order
+    for (int i = 0; i < 4 && ring.in_flight > 0; i++) {
+        mock_drain(&ring, &device, 1);
+        device.tick++;
+    }
+    TEST_ASSERT_EQ(0, ring.in_flight);
+    TEST_ASSERT_EQ(20, device.applied_count);
+    for (int i = 0; i < 20; i++) TEST_ASSERT_EQ(i, device.applied[i]);
+    TEST_ASSERT_EQ(20, (int)ring.retired);
+    TEST_ASSERT_EQ(0, (int)ring.stalls);
+    return 0;
+}
+
+// Mapping straight after the copy is the old behaviour: a GPU wait on every update
+static int test_zero_latency_stalls_every_update(void) {
+    readback_ring_t ring;
+    mock_device_t device;
+    memset(&device, 0, sizeof(device));
+    device.gpu_delay = 2;
+    TEST_ASSERT(readback_ring_init(&ring, 1, 0) == 0);
+
+    for (int update = 0; update < 10; update++) {
+        TEST_ASSERT(mock_capture(&ring, &device, update) == 0);
+        TEST_ASSERT_EQ(0, ring.in_flight);
+    }
+    TEST_ASSERT_EQ(10, (int)ring.stalls);
+    TEST_ASSERT_EQ(20, device.waited_ticks);
+    for (int i = 0; i < 10; i++) TEST_ASSERT_EQ(i, device.applied[i]);
+    return 0;
+}
+
+// A GPU slower than the latency costs a wait only for the copies that are late
+static int test_slow_gpu_waits_and_idle_defers(void) {
+    readback_ring_t ring;
+    mock_device_t device;
+    memset(&device, 0, sizeof(device));
+    device.gpu_delay = 3;
+    TEST_ASSERT(readback_ring_init(&ring, 3, 2) == 0);
+
+    for (int update = 0; update < 6; update++) {
+        TEST_ASSERT(mock_capture(&ring, &device, update) == 0);
+    }
+    TEST_ASSERT(ring.stalls > 0);
+    TEST_ASSERT(ring.stalls < 6);
+
+    // An idle poll never waits: it stops at the newest copy, which is still running
+    uint64_t stalls = ring.stalls;
+    mock_drain(&ring, &device, 1);
+    TEST_ASSERT(ring.in_flight > 0);
+    TEST_ASSERT_EQ(stalls, ring.stalls);
+    TEST_ASSERT(ring.deferred > 0);
+
+    for (int i = 0; i < 8 && ring.in_flight > 0; i++) {
+        device.tick++;
+        mock_drain(&ring, &device, 1);
+    }
+    TEST_ASSERT_EQ(0, ring.in_flight);
+    TEST_ASSERT_EQ(6, device.applied_count);
+    for (int i = 0; i < 6; i++) TEST_ASSERT_EQ(i, device.applied[i]);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_slots_rotate_and_fill);
+    RUN_TEST(test_pipelined_capture_never_stalls);
+    RUN_TEST(test_zero_latency_stalls_every_update);
+    RUN_TEST(test_slow_gpu_waits_and_idle_defers);
+
+    return failures == 0 ? 0 : 1;
+}
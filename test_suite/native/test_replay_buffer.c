@@ -0,0 +1,412 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "replay_buffer.h"
+#include <stdio.h>
+
+#define REPLAY_TEST_FILE "test_replay_buffer.mp4"
+#define REPLAY_GOP 15
+#define REPLAY_SLICE_BASE 400
+
+static int64_t video_time(uint64_t frame) {
+    return (int64_t)frame * REPLAY_UNITS_PER_SECOND / 30;
+}
+
+static int64_t audio_time(uint64_t index) {
+    return (int64_t)index * AAC_SAMPLES_PER_FRAME * REPLAY_UNITS_PER_SECOND / 48000;
+}
+
+// 30 fps video with a keyframe every half second, and 48 kHz AAC slightly ahead of it
+typedef struct {
+    uint64_t frame;
+    uint64_t audio;
+    size_t slice_base;
+    int video;
+    int audio_enabled;
+} feed_t;
+
+static int feed(replay_buffer_t* buffer, feed_t* state, uint64_t frames) {
+    static uint8_t unit[16384];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 40, 1280, 720);
+    for (uint64_t end = state->frame + frames; state->frame < end; state->frame++) {
+        uint64_t frame = state->frame;
+        if (state->video) {
+            int keyframe = frame % REPLAY_GOP == 0;
+            size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframe,
+                                              fixture_slice_size(frame, keyframe, state->slice_base), sps, sps_size);
+            if (replay_buffer_write_video(buffer, unit, size, video_time(frame)) != 0) return -1;
+        }
+        while (state->audio_enabled && state->audio * AAC_SAMPLES_PER_FRAME * 30 <= (frame + 1) * 48000) {
+            size_t size = fixture_adts_frame(unit, state->audio, 48000, 2);
+            if (replay_buffer_write_audio(buffer, unit, size, audio_time(state->audio)) != 0) return -1;
+            state->audio++;
+        }
+        if (buffer->used > buffer->config.budget_bytes) return -1;
+    }
+    return 0;
+}
+
+// Where the saved file starts in the fixture streams
+typedef struct {
+    uint64_t video_base;
+    uint64_t audio_base;
+    size_t slice_base;
+} saved_t;
+
+static saved_t saved_from(int64_t start_time, size_t slice_base) {
+    saved_t saved = { 0, 0, slice_base };
+    while (video_time(saved.video_base) < start_time) saved.video_base++;
+    while (audio_time(saved.audio_base) < start_time) saved.audio_base++;
+    return saved;
+}
+
+// Sample content, regenerated from the fixture generators
+static int check_sample(void* context, int track, uint64_t index, uint64_t time,
+                        const uint8_t* data, uint32_t size, uint32_t flags) {
+    static uint8_t payload[16384];
+    const saved_t* saved = (const saved_t*)context;
+    (void)time;
+
+    if (track == FIXTURE_AUDIO) {
+        index += saved->audio_base;
+        if (size != fixture_aac_size(index)) return -1;
+        fixture_aac_payload(index, payload, size);
+        return memcmp(payload, data, size) == 0 ? 0 : -1;
+    }
+    index += saved->video_base;
+    int keyframe = index % REPLAY_GOP == 0;
+    size_t slice = fixture_slice_size(index, keyframe, saved->slice_base);
+    if (size != 4 + 1 + slice || slice > sizeof(payload) || keyframe != !(flags & 0x00010000)) return -1;
+    fixture_slice_payload(index, payload, slice);
+    return memcmp(payload, data + 5, slice) == 0 ? 0 : -1;
+}
+
+static size_t read_saved(uint8_t* data, size_t capacity) {
+    FILE* file = fopen(REPLAY_TEST_FILE, "rb");
+    if (!file) return 0;
+    size_t size = fread(data, 1, capacity, file);
+    fclose(file);
+    remove(REPLAY_TEST_FILE);
+    return size;
+}
+
+// The buffer starts on a keyframe and no video before it is kept
+static int starts_on_keyframe(replay_buffer_t* buffer) {
+    if (buffer->keyframe_count == 0) {
+        for (uint64_t sequence = buffer->head; sequence < buffer->tail_sequence; sequence++) {
+            if (buffer->packets[sequence % buffer->config.max_packets].type == REPLAY_PACKET_VIDEO) return 0;
+        }
+        return 1;
+    }
+    uint64_t first = buffer->keyframes[buffer->keyframe_first];
+    if (first < buffer->head || !buffer->packets[first % buffer->config.max_packets].keyframe) return 0;
+    for (uint64_t sequence = buffer->head; sequence < first; sequence++) {
+        if (buffer->packets[sequence % buffer->config.max_packets].type == REPLAY_PACKET_VIDEO) return 0;
+    }
+    return 1;
+}
+
+// Memory stays within the budget while whole GOPs leave from the front
+static int test_budget(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 256 * 1024, 0, 0, 1, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, REPLAY_SLICE_BASE, 1, 1 };
+    for (int i = 0; i < 120; i++) {
+        TEST_ASSERT(feed(&buffer, &state, 5) == 0);
+        TEST_ASSERT(starts_on_keyframe(&buffer));
+    }
+
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT(stats.gops_evicted > 10);
+    TEST_ASSERT(stats.peak_bytes <= config.budget_bytes);
+    TEST_ASSERT_EQ(0, stats.dropped_before_keyframe);
+    TEST_ASSERT_EQ(0, stats.dropped_oversize);
+    // A GOP is about 10 KB of video and 3 KB of audio: the budget holds 9 s or so
+    int64_t duration = replay_buffer_duration(&buffer);
+    TEST_ASSERT(duration > 8 * REPLAY_UNITS_PER_SECOND && duration < 12 * REPLAY_UNITS_PER_SECOND);
+    TEST_ASSERT(replay_buffer_bytes(&buffer) > config.budget_bytes * 9 / 10);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+// The saved file holds exactly the buffered frames, from the first keyframe
+static int test_save(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 128 * 1024, 0, 0, 1, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, REPLAY_SLICE_BASE, 1, 1 };
+    TEST_ASSERT(feed(&buffer, &state, 400) == 0);
+
+    uint64_t first = buffer.keyframes[buffer.keyframe_first];
+    int64_t first_time = buffer.packets[first % buffer.config.max_packets].time;
+    replay_save_result_t result;
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, &result) == 0);
+    TEST_ASSERT(result.start_time <= first_time);
+    // Audio already playing at the keyframe starts the file, less than a frame earlier
+    TEST_ASSERT(first_time - result.start_time < audio_time(1));
+    TEST_ASSERT_EQ(400 - (uint64_t)(first_time * 30 / REPLAY_UNITS_PER_SECOND), result.video_frames);
+
+    static uint8_t data[1 << 20];
+    size_t size = read_saved(data, sizeof(data));
+    TEST_ASSERT(size > 0);
+    TEST_ASSERT_EQ(result.bytes_written, size);
+
+    fixture_mp4_t info;
+    saved_t saved = saved_from(result.start_time, REPLAY_SLICE_BASE);
+    TEST_ASSERT_EQ(0, saved.video_base % REPLAY_GOP);
+    int parsed = fixture_parse_fmp4(data, size, 0, &info, check_sample, &saved);
+    if (parsed != 0) fprintf(stderr, "Saved file: %s\n", info.error);
+    TEST_ASSERT(parsed == 0);
+    TEST_ASSERT_EQ(result.video_frames, info.samples[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(result.audio_frames, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(state.audio - saved.audio_base, info.samples[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(info.video_runs, info.sync_starts);
+
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT_EQ(1, stats.saves);
+    TEST_ASSERT_EQ(result.duration, stats.last_save_duration);
+    // The buffer keeps going after a save
+    TEST_ASSERT(feed(&buffer, &state, 30) == 0);
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, &result) == 0);
+    remove(REPLAY_TEST_FILE);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+// max_duration keeps the last GOPs that cover it, however large the budget
+static int test_max_duration(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 8 * 1024 * 1024, 0, 3 * REPLAY_UNITS_PER_SECOND, 1, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, REPLAY_SLICE_BASE, 1, 1 };
+    for (int i = 0; i < 60; i++) {
+        TEST_ASSERT(feed(&buffer, &state, 10) == 0);
+        if (state.frame < 120) continue;
+        int64_t duration = replay_buffer_duration(&buffer);
+        TEST_ASSERT(duration >= config.max_duration);
+        TEST_ASSERT(duration < config.max_duration + REPLAY_UNITS_PER_SECOND / 2 + audio_time(1));
+        TEST_ASSERT(starts_on_keyframe(&buffer));
+    }
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT(stats.peak_bytes < 128 * 1024);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+typedef struct {
+    replay_buffer_t* buffer;
+    feed_t* state;
+    int result;
+} writer_t;
+
+// A save runs on the saver thread while capture keeps writing, evicting the
+// packets it has written behind it; the file is still whole and correct
+static int test_save_while_writing(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 96 * 1024, 0, 0, 1, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, REPLAY_SLICE_BASE, 1, 1 };
+    TEST_ASSERT(feed(&buffer, &state, 300) == 0);
+
+    TEST_ASSERT(replay_buffer_request_save(&buffer, REPLAY_TEST_FILE) == 0);
+    for (int i = 0; i < 300; i++) {
+        TEST_ASSERT(feed(&buffer, &state, 1) == 0);
+        TEST_ASSERT(starts_on_keyframe(&buffer) || buffer.saving);
+    }
+    replay_buffer_wait_saves(&buffer);
+
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT_EQ(1, stats.saves);
+    TEST_ASSERT_EQ(0, stats.save_failures);
+
+    static uint8_t data[1 << 20];
+    size_t size = read_saved(data, sizeof(data));
+    TEST_ASSERT(size > 0);
+    // The saved range is what the buffer held when the saver started
+    fixture_mp4_t info;
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, NULL, NULL) == 0);
+    TEST_ASSERT(info.samples[FIXTURE_VIDEO] > 60);
+    TEST_ASSERT_EQ(info.video_runs, info.sync_starts);
+
+    // Queued saves beyond the limit are refused, the rest all written
+    int accepted = 0;
+    for (int i = 0; i < REPLAY_MAX_REQUESTS + 4; i++) {
+        if (replay_buffer_request_save(&buffer, REPLAY_TEST_FILE) == 0) accepted++;
+    }
+    TEST_ASSERT(accepted >= REPLAY_MAX_REQUESTS && accepted < REPLAY_MAX_REQUESTS + 4);
+    replay_buffer_wait_saves(&buffer);
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT_EQ(1 + (uint64_t)accepted, stats.saves);
+    remove(REPLAY_TEST_FILE);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+// A GOP larger than the whole budget empties the buffer; video resumes at the next keyframe
+static int test_oversize_gop(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 24 * 1024, 0, 0, 1, 0, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, 2500, 1, 0 };
+    for (int i = 0; i < 90; i++) {
+        TEST_ASSERT(feed(&buffer, &state, 1) == 0);
+        TEST_ASSERT(starts_on_keyframe(&buffer));
+    }
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT(stats.dropped_oversize >= 5);
+    TEST_ASSERT(stats.dropped_before_keyframe > 0);
+
+    // Smaller frames fit again from the next keyframe on
+    state.slice_base = 200;
+    TEST_ASSERT(feed(&buffer, &state, 60) == 0);
+    TEST_ASSERT(buffer.keyframe_count > 1);
+
+    replay_save_result_t result;
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, &result) == 0);
+    static uint8_t data[1 << 20];
+    size_t size = read_saved(data, sizeof(data));
+    fixture_mp4_t info;
+    saved_t saved = saved_from(result.start_time, 200);
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, &saved) == 0);
+    TEST_ASSERT_EQ(result.video_frames, info.samples[FIXTURE_VIDEO]);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_audio_only(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 1024 * 1024, 0, 2 * REPLAY_UNITS_PER_SECOND, 0, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    feed_t state = { 0, 0, 0, 0, 1 };
+    TEST_ASSERT(feed(&buffer, &state, 300) == 0);
+    int64_t duration = replay_buffer_duration(&buffer);
+    TEST_ASSERT(duration >= config.max_duration && duration <= config.max_duration + audio_time(1));
+
+    replay_save_result_t result;
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, &result) == 0);
+    static uint8_t data[1 << 20];
+    size_t size = read_saved(data, sizeof(data));
+    fixture_mp4_t info;
+    saved_t saved = saved_from(result.start_time, 0);
+    TEST_ASSERT(fixture_parse_fmp4(data, size, 0, &info, check_sample, &saved) == 0);
+    TEST_ASSERT(!info.tracks[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(state.audio - saved.audio_base, info.samples[FIXTURE_AUDIO]);
+    // 2 s of 48 kHz is 93.75 frames
+    TEST_ASSERT_EQ(94, info.samples[FIXTURE_AUDIO]);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+// Random packet sizes and GOP lengths over a small block and index: live
+// packets never overlap, stay within the budget and keep their bytes
+static int test_wraparound(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 10000, 48, 0, 1, 0, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 40, 640, 480);
+    static uint8_t unit[8192];
+    static uint8_t expected[8192];
+    static size_t slices[3000];
+    static int keyframes[3000];
+
+    uint32_t seed = 777;
+    for (uint64_t frame = 0; frame < 3000; frame++) {
+        seed = seed * 1664525u + 1013904223u;
+        keyframes[frame] = frame == 0 || (seed >> 24) % 9 == 0;
+        slices[frame] = 1 + (seed >> 8) % ((seed >> 28) < 2 ? 6000 : 700);
+        size_t size = fixture_access_unit(unit, sizeof(unit), frame, keyframes[frame], slices[frame], sps, sps_size);
+        TEST_ASSERT(replay_buffer_write_video(&buffer, unit, size, (int64_t)frame) == 0);
+
+        TEST_ASSERT(buffer.used <= config.budget_bytes);
+        TEST_ASSERT(buffer.tail_sequence - buffer.head <= config.max_packets);
+        TEST_ASSERT(starts_on_keyframe(&buffer));
+        size_t live = 0;
+        for (uint64_t sequence = buffer.head; sequence < buffer.tail_sequence; sequence++) {
+            const replay_packet_t* packet = &buffer.packets[sequence % config.max_packets];
+            uint64_t source = (uint64_t)packet->time;
+            size_t length = fixture_access_unit(expected, sizeof(expected), source, keyframes[source],
+                                                slices[source], sps, sps_size);
+            TEST_ASSERT_EQ(length, packet->size);
+            TEST_ASSERT(packet->offset + packet->size <= config.budget_bytes);
+            TEST_ASSERT(memcmp(expected, buffer.data + packet->offset, length) == 0);
+            live += packet->span;
+        }
+        TEST_ASSERT_EQ(live, buffer.used);
+    }
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT(stats.gops_evicted > 100);
+    TEST_ASSERT(stats.dropped_oversize > 0);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+static int test_invalid(void) {
+    replay_buffer_t buffer;
+    replay_config_t config = { 0, 0, 0, 1, 1, 0 };
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) != 0);
+    config.budget_bytes = 65536;
+    config.video = 0;
+    config.audio = 0;
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) != 0);
+
+    config.video = 1;
+    TEST_ASSERT(replay_buffer_init(&buffer, &config) == 0);
+    // Nothing to start from yet
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, NULL) != 0);
+    uint8_t unit[1024];
+    uint8_t sps[FIXTURE_MAX_SPS];
+    size_t sps_size = fixture_sps(sps, 100, 0, 40, 640, 480);
+    size_t size = fixture_access_unit(unit, sizeof(unit), 1, 0, 100, sps, sps_size);
+    TEST_ASSERT(replay_buffer_write_video(&buffer, unit, size, 0) == 0);
+    TEST_ASSERT(replay_buffer_save(&buffer, REPLAY_TEST_FILE, NULL) != 0);
+    replay_stats_t stats;
+    replay_buffer_get_stats(&buffer, &stats);
+    TEST_ASSERT_EQ(1, stats.dropped_before_keyframe);
+    TEST_ASSERT_EQ(0, stats.packets);
+
+    // No audio configured, and a path too long to queue
+    size = fixture_adts_frame(unit, 0, 48000, 2);
+    TEST_ASSERT(replay_buffer_write_audio(&buffer, unit, size, 0) != 0);
+    char path[REPLAY_MAX_PATH + 1];
+    memset(path, 'a', sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+    TEST_ASSERT(replay_buffer_request_save(&buffer, path) != 0);
+    replay_buffer_cleanup(&buffer);
+    return 0;
+}
+
+// Saves are numbered after the recording's name
+static int test_path(void) {
+    char path[64];
+    TEST_ASSERT(replay_buffer_path("clip.mp4", 1, path, sizeof(path)) == 0);
+    TEST_ASSERT(strcmp(path, "clip-replay-001.mp4") == 0);
+    TEST_ASSERT(replay_buffer_path("C:\\out.d\\clip", 12, path, sizeof(path)) == 0);
+    TEST_ASSERT(strcmp(path, "C:\\out.d\\clip-replay-012") == 0);
+    TEST_ASSERT(replay_buffer_path("clip.mp4", 1, path, 12) != 0);
+    TEST_ASSERT(replay_buffer_path(NULL, 1, path, sizeof(path)) != 0);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_budget);
+    RUN_TEST(test_save);
+    RUN_TEST(test_max_duration);
+    RUN_TEST(test_save_while_writing);
+    RUN_TEST(test_oversize_gop);
+    RUN_TEST(test_audio_only);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_invalid);
+    RUN_TEST(test_path);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+#include "test_common.h"
+#include "scaler.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Smooth content with a sharp edge, closer to a desktop than noise
+static void fill_pattern(uint8_t* data, int width, int height, size_t pitch) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* px = data + (size_t)y * pitch + (size_t)x * 4;
+            px[0] = (uint8_t)(x * 255 / (width > 1 ? width - 1 : 1));
+            px[1] = (uint8_t)(y * 255 / (height > 1 ? height - 1 : 1));
+            px[2] = x < width / 3 ? 255 : 0;
+            px[3] = (uint8_t)((x ^ y) & 0xFF);
+        }
+    }
+}
+
+// Reference area filter in double precision: mean over the exact source
+// rectangle each output pixel covers
+static double reference_area(const uint8_t* src, size_t pitch, int sw, int sh, int dw, int dh, int x, int y, int c) {
+    double x0 = (double)x * sw / dw, x1 = (double)(x + 1) * sw / dw;
+    double y0 = (double)y * sh / dh, y1 = (double)(y + 1) * sh / dh;
+    double sum = 0.0;
+    for (int sy = (int)floor(y0); sy < (int)ceil(y1); sy++) {
+        double wy = fmin(sy + 1.0, y1) - fmax((double)sy, y0);
+        for (int sx = (int)floor(x0); sx < (int)ceil(x1); sx++) {
+            double wx = fmin(sx + 1.0, x1) - fmax((double)sx, x0);
+            sum += wx * wy * src[(size_t)sy * pitch + (size_t)sx * 4 + c];
+        }
+    }
+    return sum / ((x1 - x0) * (y1 - y0));
+}
+
+// Reference bilinear filter with centre-aligned sampling and edge clamping
+static double reference_bilinear(const uint8_t* src, size_t pitch, int sw, int sh, int dw, int dh, int x, int y, int c) {
+    double fx = (x + 0.5) * sw / dw - 0.5;
+    double fy = (y + 0.5) * sh / dh - 0.5;
+    if (fx < 0) fx = 0;
+    if (fy < 0) fy = 0;
+    if (fx > sw - 1) fx = sw - 1;
+    if (fy > sh - 1) fy = sh - 1;
+    int x0 = (int)fx, y0 = (int)fy;
+    int x1 = x0 + 1 < sw ? x0 + 1 : x0;
+    int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+    double ax = fx - x0, ay = fy - y0;
+    double top = (1 - ax) * src[(size_t)y0 * pitch + (size_t)x0 * 4 + c] + ax * src[(size_t)y0 * pitch + (size_t)x1 * 4 + c];
+    double bottom = (1 - ax) * src[(size_t)y1 * pitch + (size_t)x0 * 4 + c] + ax * src[(size_t)y1 * pitch + (size_t)x1 * 4 + c];
+    return (1 - ay) * top + ay * bottom;
+}
+
+// Largest absolute difference between the scaler output and the reference
+static double max_error(const uint8_t* dst, size_t dst_pitch, const uint8_t* src, size_t src_pitch,
+                        int sw, int sh, int dw, int dh, scaler_filter_t filter) {
+    double worst = 0.0;
+    for (int y = 0; y < dh; y++) {
+        for (int x = 0; x < dw; x++) {
+            for (int c = 0; c < 4; c++) {
+                double expected = filter == SCALER_FILTER_BILINEAR
+                    ? reference_bilinear(src, src_pitch, sw, sh, dw, dh, x, y, c)
+                    : reference_area(src, src_pitch, sw, sh, dw, dh, x, y, c);
+                double error = fabs(dst[(size_t)y * dst_pitch + (size_t)x * 4 + c] - expected);
+                if (error > worst) worst = error;
+            }
+        }
+    }
+    return worst;
+}
+
+static int check_against_reference(int sw, int sh, int dw, int dh, scaler_filter_t filter, copy_kernel_level_t level) {
+    size_t src_pitch = (size_t)sw * 4 + 12;     // Padded pitch exercises strided access
+    size_t dst_pitch = (size_t)dw * 4;
+    uint8_t* src = (uint8_t*)malloc(src_pitch * sh);
+    uint8_t* dst = (uint8_t*)malloc(dst_pitch * dh);
+    TEST_ASSERT(src != NULL && dst != NULL);
+    fill_pattern(src, sw, sh, src_pitch);
+
+    scaler_t scaler;
+    TEST_ASSERT(scaler_init(&scaler, sw, sh, dw, dh, filter, NULL) == 0);
+    TEST_ASSERT(scaler_set_level(&scaler, level) == 0);
+    TEST_ASSERT(scaler_process(&scaler, dst, dst_pitch, src, src_pitch) == 0);
+
+    // Fixed-point weights and two rounding steps stay within one code value
+    double error = max_error(dst, dst_pitch, src, src_pitch, sw, sh, dw, dh, scaler.filter);
+    if (error > 1.0) {
+        fprintf(stderr, "  %dx%d -> %dx%d %s level %d: max error %.2f\n", sw, sh, dw, dh,
+                scaler_filter_name(scaler.filter), (int)level, error);
+    }
+    TEST_ASSERT(error <= 1.0);
+
+    scaler_cleanup(&scaler);
+    free(src);
+    free(dst);
+    return 0;
+}
+
+static int test_auto_filter_selection(void) {
+    scaler_t scaler;
+    TEST_ASSERT(scaler_init(&scaler, 3840, 2160, 1920, 1080, SCALER_FILTER_AUTO, NULL) == 0);
+    TEST_ASSERT_EQ(SCALER_FILTER_BOX2, scaler.filter);
+    scaler_cleanup(&scaler);
+
+    TEST_ASSERT(scaler_init(&scaler, 2560, 1440, 1920, 1080, SCALER_FILTER_AUTO, NULL) == 0);
+    TEST_ASSERT_EQ(SCALER_FILTER_AREA, scaler.filter);
+    scaler_cleanup(&scaler);
+
+    TEST_ASSERT(scaler_init(&scaler, 1280, 720, 1920, 1080, SCALER_FILTER_AUTO, NULL) == 0);
+    TEST_ASSERT_EQ(SCALER_FILTER_BILINEAR, scaler.filter);
+    scaler_cleanup(&scaler);
+
+    // The box path only handles exact halving
+    TEST_ASSERT(scaler_init(&scaler, 2560, 1440, 1920, 1080, SCALER_FILTER_BOX2, NULL) != 0);
+    return 0;
+}
+
+static int test_box2_matches_reference(void) {
+    // Widths around the SIMD block sizes hit every tail length
+    const int widths[] = { 2, 6, 8, 14, 16, 30, 34, 66, 200 };
+    for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+        if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+        for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+            int sw = widths[i] * 2;
+            int sh = 10;
+            size_t src_pitch = (size_t)sw * 4 + 20;
+            uint8_t* src = (uint8_t*)malloc(src_pitch * sh);
+            uint8_t* dst = (uint8_t*)malloc((size_t)widths[i] * 4 * (sh / 2));
+            TEST_ASSERT(src != NULL && dst != NULL);
+            fill_random(src, src_pitch * sh, (unsigned)(i + 17));
+
+            scaler_t scaler;
+            TEST_ASSERT(scaler_init(&scaler, sw, sh, widths[i], sh / 2, SCALER_FILTER_BOX2, NULL) == 0);
+            TEST_ASSERT(scaler_set_level(&scaler, (copy_kernel_level_t)level) == 0);
+            TEST_ASSERT(scaler_process(&scaler, dst, (size_t)widths[i] * 4, src, src_pitch) == 0);
+
+            // Box output is exact: rounded mean of four integers
+            for (int y = 0; y < sh / 2; y++) {
+                for (int x = 0; x < widths[i]; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        const uint8_t* a = src + (size_t)(2 * y) * src_pitch + (size_t)x * 8 + c;
+                        const uint8_t* b = a + src_pitch;
+                        int expected = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+                        TEST_ASSERT_EQ(expected, dst[(size_t)y * widths[i] * 4 + (size_t)x * 4 + c]);
+                    }
+                }
+            }
+
+            scaler_cleanup(&scaler);
+            free(src);
+            free(dst);
+        }
+    }
+    return 0;
+}
+
+static int test_area_matches_reference(void) {
+    for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+        if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+        copy_kernel_level_t l = (copy_kernel_level_t)level;
+        TEST_ASSERT(check_against_reference(256, 144, 192, 108, SCALER_FILTER_AREA, l) == 0);    // 1440p -> 1080p ratio
+        TEST_ASSERT(check_against_reference(384, 216, 128, 72, SCALER_FILTER_AREA, l) == 0);     // 3:1
+        TEST_ASSERT(check_against_reference(101, 77, 37, 23, SCALER_FILTER_AREA, l) == 0);       // Odd ratios and tails
+        TEST_ASSERT(check_against_reference(64, 40, 64, 40, SCALER_FILTER_AREA, l) == 0);        // Identity
+    }
+    return 0;
+}
+
+static int test_bilinear_matches_reference(void) {
+    for (int level = COPY_KERNEL_SCALAR; level < COPY_KERNEL_COUNT; level++) {
+        if (!copy_kernels_supported((copy_kernel_level_t)level)) continue;
+        copy_kernel_level_t l = (copy_kernel_level_t)level;
+        TEST_ASSERT(check_against_reference(128, 72, 192, 108, SCALER_FILTER_BILINEAR, l) == 0);  // Upscale
+        TEST_ASSERT(check_against_reference(200, 120, 150, 90, SCALER_FILTER_BILINEAR, l) == 0);  // Mild downscale
+        TEST_ASSERT(check_against_reference(33, 17, 70, 41, SCALER_FILTER_BILINEAR, l) == 0);
+    }
+    return 0;
+}
+
+static int test_simd_levels_are_bit_exact(void) {
+    const int sw = 333, sh = 187, dw = 250, dh = 140;
+    size_t src_pitch = (size_t)sw * 4;
+    size_t dst_pitch = (size_t)dw * 4;
+    uint8_t* src = (uint8_t*)malloc(src_pitch * sh);
+    uint8_t* expected = (uint8_t*)malloc(dst_pitch * dh);
+    uint8_t* actual = (uint8_t*)malloc(dst_pitch * dh);
+    TEST_ASSERT(src != NULL && expected != NULL && actual != NULL);
+    fill_random(src, src_pitch * sh, 99);
+
+    for (scaler_filter_t filter = SCALER_FILTER_AREA; filter <= SCALER_FILTER_BILINEAR; filter++) {
+        scaler_t scaler;
+        TEST_ASSERT(scaler_init(&scaler, sw, sh, dw, dh, filter, NULL) == 0);
+        TEST_ASSERT(scaler_set_level(&scaler, COPY_KERNEL_SCALAR) == 0);
+        TEST_ASSERT(scaler_process(&scaler, expected, dst_pitch, src, src_pitch) == 0);
+
+        for (int level = COPY_KERNEL_SSE2; level < COPY_KERNEL_COUNT; level++) {
+            if (scaler_set_level(&scaler, (copy_kernel_level_t)level) != 0) continue;
+            memset(actual, 0, dst_pitch * dh);
+            TEST_ASSERT(scaler_process(&scaler, actual, dst_pitch, src, src_pitch) == 0);
+            TEST_ASSERT(memcmp(expected, actual, dst_pitch * dh) == 0);
+        }
+        scaler_cleanup(&scaler);
+    }
+
+    free(src);
+    free(expected);
+    free(actual);
+    return 0;
+}
+
+static int test_threads_match_single_thread(void) {
+    const int sw = 640, sh = 360, dw = 426, dh = 240;
+    size_t src_pitch = (size_t)sw * 4;
+    size_t dst_pitch = (size_t)dw * 4;
+    uint8_t* src = (uint8_t*)malloc(src_pitch * sh);
+    uint8_t* single = (uint8_t*)malloc(dst_pitch * dh);
+    uint8_t* parallel = (uint8_t*)malloc(dst_pitch * dh);
+    TEST_ASSERT(src != NULL && single != NULL && parallel != NULL);
+    fill_random(src, src_pitch * sh, 7);
+
+    scaler_t scaler;
+    TEST_ASSERT(scaler_init(&scaler, sw, sh, dw, dh, SCALER_FILTER_AREA, NULL) == 0);
+    TEST_ASSERT(scaler_process(&scaler, single, dst_pitch, src, src_pitch) == 0);
+    scaler_cleanup(&scaler);
+
+    // Slices land on whichever worker claims them; the output must not depend on it
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(&pool, 4) == 0);
+    TEST_ASSERT(scaler_init(&scaler, sw, sh, dw, dh, SCALER_FILTER_AREA, &pool) == 0);
+    TEST_ASSERT_EQ(4, scaler.workers);
+    for (int run = 0; run < 8; run++) {
+        memset(parallel, 0, dst_pitch * dh);
+        TEST_ASSERT(scaler_process(&scaler, parallel, dst_pitch, src, src_pitch) == 0);
+        TEST_ASSERT(memcmp(single, parallel, dst_pitch * dh) == 0);
+    }
+    scaler_cleanup(&scaler);
+    worker_pool_cleanup(&pool);
+
+    free(src);
+    free(single);
+    free(parallel);
+    return 0;
+}
+
+static int test_output_size(void) {
+    int w = 0, h = 0;
+    TEST_ASSERT(scaler_output_size(3840, 2160, 0.5, 0, 0, &w, &h) == 0);
+    TEST_ASSERT_EQ(1920, w);
+    TEST_ASSERT_EQ(1080, h);
+
+    TEST_ASSERT(scaler_output_size(3840, 2160, 0.0, 1280, 720, &w, &h) == 0);
+    TEST_ASSERT_EQ(1280, w);
+    TEST_ASSERT_EQ(720, h);
+
+    // One side keeps the aspect ratio; odd results round down to even
+    TEST_ASSERT(scaler_output_size(2560, 1080, 0.0, 1000, 0, &w, &h) == 0);
+    TEST_ASSERT_EQ(1000, w);
+    TEST_ASSERT_EQ(422, h);
+
+    TEST_ASSERT(scaler_output_size(1920, 1080, 0.0, 0, 0, &w, &h) != 0);
+    TEST_ASSERT(scaler_output_size(1920, 1080, 0.0001, 0, 0, &w, &h) != 0);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_auto_filter_selection);
+    RUN_TEST(test_box2_matches_reference);
+    RUN_TEST(test_area_matches_reference);
+    RUN_TEST(test_bilinear_matches_reference);
+    RUN_TEST(test_simd_levels_are_bit_exact);
+    RUN_TEST(test_threads_match_single_thread);
+    RUN_TEST(test_output_size);
+
+    return failures == 0 ? 0 : 1;
+}
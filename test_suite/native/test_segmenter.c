@@ -0,0 +1,450 @@
+#include "test_common.h"
+#include "segmenter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_MAX_SEGMENTS 32
+#define MOCK_MAX_FRAMES 4096
+#define UNITS SEGMENTER_UNITS_PER_SECOND
+
+// A mock encoder: records what each segment received and checks the audio
+// content against the generator, so a dropped or repeated sample shows up
+typedef struct {
+    uint32_t index;
+    char path[SEGMENTER_MAX_PATH];
+    int64_t start_time;             // Recording time, from open
+    int64_t end_time;               // Segment time, from close
+    uint64_t first_frame;           // Recording frame number of the first video frame
+    uint64_t frames;
+    int64_t first_video_time;       // Segment time
+    int64_t last_video_time;
+    uint64_t first_sample[SEGMENTER_MAX_AUDIO];    // Recording sample frame of the first audio sample
+    uint64_t samples[SEGMENTER_MAX_AUDIO];
+    uint64_t bytes;
+    int closed;
+    int finalized;
+} mock_segment_t;
+
+typedef struct {
+    mock_segment_t segments[MOCK_MAX_SEGMENTS];
+    int count;
+    uint64_t audio_total[SEGMENTER_MAX_AUDIO];     // Sample frames received over all segments
+    uint32_t frame_bytes[SEGMENTER_MAX_AUDIO];
+    int errors;
+    platform_atomic_t gate_closed;  // Finalize blocks while set
+    platform_atomic_t finalized;
+} mock_encoder_t;
+
+typedef struct {
+    uint64_t number;
+    uint32_t size;
+} mock_frame_t;
+
+static uint8_t audio_byte(int stream, uint64_t sample, uint32_t byte) {
+    return (uint8_t)(sample * 7 + byte * 13 + (uint64_t)stream * 101);
+}
+
+static mock_segment_t* mock_open_segment(mock_encoder_t* mock, uint32_t index, const char* path, int64_t start_time) {
+    if (mock->count == MOCK_MAX_SEGMENTS) return NULL;
+    mock_segment_t* segment = &mock->segments[mock->count++];
+    memset(segment, 0, sizeof(mock_segment_t));
+    segment->index = index;
+    snprintf(segment->path, sizeof(segment->path), "%s", path);
+    segment->start_time = start_time;
+    return segment;
+}
+
+static int mock_open(void* context, uint32_t index, const char* path, int64_t start_time) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    mock_segment_t* previous = &mock->segments[mock->count - 1];
+    if (!previous->closed || index != previous->index + 1) mock->errors++;
+    return mock_open_segment(mock, index, path, start_time) ? 0 : -1;
+}
+
+static int mock_video(void* context, const void* frame, int64_t time) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    mock_segment_t* segment = &mock->segments[mock->count - 1];
+    const mock_frame_t* video = (const mock_frame_t*)frame;
+    if (segment->closed) mock->errors++;
+    if (segment->frames == 0) {
+        segment->first_frame = video->number;
+        segment->first_video_time = time;
+    } else if (time <= segment->last_video_time) {
+        mock->errors++;
+    }
+    segment->last_video_time = time;
+    segment->frames++;
+    segment->bytes += video->size;
+    return 0;
+}
+
+static int mock_audio(void* context, int stream, const uint8_t* data, uint32_t frames, uint64_t position) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    mock_segment_t* segment = &mock->segments[mock->count - 1];
+    if (segment->closed || position != segment->samples[stream]) mock->errors++;
+    if (segment->samples[stream] == 0) segment->first_sample[stream] = mock->audio_total[stream];
+
+    uint32_t frame_bytes = mock->frame_bytes[stream];
+    for (uint32_t i = 0; i < frames; i++) {
+        for (uint32_t b = 0; b < frame_bytes; b++) {
+            if (data[i * frame_bytes + b] != audio_byte(stream, mock->audio_total[stream] + i, b)) {
+                mock->errors++;
+                return -1;
+            }
+        }
+    }
+    segment->samples[stream] += frames;
+    mock->audio_total[stream] += frames;
+    segment->bytes += (uint64_t)frames * frame_bytes / 8;
+    return 0;
+}
+
+static uint64_t mock_bytes(void* context) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    return mock->segments[mock->count - 1].bytes;
+}
+
+static void* mock_close(void* context, int64_t end_time) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    mock_segment_t* segment = &mock->segments[mock->count - 1];
+    if (segment->closed) mock->errors++;
+    segment->closed = 1;
+    segment->end_time = end_time;
+    return segment;
+}
+
+static int mock_finalize(void* context, void* handle) {
+    mock_encoder_t* mock = (mock_encoder_t*)context;
+    mock_segment_t* segment = (mock_segment_t*)handle;
+    while (platform_atomic_load(&mock->gate_closed)) platform_sleep_ms(1);
+    if (!segment->closed || segment->finalized) return -1;
+    segment->finalized = 1;
+    platform_atomic_inc(&mock->finalized);
+    return 0;
+}
+
+static const segment_sink_t mock_sink = {
+    mock_open, mock_video, mock_audio, mock_bytes, mock_close, mock_finalize
+};
+
+static int mock_init(mock_encoder_t* mock, const char* base_path, const segmenter_config_t* config) {
+    memset(mock, 0, sizeof(mock_encoder_t));
+    for (int stream = 0; stream < config->audio_streams; stream++) mock->frame_bytes[stream] = config->audio_frame_bytes[stream];
+    char path[SEGMENTER_MAX_PATH];
+    segmenter_path(base_path, 1, path, sizeof(path));
+    return mock_open_segment(mock, 1, path, 0) ? 0 : -1;
+}
+
+// The recording as an encoder would see it: video at fps with a keyframe
+// every gop frames, and audio packets of uneven size that run audio_lead
+// ahead of the video (behind when negative)
+typedef struct {
+    int fps;
+    int gop;
+    uint64_t frames;
+    uint32_t frame_size;            // Varies +-50% around this
+    int audio_streams;
+    uint32_t audio_rate[SEGMENTER_MAX_AUDIO];
+    uint32_t frame_bytes[SEGMENTER_MAX_AUDIO];
+    int64_t audio_lead;
+} recording_t;
+
+static int64_t frame_time(const recording_t* recording, uint64_t frame) {
+    return (int64_t)(frame * UNITS / (uint64_t)recording->fps);
+}
+
+static int feed_audio(segmenter_t* segmenter, const recording_t* recording, int stream, uint64_t* position,
+                      uint64_t until, uint32_t* seed) {
+    static uint8_t packet[65536];
+    uint32_t frame_bytes = recording->frame_bytes[stream];
+    while (*position < until) {
+        *seed = *seed * 1664525u + 1013904223u;
+        uint32_t frames = 64 + (*seed >> 16) % 900;
+        if (*position + frames > until) frames = (uint32_t)(until - *position);
+        for (uint32_t i = 0; i < frames; i++) {
+            for (uint32_t b = 0; b < frame_bytes; b++) packet[i * frame_bytes + b] = audio_byte(stream, *position + i, b);
+        }
+        if (segmenter_audio(segmenter, stream, packet, frames) != 0) return -1;
+        *position += frames;
+    }
+    return 0;
+}
+
+static int feed(segmenter_t* segmenter, const recording_t* recording) {
+    uint64_t positions[SEGMENTER_MAX_AUDIO] = { 0 };
+    uint32_t seed = 99;
+    for (uint64_t frame = 0; frame < recording->frames; frame++) {
+        int64_t time = frame_time(recording, frame);
+        for (int stream = 0; stream < recording->audio_streams; stream++) {
+            int64_t audio_time = time + recording->audio_lead;
+            uint64_t until = audio_time > 0 ? (uint64_t)audio_time * recording->audio_rate[stream] / UNITS : 0;
+            if (feed_audio(segmenter, recording, stream, &positions[stream], until, &seed) != 0) return -1;
+        }
+        seed = seed * 1664525u + 1013904223u;
+        mock_frame_t video = { frame, recording->frame_size / 2 + (seed >> 8) % recording->frame_size };
+        if (segmenter_video(segmenter, &video, time, frame % (uint64_t)recording->gop == 0) != 0) return -1;
+    }
+    // Audio runs to the end of the last frame
+    int64_t end = frame_time(recording, recording->frames);
+    for (int stream = 0; stream < recording->audio_streams; stream++) {
+        uint64_t until = (uint64_t)end * recording->audio_rate[stream] / UNITS;
+        if (feed_audio(segmenter, recording, stream, &positions[stream], until, &seed) != 0) return -1;
+    }
+    return 0;
+}
+
+// Every frame and sample lands in exactly one segment, segments start on
+// keyframes, and each segment ends where the next begins
+static int check_segments(const mock_encoder_t* mock, const recording_t* recording) {
+    TEST_ASSERT_EQ(0, mock->errors);
+    uint64_t next_frame = 0;
+    uint64_t next_sample[SEGMENTER_MAX_AUDIO] = { 0 };
+    for (int i = 0; i < mock->count; i++) {
+        const mock_segment_t* segment = &mock->segments[i];
+        TEST_ASSERT_EQ(i + 1, segment->index);
+        TEST_ASSERT(segment->frames > 0);
+        TEST_ASSERT_EQ(next_frame, segment->first_frame);
+        TEST_ASSERT_EQ(0, segment->first_frame % (uint64_t)recording->gop);
+        TEST_ASSERT_EQ(frame_time(recording, segment->first_frame), segment->start_time);
+        TEST_ASSERT_EQ(0, segment->first_video_time);
+        next_frame += segment->frames;
+
+        for (int stream = 0; stream < recording->audio_streams; stream++) {
+            // The first sample of a segment is the one at its start time
+            uint64_t rate = recording->audio_rate[stream];
+            TEST_ASSERT_EQ(next_sample[stream], segment->first_sample[stream]);
+            TEST_ASSERT_EQ(((uint64_t)segment->start_time * rate + UNITS / 2) / UNITS, segment->first_sample[stream]);
+            next_sample[stream] += segment->samples[stream];
+        }
+        if (i + 1 < mock->count) {
+            const mock_segment_t* next = &mock->segments[i + 1];
+            TEST_ASSERT(segment->closed && segment->finalized);
+            TEST_ASSERT_EQ(next->start_time - segment->start_time, segment->end_time);
+            TEST_ASSERT(segment->last_video_time < segment->end_time);
+        } else {
+            TEST_ASSERT(!segment->closed);
+        }
+    }
+    TEST_ASSERT_EQ(recording->frames, next_frame);
+    for (int stream = 0; stream < recording->audio_streams; stream++) {
+        TEST_ASSERT_EQ(mock->audio_total[stream], next_sample[stream]);
+    }
+    return 0;
+}
+
+static int test_path(void) {
+    char path[64];
+    TEST_ASSERT(segmenter_path("rec.mp4", 1, path, sizeof(path)) == 0);
+    TEST_ASSERT(strcmp(path, "rec-001.mp4") == 0);
+    TEST_ASSERT(segmenter_path("C:\\out.d\\session", 12, path, sizeof(path)) == 0);
+    TEST_ASSERT(strcmp(path, "C:\\out.d\\session-012") == 0);
+    TEST_ASSERT(segmenter_path("dir.v2/take.one.mp4", 1234, path, sizeof(path)) == 0);
+    TEST_ASSERT(strcmp(path, "dir.v2/take.one-1234.mp4") == 0);
+    TEST_ASSERT(segmenter_path("long-name.mp4", 1, path, 8) != 0);
+    return 0;
+}
+
+// 2 s segments of 30 fps video with a keyframe every 0.5 s, audio ahead of video
+static int test_duration_rollover(void) {
+    recording_t recording = { 30, 15, 300, 4000, 1, { 48000 }, { 4 }, UNITS / 20 };
+    segmenter_config_t config = { 2 * UNITS, 0, 1, 1, { 48000 }, { 4 }, sizeof(mock_frame_t), 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "rec.mp4", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "rec.mp4", &mock_sink, &mock) == 0);
+    TEST_ASSERT(feed(&segmenter, &recording) == 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+
+    TEST_ASSERT_EQ(5, mock.count);
+    TEST_ASSERT_EQ(5, segmenter.stats.segments);
+    TEST_ASSERT_EQ(4, segmenter.stats.finalized);
+    TEST_ASSERT(strcmp(mock.segments[3].path, "rec-004.mp4") == 0);
+    TEST_ASSERT(check_segments(&mock, &recording) == 0);
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQ(2 * UNITS, mock.segments[i].end_time);
+    TEST_ASSERT_EQ(0, segmenter.stats.hold_overflows);
+    TEST_ASSERT_EQ(0, segmenter.stats.late_boundaries);
+    TEST_ASSERT_EQ(1, segmenter.stats.held_video_peak);
+    TEST_ASSERT(segmenter.stats.held_audio_peak > 0);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+// Keyframes every 2 s: a 1.5 s limit waits for the next one. Audio lags the
+// video by 40 ms, so each boundary frame also waits for its audio.
+static int test_waits_for_keyframe(void) {
+    recording_t recording = { 60, 120, 600, 2000, 2, { 48000, 44100 }, { 4, 2 }, -UNITS / 25 };
+    segmenter_config_t config = { 3 * UNITS / 2, 0, 1, 2, { 48000, 44100 }, { 4, 2 }, sizeof(mock_frame_t), 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "two.mp4", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "two.mp4", &mock_sink, &mock) == 0);
+    TEST_ASSERT(feed(&segmenter, &recording) == 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+
+    TEST_ASSERT_EQ(5, mock.count);
+    TEST_ASSERT(check_segments(&mock, &recording) == 0);
+    for (int i = 1; i < mock.count; i++) TEST_ASSERT_EQ(2 * UNITS * i, mock.segments[i].start_time);
+    TEST_ASSERT_EQ(0, segmenter.stats.late_boundaries);
+    TEST_ASSERT(segmenter.stats.held_video_peak > 1);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+// Size limit: a segment closes at the first keyframe after it is reached.
+// Audio arrives only up to each frame, so boundaries wait a frame for it.
+static int test_size_rollover(void) {
+    recording_t recording = { 30, 10, 900, 10000, 1, { 44100 }, { 4 }, 0 };
+    segmenter_config_t config = { 0, 500000, 1, 1, { 44100 }, { 4 }, sizeof(mock_frame_t), 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "size.mp4", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "size.mp4", &mock_sink, &mock) == 0);
+    TEST_ASSERT(feed(&segmenter, &recording) == 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+
+    TEST_ASSERT(check_segments(&mock, &recording) == 0);
+    TEST_ASSERT(mock.count >= 15);
+    for (int i = 0; i + 1 < mock.count; i++) {
+        // Reached, then at most one GOP more (10 frames of at most 15 KB, and their audio)
+        TEST_ASSERT(mock.segments[i].bytes >= config.max_bytes);
+        TEST_ASSERT(mock.segments[i].bytes < config.max_bytes + 10 * 15000 + 30000);
+    }
+    TEST_ASSERT_EQ(0, segmenter.stats.late_boundaries);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+// Audio alone: boundaries fall on exact sample counts, packets split between segments
+static int test_audio_only(void) {
+    segmenter_config_t config = { UNITS, 0, 0, 2, { 44100, 16000 }, { 4, 2 }, 0, 0 };
+    recording_t recording = { 1, 1, 0, 0, 2, { 44100, 16000 }, { 4, 2 }, 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "voice.m4a", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "voice.m4a", &mock_sink, &mock) == 0);
+
+    uint64_t positions[2] = { 0, 0 };
+    uint32_t seed = 7;
+    for (int step = 1; step <= 100; step++) {
+        // 55 ms at a time, the second stream a little behind
+        for (int stream = 0; stream < 2; stream++) {
+            uint64_t until = (uint64_t)step * 55 * recording.audio_rate[stream] / 1000 - (stream ? 100 : 0);
+            TEST_ASSERT(feed_audio(&segmenter, &recording, stream, &positions[stream], until, &seed) == 0);
+        }
+    }
+    TEST_ASSERT(feed_audio(&segmenter, &recording, 1, &positions[1], positions[1] + 100, &seed) == 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+
+    // 5.5 s: five full seconds and a half
+    TEST_ASSERT_EQ(0, mock.errors);
+    TEST_ASSERT_EQ(0, segmenter.stats.late_boundaries);
+    TEST_ASSERT_EQ(6, mock.count);
+    uint64_t totals[2] = { 0, 0 };
+    for (int i = 0; i < mock.count; i++) {
+        const mock_segment_t* segment = &mock.segments[i];
+        TEST_ASSERT_EQ((int64_t)i * UNITS, segment->start_time);
+        if (i + 1 < mock.count) {
+            TEST_ASSERT_EQ(44100, segment->samples[0]);
+            TEST_ASSERT_EQ(16000, segment->samples[1]);
+            TEST_ASSERT_EQ(UNITS, segment->end_time);
+        }
+        for (int stream = 0; stream < 2; stream++) {
+            TEST_ASSERT_EQ(totals[stream], segment->first_sample[stream]);
+            totals[stream] += segment->samples[stream];
+        }
+    }
+    TEST_ASSERT_EQ(positions[0], totals[0]);
+    TEST_ASSERT_EQ(positions[1], totals[1]);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+// Finalizing never blocks recording until every finalizer slot is taken
+static int test_finalize_off_thread(void) {
+    recording_t recording = { 30, 30, 300, 1000, 0, { 0 }, { 0 }, 0 };
+    segmenter_config_t config = { 2 * UNITS, 0, 1, 0, { 0 }, { 0 }, sizeof(mock_frame_t), 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "slow.mp4", &config) == 0);
+    platform_atomic_store(&mock.gate_closed, 1);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "slow.mp4", &mock_sink, &mock) == 0);
+
+    // Four rollovers while no finalize can complete
+    TEST_ASSERT(feed(&segmenter, &recording) == 0);
+    TEST_ASSERT_EQ(5, mock.count);
+    TEST_ASSERT_EQ(0, platform_atomic_load(&mock.finalized));
+    TEST_ASSERT_EQ(0, segmenter.stats.finalize_waits);
+
+    platform_atomic_store(&mock.gate_closed, 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+    TEST_ASSERT_EQ(4, platform_atomic_load(&mock.finalized));
+    TEST_ASSERT(check_segments(&mock, &recording) == 0);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+// A stream that stops (a device unplugged) holds a boundary up for hold_ms
+// at most; the segment still starts at the boundary frame
+static int test_stalled_audio(void) {
+    recording_t recording = { 30, 15, 150, 1000, 0, { 0 }, { 0 }, 0 };
+    segmenter_config_t config = { 2 * UNITS, 0, 1, 1, { 48000 }, { 4 }, sizeof(mock_frame_t), 0 };
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    TEST_ASSERT(mock_init(&mock, "stall.mp4", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "stall.mp4", &mock_sink, &mock) == 0);
+
+    // One second of audio, then nothing
+    recording_t audio = { 30, 15, 0, 0, 1, { 48000 }, { 4 }, 0 };
+    uint64_t position = 0;
+    uint32_t seed = 3;
+    TEST_ASSERT(feed_audio(&segmenter, &audio, 0, &position, 48000, &seed) == 0);
+    TEST_ASSERT(feed(&segmenter, &recording) == 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+
+    TEST_ASSERT_EQ(3, mock.count);
+    TEST_ASSERT(check_segments(&mock, &recording) == 0);
+    TEST_ASSERT_EQ(2 * UNITS, mock.segments[1].start_time);
+    TEST_ASSERT_EQ(4 * UNITS, mock.segments[2].start_time);
+    TEST_ASSERT_EQ(48000, mock.segments[0].samples[0]);
+    TEST_ASSERT_EQ(2, segmenter.stats.late_boundaries);
+    TEST_ASSERT_EQ(4, segmenter.stats.held_video_peak);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+static int test_invalid(void) {
+    mock_encoder_t mock;
+    segmenter_t segmenter;
+    segmenter_config_t none = { UNITS, 0, 0, 0, { 0 }, { 0 }, sizeof(mock_frame_t), 0 };
+    segmenter_config_t no_format = { UNITS, 0, 1, 1, { 0 }, { 4 }, sizeof(mock_frame_t), 0 };
+    segment_sink_t no_close = mock_sink;
+    no_close.close = NULL;
+    segmenter_config_t config = { UNITS, 0, 1, 0, { 0 }, { 0 }, sizeof(mock_frame_t), 0 };
+    TEST_ASSERT(segmenter_init(&segmenter, &none, "a.mp4", &mock_sink, &mock) != 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &no_format, "a.mp4", &mock_sink, &mock) != 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "a.mp4", &no_close, &mock) != 0);
+
+    // Audio on a stream that does not exist
+    TEST_ASSERT(mock_init(&mock, "a.mp4", &config) == 0);
+    TEST_ASSERT(segmenter_init(&segmenter, &config, "a.mp4", &mock_sink, &mock) == 0);
+    uint8_t data[16] = { 0 };
+    TEST_ASSERT(segmenter_audio(&segmenter, 0, data, 4) != 0);
+    TEST_ASSERT(segmenter_finish(&segmenter) == 0);
+    segmenter_cleanup(&segmenter);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_path);
+    RUN_TEST(test_duration_rollover);
+    RUN_TEST(test_waits_for_keyframe);
+    RUN_TEST(test_size_rollover);
+    RUN_TEST(test_audio_only);
+    RUN_TEST(test_finalize_off_thread);
+    RUN_TEST(test_stalled_audio);
+    RUN_TEST(test_invalid);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "test_common.h"
+#include "spsc_ring.h"
+#include "platform.h"
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t sequence;
+    uint32_t check;             // Derived from sequence, catches torn elements
+    uint64_t payload;
+} stress_item_t;
+
+typedef struct {
+    spsc_ring_t* ring;
+    uint32_t count;
+    int yield_every;            // Sleep now and then so both full and empty are hit
+} stress_context_t;
+
+static int test_init_validation(void) {
+    spsc_ring_t ring;
+    TEST_ASSERT(spsc_ring_init(NULL, "q", 4, 8) != 0);
+    TEST_ASSERT(spsc_ring_init(&ring, "q", 0, 8) != 0);
+    TEST_ASSERT(spsc_ring_init(&ring, "q", 4, 0) != 0);
+    TEST_ASSERT(spsc_ring_init(&ring, "q", 4, SPSC_RING_MAX_ELEMENT + 1) != 0);
+
+    TEST_ASSERT(spsc_ring_init(&ring, "q", 5, 8) == 0);
+    TEST_ASSERT_EQ(8, (int)ring.capacity);                  // Rounded up to a power of two
+    spsc_ring_cleanup(&ring);
+    return 0;
+}
+
+static int test_fifo_full_and_empty(void) {
+    spsc_ring_t ring;
+    TEST_ASSERT(spsc_ring_init(&ring, "fifo", 4, sizeof(int)) == 0);
+
+    int value = 0;
+    TEST_ASSERT(spsc_ring_pop(&ring, &value) != 0);
+    for (int i = 0; i < 4; i++) TEST_ASSERT(spsc_ring_push(&ring, &i) == 0);
+    int extra = 99;
+    TEST_ASSERT(spsc_ring_push(&ring, &extra) != 0);
+    TEST_ASSERT_EQ(4, (int)spsc_ring_depth(&ring));
+
+    // Interleave so the indices wrap several times
+    for (int i = 0; i < 40; i++) {
+        TEST_ASSERT(spsc_ring_pop(&ring, &value) == 0);
+        TEST_ASSERT_EQ(i, value);
+        int next = i + 4;
+        TEST_ASSERT(spsc_ring_push(&ring, &next) == 0);
+    }
+    for (int i = 40; i < 44; i++) {
+        TEST_ASSERT(spsc_ring_pop(&ring, &value) == 0);
+        TEST_ASSERT_EQ(i, value);
+    }
+    TEST_ASSERT(spsc_ring_pop(&ring, &value) != 0);
+
+    spsc_ring_stats_t stats;
+    spsc_ring_get_stats(&ring, &stats);
+    TEST_ASSERT_EQ(4, (int)stats.capacity);
+    TEST_ASSERT_EQ(0, (int)stats.depth);
+    TEST_ASSERT_EQ(4, (int)stats.high_water);
+    TEST_ASSERT_EQ(44, (int)stats.pushed);
+    TEST_ASSERT_EQ(44, (int)stats.popped);
+    TEST_ASSERT_EQ(1, (int)stats.full);
+    TEST_ASSERT_EQ(2, (int)stats.empty);
+
+    spsc_ring_cleanup(&ring);
+    return 0;
+}
+
+static void stress_producer(void* arg) {
+    stress_context_t* context = (stress_context_t*)arg;
+    for (uint32_t i = 0; i < context->count; i++) {
+        stress_item_t item;
+        item.sequence = i;
+        item.check = i * 2654435761u;
+        item.payload = (uint64_t)i << 32 | (i ^ 0x5A5A5A5Au);
+        while (spsc_ring_push(context->ring, &item) != 0) {
+            platform_yield();
+        }
+        if (context->yield_every && i % (uint32_t)context->yield_every == 0) platform_sleep_ms(1);
+    }
+}
+
+// Two threads push and pop a few hundred thousand elements through small rings
+static int test_two_thread_stress(void) {
+    const unsigned int capacities[] = { 1, 2, 16, 256 };
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        spsc_ring_t ring;
+        TEST_ASSERT(spsc_ring_init(&ring, "stress", capacities[c], sizeof(stress_item_t)) == 0);
+
+        stress_context_t context = { &ring, 200000, c == 0 ? 0 : 50000 };
+        platform_thread_t producer;
+        TEST_ASSERT(platform_thread_create(&producer, stress_producer, &context) == 0);
+
+        uint32_t expected = 0;
+        int broken = 0;
+        while (expected < context.count) {
+            stress_item_t item;
+            if (spsc_ring_pop(&ring, &item) != 0) {
+                platform_yield();
+                continue;
+            }
+            // Keep popping after a mismatch so the producer can finish
+            if (item.sequence != expected || item.check != expected * 2654435761u ||
+                item.payload != ((uint64_t)expected << 32 | (expected ^ 0x5A5A5A5Au))) {
+                broken = 1;
+            }
+            expected++;
+        }
+        platform_thread_join(producer);
+        TEST_ASSERT(!broken);
+
+        spsc_ring_stats_t stats;
+        spsc_ring_get_stats(&ring, &stats);
+        TEST_ASSERT_EQ((int)context.count, (int)stats.pushed);
+        TEST_ASSERT_EQ((int)context.count, (int)stats.popped);
+        TEST_ASSERT(stats.high_water <= stats.capacity);
+        spsc_ring_cleanup(&ring);
+    }
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_fifo_full_and_empty);
+    RUN_TEST(test_two_thread_stress);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+#include "test_common.h"
+#include "tile_hash.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_init_validation(void) {
+    tile_hash_t hash;
+    TEST_ASSERT(tile_hash_init(NULL, 64, 64, 0) != 0);
+    TEST_ASSERT(tile_hash_init(&hash, 0, 64, 0) != 0);
+    TEST_ASSERT(tile_hash_init(&hash, 64, 64, 12) != 0);     // Not a multiple of 8
+    TEST_ASSERT(tile_hash_init(&hash, 64, 64, 512) != 0);
+
+    TEST_ASSERT(tile_hash_init(&hash, 1920, 1080, 0) == 0);
+    TEST_ASSERT_EQ(TILE_HASH_DEFAULT_TILE, hash.tile_size);
+    TEST_ASSERT_EQ(30, hash.tiles_x);
+    TEST_ASSERT_EQ(17, hash.tiles_y);                       // Partial bottom row of tiles
+    TEST_ASSERT(tile_hash_update(&hash, NULL, 1920 * 4) != 0);
+    tile_hash_cleanup(&hash);
+    return 0;
+}
+
+static int test_unchanged_and_single_pixel_changes(void) {
+    const int width = 333, height = 200;                   // Partial tiles on both edges
+    size_t pitch = (size_t)width * 4 + 16;
+    uint8_t* frame = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(frame != NULL);
+    fill_random(frame, pitch * height, 3);
+
+    tile_hash_t hash;
+    TEST_ASSERT(tile_hash_init(&hash, width, height, 64) == 0);
+    int tiles = hash.tiles_x * hash.tiles_y;
+    TEST_ASSERT_EQ(tiles, tile_hash_update(&hash, frame, pitch));  // First frame: everything is new
+    TEST_ASSERT_EQ(0, tile_hash_update(&hash, frame, pitch));
+    TEST_ASSERT_EQ(0, tile_hash_update(&hash, frame, pitch));
+
+    // One bit in one channel flips exactly the tile it lands in
+    const int points[][2] = { { 0, 0 }, { 63, 63 }, { 64, 0 }, { 332, 199 }, { 200, 130 } };
+    for (size_t p = 0; p < sizeof(points) / sizeof(points[0]); p++) {
+        int x = points[p][0], y = points[p][1];
+        frame[(size_t)y * pitch + (size_t)x * 4 + 1] ^= 0x01;
+        TEST_ASSERT_EQ(1, tile_hash_update(&hash, frame, pitch));
+        TEST_ASSERT(hash.changed[(y / 64) * hash.tiles_x + x / 64]);
+    }
+
+    // Padding past the frame width is not part of the content
+    frame[(size_t)width * 4 + 3] ^= 0xFF;
+    TEST_ASSERT_EQ(0, tile_hash_update(&hash, frame, pitch));
+
+    // Reset forgets the previous frame
+    tile_hash_reset(&hash);
+    TEST_ASSERT_EQ(tiles, tile_hash_update(&hash, frame, pitch));
+    TEST_ASSERT_EQ(10, hash.frames);
+    TEST_ASSERT_EQ(3, hash.unchanged_frames);
+
+    tile_hash_cleanup(&hash);
+    free(frame);
+    return 0;
+}
+
+static int test_rearranged_content_is_detected(void) {
+    const int size = 64;
+    size_t pitch = (size_t)size * 4;
+    uint8_t* a = (uint8_t*)malloc(pitch * size);
+    uint8_t* b = (uint8_t*)malloc(pitch * size);
+    TEST_ASSERT(a != NULL && b != NULL);
+    fill_random(a, pitch * size, 21);
+
+    tile_hash_t hash;
+    TEST_ASSERT(tile_hash_init(&hash, size, size, size) == 0);
+    uint64_t original = tile_hash_block(&hash, a, pitch, size, size);
+
+    // Swapped 32-byte stripes within a row
+    memcpy(b, a, pitch * size);
+    memcpy(b + 5 * pitch, a + 5 * pitch + 32, 32);
+    memcpy(b + 5 * pitch + 32, a + 5 * pitch, 32);
+    TEST_ASSERT(tile_hash_block(&hash, b, pitch, size, size) != original);
+
+    // Swapped rows
+    memcpy(b, a, pitch * size);
+    memcpy(b + 2 * pitch, a + 9 * pitch, pitch);
+    memcpy(b + 9 * pitch, a + 2 * pitch, pitch);
+    TEST_ASSERT(tile_hash_block(&hash, b, pitch, size, size) != original);
+
+    // Content shifted by one pixel, as in a scroll
+    memcpy(b, a, pitch * size);
+    for (int y = 0; y < size; y++) {
+        memmove(b + y * pitch + 4, b + y * pitch, pitch - 4);
+    }
+    TEST_ASSERT(tile_hash_block(&hash, b, pitch, size, size) != original);
+
+    // Uniform colours that differ only in alpha
+    memset(a, 0x20, pitch * size);
+    memset(b, 0x20, pitch * size);
+    b[3] = 0x21;
+    TEST_ASSERT(tile_hash_block(&hash, a, pitch, size, size) != tile_hash_block(&hash, b, pitch, size, size));
+
+    tile_hash_cleanup(&hash);
+    free(a);
+    free(b);
+    return 0;
+}
+
+static int test_simd_levels_are_bit_exact(void) {
+    const int widths[] = { 8, 13, 64, 71, 256 };
+    const int height = 19;
+    size_t pitch = 256 * 4 + 8;
+    uint8_t* frame = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(frame != NULL);
+    fill_random(frame, pitch * height, 77);
+
+    tile_hash_t hash;
+    TEST_ASSERT(tile_hash_init(&hash, 256, height, 256) == 0);
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        TEST_ASSERT(tile_hash_set_level(&hash, COPY_KERNEL_SCALAR) == 0);
+        uint64_t expected = tile_hash_block(&hash, frame + 4, pitch, widths[w], height);
+        for (int level = COPY_KERNEL_SSE2; level < COPY_KERNEL_COUNT; level++) {
+            if (tile_hash_set_level(&hash, (copy_kernel_level_t)level) != 0) continue;
+            TEST_ASSERT(tile_hash_block(&hash, frame + 4, pitch, widths[w], height) == expected);
+        }
+    }
+    tile_hash_cleanup(&hash);
+    free(frame);
+    return 0;
+}
+
+static int test_pool_matches_single_thread(void) {
+    const int width = 640, height = 480;
+    size_t pitch = (size_t)width * 4;
+    uint8_t* frame = (uint8_t*)malloc(pitch * height);
+    TEST_ASSERT(frame != NULL);
+    fill_random(frame, pitch * height, 8);
+
+    tile_hash_t single, parallel;
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(&pool, 3) == 0);
+    TEST_ASSERT(tile_hash_init(&single, width, height, 32) == 0);
+    TEST_ASSERT(tile_hash_init(&parallel, width, height, 32) == 0);
+    tile_hash_set_pool(&parallel, &pool);
+
+    TEST_ASSERT_EQ(tile_hash_update(&single, frame, pitch), tile_hash_update(&parallel, frame, pitch));
+    frame[100 * pitch + 400] ^= 0x80;
+    frame[479 * pitch + 4] ^= 0x80;
+    TEST_ASSERT_EQ(2, tile_hash_update(&single, frame, pitch));
+    TEST_ASSERT_EQ(2, tile_hash_update(&parallel, frame, pitch));
+    size_t tiles = (size_t)single.tiles_x * single.tiles_y;
+    TEST_ASSERT(memcmp(single.hashes, parallel.hashes, tiles * sizeof(uint64_t)) == 0);
+    TEST_ASSERT(memcmp(single.changed, parallel.changed, tiles) == 0);
+
+    tile_hash_cleanup(&single);
+    tile_hash_cleanup(&parallel);
+    worker_pool_cleanup(&pool);
+    free(frame);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_validation);
+    RUN_TEST(test_unchanged_and_single_pixel_changes);
+    RUN_TEST(test_rearranged_content_is_detected);
+    RUN_TEST(test_simd_levels_are_bit_exact);
+    RUN_TEST(test_pool_matches_single_thread);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,361 @@
+#include "test_common.h"
+#include "mp4_fixtures.h"
+#include "h264_fixtures.h"
+#include "transcoder.h"
+#include "capture_spool.h"
+#include "replay_source.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRANSCODE_TEST_SPOOL "test_transcoder.spool"
+#define TRANSCODE_TEST_RAW "test_transcoder.raw"
+#define TRANSCODE_TEST_MP4 "test_transcoder.mp4"
+
+// A gradient with a square moving across it, holding still on frames 3 and 4 of every 5
+static void draw_frame(uint8_t* pixels, int width, int height, int frame) {
+    int step = frame % 5 >= 3 ? frame - frame % 5 + 2 : frame;
+    int square_x = (step * 5) % (width - 24);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = pixels + ((size_t)y * width + x) * 4;
+            int inside = x >= square_x && x < square_x + 24 && y >= 20 && y < 44;
+            pixel[0] = inside ? 20 : (uint8_t)(x * 255 / width);
+            pixel[1] = inside ? 200 : (uint8_t)(y * 255 / height);
+            pixel[2] = inside ? 240 : 90;
+            pixel[3] = 255;
+        }
+    }
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? (uint8_t*)malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+// Decodes every video sample and checks it against the expected NV12 pictures
+typedef struct {
+    fixture_decoder_t decoder;
+    const uint8_t* expected;        // One NV12 picture per frame
+    size_t picture_size;
+    int width;
+    int height;
+    uint64_t samples;
+    uint64_t mismatches;
+    uint64_t keyframes;
+} sample_check_t;
+
+static int check_sample(void* context, int track, uint64_t index, uint64_t time, const uint8_t* data,
+                        uint32_t size, uint32_t flags) {
+    sample_check_t* check = (sample_check_t*)context;
+    (void)time;
+    if (track != FIXTURE_VIDEO) return 0;
+    if (!(flags & 0x00010000)) check->keyframes++;
+    size_t offset = 0;
+    while (offset + 4 <= size) {
+        uint32_t length = mp4_read_u32(data + offset);
+        if (length == 0 || length > size - offset - 4) return -1;
+        if (fixture_decode_nal(&check->decoder, data + offset + 4, length) != 0) return -1;
+        offset += 4 + length;
+    }
+    if (check->expected) {
+        const uint8_t* picture = check->expected + check->picture_size * index;
+        const uint8_t* uv = picture + (size_t)check->width * check->height;
+        if (fixture_decoder_compare(&check->decoder, picture, (size_t)check->width, uv, (size_t)check->width) != 0) {
+            check->mismatches++;
+        }
+    }
+    check->samples++;
+    return 0;
+}
+
+// Parse the output and decode it; the parameter sets come from avcC
+static int check_output(sample_check_t* check, fixture_mp4_t* info) {
+    size_t size;
+    uint8_t* data = read_file(TRANSCODE_TEST_MP4, &size);
+    if (!data) return -1;
+    int result = fixture_parse_fmp4(data, size, 0, info, NULL, NULL);
+    if (result == 0) result = fixture_decode_nal(&check->decoder, info->sps, info->sps_size);
+    // The PPS is fixed; test_h264_writer checks it field by field
+    check->decoder.have_pps = 1;
+    if (result == 0) result = fixture_parse_fmp4(data, size, 0, info, check_sample, check);
+    if (result != 0) fprintf(stderr, "output check failed: %s / %s\n", info->error ? info->error : "",
+                             check->decoder.error ? check->decoder.error : "");
+    free(data);
+    return result;
+}
+
+static uint8_t* expected_pictures(const uint8_t* frames, int count, int width, int height, size_t* picture_size) {
+    color_converter_t converter;
+    color_converter_init(&converter, COLOR_MATRIX_BT709, COLOR_RANGE_LIMITED);
+    *picture_size = color_frame_size(COLOR_FORMAT_NV12, width, height);
+    uint8_t* pictures = (uint8_t*)malloc(*picture_size * count);
+    if (!pictures) return NULL;
+    for (int i = 0; i < count; i++) {
+        color_planes_t planes;
+        color_planes_for_buffer(COLOR_FORMAT_NV12, pictures + *picture_size * i, width, height, &planes);
+        color_convert_frame(&converter, COLOR_FORMAT_NV12, &planes, frames + (size_t)width * height * 4 * i,
+                            (size_t)width * 4, width, height);
+    }
+    return pictures;
+}
+
+static int test_spool_to_mp4(void) {
+    const int width = 160, height = 96, count = 45;
+    size_t frame_size = (size_t)width * height * 4;
+    uint8_t* frames = (uint8_t*)malloc(frame_size * count);
+    TEST_ASSERT(frames != NULL);
+
+    capture_spool_writer_t writer;
+    TEST_ASSERT(capture_spool_writer_open(&writer, TRANSCODE_TEST_SPOOL, width, height, 30) == 0);
+    // Capture clocks do not start at zero
+    int64_t start = 123456789;
+    for (int i = 0; i < count; i++) {
+        draw_frame(frames + frame_size * i, width, height, i);
+        TEST_ASSERT(capture_spool_writer_append(&writer, frames + frame_size * i, (size_t)width * 4,
+                                                start + (int64_t)i * 333333) == 0);
+    }
+    TEST_ASSERT(capture_spool_writer_close(&writer) == 0);
+    TEST_ASSERT(writer.stats.repeats > 0);
+
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    config.input = TRANSCODE_TEST_SPOOL;
+    config.output = TRANSCODE_TEST_MP4;
+    config.threads = 3;
+    config.keyframe_interval = 10;
+    transcode_stats_t stats;
+    TEST_ASSERT(transcode_file(&config, &stats) == 0);
+    TEST_ASSERT_EQ(TRANSCODE_INPUT_SPOOL, stats.input);
+    TEST_ASSERT_EQ(count, stats.frames);
+    TEST_ASSERT_EQ(count, stats.read.frames);
+    TEST_ASSERT_EQ(count, stats.convert.frames);
+    TEST_ASSERT_EQ(writer.stats.repeats, stats.repeats);
+    TEST_ASSERT_EQ(3, stats.threads);
+
+    size_t picture_size;
+    sample_check_t check;
+    memset(&check, 0, sizeof(check));
+    check.expected = expected_pictures(frames, count, width, height, &picture_size);
+    check.picture_size = picture_size;
+    check.width = width;
+    check.height = height;
+    TEST_ASSERT(check.expected != NULL);
+    fixture_mp4_t info;
+    TEST_ASSERT(check_output(&check, &info) == 0);
+    TEST_ASSERT_EQ(width, info.width);
+    TEST_ASSERT_EQ(height, info.height);
+    TEST_ASSERT_EQ(count, info.samples[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(0, info.tracks[FIXTURE_AUDIO]);
+    TEST_ASSERT_EQ(0, info.first_time[FIXTURE_VIDEO]);
+    // 45 frames at 1/30 s: 1.5 s at 90 kHz
+    TEST_ASSERT_EQ(135000, info.end_time[FIXTURE_VIDEO]);
+    TEST_ASSERT_EQ(count, check.samples);
+    TEST_ASSERT_EQ(0, check.mismatches);
+    TEST_ASSERT_EQ(5, check.keyframes);
+
+    fixture_decoder_free(&check.decoder);
+    free((void*)check.expected);
+    free(frames);
+    remove(TRANSCODE_TEST_SPOOL);
+    remove(TRANSCODE_TEST_MP4);
+    return 0;
+}
+
+static int test_raw_scaled(void) {
+    // Odd input size, halved
+    const int width = 130, height = 74, count = 20;
+    size_t frame_size = (size_t)width * height * 4;
+    uint8_t* frame = (uint8_t*)malloc(frame_size);
+    TEST_ASSERT(frame != NULL);
+    replay_writer_t writer;
+    TEST_ASSERT(replay_writer_open(&writer, TRANSCODE_TEST_RAW, width, height, 25) == 0);
+    for (int i = 0; i < count; i++) {
+        draw_frame(frame, width, height, i);
+        TEST_ASSERT(replay_writer_append(&writer, frame, (size_t)width * 4) == 0);
+    }
+    TEST_ASSERT(replay_writer_close(&writer) == 0);
+    // A frame cut short at the end is ignored
+    FILE* file = fopen(TRANSCODE_TEST_RAW, "ab");
+    TEST_ASSERT(file != NULL);
+    fwrite(frame, 1, frame_size / 2, file);
+    fclose(file);
+
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    config.input = TRANSCODE_TEST_RAW;
+    config.output = TRANSCODE_TEST_MP4;
+    config.scale = 0.5;
+    config.queue_depth = 2;
+    transcode_stats_t stats;
+    TEST_ASSERT(transcode_file(&config, &stats) == 0);
+    TEST_ASSERT_EQ(TRANSCODE_INPUT_RAW, stats.input);
+    TEST_ASSERT_EQ(count, stats.frames);
+    TEST_ASSERT_EQ(0, stats.repeats);
+    TEST_ASSERT_EQ(64, stats.output_width);
+    TEST_ASSERT_EQ(36, stats.output_height);
+
+    sample_check_t check;
+    memset(&check, 0, sizeof(check));
+    fixture_mp4_t info;
+    TEST_ASSERT(check_output(&check, &info) == 0);
+    TEST_ASSERT_EQ(64, info.width);
+    TEST_ASSERT_EQ(36, info.height);
+    TEST_ASSERT_EQ(64, check.decoder.width);
+    TEST_ASSERT_EQ(count, info.samples[FIXTURE_VIDEO]);
+    // 20 frames at the file's 25 fps
+    TEST_ASSERT_EQ(72000, info.end_time[FIXTURE_VIDEO]);
+
+    fixture_decoder_free(&check.decoder);
+    free(frame);
+    remove(TRANSCODE_TEST_RAW);
+    remove(TRANSCODE_TEST_MP4);
+    return 0;
+}
+
+typedef struct {
+    capture_spool_writer_t writer;
+    uint8_t* pixels;
+    int width;
+    int height;
+    int frames;
+    int failed;
+} spool_thread_t;
+
+static void spool_writer_thread(void* arg) {
+    spool_thread_t* spool = (spool_thread_t*)arg;
+    for (int i = 1; i < spool->frames; i++) {
+        platform_sleep_ms(2);
+        draw_frame(spool->pixels, spool->width, spool->height, i);
+        if (capture_spool_writer_append(&spool->writer, spool->pixels, (size_t)spool->width * 4, (int64_t)i * 166667) != 0) {
+            spool->failed = 1;
+        }
+    }
+    if (capture_spool_writer_close(&spool->writer) != 0) spool->failed = 1;
+}
+
+// A spool still being written: without follow the transcode stops at the
+// last whole frame, with it the transcode keeps up until the writer closes
+static int test_open_spool(void) {
+    spool_thread_t spool;
+    memset(&spool, 0, sizeof(spool));
+    spool.width = 96;
+    spool.height = 64;
+    spool.frames = 60;
+    spool.pixels = (uint8_t*)malloc((size_t)spool.width * spool.height * 4);
+    TEST_ASSERT(spool.pixels != NULL);
+    TEST_ASSERT(capture_spool_writer_open(&spool.writer, TRANSCODE_TEST_SPOOL, spool.width, spool.height, 60) == 0);
+    draw_frame(spool.pixels, spool.width, spool.height, 0);
+    TEST_ASSERT(capture_spool_writer_append(&spool.writer, spool.pixels, (size_t)spool.width * 4, 0) == 0);
+
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    config.input = TRANSCODE_TEST_SPOOL;
+    config.output = TRANSCODE_TEST_MP4;
+    transcode_stats_t stats;
+    TEST_ASSERT(transcode_file(&config, &stats) == 0);
+    TEST_ASSERT_EQ(1, stats.frames);
+
+    platform_thread_t thread;
+    TEST_ASSERT(platform_thread_create(&thread, spool_writer_thread, &spool) == 0);
+    config.follow = 1;
+    int result = transcode_file(&config, &stats);
+    platform_thread_join(thread);
+    TEST_ASSERT(result == 0);
+    TEST_ASSERT(!spool.failed);
+    TEST_ASSERT_EQ(spool.frames, stats.frames);
+
+    sample_check_t check;
+    memset(&check, 0, sizeof(check));
+    fixture_mp4_t info;
+    TEST_ASSERT(check_output(&check, &info) == 0);
+    TEST_ASSERT_EQ(spool.frames, info.samples[FIXTURE_VIDEO]);
+
+    fixture_decoder_free(&check.decoder);
+    free(spool.pixels);
+    remove(TRANSCODE_TEST_SPOOL);
+    remove(TRANSCODE_TEST_MP4);
+    return 0;
+}
+
+// The encode stage goes through the encoder backend: null measures reading and
+// conversion alone, and a backend that cannot take NV12 is refused up front
+static int test_encoder_backends(void) {
+    const int width = 64, height = 48, count = 12;
+    uint8_t* frame = (uint8_t*)malloc((size_t)width * height * 4);
+    TEST_ASSERT(frame != NULL);
+    replay_writer_t writer;
+    TEST_ASSERT(replay_writer_open(&writer, TRANSCODE_TEST_RAW, width, height, 30) == 0);
+    for (int i = 0; i < count; i++) {
+        draw_frame(frame, width, height, i);
+        TEST_ASSERT(replay_writer_append(&writer, frame, (size_t)width * 4) == 0);
+    }
+    TEST_ASSERT(replay_writer_close(&writer) == 0);
+    remove(TRANSCODE_TEST_MP4);
+
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    TEST_ASSERT_EQ(ENCODER_BACKEND_H264, config.encoder);
+    config.input = TRANSCODE_TEST_RAW;
+    config.output = TRANSCODE_TEST_MP4;
+    config.encoder = ENCODER_BACKEND_NULL;
+    transcode_stats_t stats;
+    TEST_ASSERT(transcode_file(&config, &stats) == 0);
+    TEST_ASSERT_EQ(ENCODER_BACKEND_NULL, stats.encoder);
+    TEST_ASSERT_EQ(count, stats.frames);
+    TEST_ASSERT_EQ(count, stats.convert.frames);
+    TEST_ASSERT_EQ(0, stats.output_bytes);
+    FILE* file = fopen(TRANSCODE_TEST_MP4, "rb");
+    TEST_ASSERT(file == NULL);
+
+    config.encoder = ENCODER_BACKEND_RAW;
+    TEST_ASSERT(transcode_file(&config, &stats) != 0);
+    TEST_ASSERT_EQ(0, stats.frames);
+
+    free(frame);
+    remove(TRANSCODE_TEST_RAW);
+    remove(TRANSCODE_TEST_MP4);
+    return 0;
+}
+
+static int test_bad_input(void) {
+    transcode_config_t config;
+    transcode_config_defaults(&config);
+    config.input = "test_transcoder_missing.spool";
+    config.output = TRANSCODE_TEST_MP4;
+    transcode_stats_t stats;
+    TEST_ASSERT(transcode_file(&config, &stats) != 0);
+
+    FILE* file = fopen(TRANSCODE_TEST_RAW, "wb");
+    TEST_ASSERT(file != NULL);
+    fputs("not a frame file at all", file);
+    fclose(file);
+    config.input = TRANSCODE_TEST_RAW;
+    TEST_ASSERT(transcode_file(&config, &stats) != 0);
+    remove(TRANSCODE_TEST_RAW);
+    remove(TRANSCODE_TEST_MP4);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+    RUN_TEST(test_spool_to_mp4);
+    RUN_TEST(test_raw_scaled);
+    RUN_TEST(test_open_spool);
+    RUN_TEST(test_encoder_backends);
+    RUN_TEST(test_bad_input);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#include "test_common.h"
+#include "worker_pool.h"
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_MAX_TASKS 1000
+
+typedef struct {
+    platform_atomic_t runs[TEST_MAX_TASKS];
+    platform_atomic_t bad_worker;
+    int threads;
+    int fail_task;
+    int slow_worker;
+} task_record_t;
+
+static int record_task(void* context, int task, int worker) {
+    task_record_t* record = (task_record_t*)context;
+    if (worker < 0 || worker >= record->threads) platform_atomic_inc(&record->bad_worker);
+    if (worker == record->slow_worker) platform_sleep_ms(2);
+    platform_atomic_inc(&record->runs[task]);
+    return task == record->fail_task ? -1 : 0;
+}
+
+static void record_reset(task_record_t* record, int threads) {
+    memset(record, 0, sizeof(task_record_t));
+    record->threads = threads;
+    record->fail_task = -1;
+    record->slow_worker = -1;
+}
+
+static int test_init_and_thread_count(void) {
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(NULL, 2) != 0);
+
+    TEST_ASSERT(worker_pool_init(&pool, 3) == 0);
+    TEST_ASSERT_EQ(3, worker_pool_threads(&pool));
+    worker_pool_cleanup(&pool);
+
+    // Auto-detect uses the CPU count
+    TEST_ASSERT(worker_pool_init(&pool, 0) == 0);
+    TEST_ASSERT_EQ(platform_cpu_count() > WORKER_POOL_MAX_THREADS ? WORKER_POOL_MAX_THREADS : platform_cpu_count(),
+                   worker_pool_threads(&pool));
+    worker_pool_cleanup(&pool);
+
+    TEST_ASSERT_EQ(1, worker_pool_threads(NULL));
+    return 0;
+}
+
+static int test_every_task_runs_once(void) {
+    static task_record_t record;
+    const int thread_counts[] = { 1, 2, 4, 7 };
+    const int task_counts[] = { 1, 3, 16, 999 };
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        worker_pool_t pool;
+        TEST_ASSERT(worker_pool_init(&pool, thread_counts[t]) == 0);
+
+        for (size_t c = 0; c < sizeof(task_counts) / sizeof(task_counts[0]); c++) {
+            record_reset(&record, worker_pool_threads(&pool));
+            TEST_ASSERT(worker_pool_run(&pool, task_counts[c], record_task, &record) == 0);
+            for (int i = 0; i < task_counts[c]; i++) {
+                TEST_ASSERT_EQ(1, platform_atomic_load(&record.runs[i]));
+            }
+            TEST_ASSERT_EQ(0, platform_atomic_load(&record.runs[task_counts[c]]));
+            TEST_ASSERT_EQ(0, platform_atomic_load(&record.bad_worker));
+        }
+        worker_pool_cleanup(&pool);
+    }
+    return 0;
+}
+
+static int test_slow_worker_is_stolen_from(void) {
+    static task_record_t record;
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(&pool, 4) == 0);
+
+    // The caller sleeps on every task it takes, so the helpers drain its share
+    record_reset(&record, 4);
+    record.slow_worker = 0;
+    TEST_ASSERT(worker_pool_run(&pool, 64, record_task, &record) == 0);
+    for (int i = 0; i < 64; i++) {
+        TEST_ASSERT_EQ(1, platform_atomic_load(&record.runs[i]));
+    }
+    TEST_ASSERT(platform_atomic_load(&pool.steals) > 0);
+
+    worker_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_failure_and_reuse(void) {
+    static task_record_t record;
+    worker_pool_t pool;
+    TEST_ASSERT(worker_pool_init(&pool, 3) == 0);
+
+    // A failing task fails the run, but the rest still complete before the join
+    record_reset(&record, 3);
+    record.fail_task = 5;
+    TEST_ASSERT(worker_pool_run(&pool, 20, record_task, &record) != 0);
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQ(1, platform_atomic_load(&record.runs[i]));
+    }
+
+    // Back-to-back runs reuse the same workers
+    for (int run = 0; run < 200; run++) {
+        record_reset(&record, 3);
+        TEST_ASSERT(worker_pool_run(&pool, 10, record_task, &record) == 0);
+        TEST_ASSERT_EQ(1, platform_atomic_load(&record.runs[9]));
+    }
+    TEST_ASSERT_EQ(201, pool.runs);
+
+    TEST_ASSERT(worker_pool_run(&pool, 0, record_task, &record) == 0);
+    TEST_ASSERT(worker_pool_run(&pool, -1, record_task, &record) != 0);
+    TEST_ASSERT(worker_pool_run(&pool, 4, NULL, &record) != 0);
+
+    worker_pool_cleanup(&pool);
+    return 0;
+}
+
+static int test_slice_counts(void) {
+    worker_pool_t pool;
+    TEST_ASSERT_EQ(1, worker_pool_slices(NULL, 1080, 16));
+
+    TEST_ASSERT(worker_pool_init(&pool, 4) == 0);
+    TEST_ASSERT_EQ(16, worker_pool_slices(&pool, 1080, 16));    // A few slices per worker
+    TEST_ASSERT_EQ(4, worker_pool_slices(&pool, 64, 16));       // Limited by the minimum slice size
+    TEST_ASSERT_EQ(1, worker_pool_slices(&pool, 8, 16));
+    worker_pool_cleanup(&pool);
+    return 0;
+}
+
+int main(void) {
+    int failures = 0;
+
+    RUN_TEST(test_init_and_thread_count);
+    RUN_TEST(test_every_task_runs_once);
+    RUN_TEST(test_slow_worker_is_stolen_from);
+    RUN_TEST(test_failure_and_reuse);
+    RUN_TEST(test_slice_counts);
+
+    return failures == 0 ? 0 : 1;
+}